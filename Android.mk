@@ -16,6 +16,10 @@
 # by setting BRILLO_USE_* values. Note that we define local variables like
 # local_use_* to prevent leaking our default setting for other packages.
 local_use_dbus := $(if $(BRILLO_USE_DBUS),$(BRILLO_USE_DBUS),1)
+# The allocator shim overrides malloc() on glibc, i.e. in host builds, to feed
+# the heap profiler. Turn it off for hosts which bring their own malloc().
+local_use_allocator_shim := \
+	$(if $(BRILLO_USE_ALLOCATOR_SHIM),$(BRILLO_USE_ALLOCATOR_SHIM),1)
 
 LOCAL_PATH := $(call my-dir)
 
@@ -37,10 +41,13 @@ libchromeCommonCIncludes := \
 libchromeExportedCIncludes := $(LOCAL_PATH) $(TOP)/external/gtest/include
 
 libchromeCommonSrc := \
+	base/allocator/allocator_shim.cc \
+	base/async_log_writer_posix.cc \
 	base/at_exit.cc \
 	base/base64.cc \
 	base/base64url.cc \
 	base/base_switches.cc \
+	base/binary_log.cc \
 	base/bind_helpers.cc \
 	base/build_time.cc \
 	base/callback_helpers.cc \
@@ -65,10 +72,12 @@ libchromeCommonSrc := \
 	base/files/file_util.cc \
 	base/files/file_util_posix.cc \
 	base/files/important_file_writer.cc \
+	base/files/parallel_file_enumerator.cc \
 	base/files/scoped_file.cc \
 	base/files/scoped_temp_dir.cc \
 	base/guid.cc \
 	base/guid_posix.cc \
+	base/hash.cc \
 	base/json/json_file_value_serializer.cc \
 	base/json/json_parser.cc \
 	base/json/json_reader.cc \
@@ -83,6 +92,7 @@ libchromeCommonSrc := \
 	base/memory/aligned_memory.cc \
 	base/memory/ref_counted.cc \
 	base/memory/ref_counted_memory.cc \
+	base/memory/shared_memory_posix.cc \
 	base/memory/singleton.cc \
 	base/memory/weak_ptr.cc \
 	base/message_loop/incoming_task_queue.cc \
@@ -122,10 +132,12 @@ libchromeCommonSrc := \
 	base/profiler/tracked_time.cc \
 	base/rand_util.cc \
 	base/rand_util_posix.cc \
+	base/ring_sync_socket_posix.cc \
 	base/run_loop.cc \
 	base/sequence_checker_impl.cc \
 	base/sequenced_task_runner.cc \
 	base/sha1_portable.cc \
+	base/strings/double_conversions.cc \
 	base/strings/pattern.cc \
 	base/strings/safe_sprintf.cc \
 	base/strings/string16.cc \
@@ -141,6 +153,7 @@ libchromeCommonSrc := \
 	base/synchronization/condition_variable_posix.cc \
 	base/synchronization/lock.cc \
 	base/synchronization/lock_impl_posix.cc \
+	base/synchronization/read_write_lock.cc \
 	base/synchronization/waitable_event_posix.cc \
 	base/sync_socket_posix.cc \
 	base/sys_info.cc \
@@ -171,10 +184,17 @@ libchromeCommonSrc := \
 	base/time/tick_clock.cc \
 	base/time/time.cc \
 	base/time/time_posix.cc \
+	base/time/time_stamp_counter.cc \
+	base/time/time_stamp_counter_tick_clock.cc \
 	base/timer/elapsed_timer.cc \
 	base/timer/timer.cc \
+	base/trace_event/category_registry.cc \
 	base/trace_event/heap_profiler_allocation_context.cc \
 	base/trace_event/heap_profiler_allocation_context_tracker.cc \
+	base/trace_event/heap_profiler_allocation_register.cc \
+	base/trace_event/heap_profiler_allocation_register_posix.cc \
+	base/trace_event/heap_profiler_allocation_sampler.cc \
+	base/trace_event/heap_profiler_heap_dump_writer.cc \
 	base/trace_event/heap_profiler_stack_frame_deduplicator.cc \
 	base/trace_event/heap_profiler_type_name_deduplicator.cc \
 	base/trace_event/memory_allocator_dump.cc \
@@ -197,6 +217,7 @@ libchromeCommonSrc := \
 	base/trace_event/trace_log.cc \
 	base/trace_event/trace_log_constants.cc \
 	base/trace_event/trace_sampling_thread.cc \
+	base/trace_event/trace_stack_sampler.cc \
 	base/tracked_objects.cc \
 	base/tracking_info.cc \
 	base/values.cc \
@@ -210,6 +231,7 @@ libchromeLinuxSrc := \
 	base/process/process_handle_linux.cc \
 	base/process/process_iterator_linux.cc \
 	base/process/process_metrics_linux.cc \
+	base/process/process_metrics_sampler_linux.cc \
 	base/strings/sys_string_conversions_posix.cc \
 	base/sys_info_linux.cc \
 	base/threading/platform_thread_internal_posix.cc \
@@ -239,10 +261,13 @@ libchromeMacSrc := \
 	base/threading/platform_thread_mac.mm \
 
 libchromeCommonUnittestSrc := \
+	base/allocator/allocator_shim_unittest.cc \
+	base/async_log_writer_posix_unittest.cc \
 	base/at_exit_unittest.cc \
 	base/atomicops_unittest.cc \
 	base/base64_unittest.cc \
 	base/base64url_unittest.cc \
+	base/binary_log_unittest.cc \
 	base/bind_unittest.cc \
 	base/bits_unittest.cc \
 	base/build_time_unittest.cc \
@@ -258,13 +283,17 @@ libchromeCommonUnittestSrc := \
 	base/environment_unittest.cc \
 	base/file_version_info_unittest.cc \
 	base/files/dir_reader_posix_unittest.cc \
+	base/files/file_enumerator_unittest.cc \
 	base/files/file_path_watcher_unittest.cc \
 	base/files/file_path_unittest.cc \
 	base/files/file_unittest.cc \
+	base/files/file_util_unittest.cc \
 	base/files/important_file_writer_unittest.cc \
+	base/files/parallel_file_enumerator_unittest.cc \
 	base/files/scoped_temp_dir_unittest.cc \
 	base/gmock_unittest.cc \
 	base/guid_unittest.cc \
+	base/hash_unittest.cc \
 	base/id_map_unittest.cc \
 	base/json/json_parser_unittest.cc \
 	base/json/json_reader_unittest.cc \
@@ -281,6 +310,7 @@ libchromeCommonUnittestSrc := \
 	base/memory/ref_counted_unittest.cc \
 	base/memory/scoped_ptr_unittest.cc \
 	base/memory/scoped_vector_unittest.cc \
+	base/memory/shared_memory_unittest.cc \
 	base/memory/singleton_unittest.cc \
 	base/memory/weak_ptr_unittest.cc \
 	base/message_loop/message_loop_test.cc \
@@ -302,9 +332,11 @@ libchromeCommonUnittestSrc := \
 	base/pickle_unittest.cc \
 	base/posix/file_descriptor_shuffle_unittest.cc \
 	base/posix/unix_domain_socket_linux_unittest.cc \
+	base/process/process_metrics_sampler_linux_unittest.cc \
 	base/process/process_metrics_unittest.cc \
 	base/profiler/tracked_time_unittest.cc \
 	base/rand_util_unittest.cc \
+	base/ring_sync_socket_unittest.cc \
 	base/scoped_clear_errno_unittest.cc \
 	base/scoped_generic_unittest.cc \
 	base/security_unittest.cc \
@@ -323,6 +355,8 @@ libchromeCommonUnittestSrc := \
 	base/synchronization/cancellation_flag_unittest.cc \
 	base/synchronization/condition_variable_unittest.cc \
 	base/synchronization/lock_unittest.cc \
+	base/synchronization/read_write_lock_unittest.cc \
+	base/synchronization/seq_lock_unittest.cc \
 	base/synchronization/waitable_event_unittest.cc \
 	base/sync_socket_unittest.cc \
 	base/sys_info_unittest.cc \
@@ -359,6 +393,9 @@ libchromeCommonUnittestSrc := \
 	base/timer/hi_res_timer_manager_unittest.cc \
 	base/timer/timer_unittest.cc \
 	base/trace_event/heap_profiler_allocation_context_tracker_unittest.cc \
+	base/trace_event/heap_profiler_allocation_register_unittest.cc \
+	base/trace_event/heap_profiler_allocation_sampler_unittest.cc \
+	base/trace_event/heap_profiler_heap_dump_writer_unittest.cc \
 	base/trace_event/heap_profiler_stack_frame_deduplicator_unittest.cc \
 	base/trace_event/heap_profiler_type_name_deduplicator_unittest.cc \
 	base/trace_event/memory_allocator_dump_unittest.cc \
@@ -370,6 +407,7 @@ libchromeCommonUnittestSrc := \
 	base/trace_event/trace_event_argument_unittest.cc \
 	base/trace_event/trace_event_synthetic_delay_unittest.cc \
 	base/trace_event/trace_event_unittest.cc \
+	base/trace_event/trace_stack_sampler_unittest.cc \
 	base/tracked_objects_unittest.cc \
 	base/tuple_unittest.cc \
 	base/values_unittest.cc \
@@ -383,6 +421,10 @@ libchromeCryptoUnittestSrc := \
 
 libchromeHostCFlags := -D__ANDROID_HOST__
 
+ifeq ($(local_use_allocator_shim),1)
+libchromeHostCFlags += -DUSE_EXPERIMENTAL_ALLOCATOR_SHIM
+endif
+
 ifeq ($(HOST_OS),linux)
 libchromeHostSrc := $(libchromeLinuxSrc)
 libchromeHostLdFlags :=
@@ -490,6 +532,7 @@ LOCAL_SRC_FILES := \
 	crypto/secure_hash_openssl.cc \
 	crypto/secure_util.cc \
 	crypto/sha2.cc \
+	crypto/sha2_internal.cc \
 
 LOCAL_CPP_EXTENSION := $(libchromeCommonCppExtension)
 LOCAL_CFLAGS := $(libchromeCommonCFlags) -Wno-unused-parameter
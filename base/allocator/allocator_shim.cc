@@ -0,0 +1,156 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/allocator/allocator_shim.h"
+
+#include <errno.h>
+#include <stddef.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "base/atomicops.h"
+#include "build/build_config.h"
+
+#if defined(USE_EXPERIMENTAL_ALLOCATOR_SHIM) && defined(__GLIBC__)
+#define ALLOCATOR_SHIM_ENABLED
+#endif
+
+namespace base {
+namespace allocator {
+
+namespace {
+
+subtle::AtomicWord g_allocation_hook = 0;
+subtle::AtomicWord g_free_hook = 0;
+
+#if defined(ALLOCATOR_SHIM_ENABLED)
+
+// The hooks are loaded without barriers: a thread which does not see a newly
+// installed hook yet simply misses a few allocations.
+inline void NotifyAllocation(void* address, size_t size) {
+  AllocationHook hook = reinterpret_cast<AllocationHook>(
+      subtle::NoBarrier_Load(&g_allocation_hook));
+  if (hook && address)
+    hook(address, size);
+}
+
+inline void NotifyFree(void* address) {
+  FreeHook hook =
+      reinterpret_cast<FreeHook>(subtle::NoBarrier_Load(&g_free_hook));
+  if (hook && address)
+    hook(address);
+}
+
+#endif  // defined(ALLOCATOR_SHIM_ENABLED)
+
+}  // namespace
+
+bool IsAllocatorShimEnabled() {
+#if defined(ALLOCATOR_SHIM_ENABLED)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void SetAllocationHooks(AllocationHook allocation_hook, FreeHook free_hook) {
+  subtle::Release_Store(&g_allocation_hook,
+                        reinterpret_cast<subtle::AtomicWord>(allocation_hook));
+  subtle::Release_Store(&g_free_hook,
+                        reinterpret_cast<subtle::AtomicWord>(free_hook));
+}
+
+}  // namespace allocator
+}  // namespace base
+
+#if defined(ALLOCATOR_SHIM_ENABLED)
+
+// glibc exports its allocator under these names as well, which makes it
+// possible to override the public symbols and still reach the real
+// implementation without dlsym(), which itself allocates.
+extern "C" {
+void* __libc_malloc(size_t size);
+void __libc_free(void* ptr);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+}  // extern "C"
+
+using base::allocator::NotifyAllocation;
+using base::allocator::NotifyFree;
+
+extern "C" {
+
+void* malloc(size_t size) {
+  void* ptr = __libc_malloc(size);
+  NotifyAllocation(ptr, size);
+  return ptr;
+}
+
+void free(void* ptr) {
+  NotifyFree(ptr);
+  __libc_free(ptr);
+}
+
+void* calloc(size_t n, size_t size) {
+  void* ptr = __libc_calloc(n, size);
+  // A successful calloc() implies that |n * size| did not overflow.
+  NotifyAllocation(ptr, n * size);
+  return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+  NotifyFree(ptr);
+  void* new_ptr = __libc_realloc(ptr, size);
+  // On failure the original block is left untouched, so report it again. Its
+  // requested size is not known any more, but its usable size is close.
+  if (!new_ptr && size)
+    NotifyAllocation(ptr, malloc_usable_size(ptr));
+  else
+    NotifyAllocation(new_ptr, size);
+  return new_ptr;
+}
+
+void* memalign(size_t alignment, size_t size) {
+  void* ptr = __libc_memalign(alignment, size);
+  NotifyAllocation(ptr, size);
+  return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) {
+  // posix_memalign() is required to validate the alignment, memalign() is not.
+  if (!alignment || alignment % sizeof(void*) ||
+      (alignment & (alignment - 1))) {
+    return EINVAL;
+  }
+  void* ptr = memalign(alignment, size);
+  if (!ptr)
+    return ENOMEM;
+  *result = ptr;
+  return 0;
+}
+
+void* valloc(size_t size) {
+  void* ptr = __libc_valloc(size);
+  NotifyAllocation(ptr, size);
+  return ptr;
+}
+
+void* pvalloc(size_t size) {
+  void* ptr = __libc_pvalloc(size);
+  NotifyAllocation(ptr, size);
+  return ptr;
+}
+
+}  // extern "C"
+
+#endif  // defined(ALLOCATOR_SHIM_ENABLED)
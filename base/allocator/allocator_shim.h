@@ -0,0 +1,46 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_ALLOCATOR_ALLOCATOR_SHIM_H_
+#define BASE_ALLOCATOR_ALLOCATOR_SHIM_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+
+namespace base {
+namespace allocator {
+
+// The allocator shim intercepts the malloc() family of functions and forwards
+// them to the underlying libc allocator, notifying the hooks below of every
+// allocation and free. It is only compiled in when USE_EXPERIMENTAL_ALLOCATOR_
+// SHIM is defined, which the use_experimental_allocator_shim build flag does,
+// and the C library is glibc, which exports the __libc_* entry points the shim
+// forwards to. Everywhere else the hooks are never called, and
+// IsAllocatorShimEnabled() returns false.
+
+// Called after every successful allocation with the address and the requested
+// size. For realloc() this is called for the new block after the free hook
+// was called for the old one; if the realloc() fails, it is called for the
+// old block again, with its usable size.
+typedef void (*AllocationHook)(void* address, size_t size);
+
+// Called before every free of a non-null address.
+typedef void (*FreeHook)(void* address);
+
+// Returns true if the shim is compiled in, i.e. if the hooks will be called.
+BASE_EXPORT bool IsAllocatorShimEnabled();
+
+// Installs the hooks, replacing any previously installed ones. Passing null
+// uninstalls them. The hooks can be called concurrently from any thread, also
+// shortly after they have been uninstalled, so they must be thread-safe and
+// the functions must stay valid for the lifetime of the process. Hooks must
+// guard against reentrancy if they allocate.
+BASE_EXPORT void SetAllocationHooks(AllocationHook allocation_hook,
+                                    FreeHook free_hook);
+
+}  // namespace allocator
+}  // namespace base
+
+#endif  // BASE_ALLOCATOR_ALLOCATOR_SHIM_H_
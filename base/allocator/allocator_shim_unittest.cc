@@ -0,0 +1,119 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/allocator/allocator_shim.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "base/atomicops.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace allocator {
+
+namespace {
+
+// Other threads may allocate while the hooks are installed, so the hooks only
+// record the allocations of unusual sizes, from kSize to a little more than
+// kReallocSize, and the frees of |g_watched_address|.
+const size_t kSize = 12345;
+const size_t kReallocSize = 23456;
+const size_t kMaxRecordedSize = kReallocSize + 64;
+
+subtle::AtomicWord g_last_address = 0;
+subtle::AtomicWord g_last_size = 0;
+subtle::AtomicWord g_watched_address = 0;
+subtle::Atomic32 g_num_watched_frees = 0;
+
+void TestAllocationHook(void* address, size_t size) {
+  if (size < kSize || size > kMaxRecordedSize)
+    return;
+  subtle::NoBarrier_Store(&g_last_address,
+                          reinterpret_cast<subtle::AtomicWord>(address));
+  subtle::NoBarrier_Store(&g_last_size, static_cast<subtle::AtomicWord>(size));
+}
+
+void TestFreeHook(void* address) {
+  if (reinterpret_cast<subtle::AtomicWord>(address) ==
+      subtle::NoBarrier_Load(&g_watched_address)) {
+    subtle::NoBarrier_AtomicIncrement(&g_num_watched_frees, 1);
+  }
+}
+
+void* last_address() {
+  return reinterpret_cast<void*>(subtle::NoBarrier_Load(&g_last_address));
+}
+
+size_t last_size() {
+  return static_cast<size_t>(subtle::NoBarrier_Load(&g_last_size));
+}
+
+// Returns the number of frees of |address| that |free_function| makes.
+template <typename FreeFunction>
+int CountFrees(void* address, FreeFunction free_function) {
+  subtle::NoBarrier_Store(&g_num_watched_frees, 0);
+  subtle::NoBarrier_Store(&g_watched_address,
+                          reinterpret_cast<subtle::AtomicWord>(address));
+  free_function();
+  subtle::NoBarrier_Store(&g_watched_address, 0);
+  return subtle::NoBarrier_Load(&g_num_watched_frees);
+}
+
+}  // namespace
+
+TEST(AllocatorShimTest, HooksSeeTheMallocFamily) {
+  if (!IsAllocatorShimEnabled())
+    return;
+  SetAllocationHooks(&TestAllocationHook, &TestFreeHook);
+
+  void* ptr = malloc(kSize);
+  ASSERT_TRUE(ptr);
+  EXPECT_EQ(ptr, last_address());
+  EXPECT_EQ(kSize, last_size());
+
+  // realloc() frees the old block and allocates the new one.
+  void* new_ptr = nullptr;
+  EXPECT_EQ(1, CountFrees(ptr, [&] { new_ptr = realloc(ptr, kReallocSize); }));
+  ASSERT_TRUE(new_ptr);
+  EXPECT_EQ(new_ptr, last_address());
+  EXPECT_EQ(kReallocSize, last_size());
+
+  // A failed realloc() leaves the block untouched, which is reported again
+  // with its own size.
+  const size_t kHugeSize = static_cast<size_t>(-1) / 2;
+  EXPECT_EQ(nullptr, realloc(new_ptr, kHugeSize));
+  EXPECT_EQ(new_ptr, last_address());
+  EXPECT_LE(kReallocSize, last_size());
+
+  EXPECT_EQ(1, CountFrees(new_ptr, [&] { free(new_ptr); }));
+
+  ptr = calloc(1, kSize);
+  ASSERT_TRUE(ptr);
+  EXPECT_EQ(ptr, last_address());
+  EXPECT_EQ(kSize, last_size());
+  free(ptr);
+
+  ptr = nullptr;
+  ASSERT_EQ(0, posix_memalign(&ptr, 64, kSize));
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % 64);
+  EXPECT_EQ(ptr, last_address());
+  EXPECT_EQ(kSize, last_size());
+  free(ptr);
+
+  SetAllocationHooks(nullptr, nullptr);
+}
+
+TEST(AllocatorShimTest, PosixMemalignValidatesAlignment) {
+  void* ptr = nullptr;
+  EXPECT_EQ(EINVAL, posix_memalign(&ptr, 0, kSize));
+  EXPECT_EQ(EINVAL, posix_memalign(&ptr, 3, kSize));
+  EXPECT_EQ(EINVAL, posix_memalign(&ptr, sizeof(void*) * 3, kSize));
+  EXPECT_EQ(nullptr, ptr);
+}
+
+}  // namespace allocator
+}  // namespace base
@@ -0,0 +1,396 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/async_log_writer_posix.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/posix/eintr_wrapper.h"
+
+// This file must not log: it is called by ~LogMessage(), and its writer thread
+// may hold |write_mutex_|, which a FATAL message needs for Flush().
+
+namespace logging {
+
+namespace {
+
+// Each message is stored after a header holding its length, shifted left by
+// two bits, and its destinations.
+typedef uint32_t Header;
+const size_t kHeaderSize = sizeof(Header);
+const int kDestinationBits = 2;
+const Header kDestinationMask = (1 << kDestinationBits) - 1;
+
+// How long messages may wait to be written with more.
+const int kBatchDelayMs = 20;
+
+// The number of iovecs passed to one writev() call. Each message takes one or
+// two, when it wraps around the end of its buffer.
+const int kMaxIovecs = 64;
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value)
+    result <<= 1;
+  return result;
+}
+
+// Writes all of |iovecs|, resuming after partial writes. Gives up on errors:
+// there is nowhere to report them.
+void WriteIovecs(int fd, struct iovec* iovecs, int count) {
+  while (count > 0) {
+    ssize_t written = HANDLE_EINTR(writev(fd, iovecs, count));
+    if (written < 0)
+      return;
+    while (count > 0 && static_cast<size_t>(written) >= iovecs->iov_len) {
+      written -= iovecs->iov_len;
+      iovecs++;
+      count--;
+    }
+    if (count > 0) {
+      iovecs->iov_base = static_cast<char*>(iovecs->iov_base) + written;
+      iovecs->iov_len -= written;
+    }
+  }
+}
+
+// Collects the iovecs for one destination.
+class IovecList {
+ public:
+  IovecList() : count_(0) {}
+
+  bool full() const { return count_ > kMaxIovecs - 2; }
+
+  void Add(char* data, size_t length) {
+    iovecs_[count_].iov_base = data;
+    iovecs_[count_].iov_len = length;
+    count_++;
+  }
+
+  // Writes the collected iovecs to |fd| unless it is -1, and clears the list.
+  void WriteTo(int fd) {
+    if (fd >= 0)
+      WriteIovecs(fd, iovecs_, count_);
+    count_ = 0;
+  }
+
+ private:
+  struct iovec iovecs_[kMaxIovecs];
+  int count_;
+
+  DISALLOW_COPY_AND_ASSIGN(IovecList);
+};
+
+}  // namespace
+
+// A single-producer, single-consumer ring buffer. |write_position| and
+// |read_position| only increase; they are taken modulo the buffer size when
+// accessing |data|. The owning thread is the only one that advances
+// |write_position|, and the thread holding |write_mutex_| the only one that
+// advances |read_position|.
+struct AsyncLogWriter::Buffer {
+  enum State {
+    FREE,
+    OWNED,
+    // The owning thread exited. The buffer becomes FREE once drained.
+    ORPHANED,
+  };
+
+  Buffer() : state(FREE), write_position(0), read_position(0) {}
+
+  // Copies |length| bytes between |bytes| and |data| at |position|, wrapping
+  // around the end of |data|.
+  void CopyIn(uintptr_t position, const void* bytes, size_t length,
+              size_t size) {
+    const size_t offset = position & (size - 1);
+    const size_t first = std::min(length, size - offset);
+    memcpy(&data[offset], bytes, first);
+    memcpy(&data[0], static_cast<const char*>(bytes) + first, length - first);
+  }
+  void CopyOut(uintptr_t position, void* bytes, size_t length, size_t size) {
+    const size_t offset = position & (size - 1);
+    const size_t first = std::min(length, size - offset);
+    memcpy(bytes, &data[offset], first);
+    memcpy(static_cast<char*>(bytes) + first, &data[0], length - first);
+  }
+
+  base::subtle::Atomic32 state;
+  // Allocated by the first owner, and kept when the buffer is recycled.
+  scoped_ptr<char[]> data;
+  base::subtle::AtomicWord write_position;
+  base::subtle::AtomicWord read_position;
+};
+
+AsyncLogWriter::AsyncLogWriter(size_t buffer_size, int max_buffers)
+    : buffer_size_(RoundUpToPowerOfTwo(std::max(buffer_size, kHeaderSize))),
+      max_buffers_(max_buffers),
+      buffers_(new Buffer[max_buffers]),
+      stderr_fd_(STDERR_FILENO),
+      file_fd_(-1),
+      report_dropped_messages_(true),
+      reported_dropped_count_(0),
+      dropped_count_(0),
+      sleep_state_(AWAKE),
+      stopping_(false),
+      started_(false) {
+  pthread_key_create(&buffer_key_, &ReleaseBuffer);
+  pthread_mutex_init(&write_mutex_, nullptr);
+  pthread_mutex_init(&wake_mutex_, nullptr);
+  pthread_cond_init(&wake_condition_, nullptr);
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+  if (started_) {
+    pthread_mutex_lock(&wake_mutex_);
+    stopping_ = true;
+    pthread_cond_signal(&wake_condition_);
+    pthread_mutex_unlock(&wake_mutex_);
+    pthread_join(thread_, nullptr);
+  }
+  Flush();
+
+  // Threads which still own a buffer will not release it, since the key is
+  // gone; the buffers are deleted anyway.
+  pthread_key_delete(buffer_key_);
+  pthread_cond_destroy(&wake_condition_);
+  pthread_mutex_destroy(&wake_mutex_);
+  pthread_mutex_destroy(&write_mutex_);
+  delete[] buffers_;
+}
+
+bool AsyncLogWriter::Start() {
+  if (started_)
+    return true;
+  started_ = pthread_create(&thread_, nullptr, &ThreadFunc, this) == 0;
+  return started_;
+}
+
+void AsyncLogWriter::SetFileDescriptors(int stderr_fd, int file_fd) {
+  pthread_mutex_lock(&write_mutex_);
+  WriteQueuedMessages();
+  stderr_fd_ = stderr_fd;
+  base::subtle::NoBarrier_Store(&file_fd_, file_fd);
+  pthread_mutex_unlock(&write_mutex_);
+}
+
+bool AsyncLogWriter::Write(const base::StringPiece& message,
+                           int destinations) {
+  if ((destinations & TO_FILE) && base::subtle::NoBarrier_Load(&file_fd_) < 0)
+    return false;
+  const size_t size = kHeaderSize + message.size();
+  if (size > buffer_size_)
+    return false;
+  Buffer* buffer = GetBufferForCurrentThread();
+  if (!buffer)
+    return false;
+
+  const uintptr_t write_position =
+      base::subtle::NoBarrier_Load(&buffer->write_position);
+  const uintptr_t read_position =
+      base::subtle::Acquire_Load(&buffer->read_position);
+  if (buffer_size_ - (write_position - read_position) < size) {
+    base::subtle::NoBarrier_AtomicIncrement(&dropped_count_, 1);
+    return true;
+  }
+
+  const Header header =
+      static_cast<Header>(message.size()) << kDestinationBits |
+      (destinations & kDestinationMask);
+  buffer->CopyIn(write_position, &header, kHeaderSize, buffer_size_);
+  buffer->CopyIn(write_position + kHeaderSize, message.data(), message.size(),
+                 buffer_size_);
+  base::subtle::Release_Store(&buffer->write_position, write_position + size);
+
+  WakeUpWriter(write_position + size - read_position >= buffer_size_ / 2);
+  return true;
+}
+
+void AsyncLogWriter::Flush() {
+  pthread_mutex_lock(&write_mutex_);
+  WriteQueuedMessages();
+  pthread_mutex_unlock(&write_mutex_);
+}
+
+uint32_t AsyncLogWriter::dropped_count() const {
+  return base::subtle::NoBarrier_Load(&dropped_count_);
+}
+
+AsyncLogWriter::Buffer* AsyncLogWriter::GetBufferForCurrentThread() {
+  Buffer* buffer = static_cast<Buffer*>(pthread_getspecific(buffer_key_));
+  if (buffer)
+    return buffer;
+
+  for (int i = 0; i < max_buffers_; i++) {
+    buffer = &buffers_[i];
+    if (base::subtle::NoBarrier_Load(&buffer->state) != Buffer::FREE ||
+        base::subtle::Acquire_CompareAndSwap(&buffer->state, Buffer::FREE,
+                                             Buffer::OWNED) != Buffer::FREE) {
+      continue;
+    }
+    // The writer thread only reads |data| once it sees |write_position|
+    // advance, which is stored with release semantics after this.
+    if (!buffer->data)
+      buffer->data.reset(new char[buffer_size_]);
+    pthread_setspecific(buffer_key_, buffer);
+    return buffer;
+  }
+  return nullptr;
+}
+
+void AsyncLogWriter::WakeUpWriter(bool batch_ready) {
+  // Pairs with the barrier in ThreadMain(): either the writer thread sees the
+  // new message before going to sleep, or this sees |sleep_state_| set.
+  base::subtle::MemoryBarrier();
+  const base::subtle::Atomic32 sleep_state =
+      base::subtle::NoBarrier_Load(&sleep_state_);
+  if (sleep_state == AWAKE ||
+      (sleep_state == WAITING_FOR_BATCH && !batch_ready)) {
+    return;
+  }
+  pthread_mutex_lock(&wake_mutex_);
+  pthread_cond_signal(&wake_condition_);
+  pthread_mutex_unlock(&wake_mutex_);
+}
+
+bool AsyncLogWriter::HasQueuedMessages() const {
+  for (int i = 0; i < max_buffers_; i++) {
+    const Buffer& buffer = buffers_[i];
+    if (base::subtle::NoBarrier_Load(&buffer.write_position) !=
+        base::subtle::NoBarrier_Load(&buffer.read_position)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void AsyncLogWriter::WriteQueuedMessages() {
+  const int file_fd = base::subtle::NoBarrier_Load(&file_fd_);
+  IovecList to_stderr;
+  IovecList to_file;
+
+  for (int i = 0; i < max_buffers_; i++) {
+    Buffer* buffer = &buffers_[i];
+    // Loaded before |write_position|, so that an ORPHANED buffer is seen with
+    // all of its messages.
+    const base::subtle::Atomic32 state =
+        base::subtle::Acquire_Load(&buffer->state);
+    if (state == Buffer::FREE)
+      continue;
+
+    uintptr_t read_position =
+        base::subtle::NoBarrier_Load(&buffer->read_position);
+    const uintptr_t write_position =
+        base::subtle::Acquire_Load(&buffer->write_position);
+    while (read_position != write_position) {
+      // Collect a batch of messages, write it, then free its space.
+      uintptr_t position = read_position;
+      while (position != write_position && !to_stderr.full() &&
+             !to_file.full()) {
+        Header header;
+        buffer->CopyOut(position, &header, kHeaderSize, buffer_size_);
+        const size_t length = header >> kDestinationBits;
+        const size_t offset = (position + kHeaderSize) & (buffer_size_ - 1);
+        const size_t first = std::min(length, buffer_size_ - offset);
+        if ((header & TO_FILE) && file_fd < 0) {
+          // Write() checked |file_fd_| before SetFileDescriptors() reset it,
+          // and the message has no file left to go to.
+          base::subtle::NoBarrier_AtomicIncrement(&dropped_count_, 1);
+        }
+        for (IovecList* list : {&to_stderr, &to_file}) {
+          const int destination = list == &to_stderr ? TO_STDERR : TO_FILE;
+          if (!(header & destination) || (list == &to_file && file_fd < 0))
+            continue;
+          if (first > 0)
+            list->Add(&buffer->data[offset], first);
+          if (length > first)
+            list->Add(&buffer->data[0], length - first);
+        }
+        position += kHeaderSize + length;
+      }
+      to_stderr.WriteTo(stderr_fd_);
+      to_file.WriteTo(file_fd);
+      read_position = position;
+      base::subtle::Release_Store(&buffer->read_position, read_position);
+    }
+
+    if (state == Buffer::ORPHANED)
+      base::subtle::Release_Store(&buffer->state, Buffer::FREE);
+  }
+
+  ReportDroppedMessages();
+}
+
+void AsyncLogWriter::ReportDroppedMessages() {
+  const uint32_t dropped_count = this->dropped_count();
+  if (!report_dropped_messages_ || dropped_count == reported_dropped_count_)
+    return;
+
+  char message[64];
+  const int length =
+      snprintf(message, sizeof(message), "[%u log messages were dropped]\n",
+               dropped_count - reported_dropped_count_);
+  reported_dropped_count_ = dropped_count;
+  struct iovec iovec = {message, static_cast<size_t>(length)};
+  WriteIovecs(stderr_fd_, &iovec, 1);
+  const int file_fd = base::subtle::NoBarrier_Load(&file_fd_);
+  if (file_fd >= 0) {
+    iovec.iov_base = message;
+    iovec.iov_len = length;
+    WriteIovecs(file_fd, &iovec, 1);
+  }
+}
+
+void AsyncLogWriter::ThreadMain() {
+  for (;;) {
+    Flush();
+
+    pthread_mutex_lock(&wake_mutex_);
+    base::subtle::NoBarrier_Store(&sleep_state_, WAITING_FOR_MESSAGES);
+    base::subtle::MemoryBarrier();
+    while (!stopping_ && !HasQueuedMessages())
+      pthread_cond_wait(&wake_condition_, &wake_mutex_);
+    if (!stopping_) {
+      // Missing a wake-up for a half full buffer only delays the batch.
+      base::subtle::NoBarrier_Store(&sleep_state_, WAITING_FOR_BATCH);
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += kBatchDelayMs * 1000000;
+      if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&wake_condition_, &wake_mutex_, &deadline);
+    }
+    base::subtle::NoBarrier_Store(&sleep_state_, AWAKE);
+    const bool stopping = stopping_;
+    pthread_mutex_unlock(&wake_mutex_);
+
+    // The destructor writes what is left.
+    if (stopping)
+      return;
+  }
+}
+
+// static
+void* AsyncLogWriter::ThreadFunc(void* writer) {
+  static_cast<AsyncLogWriter*>(writer)->ThreadMain();
+  return nullptr;
+}
+
+// static
+void AsyncLogWriter::ReleaseBuffer(void* buffer) {
+  // Stored after the last message, so that the writer thread sees them all.
+  base::subtle::Release_Store(&static_cast<Buffer*>(buffer)->state,
+                              Buffer::ORPHANED);
+}
+
+}  // namespace logging
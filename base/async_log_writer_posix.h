@@ -0,0 +1,145 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_ASYNC_LOG_WRITER_POSIX_H_
+#define BASE_ASYNC_LOG_WRITER_POSIX_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+
+namespace logging {
+
+// Writes log messages from a background thread, so that the threads which log
+// wait neither for the disk nor for each other. This implements the
+// WRITE_LOG_ASYNCHRONOUSLY mode of logging.h.
+//
+// Each thread that logs gets a ring buffer of its own, which it appends its
+// messages to without taking a lock. The writer thread drains the buffers with
+// one writev() per buffer and destination, in batches: messages wait up to
+// 20 ms, or until a buffer is half full. Memory use is bounded: there are at
+// most |max_buffers| buffers of |buffer_size| bytes, and a message which finds
+// its thread's buffer full is dropped and counted. The number of dropped
+// messages is written out with the next batch.
+//
+// The messages of one thread are written in order, but those of different
+// threads may be interleaved differently than they were logged.
+//
+// The writer thread does not survive fork(); a child process which logs must
+// use synchronous logging.
+class BASE_EXPORT AsyncLogWriter {
+ public:
+  // Where a message goes. These may be combined.
+  enum Destination {
+    TO_STDERR = 1 << 0,
+    TO_FILE = 1 << 1,
+  };
+
+  // |buffer_size| is rounded up to a power of two. Messages go to
+  // STDERR_FILENO and nowhere else until SetFileDescriptors() is called.
+  AsyncLogWriter(size_t buffer_size, int max_buffers);
+
+  // Stops the writer thread and writes the queued messages.
+  ~AsyncLogWriter();
+
+  // Starts the writer thread. Until then, queued messages are only written by
+  // Flush(). Returns false if the thread could not be created.
+  bool Start();
+
+  // Whether the number of dropped messages is written out, as text, after the
+  // batch in which they would have been. Defaults to true; call before Start()
+  // to change it, for instance when the messages are not text.
+  void set_report_dropped_messages(bool report) {
+    report_dropped_messages_ = report;
+  }
+
+  // Writes the queued messages to the current descriptors, then sets the ones
+  // for TO_STDERR and TO_FILE. -1 means none: TO_FILE messages are then not
+  // accepted by Write(), and those which Write() raced to queue meanwhile are
+  // counted as dropped. The descriptors are not owned.
+  void SetFileDescriptors(int stderr_fd, int file_fd);
+
+  // Queues |message| for |destinations|, or drops it if the calling thread's
+  // buffer is full. Returns false, doing neither, if the message cannot be
+  // written asynchronously: when there is no descriptor for TO_FILE, when no
+  // buffer is left for the calling thread, or when |message| does not fit in
+  // one. The caller should then write it itself.
+  bool Write(const base::StringPiece& message, int destinations);
+
+  // Writes the queued messages, from the calling thread, before returning.
+  // Call this before writing a message synchronously that must come after
+  // them, such as a FATAL one.
+  void Flush();
+
+  // Returns the number of messages dropped so far.
+  uint32_t dropped_count() const;
+
+ private:
+  struct Buffer;
+
+  // Returns the calling thread's buffer, or nullptr if all are taken.
+  Buffer* GetBufferForCurrentThread();
+
+  // Wakes the writer thread up if it waits for the first message, or for a
+  // batch and |batch_ready| is true.
+  void WakeUpWriter(bool batch_ready);
+
+  // Returns true if a buffer holds messages.
+  bool HasQueuedMessages() const;
+
+  // Writes all the messages queued so far, and recycles the buffers of the
+  // threads that exited. Requires |write_mutex_|.
+  void WriteQueuedMessages();
+
+  // Writes out the number of dropped messages if it changed. Requires
+  // |write_mutex_|.
+  void ReportDroppedMessages();
+
+  void ThreadMain();
+  static void* ThreadFunc(void* writer);
+
+  // Destructor of |buffer_key_|: gives |buffer| back once it has been drained.
+  static void ReleaseBuffer(void* buffer);
+
+  const size_t buffer_size_;
+  const int max_buffers_;
+  Buffer* const buffers_;  // Owned, |max_buffers_| of them.
+
+  // The calling thread's Buffer.
+  pthread_key_t buffer_key_;
+
+  // Held while writing, so that messages are written in order by one thread
+  // at a time.
+  pthread_mutex_t write_mutex_;
+  int stderr_fd_;
+  // Also read without |write_mutex_| by Write().
+  base::subtle::Atomic32 file_fd_;
+  bool report_dropped_messages_;
+  uint32_t reported_dropped_count_;
+
+  base::subtle::Atomic32 dropped_count_;
+
+  // What the writer thread waits for on |wake_condition_|, if anything. When
+  // messages are queued, it waits for a batch to build up: until a buffer is
+  // half full, or for kBatchDelayMs.
+  enum SleepState { AWAKE, WAITING_FOR_MESSAGES, WAITING_FOR_BATCH };
+  pthread_mutex_t wake_mutex_;
+  pthread_cond_t wake_condition_;
+  base::subtle::Atomic32 sleep_state_;
+  bool stopping_;  // Guarded by |wake_mutex_|.
+
+  bool started_;
+  pthread_t thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncLogWriter);
+};
+
+}  // namespace logging
+
+#endif  // BASE_ASYNC_LOG_WRITER_POSIX_H_
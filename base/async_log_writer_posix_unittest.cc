@@ -0,0 +1,218 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/async_log_writer_posix.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "base/files/scoped_file.h"
+#include "base/macros.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace logging {
+
+namespace {
+
+class AsyncLogWriterTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    stderr_file_.reset(tmpfile());
+    log_file_.reset(tmpfile());
+    ASSERT_TRUE(stderr_file_);
+    ASSERT_TRUE(log_file_);
+  }
+
+  int stderr_fd() const { return fileno(stderr_file_.get()); }
+  int log_fd() const { return fileno(log_file_.get()); }
+
+  static std::string ReadAll(int fd) {
+    std::string contents;
+    char buffer[4096];
+    ssize_t read;
+    while ((read = pread(fd, buffer, sizeof(buffer), contents.size())) > 0)
+      contents.append(buffer, read);
+    return contents;
+  }
+
+  base::ScopedFILE stderr_file_;
+  base::ScopedFILE log_file_;
+};
+
+// Writes |count| numbered messages to an AsyncLogWriter.
+class WritingThread : public base::DelegateSimpleThread::Delegate {
+ public:
+  WritingThread(AsyncLogWriter* writer, int id, int count)
+      : writer_(writer), id_(id), count_(count), rejected_(0) {}
+
+  void Run() override {
+    for (int i = 0; i < count_; i++) {
+      if (!writer_->Write(base::StringPrintf("%d %d\n", id_, i),
+                          AsyncLogWriter::TO_FILE)) {
+        rejected_++;
+      }
+    }
+  }
+
+  int rejected() const { return rejected_; }
+
+ private:
+  AsyncLogWriter* const writer_;
+  const int id_;
+  const int count_;
+  int rejected_;
+
+  DISALLOW_COPY_AND_ASSIGN(WritingThread);
+};
+
+}  // namespace
+
+TEST_F(AsyncLogWriterTest, WritesToDestinations) {
+  AsyncLogWriter writer(256, 1);
+  writer.SetFileDescriptors(stderr_fd(), log_fd());
+
+  EXPECT_TRUE(writer.Write("a\n", AsyncLogWriter::TO_STDERR));
+  EXPECT_TRUE(writer.Write("b\n", AsyncLogWriter::TO_FILE));
+  EXPECT_TRUE(writer.Write(
+      "c\n", AsyncLogWriter::TO_STDERR | AsyncLogWriter::TO_FILE));
+  // Nothing is written without the writer thread until Flush().
+  EXPECT_EQ("", ReadAll(stderr_fd()));
+  writer.Flush();
+  EXPECT_EQ("a\nc\n", ReadAll(stderr_fd()));
+  EXPECT_EQ("b\nc\n", ReadAll(log_fd()));
+
+  // Messages wrap around the end of the buffer.
+  std::string expected;
+  for (int i = 0; i < 100; i++) {
+    const std::string message = base::StringPrintf("message %d\n", i);
+    EXPECT_TRUE(writer.Write(message, AsyncLogWriter::TO_FILE));
+    expected += message;
+    if (i % 7 == 0)
+      writer.Flush();
+  }
+  writer.Flush();
+  EXPECT_EQ("b\nc\n" + expected, ReadAll(log_fd()));
+  EXPECT_EQ(0u, writer.dropped_count());
+}
+
+TEST_F(AsyncLogWriterTest, RejectsMessagesItCannotQueue) {
+  AsyncLogWriter writer(64, 1);
+  writer.SetFileDescriptors(stderr_fd(), -1);
+
+  // There is no file.
+  EXPECT_FALSE(writer.Write("a\n", AsyncLogWriter::TO_FILE));
+  EXPECT_TRUE(writer.Write("b\n", AsyncLogWriter::TO_STDERR));
+  // Too long for the buffer.
+  EXPECT_FALSE(writer.Write(std::string(64, 'c'), AsyncLogWriter::TO_STDERR));
+
+  // This thread has the only buffer.
+  WritingThread writing_thread(&writer, 1, 1);
+  base::DelegateSimpleThread thread(&writing_thread, "WritingThread");
+  thread.Start();
+  thread.Join();
+  EXPECT_EQ(1, writing_thread.rejected());
+
+  writer.Flush();
+  EXPECT_EQ("b\n", ReadAll(stderr_fd()));
+}
+
+TEST_F(AsyncLogWriterTest, DropsMessagesWhenFull) {
+  AsyncLogWriter writer(64, 1);
+  writer.SetFileDescriptors(stderr_fd(), log_fd());
+
+  // Each message takes 16 bytes with its header.
+  const std::string message = "0123456789\n";
+  for (int i = 0; i < 6; i++)
+    EXPECT_TRUE(writer.Write(message, AsyncLogWriter::TO_FILE));
+  EXPECT_EQ(2u, writer.dropped_count());
+
+  writer.Flush();
+  EXPECT_EQ(message + message + message + message +
+                "[2 log messages were dropped]\n",
+            ReadAll(log_fd()));
+  EXPECT_EQ("[2 log messages were dropped]\n", ReadAll(stderr_fd()));
+
+  // There is room again.
+  EXPECT_TRUE(writer.Write(message, AsyncLogWriter::TO_FILE));
+  writer.Flush();
+  EXPECT_EQ(2u, writer.dropped_count());
+  EXPECT_EQ(message + message + message + message +
+                "[2 log messages were dropped]\n" + message,
+            ReadAll(log_fd()));
+}
+
+TEST_F(AsyncLogWriterTest, WritesFromManyThreads) {
+  const int kThreads = 8;
+  const int kMessages = 1000;
+  {
+    // The buffers fit all the messages, so none are dropped however slow the
+    // writer thread is.
+    AsyncLogWriter writer(16 * 1024, kThreads);
+    writer.SetFileDescriptors(stderr_fd(), log_fd());
+    ASSERT_TRUE(writer.Start());
+
+    std::vector<scoped_ptr<WritingThread>> writing_threads;
+    std::vector<scoped_ptr<base::DelegateSimpleThread>> threads;
+    for (int i = 0; i < kThreads; i++) {
+      writing_threads.push_back(
+          make_scoped_ptr(new WritingThread(&writer, i, kMessages)));
+      threads.push_back(make_scoped_ptr(new base::DelegateSimpleThread(
+          writing_threads.back().get(), "WritingThread")));
+      threads.back()->Start();
+    }
+    for (int i = 0; i < kThreads; i++) {
+      threads[i]->Join();
+      EXPECT_EQ(0, writing_threads[i]->rejected());
+    }
+    EXPECT_EQ(0u, writer.dropped_count());
+  }
+
+  // The destructor wrote everything, in order for each thread.
+  std::vector<int> next_message(kThreads, 0);
+  for (const std::string& line :
+       base::SplitString(ReadAll(log_fd()), "\n", base::KEEP_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    std::vector<std::string> fields = base::SplitString(
+        line, " ", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+    ASSERT_EQ(2u, fields.size());
+    int thread;
+    int message;
+    ASSERT_TRUE(base::StringToInt(fields[0], &thread));
+    ASSERT_TRUE(base::StringToInt(fields[1], &message));
+    ASSERT_GE(thread, 0);
+    ASSERT_LT(thread, kThreads);
+    EXPECT_EQ(next_message[thread]++, message);
+  }
+  for (int i = 0; i < kThreads; i++)
+    EXPECT_EQ(kMessages, next_message[i]);
+}
+
+TEST_F(AsyncLogWriterTest, RecyclesBuffersOfExitedThreads) {
+  AsyncLogWriter writer(64, 1);
+  writer.SetFileDescriptors(stderr_fd(), log_fd());
+
+  std::string expected;
+  for (int i = 0; i < 4; i++) {
+    WritingThread writing_thread(&writer, i, 1);
+    base::DelegateSimpleThread thread(&writing_thread, "WritingThread");
+    thread.Start();
+    thread.Join();
+    EXPECT_EQ(0, writing_thread.rejected());
+    expected += base::StringPrintf("%d 0\n", i);
+
+    // Once drained, the buffer of the exited thread is free again.
+    writer.Flush();
+  }
+  EXPECT_EQ(expected, ReadAll(log_fd()));
+}
+
+}  // namespace logging
@@ -5,6 +5,9 @@
 {
   'variables': {
     'chromium_code': 1,
+    # Overrides malloc() and friends on glibc to call the allocation hooks of
+    # base/allocator/allocator_shim.h, which feed the heap profiler.
+    'use_experimental_allocator_shim%': 0,
   },
   'includes': [
     '../build/win_precompile.gypi',
@@ -35,6 +38,11 @@
         ],
       },
       'conditions': [
+        ['use_experimental_allocator_shim==1', {
+          'defines': [
+            'USE_EXPERIMENTAL_ALLOCATOR_SHIM',
+          ],
+        }],
         ['desktop_linux == 1 or chromeos == 1', {
           'conditions': [
             ['chromeos==1', {
@@ -220,6 +228,8 @@
         }],
         ['OS=="ios"', {
           'sources!': [
+            'ring_sync_socket.h',
+            'ring_sync_socket_posix.cc',
             'sync_socket.h',
             'sync_socket_posix.cc',
           ]
@@ -243,6 +253,8 @@
         'metrics/field_trial.h',
         'posix/file_descriptor_shuffle.cc',
         'posix/file_descriptor_shuffle.h',
+        'ring_sync_socket.h',
+        'ring_sync_socket_posix.cc',
         'sync_socket.h',
         'sync_socket_posix.cc',
         'sync_socket_win.cc',
@@ -426,6 +438,7 @@
       'target_name': 'base_unittests',
       'type': '<(gtest_target_type)',
       'sources': [
+        'allocator/allocator_shim_unittest.cc',
         'allocator/tcmalloc_unittest.cc',
         'android/application_status_listener_unittest.cc',
         'android/content_uri_utils_unittest.cc',
@@ -436,12 +449,14 @@
         'android/path_utils_unittest.cc',
         'android/scoped_java_ref_unittest.cc',
         'android/sys_utils_unittest.cc',
+        'async_log_writer_posix_unittest.cc',
         'at_exit_unittest.cc',
         'atomicops_unittest.cc',
         'barrier_closure_unittest.cc',
         'base64_unittest.cc',
         'base64url_unittest.cc',
         'big_endian_unittest.cc',
+        'binary_log_unittest.cc',
         'bind_unittest.cc',
         'bind_unittest.nc',
         'bits_unittest.cc',
@@ -472,6 +487,7 @@
         'feature_list_unittest.cc',
         'file_version_info_unittest.cc',
         'files/dir_reader_posix_unittest.cc',
+        'files/file_enumerator_unittest.cc',
         'files/file_locking_unittest.cc',
         'files/file_path_unittest.cc',
         'files/file_path_watcher_unittest.cc',
@@ -481,6 +497,7 @@
         'files/file_util_unittest.cc',
         'files/important_file_writer_unittest.cc',
         'files/memory_mapped_file_unittest.cc',
+        'files/parallel_file_enumerator_unittest.cc',
         'files/scoped_temp_dir_unittest.cc',
         'gmock_unittest.cc',
         'guid_unittest.cc',
@@ -578,6 +595,7 @@
         'process/memory_unittest.cc',
         'process/memory_unittest_mac.h',
         'process/memory_unittest_mac.mm',
+        'process/process_metrics_sampler_linux_unittest.cc',
         'process/process_metrics_unittest.cc',
         'process/process_metrics_unittest_ios.cc',
         'process/process_unittest.cc',
@@ -585,6 +603,7 @@
         'profiler/stack_sampling_profiler_unittest.cc',
         'profiler/tracked_time_unittest.cc',
         'rand_util_unittest.cc',
+        'ring_sync_socket_unittest.cc',
         'scoped_clear_errno_unittest.cc',
         'scoped_generic_unittest.cc',
         'scoped_native_library_unittest.cc',
@@ -612,6 +631,8 @@
         'synchronization/cancellation_flag_unittest.cc',
         'synchronization/condition_variable_unittest.cc',
         'synchronization/lock_unittest.cc',
+        'synchronization/read_write_lock_unittest.cc',
+        'synchronization/seq_lock_unittest.cc',
         'synchronization/waitable_event_unittest.cc',
         'synchronization/waitable_event_watcher_unittest.cc',
         'sys_info_unittest.cc',
@@ -782,6 +803,7 @@
             'file_descriptor_shuffle_unittest.cc',
             'files/dir_reader_posix_unittest.cc',
             'message_loop/message_pump_libevent_unittest.cc',
+            'ring_sync_socket_unittest.cc',
             'threading/worker_pool_posix_unittest.cc',
           ],
           # TODO(jschuh): crbug.com/167187 fix size_t to int truncations.
@@ -838,6 +860,7 @@
         # SyncSocket isn't used on iOS
         ['OS=="ios"', {
           'sources!': [
+            'ring_sync_socket_unittest.cc',
             'sync_socket_unittest.cc',
           ],
         }],
@@ -853,12 +876,39 @@
         '../testing/gtest.gyp:gtest',
       ],
       'sources': [
+        'base64_perftest.cc',
+        'binary_log_perftest.cc',
+        'callback_perftest.cc',
+        'files/file_enumerator_perftest.cc',
+        'files/file_util_perftest.cc',
+        'hash_perftest.cc',
         'message_loop/message_pump_perftest.cc',
+        'observer_list_perftest.cc',
+        'posix/unix_domain_socket_linux_perftest.cc',
+        'sha1_perftest.cc',
+        'strings/string_number_conversions_perftest.cc',
+        'synchronization/synchronization_perftest.cc',
         'test/run_all_unittests.cc',
         'threading/thread_perftest.cc',
+        'time/time_perftest.cc',
+        'trace_event/heap_profiler_allocation_sampler_perftest.cc',
+        'trace_event/trace_event_argument_perftest.cc',
         '../testing/perf/perf_test.cc'
       ],
       'conditions': [
+        ['OS == "linux" or OS == "android"', {
+          'sources': [
+            'memory/shared_memory_perftest.cc',
+            'trace_event/process_memory_maps_dump_provider_perftest.cc',
+          ],
+        }],
+        # RingSyncSocket is only implemented on POSIX, and SyncSocket isn't
+        # used on iOS.
+        ['OS != "win" and OS != "ios"', {
+          'sources': [
+            'sync_socket_perftest.cc',
+          ],
+        }],
         ['OS == "android"', {
           'dependencies': [
             '../testing/android/native_test.gyp:native_test_native_code',
@@ -1138,6 +1188,17 @@
             'i18n/build_utf8_validator_tables.cc'
           ],
         },
+        {
+          # GN: //base:decode_binary_log
+          'target_name': 'decode_binary_log',
+          'type': 'executable',
+          'sources': [
+            'decode_binary_log.cc',
+          ],
+          'dependencies': [
+            'base',
+          ],
+        },
       ],
     }],
     ['OS == "win" and target_arch=="ia32"', {
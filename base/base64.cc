@@ -4,31 +4,421 @@
 
 #include "base/base64.h"
 
-#include <stddef.h>
+#include <stdint.h>
 
-#include <modp_b64/modp_b64.h>
+#include "base/base64_internal.h"
+#include "base/cpu.h"
+
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+#include <immintrin.h>
+#endif
 
 namespace base {
 
-void Base64Encode(const StringPiece& input, std::string* output) {
-  std::string temp;
-  temp.resize(modp_b64_encode_len(input.size()));  // makes room for null byte
+namespace {
 
-  // modp_b64_encode_len() returns at least 1, so temp[0] is safe to use.
-  size_t output_size = modp_b64_encode(&(temp[0]), input.data(), input.size());
+const char kPaddingChar = '=';
 
-  temp.resize(output_size);  // strips off null byte
-  output->swap(temp);
+struct Alphabet {
+  // The characters, indexed by their values.
+  char chars[65];
+
+  // The tables of the x86 kernels, described below. They are 16 bytes each so
+  // that they are looked up with a single byte shuffle.
+  int8_t encode_offsets[16];
+  uint8_t decode_invalid_lo[16];
+  int8_t decode_offsets[16];
+};
+
+// The x86 kernels follow those of Wojciech Muła:
+// http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+// http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html
+//
+// Encoding maps each 6-bit value v to an index i, 13 for v < 26, v - 51 (from
+// 0 to 12) otherwise, and adds |encode_offsets[i]| to v to get the character.
+//
+// Decoding checks all characters of a vector at once. The valid low nibbles of
+// a character depend on its high nibble, so each class of high nibbles gets a
+// bit, set in kDecodeInvalidHi. |decode_invalid_lo| has the bits of all the
+// classes for which a low nibble is invalid, so that a character is invalid
+// iff the two lookups share a bit:
+//   0x01: high nibbles 0-1 and 8-f, which are always invalid.
+//   0x02: 2, where only the two special characters of STANDARD are, or the
+//         first special character of URL_SAFE.
+//   0x04: 3, with digits from 0 to 9.
+//   0x08: 4 and 6, with letters from 1 to f.
+//   0x10: 5, with letters from 0 to a, and the second special character of
+//         URL_SAFE.
+//   0x20: 7, with letters from 0 to a.
+// The value of a valid character is then the sum of the character and
+// |decode_offsets[i]|, where i is its high nibble, plus 8 for the last
+// character of the alphabet, so that it gets its own offset.
+
+const uint8_t kDecodeInvalidHi[16] = {
+    0x01, 0x01, 0x02, 0x04, 0x08, 0x10, 0x08, 0x20,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+};
+
+const Alphabet kStandardAlphabet = {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+    {'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+     '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0},
+    {0x0b, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+     0x03, 0x03, 0x07, 0x35, 0x37, 0x37, 0x37, 0x35},
+    {0, 0, 62 - '+', 4, -65, -65, -71, -71,
+     0, 0, 63 - '/', 0, 0, 0, 0, 0},
+};
+
+const Alphabet kUrlSafeAlphabet = {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_",
+    {'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+     '0' - 52, '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0},
+    {0x0b, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+     0x03, 0x03, 0x07, 0x37, 0x37, 0x35, 0x37, 0x27},
+    {0, 0, 62 - '-', 4, -65, -65, -71, -71,
+     0, 0, 0, 0, 0, 63 - '_', 0, 0},
+};
+
+const Alphabet& GetAlphabet(internal::Base64Alphabet alphabet) {
+  return alphabet == internal::Base64Alphabet::URL_SAFE ? kUrlSafeAlphabet
+                                                        : kStandardAlphabet;
+}
+
+// Returns the value of the character |c| in |alphabet|, or -1.
+inline int DecodeChar(uint8_t c, const Alphabet& alphabet) {
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 26;
+  if (c >= '0' && c <= '9')
+    return c - '0' + 52;
+  if (c == static_cast<uint8_t>(alphabet.chars[62]))
+    return 62;
+  if (c == static_cast<uint8_t>(alphabet.chars[63]))
+    return 63;
+  return -1;
+}
+
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+// The kernels below consume whole vectors of input and return the number of
+// bytes or characters consumed. Each 3 bytes make 4 characters.
+
+__attribute__((target("ssse3")))
+size_t EncodeSSSE3(const uint8_t* input,
+                   size_t size,
+                   const Alphabet& alphabet,
+                   char* output) {
+  const __m128i offsets = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(alphabet.encode_offsets));
+  // Each 32-bit lane gets the bytes [b1, b0, b2, b1] of a group of 3.
+  const __m128i spread =
+      _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+  // A vector is loaded for every 12 bytes.
+  size_t consumed = 0;
+  for (; size - consumed >= 16; consumed += 12, output += 16) {
+    __m128i in = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(input + consumed));
+    in = _mm_shuffle_epi8(in, spread);
+
+    // Move each 6-bit value into its own byte with two multiplications.
+    const __m128i high = _mm_mulhi_epu16(
+        _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+        _mm_set1_epi32(0x04000040));
+    const __m128i low = _mm_mullo_epi16(
+        _mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+        _mm_set1_epi32(0x01000010));
+    const __m128i values = _mm_or_si128(high, low);
+
+    __m128i indices = _mm_subs_epu8(values, _mm_set1_epi8(51));
+    const __m128i letters = _mm_cmpgt_epi8(_mm_set1_epi8(26), values);
+    indices = _mm_or_si128(indices, _mm_and_si128(letters, _mm_set1_epi8(13)));
+    const __m128i chars =
+        _mm_add_epi8(values, _mm_shuffle_epi8(offsets, indices));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), chars);
+  }
+  return consumed;
+}
+
+// Returns a 16-byte |table| in both lanes.
+__attribute__((target("avx2")))
+inline __m256i LoadTableAVX2(const void* table) {
+  const __m128i lane = _mm_loadu_si128(static_cast<const __m128i*>(table));
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lane), lane, 1);
+}
+
+__attribute__((target("avx2")))
+size_t EncodeAVX2(const uint8_t* input,
+                  size_t size,
+                  const Alphabet& alphabet,
+                  char* output) {
+  const __m256i offsets = LoadTableAVX2(alphabet.encode_offsets);
+  const __m256i spread = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+  // Each 128-bit lane gets 12 bytes, so 28 bytes are read for every 24.
+  size_t consumed = 0;
+  for (; size - consumed >= 32; consumed += 24, output += 32) {
+    const uint8_t* p = input + consumed;
+    __m256i in = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1);
+    in = _mm256_shuffle_epi8(in, spread);
+
+    const __m256i high = _mm256_mulhi_epu16(
+        _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+        _mm256_set1_epi32(0x04000040));
+    const __m256i low = _mm256_mullo_epi16(
+        _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+        _mm256_set1_epi32(0x01000010));
+    const __m256i values = _mm256_or_si256(high, low);
+
+    __m256i indices = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+    const __m256i letters = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+    indices = _mm256_or_si256(indices,
+                              _mm256_and_si256(letters, _mm256_set1_epi8(13)));
+    const __m256i chars =
+        _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets, indices));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), chars);
+  }
+  // Compilers only do this when optimizing, and SSE code running with dirty
+  // upper halves of the AVX registers is much slower.
+  _mm256_zeroupper();
+  return consumed;
+}
+
+// The decoding kernels stop at the first vector with an invalid character,
+// which the portable code then reports. They store 4 bytes past the output of
+// each vector, so they leave enough input for the rest of the output to
+// overwrite them.
+
+__attribute__((target("ssse3")))
+size_t DecodeSSSE3(const uint8_t* input,
+                   size_t size,
+                   const Alphabet& alphabet,
+                   uint8_t* output) {
+  const __m128i invalid_lo = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(alphabet.decode_invalid_lo));
+  const __m128i invalid_hi =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDecodeInvalidHi));
+  const __m128i offsets = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(alphabet.decode_offsets));
+  const __m128i last_char = _mm_set1_epi8(alphabet.chars[63]);
+  const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                     -1, -1, -1, -1);
+
+  size_t consumed = 0;
+  for (; size - consumed >= 24; consumed += 16, output += 12) {
+    const __m128i in = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(input + consumed));
+    const __m128i hi_nibbles =
+        _mm_and_si128(_mm_srli_epi32(in, 4), nibble_mask);
+    const __m128i lo_nibbles = _mm_and_si128(in, nibble_mask);
+    const __m128i invalid =
+        _mm_and_si128(_mm_shuffle_epi8(invalid_lo, lo_nibbles),
+                      _mm_shuffle_epi8(invalid_hi, hi_nibbles));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) !=
+        0xffff) {
+      break;
+    }
+
+    const __m128i indices = _mm_or_si128(
+        hi_nibbles,
+        _mm_and_si128(_mm_cmpeq_epi8(in, last_char), _mm_set1_epi8(8)));
+    const __m128i values =
+        _mm_add_epi8(in, _mm_shuffle_epi8(offsets, indices));
+
+    // Merge the 6-bit values into 24-bit groups, and pack them.
+    const __m128i pairs =
+        _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                     _mm_shuffle_epi8(groups, pack));
+  }
+  return consumed;
+}
+
+__attribute__((target("avx2")))
+size_t DecodeAVX2(const uint8_t* input,
+                  size_t size,
+                  const Alphabet& alphabet,
+                  uint8_t* output) {
+  const __m256i invalid_lo = LoadTableAVX2(alphabet.decode_invalid_lo);
+  const __m256i invalid_hi = LoadTableAVX2(kDecodeInvalidHi);
+  const __m256i offsets = LoadTableAVX2(alphabet.decode_offsets);
+  const __m256i last_char = _mm256_set1_epi8(alphabet.chars[63]);
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  // Moves the 12 bytes of the high lane next to those of the low lane.
+  const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+  size_t consumed = 0;
+  for (; size - consumed >= 48; consumed += 32, output += 24) {
+    const __m256i in = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(input + consumed));
+    const __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble_mask);
+    const __m256i lo_nibbles = _mm256_and_si256(in, nibble_mask);
+    const __m256i invalid =
+        _mm256_and_si256(_mm256_shuffle_epi8(invalid_lo, lo_nibbles),
+                         _mm256_shuffle_epi8(invalid_hi, hi_nibbles));
+    if (!_mm256_testz_si256(invalid, invalid))
+      break;
+
+    const __m256i indices = _mm256_or_si256(
+        hi_nibbles, _mm256_and_si256(_mm256_cmpeq_epi8(in, last_char),
+                                     _mm256_set1_epi8(8)));
+    const __m256i values =
+        _mm256_add_epi8(in, _mm256_shuffle_epi8(offsets, indices));
+
+    const __m256i pairs =
+        _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    const __m256i groups =
+        _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    const __m256i packed = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(groups, pack), join);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), packed);
+  }
+  _mm256_zeroupper();
+  return consumed;
+}
+
+#endif  // defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+}  // namespace
+
+namespace internal {
+
+size_t Base64EncodeWithAlphabet(const StringPiece& input,
+                                Base64Alphabet alphabet_id,
+                                bool pad,
+                                char* output) {
+  const Alphabet& alphabet = GetAlphabet(alphabet_id);
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(input.data());
+  size_t size = input.size();
+  char* out = output;
+
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+  size_t consumed = 0;
+  if (CPU::HasFeature(CPU::FEATURE_AVX2))
+    consumed = EncodeAVX2(in, size, alphabet, out);
+  if (CPU::HasFeature(CPU::FEATURE_SSSE3)) {
+    consumed += EncodeSSSE3(in + consumed, size - consumed, alphabet,
+                            out + consumed / 3 * 4);
+  }
+  in += consumed;
+  size -= consumed;
+  out += consumed / 3 * 4;
+#endif
+
+  const char* chars = alphabet.chars;
+  for (; size >= 3; size -= 3, in += 3, out += 4) {
+    const uint32_t group = (in[0] << 16) | (in[1] << 8) | in[2];
+    out[0] = chars[group >> 18];
+    out[1] = chars[(group >> 12) & 0x3f];
+    out[2] = chars[(group >> 6) & 0x3f];
+    out[3] = chars[group & 0x3f];
+  }
+  if (size) {
+    const uint32_t group = (in[0] << 16) | (size == 2 ? in[1] << 8 : 0);
+    *out++ = chars[group >> 18];
+    *out++ = chars[(group >> 12) & 0x3f];
+    if (size == 2)
+      *out++ = chars[(group >> 6) & 0x3f];
+    if (pad) {
+      *out++ = kPaddingChar;
+      if (size == 1)
+        *out++ = kPaddingChar;
+    }
+  }
+  return out - output;
+}
+
+bool Base64DecodeWithAlphabet(const StringPiece& input,
+                              Base64Alphabet alphabet_id,
+                              char* output,
+                              size_t* output_size) {
+  const Alphabet& alphabet = GetAlphabet(alphabet_id);
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(input.data());
+  size_t size = input.size();
+  uint8_t* out = reinterpret_cast<uint8_t*>(output);
+
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+  size_t consumed = 0;
+  if (CPU::HasFeature(CPU::FEATURE_AVX2))
+    consumed = DecodeAVX2(in, size, alphabet, out);
+  if (CPU::HasFeature(CPU::FEATURE_SSSE3)) {
+    consumed += DecodeSSSE3(in + consumed, size - consumed, alphabet,
+                            out + consumed / 4 * 3);
+  }
+  in += consumed;
+  size -= consumed;
+  out += consumed / 4 * 3;
+#endif
+
+  for (; size >= 4; size -= 4, in += 4, out += 3) {
+    const int a = DecodeChar(in[0], alphabet);
+    const int b = DecodeChar(in[1], alphabet);
+    const int c = DecodeChar(in[2], alphabet);
+    const int d = DecodeChar(in[3], alphabet);
+    if ((a | b | c | d) < 0)
+      return false;
+    const uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+    out[0] = static_cast<uint8_t>(group >> 16);
+    out[1] = static_cast<uint8_t>(group >> 8);
+    out[2] = static_cast<uint8_t>(group);
+  }
+
+  // A single character does not make a byte. Like modp_b64, which this
+  // replaces, unused bits of the last character are ignored.
+  if (size == 1)
+    return false;
+  if (size) {
+    const int a = DecodeChar(in[0], alphabet);
+    const int b = DecodeChar(in[1], alphabet);
+    const int c = size == 3 ? DecodeChar(in[2], alphabet) : 0;
+    if ((a | b | c) < 0)
+      return false;
+    const uint32_t group = (a << 18) | (b << 12) | (c << 6);
+    *out++ = static_cast<uint8_t>(group >> 16);
+    if (size == 3)
+      *out++ = static_cast<uint8_t>(group >> 8);
+  }
+
+  *output_size = out - reinterpret_cast<uint8_t*>(output);
+  return true;
+}
+
+}  // namespace internal
+
+void Base64Encode(const StringPiece& input, std::string* output) {
+  // Encode straight into |*output|, unless |input| is stored in it.
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(output->data());
+  const uintptr_t data = reinterpret_cast<uintptr_t>(input.data());
+  if (data >= begin && data < begin + output->size()) {
+    std::string temp;
+    Base64Encode(input, &temp);
+    output->swap(temp);
+    return;
+  }
+
+  output->resize(Base64EncodedLength(input.size()));
+  if (!output->empty())
+    Base64EncodeToBuffer(input, &(*output)[0]);
 }
 
 bool Base64Decode(const StringPiece& input, std::string* output) {
   std::string temp;
-  temp.resize(modp_b64_decode_len(input.size()));
+  temp.resize(Base64DecodedMaxLength(input.size()));
 
-  // does not null terminate result since result is binary data!
-  size_t input_size = input.size();
-  size_t output_size = modp_b64_decode(&(temp[0]), input.data(), input_size);
-  if (output_size == MODP_B64_ERROR)
+  size_t output_size;
+  if (!Base64DecodeToBuffer(input, &temp[0], &output_size))
     return false;
 
   temp.resize(output_size);
@@ -36,4 +426,34 @@ bool Base64Decode(const StringPiece& input, std::string* output) {
   return true;
 }
 
+size_t Base64EncodedLength(size_t input_size) {
+  return (input_size + 2) / 3 * 4;
+}
+
+size_t Base64DecodedMaxLength(size_t input_size) {
+  return input_size / 4 * 3 + input_size % 4 * 3 / 4;
+}
+
+size_t Base64EncodeToBuffer(const StringPiece& input, char* output) {
+  return internal::Base64EncodeWithAlphabet(
+      input, internal::Base64Alphabet::STANDARD, true, output);
+}
+
+bool Base64DecodeToBuffer(const StringPiece& input,
+                          char* output,
+                          size_t* output_size) {
+  if (input.size() % 4)
+    return false;
+
+  // There can be two padding characters at most.
+  StringPiece data = input;
+  for (int i = 0; i < 2 && !data.empty(); i++) {
+    if (data[data.size() - 1] != kPaddingChar)
+      break;
+    data.remove_suffix(1);
+  }
+  return internal::Base64DecodeWithAlphabet(
+      data, internal::Base64Alphabet::STANDARD, output, output_size);
+}
+
 }  // namespace base
@@ -5,6 +5,8 @@
 #ifndef BASE_BASE64_H_
 #define BASE_BASE64_H_
 
+#include <stddef.h>
+
 #include <string>
 
 #include "base/base_export.h"
@@ -20,6 +22,28 @@ BASE_EXPORT void Base64Encode(const StringPiece& input, std::string* output);
 // be done in-place.
 BASE_EXPORT bool Base64Decode(const StringPiece& input, std::string* output);
 
+// Returns the length of the base64 encoding of |input_size| bytes, including
+// padding.
+BASE_EXPORT size_t Base64EncodedLength(size_t input_size);
+
+// Returns an upper bound on the number of bytes decoded from |input_size|
+// base64 characters.
+BASE_EXPORT size_t Base64DecodedMaxLength(size_t input_size);
+
+// Encodes |input| in base64 into |output|, which must have room for
+// Base64EncodedLength(input.size()) characters and must not overlap |input|.
+// Returns the number of characters written. No null terminator is written.
+BASE_EXPORT size_t Base64EncodeToBuffer(const StringPiece& input, char* output);
+
+// Decodes the base64 |input| into |output|, which must have room for
+// Base64DecodedMaxLength(input.size()) bytes, and sets |*output_size| to the
+// number of bytes written. Returns false if |input| is not valid base64, in
+// which case the contents of |output| are unspecified. The decoding can be done
+// in-place, with |output| equal to |input.data()|.
+BASE_EXPORT bool Base64DecodeToBuffer(const StringPiece& input,
+                                      char* output,
+                                      size_t* output_size);
+
 }  // namespace base
 
 #endif  // BASE_BASE64_H_
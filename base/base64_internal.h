@@ -0,0 +1,44 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_BASE64_INTERNAL_H_
+#define BASE_BASE64_INTERNAL_H_
+
+#include <stddef.h>
+
+#include "base/strings/string_piece.h"
+
+// The codec shared by base64.cc and base64url.cc, which only differ in the
+// last two characters of the alphabet and in their handling of padding.
+
+namespace base {
+namespace internal {
+
+enum class Base64Alphabet {
+  // "+/", from RFC 4648 section 4.
+  STANDARD,
+
+  // "-_", from RFC 4648 section 5.
+  URL_SAFE
+};
+
+// Writes the encoding of |input| to |output|, followed by padding if |pad| is
+// true, and returns the number of characters written.
+size_t Base64EncodeWithAlphabet(const StringPiece& input,
+                                Base64Alphabet alphabet,
+                                bool pad,
+                                char* output);
+
+// Decodes |input|, which must not contain padding, into |output|. Returns
+// false if |input| contains a character outside of |alphabet|, or if its
+// length is not possible for an encoding. |output| may be |input.data()|.
+bool Base64DecodeWithAlphabet(const StringPiece& input,
+                              Base64Alphabet alphabet,
+                              char* output,
+                              size_t* output_size);
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_BASE64_INTERNAL_H_
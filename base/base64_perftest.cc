@@ -0,0 +1,98 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/base64.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "base/base64url.h"
+#include "base/format_macros.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const size_t kSizes[] = {64, 4 * 1024, 1024 * 1024};
+
+// Runs |function| on about 256 MiB of input of |size| bytes, and prints the
+// throughput in MiB/s of input.
+template <typename Function>
+void Measure(const char* trace, size_t size, Function function) {
+  const size_t iterations = (256 << 20) / size;
+  TimeTicks start = TimeTicks::Now();
+  for (size_t i = 0; i < iterations; i++)
+    function();
+  TimeDelta elapsed = TimeTicks::Now() - start;
+  perf_test::PrintResult(
+      "throughput", StringPrintf("_%" PRIuS "_bytes", size), trace,
+      static_cast<double>(iterations) * size / (1 << 20) / elapsed.InSecondsF(),
+      "MiB/s", true);
+}
+
+std::string MakeInput(size_t size) {
+  std::string input;
+  for (size_t i = 0; i < size; i++)
+    input.push_back(static_cast<char>(i * 31));
+  return input;
+}
+
+}  // namespace
+
+TEST(Base64PerfTest, Encode) {
+  for (size_t size : kSizes) {
+    const std::string input = MakeInput(size);
+    std::string buffer(Base64EncodedLength(size), '\0');
+    Measure("Base64EncodeToBuffer", size,
+            [&] { Base64EncodeToBuffer(input, &buffer[0]); });
+
+    std::string output;
+    Measure("Base64Encode", size, [&] { Base64Encode(input, &output); });
+    Measure("Base64UrlEncode", size, [&] {
+      Base64UrlEncode(input, Base64UrlEncodePolicy::OMIT_PADDING, &output);
+    });
+    Measure("HexEncode", size,
+            [&] { output = HexEncode(input.data(), input.size()); });
+    std::string hex_buffer(2 * size, '\0');
+    Measure("HexEncodeToBuffer", size, [&] {
+      HexEncodeToBuffer(input.data(), input.size(), &hex_buffer[0]);
+    });
+  }
+}
+
+TEST(Base64PerfTest, Decode) {
+  for (size_t size : kSizes) {
+    std::string encoded;
+    Base64Encode(MakeInput(size), &encoded);
+    std::string url_encoded;
+    Base64UrlEncode(MakeInput(size), Base64UrlEncodePolicy::OMIT_PADDING,
+                    &url_encoded);
+
+    // The throughputs are in bytes of decoded output, for comparison with the
+    // encoders.
+    std::string buffer(size, '\0');
+    size_t decoded_size;
+    Measure("Base64DecodeToBuffer", size, [&] {
+      CHECK(Base64DecodeToBuffer(encoded, &buffer[0], &decoded_size));
+    });
+
+    std::string output;
+    Measure("Base64Decode", size,
+            [&] { CHECK(Base64Decode(encoded, &output)); });
+    Measure("Base64UrlDecode", size, [&] {
+      CHECK(Base64UrlDecode(url_encoded,
+                            Base64UrlDecodePolicy::DISALLOW_PADDING, &output));
+    });
+  }
+}
+
+}  // namespace base
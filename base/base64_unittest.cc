@@ -4,10 +4,52 @@
 
 #include "base/base64.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "base/cpu.h"
+#include "base/macros.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
 
+namespace {
+
+const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// A straightforward encoder, to check the vectorized ones against.
+std::string ReferenceEncode(const std::string& input) {
+  std::string output;
+  for (size_t i = 0; i < input.size(); i += 3) {
+    uint32_t group = static_cast<uint8_t>(input[i]) << 16;
+    if (i + 1 < input.size())
+      group |= static_cast<uint8_t>(input[i + 1]) << 8;
+    if (i + 2 < input.size())
+      group |= static_cast<uint8_t>(input[i + 2]);
+    output.push_back(kAlphabet[group >> 18]);
+    output.push_back(kAlphabet[(group >> 12) & 0x3f]);
+    output.push_back(i + 1 < input.size() ? kAlphabet[(group >> 6) & 0x3f]
+                                          : '=');
+    output.push_back(i + 2 < input.size() ? kAlphabet[group & 0x3f] : '=');
+  }
+  return output;
+}
+
+std::string PseudoRandomBytes(size_t size) {
+  std::string bytes;
+  uint32_t state = 12345;
+  for (size_t i = 0; i < size; i++) {
+    state = state * 1103515245 + 12345;
+    bytes.push_back(static_cast<char>(state >> 16));
+  }
+  return bytes;
+}
+
+}  // namespace
+
 TEST(Base64Test, Basic) {
   const std::string kText = "hello world";
   const std::string kBase64Text = "aGVsbG8gd29ybGQ=";
@@ -37,4 +79,96 @@ TEST(Base64Test, InPlace) {
   EXPECT_EQ(text, kText);
 }
 
+TEST(Base64Test, Lengths) {
+  EXPECT_EQ(0u, Base64EncodedLength(0));
+  EXPECT_EQ(4u, Base64EncodedLength(1));
+  EXPECT_EQ(4u, Base64EncodedLength(3));
+  EXPECT_EQ(8u, Base64EncodedLength(4));
+  EXPECT_EQ(0u, Base64DecodedMaxLength(0));
+  EXPECT_EQ(3u, Base64DecodedMaxLength(4));
+  EXPECT_EQ(5u, Base64DecodedMaxLength(7));
+}
+
+TEST(Base64Test, Buffers) {
+  const std::string kText = "hello world";
+  char buffer[32];
+  ASSERT_EQ(16u, Base64EncodeToBuffer(kText, buffer));
+  EXPECT_EQ("aGVsbG8gd29ybGQ=", std::string(buffer, 16));
+
+  size_t size = 0;
+  ASSERT_TRUE(Base64DecodeToBuffer(StringPiece(buffer, 16), buffer, &size));
+  EXPECT_EQ(kText, std::string(buffer, size));
+}
+
+// Covers the vectorized code for all the alignments of the input and of the
+// end of the data, with each of the kernels the machine supports.
+TEST(Base64Test, MatchesReference) {
+  const int kDisabledFeatures[] = {
+      0, CPU::FEATURE_AVX2, CPU::FEATURE_AVX2 | CPU::FEATURE_SSSE3};
+  const std::string data = PseudoRandomBytes(300);
+  for (size_t k = 0; k < arraysize(kDisabledFeatures); k++) {
+    CPU::SetDisabledFeaturesForTesting(kDisabledFeatures[k]);
+    for (size_t offset = 0; offset < 4; offset++) {
+      for (size_t size = 0; size + offset <= data.size(); size++) {
+        const std::string input = data.substr(offset, size);
+        std::string encoded;
+        Base64Encode(input, &encoded);
+        EXPECT_EQ(ReferenceEncode(input), encoded) << "size " << size;
+
+        std::string decoded;
+        EXPECT_TRUE(Base64Decode(encoded, &decoded)) << "size " << size;
+        EXPECT_EQ(input, decoded) << "size " << size;
+
+        // In place.
+        size_t decoded_size = 0;
+        EXPECT_TRUE(
+            Base64DecodeToBuffer(encoded, &encoded[0], &decoded_size));
+        EXPECT_EQ(input, encoded.substr(0, decoded_size));
+      }
+    }
+  }
+  CPU::SetDisabledFeaturesForTesting(0);
+}
+
+TEST(Base64Test, InvalidCharacters) {
+  std::string encoded;
+  Base64Encode(PseudoRandomBytes(120), &encoded);
+  ASSERT_EQ(160u, encoded.size());
+
+  const std::string alphabet(kAlphabet);
+  std::string decoded;
+  for (size_t i = 0; i < encoded.size(); i++) {
+    for (int c = 0; c < 256; c++) {
+      std::string input = encoded;
+      input[i] = static_cast<char>(c);
+      // Only the last character can be padding.
+      const bool valid =
+          alphabet.find(static_cast<char>(c)) != std::string::npos ||
+          (c == '=' && i == encoded.size() - 1);
+      EXPECT_EQ(valid, Base64Decode(input, &decoded))
+          << "position " << i << ", character " << c;
+    }
+  }
+}
+
+TEST(Base64Test, Padding) {
+  std::string decoded;
+  EXPECT_TRUE(Base64Decode("", &decoded));
+  EXPECT_EQ("", decoded);
+  EXPECT_TRUE(Base64Decode("QQ==", &decoded));
+  EXPECT_EQ("A", decoded);
+  EXPECT_TRUE(Base64Decode("QUI=", &decoded));
+  EXPECT_EQ("AB", decoded);
+
+  EXPECT_FALSE(Base64Decode("QQ", &decoded));
+  EXPECT_FALSE(Base64Decode("QQ=", &decoded));
+  EXPECT_FALSE(Base64Decode("Q===", &decoded));
+  EXPECT_FALSE(Base64Decode("====", &decoded));
+  EXPECT_FALSE(Base64Decode("QQ=A", &decoded));
+  EXPECT_FALSE(Base64Decode("QQ==QUJD", &decoded));
+
+  // The output is not modified on failure.
+  EXPECT_EQ("AB", decoded);
+}
+
 }  // namespace base
@@ -5,98 +5,104 @@
 #include "base/base64url.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
-#include "base/base64.h"
-#include "base/macros.h"
-#include "base/numerics/safe_math.h"
-#include "base/strings/string_util.h"
+#include <algorithm>
 
-#include <modp_b64/modp_b64.h>
+#include "base/base64.h"
+#include "base/base64_internal.h"
 
 namespace base {
 
 const char kPaddingChar = '=';
 
-// Base64url maps {+, /} to {-, _} in order for the encoded content to be safe
-// to use in a URL. These characters will be translated by this implementation.
-const char kBase64Chars[] = "+/";
-const char kBase64UrlSafeChars[] = "-_";
-
 void Base64UrlEncode(const StringPiece& input,
                      Base64UrlEncodePolicy policy,
                      std::string* output) {
-  Base64Encode(input, output);
-
-  ReplaceChars(*output, "+", "-", output);
-  ReplaceChars(*output, "/", "_", output);
-
-  switch (policy) {
-    case Base64UrlEncodePolicy::INCLUDE_PADDING:
-      // The padding included in |*output| will not be amended.
-      break;
-    case Base64UrlEncodePolicy::OMIT_PADDING:
-      // The padding included in |*output| will be removed.
-      const size_t last_non_padding_pos =
-          output->find_last_not_of(kPaddingChar);
-      if (last_non_padding_pos != std::string::npos)
-        output->resize(last_non_padding_pos + 1);
-
-      break;
+  // Encode straight into |*output|, unless |input| is stored in it.
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(output->data());
+  const uintptr_t data = reinterpret_cast<uintptr_t>(input.data());
+  if (data >= begin && data < begin + output->size()) {
+    std::string temp;
+    Base64UrlEncode(input, policy, &temp);
+    output->swap(temp);
+    return;
   }
+
+  output->resize(Base64UrlEncodedLength(input.size(), policy));
+  if (!output->empty())
+    Base64UrlEncodeToBuffer(input, policy, &(*output)[0]);
 }
 
 bool Base64UrlDecode(const StringPiece& input,
                      Base64UrlDecodePolicy policy,
                      std::string* output) {
-  // Characters outside of the base64url alphabet are disallowed, which includes
-  // the {+, /} characters found in the conventional base64 alphabet.
-  if (input.find_first_of(kBase64Chars) != std::string::npos)
+  std::string temp;
+  temp.resize(Base64DecodedMaxLength(input.size()));
+
+  size_t output_size;
+  if (!Base64UrlDecodeToBuffer(input, policy, &temp[0], &output_size))
     return false;
 
-  const size_t required_padding_characters = input.size() % 4;
-  const bool needs_replacement =
-      input.find_first_of(kBase64UrlSafeChars) != std::string::npos;
+  temp.resize(output_size);
+  output->swap(temp);
+  return true;
+}
+
+size_t Base64UrlEncodedLength(size_t input_size,
+                              Base64UrlEncodePolicy policy) {
+  if (policy == Base64UrlEncodePolicy::INCLUDE_PADDING)
+    return Base64EncodedLength(input_size);
+  const size_t remainder = input_size % 3;
+  return input_size / 3 * 4 + (remainder ? remainder + 1 : 0);
+}
+
+size_t Base64UrlEncodeToBuffer(const StringPiece& input,
+                               Base64UrlEncodePolicy policy,
+                               char* output) {
+  return internal::Base64EncodeWithAlphabet(
+      input, internal::Base64Alphabet::URL_SAFE,
+      policy == Base64UrlEncodePolicy::INCLUDE_PADDING, output);
+}
+
+bool Base64UrlDecodeToBuffer(const StringPiece& input,
+                             Base64UrlDecodePolicy policy,
+                             char* output,
+                             size_t* output_size) {
+  size_t trailing_padding = 0;
+  while (trailing_padding < input.size() &&
+         input[input.size() - 1 - trailing_padding] == kPaddingChar) {
+    trailing_padding++;
+  }
+  const size_t missing_padding = (4 - input.size() % 4) % 4;
 
   switch (policy) {
     case Base64UrlDecodePolicy::REQUIRE_PADDING:
       // Fail if the required padding is not included in |input|.
-      if (required_padding_characters > 0)
+      if (missing_padding > 0)
         return false;
       break;
     case Base64UrlDecodePolicy::IGNORE_PADDING:
-      // Missing padding will be silently appended.
+      // Missing padding will be treated as if it had been appended.
       break;
     case Base64UrlDecodePolicy::DISALLOW_PADDING:
       // Fail if padding characters are included in |input|.
-      if (input.find_first_of(kPaddingChar) != std::string::npos)
+      if (trailing_padding > 0)
         return false;
       break;
   }
 
-  // If the string either needs replacement of URL-safe characters to normal
-  // base64 ones, or additional padding, a copy of |input| needs to be made in
-  // order to make these adjustments without side effects.
-  if (required_padding_characters > 0 || needs_replacement) {
-    std::string base64_input;
-
-    CheckedNumeric<size_t> base64_input_size = input.size();
-    if (required_padding_characters > 0)
-      base64_input_size += 4 - required_padding_characters;
-
-    base64_input.reserve(base64_input_size.ValueOrDie());
-    input.AppendToString(&base64_input);
-
-    // Substitute the base64url URL-safe characters to their base64 equivalents.
-    ReplaceChars(base64_input, "-", "+", &base64_input);
-    ReplaceChars(base64_input, "_", "/", &base64_input);
-
-    // Append the necessary padding characters.
-    base64_input.resize(base64_input_size.ValueOrDie(), '=');
-
-    return Base64Decode(base64_input, output);
-  }
-
-  return Base64Decode(input, output);
+  // The padded input can end with two padding characters at most, which may
+  // include missing ones. Any other padding character is invalid input, and
+  // so are characters outside of the base64url alphabet, which includes the
+  // {+, /} characters found in the conventional base64 alphabet.
+  const size_t padding =
+      std::min<size_t>(trailing_padding + missing_padding, 2);
+  if (padding < missing_padding)
+    return false;
+  return internal::Base64DecodeWithAlphabet(
+      input.substr(0, input.size() - (padding - missing_padding)),
+      internal::Base64Alphabet::URL_SAFE, output, output_size);
 }
 
 }  // namespace base
@@ -5,6 +5,8 @@
 #ifndef BASE_BASE64URL_H_
 #define BASE_BASE64URL_H_
 
+#include <stddef.h>
+
 #include <string>
 
 #include "base/base_export.h"
@@ -31,6 +33,19 @@ BASE_EXPORT void Base64UrlEncode(const StringPiece& input,
                                  Base64UrlEncodePolicy policy,
                                  std::string* output);
 
+// Returns the length of the base64url encoding of |input_size| bytes with
+// |policy|.
+BASE_EXPORT size_t Base64UrlEncodedLength(size_t input_size,
+                                          Base64UrlEncodePolicy policy);
+
+// Encodes |input| in base64url into |output|, which must have room for
+// Base64UrlEncodedLength(input.size(), policy) characters and must not overlap
+// |input|. Returns the number of characters written. No null terminator is
+// written.
+BASE_EXPORT size_t Base64UrlEncodeToBuffer(const StringPiece& input,
+                                           Base64UrlEncodePolicy policy,
+                                           char* output);
+
 enum class Base64UrlDecodePolicy {
   // Require inputs contain trailing padding if non-aligned.
   REQUIRE_PADDING,
@@ -51,6 +66,17 @@ BASE_EXPORT bool Base64UrlDecode(const StringPiece& input,
                                  Base64UrlDecodePolicy policy,
                                  std::string* output) WARN_UNUSED_RESULT;
 
+// Decodes the base64url |input| into |output|, which must have room for
+// Base64DecodedMaxLength(input.size()) bytes (see base64.h), and sets
+// |*output_size| to the number of bytes written. On failure, the contents of
+// |output| are unspecified. The decoding can be done in-place, with |output|
+// equal to |input.data()|.
+BASE_EXPORT bool Base64UrlDecodeToBuffer(const StringPiece& input,
+                                         Base64UrlDecodePolicy policy,
+                                         char* output,
+                                         size_t* output_size)
+    WARN_UNUSED_RESULT;
+
 }  // namespace base
 
 #endif  // BASE_BASE64URL_H_
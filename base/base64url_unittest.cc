@@ -110,6 +110,53 @@ TEST(Base64UrlTest, DecodeDisallowsPaddingOnly) {
       "====", Base64UrlDecodePolicy::IGNORE_PADDING, &output));
 }
 
+TEST(Base64UrlTest, Buffers) {
+  char buffer[32];
+  ASSERT_EQ(15u, Base64UrlEncodedLength(
+                     11, Base64UrlEncodePolicy::OMIT_PADDING));
+  ASSERT_EQ(15u, Base64UrlEncodeToBuffer(
+                     "hello?world", Base64UrlEncodePolicy::OMIT_PADDING,
+                     buffer));
+  EXPECT_EQ("aGVsbG8_d29ybGQ", std::string(buffer, 15));
+
+  size_t size = 0;
+  ASSERT_TRUE(Base64UrlDecodeToBuffer(StringPiece(buffer, 15),
+                                      Base64UrlDecodePolicy::DISALLOW_PADDING,
+                                      buffer, &size));
+  EXPECT_EQ("hello?world", std::string(buffer, size));
+}
+
+// Long enough inputs to go through the vectorized code.
+TEST(Base64UrlTest, LongInputs) {
+  std::string input;
+  for (int i = 0; i < 1000; i++)
+    input.push_back(static_cast<char>(i * 7));
+
+  for (size_t size = 0; size <= input.size(); size += 37) {
+    const std::string data = input.substr(0, size);
+    std::string encoded;
+    Base64UrlEncode(data, Base64UrlEncodePolicy::OMIT_PADDING, &encoded);
+    EXPECT_EQ(std::string::npos, encoded.find_first_of("+/="));
+
+    std::string decoded;
+    ASSERT_TRUE(Base64UrlDecode(encoded, Base64UrlDecodePolicy::IGNORE_PADDING,
+                                &decoded));
+    EXPECT_EQ(data, decoded);
+  }
+
+  std::string encoded;
+  Base64UrlEncode(input, Base64UrlEncodePolicy::INCLUDE_PADDING, &encoded);
+  ASSERT_NE(std::string::npos, encoded.find('-'));
+  ASSERT_NE(std::string::npos, encoded.find('_'));
+  for (size_t i = 0; i < 100; i++) {
+    std::string invalid = encoded;
+    invalid[i] = i % 2 ? '+' : '/';
+    std::string decoded;
+    EXPECT_FALSE(Base64UrlDecode(
+        invalid, Base64UrlDecodePolicy::REQUIRE_PADDING, &decoded));
+  }
+}
+
 }  // namespace
 
 }  // namespace base
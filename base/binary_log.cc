@@ -0,0 +1,707 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/binary_log.h"
+
+#include <stdio.h>
+
+#include <map>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/lazy_instance.h"
+#include "base/process/process_handle.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread_local_storage.h"
+#include "base/time/time.h"
+#include "build/build_config.h"
+
+#if defined(OS_POSIX)
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "base/async_log_writer_posix.h"
+#include "base/files/file_util.h"
+#include "base/posix/eintr_wrapper.h"
+#endif
+
+// A binary log starts with kMagic, followed by records. Each record is its
+// length, as a varint, followed by its type and fields:
+//
+//   HEADER_RECORD:   process ID, start time (base::Time internal value)
+//   SITE_RECORD:     site ID, severity (zigzag), line, file, format
+//   MESSAGE_RECORD:  site ID, thread ID, microseconds since the start time
+//                    (zigzag), then the arguments: each is its
+//                    BinaryLogArgumentType followed by its value
+//   DROPPED_RECORD:  number of messages dropped
+//
+// Integers are varints, strings are their length as a varint followed by
+// their bytes, and doubles are stored as in memory. A site is described
+// before the first message which refers to it.
+
+namespace logging {
+
+namespace {
+
+const char kMagic[] = "BINLOG1\n";
+const size_t kMagicSize = sizeof(kMagic) - 1;
+
+enum RecordType : uint8_t {
+  HEADER_RECORD = 1,
+  SITE_RECORD,
+  MESSAGE_RECORD,
+  DROPPED_RECORD,
+};
+
+// The records are at most BinaryLogRecord::kMaxSize bytes, so their length
+// takes at most two bytes.
+const size_t kMaxLengthSize = 2;
+
+const char* const kSeverityNames[] = {"INFO", "WARNING", "ERROR", "FATAL"};
+
+uint64_t ZigzagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigzagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void AppendVarint(std::string* output, uint64_t value) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+void AppendString(std::string* output, const base::StringPiece& value) {
+  AppendVarint(output, value.size());
+  value.AppendToString(output);
+}
+
+// Appends the record |body| to |output|, after its length.
+void AppendRecord(std::string* output, const std::string& body) {
+  AppendVarint(output, body.size());
+  output->append(body);
+}
+
+void AppendSiteRecord(std::string* output, const BinaryLogSite& site,
+                      int32_t id) {
+  std::string body(1, SITE_RECORD);
+  AppendVarint(&body, id);
+  AppendVarint(&body, ZigzagEncode(site.severity));
+  AppendVarint(&body, site.line);
+  AppendString(&body, site.file);
+  AppendString(&body, site.format);
+  AppendRecord(output, body);
+}
+
+// Set while a binary log is open.
+base::subtle::Atomic32 g_binary_logging_enabled = 0;
+
+class BinaryLog {
+ public:
+  BinaryLog()
+      : fd_(-1),
+#if defined(OS_POSIX)
+        writer_(64 * 1024, 64),
+        writer_started_(false),
+#endif
+        reported_dropped_count_(0),
+        start_ticks_(0) {
+  }
+
+  bool Start(const base::FilePath& path);
+  void Stop();
+  void Flush();
+
+  // Writes |size| bytes of |data|, a whole record.
+  void Write(const char* data, size_t size);
+
+  // Returns the ID of |site|, describing it in the log if it is new.
+  int32_t GetSiteId(BinaryLogSite* site);
+
+  uint64_t GetCurrentThreadId();
+
+  // The time of the records is relative to this, to keep it short. Read
+  // without |lock_|: a record racing with Start() may get a wrong time.
+  int64_t start_ticks() const { return start_ticks_; }
+
+ private:
+  void StopLocked();
+  void WriteLocked(const std::string& data);
+  // Writes a DROPPED_RECORD if messages were dropped since the last one.
+  void ReportDroppedMessagesLocked();
+
+  base::Lock lock_;
+  int fd_;
+  // Every site which wrote a record, in the order of their IDs, starting at 1.
+  std::vector<BinaryLogSite*> sites_;
+#if defined(OS_POSIX)
+  AsyncLogWriter writer_;
+  bool writer_started_;
+#endif
+  uint32_t reported_dropped_count_;
+  int64_t start_ticks_;
+  base::ThreadLocalStorage::Slot thread_id_slot_;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryLog);
+};
+
+base::LazyInstance<BinaryLog>::Leaky g_binary_log = LAZY_INSTANCE_INITIALIZER;
+
+bool BinaryLog::Start(const base::FilePath& path) {
+#if defined(OS_POSIX)
+  base::AutoLock lock(lock_);
+  StopLocked();
+
+  // O_APPEND keeps the records written directly from being overwritten by
+  // those written by |writer_|.
+  fd_ = HANDLE_EINTR(open(path.value().c_str(),
+                          O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+                          0644));
+  if (fd_ < 0)
+    return false;
+
+  const base::TimeTicks now = base::TimeTicks::Now();
+  start_ticks_ = now.ToInternalValue();
+  std::string data(kMagic, kMagicSize);
+  std::string header(1, HEADER_RECORD);
+  AppendVarint(&header, base::GetCurrentProcId());
+  AppendVarint(&header, base::Time::Now().ToInternalValue());
+  AppendRecord(&data, header);
+  for (size_t i = 0; i < sites_.size(); i++)
+    AppendSiteRecord(&data, *sites_[i], static_cast<int32_t>(i + 1));
+  WriteLocked(data);
+
+  if (!writer_started_) {
+    writer_.set_report_dropped_messages(false);
+    writer_started_ = writer_.Start();
+  }
+  // Without the writer thread, records are written synchronously.
+  if (writer_started_)
+    writer_.SetFileDescriptors(-1, fd_);
+
+  base::subtle::Release_Store(&g_binary_logging_enabled, 1);
+  return true;
+#else
+  NOTIMPLEMENTED();
+  return false;
+#endif
+}
+
+void BinaryLog::Stop() {
+  base::AutoLock lock(lock_);
+  StopLocked();
+}
+
+void BinaryLog::Flush() {
+  base::AutoLock lock(lock_);
+#if defined(OS_POSIX)
+  writer_.Flush();
+#endif
+  ReportDroppedMessagesLocked();
+}
+
+void BinaryLog::Write(const char* data, size_t size) {
+#if defined(OS_POSIX)
+  if (writer_.Write(base::StringPiece(data, size), AsyncLogWriter::TO_FILE))
+    return;
+#endif
+  // There is no room for |data| in |writer_|, or the log is closed.
+  base::AutoLock lock(lock_);
+  if (fd_ < 0)
+    return;
+#if defined(OS_POSIX)
+  // Keep the records of this thread in order.
+  writer_.Flush();
+#endif
+  WriteLocked(std::string(data, size));
+}
+
+int32_t BinaryLog::GetSiteId(BinaryLogSite* site) {
+  int32_t id = base::subtle::Acquire_Load(&site->id);
+  if (id)
+    return id;
+
+  base::AutoLock lock(lock_);
+  id = base::subtle::NoBarrier_Load(&site->id);
+  if (id)
+    return id;
+  sites_.push_back(site);
+  id = static_cast<int32_t>(sites_.size());
+  // Written directly, so that it comes before the messages of other threads,
+  // which can only refer to |site| once |id| is published below.
+  std::string data;
+  AppendSiteRecord(&data, *site, id);
+  WriteLocked(data);
+  base::subtle::Release_Store(&site->id, id);
+  return id;
+}
+
+uint64_t BinaryLog::GetCurrentThreadId() {
+  // Cached, since PlatformThread::CurrentId() is a system call on Linux. The
+  // slot holds the ID plus one, to tell it from an empty slot.
+  uintptr_t id = reinterpret_cast<uintptr_t>(thread_id_slot_.Get());
+  if (!id) {
+    id = static_cast<uintptr_t>(base::PlatformThread::CurrentId()) + 1;
+    thread_id_slot_.Set(reinterpret_cast<void*>(id));
+  }
+  return id - 1;
+}
+
+void BinaryLog::StopLocked() {
+  if (fd_ < 0)
+    return;
+  base::subtle::NoBarrier_Store(&g_binary_logging_enabled, 0);
+#if defined(OS_POSIX)
+  // Write the pending records to the file before closing it.
+  if (writer_started_)
+    writer_.SetFileDescriptors(-1, -1);
+  ReportDroppedMessagesLocked();
+  close(fd_);
+#endif
+  fd_ = -1;
+}
+
+void BinaryLog::WriteLocked(const std::string& data) {
+  lock_.AssertAcquired();
+  if (fd_ < 0)
+    return;
+#if defined(OS_POSIX)
+  base::WriteFileDescriptor(fd_, data.data(), static_cast<int>(data.size()));
+#endif
+}
+
+void BinaryLog::ReportDroppedMessagesLocked() {
+#if defined(OS_POSIX)
+  const uint32_t dropped_count = writer_.dropped_count();
+  if (dropped_count == reported_dropped_count_)
+    return;
+  std::string body(1, DROPPED_RECORD);
+  AppendVarint(&body, dropped_count - reported_dropped_count_);
+  std::string data;
+  AppendRecord(&data, body);
+  WriteLocked(data);
+  reported_dropped_count_ = dropped_count;
+#endif
+}
+
+// Reads the fields of a record.
+class RecordReader {
+ public:
+  explicit RecordReader(const base::StringPiece& data) : data_(data) {}
+
+  bool empty() const { return data_.empty(); }
+
+  bool ReadByte(uint8_t* value) {
+    if (data_.empty())
+      return false;
+    *value = static_cast<uint8_t>(data_[0]);
+    data_.remove_prefix(1);
+    return true;
+  }
+
+  bool ReadVarint(uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!ReadByte(&byte))
+        return false;
+      *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool ReadSigned(int64_t* value) {
+    uint64_t encoded;
+    if (!ReadVarint(&encoded))
+      return false;
+    *value = ZigzagDecode(encoded);
+    return true;
+  }
+
+  bool ReadBytes(size_t size, base::StringPiece* value) {
+    if (size > data_.size())
+      return false;
+    *value = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return true;
+  }
+
+  bool ReadString(base::StringPiece* value) {
+    uint64_t size;
+    return ReadVarint(&size) && size <= data_.size() &&
+           ReadBytes(static_cast<size_t>(size), value);
+  }
+
+  bool ReadDouble(double* value) {
+    base::StringPiece bytes;
+    if (!ReadBytes(sizeof(*value), &bytes))
+      return false;
+    memcpy(value, bytes.data(), sizeof(*value));
+    return true;
+  }
+
+ private:
+  base::StringPiece data_;
+};
+
+struct Site {
+  int severity;
+  uint64_t line;
+  std::string file;
+  std::string format;
+};
+
+struct Argument {
+  uint8_t type;
+  uint64_t bits;
+  double number;
+  base::StringPiece string;
+};
+
+bool ReadArgument(RecordReader* reader, Argument* argument) {
+  if (!reader->ReadByte(&argument->type))
+    return false;
+  switch (argument->type) {
+    case internal::BINARY_LOG_SIGNED:
+    case internal::BINARY_LOG_UNSIGNED:
+    case internal::BINARY_LOG_POINTER:
+      return reader->ReadVarint(&argument->bits);
+    case internal::BINARY_LOG_DOUBLE:
+      return reader->ReadDouble(&argument->number);
+    case internal::BINARY_LOG_STRING:
+      return reader->ReadString(&argument->string);
+  }
+  return false;
+}
+
+// Appends |value| formatted by the printf() conversion |format| to |*text|.
+template <typename T>
+void AppendPrintf(std::string* text, const std::string& format, T value) {
+  char buffer[128];
+  const int size = snprintf(buffer, sizeof(buffer), format.c_str(), value);
+  if (size < 0)
+    return;
+  if (static_cast<size_t>(size) < sizeof(buffer)) {
+    text->append(buffer, size);
+    return;
+  }
+  std::vector<char> large_buffer(size + 1);
+  snprintf(&large_buffer[0], large_buffer.size(), format.c_str(), value);
+  text->append(&large_buffer[0], size);
+}
+
+// Appends |argument| to |*text| as the printf() conversion |spec| followed by
+// |conversion| would. |spec| holds the flags, width and precision. Arguments
+// that do not match |conversion| are written as printf() would write their
+// type by default.
+void AppendArgument(std::string* text, std::string spec, char conversion,
+                    const Argument* argument) {
+  if (!argument) {
+    text->append("(missing)");
+    return;
+  }
+
+  const base::StringPiece kIntegerConversions = "diouxXc";
+  const base::StringPiece kDoubleConversions = "fFeEgGaA";
+  const bool integer_conversion =
+      kIntegerConversions.find(conversion) != base::StringPiece::npos;
+  switch (argument->type) {
+    case internal::BINARY_LOG_SIGNED:
+    case internal::BINARY_LOG_UNSIGNED: {
+      const bool is_signed = argument->type == internal::BINARY_LOG_SIGNED;
+      const uint64_t value = is_signed
+                                 ? static_cast<uint64_t>(
+                                       ZigzagDecode(argument->bits))
+                                 : argument->bits;
+      if (!integer_conversion) {
+        spec = "%";
+        conversion = is_signed ? 'd' : 'u';
+      }
+      if (conversion == 'c') {
+        AppendPrintf(text, spec + 'c', static_cast<int>(value));
+      } else if (conversion == 'd' || conversion == 'i') {
+        AppendPrintf(text, spec + "lld", static_cast<long long>(value));
+      } else {
+        AppendPrintf(text, spec + "ll" + conversion,
+                     static_cast<unsigned long long>(value));
+      }
+      return;
+    }
+    case internal::BINARY_LOG_DOUBLE:
+      if (kDoubleConversions.find(conversion) == base::StringPiece::npos) {
+        spec = "%";
+        conversion = 'g';
+      }
+      AppendPrintf(text, spec + conversion, argument->number);
+      return;
+    case internal::BINARY_LOG_STRING:
+      if (conversion == 's')
+        AppendPrintf(text, spec + 's', argument->string.as_string().c_str());
+      else
+        argument->string.AppendToString(text);
+      return;
+    case internal::BINARY_LOG_POINTER:
+      // The pointer may be wider than those of the decoding process.
+      if (conversion != 'x' && conversion != 'X')
+        spec = "0x%";
+      AppendPrintf(text, spec + "llx",
+                   static_cast<unsigned long long>(argument->bits));
+      return;
+  }
+}
+
+// Appends |format| to |*text|, with its conversions replaced by |arguments|.
+void AppendMessage(std::string* text, const std::string& format,
+                   const std::vector<Argument>& arguments) {
+  size_t next_argument = 0;
+  auto take_argument = [&]() -> const Argument* {
+    return next_argument < arguments.size() ? &arguments[next_argument++]
+                                            : nullptr;
+  };
+  // Appends the integer argument of a '*' width or precision to |*spec|.
+  auto take_star = [&](std::string* spec) {
+    const Argument* argument = take_argument();
+    int64_t value = 0;
+    if (argument && argument->type == internal::BINARY_LOG_SIGNED)
+      value = ZigzagDecode(argument->bits);
+    else if (argument && argument->type == internal::BINARY_LOG_UNSIGNED)
+      value = static_cast<int64_t>(argument->bits);
+    AppendPrintf(spec, "%lld", static_cast<long long>(value));
+  };
+
+  size_t i = 0;
+  while (i < format.size()) {
+    if (format[i] != '%') {
+      const size_t next = std::min(format.find('%', i), format.size());
+      text->append(format, i, next - i);
+      i = next;
+      continue;
+    }
+    if (i + 1 < format.size() && format[i + 1] == '%') {
+      text->push_back('%');
+      i += 2;
+      continue;
+    }
+
+    std::string spec = "%";
+    size_t j = i + 1;
+    while (j < format.size() && strchr("-+ #0'", format[j]))
+      spec.push_back(format[j++]);
+    if (j < format.size() && format[j] == '*') {
+      take_star(&spec);
+      j++;
+    }
+    while (j < format.size() && format[j] >= '0' && format[j] <= '9')
+      spec.push_back(format[j++]);
+    if (j < format.size() && format[j] == '.') {
+      spec.push_back(format[j++]);
+      if (j < format.size() && format[j] == '*') {
+        take_star(&spec);
+        j++;
+      }
+      while (j < format.size() && format[j] >= '0' && format[j] <= '9')
+        spec.push_back(format[j++]);
+    }
+    // The arguments carry their own size.
+    while (j < format.size() && strchr("hlLqjzt", format[j]))
+      j++;
+    if (j == format.size()) {
+      // A truncated conversion; keep it as is.
+      text->append(format, i, j - i);
+      break;
+    }
+    AppendArgument(text, spec, format[j], take_argument());
+    i = j + 1;
+  }
+}
+
+void AppendPrefix(std::string* text, uint64_t process_id, uint64_t thread_id,
+                  int64_t time, const Site& site) {
+  base::Time::Exploded exploded;
+  base::Time::FromInternalValue(time).LocalExplode(&exploded);
+  const int microseconds =
+      static_cast<int>(time % base::Time::kMicrosecondsPerSecond);
+
+  std::string severity;
+  if (site.severity >= 0 && site.severity < LOG_NUM_SEVERITIES)
+    severity = kSeverityNames[site.severity];
+  else if (site.severity < 0)
+    AppendPrintf(&severity, "VERBOSE%d", -site.severity);
+  else
+    severity = "UNKNOWN";
+
+  base::StringPiece file(site.file);
+  const size_t last_slash = file.find_last_of("\\/");
+  if (last_slash != base::StringPiece::npos)
+    file.remove_prefix(last_slash + 1);
+
+  char buffer[128];
+  snprintf(buffer, sizeof(buffer),
+           "[%llu:%llu:%02d%02d/%02d%02d%02d.%06d:%s:",
+           static_cast<unsigned long long>(process_id),
+           static_cast<unsigned long long>(thread_id), exploded.month,
+           exploded.day_of_month, exploded.hour, exploded.minute,
+           exploded.second, microseconds, severity.c_str());
+  text->append(buffer);
+  file.AppendToString(text);
+  AppendPrintf(text, "(%llu)] ", static_cast<unsigned long long>(site.line));
+}
+
+}  // namespace
+
+bool StartBinaryLogging(const base::FilePath& path) {
+  return g_binary_log.Get().Start(path);
+}
+
+void StopBinaryLogging() {
+  g_binary_log.Get().Stop();
+}
+
+void FlushBinaryLog() {
+  g_binary_log.Get().Flush();
+}
+
+bool IsBinaryLoggingEnabled() {
+  return base::subtle::Acquire_Load(&g_binary_logging_enabled) != 0;
+}
+
+bool DecodeBinaryLog(const base::StringPiece& data, std::string* text) {
+  if (!data.starts_with(base::StringPiece(kMagic, kMagicSize)))
+    return false;
+
+  RecordReader reader(data.substr(kMagicSize));
+  uint64_t process_id = 0;
+  int64_t start_time = 0;
+  std::map<uint64_t, Site> sites;
+  std::vector<Argument> arguments;
+  while (!reader.empty()) {
+    uint64_t size;
+    base::StringPiece body;
+    if (!reader.ReadVarint(&size) || !reader.ReadBytes(size, &body))
+      return false;
+    RecordReader record(body);
+    uint8_t type;
+    if (!record.ReadByte(&type))
+      return false;
+
+    switch (type) {
+      case HEADER_RECORD: {
+        uint64_t time;
+        if (!record.ReadVarint(&process_id) || !record.ReadVarint(&time))
+          return false;
+        start_time = static_cast<int64_t>(time);
+        break;
+      }
+      case SITE_RECORD: {
+        uint64_t id;
+        int64_t severity;
+        Site site;
+        base::StringPiece file;
+        base::StringPiece format;
+        if (!record.ReadVarint(&id) || !record.ReadSigned(&severity) ||
+            !record.ReadVarint(&site.line) || !record.ReadString(&file) ||
+            !record.ReadString(&format)) {
+          return false;
+        }
+        site.severity = static_cast<int>(severity);
+        file.CopyToString(&site.file);
+        format.CopyToString(&site.format);
+        sites[id] = site;
+        break;
+      }
+      case MESSAGE_RECORD: {
+        uint64_t site_id;
+        uint64_t thread_id;
+        int64_t time;
+        if (!record.ReadVarint(&site_id) || !record.ReadVarint(&thread_id) ||
+            !record.ReadSigned(&time)) {
+          return false;
+        }
+        arguments.clear();
+        while (!record.empty()) {
+          Argument argument;
+          if (!ReadArgument(&record, &argument))
+            return false;
+          arguments.push_back(argument);
+        }
+        auto site = sites.find(site_id);
+        if (site == sites.end())
+          return false;
+        AppendPrefix(text, process_id, thread_id, start_time + time,
+                     site->second);
+        AppendMessage(text, site->second.format, arguments);
+        text->push_back('\n');
+        break;
+      }
+      case DROPPED_RECORD: {
+        uint64_t count;
+        if (!record.ReadVarint(&count))
+          return false;
+        AppendPrintf(text, "[%llu log messages were dropped]\n",
+                     static_cast<unsigned long long>(count));
+        break;
+      }
+      default:
+        // Skip records added after this decoder was written.
+        break;
+    }
+  }
+  return true;
+}
+
+namespace internal {
+
+BinaryLogRecord::BinaryLogRecord(BinaryLogSite* site)
+    : begin_(buffer_ + kMaxLengthSize), end_(begin_), truncated_(false) {
+  BinaryLog& log = g_binary_log.Get();
+  *end_++ = MESSAGE_RECORD;
+  AddVarint(log.GetSiteId(site));
+  AddVarint(log.GetCurrentThreadId());
+  AddVarint(ZigzagEncode(
+      (base::TimeTicks::Now() -
+       base::TimeTicks::FromInternalValue(log.start_ticks()))
+          .InMicroseconds()));
+}
+
+BinaryLogRecord::~BinaryLogRecord() {
+  // Store the length before the body.
+  const size_t size = end_ - begin_;
+  char* start;
+  if (size < 0x80) {
+    start = begin_ - 1;
+    start[0] = static_cast<char>(size);
+  } else {
+    start = begin_ - 2;
+    start[0] = static_cast<char>(size | 0x80);
+    start[1] = static_cast<char>(size >> 7);
+  }
+  g_binary_log.Get().Write(start, end_ - start);
+}
+
+void BinaryLogRecord::AddString(const char* value) {
+  // Room for the type and a two byte length.
+  if (!Reserve(3))
+    return;
+  size_t size = strlen(value);
+  const size_t room = buffer_ + kMaxSize - end_ - 3;
+  if (size > room) {
+    size = room;
+    truncated_ = true;
+  }
+  *end_++ = BINARY_LOG_STRING;
+  AddVarint(size);
+  memcpy(end_, value, size);
+  end_ += size;
+}
+
+}  // namespace internal
+}  // namespace logging
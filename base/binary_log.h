@@ -0,0 +1,212 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Structured binary logging, for high-volume logging whose output is seldom
+// read. Instead of formatting a message and its prefix, BINARY_LOG() records
+// the ID of its call site and the raw values of its arguments in a compact
+// binary record:
+//
+//   BINARY_LOG(INFO, "Read %d bytes from %s", bytes_read, name.c_str());
+//   BINARY_VLOG(2, "Cache hit for %" PRIu64, key);
+//
+// The format string follows printf() and is checked like one; the arguments
+// are limited to what printf() takes: integers, floating point numbers, C
+// strings and pointers. Each call site is described once per binary log, with
+// its file, line, severity and format string.
+//
+// The records are written by a background thread (see AsyncLogWriter) to the
+// file passed to StartBinaryLogging(), and only formatted when reading it, by
+// DecodeBinaryLog() or the decode_binary_log tool:
+//
+//   decode_binary_log /tmp/chrome.binlog
+//
+// prints the messages as LOG() would, with a process ID, thread ID and
+// timestamp prefix. As with LOG(), BINARY_LOG() and BINARY_VLOG() are subject
+// to SetMinLogLevel() and --v/--vmodule, and their arguments are not
+// evaluated when they are off. They do nothing until StartBinaryLogging() is
+// called, and unlike LOG(FATAL), BINARY_LOG(FATAL) does not crash.
+
+#ifndef BASE_BINARY_LOG_H_
+#define BASE_BINARY_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <type_traits>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/compiler_specific.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+class FilePath;
+}
+
+#define BINARY_LOG(severity, format, ...)                                  \
+  BINARY_LOG_WITH_SEVERITY(                                                \
+      ::logging::LOG_##severity,                                           \
+      ::logging::LOG_##severity >= ::logging::GetMinLogLevel(), format,    \
+      ##__VA_ARGS__)
+
+#define BINARY_VLOG(verbose_level, format, ...)                            \
+  BINARY_LOG_WITH_SEVERITY(-(verbose_level), VLOG_IS_ON(verbose_level),    \
+                           format, ##__VA_ARGS__)
+
+// |format| must be a string literal, since it is kept in a static
+// BinaryLogSite. |condition| is only evaluated when binary logging is on.
+#define BINARY_LOG_WITH_SEVERITY(severity, condition, format, ...)         \
+  do {                                                                     \
+    static ::logging::BinaryLogSite binary_log_site = {                    \
+        __FILE__, __LINE__, severity, format, 0};                          \
+    if (::logging::IsBinaryLoggingEnabled() && (condition)) {              \
+      ::logging::internal::WriteBinaryLogRecord(&binary_log_site,          \
+                                                ##__VA_ARGS__);            \
+    }                                                                      \
+    if (false)                                                             \
+      ::logging::internal::CheckBinaryLogFormat(format, ##__VA_ARGS__);    \
+  } while (0)
+
+namespace logging {
+
+// A call site of BINARY_LOG() or BINARY_VLOG().
+struct BinaryLogSite {
+  const char* file;
+  int line;
+  int severity;
+  const char* format;
+
+  // Assigned when the site first writes a record; 0 until then.
+  base::subtle::Atomic32 id;
+};
+
+// Starts writing the records of BINARY_LOG() and BINARY_VLOG() to |path|,
+// which is replaced if it exists. Stops writing to a previous file first.
+// Returns false if |path| could not be created. Only implemented on POSIX.
+BASE_EXPORT bool StartBinaryLogging(const base::FilePath& path);
+
+// Writes the pending records and closes the binary log.
+BASE_EXPORT void StopBinaryLogging();
+
+// Writes the pending records without closing the binary log.
+BASE_EXPORT void FlushBinaryLog();
+
+BASE_EXPORT bool IsBinaryLoggingEnabled();
+
+// Appends the messages of the binary log |data| to |*text|, one per line.
+// Returns false if |data| is not a binary log or is truncated; |*text| then
+// holds the messages before the problem.
+BASE_EXPORT bool DecodeBinaryLog(const base::StringPiece& data,
+                                 std::string* text);
+
+namespace internal {
+
+// The types of the arguments stored in a record.
+enum BinaryLogArgumentType : uint8_t {
+  BINARY_LOG_SIGNED = 1,
+  BINARY_LOG_UNSIGNED,
+  BINARY_LOG_DOUBLE,
+  BINARY_LOG_STRING,
+  BINARY_LOG_POINTER,
+};
+
+// Builds a record on the stack, and writes it out on destruction. Arguments
+// that do not fit in kMaxSize bytes are cut short or left out.
+class BASE_EXPORT BinaryLogRecord {
+ public:
+  static const size_t kMaxSize = 1024;
+
+  explicit BinaryLogRecord(BinaryLogSite* site);
+  ~BinaryLogRecord();
+
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value &&
+                          std::is_signed<T>::value>::type
+  Add(T value) {
+    AddSigned(value);
+  }
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value &&
+                          !std::is_signed<T>::value>::type
+  Add(T value) {
+    AddUnsigned(BINARY_LOG_UNSIGNED, value);
+  }
+  template <typename T>
+  typename std::enable_if<std::is_enum<T>::value>::type Add(T value) {
+    AddSigned(static_cast<int64_t>(value));
+  }
+  void Add(double value) {
+    if (!Reserve(1 + sizeof(value)))
+      return;
+    *end_++ = BINARY_LOG_DOUBLE;
+    memcpy(end_, &value, sizeof(value));
+    end_ += sizeof(value);
+  }
+  void Add(const char* value) { AddString(value ? value : "(null)"); }
+  void Add(char* value) { Add(static_cast<const char*>(value)); }
+  void Add(const void* value) {
+    AddUnsigned(BINARY_LOG_POINTER, reinterpret_cast<uintptr_t>(value));
+  }
+
+ private:
+  // Returns true if |size| more bytes fit. Once an argument has not fit, no
+  // more are added, so that the decoder does not match them to the wrong
+  // conversions.
+  bool Reserve(size_t size) {
+    if (truncated_ || static_cast<size_t>(buffer_ + kMaxSize - end_) < size) {
+      truncated_ = true;
+      return false;
+    }
+    return true;
+  }
+
+  void AddSigned(int64_t value) {
+    // Zigzag encoding keeps small negative numbers short.
+    AddUnsigned(BINARY_LOG_SIGNED, (static_cast<uint64_t>(value) << 1) ^
+                                       static_cast<uint64_t>(value >> 63));
+  }
+  void AddUnsigned(BinaryLogArgumentType type, uint64_t value) {
+    if (!Reserve(11))
+      return;
+    *end_++ = type;
+    AddVarint(value);
+  }
+  void AddVarint(uint64_t value) {
+    while (value >= 0x80) {
+      *end_++ = static_cast<char>(value | 0x80);
+      value >>= 7;
+    }
+    *end_++ = static_cast<char>(value);
+  }
+  void AddString(const char* value);
+
+  char buffer_[kMaxSize];
+  // The body of the record starts after room for its length.
+  char* const begin_;
+  char* end_;
+  bool truncated_;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryLogRecord);
+};
+
+template <typename... Args>
+void WriteBinaryLogRecord(BinaryLogSite* site, const Args&... args) {
+  BinaryLogRecord record(site);
+  // Adds the arguments in order.
+  const int unused[] = {0, (record.Add(args), 0)...};
+  ALLOW_UNUSED_LOCAL(unused);
+}
+
+// Never called: lets the compiler check the arguments against |format|.
+inline void CheckBinaryLogFormat(const char* format, ...) PRINTF_FORMAT(1, 2);
+inline void CheckBinaryLogFormat(const char* format, ...) {}
+
+}  // namespace internal
+}  // namespace logging
+
+#endif  // BASE_BINARY_LOG_H_
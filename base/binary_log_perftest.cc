@@ -0,0 +1,79 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/binary_log.h"
+
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/logging.h"
+#include "base/time/time.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace logging {
+
+namespace {
+
+const int kMessages = 100000;
+
+// Runs |function| kMessages times, and prints the time it took per call.
+template <typename Function>
+void Measure(const char* trace, Function function) {
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kMessages; i++)
+    function(i);
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  perf_test::PrintResult("time_per_message", "", trace,
+                         elapsed.InSecondsF() * 1e9 / kMessages, "ns",
+                         true);
+}
+
+}  // namespace
+
+#if defined(OS_POSIX)
+
+// Compares VLOG() to a log file with BINARY_VLOG(), on a typical message.
+TEST(BinaryLogPerfTest, VerboseLogging) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const int old_min_log_level = GetMinLogLevel();
+  SetMinLogLevel(-1);
+  const char* const url = "https://www.example.com/index.html";
+
+  const base::FilePath log_path = temp_dir.path().AppendASCII("test.log");
+  LoggingSettings settings;
+  settings.logging_dest = LOG_TO_FILE;
+  settings.log_file = log_path.value().c_str();
+  settings.delete_old = DELETE_OLD_LOG_FILE;
+  ASSERT_TRUE(InitLogging(settings));
+  Measure("VLOG", [url](int i) {
+    VLOG(1) << "Request " << i << " for " << url << " took " << i * 0.25
+            << " ms";
+  });
+
+  // Most of these are dropped: their cost is mostly that of formatting.
+  settings.write_log = WRITE_LOG_ASYNCHRONOUSLY;
+  ASSERT_TRUE(InitLogging(settings));
+  Measure("VLOG_asynchronous", [url](int i) {
+    VLOG(1) << "Request " << i << " for " << url << " took " << i * 0.25
+            << " ms";
+  });
+  FlushLogMessages();
+
+  ASSERT_TRUE(InitLogging(LoggingSettings()));
+  CloseLogFile();
+
+  ASSERT_TRUE(StartBinaryLogging(temp_dir.path().AppendASCII("test.binlog")));
+  Measure("BINARY_VLOG", [url](int i) {
+    BINARY_VLOG(1, "Request %d for %s took %f ms", i, url, i * 0.25);
+  });
+  StopBinaryLogging();
+
+  SetMinLogLevel(old_min_log_level);
+}
+
+#endif  // defined(OS_POSIX)
+
+}  // namespace logging
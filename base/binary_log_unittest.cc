@@ -0,0 +1,260 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/binary_log.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/macros.h"
+#include "base/process/process_handle.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace logging {
+
+namespace {
+
+class BinaryLogTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().AppendASCII("test.binlog");
+    old_min_log_level_ = GetMinLogLevel();
+  }
+
+  void TearDown() override {
+    StopBinaryLogging();
+    SetMinLogLevel(old_min_log_level_);
+  }
+
+  // Stops binary logging and returns the decoded lines of |path_|.
+  std::vector<std::string> StopAndDecode() {
+    StopBinaryLogging();
+    std::string data;
+    EXPECT_TRUE(base::ReadFileToString(path_, &data));
+    std::string text;
+    EXPECT_TRUE(DecodeBinaryLog(data, &text));
+    return base::SplitString(text, "\n", base::KEEP_WHITESPACE,
+                             base::SPLIT_WANT_NONEMPTY);
+  }
+
+  // Returns the message of |line|, after its prefix.
+  static std::string Message(const std::string& line) {
+    const size_t end_of_prefix = line.find("] ");
+    EXPECT_NE(std::string::npos, end_of_prefix) << line;
+    return line.substr(end_of_prefix + 2);
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+  int old_min_log_level_;
+};
+
+int CountCall(int* calls) {
+  ++*calls;
+  return *calls;
+}
+
+class LoggingThread : public base::DelegateSimpleThread::Delegate {
+ public:
+  LoggingThread(int id, int count) : id_(id), count_(count) {}
+
+  void Run() override {
+    for (int i = 0; i < count_; i++)
+      BINARY_LOG(INFO, "thread %d message %d", id_, i);
+  }
+
+ private:
+  const int id_;
+  const int count_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoggingThread);
+};
+
+}  // namespace
+
+#if defined(OS_POSIX)
+
+TEST_F(BinaryLogTest, WritesMessages) {
+  SetMinLogLevel(-1);
+  ASSERT_TRUE(StartBinaryLogging(path_));
+  EXPECT_TRUE(IsBinaryLoggingEnabled());
+
+  const int line = __LINE__ + 1;
+  BINARY_LOG(INFO, "no arguments");
+  BINARY_LOG(WARNING, "%d %s", -42, "apples");
+  BINARY_LOG(ERROR, "%" PRIu64 " %" PRId64,
+             std::numeric_limits<uint64_t>::max(),
+             std::numeric_limits<int64_t>::min());
+  BINARY_VLOG(1, "%.3f %g %e", 3.14159, 0.5, 1e100);
+
+  std::vector<std::string> lines = StopAndDecode();
+  ASSERT_EQ(4u, lines.size());
+  EXPECT_EQ("no arguments", Message(lines[0]));
+  EXPECT_EQ("-42 apples", Message(lines[1]));
+  EXPECT_EQ("18446744073709551615 -9223372036854775808", Message(lines[2]));
+  EXPECT_EQ("3.142 0.5 1.000000e+100", Message(lines[3]));
+
+  // The prefix is the one of LOG(), with all the optional items.
+  EXPECT_TRUE(base::EndsWith(
+      lines[0].substr(0, lines[0].find("] ")),
+      base::StringPrintf(":INFO:binary_log_unittest.cc(%d)", line),
+      base::CompareCase::SENSITIVE))
+      << lines[0];
+  EXPECT_NE(std::string::npos, lines[1].find(":WARNING:"));
+  EXPECT_NE(std::string::npos, lines[2].find(":ERROR:"));
+  EXPECT_NE(std::string::npos, lines[3].find(":VERBOSE1:"));
+  EXPECT_TRUE(base::StartsWith(
+      lines[0],
+      base::StringPrintf("[%d:", static_cast<int>(base::GetCurrentProcId())),
+      base::CompareCase::SENSITIVE))
+      << lines[0];
+}
+
+TEST_F(BinaryLogTest, FormatsLikePrintf) {
+  ASSERT_TRUE(StartBinaryLogging(path_));
+
+  const char* const null_string = nullptr;
+  BINARY_LOG(ERROR, "[%5d][%-5d][%05d][%+d]", 42, 42, 42, 42);
+  BINARY_LOG(ERROR, "[%x][%X][%#o][%c][%%]", 255u, 255u, 8u, 'z');
+  BINARY_LOG(ERROR, "[%6s][%-6s][%.2s][%s]", "ab", "ab", "abc", null_string);
+  BINARY_LOG(ERROR, "[%*d][%.*f]", 4, 7, 2, 1.0);
+  BINARY_LOG(ERROR, "[%hhd][%ld][%lld][%zu]", static_cast<signed char>(-1),
+             -2L, -3LL, static_cast<size_t>(4));
+  BINARY_LOG(ERROR, "%p", reinterpret_cast<void*>(0xabc));
+
+  std::vector<std::string> lines = StopAndDecode();
+  ASSERT_EQ(6u, lines.size());
+  EXPECT_EQ("[   42][42   ][00042][+42]", Message(lines[0]));
+  EXPECT_EQ("[ff][FF][010][z][%]", Message(lines[1]));
+  EXPECT_EQ("[    ab][ab    ][ab][(null)]", Message(lines[2]));
+  EXPECT_EQ("[   7][1.00]", Message(lines[3]));
+  EXPECT_EQ("[-1][-2][-3][4]", Message(lines[4]));
+  EXPECT_EQ("0xabc", Message(lines[5]));
+}
+
+TEST_F(BinaryLogTest, TruncatesLongArguments) {
+  ASSERT_TRUE(StartBinaryLogging(path_));
+
+  const std::string long_string(2000, 'x');
+  BINARY_LOG(ERROR, "%s %d", long_string.c_str(), 1);
+
+  std::vector<std::string> lines = StopAndDecode();
+  ASSERT_EQ(1u, lines.size());
+  const std::string message = Message(lines[0]);
+  // The record header takes a few bytes, depending on the thread ID and time.
+  EXPECT_GT(message.size(), 900u);
+  EXPECT_LT(message.size(), internal::BinaryLogRecord::kMaxSize +
+                                sizeof(" (missing)"));
+  EXPECT_TRUE(base::EndsWith(message, "xxx (missing)",
+                             base::CompareCase::SENSITIVE));
+}
+
+TEST_F(BinaryLogTest, DoesNotEvaluateArgumentsWhenOff) {
+  int calls = 0;
+  BINARY_LOG(ERROR, "%d", CountCall(&calls));
+  EXPECT_FALSE(IsBinaryLoggingEnabled());
+
+  ASSERT_TRUE(StartBinaryLogging(path_));
+  SetMinLogLevel(LOG_WARNING);
+  BINARY_LOG(INFO, "%d", CountCall(&calls));
+  BINARY_VLOG(1, "%d", CountCall(&calls));
+  BINARY_LOG(WARNING, "%d", CountCall(&calls));
+  EXPECT_EQ(1, calls);
+
+  std::vector<std::string> lines = StopAndDecode();
+  ASSERT_EQ(1u, lines.size());
+  EXPECT_EQ("1", Message(lines[0]));
+}
+
+TEST_F(BinaryLogTest, DescribesSitesInEachLog) {
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(StartBinaryLogging(path_));
+    BINARY_LOG(ERROR, "log %d", i);
+    std::vector<std::string> lines = StopAndDecode();
+    ASSERT_EQ(1u, lines.size());
+    EXPECT_EQ(base::StringPrintf("log %d", i), Message(lines[0]));
+  }
+}
+
+TEST_F(BinaryLogTest, WritesFromManyThreads) {
+  const int kThreads = 4;
+  const int kMessages = 1000;
+  ASSERT_TRUE(StartBinaryLogging(path_));
+  SetMinLogLevel(LOG_INFO);
+
+  std::vector<scoped_ptr<LoggingThread>> logging_threads;
+  std::vector<scoped_ptr<base::DelegateSimpleThread>> threads;
+  for (int i = 0; i < kThreads; i++) {
+    logging_threads.push_back(
+        make_scoped_ptr(new LoggingThread(i, kMessages)));
+    threads.push_back(make_scoped_ptr(new base::DelegateSimpleThread(
+        logging_threads.back().get(), "LoggingThread")));
+    threads.back()->Start();
+  }
+  for (const auto& thread : threads)
+    thread->Join();
+
+  // Each thread's messages are in order, unless some were dropped.
+  std::vector<int> next_message(kThreads, 0);
+  bool dropped = false;
+  for (const std::string& line : StopAndDecode()) {
+    if (base::EndsWith(line, " log messages were dropped]",
+                       base::CompareCase::SENSITIVE)) {
+      dropped = true;
+      continue;
+    }
+    int thread;
+    int message;
+    ASSERT_EQ(2, sscanf(Message(line).c_str(), "thread %d message %d",
+                        &thread, &message)) << line;
+    ASSERT_GE(thread, 0);
+    ASSERT_LT(thread, kThreads);
+    EXPECT_LT(next_message[thread], message + 1);
+    next_message[thread] = message + 1;
+  }
+  if (!dropped) {
+    for (int i = 0; i < kThreads; i++)
+      EXPECT_EQ(kMessages, next_message[i]);
+  }
+}
+
+#endif  // defined(OS_POSIX)
+
+TEST_F(BinaryLogTest, DecodeRejectsBadLogs) {
+  std::string text;
+  EXPECT_FALSE(DecodeBinaryLog("", &text));
+  EXPECT_FALSE(DecodeBinaryLog("not a binary log", &text));
+  // A message record without the site record it refers to.
+  const char kUnknownSite[] = "BINLOG1\n\x04\x03\x01\x01\x00";
+  EXPECT_FALSE(DecodeBinaryLog(
+      base::StringPiece(kUnknownSite, sizeof(kUnknownSite) - 1), &text));
+  EXPECT_TRUE(text.empty());
+
+#if defined(OS_POSIX)
+  ASSERT_TRUE(StartBinaryLogging(path_));
+  BINARY_LOG(ERROR, "message");
+  StopBinaryLogging();
+  std::string data;
+  ASSERT_TRUE(base::ReadFileToString(path_, &data));
+  EXPECT_TRUE(DecodeBinaryLog(data, &text));
+  EXPECT_FALSE(text.empty());
+  EXPECT_FALSE(DecodeBinaryLog(data.substr(0, 4), &text));
+  EXPECT_FALSE(DecodeBinaryLog(data.substr(0, data.size() - 1), &text));
+#endif
+}
+
+}  // namespace logging
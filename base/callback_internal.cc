@@ -4,11 +4,163 @@
 
 #include "base/callback_internal.h"
 
+#include <utility>
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/threading/thread_local_storage.h"
 
 namespace base {
 namespace internal {
 
+namespace {
+
+// BindStates are allocated in size classes of kSizeClassBytes, up to
+// kSizeClasses * kSizeClassBytes. Larger ones come from the heap directly.
+const size_t kSizeClassBytes = 32;
+const size_t kSizeClasses = 8;
+
+#if defined(ADDRESS_SANITIZER) || defined(MEMORY_SANITIZER)
+// Reusing blocks would hide use-after-free errors from the sanitizers.
+const bool kUseFreeLists = false;
+#else
+const bool kUseFreeLists = true;
+#endif
+
+// Free blocks move between the threads and the depot in batches of this many.
+const int kBatchSize = 32;
+
+// A thread returns a batch to the depot when it has more free blocks than
+// this in one size class.
+const int kMaxCachedBlocks = 2 * kBatchSize;
+
+// The number of batches the depot holds in each size class.
+const size_t kDepotSlots = 16;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// The free blocks of a thread, by size class.
+struct ThreadCache {
+  FreeBlock* blocks[kSizeClasses];
+  int block_counts[kSizeClasses];
+};
+
+// Batches of free blocks, linked through FreeBlock::next, which a thread that
+// frees more than it allocates (e.g. one running tasks posted from other
+// threads) hands to threads that allocate more than they free. A slot holds
+// one batch or 0, and changes hands with a single compare-and-swap, so the
+// depot needs no lock, and a batch is never seen half-linked.
+subtle::AtomicWord g_depot[kSizeClasses][kDepotSlots];
+
+void DestroyThreadCache(void* value) {
+  ThreadCache* cache = static_cast<ThreadCache*>(value);
+  for (size_t size_class = 0; size_class < kSizeClasses; size_class++) {
+    FreeBlock* block = cache->blocks[size_class];
+    while (block) {
+      FreeBlock* next = block->next;
+      ::operator delete(block);
+      block = next;
+    }
+  }
+  delete cache;
+}
+
+struct ThreadCacheSlot {
+  ThreadCacheSlot() : slot(&DestroyThreadCache) {}
+
+  ThreadLocalStorage::Slot slot;
+};
+
+LazyInstance<ThreadCacheSlot>::Leaky g_thread_cache_slot =
+    LAZY_INSTANCE_INITIALIZER;
+
+ThreadCache* GetThreadCache() {
+  ThreadLocalStorage::Slot& slot = g_thread_cache_slot.Get().slot;
+  ThreadCache* cache = static_cast<ThreadCache*>(slot.Get());
+  if (!cache) {
+    cache = new ThreadCache();
+    slot.Set(cache);
+  }
+  return cache;
+}
+
+FreeBlock* TakeBatch(size_t size_class) {
+  for (subtle::AtomicWord& depot_slot : g_depot[size_class]) {
+    const subtle::AtomicWord batch = subtle::NoBarrier_Load(&depot_slot);
+    if (batch && subtle::Acquire_CompareAndSwap(&depot_slot, batch, 0) == batch)
+      return reinterpret_cast<FreeBlock*>(batch);
+  }
+  return nullptr;
+}
+
+bool PutBatch(size_t size_class, FreeBlock* batch) {
+  const subtle::AtomicWord value = reinterpret_cast<subtle::AtomicWord>(batch);
+  for (subtle::AtomicWord& depot_slot : g_depot[size_class]) {
+    if (!subtle::NoBarrier_Load(&depot_slot) &&
+        subtle::Release_CompareAndSwap(&depot_slot, 0, value) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+// static
+void* BindStateBase::operator new(size_t size) {
+  const size_t size_class = (size - 1) / kSizeClassBytes;
+  if (!kUseFreeLists || size_class >= kSizeClasses)
+    return ::operator new(size);
+
+  ThreadCache* cache = GetThreadCache();
+  FreeBlock* block = cache->blocks[size_class];
+  if (!block) {
+    block = TakeBatch(size_class);
+    if (!block)
+      return ::operator new((size_class + 1) * kSizeClassBytes);
+    cache->block_counts[size_class] = kBatchSize;
+  }
+  cache->blocks[size_class] = block->next;
+  cache->block_counts[size_class]--;
+  return block;
+}
+
+// static
+void BindStateBase::operator delete(void* ptr, size_t size) {
+  const size_t size_class = (size - 1) / kSizeClassBytes;
+  if (!kUseFreeLists || size_class >= kSizeClasses) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  ThreadCache* cache = GetThreadCache();
+  FreeBlock* block = static_cast<FreeBlock*>(ptr);
+  block->next = cache->blocks[size_class];
+  cache->blocks[size_class] = block;
+  if (++cache->block_counts[size_class] <= kMaxCachedBlocks)
+    return;
+
+  // Hands a batch of blocks over to the depot.
+  FreeBlock* batch = block;
+  for (int i = 1; i < kBatchSize; i++)
+    block = block->next;
+  cache->blocks[size_class] = block->next;
+  block->next = nullptr;
+  cache->block_counts[size_class] -= kBatchSize;
+  if (PutBatch(size_class, batch))
+    return;
+
+  // The depot is full.
+  while (batch) {
+    FreeBlock* next = batch->next;
+    ::operator delete(batch);
+    batch = next;
+  }
+}
+
 void BindStateBase::AddRef() {
   AtomicRefCountInc(&ref_count_);
 }
@@ -21,6 +173,20 @@ void BindStateBase::Release() {
 CallbackBase::CallbackBase(const CallbackBase& c) = default;
 CallbackBase& CallbackBase::operator=(const CallbackBase& c) = default;
 
+CallbackBase::CallbackBase(CallbackBase&& c)
+    : bind_state_(std::move(c.bind_state_)),
+      polymorphic_invoke_(c.polymorphic_invoke_) {
+  c.polymorphic_invoke_ = NULL;
+}
+
+CallbackBase& CallbackBase::operator=(CallbackBase&& c) {
+  InvokeFuncStorage polymorphic_invoke = c.polymorphic_invoke_;
+  c.polymorphic_invoke_ = NULL;
+  bind_state_ = std::move(c.bind_state_);
+  polymorphic_invoke_ = polymorphic_invoke;
+  return *this;
+}
+
 void CallbackBase::Reset() {
   polymorphic_invoke_ = NULL;
   // NULL the bind_state_ last, since it may be holding the last ref to whatever
@@ -36,7 +36,13 @@ class CallbackBase;
 // Creating a vtable for every BindState template instantiation results in a lot
 // of bloat. Its only task is to call the destructor which can be done with a
 // function pointer.
-class BindStateBase {
+class BASE_EXPORT BindStateBase {
+ public:
+  // BindStates are small and mostly short-lived, so they come from per-thread
+  // free lists of a few size classes rather than from the heap.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
  protected:
   explicit BindStateBase(void (*destructor)(BindStateBase*))
       : ref_count_(0), destructor_(destructor) {}
@@ -64,6 +70,11 @@ class BASE_EXPORT CallbackBase {
   CallbackBase(const CallbackBase& c);
   CallbackBase& operator=(const CallbackBase& c);
 
+  // Moving a callback leaves the source null, and unlike copying does not
+  // touch the reference count of the BindState.
+  CallbackBase(CallbackBase&& c);
+  CallbackBase& operator=(CallbackBase&& c);
+
   // Returns true if Callback is null (doesn't refer to anything).
   bool is_null() const { return bind_state_.get() == NULL; }
 
@@ -0,0 +1,77 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/location.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const int kCallbacks = 1000000;
+
+void Add(int* sum, int value) {
+  *sum += value;
+}
+
+void AddAndSignal(int* sum, int value, int last_value, WaitableEvent* done) {
+  *sum += value;
+  if (value == last_value)
+    done->Signal();
+}
+
+void PrintTimePerCallback(const char* trace, TimeTicks start) {
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  perf_test::PrintResult("time_per_callback", "", trace,
+                         elapsed.InSecondsF() * 1e9 / kCallbacks, "ns", true);
+}
+
+}  // namespace
+
+TEST(CallbackPerfTest, BindAndRun) {
+  int sum = 0;
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kCallbacks; i++)
+    Bind(&Add, &sum, 1).Run();
+  PrintTimePerCallback("Bind_Run", start);
+  EXPECT_EQ(kCallbacks, sum);
+}
+
+TEST(CallbackPerfTest, PostTaskToCurrentLoop) {
+  MessageLoop loop;
+  int sum = 0;
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kCallbacks; i++)
+    loop.task_runner()->PostTask(FROM_HERE, Bind(&Add, &sum, 1));
+  RunLoop().RunUntilIdle();
+  PrintTimePerCallback("PostTask_current_loop", start);
+  EXPECT_EQ(kCallbacks, sum);
+}
+
+// The callbacks are bound on one thread and destroyed on another, which is
+// the worst case for per-thread caches.
+TEST(CallbackPerfTest, PostTaskToOtherThread) {
+  Thread thread("CallbackPerfTest");
+  ASSERT_TRUE(thread.Start());
+  WaitableEvent done(false, false);
+  int sum = 0;
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kCallbacks; i++) {
+    thread.task_runner()->PostTask(
+        FROM_HERE, Bind(&AddAndSignal, &sum, i, kCallbacks - 1, &done));
+  }
+  done.Wait();
+  PrintTimePerCallback("PostTask_other_thread", start);
+  thread.Stop();
+}
+
+}  // namespace base
@@ -2,12 +2,18 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string.h>
+
+#include <utility>
+#include <vector>
+
 #include "base/bind.h"
 #include "base/callback.h"
 #include "base/callback_helpers.h"
 #include "base/callback_internal.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/threading/simple_thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
@@ -185,5 +191,90 @@ TEST_F(CallbackTest, CallbackHasLastRefOnContainingObject) {
   ASSERT_TRUE(deleted);
 }
 
+TEST_F(CallbackTest, Move) {
+  const Callback<void()> copy_of_a = callback_a_;
+
+  Callback<void()> moved(std::move(callback_a_));
+  EXPECT_TRUE(callback_a_.is_null());
+  EXPECT_TRUE(moved.Equals(copy_of_a));
+
+  callback_a_ = std::move(moved);
+  EXPECT_TRUE(moved.is_null());
+  EXPECT_TRUE(callback_a_.Equals(copy_of_a));
+}
+
+template <size_t size>
+struct Payload {
+  explicit Payload(char value) { memset(data, value, size); }
+  char data[size];
+};
+
+template <size_t size>
+bool HasPayload(char value, const Payload<size>& payload) {
+  for (char c : payload.data) {
+    if (c != value)
+      return false;
+  }
+  return true;
+}
+
+// BindStates of all sizes, pooled or not, are allocated and freed correctly.
+TEST_F(CallbackTest, BoundArgumentsOfManySizes) {
+  for (int i = 0; i < 100; i++) {
+    const char value = static_cast<char>(i);
+    Callback<bool()> small = Bind(&HasPayload<1>, value, Payload<1>(value));
+    Callback<bool()> medium = Bind(&HasPayload<100>, value,
+                                   Payload<100>(value));
+    Callback<bool()> large = Bind(&HasPayload<240>, value,
+                                  Payload<240>(value));
+    Callback<bool()> huge = Bind(&HasPayload<1000>, value,
+                                 Payload<1000>(value));
+    EXPECT_TRUE(small.Run());
+    EXPECT_TRUE(medium.Run());
+    EXPECT_TRUE(large.Run());
+    EXPECT_TRUE(huge.Run());
+  }
+}
+
+int Identity(int value) {
+  return value;
+}
+
+class CallbackResetter : public DelegateSimpleThread::Delegate {
+ public:
+  explicit CallbackResetter(std::vector<Callback<int()>>* callbacks)
+      : callbacks_(callbacks) {}
+
+  void Run() override {
+    for (Callback<int()>& callback : *callbacks_)
+      callback.Reset();
+  }
+
+ private:
+  std::vector<Callback<int()>>* const callbacks_;
+
+  DISALLOW_COPY_AND_ASSIGN(CallbackResetter);
+};
+
+// The BindStates freed by a thread other than the one that allocated them find
+// their way back to the allocating thread.
+TEST_F(CallbackTest, FreedOnAnotherThread) {
+  const int kCallbacks = 1000;
+  std::vector<Callback<int()>> callbacks(kCallbacks);
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < kCallbacks; i++)
+      callbacks[i] = Bind(&Identity, round * kCallbacks + i);
+    for (int i = 0; i < kCallbacks; i++)
+      ASSERT_EQ(round * kCallbacks + i, callbacks[i].Run());
+
+    CallbackResetter resetter(&callbacks);
+    DelegateSimpleThread thread(&resetter, "CallbackResetter");
+    thread.Start();
+    thread.Join();
+    for (const Callback<int()>& callback : callbacks)
+      ASSERT_TRUE(callback.is_null());
+  }
+}
+
 }  // namespace
 }  // namespace base
@@ -283,23 +283,33 @@ class OwningMRUCache
 
 // HashingMRUCache ------------------------------------------------------------
 
-template <class KeyType, class ValueType>
+// The map type of HashingMRUCache, which hashes keys with |HashType|.
+template <class HashType>
 struct MRUCacheHashMap {
-  typedef base::hash_map<KeyType, ValueType> Type;
+  template <class KeyType, class ValueType>
+  struct WithTypes {
+    typedef base::hash_map<KeyType, ValueType, HashType> Type;
+  };
 };
 
 // This class is similar to MRUCache, except that it uses base::hash_map as
 // the map type instead of std::map. Note that your KeyType must be hashable
-// to use this cache.
-template <class KeyType, class PayloadType>
-class HashingMRUCache : public MRUCacheBase<KeyType,
-                                            PayloadType,
-                                            MRUCacheNullDeletor<PayloadType>,
-                                            MRUCacheHashMap> {
+// to use this cache, or you need to pass a |HashType|, such as base::StringHash
+// from base/hash.h for string keys.
+template <class KeyType,
+          class PayloadType,
+          class HashType = BASE_HASH_NAMESPACE::hash<KeyType>>
+class HashingMRUCache
+    : public MRUCacheBase<KeyType,
+                          PayloadType,
+                          MRUCacheNullDeletor<PayloadType>,
+                          MRUCacheHashMap<HashType>::template WithTypes> {
  private:
-  typedef MRUCacheBase<KeyType, PayloadType,
+  typedef MRUCacheBase<KeyType,
+                       PayloadType,
                        MRUCacheNullDeletor<PayloadType>,
-                       MRUCacheHashMap> ParentType;
+                       MRUCacheHashMap<HashType>::template WithTypes>
+      ParentType;
 
  public:
   // See MRUCacheBase, noting the possibility of using NO_AUTO_EVICT.
@@ -12,6 +12,7 @@
 
 #include <algorithm>
 
+#include "base/atomicops.h"
 #include "base/macros.h"
 #include "base/strings/string_piece.h"
 #include "build/build_config.h"
@@ -48,6 +49,7 @@ CPU::CPU()
     has_avx_(false),
     has_avx2_(false),
     has_aesni_(false),
+    has_sha_(false),
     has_non_stop_time_stamp_counter_(false),
     has_broken_neon_(false),
     cpu_vendor_("unknown") {
@@ -59,6 +61,8 @@ namespace {
 #if defined(ARCH_CPU_X86_FAMILY)
 #ifndef _MSC_VER
 
+// Leaf 7 has subleaves, selected by ECX; the features are in subleaf 0. The
+// other leaves used here ignore ECX.
 #if defined(__pic__) && defined(__i386__)
 
 void __cpuid(int cpu_info[4], int info_type) {
@@ -67,7 +71,7 @@ void __cpuid(int cpu_info[4], int info_type) {
     "cpuid\n"
     "xchg %%edi, %%ebx\n"
     : "=a"(cpu_info[0]), "=D"(cpu_info[1]), "=c"(cpu_info[2]), "=d"(cpu_info[3])
-    : "a"(info_type)
+    : "a"(info_type), "c"(0)
   );
 }
 
@@ -77,7 +81,7 @@ void __cpuid(int cpu_info[4], int info_type) {
   __asm__ volatile (
     "cpuid\n"
     : "=a"(cpu_info[0]), "=b"(cpu_info[1]), "=c"(cpu_info[2]), "=d"(cpu_info[3])
-    : "a"(info_type)
+    : "a"(info_type), "c"(0)
   );
 }
 
@@ -193,6 +197,12 @@ base::LazyInstance<LazyCpuInfoValue>::Leaky g_lazy_cpuinfo =
 #endif  // defined(ARCH_CPU_ARM_FAMILY) && (defined(OS_ANDROID) ||
         // defined(OS_LINUX))
 
+// The Feature values of the processor, or'ed with kFeaturesQueried once they
+// are known, and the ones disabled for testing.
+const subtle::Atomic32 kFeaturesQueried = 1 << 30;
+subtle::Atomic32 g_features = 0;
+subtle::Atomic32 g_disabled_features = 0;
+
 }  // anonymous namespace
 
 void CPU::Initialize() {
@@ -218,7 +228,11 @@ void CPU::Initialize() {
     int cpu_info7[4] = {0};
     __cpuid(cpu_info, 1);
     if (num_ids >= 7) {
+#if defined(_MSC_VER)
+      __cpuidex(cpu_info7, 7, 0);
+#else
       __cpuid(cpu_info7, 7);
+#endif
     }
     signature_ = cpu_info[0];
     stepping_ = cpu_info[0] & 0xf;
@@ -251,6 +265,7 @@ void CPU::Initialize() {
         (_xgetbv(0) & 6) == 6 /* XSAVE enabled by kernel */;
     has_aesni_ = (cpu_info[2] & 0x02000000) != 0;
     has_avx2_ = has_avx_ && (cpu_info7[1] & 0x00000020) != 0;
+    has_sha_ = (cpu_info7[1] & 0x20000000) != 0;
   }
 
   // Get the brand string of the cpu.
@@ -293,4 +308,30 @@ CPU::IntelMicroArchitecture CPU::GetIntelMicroArchitecture() const {
   return PENTIUM;
 }
 
+// static
+bool CPU::HasFeature(Feature feature) {
+  subtle::Atomic32 features = subtle::NoBarrier_Load(&g_features);
+  if (!features) {
+    CPU cpu;
+    features = kFeaturesQueried;
+    if (cpu.has_ssse3())
+      features |= FEATURE_SSSE3;
+    if (cpu.has_sse41())
+      features |= FEATURE_SSE41;
+    if (cpu.has_avx2())
+      features |= FEATURE_AVX2;
+    if (cpu.has_sha())
+      features |= FEATURE_SHA;
+    // Racing threads store the same value.
+    subtle::NoBarrier_Store(&g_features, features);
+  }
+  return (features & feature &
+          ~subtle::NoBarrier_Load(&g_disabled_features)) != 0;
+}
+
+// static
+void CPU::SetDisabledFeaturesForTesting(int features) {
+  subtle::NoBarrier_Store(&g_disabled_features, features);
+}
+
 }  // namespace base
@@ -8,6 +8,15 @@
 #include <string>
 
 #include "base/base_export.h"
+#include "build/build_config.h"
+
+// Defined where kernels for instruction set extensions can be compiled with
+// __attribute__((target(...))), so that a file does not depend on the
+// compiler's -m flags. They must only be run if CPU::HasFeature() says so.
+#if defined(ARCH_CPU_X86_FAMILY) && defined(COMPILER_GCC) && \
+    (defined(__clang__) || __GNUC__ >= 5)
+#define BASE_CPU_TARGET_ATTRIBUTES
+#endif
 
 namespace base {
 
@@ -49,6 +58,8 @@ class BASE_EXPORT CPU {
   bool has_avx() const { return has_avx_; }
   bool has_avx2() const { return has_avx2_; }
   bool has_aesni() const { return has_aesni_; }
+  // Whether the SHA extensions (SHA-1 and SHA-256 instructions) are present.
+  bool has_sha() const { return has_sha_; }
   bool has_non_stop_time_stamp_counter() const {
     return has_non_stop_time_stamp_counter_;
   }
@@ -60,6 +71,24 @@ class BASE_EXPORT CPU {
   IntelMicroArchitecture GetIntelMicroArchitecture() const;
   const std::string& cpu_brand() const { return cpu_brand_; }
 
+  // The features which kernels are picked by at runtime.
+  enum Feature {
+    FEATURE_SSSE3 = 1 << 0,
+    FEATURE_SSE41 = 1 << 1,
+    FEATURE_AVX2 = 1 << 2,
+    FEATURE_SHA = 1 << 3,
+  };
+
+  // Returns whether the processor has |feature|. Unlike the accessors above,
+  // the features are only queried once per process, so this is cheap enough
+  // to call whenever a kernel is picked.
+  static bool HasFeature(Feature feature);
+
+  // Makes HasFeature() return false for the features in |features|, a
+  // combination of Feature values, or for none if 0. This lets tests run
+  // every kernel the machine supports.
+  static void SetDisabledFeaturesForTesting(int features);
+
  private:
   // Query the processor for CPUID information.
   void Initialize();
@@ -81,6 +110,7 @@ class BASE_EXPORT CPU {
   bool has_avx_;
   bool has_avx2_;
   bool has_aesni_;
+  bool has_sha_;
   bool has_non_stop_time_stamp_counter_;
   bool has_broken_neon_;
   std::string cpu_vendor_;
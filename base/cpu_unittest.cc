@@ -67,6 +67,11 @@ TEST(CPU, RunExtendedInstructions) {
     __asm__ __volatile__("vpunpcklbw %%ymm0, %%ymm0, %%ymm0\n" : : : "xmm0");
   }
 
+  if (cpu.has_sha()) {
+    // Execute a SHA instruction.
+    __asm__ __volatile__("sha1nexte %%xmm0, %%xmm0\n" : : : "xmm0");
+  }
+
 // Visual C 32 bit and ClangCL 32/64 bit test.
 #elif defined(COMPILER_MSVC) && (defined(ARCH_CPU_32_BITS) || \
       (defined(ARCH_CPU_64_BITS) && defined(__clang__)))
@@ -115,3 +120,17 @@ TEST(CPU, RunExtendedInstructions) {
 #endif  // defined(COMPILER_GCC)
 #endif  // defined(ARCH_CPU_X86_FAMILY)
 }
+
+TEST(CPU, HasFeature) {
+  base::CPU cpu;
+  EXPECT_EQ(cpu.has_ssse3(), base::CPU::HasFeature(base::CPU::FEATURE_SSSE3));
+  EXPECT_EQ(cpu.has_sse41(), base::CPU::HasFeature(base::CPU::FEATURE_SSE41));
+  EXPECT_EQ(cpu.has_avx2(), base::CPU::HasFeature(base::CPU::FEATURE_AVX2));
+  EXPECT_EQ(cpu.has_sha(), base::CPU::HasFeature(base::CPU::FEATURE_SHA));
+
+  base::CPU::SetDisabledFeaturesForTesting(base::CPU::FEATURE_AVX2);
+  EXPECT_EQ(cpu.has_ssse3(), base::CPU::HasFeature(base::CPU::FEATURE_SSSE3));
+  EXPECT_FALSE(base::CPU::HasFeature(base::CPU::FEATURE_AVX2));
+  base::CPU::SetDisabledFeaturesForTesting(0);
+  EXPECT_EQ(cpu.has_avx2(), base::CPU::HasFeature(base::CPU::FEATURE_AVX2));
+}
@@ -0,0 +1,44 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Prints the messages of a binary log written by BINARY_LOG() and
+// BINARY_VLOG(); see base/binary_log.h.
+//
+//   decode_binary_log <binary log>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "base/binary_log.h"
+#include "base/command_line.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+
+int main(int argc, char** argv) {
+  base::CommandLine::Init(argc, argv);
+  const base::CommandLine::StringVector& args =
+      base::CommandLine::ForCurrentProcess()->GetArgs();
+  if (args.size() != 1) {
+    fprintf(stderr, "Usage: %s <binary log>\n", argv[0]);
+    return 1;
+  }
+
+  const base::FilePath path(args[0]);
+  std::string data;
+  if (!base::ReadFileToString(path, &data)) {
+    fprintf(stderr, "Could not read %s\n", path.AsUTF8Unsafe().c_str());
+    return 1;
+  }
+
+  std::string text;
+  const bool complete = logging::DecodeBinaryLog(data, &text);
+  fwrite(text.data(), 1, text.size(), stdout);
+  if (!complete) {
+    fprintf(stderr, "%s is not a complete binary log\n",
+            path.AsUTF8Unsafe().c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -81,6 +81,11 @@ class BASE_EXPORT FileEnumerator {
     INCLUDE_DOT_DOT       = 1 << 2,
 #if defined(OS_POSIX)
     SHOW_SYM_LINKS        = 1 << 4,
+    // Only the name and the type of the files are needed: GetInfo() is only
+    // valid for GetName(), IsDirectory() and the type bits of stat().st_mode.
+    // This saves a stat() per file on file systems that report the types of
+    // files along with their names.
+    TYPE_INFO_ONLY        = 1 << 5,
 #endif
   };
 
@@ -134,9 +139,10 @@ class BASE_EXPORT FileEnumerator {
   HANDLE find_handle_;
 #elif defined(OS_POSIX)
 
-  // Read the filenames in source into the vector of DirectoryEntryInfo's
+  // Read the filenames in source into the vector of DirectoryEntryInfo's.
+  // |file_type| is the bit mask of FileType given to the constructor.
   static bool ReadDirectory(std::vector<FileInfo>* entries,
-                            const FilePath& source, bool show_links);
+                            const FilePath& source, int file_type);
 
   // The files in the current directory
   std::vector<FileInfo> directory_entries_;
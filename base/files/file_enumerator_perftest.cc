@@ -0,0 +1,99 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/file_enumerator.h"
+
+#include <string>
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/files/parallel_file_enumerator.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/time/time.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const int kDirectories = 20;
+const int kSubdirectories = 10;
+const int kFiles = 50;
+const int kEntries =
+    kDirectories * (1 + kSubdirectories * (1 + kFiles));
+
+class FileEnumeratorPerfTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    for (int i = 0; i < kDirectories; i++) {
+      const FilePath directory =
+          temp_dir_.path().AppendASCII("dir" + IntToString(i));
+      for (int j = 0; j < kSubdirectories; j++) {
+        const FilePath subdirectory =
+            directory.AppendASCII("subdir" + IntToString(j));
+        ASSERT_TRUE(CreateDirectory(subdirectory));
+        for (int k = 0; k < kFiles; k++) {
+          ASSERT_EQ(0, WriteFile(subdirectory.AppendASCII(
+                                     "file" + IntToString(k)), "", 0));
+        }
+      }
+    }
+  }
+
+  void PrintTimePerEntry(const std::string& trace, TimeTicks start) {
+    const TimeDelta elapsed = TimeTicks::Now() - start;
+    perf_test::PrintResult("time_per_entry", "", trace,
+                           elapsed.InSecondsF() * 1e9 / kEntries, "ns", true);
+  }
+
+  void MeasureFileEnumerator(const std::string& trace, int file_type) {
+    int entries = 0;
+    const TimeTicks start = TimeTicks::Now();
+    FileEnumerator enumerator(temp_dir_.path(), true, file_type);
+    while (!enumerator.Next().empty())
+      entries++;
+    PrintTimePerEntry(trace, start);
+    EXPECT_EQ(kEntries, entries);
+  }
+
+  ScopedTempDir temp_dir_;
+};
+
+void CountEntry(subtle::Atomic32* entries,
+                const FilePath& /* path */,
+                const FileEnumerator::FileInfo& /* info */) {
+  subtle::NoBarrier_AtomicIncrement(entries, 1);
+}
+
+}  // namespace
+
+TEST_F(FileEnumeratorPerfTest, Enumerate) {
+  const int kFileType = FileEnumerator::FILES | FileEnumerator::DIRECTORIES;
+  MeasureFileEnumerator("FileEnumerator", kFileType);
+#if defined(OS_POSIX)
+  MeasureFileEnumerator("FileEnumerator_TYPE_INFO_ONLY",
+                        kFileType | FileEnumerator::TYPE_INFO_ONLY);
+#endif
+
+  const int kThreads[] = {1, 2, 4, 8};
+  for (int num_threads : kThreads) {
+    subtle::Atomic32 entries = 0;
+    const TimeTicks start = TimeTicks::Now();
+    ParallelFileEnumerator enumerator(temp_dir_.path(), kFileType,
+                                      ParallelFileEnumerator::PARENTS_FIRST,
+                                      num_threads);
+    enumerator.Enumerate(Bind(&CountEntry, &entries));
+    PrintTimePerEntry("ParallelFileEnumerator_" + IntToString(num_threads) +
+                          "_threads",
+                      start);
+    EXPECT_EQ(kEntries, entries);
+  }
+}
+
+}  // namespace base
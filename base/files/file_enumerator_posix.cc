@@ -6,15 +6,53 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <fnmatch.h>
 #include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
 
+#include "base/files/scoped_file.h"
 #include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
 #include "base/threading/thread_restrictions.h"
 #include "build/build_config.h"
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <sys/syscall.h>
+
+#include "base/files/dir_reader_linux.h"
+#endif
+
 namespace base {
 
+namespace {
+
+// Returns the file type bits of st_mode for the type |d_type| of a directory
+// entry, or 0 if the type is unknown and the entry needs a stat().
+mode_t ModeFromDirentType(unsigned char d_type) {
+  switch (d_type) {
+    case DT_REG:
+      return S_IFREG;
+    case DT_DIR:
+      return S_IFDIR;
+    case DT_LNK:
+      return S_IFLNK;
+    case DT_FIFO:
+      return S_IFIFO;
+    case DT_SOCK:
+      return S_IFSOCK;
+    case DT_CHR:
+      return S_IFCHR;
+    case DT_BLK:
+      return S_IFBLK;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
 // FileEnumerator::FileInfo ----------------------------------------------------
 
 FileEnumerator::FileInfo::FileInfo() {
@@ -86,16 +124,16 @@ FilePath FileEnumerator::Next() {
     pending_paths_.pop();
 
     std::vector<FileInfo> entries;
-    if (!ReadDirectory(&entries, root_path_, file_type_ & SHOW_SYM_LINKS))
+    if (!ReadDirectory(&entries, root_path_, file_type_))
       continue;
 
     directory_entries_.clear();
     current_directory_entry_ = 0;
     for (std::vector<FileInfo>::const_iterator i = entries.begin();
          i != entries.end(); ++i) {
-      FilePath full_path = root_path_.Append(i->filename_);
-      if (ShouldSkip(full_path))
+      if (ShouldSkip(i->filename_))
         continue;
+      FilePath full_path = root_path_.Append(i->filename_);
 
       if (pattern_.size() &&
           fnmatch(pattern_.c_str(), full_path.value().c_str(), FNM_NOESCAPE))
@@ -119,14 +157,66 @@ FileEnumerator::FileInfo FileEnumerator::GetInfo() const {
 }
 
 bool FileEnumerator::ReadDirectory(std::vector<FileInfo>* entries,
-                                   const FilePath& source, bool show_links) {
+                                   const FilePath& source, int file_type) {
   base::ThreadRestrictions::AssertIOAllowed();
+  const bool show_links = (file_type & SHOW_SYM_LINKS) != 0;
+  const bool type_info_only = (file_type & TYPE_INFO_ONLY) != 0;
+
+  // Adds the entry |name| of the directory |dir_fd|, of type |d_type|, to
+  // |entries|. The entries are stat'ed relative to |dir_fd|, which saves
+  // resolving the path of the directory for each of them.
+  auto add_entry = [&](int dir_fd, const char* name, unsigned char d_type) {
+    entries->push_back(FileInfo());
+    FileInfo& info = entries->back();
+    info.filename_ = FilePath(name);
+
+    const mode_t mode = ModeFromDirentType(d_type);
+    // Without SHOW_SYM_LINKS, the type of a link is the one of its target.
+    if (type_info_only && mode && (show_links || !S_ISLNK(mode))) {
+      info.stat_.st_mode = mode;
+      return;
+    }
+    if (fstatat(dir_fd, name, &info.stat_,
+                show_links ? AT_SYMLINK_NOFOLLOW : 0) < 0) {
+      // Print the stat() error message unless it was ENOENT and we're
+      // following symlinks.
+      if (!(errno == ENOENT && !show_links)) {
+        DPLOG(ERROR) << "Couldn't stat " << source.Append(name).value();
+      }
+      memset(&info.stat_, 0, sizeof(info.stat_));
+    }
+  };
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  ScopedFD dir_fd(HANDLE_EINTR(
+      open(source.value().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+  if (!dir_fd.is_valid())
+    return false;
+
+  // The records are read straight into a buffer on the stack, without the
+  // allocation of a DIR and the copy of each record made by readdir_r().
+  uint64_t buffer[1024];
+  for (;;) {
+    const long size = HANDLE_EINTR(
+        syscall(__NR_getdents64, dir_fd.get(), buffer, sizeof(buffer)));
+    if (size <= 0) {
+      DPLOG_IF(ERROR, size < 0) << "Couldn't read " << source.value();
+      break;
+    }
+    const char* records = reinterpret_cast<const char*>(buffer);
+    for (long offset = 0; offset < size;) {
+      const linux_dirent* dent =
+          reinterpret_cast<const linux_dirent*>(records + offset);
+      add_entry(dir_fd.get(), dent->d_name, dent->d_type);
+      offset += dent->d_reclen;
+    }
+  }
+#else
   DIR* dir = opendir(source.value().c_str());
   if (!dir)
     return false;
 
-#if !defined(OS_LINUX) && !defined(OS_MACOSX) && !defined(OS_BSD) && \
-    !defined(OS_SOLARIS) && !defined(OS_ANDROID)
+#if !defined(OS_MACOSX) && !defined(OS_BSD) && !defined(OS_SOLARIS)
   #error Port warning: depending on the definition of struct dirent, \
          additional space for pathname may be needed
 #endif
@@ -134,28 +224,15 @@ bool FileEnumerator::ReadDirectory(std::vector<FileInfo>* entries,
   struct dirent dent_buf;
   struct dirent* dent;
   while (readdir_r(dir, &dent_buf, &dent) == 0 && dent) {
-    FileInfo info;
-    info.filename_ = FilePath(dent->d_name);
-
-    FilePath full_name = source.Append(dent->d_name);
-    int ret;
-    if (show_links)
-      ret = lstat(full_name.value().c_str(), &info.stat_);
-    else
-      ret = stat(full_name.value().c_str(), &info.stat_);
-    if (ret < 0) {
-      // Print the stat() error message unless it was ENOENT and we're
-      // following symlinks.
-      if (!(errno == ENOENT && !show_links)) {
-        DPLOG(ERROR) << "Couldn't stat "
-                     << source.Append(dent->d_name).value();
-      }
-      memset(&info.stat_, 0, sizeof(info.stat_));
-    }
-    entries->push_back(info);
+#if defined(OS_SOLARIS)
+    add_entry(dirfd(dir), dent->d_name, DT_UNKNOWN);
+#else
+    add_entry(dirfd(dir), dent->d_name, dent->d_type);
+#endif
   }
 
   closedir(dir);
+#endif
   return true;
 }
 
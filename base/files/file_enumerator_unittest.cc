@@ -0,0 +1,99 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/file_enumerator.h"
+
+#include <map>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+class FileEnumeratorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    root_ = temp_dir_.path();
+    ASSERT_TRUE(CreateDirectory(root_.AppendASCII("dir")));
+    ASSERT_EQ(3, WriteFile(root_.AppendASCII("a"), "abc", 3));
+    ASSERT_EQ(5, WriteFile(root_.AppendASCII("dir").AppendASCII("b"),
+                           "abcde", 5));
+  }
+
+  // Returns the entries found by a FileEnumerator, with their info.
+  std::map<FilePath, FileEnumerator::FileInfo> Enumerate(int file_type) {
+    std::map<FilePath, FileEnumerator::FileInfo> entries;
+    FileEnumerator enumerator(root_, true, file_type);
+    for (FilePath path = enumerator.Next(); !path.empty();
+         path = enumerator.Next()) {
+      EXPECT_EQ(path.BaseName(), enumerator.GetInfo().GetName());
+      entries[path] = enumerator.GetInfo();
+    }
+    return entries;
+  }
+
+  ScopedTempDir temp_dir_;
+  FilePath root_;
+};
+
+}  // namespace
+
+TEST_F(FileEnumeratorTest, Recursive) {
+  std::map<FilePath, FileEnumerator::FileInfo> entries =
+      Enumerate(FileEnumerator::FILES | FileEnumerator::DIRECTORIES);
+  ASSERT_EQ(3u, entries.size());
+  EXPECT_FALSE(entries[root_.AppendASCII("a")].IsDirectory());
+  EXPECT_EQ(3, entries[root_.AppendASCII("a")].GetSize());
+  EXPECT_TRUE(entries[root_.AppendASCII("dir")].IsDirectory());
+  EXPECT_EQ(5, entries[root_.AppendASCII("dir").AppendASCII("b")].GetSize());
+
+  EXPECT_EQ(2u, Enumerate(FileEnumerator::FILES).size());
+  EXPECT_EQ(1u, Enumerate(FileEnumerator::DIRECTORIES).size());
+}
+
+#if defined(OS_POSIX)
+
+TEST_F(FileEnumeratorTest, TypeInfoOnly) {
+  std::map<FilePath, FileEnumerator::FileInfo> entries =
+      Enumerate(FileEnumerator::FILES | FileEnumerator::DIRECTORIES |
+                FileEnumerator::TYPE_INFO_ONLY);
+  ASSERT_EQ(3u, entries.size());
+  EXPECT_FALSE(entries[root_.AppendASCII("a")].IsDirectory());
+  EXPECT_TRUE(S_ISREG(entries[root_.AppendASCII("a")].stat().st_mode));
+  EXPECT_TRUE(entries[root_.AppendASCII("dir")].IsDirectory());
+  EXPECT_FALSE(
+      entries[root_.AppendASCII("dir").AppendASCII("b")].IsDirectory());
+}
+
+TEST_F(FileEnumeratorTest, SymbolicLinks) {
+  ASSERT_TRUE(CreateSymbolicLink(root_.AppendASCII("dir"),
+                                 root_.AppendASCII("link")));
+  const FilePath link_path = root_.AppendASCII("link");
+  const int kTypeInfo[] = {0, FileEnumerator::TYPE_INFO_ONLY};
+  for (int type_info : kTypeInfo) {
+    // Links are followed, to the target of the link.
+    std::map<FilePath, FileEnumerator::FileInfo> entries = Enumerate(
+        FileEnumerator::FILES | FileEnumerator::DIRECTORIES | type_info);
+    EXPECT_EQ(5u, entries.size());
+    EXPECT_TRUE(entries[link_path].IsDirectory());
+    EXPECT_EQ(1u, entries.count(link_path.AppendASCII("b")));
+
+    // Unless they are shown as links.
+    entries = Enumerate(FileEnumerator::FILES | FileEnumerator::DIRECTORIES |
+                        FileEnumerator::SHOW_SYM_LINKS | type_info);
+    EXPECT_EQ(4u, entries.size());
+    EXPECT_TRUE(S_ISLNK(entries[link_path].stat().st_mode));
+    EXPECT_FALSE(entries[link_path].IsDirectory());
+  }
+}
+
+#endif  // defined(OS_POSIX)
+
+}  // namespace base
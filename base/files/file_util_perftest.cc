@@ -0,0 +1,73 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/file_util.h"
+
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+class FileUtilPerfTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+  }
+
+  ScopedTempDir temp_dir_;
+};
+
+}  // namespace
+
+TEST_F(FileUtilPerfTest, CopyFile) {
+  const int kSize = 64 * 1024 * 1024;
+  const FilePath from = temp_dir_.path().AppendASCII("from");
+  const std::string data(kSize, 'x');
+  ASSERT_EQ(kSize, WriteFile(from, data.data(), kSize));
+
+  const int kCopies = 5;
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kCopies; i++) {
+    ASSERT_TRUE(CopyFile(from, temp_dir_.path().AppendASCII(
+                                   "to" + IntToString(i))));
+  }
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  perf_test::PrintResult("copy_throughput", "", "CopyFile_64MB",
+                         kCopies * (kSize / (1024.0 * 1024)) /
+                             elapsed.InSecondsF(),
+                         "MB/s", true);
+}
+
+TEST_F(FileUtilPerfTest, CopyDirectory) {
+  const int kDirectories = 20;
+  const int kFiles = 100;
+  const FilePath from = temp_dir_.path().AppendASCII("from");
+  const std::string data(16 * 1024, 'x');
+  for (int i = 0; i < kDirectories; i++) {
+    const FilePath directory = from.AppendASCII("dir" + IntToString(i));
+    ASSERT_TRUE(CreateDirectory(directory));
+    for (int j = 0; j < kFiles; j++) {
+      ASSERT_EQ(static_cast<int>(data.size()),
+                WriteFile(directory.AppendASCII("file" + IntToString(j)),
+                          data.data(), static_cast<int>(data.size())));
+    }
+  }
+
+  const TimeTicks start = TimeTicks::Now();
+  ASSERT_TRUE(CopyDirectory(from, temp_dir_.path().AppendASCII("to"), true));
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  perf_test::PrintResult("time_per_file", "", "CopyDirectory_16KB_files",
+                         elapsed.InSecondsF() * 1e6 / (kDirectories * kFiles),
+                         "us", true);
+}
+
+}  // namespace base
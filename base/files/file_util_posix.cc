@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/errno.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/stat.h>
@@ -22,8 +23,15 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/bind.h"
 #include "base/files/file_enumerator.h"
 #include "base/files/file_path.h"
+#include "base/files/parallel_file_enumerator.h"
 #include "base/files/scoped_file.h"
 #include "base/logging.h"
 #include "base/macros.h"
@@ -45,6 +53,15 @@
 #include "base/mac/foundation_util.h"
 #endif
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+
+#if !defined(FICLONE)
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif
+
 #if defined(OS_ANDROID)
 #include "base/android/content_uri_utils.h"
 #include "base/os_compat_android.h"
@@ -182,6 +199,243 @@ bool DetermineDevShmExecutable() {
   return result;
 }
 #endif  // defined(OS_LINUX)
+
+#if !defined(OS_MACOSX)
+// Copies the data of a file to another, in the fastest way the kernel and the
+// file systems support.
+class FileCopier {
+ public:
+  // |infile| and |outfile| must be at their start, and |outfile| empty.
+  FileCopier(File* infile, File* outfile)
+      : infile_(infile), outfile_(outfile), method_(kFastestMethod) {}
+
+  // Returns false on error.
+  bool Copy();
+
+ private:
+  // The ways to copy data, from the fastest to the most widely supported.
+  // Each falls back to the next when the files do not support it. The
+  // seccomp policies of Android do not allow copy_file_range().
+  enum Method {
+    // Copies in the kernel, and lets the file system share the data between
+    // the files, or copy it on the storage device.
+    COPY_FILE_RANGE,
+
+    // Copies in the kernel, from the page cache of a file to another.
+    SENDFILE,
+
+    // Copies through a buffer.
+    READ_WRITE,
+  };
+
+#if defined(OS_LINUX)
+  static const Method kFastestMethod = COPY_FILE_RANGE;
+#elif defined(OS_ANDROID)
+  static const Method kFastestMethod = SENDFILE;
+#else
+  static const Method kFastestMethod = READ_WRITE;
+#endif
+
+  // Copies the data at [|offset|, |end|) of |infile_| to the same offset of
+  // |outfile_|, or up to the end of |infile_| if |end| is -1.
+  bool CopyRange(int64_t offset, int64_t end);
+
+  // Copies up to |length| bytes at |offset|. Returns the number of bytes
+  // copied, 0 at the end of |infile_|, or -1 on error.
+  int64_t CopyChunk(int64_t offset, int64_t length);
+
+  // Copies from the current position of |infile_| to its end, for files that
+  // cannot be read at an offset, or whose size is not known.
+  bool CopySequentially();
+
+  File* const infile_;
+  File* const outfile_;
+  Method method_;
+  std::vector<char> buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileCopier);
+};
+
+bool FileCopier::Copy() {
+  const int in_fd = infile_->GetPlatformFile();
+  struct stat in_stat;
+  if (fstat(in_fd, &in_stat) != 0 || !S_ISREG(in_stat.st_mode) ||
+      in_stat.st_size == 0) {
+    // E.g. pipes, or the files of /proc, which have a size of 0.
+    return CopySequentially();
+  }
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#if defined(OS_LINUX)
+  // A clone shares the data of the files until either is written, on file
+  // systems like Btrfs and XFS.
+  if (ioctl(outfile_->GetPlatformFile(), FICLONE, in_fd) == 0)
+    return true;
+#endif
+
+  // A file with fewer blocks than its size has holes, which are kept in the
+  // copy by only copying the data around them.
+  if (in_stat.st_blocks * 512 < in_stat.st_size) {
+    int64_t offset = 0;
+    for (;;) {
+      const off64_t data = lseek64(in_fd, offset, SEEK_DATA);
+      if (data < 0) {
+        if (errno != ENXIO)  // SEEK_DATA is not supported.
+          return CopyRange(offset, -1);
+        break;  // The rest of the file is a hole.
+      }
+      const off64_t hole = lseek64(in_fd, data, SEEK_HOLE);
+      if (hole < 0)
+        return CopyRange(data, -1);
+      if (!CopyRange(data, hole))
+        return false;
+      offset = hole;
+    }
+    const off64_t size = lseek64(in_fd, 0, SEEK_END);
+    return size >= 0 && outfile_->SetLength(size);
+  }
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
+  return CopyRange(0, -1);
+}
+
+bool FileCopier::CopyRange(int64_t offset, int64_t end) {
+  const int64_t kMaxChunkSize = 1 << 30;
+  while (end < 0 || offset < end) {
+    const int64_t length =
+        end < 0 ? kMaxChunkSize : std::min(end - offset, kMaxChunkSize);
+    const int64_t copied = CopyChunk(offset, length);
+    if (copied < 0)
+      return false;
+    if (copied == 0)
+      break;
+    offset += copied;
+  }
+  return true;
+}
+
+int64_t FileCopier::CopyChunk(int64_t offset, int64_t length) {
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  const int in_fd = infile_->GetPlatformFile();
+  const int out_fd = outfile_->GetPlatformFile();
+  if (method_ == COPY_FILE_RANGE) {
+#if defined(__NR_copy_file_range)
+    loff_t in_offset = offset;
+    loff_t out_offset = offset;
+    const ssize_t copied = HANDLE_EINTR(
+        syscall(__NR_copy_file_range, in_fd, &in_offset, out_fd, &out_offset,
+                static_cast<size_t>(length), 0u));
+    // Older kernels do not have the call, or do not copy between different
+    // file systems, and some file systems do not support it.
+    if (copied >= 0 ||
+        (errno != ENOSYS && errno != EXDEV && errno != EINVAL &&
+         errno != EOPNOTSUPP)) {
+      return copied;
+    }
+#endif
+    method_ = SENDFILE;
+  }
+  if (method_ == SENDFILE) {
+    off64_t in_offset = offset;
+    if (lseek64(out_fd, offset, SEEK_SET) == offset) {
+      const ssize_t copied = HANDLE_EINTR(
+          sendfile64(out_fd, in_fd, &in_offset, static_cast<size_t>(length)));
+      if (copied >= 0 || (errno != ENOSYS && errno != EINVAL))
+        return copied;
+    }
+    method_ = READ_WRITE;
+  }
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
+  const size_t kBufferSize = 1 << 20;
+  buffer_.resize(kBufferSize);
+  const int bytes_read = infile_->Read(
+      offset, &buffer_[0],
+      static_cast<int>(std::min(length, static_cast<int64_t>(kBufferSize))));
+  if (bytes_read <= 0)
+    return bytes_read;
+  if (outfile_->Write(offset, &buffer_[0], bytes_read) != bytes_read)
+    return -1;
+  return bytes_read;
+}
+
+bool FileCopier::CopySequentially() {
+  const size_t kBufferSize = 32768;
+  buffer_.resize(kBufferSize);
+  bool result = true;
+
+  while (result) {
+    ssize_t bytes_read = infile_->ReadAtCurrentPos(&buffer_[0], buffer_.size());
+    if (bytes_read < 0) {
+      result = false;
+      break;
+    }
+    if (bytes_read == 0)
+      break;
+    // Allow for partial writes
+    ssize_t bytes_written_per_read = 0;
+    do {
+      ssize_t bytes_written_partial =
+          outfile_->WriteAtCurrentPos(&buffer_[bytes_written_per_read],
+                                      bytes_read - bytes_written_per_read);
+      if (bytes_written_partial < 0) {
+        result = false;
+        break;
+      }
+      bytes_written_per_read += bytes_written_partial;
+    } while (bytes_written_per_read < bytes_read);
+  }
+
+  return result;
+}
+#endif  // !defined(OS_MACOSX)
+
+// Trees with fewer entries than this are copied by CopyDirectory() on the
+// calling thread, as starting the threads would cost more than they save.
+const size_t kMinEntriesForParallelCopy = 64;
+
+// Copies |from_path|, an entry of the tree being copied by CopyDirectory(),
+// to |target_path|. Returns false on error.
+bool CopyDirectoryEntry(const FilePath& from_path,
+                        const struct stat& from_stat,
+                        const FilePath& target_path) {
+  if (S_ISDIR(from_stat.st_mode)) {
+    if (mkdir(target_path.value().c_str(),
+              (from_stat.st_mode & 01777) | S_IRUSR | S_IXUSR | S_IWUSR) !=
+            0 &&
+        errno != EEXIST) {
+      DLOG(ERROR) << "CopyDirectory() couldn't create directory: "
+                  << target_path.value() << " errno = " << errno;
+      return false;
+    }
+  } else if (S_ISREG(from_stat.st_mode)) {
+    if (!CopyFile(from_path, target_path)) {
+      DLOG(ERROR) << "CopyDirectory() couldn't create file: "
+                  << target_path.value();
+      return false;
+    }
+  } else {
+    DLOG(WARNING) << "CopyDirectory() skipping non-regular file: "
+                  << from_path.value();
+  }
+  return true;
+}
+
+// Copies an entry found by the ParallelFileEnumerator of CopyDirectory(),
+// unless copying an earlier one failed. Runs on several threads at once.
+void CopyEnumeratedEntry(const FilePath& from_path_base,
+                         const FilePath& to_path,
+                         subtle::Atomic32* failed,
+                         const FilePath& from_path,
+                         const FileEnumerator::FileInfo& info) {
+  if (subtle::NoBarrier_Load(failed))
+    return;
+  FilePath target_path(to_path);
+  if (!from_path_base.AppendRelativePath(from_path, &target_path) ||
+      !CopyDirectoryEntry(from_path, info.stat(), target_path)) {
+    subtle::NoBarrier_Store(failed, 1);
+  }
+}
 #endif  // !defined(OS_NACL_NONSFI)
 
 }  // namespace
@@ -219,7 +473,7 @@ bool DeleteFile(const FilePath& path, bool recursive) {
   directories.push(path.value());
   FileEnumerator traversal(path, true,
       FileEnumerator::FILES | FileEnumerator::DIRECTORIES |
-      FileEnumerator::SHOW_SYM_LINKS);
+      FileEnumerator::SHOW_SYM_LINKS | FileEnumerator::TYPE_INFO_ONLY);
   for (FilePath current = traversal.Next(); success && !current.empty();
        current = traversal.Next()) {
     if (traversal.GetInfo().IsDirectory())
@@ -281,15 +535,9 @@ bool CopyDirectory(const FilePath& from_path,
     return false;
   }
 
-  int traverse_type = FileEnumerator::FILES | FileEnumerator::SHOW_SYM_LINKS;
-  if (recursive)
-    traverse_type |= FileEnumerator::DIRECTORIES;
-  FileEnumerator traversal(from_path, recursive, traverse_type);
-
   // We have to mimic windows behavior here. |to_path| may not exist yet,
-  // start the loop with |to_path|.
+  // start with |to_path|.
   struct stat from_stat;
-  FilePath current = from_path;
   if (stat(from_path.value().c_str(), &from_stat) < 0) {
     DLOG(ERROR) << "CopyDirectory() couldn't stat source directory: "
                 << from_path.value() << " errno = " << errno;
@@ -309,44 +557,67 @@ bool CopyDirectory(const FilePath& from_path,
   // TODO(maruel): This is not necessary anymore.
   DCHECK(recursive || S_ISDIR(from_stat.st_mode));
 
-  bool success = true;
-  while (success && !current.empty()) {
-    // current is the source path, including from_path, so append
-    // the suffix after from_path to to_path to create the target_path.
-    FilePath target_path(to_path);
-    if (from_path_base != current) {
-      if (!from_path_base.AppendRelativePath(current, &target_path)) {
-        success = false;
-        break;
-      }
-    }
+  FilePath target_path(to_path);
+  if (from_path_base != from_path &&
+      !from_path_base.AppendRelativePath(from_path, &target_path)) {
+    return false;
+  }
+  if (!CopyDirectoryEntry(from_path, from_stat, target_path))
+    return false;
+  if (!S_ISDIR(from_stat.st_mode))
+    return true;
 
-    if (S_ISDIR(from_stat.st_mode)) {
-      if (mkdir(target_path.value().c_str(),
-                (from_stat.st_mode & 01777) | S_IRUSR | S_IXUSR | S_IWUSR) !=
-              0 &&
-          errno != EEXIST) {
-        DLOG(ERROR) << "CopyDirectory() couldn't create directory: "
-                    << target_path.value() << " errno = " << errno;
-        success = false;
+  if (recursive) {
+    // The first entries are enumerated on this thread, which then copies them
+    // if that is the whole tree. FileEnumerator, like PARENTS_FIRST below,
+    // returns each directory before the entries in it.
+    const int file_type = FileEnumerator::FILES |
+                          FileEnumerator::DIRECTORIES |
+                          FileEnumerator::SHOW_SYM_LINKS;
+    std::vector<std::pair<FilePath, struct stat>> entries;
+    FileEnumerator traversal(from_path, true, file_type);
+    for (FilePath current = traversal.Next(); !current.empty();
+         current = traversal.Next()) {
+      if (entries.size() + 1 < kMinEntriesForParallelCopy) {
+        entries.push_back(std::make_pair(current, traversal.GetInfo().stat()));
+        continue;
       }
-    } else if (S_ISREG(from_stat.st_mode)) {
-      if (!CopyFile(current, target_path)) {
-        DLOG(ERROR) << "CopyDirectory() couldn't create file: "
-                    << target_path.value();
-        success = false;
+      // The files of a larger tree are copied on several threads, which keeps
+      // the storage busier than one copy at a time. It is enumerated again
+      // from the start, as the entries above are not copied yet.
+      subtle::Atomic32 failed = 0;
+      ParallelFileEnumerator enumerator(
+          from_path, file_type, ParallelFileEnumerator::PARENTS_FIRST,
+          std::min(SysInfo::NumberOfProcessors(), 8));
+      enumerator.Enumerate(
+          Bind(&CopyEnumeratedEntry, from_path_base, to_path, &failed));
+      return !failed;
+    }
+    for (const auto& entry : entries) {
+      target_path = to_path;
+      if (!from_path_base.AppendRelativePath(entry.first, &target_path) ||
+          !CopyDirectoryEntry(entry.first, entry.second, target_path)) {
+        return false;
       }
-    } else {
-      DLOG(WARNING) << "CopyDirectory() skipping non-regular file: "
-                    << current.value();
     }
-
-    current = traversal.Next();
-    if (!current.empty())
-      from_stat = traversal.GetInfo().stat();
+    return true;
   }
 
-  return success;
+  FileEnumerator traversal(from_path, false,
+                           FileEnumerator::FILES |
+                               FileEnumerator::SHOW_SYM_LINKS);
+  for (FilePath current = traversal.Next(); !current.empty();
+       current = traversal.Next()) {
+    // current is the source path, including from_path, so append
+    // the suffix after from_path to to_path to create the target_path.
+    target_path = to_path;
+    if (!from_path_base.AppendRelativePath(current, &target_path) ||
+        !CopyDirectoryEntry(current, traversal.GetInfo().stat(),
+                            target_path)) {
+      return false;
+    }
+  }
+  return true;
 }
 #endif  // !defined(OS_NACL_NONSFI)
 
@@ -876,32 +1147,7 @@ bool CopyFile(const FilePath& from_path, const FilePath& to_path) {
   if (!outfile.IsValid())
     return false;
 
-  const size_t kBufferSize = 32768;
-  std::vector<char> buffer(kBufferSize);
-  bool result = true;
-
-  while (result) {
-    ssize_t bytes_read = infile.ReadAtCurrentPos(&buffer[0], buffer.size());
-    if (bytes_read < 0) {
-      result = false;
-      break;
-    }
-    if (bytes_read == 0)
-      break;
-    // Allow for partial writes
-    ssize_t bytes_written_per_read = 0;
-    do {
-      ssize_t bytes_written_partial = outfile.WriteAtCurrentPos(
-          &buffer[bytes_written_per_read], bytes_read - bytes_written_per_read);
-      if (bytes_written_partial < 0) {
-        result = false;
-        break;
-      }
-      bytes_written_per_read += bytes_written_partial;
-    } while (bytes_written_per_read < bytes_read);
-  }
-
-  return result;
+  return FileCopier(&infile, &outfile).Copy();
 }
 #endif  // !defined(OS_MACOSX)
 
@@ -0,0 +1,180 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/file_util.h"
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/string_number_conversions.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+#if defined(OS_POSIX)
+#include <sys/stat.h>
+#endif
+
+namespace base {
+
+namespace {
+
+class FileUtilTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+  }
+
+  FilePath TempPath(const std::string& name) {
+    return temp_dir_.path().AppendASCII(name);
+  }
+
+  ScopedTempDir temp_dir_;
+};
+
+// Returns |size| bytes which are unlikely to repeat with a short period.
+std::string MakeData(size_t size) {
+  std::string data(size, '\0');
+  uint32_t state = 1;
+  for (char& c : data) {
+    state = state * 1103515245 + 12345;
+    c = static_cast<char>(state >> 24);
+  }
+  return data;
+}
+
+std::string ReadFile(const FilePath& path) {
+  std::string data;
+  EXPECT_TRUE(ReadFileToString(path, &data));
+  return data;
+}
+
+}  // namespace
+
+TEST_F(FileUtilTest, CopyFile) {
+  const size_t kSizes[] = {0, 1, 4096, 3 * 1024 * 1024 + 7};
+  for (size_t size : kSizes) {
+    const std::string data = MakeData(size);
+    const FilePath from = TempPath("from" + SizeTToString(size));
+    const FilePath to = TempPath("to" + SizeTToString(size));
+    ASSERT_EQ(static_cast<int>(size),
+              WriteFile(from, data.data(), static_cast<int>(size)));
+    ASSERT_TRUE(CopyFile(from, to));
+    EXPECT_EQ(data, ReadFile(to));
+
+    // Copying over a longer file replaces it.
+    ASSERT_TRUE(WriteFile(to, "0123456789abcdef", 16));
+    ASSERT_TRUE(CopyFile(from, to));
+    EXPECT_EQ(data, ReadFile(to));
+  }
+
+  EXPECT_FALSE(CopyFile(TempPath("missing"), TempPath("to")));
+}
+
+#if defined(OS_LINUX)
+TEST_F(FileUtilTest, CopyFileOfUnknownSize) {
+  // The files of /proc have a size of 0, but are not empty.
+  const FilePath to = TempPath("status");
+  ASSERT_TRUE(CopyFile(FilePath("/proc/self/status"), to));
+  EXPECT_NE(std::string::npos, ReadFile(to).find("Pid:"));
+}
+#endif
+
+#if defined(OS_POSIX)
+TEST_F(FileUtilTest, CopyFileKeepsHoles) {
+  const int64_t kSize = 64 * 1024 * 1024;
+  const int64_t kDataOffset = 16 * 1024 * 1024;
+  const std::string data = MakeData(4096);
+  const FilePath from = TempPath("sparse");
+  {
+    File file(from, File::FLAG_CREATE | File::FLAG_WRITE);
+    ASSERT_TRUE(file.IsValid());
+    ASSERT_TRUE(file.SetLength(kSize));
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file.Write(kDataOffset, data.data(),
+                         static_cast<int>(data.size())));
+  }
+
+  const FilePath to = TempPath("copy");
+  ASSERT_TRUE(CopyFile(from, to));
+  const std::string copy = ReadFile(to);
+  ASSERT_EQ(static_cast<size_t>(kSize), copy.size());
+  EXPECT_EQ(data, copy.substr(kDataOffset, data.size()));
+  EXPECT_EQ(std::string(kDataOffset, '\0'), copy.substr(0, kDataOffset));
+  EXPECT_EQ(std::string(kSize - kDataOffset - data.size(), '\0'),
+            copy.substr(kDataOffset + data.size()));
+
+  struct stat from_stat;
+  struct stat to_stat;
+  ASSERT_EQ(0, stat(from.value().c_str(), &from_stat));
+  ASSERT_EQ(0, stat(to.value().c_str(), &to_stat));
+  // The holes are kept where the file system supports them.
+  if (from_stat.st_blocks * 512 < kSize / 2) {
+    EXPECT_LT(to_stat.st_blocks * 512, kSize / 2);
+  }
+}
+#endif  // defined(OS_POSIX)
+
+TEST_F(FileUtilTest, CopyDirectoryRecursively) {
+  const FilePath from = TempPath("from");
+  ASSERT_TRUE(CreateDirectory(from.AppendASCII("a").AppendASCII("b")));
+  ASSERT_TRUE(CreateDirectory(from.AppendASCII("empty")));
+  // Enough files for the whole tree to be copied in parallel, but not "a".
+  for (int i = 0; i < 30; i++) {
+    const std::string name = "file" + IntToString(i);
+    const std::string data = MakeData(i * 1000);
+    const FilePath directories[] = {
+        from, from.AppendASCII("a"), from.AppendASCII("a").AppendASCII("b")};
+    for (const FilePath& directory : directories) {
+      ASSERT_EQ(static_cast<int>(data.size()),
+                WriteFile(directory.AppendASCII(name), data.data(),
+                          static_cast<int>(data.size())));
+    }
+  }
+
+  // The destination does not exist: it becomes the copy.
+  const FilePath to = TempPath("to");
+  ASSERT_TRUE(CopyDirectory(from, to, true));
+  EXPECT_TRUE(DirectoryExists(to.AppendASCII("empty")));
+  for (int i = 0; i < 30; i++) {
+    const std::string name = "file" + IntToString(i);
+    const std::string data = MakeData(i * 1000);
+    EXPECT_EQ(data, ReadFile(to.AppendASCII(name)));
+    EXPECT_EQ(data, ReadFile(to.AppendASCII("a").AppendASCII(name)));
+    EXPECT_EQ(data, ReadFile(to.AppendASCII("a").AppendASCII("b")
+                                 .AppendASCII(name)));
+  }
+
+  // The destination exists: the copy goes in it.
+  ASSERT_TRUE(CopyDirectory(from.AppendASCII("a"), to, true));
+  EXPECT_EQ(MakeData(1000),
+            ReadFile(to.AppendASCII("a").AppendASCII("b").AppendASCII(
+                "file1")));
+  EXPECT_EQ(MakeData(29000), ReadFile(to.AppendASCII("a").AppendASCII(
+                                 "file29")));
+  ASSERT_TRUE(CopyDirectory(from, to.AppendASCII("empty"), true));
+  EXPECT_EQ(MakeData(1000),
+            ReadFile(to.AppendASCII("empty").AppendASCII("from").AppendASCII(
+                "file1")));
+
+  // A destination in the source is refused.
+  EXPECT_FALSE(CopyDirectory(from, from.AppendASCII("a"), true));
+}
+
+TEST_F(FileUtilTest, CopyDirectoryNotRecursively) {
+  const FilePath from = TempPath("from");
+  ASSERT_TRUE(CreateDirectory(from.AppendASCII("a")));
+  ASSERT_EQ(1, WriteFile(from.AppendASCII("file"), "x", 1));
+  ASSERT_EQ(1, WriteFile(from.AppendASCII("a").AppendASCII("file"), "y", 1));
+
+  const FilePath to = TempPath("to");
+  ASSERT_TRUE(CopyDirectory(from, to, false));
+  EXPECT_EQ("x", ReadFile(to.AppendASCII("file")));
+  EXPECT_FALSE(PathExists(to.AppendASCII("a")));
+}
+
+}  // namespace base
@@ -0,0 +1,127 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/parallel_file_enumerator.h"
+
+#include "base/atomic_ref_count.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+
+namespace base {
+
+struct ParallelFileEnumerator::Directory {
+  Directory(const FilePath& path,
+            const FileEnumerator::FileInfo& info,
+            Directory* parent)
+      : path(path), info(info), parent(parent), pending(1) {}
+
+  const FilePath path;
+  const FileEnumerator::FileInfo info;
+
+  // The directory containing this one, or null for the root.
+  Directory* const parent;
+
+  // One while this directory is being read, plus the number of its
+  // subdirectories which are not done yet.
+  AtomicRefCount pending;
+};
+
+ParallelFileEnumerator::ParallelFileEnumerator(const FilePath& root_path,
+                                               int file_type,
+                                               Order order,
+                                               int num_threads)
+    : root_path_(root_path.StripTrailingSeparators()),
+      file_type_(file_type),
+      order_(order),
+      num_threads_(num_threads),
+      directories_queued_(&lock_),
+      pending_directories_(0) {
+  DCHECK(!(file_type_ & FileEnumerator::INCLUDE_DOT_DOT));
+  DCHECK_GT(num_threads_, 0);
+}
+
+ParallelFileEnumerator::~ParallelFileEnumerator() {
+  DCHECK(queued_directories_.empty());
+}
+
+void ParallelFileEnumerator::Enumerate(const Visitor& visitor) {
+  DCHECK(visitor_.is_null());
+  visitor_ = visitor;
+  {
+    AutoLock lock(lock_);
+    queued_directories_.push_back(
+        new Directory(root_path_, FileEnumerator::FileInfo(), nullptr));
+    pending_directories_ = 1;
+  }
+
+  std::vector<scoped_ptr<DelegateSimpleThread>> threads;
+  for (int i = 1; i < num_threads_; i++) {
+    threads.push_back(make_scoped_ptr(
+        new DelegateSimpleThread(this, "ParallelFileEnumerator")));
+    threads.back()->Start();
+  }
+  Run();
+  for (const auto& thread : threads)
+    thread->Join();
+}
+
+void ParallelFileEnumerator::Run() {
+  for (;;) {
+    Directory* directory;
+    {
+      AutoLock lock(lock_);
+      while (queued_directories_.empty() && pending_directories_ > 0)
+        directories_queued_.Wait();
+      if (queued_directories_.empty())
+        return;
+      directory = queued_directories_.back();
+      queued_directories_.pop_back();
+    }
+    ReadDirectory(directory);
+  }
+}
+
+void ParallelFileEnumerator::ReadDirectory(Directory* directory) {
+  // The subdirectories are needed even when only files are visited.
+  FileEnumerator enumerator(directory->path, false,
+                            file_type_ | FileEnumerator::DIRECTORIES);
+  std::vector<Directory*> subdirectories;
+  for (FilePath path = enumerator.Next(); !path.empty();
+       path = enumerator.Next()) {
+    FileEnumerator::FileInfo info = enumerator.GetInfo();
+    if (info.IsDirectory()) {
+      if (order_ == PARENTS_FIRST && (file_type_ & FileEnumerator::DIRECTORIES))
+        visitor_.Run(path, info);
+      subdirectories.push_back(new Directory(path, info, directory));
+    } else if (file_type_ & FileEnumerator::FILES) {
+      visitor_.Run(path, info);
+    }
+  }
+
+  // The subdirectories are accounted for before any of them can be done.
+  AtomicRefCountIncN(&directory->pending,
+                     static_cast<AtomicRefCount>(subdirectories.size()));
+  DirectoryDone(directory);
+
+  AutoLock lock(lock_);
+  queued_directories_.insert(queued_directories_.end(),
+                             subdirectories.begin(), subdirectories.end());
+  pending_directories_ += static_cast<int>(subdirectories.size()) - 1;
+  if (!subdirectories.empty() || pending_directories_ == 0)
+    directories_queued_.Broadcast();
+}
+
+void ParallelFileEnumerator::DirectoryDone(Directory* directory) {
+  while (directory && !AtomicRefCountDec(&directory->pending)) {
+    Directory* parent = directory->parent;
+    if (order_ == CHILDREN_FIRST && parent &&
+        (file_type_ & FileEnumerator::DIRECTORIES)) {
+      visitor_.Run(directory->path, directory->info);
+    }
+    delete directory;
+    directory = parent;
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,100 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_FILES_PARALLEL_FILE_ENUMERATOR_H_
+#define BASE_FILES_PARALLEL_FILE_ENUMERATOR_H_
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/callback.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/simple_thread.h"
+
+namespace base {
+
+// Enumerates a directory tree recursively on several threads. Each directory
+// is read by one of the threads with a FileEnumerator, and its subdirectories
+// are queued for any of the threads to read. This pays off on large trees,
+// whose enumeration is mostly spent waiting for the file system.
+//
+// Example:
+//   ParallelFileEnumerator enumerator(
+//       path, FileEnumerator::FILES, ParallelFileEnumerator::PARENTS_FIRST, 8);
+//   enumerator.Enumerate(Bind(&CountFile, &count));
+class BASE_EXPORT ParallelFileEnumerator
+    : private DelegateSimpleThread::Delegate {
+ public:
+  // The order in which a directory and the entries below it are visited.
+  // Other entries are visited in no particular order.
+  enum Order {
+    // A directory is visited before the entries below it, e.g. to copy the
+    // tree.
+    PARENTS_FIRST,
+
+    // A directory is visited after all the entries below it, e.g. to delete
+    // the tree.
+    CHILDREN_FIRST,
+  };
+
+  // Called with the path of each entry, which starts with the |root_path|
+  // given to the constructor, and its info. Called on all the threads at
+  // once, so it must be thread-safe.
+  using Visitor =
+      Callback<void(const FilePath& path,
+                    const FileEnumerator::FileInfo& info)>;
+
+  // |file_type| is a bit mask of FileEnumerator::FileType, which must not
+  // include INCLUDE_DOT_DOT. The enumeration runs on |num_threads| threads,
+  // including the one calling Enumerate().
+  ParallelFileEnumerator(const FilePath& root_path,
+                         int file_type,
+                         Order order,
+                         int num_threads);
+  ~ParallelFileEnumerator() override;
+
+  // Visits the entries below the root path, not including the root path
+  // itself, and returns once all of them were visited. Must be called once.
+  void Enumerate(const Visitor& visitor);
+
+ private:
+  struct Directory;
+
+  // DelegateSimpleThread::Delegate:
+  void Run() override;
+
+  // Reads |directory|, visits its entries, and queues its subdirectories.
+  void ReadDirectory(Directory* directory);
+
+  // Called when |directory| and all the directories below it have been read.
+  void DirectoryDone(Directory* directory);
+
+  const FilePath root_path_;
+  const int file_type_;
+  const Order order_;
+  const int num_threads_;
+  Visitor visitor_;
+
+  Lock lock_;
+
+  // Signaled when directories are queued, or when all were read.
+  ConditionVariable directories_queued_;
+
+  // The directories to read. The last queued is read first, which keeps the
+  // queue short on deep trees.
+  std::vector<Directory*> queued_directories_;
+
+  // The number of directories queued or being read.
+  int pending_directories_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelFileEnumerator);
+};
+
+}  // namespace base
+
+#endif  // BASE_FILES_PARALLEL_FILE_ENUMERATOR_H_
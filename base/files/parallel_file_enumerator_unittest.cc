@@ -0,0 +1,140 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/parallel_file_enumerator.h"
+
+#include <stddef.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/macros.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/lock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Records the paths visited by a ParallelFileEnumerator, in order.
+class Recorder {
+ public:
+  Recorder() {}
+
+  void Visit(const FilePath& path, const FileEnumerator::FileInfo& info) {
+    EXPECT_EQ(path.BaseName(), info.GetName());
+    AutoLock lock(lock_);
+    paths_.push_back(path);
+  }
+
+  const std::vector<FilePath>& paths() const { return paths_; }
+
+ private:
+  Lock lock_;
+  std::vector<FilePath> paths_;
+
+  DISALLOW_COPY_AND_ASSIGN(Recorder);
+};
+
+class ParallelFileEnumeratorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    root_ = temp_dir_.path();
+    CreateTree(root_, 3);
+  }
+
+  // Creates a tree of |depth| levels of directories, each with a few files
+  // and subdirectories.
+  void CreateTree(const FilePath& path, int depth) {
+    for (int i = 0; i < 3; i++) {
+      ASSERT_EQ(1, WriteFile(path.AppendASCII("file" + IntToString(i)),
+                             "x", 1));
+    }
+    if (depth == 0)
+      return;
+    for (int i = 0; i < 3; i++) {
+      const FilePath subdirectory = path.AppendASCII("dir" + IntToString(i));
+      ASSERT_TRUE(CreateDirectory(subdirectory));
+      CreateTree(subdirectory, depth - 1);
+    }
+  }
+
+  std::vector<FilePath> Enumerate(int file_type,
+                                  ParallelFileEnumerator::Order order,
+                                  int num_threads) {
+    Recorder recorder;
+    ParallelFileEnumerator enumerator(root_, file_type, order, num_threads);
+    enumerator.Enumerate(
+        Bind(&Recorder::Visit, Unretained(&recorder)));
+    return recorder.paths();
+  }
+
+  ScopedTempDir temp_dir_;
+  FilePath root_;
+};
+
+std::set<FilePath> EnumerateSerially(const FilePath& root, int file_type) {
+  std::set<FilePath> paths;
+  FileEnumerator enumerator(root, true, file_type);
+  for (FilePath path = enumerator.Next(); !path.empty();
+       path = enumerator.Next()) {
+    paths.insert(path);
+  }
+  return paths;
+}
+
+}  // namespace
+
+TEST_F(ParallelFileEnumeratorTest, VisitsTheSameEntriesAsFileEnumerator) {
+  const int kFileTypes[] = {
+      FileEnumerator::FILES, FileEnumerator::DIRECTORIES,
+      FileEnumerator::FILES | FileEnumerator::DIRECTORIES};
+  for (int file_type : kFileTypes) {
+    const std::set<FilePath> expected = EnumerateSerially(root_, file_type);
+    for (int num_threads = 1; num_threads <= 4; num_threads++) {
+      const std::vector<FilePath> paths = Enumerate(
+          file_type, ParallelFileEnumerator::PARENTS_FIRST, num_threads);
+      EXPECT_EQ(expected.size(), paths.size());
+      EXPECT_EQ(expected, std::set<FilePath>(paths.begin(), paths.end()));
+    }
+  }
+}
+
+TEST_F(ParallelFileEnumeratorTest, Order) {
+  const int kFileType = FileEnumerator::FILES | FileEnumerator::DIRECTORIES;
+  const ParallelFileEnumerator::Order kOrders[] = {
+      ParallelFileEnumerator::PARENTS_FIRST,
+      ParallelFileEnumerator::CHILDREN_FIRST};
+  for (ParallelFileEnumerator::Order order : kOrders) {
+    const std::vector<FilePath> paths = Enumerate(kFileType, order, 4);
+    std::map<FilePath, size_t> indices;
+    for (size_t i = 0; i < paths.size(); i++)
+      indices[paths[i]] = i;
+
+    for (const FilePath& path : paths) {
+      for (FilePath parent = path.DirName(); parent != root_;
+           parent = parent.DirName()) {
+        ASSERT_EQ(1u, indices.count(parent));
+        if (order == ParallelFileEnumerator::PARENTS_FIRST)
+          EXPECT_LT(indices[parent], indices[path]);
+        else
+          EXPECT_GT(indices[parent], indices[path]);
+      }
+    }
+  }
+}
+
+TEST_F(ParallelFileEnumeratorTest, MissingRoot) {
+  root_ = root_.AppendASCII("missing");
+  EXPECT_TRUE(Enumerate(FileEnumerator::FILES,
+                        ParallelFileEnumerator::CHILDREN_FIRST, 2).empty());
+}
+
+}  // namespace base
@@ -0,0 +1,306 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/hash.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/sys_byteorder.h"
+
+namespace base {
+
+namespace {
+
+// xxHash, by Yann Collet: https://github.com/Cyan4973/xxHash. Both variants
+// keep four independent accumulators, so that the multiplications of
+// consecutive words overlap in the pipeline.
+
+const uint32_t kPrime32_1 = 2654435761u;
+const uint32_t kPrime32_2 = 2246822519u;
+const uint32_t kPrime32_3 = 3266489917u;
+const uint32_t kPrime32_4 = 668265263u;
+const uint32_t kPrime32_5 = 374761393u;
+
+const uint64_t kPrime64_1 = UINT64_C(11400714785074694791);
+const uint64_t kPrime64_2 = UINT64_C(14029467366897019727);
+const uint64_t kPrime64_3 = UINT64_C(1609587929392839161);
+const uint64_t kPrime64_4 = UINT64_C(9650029242287828579);
+const uint64_t kPrime64_5 = UINT64_C(2870177450012600261);
+
+inline uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return ByteSwapToLE32(value);
+}
+
+inline uint64_t Read64(const uint8_t* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return ByteSwapToLE64(value);
+}
+
+inline uint32_t RotateLeft32(uint32_t x, int n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+inline uint64_t RotateLeft64(uint64_t x, int n) {
+  return (x << n) | (x >> (64 - n));
+}
+
+inline uint32_t Round32(uint32_t accumulator, uint32_t input) {
+  accumulator += input * kPrime32_2;
+  return RotateLeft32(accumulator, 13) * kPrime32_1;
+}
+
+inline uint64_t Round64(uint64_t accumulator, uint64_t input) {
+  accumulator += input * kPrime64_2;
+  return RotateLeft64(accumulator, 31) * kPrime64_1;
+}
+
+inline uint64_t MergeRound64(uint64_t hash, uint64_t accumulator) {
+  hash ^= Round64(0, accumulator);
+  return hash * kPrime64_1 + kPrime64_4;
+}
+
+// Initializes the accumulators of xxHash64.
+void InitAccumulators64(uint64_t seed, uint64_t accumulators[4]) {
+  accumulators[0] = seed + kPrime64_1 + kPrime64_2;
+  accumulators[1] = seed + kPrime64_2;
+  accumulators[2] = seed;
+  accumulators[3] = seed - kPrime64_1;
+}
+
+// Consumes the whole 32-byte stripes of |length| bytes at |data|, and returns
+// the number of bytes consumed.
+size_t ConsumeStripes64(const uint8_t* data,
+                        size_t length,
+                        uint64_t accumulators[4]) {
+  const uint8_t* p = data;
+  const uint8_t* const limit = data + length - length % 32;
+  uint64_t v1 = accumulators[0];
+  uint64_t v2 = accumulators[1];
+  uint64_t v3 = accumulators[2];
+  uint64_t v4 = accumulators[3];
+  for (; p < limit; p += 32) {
+    v1 = Round64(v1, Read64(p));
+    v2 = Round64(v2, Read64(p + 8));
+    v3 = Round64(v3, Read64(p + 16));
+    v4 = Round64(v4, Read64(p + 24));
+  }
+  accumulators[0] = v1;
+  accumulators[1] = v2;
+  accumulators[2] = v3;
+  accumulators[3] = v4;
+  return p - data;
+}
+
+// Computes the final hash from the accumulators (if |total_length| >= 32),
+// the |tail_length| (< 32) remaining bytes at |tail| and the total length.
+uint64_t Finalize64(const uint64_t accumulators[4],
+                    uint64_t seed,
+                    uint64_t total_length,
+                    const uint8_t* tail,
+                    size_t tail_length) {
+  uint64_t hash;
+  if (total_length >= 32) {
+    hash = RotateLeft64(accumulators[0], 1) + RotateLeft64(accumulators[1], 7) +
+           RotateLeft64(accumulators[2], 12) +
+           RotateLeft64(accumulators[3], 18);
+    for (int i = 0; i < 4; i++)
+      hash = MergeRound64(hash, accumulators[i]);
+  } else {
+    hash = seed + kPrime64_5;
+  }
+  hash += total_length;
+
+  const uint8_t* p = tail;
+  const uint8_t* const end = tail + tail_length;
+  for (; p + 8 <= end; p += 8) {
+    hash ^= Round64(0, Read64(p));
+    hash = RotateLeft64(hash, 27) * kPrime64_1 + kPrime64_4;
+  }
+  if (p + 4 <= end) {
+    hash ^= static_cast<uint64_t>(Read32(p)) * kPrime64_1;
+    hash = RotateLeft64(hash, 23) * kPrime64_2 + kPrime64_3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    hash ^= *p * kPrime64_5;
+    hash = RotateLeft64(hash, 11) * kPrime64_1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime64_2;
+  hash ^= hash >> 29;
+  hash *= kPrime64_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+inline uint64_t FinalMix64(uint64_t k) {
+  k ^= k >> 33;
+  k *= UINT64_C(0xff51afd7ed558ccd);
+  k ^= k >> 33;
+  k *= UINT64_C(0xc4ceb9fe1a85ec53);
+  k ^= k >> 33;
+  return k;
+}
+
+}  // namespace
+
+uint32_t Hash32(const void* data, size_t length, uint32_t seed) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint8_t* const end = p + length;
+  uint32_t hash;
+
+  if (length >= 16) {
+    const uint8_t* const limit = end - 16;
+    uint32_t v1 = seed + kPrime32_1 + kPrime32_2;
+    uint32_t v2 = seed + kPrime32_2;
+    uint32_t v3 = seed;
+    uint32_t v4 = seed - kPrime32_1;
+    do {
+      v1 = Round32(v1, Read32(p));
+      v2 = Round32(v2, Read32(p + 4));
+      v3 = Round32(v3, Read32(p + 8));
+      v4 = Round32(v4, Read32(p + 12));
+      p += 16;
+    } while (p <= limit);
+    hash = RotateLeft32(v1, 1) + RotateLeft32(v2, 7) + RotateLeft32(v3, 12) +
+           RotateLeft32(v4, 18);
+  } else {
+    hash = seed + kPrime32_5;
+  }
+  hash += static_cast<uint32_t>(length);
+
+  for (; p + 4 <= end; p += 4) {
+    hash += Read32(p) * kPrime32_3;
+    hash = RotateLeft32(hash, 17) * kPrime32_4;
+  }
+  for (; p < end; p++) {
+    hash += *p * kPrime32_5;
+    hash = RotateLeft32(hash, 11) * kPrime32_1;
+  }
+
+  hash ^= hash >> 15;
+  hash *= kPrime32_2;
+  hash ^= hash >> 13;
+  hash *= kPrime32_3;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+uint64_t Hash64(const void* data, size_t length, uint64_t seed) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  uint64_t accumulators[4];
+  InitAccumulators64(seed, accumulators);
+  size_t consumed = ConsumeStripes64(p, length, accumulators);
+  return Finalize64(accumulators, seed, length, p + consumed,
+                    length - consumed);
+}
+
+// MurmurHash3_x64_128, by Austin Appleby:
+// https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp
+Hash128Value Hash128(const void* data, size_t length, uint64_t seed) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint64_t c1 = UINT64_C(0x87c37b91114253d5);
+  const uint64_t c2 = UINT64_C(0x4cf5ad432745937f);
+  uint64_t h1 = seed;
+  uint64_t h2 = seed;
+
+  const size_t num_blocks = length / 16;
+  for (size_t i = 0; i < num_blocks; i++, p += 16) {
+    uint64_t k1 = Read64(p);
+    uint64_t k2 = Read64(p + 8);
+
+    k1 *= c1;
+    k1 = RotateLeft64(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+    h1 = RotateLeft64(h1, 27);
+    h1 += h2;
+    h1 = h1 * 5 + 0x52dce729;
+
+    k2 *= c2;
+    k2 = RotateLeft64(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+    h2 = RotateLeft64(h2, 31);
+    h2 += h1;
+    h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  // The tail bytes are read as two little-endian words.
+  const size_t tail_length = length % 16;
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+  for (size_t i = tail_length; i > 8; i--)
+    k2 = (k2 << 8) | p[i - 1];
+  for (size_t i = std::min<size_t>(tail_length, 8); i > 0; i--)
+    k1 = (k1 << 8) | p[i - 1];
+  if (tail_length > 8) {
+    k2 *= c2;
+    k2 = RotateLeft64(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+  }
+  if (tail_length) {
+    k1 *= c1;
+    k1 = RotateLeft64(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+  }
+
+  h1 ^= length;
+  h2 ^= length;
+  h1 += h2;
+  h2 += h1;
+  h1 = FinalMix64(h1);
+  h2 = FinalMix64(h2);
+  h1 += h2;
+  h2 += h1;
+
+  Hash128Value value;
+  value.low = h1;
+  value.high = h2;
+  return value;
+}
+
+Hasher64::Hasher64() : Hasher64(0) {}
+
+Hasher64::Hasher64(uint64_t seed)
+    : seed_(seed), total_length_(0), buffered_length_(0) {
+  InitAccumulators64(seed, accumulators_);
+}
+
+void Hasher64::Update(const void* data, size_t length) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  total_length_ += length;
+
+  // Complete a buffered partial stripe first.
+  if (buffered_length_) {
+    size_t n = std::min(sizeof(buffer_) - buffered_length_, length);
+    memcpy(buffer_ + buffered_length_, p, n);
+    buffered_length_ += n;
+    p += n;
+    length -= n;
+    if (buffered_length_ < sizeof(buffer_))
+      return;
+    ConsumeStripes64(buffer_, sizeof(buffer_), accumulators_);
+    buffered_length_ = 0;
+  }
+
+  size_t consumed = ConsumeStripes64(p, length, accumulators_);
+  memcpy(buffer_, p + consumed, length - consumed);
+  buffered_length_ = length - consumed;
+}
+
+uint64_t Hasher64::Finish() const {
+  return Finalize64(accumulators_, seed_, total_length_, buffer_,
+                    buffered_length_);
+}
+
+}  // namespace base
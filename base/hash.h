@@ -5,21 +5,89 @@
 #ifndef BASE_HASH_H_
 #define BASE_HASH_H_
 
-#include <cstdint>
-#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
 #include <string>
 
+#include "base/base_export.h"
+#include "base/strings/string_piece.h"
+
 namespace base {
 
-// Deprecated: just use std::hash directly
+// Fast non-cryptographic hash functions. Hash32() is xxHash32, Hash64() is
+// xxHash64 and Hash128() is MurmurHash3_x64_128. The values only depend on
+// the bytes hashed and the seed, not on the platform, standard library or
+// build, so they can be persisted and compared across processes.
 //
-// Computes a hash of a string |str|.
-// WARNING: This hash function should not be used for any cryptographic purpose.
+// WARNING: These hash functions should not be used for any cryptographic
+// purpose. In particular, an attacker can easily produce collisions.
+
+struct Hash128Value {
+  uint64_t low;
+  uint64_t high;
+};
+
+BASE_EXPORT uint32_t Hash32(const void* data, size_t length, uint32_t seed);
+BASE_EXPORT uint64_t Hash64(const void* data, size_t length, uint64_t seed);
+BASE_EXPORT Hash128Value Hash128(const void* data,
+                                 size_t length,
+                                 uint64_t seed);
+
+inline uint32_t Hash32(const StringPiece& data) {
+  return Hash32(data.data(), data.size(), 0);
+}
+
+inline uint64_t Hash64(const StringPiece& data) {
+  return Hash64(data.data(), data.size(), 0);
+}
+
+inline Hash128Value Hash128(const StringPiece& data) {
+  return Hash128(data.data(), data.size(), 0);
+}
+
+// Computes a hash of a string |str|. Same as Hash32(str).
 inline uint32_t Hash(const std::string& str) {
-  std::hash<std::string> hash_fn;
-  return hash_fn(str);
+  return Hash32(str);
 }
 
+// Computes Hash64() of data which is fed in pieces. The result is the same as
+// Hash64() of all the pieces concatenated. Copying a Hasher64 forks the state.
+class BASE_EXPORT Hasher64 {
+ public:
+  Hasher64();
+  explicit Hasher64(uint64_t seed);
+
+  void Update(const void* data, size_t length);
+  void Update(const StringPiece& data) { Update(data.data(), data.size()); }
+
+  // Returns the hash of everything passed to Update() so far. More data can
+  // be added afterwards.
+  uint64_t Finish() const;
+
+ private:
+  uint64_t seed_;
+  uint64_t total_length_;
+
+  // The four accumulators of xxHash64, which consumes 32-byte stripes.
+  uint64_t accumulators_[4];
+
+  // The bytes of an incomplete stripe.
+  uint8_t buffer_[32];
+  size_t buffered_length_;
+};
+
+// A hasher for hash_map and hash_set (and thus HashingMRUCache) with string
+// keys, which, unlike the default one, does not depend on the standard
+// library, and hashes StringPieces without copying them into strings.
+struct StringHash {
+  size_t operator()(const StringPiece& str) const {
+    return sizeof(size_t) == sizeof(uint64_t)
+               ? static_cast<size_t>(Hash64(str))
+               : static_cast<size_t>(Hash32(str));
+  }
+};
+
 }  // namespace base
 
 #endif  // BASE_HASH_H_
@@ -0,0 +1,165 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/hash.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "base/format_macros.h"
+#include "base/metrics/metrics_hashes.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+// The hash functions under test, reduced to 64 bits.
+uint64_t Hash32Function(const std::string& str) {
+  return Hash32(str);
+}
+
+uint64_t Hash64Function(const std::string& str) {
+  return Hash64(str);
+}
+
+uint64_t Hash128Function(const std::string& str) {
+  return Hash128(str).low;
+}
+
+uint64_t StdHashFunction(const std::string& str) {
+  return std::hash<std::string>()(str);
+}
+
+uint64_t MD5Function(const std::string& str) {
+  return HashMetricName(str);
+}
+
+struct HashFunction {
+  const char* name;
+  uint64_t (*function)(const std::string& str);
+  int bits;
+};
+
+const HashFunction kHashFunctions[] = {
+    {"Hash32", &Hash32Function, 32},
+    {"Hash64", &Hash64Function, 64},
+    {"Hash128", &Hash128Function, 64},
+    {"std_hash", &StdHashFunction, 8 * sizeof(size_t)},
+    {"HashMetricName", &MD5Function, 64},
+};
+
+void MeasureSpeed(size_t size) {
+  // Hash 256 different strings, so that the branch predictor does not learn
+  // a single input.
+  std::vector<std::string> inputs;
+  for (int i = 0; i < 256; i++)
+    inputs.push_back(std::string(size, static_cast<char>(i)));
+  const size_t kBytesPerMeasurement = 64 * 1024 * 1024;
+  const size_t iterations =
+      std::max<size_t>(kBytesPerMeasurement / (size * inputs.size()), 1);
+
+  for (const HashFunction& hash : kHashFunctions) {
+    uint64_t sink = 0;
+    TimeTicks start = TimeTicks::Now();
+    for (size_t i = 0; i < iterations; i++) {
+      for (const std::string& input : inputs)
+        sink += hash.function(input);
+    }
+    TimeDelta elapsed = TimeTicks::Now() - start;
+    const double num_hashes = static_cast<double>(iterations) * inputs.size();
+    perf_test::PrintResult(
+        "hash_time", StringPrintf("_%" PRIuS "_bytes", size), hash.name,
+        elapsed.InSecondsF() * 1e9 / num_hashes, "ns", true);
+    // Keep the compiler from dropping the computation.
+    EXPECT_NE(1u, sink);
+  }
+}
+
+// Flips every bit of a number of random keys and reports the worst deviation
+// from the ideal probability of 1/2 that an output bit flips with it, in
+// percentage points. With this sample size, sampling noise alone accounts for
+// about 2.
+void MeasureAvalanche(const HashFunction& hash, size_t key_size) {
+  const int kNumKeys = 10000;
+  std::vector<std::vector<int>> flips(
+      8 * key_size, std::vector<int>(hash.bits, 0));
+  uint64_t random = 88172645463325252ull;
+  for (int k = 0; k < kNumKeys; k++) {
+    std::string key(key_size, 0);
+    for (size_t i = 0; i < key_size; i++) {
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      key[i] = static_cast<char>(random);
+    }
+    const uint64_t original = hash.function(key);
+    for (size_t bit = 0; bit < 8 * key_size; bit++) {
+      key[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+      const uint64_t difference = original ^ hash.function(key);
+      key[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+      for (int out = 0; out < hash.bits; out++)
+        flips[bit][out] += (difference >> out) & 1;
+    }
+  }
+
+  double worst_bias = 0;
+  for (const std::vector<int>& input_bit : flips) {
+    for (int count : input_bit) {
+      worst_bias = std::max(
+          worst_bias, fabs(static_cast<double>(count) / kNumKeys - 0.5));
+    }
+  }
+  perf_test::PrintResult("avalanche_worst_bias",
+                         StringPrintf("_%" PRIuS "_bytes", key_size),
+                         hash.name, 100 * worst_bias, "%", false);
+}
+
+// Hashes similar keys, such as those of metrics, into a power-of-two number
+// of buckets and reports the chi-squared statistic over the expected uniform
+// distribution, normalized so that a uniform hash gives about 1.
+void MeasureDistribution(const HashFunction& hash) {
+  const size_t kNumBuckets = 1 << 12;
+  const size_t kNumKeys = 64 * kNumBuckets;
+  std::vector<int> buckets(kNumBuckets, 0);
+  for (size_t i = 0; i < kNumKeys; i++) {
+    const uint64_t value =
+        hash.function(StringPrintf("Memory.Renderer.%" PRIuS, i));
+    buckets[value & (kNumBuckets - 1)]++;
+  }
+  const double expected = static_cast<double>(kNumKeys) / kNumBuckets;
+  double chi_squared = 0;
+  for (int count : buckets)
+    chi_squared += (count - expected) * (count - expected) / expected;
+  perf_test::PrintResult("distribution_chi_squared", "", hash.name,
+                         chi_squared / (kNumBuckets - 1), "", false);
+}
+
+}  // namespace
+
+TEST(HashPerfTest, Speed) {
+  MeasureSpeed(8);
+  MeasureSpeed(32);
+  MeasureSpeed(256);
+  MeasureSpeed(4096);
+}
+
+TEST(HashPerfTest, Quality) {
+  for (const HashFunction& hash : kHashFunctions) {
+    MeasureAvalanche(hash, 4);
+    MeasureAvalanche(hash, 32);
+    MeasureDistribution(hash);
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,129 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/hash.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "base/containers/hash_tables.h"
+#include "base/containers/mru_cache.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const char kFox[] = "The quick brown fox jumps over the lazy dog";
+
+// 1024 bytes, so that all of the hashes run several full stripes.
+std::string LongInput() {
+  std::string input;
+  for (int i = 0; i < 1024; i++)
+    input.push_back(static_cast<char>(i & 0xff));
+  return input;
+}
+
+}  // namespace
+
+// The expected values are those of the reference implementations.
+TEST(HashTest, Hash32) {
+  EXPECT_EQ(0x02cc5d05u, Hash32(""));
+  EXPECT_EQ(0x32d153ffu, Hash32("abc"));
+  EXPECT_EQ(0xe85ea4deu, Hash32(kFox));
+  EXPECT_EQ(0x58654d5au, Hash32(LongInput()));
+  EXPECT_EQ(0x4d4cb222u, Hash32("abc", 3, 0x9747b28c));
+
+  // Hash() is Hash32().
+  EXPECT_EQ(0xe85ea4deu, Hash(kFox));
+}
+
+TEST(HashTest, Hash64) {
+  EXPECT_EQ(UINT64_C(0xef46db3751d8e999), Hash64(""));
+  EXPECT_EQ(UINT64_C(0x44bc2cf5ad770999), Hash64("abc"));
+  EXPECT_EQ(UINT64_C(0x0b242d361fda71bc), Hash64(kFox));
+  EXPECT_EQ(UINT64_C(0x6f3914f18fe4df57), Hash64(LongInput()));
+  EXPECT_EQ(UINT64_C(0x7d79a0222a9406c7), Hash64("abc", 3, 0x9747b28c));
+}
+
+TEST(HashTest, Hash128) {
+  Hash128Value value = Hash128("");
+  EXPECT_EQ(0u, value.low);
+  EXPECT_EQ(0u, value.high);
+
+  value = Hash128("abc");
+  EXPECT_EQ(UINT64_C(0xb4963f3f3fad7867), value.low);
+  EXPECT_EQ(UINT64_C(0x3ba2744126ca2d52), value.high);
+
+  value = Hash128(kFox);
+  EXPECT_EQ(UINT64_C(0xe34bbc7bbc071b6c), value.low);
+  EXPECT_EQ(UINT64_C(0x7a433ca9c49a9347), value.high);
+
+  value = Hash128(LongInput());
+  EXPECT_EQ(UINT64_C(0x69d9dcce316c4c29), value.low);
+  EXPECT_EQ(UINT64_C(0xed876c1605cc45c6), value.high);
+}
+
+TEST(HashTest, UnalignedInput) {
+  const std::string input = LongInput();
+  std::string copy = "x" + input;
+  EXPECT_EQ(Hash32(input), Hash32(copy.data() + 1, input.size(), 0));
+  EXPECT_EQ(Hash64(input), Hash64(copy.data() + 1, input.size(), 0));
+  EXPECT_EQ(Hash128(input).low, Hash128(copy.data() + 1, input.size(), 0).low);
+}
+
+TEST(HashTest, Hasher64MatchesHash64) {
+  const std::string input = LongInput();
+  for (size_t length = 0; length <= 200; length++) {
+    const StringPiece data(input.data(), length);
+
+    // All in one piece, and in pieces of every size up to a stripe.
+    Hasher64 whole(42);
+    whole.Update(data);
+    EXPECT_EQ(Hash64(data.data(), data.size(), 42), whole.Finish());
+
+    for (size_t piece = 1; piece <= 33 && piece <= length; piece++) {
+      Hasher64 hasher(42);
+      for (size_t pos = 0; pos < length; pos += piece)
+        hasher.Update(data.substr(pos, piece));
+      EXPECT_EQ(Hash64(data.data(), data.size(), 42), hasher.Finish())
+          << "length " << length << ", piece " << piece;
+    }
+  }
+}
+
+TEST(HashTest, Hasher64Fork) {
+  Hasher64 hasher;
+  hasher.Update("The quick brown fox ");
+  Hasher64 fork = hasher;
+  hasher.Update("jumps over the lazy dog");
+  fork.Update("jumps");
+  EXPECT_EQ(Hash64(kFox), hasher.Finish());
+  EXPECT_EQ(Hash64("The quick brown fox jumps"), fork.Finish());
+
+  // Finish() does not change the state.
+  hasher.Update(".");
+  EXPECT_EQ(Hash64(std::string(kFox) + "."), hasher.Finish());
+}
+
+TEST(HashTest, StringHash) {
+  hash_map<std::string, int, StringHash> map;
+  map["one"] = 1;
+  map["two"] = 2;
+  EXPECT_EQ(1, map["one"]);
+  EXPECT_EQ(2, map["two"]);
+  EXPECT_EQ(StringHash()(std::string("one")), StringHash()(StringPiece("one")));
+
+  HashingMRUCache<std::string, int, StringHash> cache(2);
+  cache.Put("one", 1);
+  cache.Put("two", 2);
+  cache.Put("three", 3);
+  EXPECT_EQ(cache.end(), cache.Get("one"));
+  ASSERT_NE(cache.end(), cache.Get("three"));
+  EXPECT_EQ(3, cache.Get("three")->second);
+}
+
+}  // namespace base
@@ -889,7 +889,7 @@ Value* JSONParser::ConsumeNumber() {
     return new FundamentalValue(num_int);
 
   double num_double;
-  if (StringToDouble(num_string.as_string(), &num_double) &&
+  if (StringToDouble(num_string, &num_double) &&
       std::isfinite(num_double)) {
     return new FundamentalValue(num_double);
   }
@@ -74,7 +74,8 @@ bool JSONWriter::BuildJSONString(const Value& node, size_t depth) {
       int value;
       bool result = node.GetAsInteger(&value);
       DCHECK(result);
-      json_string_->append(IntToString(value));
+      char buffer[kMaxNumberStringLength];
+      json_string_->append(buffer, Int64ToBuffer(value, buffer));
       return result;
     }
 
@@ -86,27 +87,16 @@ bool JSONWriter::BuildJSONString(const Value& node, size_t depth) {
           value <= std::numeric_limits<int64_t>::max() &&
           value >= std::numeric_limits<int64_t>::min() &&
           std::floor(value) == value) {
-        json_string_->append(Int64ToString(static_cast<int64_t>(value)));
+        char buffer[kMaxNumberStringLength];
+        json_string_->append(
+            buffer, Int64ToBuffer(static_cast<int64_t>(value), buffer));
         return result;
       }
-      std::string real = DoubleToString(value);
-      // Ensure that the number has a .0 if there's no decimal or 'e'.  This
-      // makes sure that when we read the JSON back, it's interpreted as a
-      // real rather than an int.
-      if (real.find('.') == std::string::npos &&
-          real.find('e') == std::string::npos &&
-          real.find('E') == std::string::npos) {
-        real.append(".0");
-      }
-      // The JSON spec requires that non-integer values in the range (-1,1)
-      // have a zero before the decimal point - ".52" is not valid, "0.52" is.
-      if (real[0] == '.') {
-        real.insert(static_cast<size_t>(0), static_cast<size_t>(1), '0');
-      } else if (real.length() > 1 && real[0] == '-' && real[1] == '.') {
-        // "-.1" bad "-0.1" good
-        real.insert(static_cast<size_t>(1), static_cast<size_t>(1), '0');
-      }
-      json_string_->append(real);
+      // This writes a digit before any decimal point, and a point or an
+      // exponent, so that the number is valid JSON and is read back as a real
+      // rather than an int.
+      char buffer[kMaxNumberStringLength];
+      json_string_->append(buffer, DoubleToBuffer(value, buffer));
       return result;
     }
 
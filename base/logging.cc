@@ -74,6 +74,7 @@ typedef pthread_mutex_t* MutexHandle;
 #include "base/threading/platform_thread.h"
 #include "base/vlog.h"
 #if defined(OS_POSIX)
+#include "base/async_log_writer_posix.h"
 #include "base/posix/safe_strerror.h"
 #endif
 
@@ -117,6 +118,22 @@ PathString* g_log_file_name = nullptr;
 // This file is lazily opened and the handle may be nullptr
 FileHandle g_log_file = nullptr;
 
+#if defined(OS_POSIX)
+// Writes the messages to stderr and |g_log_file| in WRITE_LOG_ASYNCHRONOUSLY
+// mode, and is nullptr otherwise.
+AsyncLogWriter* g_async_log_writer = nullptr;
+
+// Bounds the memory of |g_async_log_writer| to 4 MiB.
+const size_t kAsyncLogBufferSize = 64 * 1024;
+const int kMaxAsyncLogBuffers = 64;
+
+// Registered with atexit(), so that queued messages are not lost on exit.
+void FlushAsyncLogWriter() {
+  if (g_async_log_writer)
+    g_async_log_writer->Flush();
+}
+#endif
+
 // What should be prepended to each message?
 bool g_log_process_id = false;
 bool g_log_thread_id = false;
@@ -314,6 +331,8 @@ bool InitializeLogFileHandle() {
     g_log_file = fopen(g_log_file_name->c_str(), "a");
     if (g_log_file == nullptr)
       return false;
+    if (g_async_log_writer)
+      g_async_log_writer->SetFileDescriptors(STDERR_FILENO, fileno(g_log_file));
 #endif
   }
 
@@ -332,6 +351,11 @@ void CloseLogFileUnlocked() {
   if (!g_log_file)
     return;
 
+#if defined(OS_POSIX)
+  // Write the messages queued for the file before closing it.
+  if (g_async_log_writer)
+    g_async_log_writer->SetFileDescriptors(STDERR_FILENO, -1);
+#endif
   CloseFile(g_log_file);
   g_log_file = nullptr;
 }
@@ -340,6 +364,7 @@ void CloseLogFileUnlocked() {
 
 LoggingSettings::LoggingSettings()
     : logging_dest(LOG_DEFAULT),
+      write_log(WRITE_LOG_SYNCHRONOUSLY),
       log_file(nullptr),
       lock_log(LOCK_LOG_FILE),
       delete_old(APPEND_TO_OLD_LOG_FILE) {}
@@ -370,6 +395,28 @@ bool BaseInitLoggingImpl(const LoggingSettings& settings) {
 
   g_logging_destination = settings.logging_dest;
 
+#if defined(OS_POSIX)
+  if (settings.write_log == WRITE_LOG_ASYNCHRONOUSLY) {
+    if (!g_async_log_writer) {
+      AsyncLogWriter* writer =
+          new AsyncLogWriter(kAsyncLogBufferSize, kMaxAsyncLogBuffers);
+      if (writer->Start()) {
+        // Leaked, like its thread.
+        g_async_log_writer = writer;
+        atexit(&FlushAsyncLogWriter);
+      } else {
+        delete writer;
+      }
+    }
+  } else if (g_async_log_writer) {
+    // Don't delete the writer, another thread may still be using it; it stays
+    // idle once its queued messages are written.
+    AsyncLogWriter* writer = g_async_log_writer;
+    g_async_log_writer = nullptr;
+    writer->SetFileDescriptors(STDERR_FILENO, -1);
+  }
+#endif
+
   // ignore file options unless logging to file is set.
   if ((g_logging_destination & LOG_TO_FILE) == 0)
     return true;
@@ -539,6 +586,7 @@ LogMessage::~LogMessage() {
     return;
   }
 
+  bool to_stderr = false;
   if ((g_logging_destination & LOG_TO_SYSTEM_DEBUG_LOG) != 0) {
 #if defined(OS_WIN)
     OutputDebugStringA(str_newline.c_str());
@@ -685,18 +733,39 @@ LogMessage::~LogMessage() {
         str_newline.c_str());
 #endif  // defined(OS_ANDROID)
 #endif
-    ignore_result(fwrite(str_newline.data(), str_newline.size(), 1, stderr));
-    fflush(stderr);
+    to_stderr = true;
   } else if (severity_ >= kAlwaysPrintErrorLevel) {
     // When we're only outputting to a log file, above a certain log level, we
     // should still output to stderr so that we can better detect and diagnose
     // problems with unit tests, especially on the buildbots.
+    to_stderr = true;
+  }
+  bool to_file = (g_logging_destination & LOG_TO_FILE) != 0;
+
+#if defined(OS_POSIX)
+  AsyncLogWriter* async_log_writer = g_async_log_writer;
+  if (async_log_writer && (to_stderr || to_file)) {
+    if (severity_ != LOG_FATAL &&
+        async_log_writer->Write(
+            str_newline, (to_stderr ? AsyncLogWriter::TO_STDERR : 0) |
+                             (to_file ? AsyncLogWriter::TO_FILE : 0))) {
+      to_stderr = false;
+      to_file = false;
+    } else {
+      // This message is written below. Write the queued ones first, which
+      // also gets them out before the process goes down on a FATAL message.
+      async_log_writer->Flush();
+    }
+  }
+#endif
+
+  if (to_stderr) {
     ignore_result(fwrite(str_newline.data(), str_newline.size(), 1, stderr));
     fflush(stderr);
   }
 
   // write to log file
-  if ((g_logging_destination & LOG_TO_FILE) != 0) {
+  if (to_file) {
     // We can have multiple threads and/or processes, so try to prevent them
     // from clobbering each other's writes.
     // If the client app did not call InitLogging, and the lock has not
@@ -876,6 +945,21 @@ void CloseLogFile() {
   CloseLogFileUnlocked();
 }
 
+void FlushLogMessages() {
+#if defined(OS_POSIX)
+  if (g_async_log_writer)
+    g_async_log_writer->Flush();
+#endif
+}
+
+uint32_t GetDroppedLogMessageCount() {
+#if defined(OS_POSIX)
+  if (g_async_log_writer)
+    return g_async_log_writer->dropped_count();
+#endif
+  return 0;
+}
+
 void RawLog(int level, const char* message) {
   if (level >= g_min_log_level) {
     size_t bytes_written = 0;
@@ -6,6 +6,7 @@
 #define BASE_LOGGING_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <cassert>
 #include <cstring>
@@ -207,6 +208,16 @@ enum LogLockingState { LOCK_LOG_FILE, DONT_LOCK_LOG_FILE };
 // Defaults to APPEND_TO_OLD_LOG_FILE.
 enum OldFileDeletionState { DELETE_OLD_LOG_FILE, APPEND_TO_OLD_LOG_FILE };
 
+// Should messages be written to stderr and the log file by the thread logging
+// them, or queued for a background thread? Writing asynchronously keeps the
+// threads that log from waiting for the disk and for each other, but drops
+// messages when a thread logs faster than they can be written (see
+// GetDroppedLogMessageCount()). FATAL messages are always written
+// synchronously, after the queued ones. Only supported on POSIX; the system
+// debug logs of Android and Mac are always written synchronously.
+// Defaults to WRITE_LOG_SYNCHRONOUSLY.
+enum LogWritingState { WRITE_LOG_SYNCHRONOUSLY, WRITE_LOG_ASYNCHRONOUSLY };
+
 struct BASE_EXPORT LoggingSettings {
   // The defaults values are:
   //
@@ -214,9 +225,11 @@ struct BASE_EXPORT LoggingSettings {
   //  log_file:     NULL
   //  lock_log:     LOCK_LOG_FILE
   //  delete_old:   APPEND_TO_OLD_LOG_FILE
+  //  write_log:    WRITE_LOG_SYNCHRONOUSLY
   LoggingSettings();
 
   LoggingDestination logging_dest;
+  LogWritingState write_log;
 
   // The three settings below have an effect only when LOG_TO_FILE is
   // set in |logging_dest|.
@@ -912,6 +925,14 @@ class BASE_EXPORT ErrnoLogMessage {
 //       after this call.
 BASE_EXPORT void CloseLogFile();
 
+// Writes the messages queued in WRITE_LOG_ASYNCHRONOUSLY mode before
+// returning. Does nothing in WRITE_LOG_SYNCHRONOUSLY mode.
+BASE_EXPORT void FlushLogMessages();
+
+// Returns the number of messages dropped in WRITE_LOG_ASYNCHRONOUSLY mode
+// because they were logged faster than they could be written.
+BASE_EXPORT uint32_t GetDroppedLogMessageCount();
+
 // Async signal safe logging mechanism.
 BASE_EXPORT void RawLog(int level, const char* message);
 
@@ -3,8 +3,12 @@
 // found in the LICENSE file.
 
 #include "base/compiler_specific.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/strings/string_number_conversions.h"
+#include "build/build_config.h"
 
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -276,6 +280,41 @@ TEST_F(LoggingTest, CheckEqStatements) {
     CHECK_EQ(false, true);           // Unreached.
 }
 
+#if defined(OS_POSIX)
+TEST_F(LoggingTest, WritesAsynchronously) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const base::FilePath log_path = temp_dir.path().AppendASCII("test.log");
+
+  LoggingSettings settings;
+  settings.logging_dest = LOG_TO_FILE;
+  settings.log_file = log_path.value().c_str();
+  settings.write_log = WRITE_LOG_ASYNCHRONOUSLY;
+  ASSERT_TRUE(InitLogging(settings));
+
+  SetMinLogLevel(LOG_INFO);
+  const int kMessages = 100;
+  for (int i = 0; i < kMessages; i++)
+    LOG(INFO) << "asynchronous message " << i;
+  FlushLogMessages();
+  EXPECT_EQ(0u, GetDroppedLogMessageCount());
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(log_path, &contents));
+  size_t position = 0;
+  for (int i = 0; i < kMessages; i++) {
+    const std::string message =
+        "asynchronous message " + base::IntToString(i) + "\n";
+    position = contents.find(message, position);
+    ASSERT_NE(std::string::npos, position) << i;
+  }
+
+  // Back to the defaults.
+  ASSERT_TRUE(InitLogging(LoggingSettings()));
+  CloseLogFile();
+}
+#endif  // defined(OS_POSIX)
+
 // Test that defining an operator<< for a type in a namespace doesn't prevent
 // other code in that namespace from calling the operator<<(ostream, wstring)
 // defined by logging.h. This can fail if operator<<(ostream, wstring) can't be
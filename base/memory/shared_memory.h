@@ -58,6 +58,14 @@ struct BASE_EXPORT SharedMemoryCreateOptions {
 
   // If true, the file can be shared read-only to a process.
   bool share_read_only;
+
+  // If true, the segment is backed by huge pages where the system provides
+  // them: reserved hugetlbfs pages when the size is a multiple of the huge
+  // page size and enough are free, and otherwise transparent huge pages, if
+  // they are enabled for shared memory. This saves page faults and TLB misses
+  // on segments of several megabytes, and wastes memory on small ones. Only
+  // honored on Linux and Android.
+  bool huge_pages;
 };
 
 // Platform abstraction for shared memory.  Provides a C++ wrapper
@@ -192,6 +200,13 @@ class BASE_EXPORT SharedMemory {
   bool MapAt(off_t offset, size_t bytes);
   enum { MAP_MINIMUM_ALIGNMENT = 32 };
 
+#if defined(OS_POSIX) && !(defined(OS_MACOSX) && !defined(OS_IOS))
+  // If true, MapAt() faults in all the pages of the mapping at once (with
+  // MAP_POPULATE on Linux), rather than on first access. This is cheaper when
+  // the whole mapping is about to be read or written.
+  void set_prefault(bool prefault) { prefault_ = prefault; }
+#endif
+
   // Unmaps the shared memory from the caller's address space.
   // Returns true if successful; returns false on error or if the
   // memory is not mapped.
@@ -226,6 +241,10 @@ class BASE_EXPORT SharedMemory {
   // methods with share_read_only=true. If it was constructed from a
   // SharedMemoryHandle, this call will CHECK-fail.
   //
+  // On Linux, this seals the segment against writable mappings, so that the
+  // read-only handle cannot be reopened for writing: mappings of |*this|
+  // made before the call stay writable, but those made after are not.
+  //
   // Returns true on success, false otherwise.
   bool ShareReadOnlyToProcess(ProcessHandle process,
                               SharedMemoryHandle* new_handle) {
@@ -299,6 +318,8 @@ class BASE_EXPORT SharedMemory {
 #elif defined(OS_POSIX)
   int                mapped_file_;
   int                readonly_mapped_file_;
+  bool               huge_pages_;
+  bool               prefault_;
 #endif
   size_t             mapped_size_;
   void*              memory_;
@@ -0,0 +1,168 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/shared_memory.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/files/scoped_file.h"
+#include "base/posix/unix_domain_socket_linux.h"
+#include "base/process/process.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/multiprocess_test.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/multiprocess_func_list.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+// The descriptor of the socket of the child process.
+const int kChildSocketFd = 100;
+
+// The message which hands a segment off to the child process, along with its
+// handle. A size of 0 tells the child process to exit.
+struct Handoff {
+  size_t size;
+  bool prefault;
+};
+
+uint64_t SumWords(const void* memory, size_t size) {
+  const uint64_t* words = static_cast<const uint64_t*>(memory);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < size / sizeof(uint64_t); i++)
+    sum += words[i];
+  return sum;
+}
+
+// Reads all of each segment handed off to it, and replies with its sum.
+MULTIPROCESS_TEST_MAIN(SharedMemoryHandoffChild) {
+  while (true) {
+    Handoff handoff;
+    std::vector<ScopedFD> fds;
+    if (UnixDomainSocket::RecvMsg(kChildSocketFd, &handoff, sizeof(handoff),
+                                  &fds) != sizeof(handoff)) {
+      return 1;
+    }
+    if (handoff.size == 0)
+      return 0;
+    if (fds.size() != 1)
+      return 2;
+
+    SharedMemory memory(FileDescriptor(fds[0].release(), true), true);
+    memory.set_prefault(handoff.prefault);
+    if (!memory.Map(handoff.size))
+      return 3;
+    const uint64_t sum = SumWords(memory.memory(), handoff.size);
+    if (!UnixDomainSocket::SendMsg(kChildSocketFd, &sum, sizeof(sum),
+                                   std::vector<int>())) {
+      return 4;
+    }
+  }
+}
+
+class SharedMemoryPerfTest : public MultiProcessTest {
+ public:
+  void SetUp() override {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    socket_.reset(fds[0]);
+    ScopedFD child_socket(fds[1]);
+
+    FileHandleMappingVector fds_to_remap;
+    fds_to_remap.push_back(std::make_pair(child_socket.get(), kChildSocketFd));
+    LaunchOptions options;
+    options.fds_to_remap = &fds_to_remap;
+    child_ = SpawnChildWithOptions("SharedMemoryHandoffChild", options);
+    ASSERT_TRUE(child_.IsValid());
+  }
+
+  void TearDown() override {
+    const Handoff handoff = {0, false};
+    EXPECT_TRUE(UnixDomainSocket::SendMsg(socket_.get(), &handoff,
+                                          sizeof(handoff), std::vector<int>()));
+    int exit_code = -1;
+    EXPECT_TRUE(child_.WaitForExitWithTimeout(TimeDelta::FromSeconds(10),
+                                              &exit_code));
+    EXPECT_EQ(0, exit_code);
+  }
+
+  // Creates segments of |size| bytes, writes them and hands them off,
+  // read-only, to the child process, which reads them back.
+  void MeasureHandoff(size_t size, bool prefault, bool huge_pages) {
+    const size_t kBytes = 512 * 1024 * 1024;
+    const int handoffs = static_cast<int>(std::max<size_t>(kBytes / size, 16));
+    const TimeTicks start = TimeTicks::Now();
+    for (int i = 0; i < handoffs; i++) {
+      SharedMemoryCreateOptions options;
+      options.size = size;
+      options.share_read_only = true;
+      options.huge_pages = huge_pages;
+      SharedMemory memory;
+      memory.set_prefault(prefault);
+      ASSERT_TRUE(memory.Create(options));
+      ASSERT_TRUE(memory.Map(size));
+      memset(memory.memory(), i, size);
+
+      SharedMemoryHandle handle;
+      ASSERT_TRUE(memory.GiveReadOnlyToProcess(child_.Handle(), &handle));
+      ScopedFD handle_fd(handle.fd);
+      const Handoff handoff = {size, prefault};
+      ASSERT_TRUE(UnixDomainSocket::SendMsg(
+          socket_.get(), &handoff, sizeof(handoff),
+          std::vector<int>(1, handle_fd.get())));
+      handle_fd.reset();
+
+      uint64_t sum = 0;
+      std::vector<ScopedFD> fds;
+      ASSERT_EQ(static_cast<ssize_t>(sizeof(sum)),
+                UnixDomainSocket::RecvMsg(socket_.get(), &sum, sizeof(sum),
+                                          &fds));
+      EXPECT_EQ(static_cast<uint8_t>(i) * 0x0101010101010101ull *
+                    (size / sizeof(uint64_t)),
+                sum);
+    }
+    const TimeDelta elapsed = TimeTicks::Now() - start;
+
+    std::string trace = "Handoff_" + SizeTToString(size / 1024) + "KB";
+    if (prefault)
+      trace += "_prefault";
+    if (huge_pages)
+      trace += "_huge_pages";
+    perf_test::PrintResult("throughput", "", trace,
+                           handoffs * (size / (1024.0 * 1024)) /
+                               elapsed.InSecondsF(),
+                           "MB/s", true);
+    perf_test::PrintResult("time_per_handoff", "", trace,
+                           elapsed.InSecondsF() * 1e6 / handoffs, "us", true);
+  }
+
+ private:
+  ScopedFD socket_;
+  Process child_;
+};
+
+}  // namespace
+
+TEST_F(SharedMemoryPerfTest, Handoff) {
+  const size_t kSizes[] = {64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+  for (size_t size : kSizes) {
+    MeasureHandoff(size, false, false);
+    MeasureHandoff(size, true, false);
+  }
+  MeasureHandoff(16 * 1024 * 1024, false, true);
+  MeasureHandoff(16 * 1024 * 1024, true, true);
+}
+
+}  // namespace base
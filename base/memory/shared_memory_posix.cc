@@ -0,0 +1,658 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/shared_memory.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <limits>
+#include <utility>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_file.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/process/process_metrics.h"
+#include "base/scoped_generic.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/threading/thread_restrictions.h"
+#include "build/build_config.h"
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <linux/magic.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+
+// The headers of older C libraries lack the memfd and sealing constants.
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB 0x0004U
+#endif
+#ifndef MFD_NOEXEC_SEAL
+#define MFD_NOEXEC_SEAL 0x0008U
+#define MFD_EXEC 0x0010U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ 22
+#define MADV_POPULATE_WRITE 23
+#endif
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
+namespace base {
+
+namespace {
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+
+// The size of the huge pages of hugetlbfs, and of transparent huge pages.
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+int MemfdCreate(unsigned int flags, bool executable) {
+#if defined(__NR_memfd_create)
+  const char kName[] = "base::SharedMemory";
+  // Linux 6.3 and later warn about memfds which do not say whether they may
+  // be executable, and earlier versions refuse the flags that say so.
+  const int fd = syscall(__NR_memfd_create, kName,
+                         flags | (executable ? MFD_EXEC : MFD_NOEXEC_SEAL));
+  if (fd >= 0 || errno != EINVAL)
+    return fd;
+  return syscall(__NR_memfd_create, kName, flags);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+// Creates a memfd of |size| bytes, on hugetlbfs if |huge_pages| and there
+// are enough free huge pages. The size is sealed, so that no process it is
+// shared with can truncate it under the mappings of the others. Returns an
+// invalid fd on failure, in particular on kernels older than 3.17.
+ScopedFD CreateMemfd(size_t size, bool executable, bool huge_pages) {
+  const unsigned int kFlags = MFD_CLOEXEC | MFD_ALLOW_SEALING;
+  ScopedFD fd;
+  if (huge_pages && size % kHugePageSize == 0) {
+    fd.reset(MemfdCreate(kFlags | MFD_HUGETLB, executable));
+    // Huge pages are only reserved when they are mapped, where running out
+    // of them fails with SIGBUS; allocate them now to fail here instead.
+    if (fd.is_valid() &&
+        (HANDLE_EINTR(ftruncate(fd.get(), size)) != 0 ||
+         HANDLE_EINTR(fallocate(fd.get(), 0, 0, size)) != 0)) {
+      fd.reset();
+    }
+  }
+  if (!fd.is_valid()) {
+    fd.reset(MemfdCreate(kFlags, executable));
+    if (!fd.is_valid())
+      return ScopedFD();
+    if (HANDLE_EINTR(ftruncate(fd.get(), size)) != 0) {
+      DPLOG(ERROR) << "ftruncate";
+      return ScopedFD();
+    }
+  }
+  if (HANDLE_EINTR(fcntl(fd.get(), F_ADD_SEALS,
+                         F_SEAL_SHRINK | F_SEAL_GROW)) != 0) {
+    DPLOG(ERROR) << "fcntl(F_ADD_SEALS)";
+    return ScopedFD();
+  }
+  return fd;
+}
+
+// Returns true if |fd| is a file of hugetlbfs, whose mappings are made of
+// whole huge pages. A memfd asked for on huge pages is an ordinary one when
+// its size is not whole huge pages or there were not enough free ones, and a
+// handle received from another process may be either.
+bool IsOnHugetlbfs(int fd) {
+  struct statfs statfs_buf;
+  return fstatfs(fd, &statfs_buf) == 0 &&
+         static_cast<uintmax_t>(statfs_buf.f_type) == HUGETLBFS_MAGIC;
+}
+
+// Returns a read-only file descriptor of the memfd |fd|.
+ScopedFD CreateReadOnlyMemfd(int fd) {
+  // A file descriptor opened read-only is all that protects the memory
+  // from writes on kernels without F_SEAL_FUTURE_WRITE, so try that first.
+  const std::string path = "/proc/self/fd/" + IntToString(fd);
+  ScopedFD readonly_fd(HANDLE_EINTR(open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+  if (!readonly_fd.is_valid())
+    readonly_fd.reset(HANDLE_EINTR(dup(fd)));
+  return readonly_fd;
+}
+
+// Makes sure that the memory of |fd| cannot be written through
+// |readonly_fd|, nor through a file descriptor opened again from it in
+// /proc/<pid>/fd.
+bool SealAgainstWrites(int fd, int readonly_fd) {
+  // Only writable file descriptors can add seals.
+  const int seals = HANDLE_EINTR(fcntl(fd, F_GET_SEALS));
+  if (seals >= 0 &&
+      ((seals & F_SEAL_FUTURE_WRITE) ||
+       HANDLE_EINTR(fcntl(fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE)) == 0)) {
+    return true;
+  }
+  // Files in /dev/shm cannot be sealed, and neither can memfds before
+  // Linux 5.1: settle for a file descriptor which is read-only.
+  const int flags = HANDLE_EINTR(fcntl(readonly_fd, F_GETFL));
+  return flags >= 0 && (flags & O_ACCMODE) == O_RDONLY;
+}
+
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
+#if !defined(OS_ANDROID)
+
+struct ScopedPathUnlinkerTraits {
+  static FilePath* InvalidValue() { return nullptr; }
+
+  static void Free(FilePath* path) {
+    if (unlink(path->value().c_str()))
+      PLOG(WARNING) << "unlink";
+  }
+};
+
+// Unlinks the FilePath when the object is destroyed.
+typedef ScopedGeneric<FilePath*, ScopedPathUnlinkerTraits> ScopedPathUnlinker;
+
+// Makes a temporary file, fdopens it, and then unlinks it. |fp| is populated
+// with the fdopened FILE. |readonly_fd| is populated with the opened fd if
+// options.share_read_only is true. |path| is populated with the location of
+// the file before it was unlinked.
+// Returns false if there's an unhandled failure.
+bool CreateAnonymousSharedMemory(const SharedMemoryCreateOptions& options,
+                                 ScopedFILE* fp,
+                                 ScopedFD* readonly_fd,
+                                 FilePath* path) {
+  // It doesn't make sense to have a open-existing private piece of shmem
+  DCHECK(!options.open_existing_deprecated);
+  FilePath directory;
+  ScopedPathUnlinker path_unlinker;
+  if (GetShmemTempDir(options.executable, &directory)) {
+    fp->reset(CreateAndOpenTemporaryFileInDir(directory, path));
+
+    // Deleting the file prevents anyone else from mapping it in (making it
+    // private), and prevents the need for cleanup (once the last fd is
+    // closed, it is truly freed).
+    if (*fp)
+      path_unlinker.reset(path);
+  }
+
+  if (*fp) {
+    if (options.share_read_only) {
+      // Also open as readonly so that we can ShareReadOnlyToProcess.
+      readonly_fd->reset(HANDLE_EINTR(open(path->value().c_str(), O_RDONLY)));
+      if (!readonly_fd->is_valid()) {
+        DPLOG(ERROR) << "open(\"" << path->value() << "\", O_RDONLY) failed";
+        fp->reset();
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+#endif  // !defined(OS_ANDROID)
+
+}  // namespace
+
+SharedMemoryCreateOptions::SharedMemoryCreateOptions()
+    : name_deprecated(nullptr),
+      open_existing_deprecated(false),
+      size(0),
+      executable(false),
+      share_read_only(false),
+      huge_pages(false) {}
+
+SharedMemory::SharedMemory()
+    : mapped_file_(-1),
+      readonly_mapped_file_(-1),
+      huge_pages_(false),
+      prefault_(false),
+      mapped_size_(0),
+      memory_(NULL),
+      read_only_(false),
+      requested_size_(0) {}
+
+SharedMemory::SharedMemory(const SharedMemoryHandle& handle, bool read_only)
+    : mapped_file_(handle.fd),
+      readonly_mapped_file_(-1),
+      huge_pages_(false),
+      prefault_(false),
+      mapped_size_(0),
+      memory_(NULL),
+      read_only_(read_only),
+      requested_size_(0) {}
+
+SharedMemory::~SharedMemory() {
+  Unmap();
+  Close();
+}
+
+// static
+bool SharedMemory::IsHandleValid(const SharedMemoryHandle& handle) {
+  return handle.fd >= 0;
+}
+
+// static
+SharedMemoryHandle SharedMemory::NULLHandle() {
+  return SharedMemoryHandle();
+}
+
+// static
+void SharedMemory::CloseHandle(const SharedMemoryHandle& handle) {
+  DCHECK_GE(handle.fd, 0);
+  if (IGNORE_EINTR(close(handle.fd)) < 0)
+    DPLOG(ERROR) << "close";
+}
+
+// static
+size_t SharedMemory::GetHandleLimit() {
+  return GetMaxFds();
+}
+
+// static
+SharedMemoryHandle SharedMemory::DuplicateHandle(
+    const SharedMemoryHandle& handle) {
+  int duped_handle = HANDLE_EINTR(dup(handle.fd));
+  if (duped_handle < 0)
+    return NULLHandle();
+  return FileDescriptor(duped_handle, true);
+}
+
+// static
+int SharedMemory::GetFdFromSharedMemoryHandle(
+    const SharedMemoryHandle& handle) {
+  return handle.fd;
+}
+
+bool SharedMemory::CreateAndMapAnonymous(size_t size) {
+  return CreateAnonymous(size) && Map(size);
+}
+
+#if !defined(OS_ANDROID)
+// static
+bool SharedMemory::GetSizeFromSharedMemoryHandle(
+    const SharedMemoryHandle& handle,
+    size_t* size) {
+  struct stat st;
+  if (fstat(handle.fd, &st) != 0)
+    return false;
+  if (st.st_size < 0)
+    return false;
+  *size = st.st_size;
+  return true;
+}
+#endif  // !defined(OS_ANDROID)
+
+// Anonymous segments are memfds on Linux and Android: they need neither a
+// file system mounted nor a name, and they can be sealed. Elsewhere, and for
+// named segments, they are files in the directory of GetShmemTempDir().
+bool SharedMemory::Create(const SharedMemoryCreateOptions& options) {
+  DCHECK_EQ(-1, mapped_file_);
+  if (options.size == 0)
+    return false;
+
+  if (options.size > static_cast<size_t>(std::numeric_limits<int>::max()))
+    return false;
+
+  // This function theoretically can block on the disk, but realistically
+  // the temporary files we create will just go into the buffer cache
+  // and be deleted before they ever make it out to disk.
+  ThreadRestrictions::ScopedAllowIO allow_io;
+
+  huge_pages_ = options.huge_pages;
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  if (options.name_deprecated == NULL || options.name_deprecated->empty()) {
+    ScopedFD fd = CreateMemfd(options.size, options.executable,
+                              options.huge_pages);
+    if (fd.is_valid()) {
+      ScopedFD readonly_fd;
+      if (options.share_read_only) {
+        readonly_fd = CreateReadOnlyMemfd(fd.get());
+        if (!readonly_fd.is_valid())
+          return false;
+      }
+      requested_size_ = options.size;
+      mapped_file_ = fd.release();
+      readonly_mapped_file_ = readonly_fd.release();
+      return true;
+    }
+    DPLOG(WARNING) << "memfd_create";
+  }
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
+#if defined(OS_ANDROID)
+  // Android has no shared memory directory to fall back on.
+  return false;
+#else
+  ScopedFILE fp;
+  bool fix_size = true;
+  ScopedFD readonly_fd;
+
+  FilePath path;
+  if (options.name_deprecated == NULL || options.name_deprecated->empty()) {
+    bool result =
+        CreateAnonymousSharedMemory(options, &fp, &readonly_fd, &path);
+    if (!result)
+      return false;
+  } else {
+    if (!FilePathForMemoryName(*options.name_deprecated, &path))
+      return false;
+
+    // Make sure that the file is opened without any permission
+    // to other users on the system.
+    const mode_t kOwnerOnly = S_IRUSR | S_IWUSR;
+
+    // First, try to create the file.
+    int fd = HANDLE_EINTR(
+        open(path.value().c_str(), O_RDWR | O_CREAT | O_EXCL, kOwnerOnly));
+    if (fd == -1 && options.open_existing_deprecated) {
+      // If this doesn't work, try and open an existing file in append mode.
+      // Opening an existing file in a world writable directory has two main
+      // security implications:
+      // - Attackers could plant a file under their control, so ownership of
+      //   the file is checked below.
+      // - Attackers could plant a symbolic link so that an unexpected file
+      //   is opened, so O_NOFOLLOW is passed to open().
+      fd = HANDLE_EINTR(
+          open(path.value().c_str(), O_RDWR | O_APPEND | O_NOFOLLOW));
+
+      // Check that the current user owns the file.
+      // If uid != euid, then a more complex permission model is used and this
+      // API is not appropriate.
+      const uid_t real_uid = getuid();
+      const uid_t effective_uid = geteuid();
+      struct stat sb;
+      if (fd >= 0 &&
+          (fstat(fd, &sb) != 0 || sb.st_uid != real_uid ||
+           sb.st_uid != effective_uid)) {
+        LOG(ERROR) <<
+            "Invalid owner when opening existing shared memory file.";
+        close(fd);
+        return false;
+      }
+
+      // An existing file was opened, so its size should not be fixed.
+      fix_size = false;
+    }
+
+    if (options.share_read_only) {
+      // Also open as readonly so that we can ShareReadOnlyToProcess.
+      readonly_fd.reset(HANDLE_EINTR(open(path.value().c_str(), O_RDONLY)));
+      if (!readonly_fd.is_valid()) {
+        DPLOG(ERROR) << "open(\"" << path.value() << "\", O_RDONLY) failed";
+        close(fd);
+        fd = -1;
+        return false;
+      }
+    }
+    if (fd >= 0) {
+      // "a+" is always appropriate: if it's a new file, a+ is similar to w+.
+      fp.reset(fdopen(fd, "a+"));
+    }
+  }
+  if (fp && fix_size) {
+    // Get current size.
+    struct stat stat;
+    if (fstat(fileno(fp.get()), &stat) != 0)
+      return false;
+    const size_t current_size = stat.st_size;
+    if (current_size != options.size) {
+      if (HANDLE_EINTR(ftruncate(fileno(fp.get()), options.size)) != 0)
+        return false;
+    }
+    requested_size_ = options.size;
+  }
+  if (fp == NULL) {
+    PLOG(ERROR) << "Creating shared memory in " << path.value() << " failed";
+    FilePath dir = path.DirName();
+    if (access(dir.value().c_str(), W_OK | X_OK) < 0) {
+      PLOG(ERROR) << "Unable to access(W_OK|X_OK) " << dir.value();
+      if (dir.value() == "/dev/shm") {
+        LOG(FATAL) << "This is frequently caused by incorrect permissions on "
+                   << "/dev/shm.  Try 'sudo chmod 1777 /dev/shm' to fix.";
+      }
+    }
+    return false;
+  }
+
+  return PrepareMapFile(std::move(fp), std::move(readonly_fd));
+#endif  // defined(OS_ANDROID)
+}
+
+#if !defined(OS_ANDROID)
+// Our current implementation of shmem is with mmap()ing of files.
+// These files need to be deleted explicitly.
+// In practice this call is only needed for unit tests.
+bool SharedMemory::Delete(const std::string& name) {
+  FilePath path;
+  if (!FilePathForMemoryName(name, &path))
+    return false;
+
+  if (PathExists(path))
+    return DeleteFile(path, false);
+
+  // Doesn't exist, so success.
+  return true;
+}
+
+bool SharedMemory::Open(const std::string& name, bool read_only) {
+  FilePath path;
+  if (!FilePathForMemoryName(name, &path))
+    return false;
+
+  read_only_ = read_only;
+
+  const char *mode = read_only ? "r" : "r+";
+  ScopedFILE fp(OpenFile(path, mode));
+  ScopedFD readonly_fd(HANDLE_EINTR(open(path.value().c_str(), O_RDONLY)));
+  if (!readonly_fd.is_valid()) {
+    DPLOG(ERROR) << "open(\"" << path.value() << "\", O_RDONLY) failed";
+    return false;
+  }
+  return PrepareMapFile(std::move(fp), std::move(readonly_fd));
+}
+#endif  // !defined(OS_ANDROID)
+
+bool SharedMemory::MapAt(off_t offset, size_t bytes) {
+  if (mapped_file_ == -1)
+    return false;
+
+  if (bytes > static_cast<size_t>(std::numeric_limits<int>::max()))
+    return false;
+
+  if (memory_)
+    return false;
+
+  int flags = MAP_SHARED;
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  if (IsOnHugetlbfs(mapped_file_)) {
+    // Mappings of hugetlbfs files can only be unmapped in whole huge pages.
+    bytes = (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+  }
+  // Pages are only huge if they are faulted in after madvise(): populate
+  // the mapping after that, in that case.
+  if (prefault_ && !huge_pages_)
+    flags |= MAP_POPULATE;
+#endif
+
+  memory_ = mmap(NULL, bytes, PROT_READ | (read_only_ ? 0 : PROT_WRITE),
+                 flags, mapped_file_, offset);
+
+  bool mmap_succeeded = memory_ != MAP_FAILED && memory_ != NULL;
+  if (mmap_succeeded) {
+    mapped_size_ = bytes;
+    DCHECK_EQ(0U, reinterpret_cast<uintptr_t>(memory_) &
+        (SharedMemory::MAP_MINIMUM_ALIGNMENT - 1));
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    // Both calls fail harmlessly on hugetlbfs, and where transparent huge
+    // pages or MADV_POPULATE_* (Linux 5.14) are not available.
+    if (huge_pages_) {
+      madvise(memory_, bytes, MADV_HUGEPAGE);
+      if (prefault_) {
+        madvise(memory_, bytes,
+                read_only_ ? MADV_POPULATE_READ : MADV_POPULATE_WRITE);
+      }
+    }
+#endif
+  } else {
+    memory_ = NULL;
+  }
+
+  return mmap_succeeded;
+}
+
+bool SharedMemory::Unmap() {
+  if (memory_ == NULL)
+    return false;
+
+  munmap(memory_, mapped_size_);
+  memory_ = NULL;
+  mapped_size_ = 0;
+  return true;
+}
+
+SharedMemoryHandle SharedMemory::handle() const {
+  return FileDescriptor(mapped_file_, false);
+}
+
+void SharedMemory::Close() {
+  if (mapped_file_ > 0) {
+    if (IGNORE_EINTR(close(mapped_file_)) < 0)
+      PLOG(ERROR) << "close";
+    mapped_file_ = -1;
+  }
+  if (readonly_mapped_file_ > 0) {
+    if (IGNORE_EINTR(close(readonly_mapped_file_)) < 0)
+      PLOG(ERROR) << "close";
+    readonly_mapped_file_ = -1;
+  }
+}
+
+#if !defined(OS_ANDROID)
+bool SharedMemory::PrepareMapFile(ScopedFILE fp, ScopedFD readonly_fd) {
+  DCHECK_EQ(-1, mapped_file_);
+  DCHECK_EQ(-1, readonly_mapped_file_);
+  if (fp == NULL)
+    return false;
+
+  // This function theoretically can block on the disk, but realistically
+  // the temporary files we create will just go into the buffer cache
+  // and be deleted before they ever make it out to disk.
+  ThreadRestrictions::ScopedAllowIO allow_io;
+
+  struct stat st = {};
+  if (fstat(fileno(fp.get()), &st))
+    NOTREACHED();
+  if (readonly_fd.is_valid()) {
+    struct stat readonly_st = {};
+    if (fstat(readonly_fd.get(), &readonly_st))
+      NOTREACHED();
+    if (st.st_dev != readonly_st.st_dev || st.st_ino != readonly_st.st_ino) {
+      LOG(ERROR) << "writable and read-only inodes don't match; bailing";
+      return false;
+    }
+  }
+
+  mapped_file_ = HANDLE_EINTR(dup(fileno(fp.get())));
+  if (mapped_file_ == -1) {
+    if (errno == EMFILE) {
+      LOG(WARNING) << "Shared memory creation failed; out of file descriptors";
+      return false;
+    } else {
+      NOTREACHED() << "Call to dup failed, errno=" << errno;
+    }
+  }
+  readonly_mapped_file_ = readonly_fd.release();
+
+  return true;
+}
+
+// For the given shmem named |mem_name|, return a filename to mmap()
+// (and possibly create).  Modifies |filename|.  Return false on
+// error, or true of we are happy.
+bool SharedMemory::FilePathForMemoryName(const std::string& mem_name,
+                                         FilePath* path) {
+  // mem_name will be used for a filename; make sure it doesn't
+  // contain anything which will confuse us.
+  DCHECK_EQ(std::string::npos, mem_name.find('/'));
+  DCHECK_EQ(std::string::npos, mem_name.find('\0'));
+
+  FilePath temp_dir;
+  if (!GetShmemTempDir(false, &temp_dir))
+    return false;
+
+#if defined(GOOGLE_CHROME_BUILD)
+  std::string name_base = std::string("com.google.Chrome");
+#else
+  std::string name_base = std::string("org.chromium.Chromium");
+#endif  // defined(GOOGLE_CHROME_BUILD)
+  *path = temp_dir.AppendASCII(name_base + ".shmem." + mem_name);
+  return true;
+}
+#endif  // !defined(OS_ANDROID)
+
+bool SharedMemory::ShareToProcessCommon(ProcessHandle /* process */,
+                                        SharedMemoryHandle* new_handle,
+                                        bool close_self,
+                                        ShareMode share_mode) {
+  int handle_to_dup = -1;
+  switch (share_mode) {
+    case SHARE_CURRENT_MODE:
+      handle_to_dup = mapped_file_;
+      break;
+    case SHARE_READONLY:
+      CHECK_GE(readonly_mapped_file_, 0);
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+      if (!SealAgainstWrites(mapped_file_, readonly_mapped_file_)) {
+        if (close_self) {
+          Unmap();
+          Close();
+        }
+        DLOG(ERROR) << "The segment cannot be made read-only.";
+        return false;
+      }
+#endif
+      handle_to_dup = readonly_mapped_file_;
+      break;
+  }
+
+  const int new_fd = HANDLE_EINTR(dup(handle_to_dup));
+  if (new_fd < 0) {
+    if (close_self) {
+      Unmap();
+      Close();
+    }
+    DPLOG(ERROR) << "dup() failed.";
+    return false;
+  }
+
+  new_handle->fd = new_fd;
+  new_handle->auto_close = true;
+
+  if (close_self) {
+    Unmap();
+    Close();
+  }
+
+  return true;
+}
+
+}  // namespace base
@@ -0,0 +1,290 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/shared_memory.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/files/scoped_file.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/posix/unix_domain_socket_linux.h"
+#include "base/process/process.h"
+#include "base/rand_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/sys_info.h"
+#include "base/test/multiprocess_test.h"
+#include "base/time/time.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/multiprocess_func_list.h"
+
+#if defined(OS_LINUX)
+#include <fcntl.h>
+#endif
+
+namespace base {
+
+namespace {
+
+const size_t kDataSize = 1024 * 1024;
+
+// The descriptor of the socket of the child processes.
+const int kChildSocketFd = 100;
+
+// Returns the sum of the bytes in |memory|, as a cheap checksum.
+uint64_t SumBytes(const void* memory, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(memory);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < size; i++)
+    sum += bytes[i];
+  return sum;
+}
+
+void FillBytes(void* memory, size_t size) {
+  uint8_t* bytes = static_cast<uint8_t*>(memory);
+  for (size_t i = 0; i < size; i++)
+    bytes[i] = static_cast<uint8_t>(i * 7 + i / 251);
+}
+
+// Maps the segment received on the socket of the child process, and sends
+// back the sum of its bytes, or 0 if the segment could be mapped writable.
+MULTIPROCESS_TEST_MAIN(SharedMemoryReadOnlyChild) {
+  size_t size;
+  std::vector<ScopedFD> fds;
+  if (UnixDomainSocket::RecvMsg(kChildSocketFd, &size, sizeof(size), &fds) !=
+          sizeof(size) ||
+      fds.size() != 1) {
+    return 1;
+  }
+
+  uint64_t sum = 0;
+  void* writable = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        fds[0].get(), 0);
+  if (writable == MAP_FAILED) {
+    SharedMemory memory(FileDescriptor(fds[0].release(), true), true);
+    if (!memory.Map(size))
+      return 2;
+    sum = SumBytes(memory.memory(), size);
+  } else {
+    munmap(writable, size);
+  }
+  return UnixDomainSocket::SendMsg(kChildSocketFd, &sum, sizeof(sum),
+                                   std::vector<int>())
+             ? 0
+             : 3;
+}
+
+}  // namespace
+
+TEST(SharedMemoryTest, OpenClose) {
+  const size_t kSize = 1024;
+  const std::string test_name =
+      "SharedMemoryOpenCloseTest" + Uint64ToString(RandUint64());
+
+  // Open two handles to a memory segment, confirm that they are mapped
+  // separately yet point to the same space.
+  SharedMemory memory1;
+  ASSERT_TRUE(memory1.Delete(test_name));
+  ASSERT_TRUE(memory1.CreateNamedDeprecated(test_name, false, kSize));
+  ASSERT_TRUE(memory1.Map(kSize));
+
+  SharedMemory memory2;
+  ASSERT_TRUE(memory2.Open(test_name, false));
+  ASSERT_TRUE(memory2.Map(kSize));
+  EXPECT_NE(memory1.memory(), memory2.memory());
+
+  memset(memory1.memory(), 'G', kSize);
+  EXPECT_EQ(0, memcmp(memory1.memory(), memory2.memory(), kSize));
+
+  memory1.Close();
+  memory2.Close();
+  EXPECT_TRUE(memory1.Unmap());
+  EXPECT_TRUE(memory2.Unmap());
+  EXPECT_TRUE(memory1.Delete(test_name));
+}
+
+TEST(SharedMemoryTest, CreateAndMapAnonymous) {
+  SharedMemory memory;
+  ASSERT_TRUE(memory.CreateAndMapAnonymous(kDataSize));
+  EXPECT_EQ(kDataSize, memory.requested_size());
+  EXPECT_EQ(kDataSize, memory.mapped_size());
+  EXPECT_TRUE(SharedMemory::IsHandleValid(memory.handle()));
+  FillBytes(memory.memory(), kDataSize);
+
+  size_t size = 0;
+  ASSERT_TRUE(
+      SharedMemory::GetSizeFromSharedMemoryHandle(memory.handle(), &size));
+  EXPECT_EQ(kDataSize, size);
+
+  // A duplicate of the handle maps the same memory.
+  SharedMemory duplicate(SharedMemory::DuplicateHandle(memory.handle()),
+                         false);
+  ASSERT_TRUE(duplicate.Map(kDataSize));
+  EXPECT_EQ(0, memcmp(memory.memory(), duplicate.memory(), kDataSize));
+  static_cast<char*>(duplicate.memory())[1] = 'x';
+  EXPECT_EQ('x', static_cast<char*>(memory.memory())[1]);
+}
+
+TEST(SharedMemoryTest, MapAt) {
+  const size_t kOffset = SysInfo::VMAllocationGranularity();
+  SharedMemory memory;
+  ASSERT_TRUE(memory.CreateAndMapAnonymous(2 * kOffset));
+  FillBytes(memory.memory(), 2 * kOffset);
+  const uint64_t sum =
+      SumBytes(static_cast<char*>(memory.memory()) + kOffset, kOffset);
+  ASSERT_TRUE(memory.Unmap());
+
+  ASSERT_TRUE(memory.MapAt(kOffset, kOffset));
+  EXPECT_EQ(sum, SumBytes(memory.memory(), kOffset));
+}
+
+TEST(SharedMemoryTest, ShareReadOnly) {
+  SharedMemoryCreateOptions options;
+  options.size = kDataSize;
+  options.share_read_only = true;
+  SharedMemory writable;
+  ASSERT_TRUE(writable.Create(options));
+  ASSERT_TRUE(writable.Map(kDataSize));
+  FillBytes(writable.memory(), kDataSize);
+
+  SharedMemoryHandle handle;
+  ASSERT_TRUE(writable.ShareReadOnlyToProcess(GetCurrentProcessHandle(),
+                                              &handle));
+  ScopedFD readonly_fd(handle.fd);
+  EXPECT_EQ(MAP_FAILED, mmap(NULL, kDataSize, PROT_READ | PROT_WRITE,
+                             MAP_SHARED, readonly_fd.get(), 0));
+  EXPECT_EQ(-1, HANDLE_EINTR(write(readonly_fd.get(), "x", 1)));
+
+  SharedMemory readonly(FileDescriptor(readonly_fd.release(), true), true);
+  ASSERT_TRUE(readonly.Map(kDataSize));
+  EXPECT_EQ(0, memcmp(writable.memory(), readonly.memory(), kDataSize));
+
+  // The mapping made before sharing stays writable.
+  static_cast<char*>(writable.memory())[0] = 'x';
+  EXPECT_EQ('x', static_cast<char*>(readonly.memory())[0]);
+
+#if defined(OS_LINUX)
+  // Opening the read-only descriptor again does not make it writable.
+  const std::string path =
+      "/proc/self/fd/" + IntToString(readonly.handle().fd);
+  ScopedFD reopened_fd(HANDLE_EINTR(open(path.c_str(), O_RDWR)));
+  if (reopened_fd.is_valid()) {
+    EXPECT_EQ(MAP_FAILED, mmap(NULL, kDataSize, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, reopened_fd.get(), 0));
+    EXPECT_EQ(-1, HANDLE_EINTR(write(reopened_fd.get(), "x", 1)));
+  }
+#endif  // defined(OS_LINUX)
+}
+
+#if defined(OS_LINUX)
+TEST(SharedMemoryTest, SizeIsSealed) {
+  SharedMemory memory;
+  ASSERT_TRUE(memory.CreateAndMapAnonymous(kDataSize));
+  EXPECT_NE(0, HANDLE_EINTR(ftruncate(memory.handle().fd, 0)));
+  EXPECT_NE(0, HANDLE_EINTR(ftruncate(memory.handle().fd, 2 * kDataSize)));
+  FillBytes(memory.memory(), kDataSize);
+}
+
+TEST(SharedMemoryTest, Prefault) {
+  const size_t kPageSize = getpagesize();
+  const size_t kPages = kDataSize / kPageSize;
+  for (bool prefault : {false, true}) {
+    SharedMemory memory;
+    memory.set_prefault(prefault);
+    ASSERT_TRUE(memory.CreateAndMapAnonymous(kDataSize));
+    std::vector<unsigned char> resident(kPages);
+    ASSERT_EQ(0, mincore(memory.memory(), kDataSize, resident.data()));
+    size_t resident_pages = 0;
+    for (unsigned char page : resident)
+      resident_pages += page & 1;
+    EXPECT_EQ(prefault ? kPages : 0u, resident_pages);
+  }
+}
+
+TEST(SharedMemoryTest, HugePages) {
+  // The memory is on hugetlbfs, on transparent huge pages, or on normal
+  // pages, depending on the system: all of them must work.
+  const size_t kSizes[] = {kDataSize, 4 * kDataSize};
+  for (size_t size : kSizes) {
+    for (bool prefault : {false, true}) {
+      SharedMemoryCreateOptions options;
+      options.size = size;
+      options.huge_pages = true;
+      options.share_read_only = true;
+      SharedMemory memory;
+      memory.set_prefault(prefault);
+      ASSERT_TRUE(memory.Create(options));
+      ASSERT_TRUE(memory.Map(size));
+      // Both sizes are whole huge pages, or are not on hugetlbfs.
+      EXPECT_EQ(size, memory.mapped_size());
+      FillBytes(memory.memory(), size);
+
+      SharedMemoryHandle handle;
+      ASSERT_TRUE(memory.ShareReadOnlyToProcess(GetCurrentProcessHandle(),
+                                                &handle));
+      SharedMemory readonly(handle, true);
+      ASSERT_TRUE(readonly.Map(size));
+      EXPECT_EQ(0, memcmp(memory.memory(), readonly.memory(), size));
+    }
+  }
+}
+#endif  // defined(OS_LINUX)
+
+class SharedMemoryProcessTest : public MultiProcessTest {};
+
+// Hands a read-only segment off to another process, over a socket.
+TEST_F(SharedMemoryProcessTest, HandOffReadOnly) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+  ScopedFD socket(fds[0]);
+  ScopedFD child_socket(fds[1]);
+
+  FileHandleMappingVector fds_to_remap;
+  fds_to_remap.push_back(std::make_pair(child_socket.get(), kChildSocketFd));
+  LaunchOptions launch_options;
+  launch_options.fds_to_remap = &fds_to_remap;
+  Process child =
+      SpawnChildWithOptions("SharedMemoryReadOnlyChild", launch_options);
+  ASSERT_TRUE(child.IsValid());
+  child_socket.reset();
+
+  SharedMemoryCreateOptions options;
+  options.size = kDataSize;
+  options.share_read_only = true;
+  SharedMemory memory;
+  ASSERT_TRUE(memory.Create(options));
+  ASSERT_TRUE(memory.Map(kDataSize));
+  FillBytes(memory.memory(), kDataSize);
+
+  SharedMemoryHandle handle;
+  ASSERT_TRUE(memory.ShareReadOnlyToProcess(child.Handle(), &handle));
+  ScopedFD handle_fd(handle.fd);
+  ASSERT_TRUE(UnixDomainSocket::SendMsg(socket.get(), &kDataSize,
+                                        sizeof(kDataSize),
+                                        std::vector<int>(1, handle_fd.get())));
+  handle_fd.reset();
+
+  uint64_t sum = 0;
+  std::vector<ScopedFD> received_fds;
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(sum)),
+            UnixDomainSocket::RecvMsg(socket.get(), &sum, sizeof(sum),
+                                      &received_fds));
+  EXPECT_EQ(SumBytes(memory.memory(), kDataSize), sum);
+
+  int exit_code = -1;
+  ASSERT_TRUE(child.WaitForExitWithTimeout(TimeDelta::FromSeconds(10),
+                                           &exit_code));
+  EXPECT_EQ(0, exit_code);
+}
+
+}  // namespace base
@@ -5,6 +5,7 @@
 #include "base/message_loop/incoming_task_queue.h"
 
 #include <limits>
+#include <utility>
 
 #include "base/location.h"
 #include "base/message_loop/message_loop.h"
@@ -157,8 +158,7 @@ bool IncomingTaskQueue::PostPendingTask(PendingTask* pending_task) {
                                                 *pending_task);
 
   bool was_empty = incoming_queue_.empty();
-  incoming_queue_.push(*pending_task);
-  pending_task->task.Reset();
+  incoming_queue_.push(std::move(*pending_task));
 
   if (is_ready_for_scheduling_ &&
       (always_schedule_work_ || (!message_loop_scheduled_ && was_empty))) {
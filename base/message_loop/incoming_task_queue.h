@@ -66,9 +66,9 @@ class BASE_EXPORT IncomingTaskQueue
   TimeTicks CalculateDelayedRuntime(TimeDelta delay);
 
   // Adds a task to |incoming_queue_|. The caller retains ownership of
-  // |pending_task|, but this function will reset the value of
-  // |pending_task->task|. This is needed to ensure that the posting call stack
-  // does not retain |pending_task->task| beyond this function call.
+  // |pending_task|, but this function moves |pending_task->task| out of it.
+  // This is needed to ensure that the posting call stack does not retain
+  // |pending_task->task| beyond this function call.
   bool PostPendingTask(PendingTask* pending_task);
 
   // Wakes up the message loop and schedules work.
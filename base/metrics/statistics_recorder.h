@@ -19,10 +19,13 @@
 
 #include "base/base_export.h"
 #include "base/callback.h"
+#include "base/containers/hash_tables.h"
 #include "base/gtest_prod_util.h"
+#include "base/hash.h"
 #include "base/lazy_instance.h"
 #include "base/macros.h"
 #include "base/metrics/histogram_base.h"
+#include "base/strings/string_piece.h"
 
 namespace base {
 
@@ -62,7 +65,8 @@ class BASE_EXPORT StatisticsRecorder {
   // |query| will process all registered histograms).
   static std::string ToJSON(const std::string& query);
 
-  // Method for extracting histograms which were marked for use by UMA.
+  // Method for extracting histograms which were marked for use by UMA. They
+  // are appended to |output| sorted by name.
   static void GetHistograms(Histograms* output);
 
   // Method for extracting BucketRanges used by all histograms registered.
@@ -75,7 +79,7 @@ class BASE_EXPORT StatisticsRecorder {
   // GetSnapshot copies some of the pointers to registered histograms into the
   // caller supplied vector (Histograms). Only histograms which have |query| as
   // a substring are copied (an empty string will process all registered
-  // histograms).
+  // histograms), sorted by name.
   static void GetSnapshot(const std::string& query, Histograms* snapshot);
 
   typedef base::Callback<void(HistogramBase::Sample)> OnSampleCallback;
@@ -97,9 +101,13 @@ class BASE_EXPORT StatisticsRecorder {
   static OnSampleCallback FindCallback(const std::string& histogram_name);
 
  private:
-  // We keep all registered histograms in a map, indexed by the hash of the
-  // name of the histogram.
-  typedef std::map<uint64_t, HistogramBase*> HistogramMap;
+  // We keep all registered histograms in a map, indexed by the name of the
+  // histogram. The keys point to the names owned by the histograms, which are
+  // never deleted while registered. HistogramBase::name_hash() is not used as
+  // the key, as computing that MD5-based hash made every lookup slow.
+  // GetHistograms() and GetSnapshot() sort what they return by name, which the
+  // snapshot manager and the dumps rely on.
+  typedef hash_map<StringPiece, HistogramBase*, StringHash> HistogramMap;
 
   // We keep a map of callbacks to histograms, so that as histograms are
   // created, we can set the callback properly.
@@ -0,0 +1,134 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/observer_list_threadsafe.h"
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/macros.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+class Observer {
+ public:
+  virtual void OnChange(int value) = 0;
+
+ protected:
+  virtual ~Observer() {}
+};
+
+// Observes the list on its own thread.
+class ObserverThread : public Observer {
+ public:
+  explicit ObserverThread(ObserverListThreadSafe<Observer>* list)
+      : list_(list),
+        thread_("ObserverThread"),
+        notifications_(0),
+        last_value_(0) {
+    thread_.Start();
+    WaitableEvent added(false, false);
+    thread_.task_runner()->PostTask(
+        FROM_HERE,
+        Bind(&ObserverThread::AddObserver, Unretained(this), &added));
+    added.Wait();
+  }
+  ~ObserverThread() override {}
+
+  void OnChange(int value) override {
+    ++notifications_;
+    last_value_ = value;
+  }
+
+  // Waits for the thread to process the notifications made so far.
+  void Stop() {
+    thread_.task_runner()->PostTask(
+        FROM_HERE,
+        Bind(&ObserverListThreadSafe<Observer>::RemoveObserver, list_,
+             Unretained(static_cast<Observer*>(this))));
+    thread_.Stop();
+  }
+
+  int notifications() const { return notifications_; }
+  int last_value() const { return last_value_; }
+
+ private:
+  void AddObserver(WaitableEvent* added) {
+    list_->AddObserver(this);
+    added->Signal();
+  }
+
+  ObserverListThreadSafe<Observer>* list_;
+  Thread thread_;
+  int notifications_;
+  int last_value_;
+
+  DISALLOW_COPY_AND_ASSIGN(ObserverThread);
+};
+
+void MeasureNotifications(
+    int num_threads,
+    ObserverListThreadSafe<Observer>::CoalescingPolicy policy) {
+  const int kNotifications = 100000 / num_threads;
+  scoped_refptr<ObserverListThreadSafe<Observer>> list(
+      new ObserverListThreadSafe<Observer>(
+          ObserverList<Observer>::NOTIFY_ALL, policy));
+  ScopedVector<ObserverThread> threads;
+  for (int i = 0; i < num_threads; ++i)
+    threads.push_back(new ObserverThread(list.get()));
+
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 1; i <= kNotifications; ++i)
+    list->Notify(FROM_HERE, &Observer::OnChange, i);
+  const TimeDelta notify_time = TimeTicks::Now() - start;
+  int64_t delivered = 0;
+  for (ObserverThread* thread : threads) {
+    thread->Stop();
+    EXPECT_EQ(kNotifications, thread->last_value());
+    delivered += thread->notifications();
+  }
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+
+  const std::string trace =
+      std::string(policy == ObserverListThreadSafe<Observer>::KEEP_LATEST
+                      ? "KeepLatest"
+                      : "DeliverAll") +
+      "_" + IntToString(num_threads) + "threads";
+  perf_test::PrintResult("notify_time", "", trace,
+                         notify_time.InSecondsF() * 1e6 / kNotifications,
+                         "us", true);
+  perf_test::PrintResult("time_to_deliver", "", trace,
+                         elapsed.InSecondsF() * 1e6 / kNotifications, "us",
+                         true);
+  perf_test::PrintResult(
+      "deliveries", "", trace,
+      static_cast<double>(delivered) / (num_threads * kNotifications) * 100,
+      "%", true);
+}
+
+}  // namespace
+
+TEST(ObserverListThreadSafePerfTest, Notify) {
+  const int kThreadCounts[] = {1, 8, 32};
+  for (int num_threads : kThreadCounts) {
+    MeasureNotifications(num_threads,
+                         ObserverListThreadSafe<Observer>::DELIVER_ALL);
+    MeasureNotifications(num_threads,
+                         ObserverListThreadSafe<Observer>::KEEP_LATEST);
+  }
+}
+
+}  // namespace base
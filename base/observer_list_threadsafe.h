@@ -7,16 +7,22 @@
 
 #include <algorithm>
 #include <map>
+#include <utility>
+#include <vector>
 
+#include "base/atomicops.h"
 #include "base/bind.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
 #include "base/message_loop/message_loop.h"
 #include "base/observer_list.h"
 #include "base/single_thread_task_runner.h"
 #include "base/stl_util.h"
+#include "base/synchronization/lock.h"
 #include "base/thread_task_runner_handle.h"
 #include "base/threading/platform_thread.h"
 
@@ -38,6 +44,9 @@
 //    * If one thread is notifying observers concurrently with an observer
 //      removing itself from the observer list, the notifications will
 //      be silently dropped.
+//    * Optionally, notifications still pending delivery to a thread can be
+//      coalesced, so that only the latest one of each method is delivered
+//      (see CoalescingPolicy).
 //
 //   The drawback of the threadsafe observer list is that notifications
 //   are not as real-time as the non-threadsafe version of this class.
@@ -49,7 +58,10 @@
 //   The ObserverListThreadSafe maintains an ObserverList for each thread
 //   which uses the ThreadSafeObserver.  When Notifying the observers,
 //   we simply call PostTask to each registered thread, and then each thread
-//   will notify its regular ObserverList.
+//   will notify its regular ObserverList.  Notify() finds the threads in an
+//   immutable, refcounted snapshot of them, which is replaced whenever a
+//   thread is added or removed. It only holds a lock while it takes a
+//   reference to the snapshot, not the lock of the list.
 //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -73,11 +85,51 @@ class UnboundMethod {
   void Run(T* obj) const {
     DispatchToMethod(obj, m_, p_);
   }
+  Method method() const { return m_; }
  private:
   Method m_;
   Params p_;
 };
 
+// Returns an address which identifies the type |Method|.
+template <class Method>
+const void* MethodTypeTag() {
+  static const char kTag = 0;
+  return &kTag;
+}
+
+// A notification pending delivery to the observers of a thread, with the
+// KEEP_LATEST policy of ObserverListThreadSafe.
+template <class T>
+class PendingNotification {
+ public:
+  virtual ~PendingNotification() {}
+
+  // Returns true if the notification is of |*method|, whose type is
+  // identified by |method_type_tag|.
+  virtual bool IsOfMethod(const void* method_type_tag,
+                          const void* method) const = 0;
+  virtual void Run(T* obj) const = 0;
+};
+
+template <class T, class Method, class Params>
+class PendingNotificationImpl : public PendingNotification<T> {
+ public:
+  explicit PendingNotificationImpl(
+      const UnboundMethod<T, Method, Params>& method)
+      : method_(method) {}
+
+  bool IsOfMethod(const void* method_type_tag,
+                  const void* method) const override {
+    return method_type_tag == MethodTypeTag<Method>() &&
+           *static_cast<const Method*>(method) == method_.method();
+  }
+  void Run(T* obj) const override { method_.Run(obj); }
+
+ private:
+  UnboundMethod<T, Method, Params> method_;
+};
+
 }  // namespace internal
 
 // This class is used to work around VS2005 not accepting:
@@ -105,9 +157,24 @@ class ObserverListThreadSafe
   typedef typename ObserverList<ObserverType>::NotificationType
       NotificationType;
 
+  // What happens to the notifications which are still pending delivery to a
+  // thread when more are made.
+  enum CoalescingPolicy {
+    // Each notification is delivered, with a task of its own.
+    DELIVER_ALL,
+    // Only the latest pending notification of each method is delivered, after
+    // those of other methods which were made before it. A thread is posted a
+    // single task at a time, which delivers all of its pending notifications.
+    KEEP_LATEST,
+  };
+
   ObserverListThreadSafe()
-      : type_(ObserverListBase<ObserverType>::NOTIFY_ALL) {}
-  explicit ObserverListThreadSafe(NotificationType type) : type_(type) {}
+      : ObserverListThreadSafe(ObserverListBase<ObserverType>::NOTIFY_ALL) {}
+  explicit ObserverListThreadSafe(NotificationType type)
+      : ObserverListThreadSafe(type, DELIVER_ALL) {}
+  ObserverListThreadSafe(NotificationType type, CoalescingPolicy policy)
+      : type_(type),
+        policy_(policy) {}
 
   // Add an observer to the list.  An observer should not be added to
   // the same list more than once.
@@ -121,9 +188,12 @@ class ObserverListThreadSafe
     PlatformThreadId thread_id = PlatformThread::CurrentId();
     {
       AutoLock lock(list_lock_);
-      if (observer_lists_.find(thread_id) == observer_lists_.end())
-        observer_lists_[thread_id] = new ObserverListContext(type_);
-      list = &(observer_lists_[thread_id]->list);
+      scoped_refptr<ObserverListContext>& context = observer_lists_[thread_id];
+      if (!context) {
+        context = new ObserverListContext(type_);
+        UpdateSnapshotLocked();
+      }
+      list = &context->list;
     }
     list->AddObserver(obs);
   }
@@ -134,8 +204,7 @@ class ObserverListThreadSafe
   // If the observer to be removed is in the list, RemoveObserver MUST
   // be called from the same thread which called AddObserver.
   void RemoveObserver(ObserverType* obs) {
-    ObserverListContext* context = nullptr;
-    ObserverList<ObserverType>* list = nullptr;
+    scoped_refptr<ObserverListContext> context;
     PlatformThreadId thread_id = PlatformThread::CurrentId();
     {
       AutoLock lock(list_lock_);
@@ -146,20 +215,15 @@ class ObserverListThreadSafe
         return;
       }
       context = it->second;
-      list = &context->list;
 
       // If we're about to remove the last observer from the list,
       // then we can remove this observer_list entirely.
-      if (list->HasObserver(obs) && list->size() == 1)
-        observer_lists_.erase(it);
+      if (context->list.HasObserver(obs) && context->list.size() == 1)
+        RemoveContextLocked(it);
     }
-    list->RemoveObserver(obs);
-
-    // If RemoveObserver is called from a notification, the size will be
-    // nonzero.  Instead of deleting here, the NotifyWrapper will delete
-    // when it finishes iterating.
-    if (list->size() == 0)
-      delete context;
+    // If RemoveObserver is called from a notification, the notification
+    // holds on to |context| until it finishes iterating.
+    context->list.RemoveObserver(obs);
   }
 
   // Verifies that the list is currently empty (i.e. there are no observers).
@@ -177,17 +241,31 @@ class ObserverListThreadSafe
   void Notify(const tracked_objects::Location& from_here,
               Method m,
               const Params&... params) {
-    internal::UnboundMethod<ObserverType, Method, Tuple<Params...>> method(
-        m, MakeTuple(params...));
+    typedef internal::UnboundMethod<ObserverType, Method, Tuple<Params...>>
+        Unbound;
+    Unbound method(m, MakeTuple(params...));
 
-    AutoLock lock(list_lock_);
-    for (const auto& entry : observer_lists_) {
-      ObserverListContext* context = entry.second;
-      context->task_runner->PostTask(
-          from_here,
-          Bind(&ObserverListThreadSafe<ObserverType>::template NotifyWrapper<
-                  Method, Tuple<Params...>>,
-              this, context, method));
+    scoped_refptr<Snapshot> snapshot;
+    {
+      AutoLock lock(snapshot_lock_);
+      snapshot = snapshot_;
+    }
+    if (snapshot) {
+      for (const scoped_refptr<ObserverListContext>& context :
+           snapshot->data) {
+        if (policy_ == KEEP_LATEST) {
+          AddPendingNotification(
+              from_here, context, internal::MethodTypeTag<Method>(), &m,
+              make_scoped_ptr(new internal::PendingNotificationImpl<
+                              ObserverType, Method, Tuple<Params...>>(
+                  method)));
+        } else {
+          context->task_runner->PostTask(
+              from_here, Bind(&ObserverListThreadSafe<ObserverType>::
+                                  template NotifyWrapper<Unbound>,
+                              this, context, method));
+        }
+      }
     }
   }
 
@@ -195,74 +273,159 @@ class ObserverListThreadSafe
   // See comment above ObserverListThreadSafeTraits' definition.
   friend struct ObserverListThreadSafeTraits<ObserverType>;
 
-  struct ObserverListContext {
+  class ObserverListContext
+      : public RefCountedThreadSafe<ObserverListContext> {
+   public:
     explicit ObserverListContext(NotificationType type)
-        : task_runner(ThreadTaskRunnerHandle::Get()), list(type) {}
+        : task_runner(ThreadTaskRunnerHandle::Get()),
+          list(type),
+          removed(0),
+          flush_posted(false) {}
 
     scoped_refptr<SingleThreadTaskRunner> task_runner;
     ObserverList<ObserverType> list;
+    // Set once the context is removed from |observer_lists_|, after which no
+    // more notifications are delivered to it.
+    subtle::Atomic32 removed;
+
+    // With the KEEP_LATEST policy, the notifications pending delivery, and
+    // whether a task is posted to deliver them.
+    Lock pending_lock;
+    ScopedVector<internal::PendingNotification<ObserverType>> pending;
+    bool flush_posted;
 
    private:
+    friend class RefCountedThreadSafe<ObserverListContext>;
+    ~ObserverListContext() {}
+
     DISALLOW_COPY_AND_ASSIGN(ObserverListContext);
   };
 
-  ~ObserverListThreadSafe() {
-    STLDeleteValues(&observer_lists_);
+  // The contexts of all the threads, as read by Notify(). A snapshot goes
+  // away with the last Notify() which reads it.
+  typedef RefCountedData<std::vector<scoped_refptr<ObserverListContext>>>
+      Snapshot;
+
+  // Key by PlatformThreadId because in tests, clients can attempt to remove
+  // observers without a MessageLoop. If this were keyed by MessageLoop, that
+  // operation would be silently ignored, leaving garbage in the ObserverList.
+  typedef std::map<PlatformThreadId, scoped_refptr<ObserverListContext>>
+      ObserversListMap;
+
+  ~ObserverListThreadSafe() {}
+
+  // Replaces the snapshot with one of |observer_lists_|. Must be called with
+  // |list_lock_| held.
+  void UpdateSnapshotLocked() {
+    list_lock_.AssertAcquired();
+    scoped_refptr<Snapshot> snapshot(new Snapshot);
+    snapshot->data.reserve(observer_lists_.size());
+    for (const auto& entry : observer_lists_)
+      snapshot->data.push_back(entry.second);
+    // The old snapshot is released after |snapshot_lock_|, unless a Notify()
+    // still holds on to it.
+    AutoLock lock(snapshot_lock_);
+    snapshot_.swap(snapshot);
   }
 
-  // Wrapper which is called to fire the notifications for each thread's
-  // ObserverList.  This function MUST be called on the thread which owns
-  // the unsafe ObserverList.
-  template <class Method, class Params>
-  void NotifyWrapper(
-      ObserverListContext* context,
-      const internal::UnboundMethod<ObserverType, Method, Params>& method) {
-    // Check that this list still needs notifications.
-    {
-      AutoLock lock(list_lock_);
-      typename ObserversListMap::iterator it =
-          observer_lists_.find(PlatformThread::CurrentId());
+  // Removes the context at |it| from |observer_lists_|. Must be called with
+  // |list_lock_| held.
+  void RemoveContextLocked(typename ObserversListMap::iterator it) {
+    subtle::Release_Store(&it->second->removed, 1);
+    observer_lists_.erase(it);
+    UpdateSnapshotLocked();
+  }
 
-      // The ObserverList could have been removed already.  In fact, it could
-      // have been removed and then re-added!  If the master list's loop
-      // does not match this one, then we do not need to finish this
-      // notification.
-      if (it == observer_lists_.end() || it->second != context)
+  // Adds |notification|, of |*method|, to those pending delivery to
+  // |context|, in place of the one of the same method, if any, and posts a
+  // task to deliver them unless there is one already.
+  void AddPendingNotification(
+      const tracked_objects::Location& from_here,
+      const scoped_refptr<ObserverListContext>& context,
+      const void* method_type_tag,
+      const void* method,
+      scoped_ptr<internal::PendingNotification<ObserverType>> notification) {
+    {
+      AutoLock lock(context->pending_lock);
+      for (auto it = context->pending.begin(); it != context->pending.end();
+           ++it) {
+        if ((*it)->IsOfMethod(method_type_tag, method)) {
+          context->pending.erase(it);
+          break;
+        }
+      }
+      context->pending.push_back(std::move(notification));
+      if (context->flush_posted)
         return;
+      context->flush_posted = true;
+    }
+    if (!context->task_runner->PostTask(
+            from_here,
+            Bind(&ObserverListThreadSafe<ObserverType>::FlushWrapper, this,
+                 context))) {
+      // The thread is gone: the notifications stay pending, and the next one
+      // tries again.
+      AutoLock lock(context->pending_lock);
+      context->flush_posted = false;
     }
+  }
+
+  // Wrapper which is called to fire the notifications for each thread's
+  // ObserverList.  This function MUST be called on the thread which owns
+  // the unsafe ObserverList.
+  template <class Notification>
+  void NotifyWrapper(const scoped_refptr<ObserverListContext>& context,
+                     const Notification& notification) {
+    // Check that this list still needs notifications. The ObserverList could
+    // have been removed already.  In fact, it could have been removed and
+    // then re-added, with another context!
+    if (subtle::Acquire_Load(&context->removed))
+      return;
 
     {
       typename ObserverList<ObserverType>::Iterator it(&context->list);
       ObserverType* obs;
       while ((obs = it.GetNext()) != nullptr)
-        method.Run(obs);
+        notification.Run(obs);
     }
 
-    // If there are no more observers on the list, we can now delete it.
+    // If there are no more observers on the list, we can now remove it.
     if (context->list.size() == 0) {
-      {
-        AutoLock lock(list_lock_);
-        // Remove |list| if it's not already removed.
-        // This can happen if multiple observers got removed in a notification.
-        // See http://crbug.com/55725.
-        typename ObserversListMap::iterator it =
-            observer_lists_.find(PlatformThread::CurrentId());
-        if (it != observer_lists_.end() && it->second == context)
-          observer_lists_.erase(it);
-      }
-      delete context;
+      AutoLock lock(list_lock_);
+      // Remove |list| if it's not already removed.
+      // This can happen if multiple observers got removed in a notification.
+      // See http://crbug.com/55725.
+      typename ObserversListMap::iterator it =
+          observer_lists_.find(PlatformThread::CurrentId());
+      if (it != observer_lists_.end() && it->second == context)
+        RemoveContextLocked(it);
     }
   }
 
-  // Key by PlatformThreadId because in tests, clients can attempt to remove
-  // observers without a MessageLoop. If this were keyed by MessageLoop, that
-  // operation would be silently ignored, leaving garbage in the ObserverList.
-  typedef std::map<PlatformThreadId, ObserverListContext*>
-      ObserversListMap;
+  // Delivers the notifications pending delivery to |context|, with the
+  // KEEP_LATEST policy.
+  void FlushWrapper(const scoped_refptr<ObserverListContext>& context) {
+    ScopedVector<internal::PendingNotification<ObserverType>> pending;
+    {
+      AutoLock lock(context->pending_lock);
+      pending.swap(context->pending);
+      context->flush_posted = false;
+    }
+    for (const internal::PendingNotification<ObserverType>* notification :
+         pending) {
+      NotifyWrapper(context, *notification);
+    }
+  }
 
   mutable Lock list_lock_;  // Protects the observer_lists_.
   ObserversListMap observer_lists_;
   const NotificationType type_;
+  const CoalescingPolicy policy_;
+
+  // Protects |snapshot_|, the current Snapshot, which is only written with
+  // |list_lock_| held too.
+  Lock snapshot_lock_;
+  scoped_refptr<Snapshot> snapshot_;
 
   DISALLOW_COPY_AND_ASSIGN(ObserverListThreadSafe);
 };
@@ -5,14 +5,19 @@
 #include "base/observer_list.h"
 #include "base/observer_list_threadsafe.h"
 
+#include <string>
 #include <vector>
 
+#include "base/bind.h"
 #include "base/compiler_specific.h"
 #include "base/location.h"
 #include "base/memory/weak_ptr.h"
 #include "base/run_loop.h"
 #include "base/single_thread_task_runner.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/waitable_event.h"
 #include "base/threading/platform_thread.h"
+#include "base/threading/thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
@@ -364,15 +369,17 @@ TEST(ObserverListThreadSafeTest, RemoveMultipleObservers) {
 // from the observer list.  Optionally, if cross_thread_notifies is set
 // to true, the observer threads will also trigger notifications to
 // all observers.
-static void ThreadSafeObserverHarness(int num_threads,
-                                      bool cross_thread_notifies) {
+static void ThreadSafeObserverHarness(
+    int num_threads,
+    bool cross_thread_notifies,
+    ObserverListThreadSafe<Foo>::CoalescingPolicy policy) {
   MessageLoop loop;
 
   const int kMaxThreads = 15;
   num_threads = num_threads > kMaxThreads ? kMaxThreads : num_threads;
 
   scoped_refptr<ObserverListThreadSafe<Foo> > observer_list(
-      new ObserverListThreadSafe<Foo>);
+      new ObserverListThreadSafe<Foo>(ObserverList<Foo>::NOTIFY_ALL, policy));
   Adder a(1);
   Adder b(-1);
   Adder c(1);
@@ -408,13 +415,19 @@ static void ThreadSafeObserverHarness(int num_threads,
 TEST(ObserverListThreadSafeTest, CrossThreadObserver) {
   // Use 7 observer threads.  Notifications only come from
   // the main thread.
-  ThreadSafeObserverHarness(7, false);
+  ThreadSafeObserverHarness(7, false,
+                            ObserverListThreadSafe<Foo>::DELIVER_ALL);
 }
 
 TEST(ObserverListThreadSafeTest, CrossThreadNotifications) {
   // Use 3 observer threads.  Notifications will fire from
   // the main thread and all 3 observer threads.
-  ThreadSafeObserverHarness(3, true);
+  ThreadSafeObserverHarness(3, true, ObserverListThreadSafe<Foo>::DELIVER_ALL);
+}
+
+TEST(ObserverListThreadSafeTest, CrossThreadNotificationsKeepLatest) {
+  // Same as above, with coalesced notifications.
+  ThreadSafeObserverHarness(3, true, ObserverListThreadSafe<Foo>::KEEP_LATEST);
 }
 
 TEST(ObserverListThreadSafeTest, OutlivesMessageLoop) {
@@ -429,6 +442,106 @@ TEST(ObserverListThreadSafeTest, OutlivesMessageLoop) {
   observer_list->Notify(FROM_HERE, &Foo::Observe, 1);
 }
 
+class Bar {
+ public:
+  virtual void OnA(int x) = 0;
+  virtual void OnB(int x) = 0;
+  virtual ~Bar() {}
+};
+
+// Records the notifications it observes.
+class BarRecorder : public Bar {
+ public:
+  BarRecorder() {}
+  ~BarRecorder() override {}
+
+  void OnA(int x) override { Record("A", x); }
+  void OnB(int x) override { Record("B", x); }
+
+  const std::vector<std::string>& notifications() const {
+    return notifications_;
+  }
+
+ private:
+  void Record(const std::string& method, int x) {
+    notifications_.push_back(method + IntToString(x));
+  }
+
+  std::vector<std::string> notifications_;
+
+  DISALLOW_COPY_AND_ASSIGN(BarRecorder);
+};
+
+TEST(ObserverListThreadSafeTest, KeepLatest) {
+  MessageLoop loop;
+
+  scoped_refptr<ObserverListThreadSafe<Bar>> observer_list(
+      new ObserverListThreadSafe<Bar>(
+          ObserverList<Bar>::NOTIFY_ALL,
+          ObserverListThreadSafe<Bar>::KEEP_LATEST));
+  BarRecorder a;
+  BarRecorder b;
+  observer_list->AddObserver(&a);
+  observer_list->AddObserver(&b);
+
+  // Only the latest notification of each method is delivered, after those of
+  // other methods made before it.
+  observer_list->Notify(FROM_HERE, &Bar::OnA, 1);
+  observer_list->Notify(FROM_HERE, &Bar::OnB, 2);
+  observer_list->Notify(FROM_HERE, &Bar::OnA, 3);
+  observer_list->Notify(FROM_HERE, &Bar::OnA, 4);
+  RunLoop().RunUntilIdle();
+
+  const std::vector<std::string> expected = {"B2", "A4"};
+  EXPECT_EQ(expected, a.notifications());
+  EXPECT_EQ(expected, b.notifications());
+
+  // Delivered notifications are not coalesced with later ones.
+  observer_list->Notify(FROM_HERE, &Bar::OnA, 5);
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(3u, a.notifications().size());
+  EXPECT_EQ("A5", a.notifications().back());
+
+  // Pending notifications are dropped when the observer goes.
+  observer_list->Notify(FROM_HERE, &Bar::OnB, 6);
+  observer_list->RemoveObserver(&a);
+  observer_list->RemoveObserver(&b);
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(3u, a.notifications().size());
+  EXPECT_EQ(3u, b.notifications().size());
+}
+
+TEST(ObserverListThreadSafeTest, KeepLatestOnAnotherThread) {
+  scoped_refptr<ObserverListThreadSafe<Foo>> observer_list(
+      new ObserverListThreadSafe<Foo>(
+          ObserverList<Foo>::NOTIFY_ALL,
+          ObserverListThreadSafe<Foo>::KEEP_LATEST));
+  Adder a(1);
+  Thread thread("ObserverThread");
+  ASSERT_TRUE(thread.Start());
+  thread.task_runner()->PostTask(
+      FROM_HERE, Bind(&ObserverListThreadSafe<Foo>::AddObserver,
+                      observer_list, &a));
+
+  // Keep the thread busy while the notifications are made.
+  WaitableEvent added(false, false);
+  WaitableEvent notified(false, false);
+  thread.task_runner()->PostTask(
+      FROM_HERE, Bind(&WaitableEvent::Signal, Unretained(&added)));
+  thread.task_runner()->PostTask(
+      FROM_HERE, Bind(&WaitableEvent::Wait, Unretained(&notified)));
+  added.Wait();
+  for (int i = 1; i <= 1000; ++i)
+    observer_list->Notify(FROM_HERE, &Foo::Observe, i);
+  notified.Signal();
+
+  thread.task_runner()->PostTask(
+      FROM_HERE, Bind(&ObserverListThreadSafe<Foo>::RemoveObserver,
+                      observer_list, &a));
+  thread.Stop();
+  EXPECT_EQ(1000, a.total);
+}
+
 TEST(ObserverListTest, Existing) {
   ObserverList<Foo> observer_list(ObserverList<Foo>::NOTIFY_EXISTING_ONLY);
   Adder a(1);
@@ -30,9 +30,15 @@ PendingTask::PendingTask(const tracked_objects::Location& posted_from,
       is_high_res(false) {
 }
 
+PendingTask::PendingTask(const PendingTask& other) = default;
+PendingTask::PendingTask(PendingTask&& other) = default;
+
 PendingTask::~PendingTask() {
 }
 
+PendingTask& PendingTask::operator=(const PendingTask& other) = default;
+PendingTask& PendingTask::operator=(PendingTask&& other) = default;
+
 bool PendingTask::operator<(const PendingTask& other) const {
   // Since the top of a priority queue is defined as the "greatest" element, we
   // need to invert the comparison here.  We want the smaller time to be at the
@@ -24,8 +24,15 @@ struct BASE_EXPORT PendingTask : public TrackingInfo {
               const Closure& task,
               TimeTicks delayed_run_time,
               bool nestable);
+  PendingTask(const PendingTask& other);
+  // Moving a PendingTask moves its |task| without touching the reference
+  // count of the callback, which is what queues of tasks should do.
+  PendingTask(PendingTask&& other);
   ~PendingTask();
 
+  PendingTask& operator=(const PendingTask& other);
+  PendingTask& operator=(PendingTask&& other);
+
   // Used to support sorting.
   bool operator<(const PendingTask& other) const;
 
@@ -8,6 +8,7 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <vector>
 
 #include "base/files/scoped_file.h"
@@ -25,7 +26,68 @@ namespace base {
 
 const size_t UnixDomainSocket::kMaxFileDescriptors = 16;
 
+// The size of the control buffer of a received message.
+static const size_t kControlBufferSize =
+    CMSG_SPACE(sizeof(int) * UnixDomainSocket::kMaxFileDescriptors)
 #if !defined(OS_NACL_NONSFI)
+    // The PNaCl toolchain for Non-SFI binary build does not support ucred.
+    + CMSG_SPACE(sizeof(struct ucred))
+#endif
+    ;
+
+// Takes the file descriptors and the sender's process ID out of the control
+// messages of |msg|, which was received. Returns false, after closing the
+// file descriptors, if |msg| was truncated.
+static bool TakeControlMessages(struct msghdr* msg,
+                                std::vector<ScopedFD>* fds,
+                                ProcessId* out_pid) {
+  int* wire_fds = NULL;
+  unsigned wire_fds_len = 0;
+  ProcessId pid = -1;
+
+  if (msg->msg_controllen > 0) {
+    struct cmsghdr* cmsg;
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+      const unsigned payload_len = cmsg->cmsg_len - CMSG_LEN(0);
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_RIGHTS) {
+        DCHECK_EQ(payload_len % sizeof(int), 0u);
+        DCHECK_EQ(wire_fds, static_cast<void*>(nullptr));
+        wire_fds = reinterpret_cast<int*>(CMSG_DATA(cmsg));
+        wire_fds_len = payload_len / sizeof(int);
+      }
+#if !defined(OS_NACL_NONSFI)
+      // The PNaCl toolchain for Non-SFI binary build does not support
+      // SCM_CREDENTIALS.
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_CREDENTIALS) {
+        DCHECK_EQ(payload_len, sizeof(struct ucred));
+        DCHECK_EQ(pid, -1);
+        pid = reinterpret_cast<struct ucred*>(CMSG_DATA(cmsg))->pid;
+      }
+#endif
+    }
+  }
+  *out_pid = pid;
+
+  if (msg->msg_flags & MSG_TRUNC || msg->msg_flags & MSG_CTRUNC) {
+    for (unsigned i = 0; i < wire_fds_len; ++i)
+      close(wire_fds[i]);
+    return false;
+  }
+
+  if (wire_fds) {
+    for (unsigned i = 0; i < wire_fds_len; ++i)
+      fds->push_back(ScopedFD(wire_fds[i]));  // TODO(mdempsky): emplace_back
+  }
+  return true;
+}
+
+#if !defined(OS_NACL_NONSFI)
+// The maximum number of messages of a sendmmsg(2) or recvmmsg(2) call
+// (UIO_MAXIOV).
+static const size_t kMaxBatchSize = 1024;
+
 // Creates a connected pair of UNIX-domain SOCK_SEQPACKET sockets, and passes
 // ownership of the newly allocated file descriptors to |one| and |two|.
 // Returns true on success.
@@ -43,6 +105,20 @@ bool UnixDomainSocket::EnableReceiveProcessId(int fd) {
   const int enable = 1;
   return setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &enable, sizeof(enable)) == 0;
 }
+
+UnixDomainSocket::OutgoingMessage::OutgoingMessage()
+    : data(NULL), length(0) {}
+
+UnixDomainSocket::OutgoingMessage::OutgoingMessage(const void* data,
+                                                   size_t length)
+    : data(data), length(length) {}
+
+UnixDomainSocket::IncomingMessage::IncomingMessage()
+    : buffer(NULL), buffer_length(0), length(-1), pid(-1) {}
+
+UnixDomainSocket::IncomingMessage::IncomingMessage(void* buffer,
+                                                   size_t buffer_length)
+    : buffer(buffer), buffer_length(buffer_length), length(-1), pid(-1) {}
 #endif  // !defined(OS_NACL_NONSFI)
 
 // static
@@ -115,13 +191,6 @@ ssize_t UnixDomainSocket::RecvMsgWithFlags(int fd,
   msg.msg_iov = &iov;
   msg.msg_iovlen = 1;
 
-  const size_t kControlBufferSize =
-      CMSG_SPACE(sizeof(int) * kMaxFileDescriptors)
-#if !defined(OS_NACL_NONSFI)
-      // The PNaCl toolchain for Non-SFI binary build does not support ucred.
-      + CMSG_SPACE(sizeof(struct ucred))
-#endif
-      ;
   char control_buffer[kControlBufferSize];
   msg.msg_control = control_buffer;
   msg.msg_controllen = sizeof(control_buffer);
@@ -130,46 +199,12 @@ ssize_t UnixDomainSocket::RecvMsgWithFlags(int fd,
   if (r == -1)
     return -1;
 
-  int* wire_fds = NULL;
-  unsigned wire_fds_len = 0;
-  ProcessId pid = -1;
-
-  if (msg.msg_controllen > 0) {
-    struct cmsghdr* cmsg;
-    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
-      const unsigned payload_len = cmsg->cmsg_len - CMSG_LEN(0);
-      if (cmsg->cmsg_level == SOL_SOCKET &&
-          cmsg->cmsg_type == SCM_RIGHTS) {
-        DCHECK_EQ(payload_len % sizeof(int), 0u);
-        DCHECK_EQ(wire_fds, static_cast<void*>(nullptr));
-        wire_fds = reinterpret_cast<int*>(CMSG_DATA(cmsg));
-        wire_fds_len = payload_len / sizeof(int);
-      }
-#if !defined(OS_NACL_NONSFI)
-      // The PNaCl toolchain for Non-SFI binary build does not support
-      // SCM_CREDENTIALS.
-      if (cmsg->cmsg_level == SOL_SOCKET &&
-          cmsg->cmsg_type == SCM_CREDENTIALS) {
-        DCHECK_EQ(payload_len, sizeof(struct ucred));
-        DCHECK_EQ(pid, -1);
-        pid = reinterpret_cast<struct ucred*>(CMSG_DATA(cmsg))->pid;
-      }
-#endif
-    }
-  }
-
-  if (msg.msg_flags & MSG_TRUNC || msg.msg_flags & MSG_CTRUNC) {
-    for (unsigned i = 0; i < wire_fds_len; ++i)
-      close(wire_fds[i]);
+  ProcessId pid;
+  if (!TakeControlMessages(&msg, fds, &pid)) {
     errno = EMSGSIZE;
     return -1;
   }
 
-  if (wire_fds) {
-    for (unsigned i = 0; i < wire_fds_len; ++i)
-      fds->push_back(ScopedFD(wire_fds[i]));  // TODO(mdempsky): emplace_back
-  }
-
   if (out_pid) {
     // |pid| will legitimately be -1 if we read EOF, so only DCHECK if we
     // actually received a message.  Unfortunately, Linux allows sending zero
@@ -185,6 +220,115 @@ ssize_t UnixDomainSocket::RecvMsgWithFlags(int fd,
 }
 
 #if !defined(OS_NACL_NONSFI)
+// static
+size_t UnixDomainSocket::SendMsgs(int fd,
+                                  const OutgoingMessage* messages,
+                                  size_t count) {
+  std::vector<struct mmsghdr> headers;
+  std::vector<struct iovec> iovs;
+  std::vector<char> control_buffer;
+  size_t sent = 0;
+  while (sent < count) {
+    const size_t batch_size = std::min(count - sent, kMaxBatchSize);
+    headers.assign(batch_size, mmsghdr());
+    iovs.resize(batch_size);
+    size_t control_len = 0;
+    for (size_t i = 0; i < batch_size; ++i) {
+      const std::vector<int>& fds = messages[sent + i].fds;
+      if (fds.size())
+        control_len += CMSG_SPACE(sizeof(int) * fds.size());
+    }
+    control_buffer.assign(control_len, 0);
+
+    size_t control_offset = 0;
+    for (size_t i = 0; i < batch_size; ++i) {
+      const OutgoingMessage& message = messages[sent + i];
+      struct msghdr* msg = &headers[i].msg_hdr;
+      iovs[i].iov_base = const_cast<void*>(message.data);
+      iovs[i].iov_len = message.length;
+      msg->msg_iov = &iovs[i];
+      msg->msg_iovlen = 1;
+      if (message.fds.size()) {
+        const size_t fds_len = sizeof(int) * message.fds.size();
+        msg->msg_control = &control_buffer[control_offset];
+        msg->msg_controllen = CMSG_SPACE(fds_len);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(fds_len);
+        memcpy(CMSG_DATA(cmsg), &message.fds[0], fds_len);
+        msg->msg_controllen = cmsg->cmsg_len;
+        control_offset += CMSG_SPACE(fds_len);
+      }
+    }
+
+    // As in SendMsg(), avoid a SIGPIPE if the other end breaks the
+    // connection. sendmmsg(2) only fails if it could not send the first
+    // message; it stops at the first one it could not send otherwise.
+    const int r = HANDLE_EINTR(sendmmsg(fd, &headers[0], batch_size,
+                                        MSG_NOSIGNAL));
+    if (r <= 0)
+      return sent;
+    for (int i = 0; i < r; ++i) {
+      if (headers[i].msg_len != messages[sent].length) {
+        // Only part of the message was sent, which sendmmsg() does not report
+        // as an error, so set errno for the caller.
+        errno = EMSGSIZE;
+        return sent;
+      }
+      ++sent;
+    }
+  }
+  return sent;
+}
+
+// static
+ssize_t UnixDomainSocket::RecvMsgs(int fd,
+                                   IncomingMessage* messages,
+                                   size_t count) {
+  count = std::min(count, kMaxBatchSize);
+  std::vector<struct mmsghdr> headers(count);
+  std::vector<struct iovec> iovs(count);
+  std::vector<char> control_buffer(count * kControlBufferSize);
+  for (size_t i = 0; i < count; ++i) {
+    struct msghdr* msg = &headers[i].msg_hdr;
+    iovs[i].iov_base = messages[i].buffer;
+    iovs[i].iov_len = messages[i].buffer_length;
+    msg->msg_iov = &iovs[i];
+    msg->msg_iovlen = 1;
+    msg->msg_control = &control_buffer[i * kControlBufferSize];
+    msg->msg_controllen = kControlBufferSize;
+  }
+
+  // MSG_WAITFORONE only waits for the first message.
+  const int r =
+      HANDLE_EINTR(recvmmsg(fd, &headers[0], count, MSG_WAITFORONE, NULL));
+  if (r == -1)
+    return -1;
+
+  // Once the other end is closed, every message reads as one of length 0, as
+  // in RecvMsg(). Those which end the batch are reported as a single one.
+  int received = r;
+  while (received > 1 && headers[received - 1].msg_len == 0 &&
+         headers[received - 1].msg_hdr.msg_controllen == 0 &&
+         headers[received - 2].msg_len == 0 &&
+         headers[received - 2].msg_hdr.msg_controllen == 0) {
+    --received;
+  }
+
+  for (int i = 0; i < received; ++i) {
+    IncomingMessage* message = &messages[i];
+    message->fds.clear();
+    if (TakeControlMessages(&headers[i].msg_hdr, &message->fds,
+                            &message->pid)) {
+      message->length = headers[i].msg_len;
+    } else {
+      message->length = -1;
+    }
+  }
+  return received;
+}
+
 // static
 ssize_t UnixDomainSocket::SendRecvMsg(int fd,
                                       uint8_t* reply,
@@ -24,6 +24,39 @@ class BASE_EXPORT UnixDomainSocket {
   // Maximum number of file descriptors that can be read by RecvMsg().
   static const size_t kMaxFileDescriptors;
 
+#if !defined(OS_NACL_NONSFI)
+  // A message to send with SendMsgs().
+  struct BASE_EXPORT OutgoingMessage {
+    OutgoingMessage();
+    OutgoingMessage(const void* data, size_t length);
+
+    const void* data;
+    size_t length;
+    // The file descriptors to send along with the message.
+    std::vector<int> fds;
+  };
+
+  // A message received by RecvMsgs().
+  struct BASE_EXPORT IncomingMessage {
+    IncomingMessage();
+    IncomingMessage(void* buffer, size_t buffer_length);
+
+    // The buffer to read the message into.
+    void* buffer;
+    size_t buffer_length;
+
+    // The length of the message, 0 at the end of the stream, or -1 if it did
+    // not fit in |buffer|, or came with more than |kMaxFileDescriptors| file
+    // descriptors.
+    ssize_t length;
+    // The file descriptors which came along with the message.
+    std::vector<ScopedFD> fds;
+    // The process ID of the sender, as with RecvMsgWithPid(); -1 if
+    // EnableReceiveProcessId() was not called on the receiving socket.
+    ProcessId pid;
+  };
+#endif  // !defined(OS_NACL_NONSFI)
+
 #if !defined(OS_NACL_NONSFI)
   // Use to enable receiving process IDs in RecvMsgWithPid.  Should be called on
   // the receiving socket (i.e., the socket passed to RecvMsgWithPid). Returns
@@ -56,6 +89,19 @@ class BASE_EXPORT UnixDomainSocket {
                                 ProcessId* pid);
 
 #if !defined(OS_NACL_NONSFI)
+  // Uses sendmmsg to write |count| messages, each with its own file
+  // descriptors, in as few system calls as possible. Returns the number of
+  // messages sent: if it is less than |count|, errno tells why the next one
+  // could not be.
+  static size_t SendMsgs(int fd, const OutgoingMessage* messages, size_t count);
+
+  // Uses recvmmsg to read up to |count| messages in a single system call. It
+  // waits for the first message only, and reads those which follow it if they
+  // have already arrived. Returns the number of messages read, or -1 on
+  // failure. At the end of the stream, every message reads as one of length
+  // 0: those which end the batch are reported as a single one.
+  static ssize_t RecvMsgs(int fd, IncomingMessage* messages, size_t count);
+
   // Perform a sendmsg/recvmsg pair.
   //   1. This process creates a UNIX SEQPACKET socketpair. Using
   //      connection-oriented sockets (SEQPACKET or STREAM) is critical here,
@@ -0,0 +1,153 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/posix/unix_domain_socket_linux.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <string>
+#include <vector>
+
+#include "base/files/scoped_file.h"
+#include "base/macros.h"
+#include "base/pickle.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const int kBursts = 200;
+const size_t kBurstSize = 1000;
+const char kAck = 'a';
+
+// Sends |kBursts| bursts of |kBurstSize| small Pickle messages, each with
+// |fds_per_message| file descriptors, and waits for each burst to be
+// acknowledged before sending the next one.
+class BurstSender : public DelegateSimpleThread::Delegate {
+ public:
+  BurstSender(int socket, bool batched, size_t fds_per_message)
+      : socket_(socket),
+        batched_(batched),
+        fds_per_message_(fds_per_message),
+        thread_(this, "BurstSender") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    std::vector<Pickle> pickles(kBurstSize);
+    std::vector<UnixDomainSocket::OutgoingMessage> messages;
+    const std::vector<int> fds(fds_per_message_, socket_);
+    for (size_t i = 0; i < kBurstSize; ++i) {
+      pickles[i].WriteInt(static_cast<int>(i));
+      pickles[i].WriteString("request");
+      messages.push_back(UnixDomainSocket::OutgoingMessage(
+          pickles[i].data(), pickles[i].size()));
+      messages.back().fds = fds;
+    }
+
+    for (int burst = 0; burst < kBursts; ++burst) {
+      if (batched_) {
+        ASSERT_EQ(kBurstSize, UnixDomainSocket::SendMsgs(
+                                  socket_, &messages[0], messages.size()));
+      } else {
+        for (size_t i = 0; i < kBurstSize; ++i) {
+          ASSERT_TRUE(UnixDomainSocket::SendMsg(socket_, messages[i].data,
+                                                messages[i].length, fds));
+        }
+      }
+      char ack;
+      std::vector<ScopedFD> ack_fds;
+      ASSERT_EQ(1, UnixDomainSocket::RecvMsg(socket_, &ack, sizeof(ack),
+                                             &ack_fds));
+    }
+  }
+
+  void Join() { thread_.Join(); }
+
+ private:
+  const int socket_;
+  const bool batched_;
+  const size_t fds_per_message_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(BurstSender);
+};
+
+// Receives the bursts of a BurstSender, one message or one batch of messages
+// per system call, and reports the throughput and the number of system calls
+// it took.
+void MeasureBursts(bool batched, size_t fds_per_message) {
+  int raw_socks[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, raw_socks));
+  ScopedFD recv_sock(raw_socks[0]);
+  ScopedFD send_sock(raw_socks[1]);
+  ASSERT_TRUE(UnixDomainSocket::EnableReceiveProcessId(recv_sock.get()));
+
+  const size_t kBufferSize = 64;
+  std::vector<char> buffers(kBurstSize * kBufferSize);
+  std::vector<UnixDomainSocket::IncomingMessage> messages;
+  for (size_t i = 0; i < kBurstSize; ++i) {
+    messages.push_back(UnixDomainSocket::IncomingMessage(
+        &buffers[i * kBufferSize], kBufferSize));
+  }
+
+  const TimeTicks start = TimeTicks::Now();
+  BurstSender sender(send_sock.get(), batched, fds_per_message);
+  int64_t receive_calls = 0;
+  for (int burst = 0; burst < kBursts; ++burst) {
+    size_t received = 0;
+    while (received < kBurstSize) {
+      if (batched) {
+        const ssize_t r = UnixDomainSocket::RecvMsgs(
+            recv_sock.get(), &messages[0], kBurstSize - received);
+        ASSERT_GT(r, 0);
+        received += r;
+      } else {
+        UnixDomainSocket::IncomingMessage* message = &messages[0];
+        message->length = UnixDomainSocket::RecvMsgWithPid(
+            recv_sock.get(), message->buffer, message->buffer_length,
+            &message->fds, &message->pid);
+        ASSERT_GT(message->length, 0);
+        ++received;
+      }
+      ++receive_calls;
+    }
+    ASSERT_TRUE(UnixDomainSocket::SendMsg(recv_sock.get(), &kAck,
+                                          sizeof(kAck), std::vector<int>()));
+  }
+  sender.Join();
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+
+  // A batch is sent with a single sendmmsg(2) call.
+  const int64_t send_calls = batched ? kBursts : kBursts * kBurstSize;
+  std::string trace = batched ? "Batched" : "OneByOne";
+  if (fds_per_message)
+    trace += "_fd";
+  perf_test::PrintResult("throughput", "", trace,
+                         kBursts * kBurstSize / elapsed.InSecondsF(),
+                         "messages/s", true);
+  perf_test::PrintResult("time_per_burst", "", trace,
+                         elapsed.InSecondsF() * 1e6 / kBursts, "us", true);
+  perf_test::PrintResult(
+      "system_calls_per_burst", "", trace,
+      static_cast<double>(send_calls + receive_calls) / kBursts, "calls",
+      true);
+}
+
+}  // namespace
+
+TEST(UnixDomainSocketPerfTest, Bursts) {
+  MeasureBursts(false, 0);
+  MeasureBursts(true, 0);
+  MeasureBursts(false, 1);
+  MeasureBursts(true, 1);
+}
+
+}  // namespace base
@@ -4,15 +4,19 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <vector>
+
 #include "base/bind.h"
 #include "base/bind_helpers.h"
 #include "base/files/file_util.h"
 #include "base/files/scoped_file.h"
 #include "base/location.h"
+#include "base/macros.h"
 #include "base/pickle.h"
 #include "base/posix/unix_domain_socket_linux.h"
 #include "base/single_thread_task_runner.h"
@@ -157,6 +161,146 @@ TEST(UnixDomianSocketTest, RecvPidDisconnectedSocket) {
   ASSERT_EQ(0U, recv_fds.size());
 }
 
+TEST(UnixDomainSocketTest, SendRecvMsgs) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+  ScopedFD recv_sock(fds[0]);
+  ScopedFD send_sock(fds[1]);
+
+  ASSERT_TRUE(UnixDomainSocket::EnableReceiveProcessId(recv_sock.get()));
+
+  // Each message comes with as many file descriptors as its index.
+  static const char kMessages[][8] = {"zero", "one", "two"};
+  std::vector<UnixDomainSocket::OutgoingMessage> messages;
+  for (size_t i = 0; i < arraysize(kMessages); ++i) {
+    messages.push_back(UnixDomainSocket::OutgoingMessage(
+        kMessages[i], strlen(kMessages[i])));
+    messages.back().fds.assign(i, send_sock.get());
+  }
+  ASSERT_EQ(messages.size(), UnixDomainSocket::SendMsgs(
+                                 send_sock.get(), &messages[0],
+                                 messages.size()));
+
+  // Read them with room for more: only those which arrived are read.
+  char buffers[5][8];
+  std::vector<UnixDomainSocket::IncomingMessage> received;
+  for (size_t i = 0; i < arraysize(buffers); ++i) {
+    received.push_back(UnixDomainSocket::IncomingMessage(
+        buffers[i], sizeof(buffers[i])));
+  }
+  ASSERT_EQ(static_cast<ssize_t>(arraysize(kMessages)),
+            UnixDomainSocket::RecvMsgs(recv_sock.get(), &received[0],
+                                       received.size()));
+  for (size_t i = 0; i < arraysize(kMessages); ++i) {
+    ASSERT_EQ(static_cast<ssize_t>(strlen(kMessages[i])),
+              received[i].length);
+    EXPECT_EQ(0, memcmp(kMessages[i], buffers[i], received[i].length));
+    EXPECT_EQ(i, received[i].fds.size());
+    EXPECT_EQ(getpid(), received[i].pid);
+  }
+}
+
+TEST(UnixDomainSocketTest, RecvMsgsTruncated) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+  ScopedFD recv_sock(fds[0]);
+  ScopedFD send_sock(fds[1]);
+
+  static const char kLong[] = "too long";
+  static const char kShort[] = "short";
+  UnixDomainSocket::OutgoingMessage messages[] = {
+      UnixDomainSocket::OutgoingMessage(kLong, sizeof(kLong)),
+      UnixDomainSocket::OutgoingMessage(kShort, sizeof(kShort))};
+  messages[0].fds.push_back(send_sock.get());
+  ASSERT_EQ(2U, UnixDomainSocket::SendMsgs(send_sock.get(), messages, 2));
+
+  char buffers[2][sizeof(kShort)];
+  UnixDomainSocket::IncomingMessage received[] = {
+      UnixDomainSocket::IncomingMessage(buffers[0], sizeof(buffers[0])),
+      UnixDomainSocket::IncomingMessage(buffers[1], sizeof(buffers[1]))};
+  ASSERT_EQ(2, UnixDomainSocket::RecvMsgs(recv_sock.get(), received, 2));
+  EXPECT_EQ(-1, received[0].length);
+  EXPECT_EQ(0U, received[0].fds.size());
+  EXPECT_EQ(static_cast<ssize_t>(sizeof(kShort)), received[1].length);
+  EXPECT_EQ(0, memcmp(kShort, buffers[1], sizeof(kShort)));
+  EXPECT_EQ(-1, received[1].pid);
+}
+
+// Check that the end of the stream ends a batch with a single message of
+// length 0.
+TEST(UnixDomainSocketTest, RecvMsgsDisconnectedSocket) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+  ScopedFD recv_sock(fds[0]);
+  ScopedFD send_sock(fds[1]);
+
+  static const char kHello[] = "hello";
+  ASSERT_TRUE(UnixDomainSocket::SendMsg(
+      send_sock.get(), kHello, sizeof(kHello), std::vector<int>()));
+  send_sock.reset();
+
+  char buffers[4][sizeof(kHello)];
+  std::vector<UnixDomainSocket::IncomingMessage> received;
+  for (size_t i = 0; i < arraysize(buffers); ++i) {
+    received.push_back(UnixDomainSocket::IncomingMessage(
+        buffers[i], sizeof(buffers[i])));
+  }
+  ASSERT_EQ(2, UnixDomainSocket::RecvMsgs(recv_sock.get(), &received[0],
+                                          received.size()));
+  EXPECT_EQ(static_cast<ssize_t>(sizeof(kHello)), received[0].length);
+  EXPECT_EQ(0, received[1].length);
+  EXPECT_EQ(-1, received[1].pid);
+
+  ASSERT_EQ(1, UnixDomainSocket::RecvMsgs(recv_sock.get(), &received[0],
+                                          received.size()));
+  EXPECT_EQ(0, received[0].length);
+}
+
+// Sends more messages than a single system call takes, and than the socket
+// buffer holds.
+TEST(UnixDomainSocketTest, SendRecvMsgsLargeBatch) {
+  Thread message_thread("UnixDomainSocketTest");
+  ASSERT_TRUE(message_thread.Start());
+
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+  ScopedFD recv_sock(fds[0]);
+  ScopedFD send_sock(fds[1]);
+
+  const size_t kCount = 3000;
+  std::vector<uint32_t> values(kCount);
+  std::vector<UnixDomainSocket::OutgoingMessage> messages;
+  for (size_t i = 0; i < kCount; ++i) {
+    values[i] = i;
+    messages.push_back(
+        UnixDomainSocket::OutgoingMessage(&values[i], sizeof(values[i])));
+  }
+  messages[kCount / 2].fds.push_back(send_sock.get());
+  message_thread.task_runner()->PostTask(
+      FROM_HERE, Bind(IgnoreResult(&UnixDomainSocket::SendMsgs),
+                      send_sock.get(), &messages[0], kCount));
+
+  std::vector<uint32_t> received_values(kCount);
+  std::vector<UnixDomainSocket::IncomingMessage> received;
+  for (size_t i = 0; i < kCount; ++i) {
+    received.push_back(UnixDomainSocket::IncomingMessage(
+        &received_values[i], sizeof(received_values[i])));
+  }
+  size_t count = 0;
+  while (count < kCount) {
+    const ssize_t r = UnixDomainSocket::RecvMsgs(
+        recv_sock.get(), &received[count], kCount - count);
+    ASSERT_GT(r, 0);
+    for (ssize_t i = 0; i < r; ++i, ++count) {
+      ASSERT_EQ(static_cast<ssize_t>(sizeof(uint32_t)),
+                received[count].length);
+      EXPECT_EQ(count, received_values[count]);
+      EXPECT_EQ(count == kCount / 2 ? 1U : 0U, received[count].fds.size());
+    }
+  }
+  message_thread.Stop();
+}
+
 }  // namespace
 
 }  // namespace base
@@ -0,0 +1,487 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/process_metrics_sampler_linux.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/atomic_ref_count.h"
+#include "base/containers/hash_tables.h"
+#include "base/logging.h"
+#include "base/memory/scoped_vector.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/process/internal_linux.h"
+#include "base/strings/string_util.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "base/threading/thread_restrictions.h"
+
+namespace base {
+
+namespace {
+
+// Large enough for the fields we parse from each of the sampled files,
+// including /proc/<pid>/status with a long list of supplementary groups. Only
+// the first 24 fields of /proc/<pid>/stat are used, so it does not matter if
+// the tail of that file does not fit.
+const size_t kReadBufferSize = 4096;
+
+// Below this many processes per thread it is cheaper to sample everything on
+// the calling thread than to hand it to the worker threads.
+const size_t kMinProcessesPerThread = 64;
+
+// Work is split into this many chunks per thread, so that threads which
+// happen to get cheap processes pick up more work.
+const size_t kChunksPerThread = 4;
+
+int OpenProcFile(ProcessId pid, const char* name) {
+  char path[64];
+  snprintf(path, sizeof(path), "%s/%d/%s", internal::kProcDir,
+           static_cast<int>(pid), name);
+  return HANDLE_EINTR(open(path, O_RDONLY | O_CLOEXEC));
+}
+
+// Opens the rollup of /proc/<pid>/smaps: totmaps, which Chrome OS kernels
+// have, or smaps_rollup, its upstream equivalent.
+int OpenProcTotmapsFile(ProcessId pid) {
+  int fd = OpenProcFile(pid, "totmaps");
+  if (fd < 0 && errno == ENOENT)
+    fd = OpenProcFile(pid, "smaps_rollup");
+  return fd;
+}
+
+void CloseProcFile(int* fd) {
+  if (*fd < 0)
+    return;
+  if (IGNORE_EINTR(close(*fd)) < 0)
+    DPLOG(ERROR) << "close";
+  *fd = -1;
+}
+
+// Reads the whole of the /proc file |fd| into |buffer|. Returns the contents,
+// or an empty StringPiece on failure (e.g. ESRCH once the process has exited).
+StringPiece ReadProcFile(int fd, char* buffer, size_t buffer_size) {
+  if (fd < 0)
+    return StringPiece();
+  ssize_t length = HANDLE_EINTR(pread(fd, buffer, buffer_size, 0));
+  if (length <= 0)
+    return StringPiece();
+  return StringPiece(buffer, static_cast<size_t>(length));
+}
+
+// Parses the unsigned decimal number at |*pos| in |data| and advances |*pos|
+// past it. Returns false if there is no number at |*pos|.
+bool ScanUint64(StringPiece data, size_t* pos, uint64_t* value) {
+  size_t i = *pos;
+  uint64_t result = 0;
+  while (i < data.size() && IsAsciiDigit(data[i])) {
+    result = result * 10 + static_cast<uint64_t>(data[i] - '0');
+    ++i;
+  }
+  if (i == *pos)
+    return false;
+  *pos = i;
+  *value = result;
+  return true;
+}
+
+// Advances |*pos| past any spaces and tabs.
+void SkipBlanks(StringPiece data, size_t* pos) {
+  while (*pos < data.size() && (data[*pos] == ' ' || data[*pos] == '\t'))
+    ++*pos;
+}
+
+// Parses the "key: value" lines of |data|, such as /proc/<pid>/io, storing
+// the number starting the value of |keys[i]| to |*values[i]|; a unit after it,
+// e.g. "kB", is ignored. Returns false if any of the |num_keys| keys is
+// missing or its value is not a number.
+bool ParseProcKeyValues(StringPiece data,
+                        const char* const* keys,
+                        uint64_t* const* values,
+                        size_t num_keys) {
+  DCHECK_LT(num_keys, 32u);
+  uint32_t found = 0;
+  size_t line_start = 0;
+  while (line_start < data.size()) {
+    size_t line_end = data.find('\n', line_start);
+    if (line_end == StringPiece::npos)
+      line_end = data.size();
+    size_t colon = data.find(':', line_start);
+    if (colon < line_end) {
+      StringPiece key = data.substr(line_start, colon - line_start);
+      for (size_t i = 0; i < num_keys; ++i) {
+        if (key != keys[i])
+          continue;
+        size_t pos = colon + 1;
+        SkipBlanks(data, &pos);
+        if (!ScanUint64(data, &pos, values[i]))
+          return false;
+        found |= 1u << i;
+        break;
+      }
+    }
+    line_start = line_end + 1;
+  }
+  return found == (1u << num_keys) - 1;
+}
+
+}  // namespace
+
+namespace internal {
+
+bool ParseProcStatForSampler(StringPiece data,
+                             uint64_t* cpu_ticks,
+                             uint64_t* num_threads,
+                             uint64_t* start_time,
+                             uint64_t* vsize_bytes) {
+  // The stat file is formatted as:
+  // pid (process name) data1 data2 .... dataN
+  // Look for the closing paren by scanning backwards, to avoid being fooled by
+  // processes with ')' in the name.
+  size_t close_parens_idx = data.rfind(')');
+  if (close_parens_idx == StringPiece::npos)
+    return false;
+
+  uint64_t utime = 0;
+  uint64_t stime = 0;
+  size_t pos = close_parens_idx + 1;
+  // VM_STATE is the first field after the process name.
+  for (int field = VM_STATE; field <= VM_RSS; ++field) {
+    SkipBlanks(data, &pos);
+    if (pos >= data.size())
+      return false;
+
+    uint64_t* target = nullptr;
+    switch (field) {
+      case VM_UTIME:
+        target = &utime;
+        break;
+      case VM_STIME:
+        target = &stime;
+        break;
+      case VM_NUMTHREADS:
+        target = num_threads;
+        break;
+      case VM_STARTTIME:
+        target = start_time;
+        break;
+      case VM_VSIZE:
+        target = vsize_bytes;
+        break;
+    }
+    if (target) {
+      if (!ScanUint64(data, &pos, target))
+        return false;
+    } else {
+      // Skip fields we are not interested in, some of which are negative or
+      // non-numeric.
+      while (pos < data.size() && data[pos] != ' ' && data[pos] != '\n')
+        ++pos;
+    }
+  }
+  *cpu_ticks = utime + stime;
+  return true;
+}
+
+bool ParseProcStatmForSampler(StringPiece data,
+                              uint64_t* resident_pages,
+                              uint64_t* shared_pages) {
+  // The format of /proc/<pid>/statm is:
+  // size resident shared text lib data dt
+  uint64_t size;
+  size_t pos = 0;
+  if (!ScanUint64(data, &pos, &size))
+    return false;
+  SkipBlanks(data, &pos);
+  if (!ScanUint64(data, &pos, resident_pages))
+    return false;
+  SkipBlanks(data, &pos);
+  return ScanUint64(data, &pos, shared_pages);
+}
+
+bool ParseProcIoForSampler(StringPiece data,
+                           uint64_t* read_chars,
+                           uint64_t* write_chars,
+                           uint64_t* read_syscalls,
+                           uint64_t* write_syscalls) {
+  // The format of /proc/<pid>/io is:
+  //
+  // rchar: 3263542
+  // wchar: 41298
+  // syscr: 4004
+  // syscw: 412
+  // read_bytes: 8192
+  // ...
+  const char* const kKeys[] = {"rchar", "wchar", "syscr", "syscw"};
+  uint64_t* const values[] = {read_chars, write_chars, read_syscalls,
+                              write_syscalls};
+  return ParseProcKeyValues(data, kKeys, values, arraysize(kKeys));
+}
+
+bool ParseProcStatusForSampler(StringPiece data,
+                               uint64_t* vm_rss_kb,
+                               uint64_t* vm_hwm_kb,
+                               uint64_t* vm_swap_kb) {
+  // The format of /proc/<pid>/status is:
+  //
+  // Name:   cat
+  // ...
+  // VmHWM:       704 kB
+  // VmRSS:       704 kB
+  // ...
+  // VmSwap:        0 kB
+  // ...
+  //
+  // Kernel threads, which have no memory of their own, have no Vm lines.
+  const char* const kKeys[] = {"VmRSS", "VmHWM", "VmSwap"};
+  uint64_t* const values[] = {vm_rss_kb, vm_hwm_kb, vm_swap_kb};
+  return ParseProcKeyValues(data, kKeys, values, arraysize(kKeys));
+}
+
+bool ParseProcTotmapsForSampler(StringPiece data,
+                                uint64_t* pss_kb,
+                                uint64_t* private_kb,
+                                uint64_t* swap_kb) {
+  // The format of /proc/<pid>/totmaps is that of an entry of
+  // /proc/<pid>/smaps, without the mapping line:
+  //
+  // Rss:                6120 kB
+  // Pss:                3335 kB
+  // Shared_Clean:       1008 kB
+  // Shared_Dirty:       4012 kB
+  // Private_Clean:         4 kB
+  // Private_Dirty:      1096 kB
+  // ...
+  // Swap:                  0 kB
+  // ...
+  //
+  // smaps_rollup has a summary mapping line first, which matches no key.
+  const char* const kKeys[] = {"Pss", "Private_Clean", "Private_Dirty",
+                               "Swap"};
+  uint64_t private_clean_kb;
+  uint64_t private_dirty_kb;
+  uint64_t* const values[] = {pss_kb, &private_clean_kb, &private_dirty_kb,
+                              swap_kb};
+  if (!ParseProcKeyValues(data, kKeys, values, arraysize(kKeys)))
+    return false;
+  *private_kb = private_clean_kb + private_dirty_kb;
+  return true;
+}
+
+}  // namespace internal
+
+ProcessMetricsSnapshot::ProcessMetricsSnapshot() {}
+
+ProcessMetricsSnapshot::~ProcessMetricsSnapshot() {}
+
+void ProcessMetricsSnapshot::Reset(size_t size) {
+  pids.assign(size, 0);
+  valid_fields.assign(size, 0);
+  cpu_ticks.assign(size, 0);
+  num_threads.assign(size, 0);
+  start_time.assign(size, 0);
+  vsize_bytes.assign(size, 0);
+  resident_pages.assign(size, 0);
+  shared_pages.assign(size, 0);
+  read_chars.assign(size, 0);
+  write_chars.assign(size, 0);
+  read_syscalls.assign(size, 0);
+  write_syscalls.assign(size, 0);
+  vm_rss_kb.assign(size, 0);
+  vm_hwm_kb.assign(size, 0);
+  vm_swap_kb.assign(size, 0);
+  pss_kb.assign(size, 0);
+  private_kb.assign(size, 0);
+  swap_kb.assign(size, 0);
+}
+
+class ProcessMetricsSampler::Worker : public DelegateSimpleThread::Delegate {
+ public:
+  // The last of the workers sharing |num_pending| to finish signals |done|.
+  Worker(ProcessMetricsSampler* sampler,
+         size_t begin,
+         size_t end,
+         ProcessMetricsSnapshot* snapshot,
+         AtomicRefCount* num_pending,
+         WaitableEvent* done)
+      : sampler_(sampler),
+        begin_(begin),
+        end_(end),
+        snapshot_(snapshot),
+        num_pending_(num_pending),
+        done_(done) {}
+
+  void Run() override {
+    sampler_->SampleRange(begin_, end_, snapshot_);
+    if (!AtomicRefCountDec(num_pending_))
+      done_->Signal();
+  }
+
+ private:
+  ProcessMetricsSampler* const sampler_;
+  const size_t begin_;
+  const size_t end_;
+  ProcessMetricsSnapshot* const snapshot_;
+  AtomicRefCount* const num_pending_;
+  WaitableEvent* const done_;
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+ProcessMetricsSampler::ProcessMetricsSampler(uint32_t fields, int num_threads)
+    : fields_(fields), num_threads_(std::max(num_threads, 1)) {
+  DCHECK_EQ(0u, fields & ~static_cast<uint32_t>(ALL_FIELDS));
+}
+
+ProcessMetricsSampler::~ProcessMetricsSampler() {
+  if (pool_) {
+    ThreadRestrictions::ScopedAllowIO allow_io;
+    pool_->JoinAll();
+  }
+  SetProcesses(std::vector<ProcessId>());
+}
+
+void ProcessMetricsSampler::SetProcesses(const std::vector<ProcessId>& pids) {
+  // Opening files in /proc does not hit the disk.
+  ThreadRestrictions::ScopedAllowIO allow_io;
+
+  hash_map<ProcessId, size_t> old_indices;
+  for (size_t i = 0; i < entries_.size(); ++i)
+    old_indices[entries_[i].pid] = i;
+
+#if DCHECK_IS_ON()
+  hash_set<ProcessId> new_pids;
+#endif
+  std::vector<Entry> new_entries(pids.size());
+  for (size_t i = 0; i < pids.size(); ++i) {
+#if DCHECK_IS_ON()
+    DCHECK(new_pids.insert(pids[i]).second) << "Duplicate pid " << pids[i];
+#endif
+    Entry& entry = new_entries[i];
+    auto it = old_indices.find(pids[i]);
+    if (it != old_indices.end()) {
+      // Steal the already open files.
+      Entry& old_entry = entries_[it->second];
+      entry = old_entry;
+      old_entry.stat_fd = old_entry.statm_fd = old_entry.io_fd = -1;
+      old_entry.status_fd = old_entry.totmaps_fd = -1;
+      old_entry.pid = kNullProcessId;
+      continue;
+    }
+    entry.pid = pids[i];
+    entry.stat_fd =
+        (fields_ & STAT) ? OpenProcFile(pids[i], internal::kStatFile) : -1;
+    entry.statm_fd = (fields_ & STATM) ? OpenProcFile(pids[i], "statm") : -1;
+    entry.io_fd = (fields_ & IO) ? OpenProcFile(pids[i], "io") : -1;
+    entry.status_fd =
+        (fields_ & STATUS) ? OpenProcFile(pids[i], "status") : -1;
+    entry.totmaps_fd =
+        (fields_ & TOTMAPS) ? OpenProcTotmapsFile(pids[i]) : -1;
+  }
+
+  for (Entry& entry : entries_) {
+    CloseProcFile(&entry.stat_fd);
+    CloseProcFile(&entry.statm_fd);
+    CloseProcFile(&entry.io_fd);
+    CloseProcFile(&entry.status_fd);
+    CloseProcFile(&entry.totmaps_fd);
+  }
+  entries_.swap(new_entries);
+}
+
+void ProcessMetricsSampler::Sample(ProcessMetricsSnapshot* snapshot) {
+  // Synchronously reading files in /proc does not hit the disk, and waiting
+  // for the workers is bounded by that.
+  ThreadRestrictions::ScopedAllowIO allow_io;
+
+  const size_t size = entries_.size();
+  snapshot->Reset(size);
+  for (size_t i = 0; i < size; ++i)
+    snapshot->pids[i] = entries_[i].pid;
+
+  size_t num_threads = std::min(static_cast<size_t>(num_threads_),
+                                size / kMinProcessesPerThread);
+  if (num_threads <= 1) {
+    SampleRange(0, size, snapshot);
+    return;
+  }
+
+  size_t num_chunks = num_threads * kChunksPerThread;
+  size_t chunk_size = (size + num_chunks - 1) / num_chunks;
+  if (!pool_) {
+    pool_.reset(new DelegateSimpleThreadPool("ProcessMetricsSampler",
+                                             num_threads_));
+    pool_->Start();
+  }
+
+  ScopedVector<Worker> workers;
+  AtomicRefCount num_pending =
+      static_cast<AtomicRefCount>((size + chunk_size - 1) / chunk_size);
+  WaitableEvent done(false, false);
+  for (size_t begin = 0; begin < size; begin += chunk_size) {
+    workers.push_back(new Worker(this, begin,
+                                 std::min(begin + chunk_size, size), snapshot,
+                                 &num_pending, &done));
+    pool_->AddWork(workers.back());
+  }
+  done.Wait();
+}
+
+void ProcessMetricsSampler::SampleRange(size_t begin,
+                                        size_t end,
+                                        ProcessMetricsSnapshot* snapshot) {
+  char buffer[kReadBufferSize];
+  for (size_t i = begin; i < end; ++i) {
+    const Entry& entry = entries_[i];
+    uint32_t valid = 0;
+
+    StringPiece data = ReadProcFile(entry.stat_fd, buffer, sizeof(buffer));
+    if (!data.empty() &&
+        internal::ParseProcStatForSampler(
+            data, &snapshot->cpu_ticks[i], &snapshot->num_threads[i],
+            &snapshot->start_time[i], &snapshot->vsize_bytes[i])) {
+      valid |= STAT;
+    }
+
+    data = ReadProcFile(entry.statm_fd, buffer, sizeof(buffer));
+    if (!data.empty() &&
+        internal::ParseProcStatmForSampler(data, &snapshot->resident_pages[i],
+                                           &snapshot->shared_pages[i])) {
+      valid |= STATM;
+    }
+
+    data = ReadProcFile(entry.io_fd, buffer, sizeof(buffer));
+    if (!data.empty() &&
+        internal::ParseProcIoForSampler(
+            data, &snapshot->read_chars[i], &snapshot->write_chars[i],
+            &snapshot->read_syscalls[i], &snapshot->write_syscalls[i])) {
+      valid |= IO;
+    }
+
+    data = ReadProcFile(entry.status_fd, buffer, sizeof(buffer));
+    if (!data.empty() &&
+        internal::ParseProcStatusForSampler(data, &snapshot->vm_rss_kb[i],
+                                            &snapshot->vm_hwm_kb[i],
+                                            &snapshot->vm_swap_kb[i])) {
+      valid |= STATUS;
+    }
+
+    data = ReadProcFile(entry.totmaps_fd, buffer, sizeof(buffer));
+    if (!data.empty() &&
+        internal::ParseProcTotmapsForSampler(data, &snapshot->pss_kb[i],
+                                             &snapshot->private_kb[i],
+                                             &snapshot->swap_kb[i])) {
+      valid |= TOTMAPS;
+    }
+
+    snapshot->valid_fields[i] = valid;
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,183 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Bulk sampling of /proc statistics for many processes at once. Unlike
+// ProcessMetrics, which re-opens and re-reads the /proc files on every call
+// and splits them into strings, ProcessMetricsSampler keeps the /proc files
+// of every tracked process open, re-reads them with pread() and parses them
+// in place without allocating. Processes can be sampled in parallel on a
+// small pool of worker threads.
+
+#ifndef BASE_PROCESS_PROCESS_METRICS_SAMPLER_LINUX_H_
+#define BASE_PROCESS_PROCESS_METRICS_SAMPLER_LINUX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/process/process_handle.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+
+class DelegateSimpleThreadPool;
+
+// Struct-of-arrays snapshot produced by ProcessMetricsSampler::Sample(). All
+// vectors have the same length and entry |i| of each of them refers to
+// |pids[i]|. Fields which could not be read for a process (because it exited,
+// or because the caller lacks the permission to read it) are left at 0 and
+// the corresponding bit of |valid_fields[i]| is cleared.
+struct BASE_EXPORT ProcessMetricsSnapshot {
+  ProcessMetricsSnapshot();
+  ~ProcessMetricsSnapshot();
+
+  // Resizes all of the arrays to |size| entries and zeroes them.
+  void Reset(size_t size);
+
+  size_t size() const { return pids.size(); }
+
+  std::vector<ProcessId> pids;
+  // Bitmask of ProcessMetricsSampler::Field values successfully sampled.
+  std::vector<uint32_t> valid_fields;
+
+  // From /proc/<pid>/stat.
+  std::vector<uint64_t> cpu_ticks;    // utime + stime, in clock ticks.
+  std::vector<uint64_t> num_threads;
+  std::vector<uint64_t> start_time;   // In clock ticks since boot.
+  std::vector<uint64_t> vsize_bytes;
+
+  // From /proc/<pid>/statm.
+  std::vector<uint64_t> resident_pages;
+  std::vector<uint64_t> shared_pages;
+
+  // From /proc/<pid>/io.
+  std::vector<uint64_t> read_chars;
+  std::vector<uint64_t> write_chars;
+  std::vector<uint64_t> read_syscalls;
+  std::vector<uint64_t> write_syscalls;
+
+  // From /proc/<pid>/status.
+  std::vector<uint64_t> vm_rss_kb;
+  std::vector<uint64_t> vm_hwm_kb;    // Peak resident set size.
+  std::vector<uint64_t> vm_swap_kb;
+
+  // From /proc/<pid>/totmaps, or /proc/<pid>/smaps_rollup on kernels without
+  // it.
+  std::vector<uint64_t> pss_kb;
+  std::vector<uint64_t> private_kb;   // Private_Clean + Private_Dirty.
+  std::vector<uint64_t> swap_kb;
+};
+
+// Samples /proc/<pid>/{stat,statm,io,status,totmaps} for a set of processes.
+//
+// Example:
+//   ProcessMetricsSampler sampler(ProcessMetricsSampler::ALL_FIELDS, 4);
+//   sampler.SetProcesses(pids);
+//   ProcessMetricsSnapshot snapshot;
+//   while (...) {
+//     sampler.Sample(&snapshot);
+//     ...
+//   }
+//
+// The /proc files are opened once, when a process is added with
+// SetProcesses(). An open /proc file refers to the process instance that was
+// running when it was opened, so a recycled pid never reports the metrics of
+// an unrelated process; once a process exits its entry simply stops being
+// valid until SetProcesses() is called again.
+//
+// This class is not thread-safe; it must be used from a single thread (which
+// must allow blocking, as Sample() waits for its worker threads).
+class BASE_EXPORT ProcessMetricsSampler {
+ public:
+  enum Field {
+    STAT = 1 << 0,
+    STATM = 1 << 1,
+    IO = 1 << 2,
+    STATUS = 1 << 3,
+    // Walks all the memory mappings of the process, so it is much more
+    // expensive to sample than the other fields.
+    TOTMAPS = 1 << 4,
+    ALL_FIELDS = STAT | STATM | IO | STATUS | TOTMAPS,
+  };
+
+  // |fields| is a bitmask of Field values selecting which /proc files to
+  // sample. |num_threads| is the number of worker threads Sample() may use;
+  // with 1 (or fewer) everything is sampled on the calling thread.
+  ProcessMetricsSampler(uint32_t fields, int num_threads);
+  ~ProcessMetricsSampler();
+
+  // Sets the processes to sample. Processes which were already tracked keep
+  // their open files; new processes have their files opened and processes no
+  // longer in |pids| have theirs closed. The order of |pids| is the order of
+  // the entries in the snapshots. Duplicates are not allowed.
+  void SetProcesses(const std::vector<ProcessId>& pids);
+
+  // Samples every tracked process into |snapshot|, overwriting its contents.
+  void Sample(ProcessMetricsSnapshot* snapshot);
+
+  size_t num_processes() const { return entries_.size(); }
+
+ private:
+  class Worker;
+
+  // The open /proc files of a tracked process, or -1 for files which are not
+  // sampled or could not be opened.
+  struct Entry {
+    ProcessId pid;
+    int stat_fd;
+    int statm_fd;
+    int io_fd;
+    int status_fd;
+    int totmaps_fd;
+  };
+
+  // Samples entries [begin, end) into the corresponding snapshot slots.
+  void SampleRange(size_t begin, size_t end, ProcessMetricsSnapshot* snapshot);
+
+  const uint32_t fields_;
+  const int num_threads_;
+  std::vector<Entry> entries_;
+
+  // Started by the first Sample() which needs worker threads, and joined when
+  // the sampler is destroyed.
+  scoped_ptr<DelegateSimpleThreadPool> pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProcessMetricsSampler);
+};
+
+namespace internal {
+
+// Allocation-free parsers for the /proc files sampled above, exposed for
+// testing. They return false if |data| is not in the expected format.
+BASE_EXPORT bool ParseProcStatForSampler(StringPiece data,
+                                         uint64_t* cpu_ticks,
+                                         uint64_t* num_threads,
+                                         uint64_t* start_time,
+                                         uint64_t* vsize_bytes);
+BASE_EXPORT bool ParseProcStatmForSampler(StringPiece data,
+                                          uint64_t* resident_pages,
+                                          uint64_t* shared_pages);
+BASE_EXPORT bool ParseProcIoForSampler(StringPiece data,
+                                       uint64_t* read_chars,
+                                       uint64_t* write_chars,
+                                       uint64_t* read_syscalls,
+                                       uint64_t* write_syscalls);
+BASE_EXPORT bool ParseProcStatusForSampler(StringPiece data,
+                                           uint64_t* vm_rss_kb,
+                                           uint64_t* vm_hwm_kb,
+                                           uint64_t* vm_swap_kb);
+BASE_EXPORT bool ParseProcTotmapsForSampler(StringPiece data,
+                                            uint64_t* pss_kb,
+                                            uint64_t* private_kb,
+                                            uint64_t* swap_kb);
+
+}  // namespace internal
+
+}  // namespace base
+
+#endif  // BASE_PROCESS_PROCESS_METRICS_SAMPLER_LINUX_H_
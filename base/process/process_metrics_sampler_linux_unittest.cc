@@ -0,0 +1,296 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/process_metrics_sampler_linux.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "base/files/dir_reader_posix.h"
+#include "base/macros.h"
+#include "base/memory/scoped_vector.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/process/internal_linux.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+class BlockingDelegate : public DelegateSimpleThread::Delegate {
+ public:
+  explicit BlockingDelegate(WaitableEvent* event) : event_(event) {}
+  void Run() override { event_->Wait(); }
+
+ private:
+  WaitableEvent* event_;
+};
+
+// Returns the thread ids of the current process. Every thread has its own
+// /proc/<tid> directory, which lets the tests sample many "processes" without
+// forking.
+std::vector<ProcessId> GetCurrentThreadIds() {
+  std::vector<ProcessId> tids;
+  DirReaderPosix dir_reader("/proc/self/task");
+  EXPECT_TRUE(dir_reader.IsValid());
+  while (dir_reader.Next()) {
+    pid_t tid = internal::ProcDirSlotToPid(dir_reader.name());
+    if (tid)
+      tids.push_back(tid);
+  }
+  return tids;
+}
+
+}  // namespace
+
+TEST(ProcessMetricsSamplerTest, ParseProcStat) {
+  const char kStat[] =
+      "9164 (a) b) c) S 1 9164 9164 0 -1 4202496 1373 0 2 0 120 35 0 0 20 0 "
+      "3 0 7442 114397184 1200 18446744073709551615 1 1 0 0 0 0 0 4096 "
+      "65536 0 0 0 17 1 0 0 0 0 0\n";
+  uint64_t cpu_ticks = 0;
+  uint64_t num_threads = 0;
+  uint64_t start_time = 0;
+  uint64_t vsize_bytes = 0;
+  EXPECT_TRUE(internal::ParseProcStatForSampler(
+      kStat, &cpu_ticks, &num_threads, &start_time, &vsize_bytes));
+  EXPECT_EQ(155u, cpu_ticks);
+  EXPECT_EQ(3u, num_threads);
+  EXPECT_EQ(7442u, start_time);
+  EXPECT_EQ(114397184u, vsize_bytes);
+
+  EXPECT_FALSE(internal::ParseProcStatForSampler(
+      "", &cpu_ticks, &num_threads, &start_time, &vsize_bytes));
+  EXPECT_FALSE(internal::ParseProcStatForSampler(
+      "9164 (cat) S 1 9164", &cpu_ticks, &num_threads, &start_time,
+      &vsize_bytes));
+}
+
+TEST(ProcessMetricsSamplerTest, ParseProcStatm) {
+  uint64_t resident_pages = 0;
+  uint64_t shared_pages = 0;
+  EXPECT_TRUE(internal::ParseProcStatmForSampler(
+      "27929 1200 901 8 0 1200 0\n", &resident_pages, &shared_pages));
+  EXPECT_EQ(1200u, resident_pages);
+  EXPECT_EQ(901u, shared_pages);
+
+  EXPECT_FALSE(internal::ParseProcStatmForSampler("27929 1200", &resident_pages,
+                                                  &shared_pages));
+}
+
+TEST(ProcessMetricsSamplerTest, ParseProcIo) {
+  const char kIo[] =
+      "rchar: 3263542\n"
+      "wchar: 41298\n"
+      "syscr: 4004\n"
+      "syscw: 412\n"
+      "read_bytes: 8192\n"
+      "write_bytes: 0\n"
+      "cancelled_write_bytes: 0\n";
+  uint64_t read_chars = 0;
+  uint64_t write_chars = 0;
+  uint64_t read_syscalls = 0;
+  uint64_t write_syscalls = 0;
+  EXPECT_TRUE(internal::ParseProcIoForSampler(
+      kIo, &read_chars, &write_chars, &read_syscalls, &write_syscalls));
+  EXPECT_EQ(3263542u, read_chars);
+  EXPECT_EQ(41298u, write_chars);
+  EXPECT_EQ(4004u, read_syscalls);
+  EXPECT_EQ(412u, write_syscalls);
+
+  EXPECT_FALSE(internal::ParseProcIoForSampler(
+      "rchar: 1\nwchar: 2\n", &read_chars, &write_chars, &read_syscalls,
+      &write_syscalls));
+}
+
+TEST(ProcessMetricsSamplerTest, ParseProcStatus) {
+  const char kStatus[] =
+      "Name:\tcat\n"
+      "State:\tR (running)\n"
+      "Groups:\t4 24 27\n"
+      "VmPeak:\t    7880 kB\n"
+      "VmSize:\t    7880 kB\n"
+      "VmHWM:\t     756 kB\n"
+      "VmRSS:\t     704 kB\n"
+      "VmData:\t     312 kB\n"
+      "VmSwap:\t      12 kB\n"
+      "Threads:\t1\n";
+  uint64_t vm_rss_kb = 0;
+  uint64_t vm_hwm_kb = 0;
+  uint64_t vm_swap_kb = 0;
+  EXPECT_TRUE(internal::ParseProcStatusForSampler(kStatus, &vm_rss_kb,
+                                                  &vm_hwm_kb, &vm_swap_kb));
+  EXPECT_EQ(704u, vm_rss_kb);
+  EXPECT_EQ(756u, vm_hwm_kb);
+  EXPECT_EQ(12u, vm_swap_kb);
+
+  // A kernel thread.
+  EXPECT_FALSE(internal::ParseProcStatusForSampler(
+      "Name:\tkthreadd\nState:\tS (sleeping)\nThreads:\t1\n", &vm_rss_kb,
+      &vm_hwm_kb, &vm_swap_kb));
+}
+
+TEST(ProcessMetricsSamplerTest, ParseProcTotmaps) {
+  const char kTotmaps[] =
+      "Rss:                6120 kB\n"
+      "Pss:                3335 kB\n"
+      "Shared_Clean:       1008 kB\n"
+      "Shared_Dirty:       4012 kB\n"
+      "Private_Clean:         4 kB\n"
+      "Private_Dirty:      1096 kB\n"
+      "Referenced:         6120 kB\n"
+      "Anonymous:          1100 kB\n"
+      "AnonHugePages:         0 kB\n"
+      "Swap:                 32 kB\n"
+      "Locked:                0 kB\n";
+  uint64_t pss_kb = 0;
+  uint64_t private_kb = 0;
+  uint64_t swap_kb = 0;
+  EXPECT_TRUE(internal::ParseProcTotmapsForSampler(kTotmaps, &pss_kb,
+                                                   &private_kb, &swap_kb));
+  EXPECT_EQ(3335u, pss_kb);
+  EXPECT_EQ(1100u, private_kb);
+  EXPECT_EQ(32u, swap_kb);
+
+  // smaps_rollup starts with a mapping line, and has more Pss and Swap lines.
+  const char kSmapsRollup[] =
+      "56155a6fc000-7ffe0e9c5000 ---p 00000000 00:00 0       [rollup]\n"
+      "Rss:                1248 kB\n"
+      "Pss:                 382 kB\n"
+      "Pss_Anon:            104 kB\n"
+      "Shared_Clean:        992 kB\n"
+      "Shared_Dirty:          0 kB\n"
+      "Private_Clean:       152 kB\n"
+      "Private_Dirty:       104 kB\n"
+      "Swap:                  0 kB\n"
+      "SwapPss:               0 kB\n";
+  EXPECT_TRUE(internal::ParseProcTotmapsForSampler(kSmapsRollup, &pss_kb,
+                                                   &private_kb, &swap_kb));
+  EXPECT_EQ(382u, pss_kb);
+  EXPECT_EQ(256u, private_kb);
+  EXPECT_EQ(0u, swap_kb);
+
+  EXPECT_FALSE(internal::ParseProcTotmapsForSampler(
+      "Rss: 1 kB\nPss: 1 kB\n", &pss_kb, &private_kb, &swap_kb));
+}
+
+TEST(ProcessMetricsSamplerTest, SampleCurrentProcess) {
+  ProcessMetricsSampler sampler(ProcessMetricsSampler::ALL_FIELDS, 1);
+  sampler.SetProcesses(std::vector<ProcessId>(1, GetCurrentProcId()));
+
+  ProcessMetricsSnapshot snapshot;
+  sampler.Sample(&snapshot);
+  ASSERT_EQ(1u, snapshot.size());
+  EXPECT_EQ(GetCurrentProcId(), snapshot.pids[0]);
+  // /proc/self/io is not available on kernels without task IO accounting.
+  EXPECT_EQ(static_cast<uint32_t>(ProcessMetricsSampler::STAT |
+                                  ProcessMetricsSampler::STATM),
+            snapshot.valid_fields[0] & (ProcessMetricsSampler::STAT |
+                                        ProcessMetricsSampler::STATM));
+  EXPECT_GE(snapshot.num_threads[0], 1u);
+  EXPECT_GT(snapshot.vsize_bytes[0], 0u);
+  EXPECT_GT(snapshot.resident_pages[0], 0u);
+  EXPECT_EQ(static_cast<uint64_t>(internal::ReadProcStatsAndGetFieldAsInt64(
+                GetCurrentProcId(), internal::VM_STARTTIME)),
+            snapshot.start_time[0]);
+  EXPECT_NE(0u, snapshot.valid_fields[0] & ProcessMetricsSampler::STATUS);
+  EXPECT_GT(snapshot.vm_rss_kb[0], 0u);
+  EXPECT_GE(snapshot.vm_hwm_kb[0], snapshot.vm_rss_kb[0]);
+  // Older kernels have neither totmaps nor smaps_rollup.
+  if (snapshot.valid_fields[0] & ProcessMetricsSampler::TOTMAPS) {
+    EXPECT_GT(snapshot.pss_kb[0], 0u);
+    EXPECT_GT(snapshot.private_kb[0], 0u);
+  }
+}
+
+TEST(ProcessMetricsSamplerTest, ExitedProcessIsInvalid) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    // Wait for the parent to open the /proc files and close the pipe.
+    close(fds[1]);
+    char c;
+    ignore_result(HANDLE_EINTR(read(fds[0], &c, 1)));
+    _exit(0);
+  }
+  close(fds[0]);
+
+  std::vector<ProcessId> pids;
+  pids.push_back(GetCurrentProcId());
+  pids.push_back(child);
+  ProcessMetricsSampler sampler(ProcessMetricsSampler::STAT, 1);
+  sampler.SetProcesses(pids);
+  close(fds[1]);
+
+  int status;
+  ASSERT_EQ(child, HANDLE_EINTR(waitpid(child, &status, 0)));
+
+  ProcessMetricsSnapshot snapshot;
+  sampler.Sample(&snapshot);
+  ASSERT_EQ(2u, snapshot.size());
+  EXPECT_EQ(static_cast<uint32_t>(ProcessMetricsSampler::STAT),
+            snapshot.valid_fields[0]);
+  EXPECT_EQ(0u, snapshot.valid_fields[1]);
+  EXPECT_EQ(0u, snapshot.vsize_bytes[1]);
+
+  // Dropping the exited process keeps the remaining one working.
+  sampler.SetProcesses(std::vector<ProcessId>(1, GetCurrentProcId()));
+  sampler.Sample(&snapshot);
+  ASSERT_EQ(1u, snapshot.size());
+  EXPECT_EQ(static_cast<uint32_t>(ProcessMetricsSampler::STAT),
+            snapshot.valid_fields[0]);
+}
+
+TEST(ProcessMetricsSamplerTest, ParallelSampleMatchesSerial) {
+  // Enough threads for the sampler to actually use its workers.
+  const int kNumThreads = 300;
+  WaitableEvent event(true, false);
+  BlockingDelegate delegate(&event);
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(new DelegateSimpleThread(&delegate, "Blocking"));
+    threads.back()->Start();
+  }
+
+  std::vector<ProcessId> tids = GetCurrentThreadIds();
+  ASSERT_GT(tids.size(), static_cast<size_t>(kNumThreads));
+
+  ProcessMetricsSampler serial_sampler(
+      ProcessMetricsSampler::STAT | ProcessMetricsSampler::STATM, 1);
+  ProcessMetricsSampler parallel_sampler(
+      ProcessMetricsSampler::STAT | ProcessMetricsSampler::STATM, 4);
+  serial_sampler.SetProcesses(tids);
+  parallel_sampler.SetProcesses(tids);
+
+  ProcessMetricsSnapshot serial;
+  serial_sampler.Sample(&serial);
+  ASSERT_EQ(tids.size(), serial.size());
+
+  // The second sample reuses the worker threads of the first.
+  for (int run = 0; run < 2; ++run) {
+    ProcessMetricsSnapshot parallel;
+    parallel_sampler.Sample(&parallel);
+    ASSERT_EQ(tids.size(), parallel.size());
+    for (size_t i = 0; i < tids.size(); ++i) {
+      EXPECT_EQ(tids[i], parallel.pids[i]);
+      EXPECT_EQ(serial.valid_fields[i], parallel.valid_fields[i]);
+      EXPECT_NE(0u, parallel.valid_fields[i] & ProcessMetricsSampler::STAT);
+      EXPECT_EQ(serial.start_time[i], parallel.start_time[i]);
+    }
+  }
+
+  event.Signal();
+  for (DelegateSimpleThread* thread : threads)
+    thread->Join();
+}
+
+}  // namespace base
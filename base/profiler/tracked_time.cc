@@ -4,6 +4,9 @@
 
 #include "base/profiler/tracked_time.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "build/build_config.h"
 
 #if defined(OS_WIN)
@@ -65,4 +68,30 @@ TrackedTime TrackedTime::operator+(const Duration& other) const {
 
 bool TrackedTime::is_null() const { return ms_ == 0; }
 
+//------------------------------------------------------------------------------
+
+TimeStampCounter::TimeStampCounter() {}
+TimeStampCounter::TimeStampCounter(const base::TimeTicks& ticks)
+    : ticks_(ticks) {}
+
+// static
+TimeStampCounter TimeStampCounter::Now() {
+  // Also calibrates the counter, on first use.
+  const base::TimeTicks ticks = base::TimeTicks::NowFromTimeStampCounter();
+  if (!base::TimeTicks::IsTimeStampCounterCalibrated())
+    return TimeStampCounter();
+  return TimeStampCounter(ticks);
+}
+
+Duration TimeStampCounter::operator-(const TimeStampCounter& other) const {
+  // A reading taken on another CPU can be slightly ahead.
+  if (is_null() || other.is_null() || ticks_ < other.ticks_)
+    return Duration();
+  const int64_t ms = (ticks_ - other.ticks_).InMilliseconds();
+  return Duration(static_cast<int32_t>(
+      std::min<int64_t>(ms, std::numeric_limits<int32_t>::max())));
+}
+
+bool TimeStampCounter::is_null() const { return ticks_.is_null(); }
+
 }  // namespace tracked_objects
@@ -40,6 +40,7 @@ class BASE_EXPORT Duration {  // Similar to base::TimeDelta.
 
  private:
   friend class TrackedTime;
+  friend class TimeStampCounter;
   explicit Duration(int32_t duration);
 
   // Internal time is stored directly in milliseconds.
@@ -66,6 +67,25 @@ class BASE_EXPORT TrackedTime {  // Similar to base::TimeTicks.
   uint32_t ms_;
 };
 
+// A reading of the CPU's time stamp counter (see
+// base::TimeTicks::NowFromTimeStampCounter()), to time tasks more cheaply than
+// with TrackedTime::Now(), which asks the OS.  Now() is null until the counter
+// is calibrated, and on CPUs where it cannot be used.
+class BASE_EXPORT TimeStampCounter {
+ public:
+  TimeStampCounter();
+
+  static TimeStampCounter Now();
+  // Returns a zero duration if either reading is null.
+  Duration operator-(const TimeStampCounter& other) const;
+  bool is_null() const;
+
+ private:
+  explicit TimeStampCounter(const base::TimeTicks& ticks);
+
+  base::TimeTicks ticks_;
+};
+
 }  // namespace tracked_objects
 
 #endif  // BASE_PROFILER_TRACKED_TIME_H_
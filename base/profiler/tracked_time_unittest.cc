@@ -7,6 +7,7 @@
 #include <stdint.h>
 
 #include "base/profiler/tracked_time.h"
+#include "base/threading/platform_thread.h"
 #include "base/time/time.h"
 #include "base/tracked_objects.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -102,4 +103,36 @@ TEST(TrackedTimeTest, TrackedTimerEnabled) {
   EXPECT_GE(0, after.InMilliseconds());
 }
 
+TEST(TrackedTimeTest, TimeStampCounter) {
+  const TimeStampCounter null_counter;
+  EXPECT_TRUE(null_counter.is_null());
+  EXPECT_EQ(0, (null_counter - null_counter).InMilliseconds());
+
+  // The counter is only read once its rate is known, which takes a while, and
+  // on some CPUs never happens.
+  const base::TimeTicks deadline =
+      base::TimeTicks::Now() + base::TimeDelta::FromSeconds(1);
+  TimeStampCounter start = TimeStampCounter::Now();
+  while (start.is_null() && base::TimeTicks::Now() < deadline) {
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(10));
+    start = TimeStampCounter::Now();
+  }
+  if (start.is_null())
+    return;
+  EXPECT_EQ(0, (null_counter - start).InMilliseconds());
+  EXPECT_EQ(0, (start - null_counter).InMilliseconds());
+
+  // Durations agree with TimeTicks, give or take the truncation to whole
+  // milliseconds and the precision of the rate.
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(50));
+  const base::TimeTicks end_time = base::TimeTicks::Now();
+  const TimeStampCounter end = TimeStampCounter::Now();
+  ASSERT_FALSE(end.is_null());
+  const int32_t elapsed_ms = (end - start).InMilliseconds();
+  EXPECT_GE(elapsed_ms, (end_time - start_time).InMilliseconds() - 1);
+  EXPECT_LE(elapsed_ms,
+            (base::TimeTicks::Now() - start_time).InMilliseconds() + 2);
+}
+
 }  // namespace tracked_objects
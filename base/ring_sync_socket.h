@@ -0,0 +1,124 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_RING_SYNC_SOCKET_H_
+#define BASE_RING_SYNC_SOCKET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "base/process/process_handle.h"
+#include "base/sync_socket.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// A SyncSocket whose data goes through a ring buffer in shared memory in each
+// direction, rather than through the kernel. Its sockets only carry wake-ups,
+// which are only sent to a thread asleep waiting for data (or for space to
+// send it); and a thread spins for a while before it goes to sleep, longer
+// when spinning recently paid off. A stream of messages between two busy
+// threads then takes no system calls at all.
+//
+// Send(), Receive(), ReceiveWithTimeout() and Peek() behave as those of
+// SyncSocket, except that a Send() to a closed peer only fails once the ring
+// buffer is full. Each direction has a single producer and a single consumer:
+// a thread may send while another one receives, but two threads must not
+// send, or receive, at the same time. Like CancelableSyncSocket, it can be
+// shut down from another thread.
+class BASE_EXPORT RingSyncSocket : public SyncSocket {
+ public:
+  // The descriptors of an end of a pair, to create it in another process.
+  struct BASE_EXPORT TransitDescriptors {
+    TransitDescriptors();
+
+    // The shared memory of the ring buffers.
+    SharedMemoryHandle memory;
+    // The sockets which wake up the end when it waits for data, and when it
+    // waits for space to send data.
+    TransitDescriptor receive_socket;
+    TransitDescriptor send_socket;
+    // Which of the two ring buffers the end receives from.
+    int receive_ring;
+  };
+
+  // The capacity of the ring buffers of CreatePair().
+  static const size_t kDefaultCapacity;
+
+  RingSyncSocket();
+
+  // Creates an end of a pair from the descriptors of another process, which
+  // it takes ownership of. handle() is invalid if they are not valid.
+  explicit RingSyncSocket(const TransitDescriptors& descriptors);
+
+  ~RingSyncSocket() override;
+
+  // Initializes and connects a pair of sockets, with ring buffers of
+  // kDefaultCapacity bytes.
+  static bool CreatePair(RingSyncSocket* socket_a, RingSyncSocket* socket_b);
+
+  // Same as CreatePair(), with ring buffers of |capacity| bytes, a power of
+  // two of at least 64.
+  static bool CreatePairWithCapacity(size_t capacity,
+                                     RingSyncSocket* socket_a,
+                                     RingSyncSocket* socket_b);
+
+  // Fills |descriptors| with those of this end, for the peer process to
+  // create it. They remain owned by this object.
+  bool PrepareTransitDescriptors(ProcessHandle peer_process_handle,
+                                 TransitDescriptors* descriptors);
+
+  // Makes the blocking calls of both ends, current and future, fail. May be
+  // called from any thread.
+  bool Shutdown();
+
+  // SyncSocket:
+  bool Close() override;
+  size_t Send(const void* buffer, size_t length) override;
+  size_t Receive(void* buffer, size_t length) override;
+  size_t ReceiveWithTimeout(void* buffer,
+                            size_t length,
+                            TimeDelta timeout) override;
+  size_t Peek() override;
+
+ private:
+  // The control block of a ring buffer, in the shared memory.
+  struct Ring;
+
+  // Maps the ring buffers of |memory_|, and checks their layout. Returns
+  // false if it is not valid.
+  bool MapRings(int receive_ring);
+
+  // Receives up to |length| bytes, waiting for all of them, or until
+  // |deadline| if it is not null. Returns the number of bytes received.
+  size_t ReceiveUntil(void* buffer, size_t length, TimeTicks deadline);
+
+  scoped_ptr<SharedMemory> memory_;
+  Handle send_handle_;
+  int receive_ring_index_;
+  size_t capacity_;
+  Ring* receive_ring_;
+  Ring* send_ring_;
+  char* receive_data_;
+  char* send_data_;
+
+  // The number of times to check for data, and for space to send it, before
+  // going to sleep.
+  int receive_spins_;
+  int send_spins_;
+  int max_spins_;
+
+  subtle::Atomic32 shut_down_;
+
+  DISALLOW_COPY_AND_ASSIGN(RingSyncSocket);
+};
+
+}  // namespace base
+
+#endif  // BASE_RING_SYNC_SOCKET_H_
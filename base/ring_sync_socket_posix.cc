@@ -0,0 +1,468 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/ring_sync_socket.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/files/scoped_file.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/sys_info.h"
+#include "base/threading/thread_restrictions.h"
+#include "build/build_config.h"
+
+namespace base {
+
+namespace {
+
+const size_t kCacheLineSize = 64;
+
+// The layout of the shared memory: a header, the control blocks of the two
+// ring buffers, then their data.
+const size_t kRingsOffset = kCacheLineSize;
+const size_t kDataOffset = kRingsOffset + 4 * kCacheLineSize;
+const size_t kMaxCapacity = 1u << 30;
+
+// The bounds of the adaptive spinning, in checks of the ring buffer.
+const int kMinSpins = 16;
+const int kMaxSpins = 8192;
+
+#if defined(MSG_NOSIGNAL)
+const int kSendFlags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+const int kSendFlags = MSG_DONTWAIT;
+#endif
+
+struct Header {
+  uint32_t capacity;
+};
+
+size_t SegmentSize(size_t capacity) {
+  return kDataOffset + 2 * capacity;
+}
+
+bool IsValidCapacity(size_t capacity) {
+  return capacity >= kCacheLineSize && capacity <= kMaxCapacity &&
+         (capacity & (capacity - 1)) == 0;
+}
+
+// Tells the processor that this is a spin-wait loop, which saves power and
+// lets the other hyperthread of the core run.
+inline void SpinPause() {
+#if defined(ARCH_CPU_X86_FAMILY)
+  __asm__ __volatile__("pause");
+#elif defined(ARCH_CPU_ARM_FAMILY)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+// Wakes up the peer of |fd|. Failures are harmless: the socket buffer is
+// only full if there are wake-ups the peer has not read yet, and it has been
+// closed only if there is no peer to wake up.
+void WakeUp(int fd) {
+  const char kWakeUp = 0;
+  ignore_result(HANDLE_EINTR(send(fd, &kWakeUp, 1, kSendFlags)));
+}
+
+// Waits for a wake-up of the peer of |fd|, or for |deadline| if it is not
+// null. Returns false on timeout, or if the socket has been closed or shut
+// down.
+bool WaitForWakeUp(int fd, TimeTicks deadline) {
+  if (!deadline.is_null()) {
+    const TimeDelta timeout = deadline - TimeTicks::Now();
+    if (timeout <= TimeDelta())
+      return false;
+    struct pollfd pollfd = {fd, POLLIN, 0};
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    const struct timespec timespec = timeout.ToTimeSpec();
+    const int result = ppoll(&pollfd, 1, &timespec, NULL);
+#else
+    const int result = poll(
+        &pollfd, 1, static_cast<int>(timeout.InMillisecondsRoundedUp()));
+#endif
+    // On EINTR, the caller checks the ring buffer again and calls back.
+    if (result == 0 || (result < 0 && errno != EINTR))
+      return false;
+    if (result < 0)
+      return true;
+  }
+
+  // Read all the pending wake-ups, to only wake up once for them.
+  char buffer[64];
+  return HANDLE_EINTR(recv(fd, buffer, sizeof(buffer), 0)) > 0;
+}
+
+// Checks |*position| until it differs from |value|, up to |*spins| times.
+// Adjusts |*spins| to how long that took: spinning longer if it paid off,
+// and less if it did not. Returns true if |*position| changed.
+bool SpinWhileEqual(const volatile subtle::Atomic32* position,
+                    subtle::Atomic32 value,
+                    int max_spins,
+                    int* spins) {
+  if (max_spins == 0)
+    return false;
+  for (int i = 0; i < *spins; i++) {
+    if (subtle::NoBarrier_Load(position) != value) {
+      *spins = std::min(*spins * 2, max_spins);
+      return true;
+    }
+    SpinPause();
+  }
+  *spins = std::max(*spins / 2, kMinSpins);
+  return false;
+}
+
+// Copies |length| bytes to |data|, a ring buffer of |capacity| bytes, from
+// |position| on.
+void CopyToRing(char* data,
+                size_t capacity,
+                uint32_t position,
+                const char* buffer,
+                size_t length) {
+  const size_t offset = position & (capacity - 1);
+  const size_t first = std::min(length, capacity - offset);
+  memcpy(data + offset, buffer, first);
+  memcpy(data, buffer + first, length - first);
+}
+
+void CopyFromRing(const char* data,
+                  size_t capacity,
+                  uint32_t position,
+                  char* buffer,
+                  size_t length) {
+  const size_t offset = position & (capacity - 1);
+  const size_t first = std::min(length, capacity - offset);
+  memcpy(buffer, data + offset, first);
+  memcpy(buffer + first, data, length - first);
+}
+
+}  // namespace
+
+// The positions count the bytes written to and read from the ring buffer,
+// modulo 2^32. Each end only writes its own, on its own cache line, along
+// with the flag it sets before it goes to sleep waiting for the other.
+struct RingSyncSocket::Ring {
+  volatile subtle::Atomic32 write_position;
+  volatile subtle::Atomic32 producer_waiting;
+  char padding0[kCacheLineSize - 2 * sizeof(subtle::Atomic32)];
+
+  volatile subtle::Atomic32 read_position;
+  volatile subtle::Atomic32 consumer_waiting;
+  char padding1[kCacheLineSize - 2 * sizeof(subtle::Atomic32)];
+};
+
+static_assert(sizeof(Header) <= kRingsOffset, "the header is too large");
+
+RingSyncSocket::TransitDescriptors::TransitDescriptors() : receive_ring(0) {}
+
+const size_t RingSyncSocket::kDefaultCapacity = 64 * 1024;
+
+RingSyncSocket::RingSyncSocket()
+    : send_handle_(kInvalidHandle),
+      receive_ring_index_(0),
+      capacity_(0),
+      receive_ring_(nullptr),
+      send_ring_(nullptr),
+      receive_data_(nullptr),
+      send_data_(nullptr),
+      receive_spins_(kMinSpins),
+      send_spins_(kMinSpins),
+      max_spins_(SysInfo::NumberOfProcessors() > 1 ? kMaxSpins : 0),
+      shut_down_(0) {}
+
+RingSyncSocket::RingSyncSocket(const TransitDescriptors& descriptors)
+    : SyncSocket(descriptors.receive_socket.fd),
+      memory_(new SharedMemory(descriptors.memory, false)),
+      send_handle_(descriptors.send_socket.fd),
+      receive_ring_index_(0),
+      capacity_(0),
+      receive_ring_(nullptr),
+      send_ring_(nullptr),
+      receive_data_(nullptr),
+      send_data_(nullptr),
+      receive_spins_(kMinSpins),
+      send_spins_(kMinSpins),
+      max_spins_(SysInfo::NumberOfProcessors() > 1 ? kMaxSpins : 0),
+      shut_down_(0) {
+  if (!MapRings(descriptors.receive_ring))
+    Close();
+}
+
+RingSyncSocket::~RingSyncSocket() {
+  // ~SyncSocket() would only close |handle_|.
+  Close();
+}
+
+// static
+bool RingSyncSocket::CreatePair(RingSyncSocket* socket_a,
+                                RingSyncSocket* socket_b) {
+  return CreatePairWithCapacity(kDefaultCapacity, socket_a, socket_b);
+}
+
+// static
+bool RingSyncSocket::CreatePairWithCapacity(size_t capacity,
+                                            RingSyncSocket* socket_a,
+                                            RingSyncSocket* socket_b) {
+  DCHECK_NE(socket_a, socket_b);
+  DCHECK_EQ(socket_a->handle_, kInvalidHandle);
+  DCHECK_EQ(socket_b->handle_, kInvalidHandle);
+  if (!IsValidCapacity(capacity))
+    return false;
+
+  SharedMemory memory;
+  if (!memory.CreateAndMapAnonymous(SegmentSize(capacity)))
+    return false;
+  static_cast<Header*>(memory.memory())->capacity =
+      static_cast<uint32_t>(capacity);
+  memory.Unmap();
+
+  // Ring buffer i has a pair of sockets, for its consumer and its producer;
+  // |socket_a| receives from ring buffer 0, and |socket_b| from 1.
+  ScopedFD sockets[2][2];
+  for (int i = 0; i < 2; i++) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+      return false;
+    sockets[i][0].reset(fds[0]);
+    sockets[i][1].reset(fds[1]);
+  }
+
+  RingSyncSocket* const ends[2] = {socket_a, socket_b};
+  for (int i = 0; i < 2; i++) {
+    ends[i]->memory_.reset(new SharedMemory(
+        SharedMemory::DuplicateHandle(memory.handle()), false));
+    ends[i]->handle_ = sockets[i][0].release();
+    ends[i]->send_handle_ = sockets[1 - i][1].release();
+  }
+  if (!socket_a->MapRings(0) || !socket_b->MapRings(1)) {
+    socket_a->Close();
+    socket_b->Close();
+    return false;
+  }
+  return true;
+}
+
+bool RingSyncSocket::MapRings(int receive_ring) {
+  struct stat st;
+  if (receive_ring < 0 || receive_ring > 1 ||
+      !SharedMemory::IsHandleValid(memory_->handle()) ||
+      fstat(memory_->handle().fd, &st) != 0 ||
+      st.st_size < static_cast<off_t>(kDataOffset) ||
+      !memory_->Map(static_cast<size_t>(st.st_size))) {
+    return false;
+  }
+  // The peer can change the header at any time: read it once.
+  const size_t capacity =
+      static_cast<volatile Header*>(memory_->memory())->capacity;
+  if (!IsValidCapacity(capacity) ||
+      SegmentSize(capacity) != static_cast<size_t>(st.st_size)) {
+    return false;
+  }
+
+  char* const memory = static_cast<char*>(memory_->memory());
+  Ring* const rings = reinterpret_cast<Ring*>(memory + kRingsOffset);
+  receive_ring_index_ = receive_ring;
+  capacity_ = capacity;
+  receive_ring_ = &rings[receive_ring];
+  send_ring_ = &rings[1 - receive_ring];
+  receive_data_ = memory + kDataOffset + receive_ring * capacity;
+  send_data_ = memory + kDataOffset + (1 - receive_ring) * capacity;
+  return true;
+}
+
+bool RingSyncSocket::PrepareTransitDescriptors(
+    ProcessHandle /* peer_process_handle */,
+    TransitDescriptors* descriptors) {
+  if (!memory_)
+    return false;
+  descriptors->memory = memory_->handle();
+  descriptors->receive_socket = FileDescriptor(handle_, false);
+  descriptors->send_socket = FileDescriptor(send_handle_, false);
+  descriptors->receive_ring = receive_ring_index_;
+  return handle_ != kInvalidHandle && send_handle_ != kInvalidHandle &&
+         SharedMemory::IsHandleValid(descriptors->memory);
+}
+
+bool RingSyncSocket::Shutdown() {
+  DCHECK_NE(handle_, kInvalidHandle);
+  subtle::NoBarrier_Store(&shut_down_, 1);
+  // Blocked receivers, and senders, wake up to end of file.
+  const bool receive_result =
+      HANDLE_EINTR(shutdown(handle_, SHUT_RDWR)) >= 0;
+  const bool send_result =
+      HANDLE_EINTR(shutdown(send_handle_, SHUT_RDWR)) >= 0;
+  return receive_result && send_result;
+}
+
+bool RingSyncSocket::Close() {
+  bool result = SyncSocket::Close();
+  if (send_handle_ != kInvalidHandle && close(send_handle_) < 0) {
+    DPLOG(ERROR) << "close";
+    result = false;
+  }
+  send_handle_ = kInvalidHandle;
+  memory_.reset();
+  receive_ring_ = nullptr;
+  send_ring_ = nullptr;
+  return result;
+}
+
+size_t RingSyncSocket::Send(const void* buffer, size_t length) {
+  ThreadRestrictions::AssertIOAllowed();
+  DCHECK_GT(length, 0u);
+  DCHECK_LE(length, kMaxCapacity * 2);
+  DCHECK_NE(handle_, kInvalidHandle);
+  if (!send_ring_ || subtle::NoBarrier_Load(&shut_down_))
+    return 0;
+
+  const char* charbuffer = static_cast<const char*>(buffer);
+  const uint32_t capacity = static_cast<uint32_t>(capacity_);
+  uint32_t write_position = subtle::NoBarrier_Load(&send_ring_->write_position);
+  size_t sent = 0;
+  while (sent < length) {
+    // Pairs with the release store of the consumer, which is then done
+    // reading the bytes about to be overwritten.
+    const subtle::Atomic32 read_position =
+        subtle::Acquire_Load(&send_ring_->read_position);
+    const uint32_t used = write_position - static_cast<uint32_t>(read_position);
+    if (used > capacity)
+      return 0;
+
+    if (used == capacity) {
+      if (SpinWhileEqual(&send_ring_->read_position, read_position, max_spins_,
+                         &send_spins_)) {
+        continue;
+      }
+      // The consumer wakes this end up if it sees the flag after it frees
+      // space, and else this end sees the space after it sets the flag.
+      subtle::NoBarrier_Store(&send_ring_->producer_waiting, 1);
+      subtle::MemoryBarrier();
+      if (subtle::NoBarrier_Load(&send_ring_->read_position) ==
+          read_position) {
+        if (!WaitForWakeUp(send_handle_, TimeTicks()))
+          return 0;
+      }
+      subtle::NoBarrier_Store(&send_ring_->producer_waiting, 0);
+      continue;
+    }
+
+    const size_t bytes = std::min<size_t>(length - sent, capacity - used);
+    CopyToRing(send_data_, capacity, write_position, charbuffer + sent, bytes);
+    write_position += static_cast<uint32_t>(bytes);
+    sent += bytes;
+    subtle::Release_Store(&send_ring_->write_position, write_position);
+
+    subtle::MemoryBarrier();
+    if (subtle::NoBarrier_Load(&send_ring_->consumer_waiting) &&
+        subtle::NoBarrier_CompareAndSwap(&send_ring_->consumer_waiting, 1,
+                                         0) == 1) {
+      WakeUp(send_handle_);
+    }
+  }
+  return length;
+}
+
+size_t RingSyncSocket::Receive(void* buffer, size_t length) {
+  ThreadRestrictions::AssertIOAllowed();
+  DCHECK_GT(length, 0u);
+  DCHECK_NE(handle_, kInvalidHandle);
+  return ReceiveUntil(buffer, length, TimeTicks()) == length ? length : 0;
+}
+
+size_t RingSyncSocket::ReceiveWithTimeout(void* buffer,
+                                          size_t length,
+                                          TimeDelta timeout) {
+  ThreadRestrictions::AssertIOAllowed();
+  DCHECK_GT(length, 0u);
+  DCHECK_NE(handle_, kInvalidHandle);
+
+  // Only timeouts greater than zero and less than one second are allowed.
+  DCHECK_GT(timeout.InMicroseconds(), 0);
+  DCHECK_LT(timeout.InMicroseconds(),
+            base::TimeDelta::FromSeconds(1).InMicroseconds());
+
+  return ReceiveUntil(buffer, length, TimeTicks::Now() + timeout);
+}
+
+size_t RingSyncSocket::ReceiveUntil(void* buffer,
+                                    size_t length,
+                                    TimeTicks deadline) {
+  if (!receive_ring_)
+    return 0;
+
+  char* charbuffer = static_cast<char*>(buffer);
+  const uint32_t capacity = static_cast<uint32_t>(capacity_);
+  uint32_t read_position =
+      subtle::NoBarrier_Load(&receive_ring_->read_position);
+  size_t received = 0;
+  while (received < length) {
+    // Pairs with the release store of the producer, which is then done
+    // writing the bytes about to be read.
+    const subtle::Atomic32 write_position =
+        subtle::Acquire_Load(&receive_ring_->write_position);
+    const uint32_t available =
+        static_cast<uint32_t>(write_position) - read_position;
+    if (available > capacity)
+      return received;
+
+    if (available == 0) {
+      if (SpinWhileEqual(&receive_ring_->write_position, write_position,
+                         max_spins_, &receive_spins_)) {
+        continue;
+      }
+      // As in Send(), with the roles swapped.
+      subtle::NoBarrier_Store(&receive_ring_->consumer_waiting, 1);
+      subtle::MemoryBarrier();
+      bool woken_up = true;
+      if (subtle::NoBarrier_Load(&receive_ring_->write_position) ==
+          write_position) {
+        woken_up = WaitForWakeUp(handle_, deadline);
+      }
+      subtle::NoBarrier_Store(&receive_ring_->consumer_waiting, 0);
+      if (!woken_up &&
+          subtle::Acquire_Load(&receive_ring_->write_position) ==
+              write_position) {
+        return received;
+      }
+      continue;
+    }
+
+    const size_t bytes = std::min<size_t>(length - received, available);
+    CopyFromRing(receive_data_, capacity, read_position, charbuffer + received,
+                 bytes);
+    read_position += static_cast<uint32_t>(bytes);
+    received += bytes;
+    subtle::Release_Store(&receive_ring_->read_position, read_position);
+
+    subtle::MemoryBarrier();
+    if (subtle::NoBarrier_Load(&receive_ring_->producer_waiting) &&
+        subtle::NoBarrier_CompareAndSwap(&receive_ring_->producer_waiting, 1,
+                                         0) == 1) {
+      WakeUp(handle_);
+    }
+  }
+  return received;
+}
+
+size_t RingSyncSocket::Peek() {
+  DCHECK_NE(handle_, kInvalidHandle);
+  if (!receive_ring_)
+    return 0;
+  const uint32_t available =
+      static_cast<uint32_t>(
+          subtle::Acquire_Load(&receive_ring_->write_position)) -
+      static_cast<uint32_t>(
+          subtle::NoBarrier_Load(&receive_ring_->read_position));
+  return available <= capacity_ ? available : 0;
+}
+
+}  // namespace base
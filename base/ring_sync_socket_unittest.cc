@@ -0,0 +1,266 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/ring_sync_socket.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "base/process/process_handle.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const size_t kSmallCapacity = 64;
+
+uint8_t ByteAt(size_t index) {
+  return static_cast<uint8_t>(index * 13 + index / 256);
+}
+
+// Sends |size| bytes in chunks of growing sizes, on its own thread.
+class SenderThread : public DelegateSimpleThread::Delegate {
+ public:
+  SenderThread(SyncSocket* socket, size_t size)
+      : socket_(socket), size_(size), sent_(0), thread_(this, "Sender") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    std::vector<uint8_t> buffer;
+    size_t chunk = 1;
+    while (sent_ < size_) {
+      buffer.resize(std::min(chunk, size_ - sent_));
+      for (size_t i = 0; i < buffer.size(); i++)
+        buffer[i] = ByteAt(sent_ + i);
+      if (socket_->Send(buffer.data(), buffer.size()) != buffer.size())
+        return;
+      sent_ += buffer.size();
+      chunk = chunk % 1000 + 7;
+    }
+  }
+
+  size_t Join() {
+    thread_.Join();
+    return sent_;
+  }
+
+ private:
+  SyncSocket* socket_;
+  const size_t size_;
+  size_t sent_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(SenderThread);
+};
+
+// Receives on its own thread, until the socket fails.
+class ReceiverThread : public DelegateSimpleThread::Delegate {
+ public:
+  explicit ReceiverThread(SyncSocket* socket)
+      : socket_(socket), thread_(this, "Receiver") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    int data;
+    EXPECT_EQ(0u, socket_->Receive(&data, sizeof(data)));
+  }
+
+  void Join() { thread_.Join(); }
+
+ private:
+  SyncSocket* socket_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReceiverThread);
+};
+
+}  // namespace
+
+TEST(RingSyncSocketTest, SendReceivePeek) {
+  RingSyncSocket socket_a;
+  RingSyncSocket socket_b;
+  ASSERT_TRUE(RingSyncSocket::CreatePair(&socket_a, &socket_b));
+
+  const int kSending = 123;
+  int received = 0;
+  ASSERT_EQ(0u, socket_a.Peek());
+  ASSERT_EQ(0u, socket_b.Peek());
+  ASSERT_EQ(sizeof(kSending), socket_a.Send(&kSending, sizeof(kSending)));
+  ASSERT_EQ(0u, socket_a.Peek());
+  ASSERT_EQ(sizeof(kSending), socket_b.Peek());
+  ASSERT_EQ(sizeof(kSending), socket_b.Receive(&received, sizeof(received)));
+  EXPECT_EQ(kSending, received);
+  ASSERT_EQ(0u, socket_b.Peek());
+
+  // And the reverse.
+  received = 0;
+  ASSERT_EQ(sizeof(kSending), socket_b.Send(&kSending, sizeof(kSending)));
+  ASSERT_EQ(sizeof(kSending), socket_a.Peek());
+  ASSERT_EQ(sizeof(kSending), socket_a.Receive(&received, sizeof(received)));
+  EXPECT_EQ(kSending, received);
+
+  EXPECT_TRUE(socket_a.Close());
+  EXPECT_TRUE(socket_b.Close());
+}
+
+TEST(RingSyncSocketTest, InvalidCapacity) {
+  RingSyncSocket socket_a;
+  RingSyncSocket socket_b;
+  EXPECT_FALSE(RingSyncSocket::CreatePairWithCapacity(100, &socket_a,
+                                                      &socket_b));
+  EXPECT_FALSE(RingSyncSocket::CreatePairWithCapacity(32, &socket_a,
+                                                      &socket_b));
+  EXPECT_EQ(SyncSocket::kInvalidHandle, socket_a.handle());
+}
+
+// Streams more than the ring buffers hold, through both of them at once, so
+// that both ends wait for data and for space.
+TEST(RingSyncSocketTest, Stream) {
+  const size_t kSize = 1024 * 1024;
+  const size_t kCapacities[] = {kSmallCapacity, 4096,
+                                RingSyncSocket::kDefaultCapacity};
+  for (size_t capacity : kCapacities) {
+    RingSyncSocket socket_a;
+    RingSyncSocket socket_b;
+    ASSERT_TRUE(RingSyncSocket::CreatePairWithCapacity(capacity, &socket_a,
+                                                       &socket_b));
+    SenderThread sender_a(&socket_a, kSize);
+    SenderThread sender_b(&socket_b, kSize);
+
+    std::vector<uint8_t> received_a(kSize);
+    std::vector<uint8_t> received_b(kSize);
+    for (size_t offset = 0; offset < kSize; offset += 4096) {
+      ASSERT_EQ(4096u, socket_b.Receive(&received_b[offset], 4096));
+      ASSERT_EQ(4096u, socket_a.Receive(&received_a[offset], 4096));
+    }
+    EXPECT_EQ(kSize, sender_a.Join());
+    EXPECT_EQ(kSize, sender_b.Join());
+    for (size_t i = 0; i < kSize; i++) {
+      ASSERT_EQ(ByteAt(i), received_a[i]);
+      ASSERT_EQ(ByteAt(i), received_b[i]);
+    }
+    EXPECT_EQ(0u, socket_a.Peek());
+  }
+}
+
+TEST(RingSyncSocketTest, ReceiveWithTimeout) {
+  RingSyncSocket socket_a;
+  RingSyncSocket socket_b;
+  ASSERT_TRUE(RingSyncSocket::CreatePair(&socket_a, &socket_b));
+
+  const TimeDelta kTimeout = TimeDelta::FromMilliseconds(50);
+  int data[2] = {0, 0};
+  TimeTicks start = TimeTicks::Now();
+  EXPECT_EQ(0u, socket_b.ReceiveWithTimeout(data, sizeof(data), kTimeout));
+  EXPECT_GE(TimeTicks::Now() - start, kTimeout);
+
+  // Only part of the data is there: it is returned after the timeout.
+  const int kSending = 42;
+  ASSERT_EQ(sizeof(kSending), socket_a.Send(&kSending, sizeof(kSending)));
+  start = TimeTicks::Now();
+  EXPECT_EQ(sizeof(kSending),
+            socket_b.ReceiveWithTimeout(data, sizeof(data), kTimeout));
+  EXPECT_GE(TimeTicks::Now() - start, kTimeout);
+  EXPECT_EQ(kSending, data[0]);
+
+  // All of it is there: it is returned at once.
+  ASSERT_EQ(sizeof(data), socket_a.Send(data, sizeof(data)));
+  EXPECT_EQ(sizeof(data),
+            socket_b.ReceiveWithTimeout(data, sizeof(data), kTimeout));
+}
+
+TEST(RingSyncSocketTest, ShutdownCancelsReceive) {
+  RingSyncSocket socket_a;
+  RingSyncSocket socket_b;
+  ASSERT_TRUE(RingSyncSocket::CreatePair(&socket_a, &socket_b));
+
+  ReceiverThread receiver_a(&socket_a);
+  ReceiverThread receiver_b(&socket_b);
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(20));
+  ASSERT_TRUE(socket_a.Shutdown());
+  receiver_a.Join();
+  receiver_b.Join();
+
+  const int kSending = 1;
+  EXPECT_EQ(0u, socket_a.Send(&kSending, sizeof(kSending)));
+}
+
+TEST(RingSyncSocketTest, ShutdownCancelsSend) {
+  RingSyncSocket socket_a;
+  RingSyncSocket socket_b;
+  ASSERT_TRUE(RingSyncSocket::CreatePairWithCapacity(kSmallCapacity,
+                                                     &socket_a, &socket_b));
+  SenderThread sender(&socket_a, 100 * kSmallCapacity);
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(20));
+  ASSERT_TRUE(socket_b.Shutdown());
+  EXPECT_LT(sender.Join(), 100 * kSmallCapacity);
+}
+
+TEST(RingSyncSocketTest, PeerClosed) {
+  RingSyncSocket socket_a;
+  RingSyncSocket socket_b;
+  ASSERT_TRUE(RingSyncSocket::CreatePair(&socket_a, &socket_b));
+
+  // What was sent before the peer closed its end can still be received.
+  const int kSending = 7;
+  ASSERT_EQ(sizeof(kSending), socket_a.Send(&kSending, sizeof(kSending)));
+  ASSERT_TRUE(socket_a.Close());
+  int received = 0;
+  EXPECT_EQ(sizeof(received), socket_b.Receive(&received, sizeof(received)));
+  EXPECT_EQ(kSending, received);
+  EXPECT_EQ(0u, socket_b.Receive(&received, sizeof(received)));
+}
+
+TEST(RingSyncSocketTest, TransitDescriptors) {
+  RingSyncSocket socket_a;
+  scoped_ptr<RingSyncSocket> socket_b(new RingSyncSocket);
+  ASSERT_TRUE(RingSyncSocket::CreatePair(&socket_a, socket_b.get()));
+
+  // Recreate |socket_b| from copies of its descriptors, as another process
+  // would.
+  RingSyncSocket::TransitDescriptors descriptors;
+  ASSERT_TRUE(socket_b->PrepareTransitDescriptors(GetCurrentProcessHandle(),
+                                                  &descriptors));
+  descriptors.memory = SharedMemory::DuplicateHandle(descriptors.memory);
+  descriptors.receive_socket.fd = dup(descriptors.receive_socket.fd);
+  descriptors.send_socket.fd = dup(descriptors.send_socket.fd);
+  socket_b.reset();
+  RingSyncSocket transited_b(descriptors);
+  ASSERT_NE(SyncSocket::kInvalidHandle, transited_b.handle());
+
+  const int kSending = 11;
+  int received = 0;
+  ASSERT_EQ(sizeof(kSending), socket_a.Send(&kSending, sizeof(kSending)));
+  ASSERT_EQ(sizeof(received),
+            transited_b.Receive(&received, sizeof(received)));
+  EXPECT_EQ(kSending, received);
+  ASSERT_EQ(sizeof(kSending), transited_b.Send(&kSending, sizeof(kSending)));
+  ASSERT_EQ(sizeof(received), socket_a.Receive(&received, sizeof(received)));
+
+  // Descriptors of the wrong ring buffer are refused.
+  RingSyncSocket::TransitDescriptors invalid;
+  ASSERT_TRUE(socket_a.PrepareTransitDescriptors(GetCurrentProcessHandle(),
+                                                 &invalid));
+  invalid.memory = SharedMemory::DuplicateHandle(invalid.memory);
+  invalid.receive_socket.fd = dup(invalid.receive_socket.fd);
+  invalid.send_socket.fd = dup(invalid.send_socket.fd);
+  invalid.receive_ring = 2;
+  RingSyncSocket invalid_socket(invalid);
+  EXPECT_EQ(SyncSocket::kInvalidHandle, invalid_socket.handle());
+}
+
+}  // namespace base
@@ -10,6 +10,7 @@
 #include <string>
 
 #include "base/base_export.h"
+#include "base/strings/string_piece.h"
 
 namespace base {
 
@@ -26,6 +27,15 @@ BASE_EXPORT std::string SHA1HashString(const std::string& str);
 BASE_EXPORT void SHA1HashBytes(const unsigned char* data, size_t len,
                                unsigned char* hash);
 
+// Computes the SHA-1 hashes of the |count| messages in |messages| and puts
+// the hash of messages[i] at |hashes| + i * kSHA1Length. |hashes| must be
+// |count| * kSHA1Length bytes long. Hashing many messages at once is faster
+// than hashing them one by one on CPUs with AVX2, which can work on eight
+// messages in parallel.
+BASE_EXPORT void SHA1HashMultiple(const StringPiece* messages,
+                                  size_t count,
+                                  unsigned char* hashes);
+
 }  // namespace base
 
 #endif  // BASE_SHA1_H_
@@ -0,0 +1,79 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/sha1.h"
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "base/format_macros.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+// Each measurement hashes this many bytes in total.
+const size_t kBytesPerMeasurement = 64 * 1024 * 1024;
+
+void PrintThroughput(const std::string& measurement,
+                     size_t message_size,
+                     TimeDelta elapsed) {
+  perf_test::PrintResult(
+      measurement, "", StringPrintf("%" PRIuS "_bytes", message_size),
+      kBytesPerMeasurement / elapsed.InSecondsF() / (1024 * 1024), "MiB/s",
+      true);
+}
+
+void MeasureSingle(size_t message_size) {
+  const std::string message(message_size, 'a');
+  const size_t iterations = kBytesPerMeasurement / message_size;
+  unsigned char hash[kSHA1Length];
+
+  TimeTicks start = TimeTicks::Now();
+  for (size_t i = 0; i < iterations; i++) {
+    SHA1HashBytes(reinterpret_cast<const unsigned char*>(message.data()),
+                  message.size(), hash);
+  }
+  PrintThroughput("sha1_single", message_size, TimeTicks::Now() - start);
+}
+
+void MeasureMultiple(size_t message_size) {
+  // Hash the messages in batches of 64, which keeps the data in cache.
+  const size_t kBatchSize = 64;
+  const std::string data(kBatchSize * message_size, 'a');
+  std::vector<StringPiece> messages;
+  for (size_t i = 0; i < kBatchSize; i++)
+    messages.push_back(StringPiece(data.data() + i * message_size,
+                                   message_size));
+  std::vector<unsigned char> hashes(kBatchSize * kSHA1Length);
+  const size_t iterations = kBytesPerMeasurement / data.size();
+
+  TimeTicks start = TimeTicks::Now();
+  for (size_t i = 0; i < iterations; i++)
+    SHA1HashMultiple(messages.data(), messages.size(), hashes.data());
+  PrintThroughput("sha1_multiple", message_size, TimeTicks::Now() - start);
+}
+
+}  // namespace
+
+TEST(SHA1PerfTest, Single) {
+  MeasureSingle(64);
+  MeasureSingle(1024);
+  MeasureSingle(1024 * 1024);
+}
+
+TEST(SHA1PerfTest, Multiple) {
+  MeasureMultiple(64);
+  MeasureMultiple(1024);
+  MeasureMultiple(16 * 1024);
+}
+
+}  // namespace base
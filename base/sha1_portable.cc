@@ -8,11 +8,17 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <algorithm>
+
+#include "base/cpu.h"
+#include "base/sha_internal.h"
+#include "build/build_config.h"
 
 namespace base {
 
-// Implementation of SHA-1. Only handles data in byte-sized blocks,
-// which simplifies the code a fair bit.
+// Implementation of SHA-1. The block function, which does all of the work,
+// has a portable implementation and, on x86, implementations using the SHA
+// extensions and AVX2. The best one for the CPU is picked at runtime.
 
 // Identifier names follow notation in FIPS PUB 180-3, where you'll
 // also find a description of the algorithm:
@@ -48,154 +54,421 @@ class SecureHashAlgorithm {
   }
 
  private:
-  void Pad();
-  void Process();
-
-  uint32_t A, B, C, D, E;
-
   uint32_t H[5];
 
-  union {
-    uint32_t W[80];
-    uint8_t M[64];
-  };
+  // The buffered bytes of a partial block.
+  uint8_t M[64];
 
   uint32_t cursor;
   uint64_t l;
 };
 
-static inline uint32_t f(uint32_t t, uint32_t B, uint32_t C, uint32_t D) {
-  if (t < 20) {
-    return (B & C) | ((~B) & D);
-  } else if (t < 40) {
-    return B ^ C ^ D;
-  } else if (t < 60) {
-    return (B & C) | (B & D) | (C & D);
-  } else {
-    return B ^ C ^ D;
+namespace {
+
+using internal::PadSHAFinalBlocks;
+using internal::WriteBigEndian32;
+
+const size_t kBlockSize = internal::kSHABlockSize;
+
+const uint32_t kInitialState[5] = {
+  0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+};
+
+// Processes |num_blocks| consecutive 64-byte blocks at |blocks|, updating the
+// five words of |state|.
+typedef void (*BlockFunction)(uint32_t* state,
+                              const uint8_t* blocks,
+                              size_t num_blocks);
+
+inline uint32_t S(uint32_t n, uint32_t X) {
+  return (X << n) | (X >> (32-n));
+}
+
+inline uint32_t ReadBigEndian32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void ProcessBlocksPortable(uint32_t* state,
+                           const uint8_t* blocks,
+                           size_t num_blocks) {
+  for (; num_blocks; num_blocks--, blocks += kBlockSize) {
+    uint32_t W[80];
+    uint32_t t;
+
+    // Each a...e corresponds to a section in the FIPS 180-3 algorithm.
+
+    // a.
+    for (t = 0; t < 16; ++t)
+      W[t] = ReadBigEndian32(blocks + 4 * t);
+
+    // b.
+    for (t = 16; t < 80; ++t)
+      W[t] = S(1, W[t - 3] ^ W[t - 8] ^ W[t - 14] ^ W[t - 16]);
+
+    // c.
+    uint32_t A = state[0];
+    uint32_t B = state[1];
+    uint32_t C = state[2];
+    uint32_t D = state[3];
+    uint32_t E = state[4];
+
+    // d. The four kinds of rounds are split into separate loops, so that the
+    // round function and constant are fixed within each loop.
+#define SHA1_ROUND(F, K)                       \
+    do {                                       \
+      uint32_t TEMP = S(5, A) + (F) + E + W[t] + (K); \
+      E = D;                                   \
+      D = C;                                   \
+      C = S(30, B);                            \
+      B = A;                                   \
+      A = TEMP;                                \
+    } while (0)
+    for (t = 0; t < 20; ++t)
+      SHA1_ROUND(D ^ (B & (C ^ D)), 0x5a827999);
+    for (; t < 40; ++t)
+      SHA1_ROUND(B ^ C ^ D, 0x6ed9eba1);
+    for (; t < 60; ++t)
+      SHA1_ROUND((B & C) | (D & (B | C)), 0x8f1bbcdc);
+    for (; t < 80; ++t)
+      SHA1_ROUND(B ^ C ^ D, 0xca62c1d6);
+#undef SHA1_ROUND
+
+    // e.
+    state[0] += A;
+    state[1] += B;
+    state[2] += C;
+    state[3] += D;
+    state[4] += E;
   }
 }
 
-static inline uint32_t S(uint32_t n, uint32_t X) {
-  return (X << n) | (X >> (32-n));
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+// Uses the SHA extensions, which do four rounds per instruction. The round
+// and message schedule instructions are interleaved as suggested by Intel.
+__attribute__((target("sha,sse4.1")))
+void ProcessBlocksSHA(uint32_t* state,
+                      const uint8_t* blocks,
+                      size_t num_blocks) {
+  const __m128i kByteSwap =
+      _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+  // ABCD holds A in its highest lane; E is in the highest lane of E0/E1.
+  __m128i abcd = _mm_shuffle_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1b);
+  __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+  __m128i e1;
+  __m128i msg[4];
+
+  for (; num_blocks; num_blocks--, blocks += kBlockSize) {
+    const __m128i abcd_save = abcd;
+    const __m128i e_save = e0;
+
+// Rounds 4 * i ... 4 * i + 3. |e| holds E plus the message words for these
+// rounds, |e_next| receives A for the next four rounds.
+#define SHA1_ROUNDS4(i, e, e_next)                                         \
+    do {                                                                   \
+      if (i < 4) {                                                         \
+        msg[i % 4] = _mm_shuffle_epi8(                                     \
+            _mm_loadu_si128(                                               \
+                reinterpret_cast<const __m128i*>(blocks + 16 * i)),       \
+            kByteSwap);                                                    \
+      }                                                                    \
+      if (i == 0)                                                          \
+        e = _mm_add_epi32(e, msg[0]);                                      \
+      else                                                                 \
+        e = _mm_sha1nexte_epu32(e, msg[i % 4]);                            \
+      e_next = abcd;                                                       \
+      if (i >= 3 && i <= 18)                                               \
+        msg[(i + 1) % 4] = _mm_sha1msg2_epu32(msg[(i + 1) % 4], msg[i % 4]); \
+      abcd = _mm_sha1rnds4_epu32(abcd, e, i / 5);                          \
+      if (i >= 1 && i <= 16)                                               \
+        msg[(i + 3) % 4] = _mm_sha1msg1_epu32(msg[(i + 3) % 4], msg[i % 4]); \
+      if (i >= 2 && i <= 17)                                               \
+        msg[(i + 2) % 4] = _mm_xor_si128(msg[(i + 2) % 4], msg[i % 4]);    \
+    } while (0)
+
+    SHA1_ROUNDS4(0, e0, e1);
+    SHA1_ROUNDS4(1, e1, e0);
+    SHA1_ROUNDS4(2, e0, e1);
+    SHA1_ROUNDS4(3, e1, e0);
+    SHA1_ROUNDS4(4, e0, e1);
+    SHA1_ROUNDS4(5, e1, e0);
+    SHA1_ROUNDS4(6, e0, e1);
+    SHA1_ROUNDS4(7, e1, e0);
+    SHA1_ROUNDS4(8, e0, e1);
+    SHA1_ROUNDS4(9, e1, e0);
+    SHA1_ROUNDS4(10, e0, e1);
+    SHA1_ROUNDS4(11, e1, e0);
+    SHA1_ROUNDS4(12, e0, e1);
+    SHA1_ROUNDS4(13, e1, e0);
+    SHA1_ROUNDS4(14, e0, e1);
+    SHA1_ROUNDS4(15, e1, e0);
+    SHA1_ROUNDS4(16, e0, e1);
+    SHA1_ROUNDS4(17, e1, e0);
+    SHA1_ROUNDS4(18, e0, e1);
+    SHA1_ROUNDS4(19, e1, e0);
+#undef SHA1_ROUNDS4
+
+    e0 = _mm_sha1nexte_epu32(e0, e_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+  }
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state),
+                   _mm_shuffle_epi32(abcd, 0x1b));
+  state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+// The multi-buffer kernel hashes one block of each of eight messages at a
+// time, with each 32-bit lane of the AVX2 registers working on one message.
+const size_t kNumLanes = internal::kSHANumLanes;
+
+// With fewer messages too many lanes would idle, and hashing the messages one
+// by one is faster.
+const size_t kMinMessagesForAVX2 = 4;
+
+// The state of the eight lanes, transposed: words[i][lane] is word i of the
+// state of |lane|.
+struct LaneStates {
+  uint32_t words[5][kNumLanes];
+};
+
+template <int n>
+__attribute__((target("avx2")))
+inline __m256i RotateLeft(__m256i x) {
+  return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
 }
 
-static inline uint32_t K(uint32_t t) {
-  if (t < 20) {
-    return 0x5a827999;
-  } else if (t < 40) {
-    return 0x6ed9eba1;
-  } else if (t < 60) {
-    return 0x8f1bbcdc;
+__attribute__((target("avx2")))
+void ProcessBlocksAVX2x8(LaneStates* states,
+                         const uint8_t* const blocks[kNumLanes]) {
+  const __m256i kByteSwap = _mm256_setr_epi8(
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+  // Load the blocks and transpose them, so that w[t] holds message word t of
+  // every lane.
+  __m256i w[16];
+  for (int half = 0; half < 2; half++) {
+    for (size_t lane = 0; lane < kNumLanes; lane++) {
+      w[8 * half + lane] = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(blocks[lane] + 32 * half));
+    }
+    internal::TransposeSHALanes(w + 8 * half);
+  }
+  for (int t = 0; t < 16; t++)
+    w[t] = _mm256_shuffle_epi8(w[t], kByteSwap);
+
+  __m256i v[5];
+  for (int i = 0; i < 5; i++) {
+    v[i] = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(states->words[i]));
+  }
+  __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4];
+
+#define SHA1_ROUND(F, K)                                                    \
+  do {                                                                      \
+    if (t >= 16) {                                                          \
+      w[t & 15] = RotateLeft<1>(_mm256_xor_si256(                           \
+          _mm256_xor_si256(w[(t - 3) & 15], w[(t - 8) & 15]),               \
+          _mm256_xor_si256(w[(t - 14) & 15], w[t & 15])));                  \
+    }                                                                       \
+    __m256i temp = _mm256_add_epi32(                                        \
+        _mm256_add_epi32(RotateLeft<5>(a), (F)),                            \
+        _mm256_add_epi32(_mm256_add_epi32(e, _mm256_set1_epi32(K)),         \
+                         w[t & 15]));                                       \
+    e = d;                                                                  \
+    d = c;                                                                  \
+    c = RotateLeft<30>(b);                                                  \
+    b = a;                                                                  \
+    a = temp;                                                               \
+  } while (0)
+  int t;
+  for (t = 0; t < 20; t++) {
+    SHA1_ROUND(_mm256_xor_si256(
+                   d, _mm256_and_si256(b, _mm256_xor_si256(c, d))),
+               0x5a827999);
+  }
+  for (; t < 40; t++)
+    SHA1_ROUND(_mm256_xor_si256(_mm256_xor_si256(b, c), d), 0x6ed9eba1);
+  for (; t < 60; t++) {
+    SHA1_ROUND(_mm256_or_si256(_mm256_and_si256(b, c),
+                               _mm256_and_si256(d, _mm256_or_si256(b, c))),
+               static_cast<int>(0x8f1bbcdc));
+  }
+  for (; t < 80; t++) {
+    SHA1_ROUND(_mm256_xor_si256(_mm256_xor_si256(b, c), d),
+               static_cast<int>(0xca62c1d6));
+  }
+#undef SHA1_ROUND
+
+  v[0] = _mm256_add_epi32(v[0], a);
+  v[1] = _mm256_add_epi32(v[1], b);
+  v[2] = _mm256_add_epi32(v[2], c);
+  v[3] = _mm256_add_epi32(v[3], d);
+  v[4] = _mm256_add_epi32(v[4], e);
+  for (int i = 0; i < 5; i++) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(states->words[i]), v[i]);
+  }
+}
+
+// A message being hashed in one lane of the multi-buffer kernel. The lane
+// first runs over the full blocks of the message in place, then over the
+// padded copy of its tail.
+struct Lane {
+  // The index of the message, or -1 if the lane is idle.
+  ptrdiff_t message;
+
+  // The next block to process, and the number of blocks left from there on
+  // before switching to the tail or finishing.
+  const uint8_t* next_block;
+  size_t num_blocks;
+
+  bool in_tail;
+  size_t num_tail_blocks;
+  uint8_t tail[2 * kBlockSize];
+};
+
+void StartLane(Lane* lane,
+               size_t lane_index,
+               ptrdiff_t message_index,
+               const StringPiece& message,
+               LaneStates* states) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(message.data());
+  const size_t num_full_blocks = message.size() / kBlockSize;
+  lane->message = message_index;
+  lane->num_tail_blocks =
+      PadSHAFinalBlocks(data + num_full_blocks * kBlockSize,
+                        message.size() % kBlockSize, message.size(),
+                        lane->tail);
+  if (num_full_blocks) {
+    lane->next_block = data;
+    lane->num_blocks = num_full_blocks;
+    lane->in_tail = false;
   } else {
-    return 0xca62c1d6;
+    lane->next_block = lane->tail;
+    lane->num_blocks = lane->num_tail_blocks;
+    lane->in_tail = true;
   }
+  for (int i = 0; i < 5; i++)
+    states->words[i][lane_index] = kInitialState[i];
 }
 
-static inline void swapends(uint32_t* t) {
-  *t = (*t >> 24) | ((*t >> 8) & 0xff00) | ((*t & 0xff00) << 8) | (*t << 24);
+void HashMultipleAVX2(const StringPiece* messages,
+                      size_t count,
+                      unsigned char* hashes) {
+  // Idle lanes hash this block, and their results are ignored.
+  static const uint8_t kIdleBlock[kBlockSize] = {0};
+
+  Lane lanes[kNumLanes];
+  LaneStates states;
+  size_t next_message = 0;
+  size_t num_busy_lanes = 0;
+  for (size_t i = 0; i < kNumLanes; i++) {
+    if (next_message < count) {
+      StartLane(&lanes[i], i, next_message, messages[next_message], &states);
+      next_message++;
+      num_busy_lanes++;
+    } else {
+      lanes[i].message = -1;
+    }
+  }
+
+  const uint8_t* blocks[kNumLanes];
+  while (num_busy_lanes) {
+    for (size_t i = 0; i < kNumLanes; i++)
+      blocks[i] = lanes[i].message >= 0 ? lanes[i].next_block : kIdleBlock;
+    ProcessBlocksAVX2x8(&states, blocks);
+
+    for (size_t i = 0; i < kNumLanes; i++) {
+      Lane* lane = &lanes[i];
+      if (lane->message < 0)
+        continue;
+      lane->next_block += kBlockSize;
+      if (--lane->num_blocks)
+        continue;
+      if (!lane->in_tail) {
+        lane->next_block = lane->tail;
+        lane->num_blocks = lane->num_tail_blocks;
+        lane->in_tail = true;
+        continue;
+      }
+
+      // The message is done; the lane moves on to the next one, if any.
+      internal::StoreSHALaneDigest(states.words, 5, i,
+                                   hashes + lane->message * kSHA1Length);
+      if (next_message < count) {
+        StartLane(lane, i, next_message, messages[next_message], &states);
+        next_message++;
+      } else {
+        lane->message = -1;
+        num_busy_lanes--;
+      }
+    }
+  }
+}
+
+#endif  // defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+BlockFunction GetBlockFunction() {
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+  if (CPU::HasFeature(CPU::FEATURE_SHA) &&
+      CPU::HasFeature(CPU::FEATURE_SSE41)) {
+    return &ProcessBlocksSHA;
+  }
+#endif
+  return &ProcessBlocksPortable;
 }
 
+}  // namespace
+
 const int SecureHashAlgorithm::kDigestSizeBytes = 20;
 
 void SecureHashAlgorithm::Init() {
-  A = 0;
-  B = 0;
-  C = 0;
-  D = 0;
-  E = 0;
   cursor = 0;
   l = 0;
-  H[0] = 0x67452301;
-  H[1] = 0xefcdab89;
-  H[2] = 0x98badcfe;
-  H[3] = 0x10325476;
-  H[4] = 0xc3d2e1f0;
+  memcpy(H, kInitialState, sizeof(H));
 }
 
 void SecureHashAlgorithm::Final() {
-  Pad();
-  Process();
+  uint8_t blocks[2 * kBlockSize];
+  size_t num_blocks = PadSHAFinalBlocks(M, cursor, l, blocks);
+  GetBlockFunction()(H, blocks, num_blocks);
 
+  // Digest() returns the state words in big-endian byte order.
   for (int t = 0; t < 5; ++t)
-    swapends(&H[t]);
+    WriteBigEndian32(H[t], reinterpret_cast<uint8_t*>(&H[t]));
 }
 
 void SecureHashAlgorithm::Update(const void* data, size_t nbytes) {
   const uint8_t* d = reinterpret_cast<const uint8_t*>(data);
-  while (nbytes--) {
-    M[cursor++] = *d++;
-    if (cursor >= 64)
-      Process();
-    l += 8;
+  const BlockFunction process_blocks = GetBlockFunction();
+  l += nbytes;
+
+  // Complete a buffered partial block first.
+  if (cursor) {
+    size_t n = std::min(kBlockSize - cursor, nbytes);
+    memcpy(M + cursor, d, n);
+    cursor += n;
+    d += n;
+    nbytes -= n;
+    if (cursor < kBlockSize)
+      return;
+    process_blocks(H, M, 1);
+    cursor = 0;
   }
-}
-
-void SecureHashAlgorithm::Pad() {
-  M[cursor++] = 0x80;
 
-  if (cursor > 64-8) {
-    // pad out to next block
-    while (cursor < 64)
-      M[cursor++] = 0;
-
-    Process();
+  // Whole blocks are processed straight from |data|.
+  if (nbytes >= kBlockSize) {
+    process_blocks(H, d, nbytes / kBlockSize);
+    d += nbytes - nbytes % kBlockSize;
+    nbytes %= kBlockSize;
   }
 
-  while (cursor < 64-8)
-    M[cursor++] = 0;
-
-  M[cursor++] = (l >> 56) & 0xff;
-  M[cursor++] = (l >> 48) & 0xff;
-  M[cursor++] = (l >> 40) & 0xff;
-  M[cursor++] = (l >> 32) & 0xff;
-  M[cursor++] = (l >> 24) & 0xff;
-  M[cursor++] = (l >> 16) & 0xff;
-  M[cursor++] = (l >> 8) & 0xff;
-  M[cursor++] = l & 0xff;
-}
-
-void SecureHashAlgorithm::Process() {
-  uint32_t t;
-
-  // Each a...e corresponds to a section in the FIPS 180-3 algorithm.
-
-  // a.
-  //
-  // W and M are in a union, so no need to memcpy.
-  // memcpy(W, M, sizeof(M));
-  for (t = 0; t < 16; ++t)
-    swapends(&W[t]);
-
-  // b.
-  for (t = 16; t < 80; ++t)
-    W[t] = S(1, W[t - 3] ^ W[t - 8] ^ W[t - 14] ^ W[t - 16]);
-
-  // c.
-  A = H[0];
-  B = H[1];
-  C = H[2];
-  D = H[3];
-  E = H[4];
-
-  // d.
-  for (t = 0; t < 80; ++t) {
-    uint32_t TEMP = S(5, A) + f(t, B, C, D) + E + W[t] + K(t);
-    E = D;
-    D = C;
-    C = S(30, B);
-    B = A;
-    A = TEMP;
-  }
-
-  // e.
-  H[0] += A;
-  H[1] += B;
-  H[2] += C;
-  H[3] += D;
-  H[4] += E;
-
-  cursor = 0;
+  memcpy(M, d, nbytes);
+  cursor = nbytes;
 }
 
 std::string SHA1HashString(const std::string& str) {
@@ -214,4 +487,19 @@ void SHA1HashBytes(const unsigned char* data, size_t len,
   memcpy(hash, sha.Digest(), SecureHashAlgorithm::kDigestSizeBytes);
 }
 
+void SHA1HashMultiple(const StringPiece* messages,
+                      size_t count,
+                      unsigned char* hashes) {
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+  if (count >= kMinMessagesForAVX2 && CPU::HasFeature(CPU::FEATURE_AVX2)) {
+    HashMultipleAVX2(messages, count, hashes);
+    return;
+  }
+#endif
+  for (size_t i = 0; i < count; i++) {
+    SHA1HashBytes(reinterpret_cast<const unsigned char*>(messages[i].data()),
+                  messages[i].size(), hashes + i * kSHA1Length);
+  }
+}
+
 }  // namespace base
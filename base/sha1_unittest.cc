@@ -5,11 +5,28 @@
 #include "base/sha1.h"
 
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 #include <string>
+#include <vector>
 
+#include "base/cpu.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
+namespace {
+
+// Hiding these features from the dispatch runs every kernel the machine
+// supports: the SHA extensions or the portable block function for single
+// messages, and AVX2 or not for multiple messages.
+const int kDisabledFeatures[] = {
+    0, base::CPU::FEATURE_SHA, base::CPU::FEATURE_AVX2,
+    base::CPU::FEATURE_SHA | base::CPU::FEATURE_AVX2};
+
+}  // namespace
+
 TEST(SHA1Test, Test1) {
   // Example A.1 from FIPS 180-2: one-block message.
   std::string input = "abc";
@@ -107,3 +124,83 @@ TEST(SHA1Test, Test3Bytes) {
   for (size_t i = 0; i < base::kSHA1Length; i++)
     EXPECT_EQ(expected[i], output[i]);
 }
+
+TEST(SHA1Test, KnownAnswersEveryKernel) {
+  // The examples from FIPS 180-2, repeated so that the messages fill more
+  // than one batch of lanes.
+  const std::string kInputs[] = {
+      "abc", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      std::string(1000000, 'a')};
+  const unsigned char kExpected[][base::kSHA1Length] = {
+      {0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+       0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d},
+      {0x84, 0x98, 0x3e, 0x44, 0x1c, 0x3b, 0xd2, 0x6e, 0xba, 0xae,
+       0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5, 0xe5, 0x46, 0x70, 0xf1},
+      {0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e,
+       0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6f}};
+
+  const size_t kCount = 20;
+  std::vector<base::StringPiece> messages;
+  for (size_t i = 0; i < kCount; i++)
+    messages.push_back(kInputs[i % 3]);
+
+  for (size_t k = 0; k < arraysize(kDisabledFeatures); k++) {
+    base::CPU::SetDisabledFeaturesForTesting(kDisabledFeatures[k]);
+
+    for (size_t i = 0; i < arraysize(kInputs); i++) {
+      unsigned char hash[base::kSHA1Length];
+      base::SHA1HashBytes(
+          reinterpret_cast<const unsigned char*>(kInputs[i].data()),
+          kInputs[i].size(), hash);
+      EXPECT_EQ(0, memcmp(kExpected[i], hash, base::kSHA1Length))
+          << "disabled features " << kDisabledFeatures[k] << ", input " << i;
+    }
+
+    std::vector<unsigned char> hashes(kCount * base::kSHA1Length);
+    base::SHA1HashMultiple(messages.data(), kCount, hashes.data());
+    for (size_t i = 0; i < kCount; i++) {
+      EXPECT_EQ(0, memcmp(kExpected[i % 3], &hashes[i * base::kSHA1Length],
+                          base::kSHA1Length))
+          << "disabled features " << kDisabledFeatures[k] << ", message "
+          << i;
+    }
+  }
+  base::CPU::SetDisabledFeaturesForTesting(0);
+}
+
+TEST(SHA1Test, MultipleMatchesSingle) {
+  // Messages of every length up to three blocks, around the padding
+  // boundaries, and in batches that leave lanes idle.
+  std::string data(300, 0);
+  uint32_t x = 1;
+  for (size_t i = 0; i < data.size(); i++) {
+    x = x * 1103515245 + 12345;
+    data[i] = static_cast<char>(x >> 16);
+  }
+
+  for (size_t count = 0; count <= 200; count += count < 10 ? 1 : 19) {
+    std::vector<base::StringPiece> messages;
+    for (size_t i = 0; i < count; i++) {
+      // Vary the offset too, so that the blocks are not aligned.
+      messages.push_back(
+          base::StringPiece(data.data() + i % 7, (i * 37 + count) % 193));
+    }
+    std::vector<unsigned char> hashes(count * base::kSHA1Length + 1, 0xcc);
+    base::SHA1HashMultiple(messages.data(), count, hashes.data());
+
+    // The expected hashes come from the portable block function.
+    base::CPU::SetDisabledFeaturesForTesting(base::CPU::FEATURE_SHA);
+    for (size_t i = 0; i < count; i++) {
+      unsigned char expected[base::kSHA1Length];
+      base::SHA1HashBytes(
+          reinterpret_cast<const unsigned char*>(messages[i].data()),
+          messages[i].size(), expected);
+      EXPECT_EQ(0, memcmp(expected, &hashes[i * base::kSHA1Length],
+                          base::kSHA1Length))
+          << "count " << count << ", message " << i;
+    }
+    base::CPU::SetDisabledFeaturesForTesting(0);
+    // Nothing is written past the last hash.
+    EXPECT_EQ(0xcc, hashes.back());
+  }
+}
@@ -0,0 +1,99 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Helpers shared by the SHA-1 implementation in base/sha1_portable.cc and the
+// multi-buffer SHA-256 implementation in crypto/sha2.cc. Not for other uses.
+
+#ifndef BASE_SHA_INTERNAL_H_
+#define BASE_SHA_INTERNAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "base/cpu.h"
+
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+#include <immintrin.h>
+#endif
+
+namespace base {
+namespace internal {
+
+// SHA-1 and SHA-256 both work on 64-byte blocks.
+const size_t kSHABlockSize = 64;
+
+inline void WriteBigEndian32(uint32_t x, uint8_t* p) {
+  p[0] = static_cast<uint8_t>(x >> 24);
+  p[1] = static_cast<uint8_t>(x >> 16);
+  p[2] = static_cast<uint8_t>(x >> 8);
+  p[3] = static_cast<uint8_t>(x);
+}
+
+// Writes the padded last one or two blocks of a message of |total_length|
+// bytes, whose last |tail_length| (< 64) bytes are at |tail|, to |blocks|,
+// and returns the number of blocks written. The padding is a 1 bit, zeros,
+// and the length in bits as a big-endian 64-bit number.
+inline size_t PadSHAFinalBlocks(const uint8_t* tail,
+                                size_t tail_length,
+                                uint64_t total_length,
+                                uint8_t blocks[2 * kSHABlockSize]) {
+  const size_t num_blocks = tail_length < kSHABlockSize - 8 ? 1 : 2;
+  const size_t padded_length = num_blocks * kSHABlockSize;
+  memcpy(blocks, tail, tail_length);
+  blocks[tail_length] = 0x80;
+  memset(blocks + tail_length + 1, 0, padded_length - tail_length - 1 - 8);
+  const uint64_t bit_length = total_length * 8;
+  WriteBigEndian32(static_cast<uint32_t>(bit_length >> 32),
+                   blocks + padded_length - 8);
+  WriteBigEndian32(static_cast<uint32_t>(bit_length),
+                   blocks + padded_length - 4);
+  return num_blocks;
+}
+
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+// The multi-buffer kernels hash one block of each of eight messages at a
+// time, with each 32-bit lane of the AVX2 registers working on one message.
+const size_t kSHANumLanes = 8;
+
+// Transposes the 8x8 matrix of 32-bit words in |rows|. Applied to eight
+// message blocks, one per row, it gathers the same word of every lane.
+__attribute__((target("avx2")))
+inline void TransposeSHALanes(__m256i rows[8]) {
+  __m256i t[8];
+  for (int i = 0; i < 4; i++) {
+    t[2 * i] = _mm256_unpacklo_epi32(rows[2 * i], rows[2 * i + 1]);
+    t[2 * i + 1] = _mm256_unpackhi_epi32(rows[2 * i], rows[2 * i + 1]);
+  }
+  __m256i u[8];
+  for (int i = 0; i < 2; i++) {
+    u[4 * i] = _mm256_unpacklo_epi64(t[4 * i], t[4 * i + 2]);
+    u[4 * i + 1] = _mm256_unpackhi_epi64(t[4 * i], t[4 * i + 2]);
+    u[4 * i + 2] = _mm256_unpacklo_epi64(t[4 * i + 1], t[4 * i + 3]);
+    u[4 * i + 3] = _mm256_unpackhi_epi64(t[4 * i + 1], t[4 * i + 3]);
+  }
+  for (int i = 0; i < 4; i++) {
+    rows[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+    rows[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+  }
+}
+
+// Writes the digest of |lane| to |digest|: the big-endian state words of the
+// lane, from the |num_words| transposed |words|, where words[i][lane] is word
+// i of the state of |lane|.
+inline void StoreSHALaneDigest(const uint32_t (*words)[kSHANumLanes],
+                               size_t num_words,
+                               size_t lane,
+                               uint8_t* digest) {
+  for (size_t i = 0; i < num_words; i++)
+    WriteBigEndian32(words[i][lane], digest + 4 * i);
+}
+
+#endif  // defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_SHA_INTERNAL_H_
@@ -0,0 +1,420 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/strings/double_conversions.h"
+
+#include <string.h>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/macros.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// Both algorithms multiply by 128-bit approximations of powers of 5 or 10.
+struct UInt128 {
+  uint64_t low;
+  uint64_t high;
+};
+
+// Returns the low half of a * b, and sets |*high| to the high half.
+inline uint64_t Multiply128(uint64_t a, uint64_t b, uint64_t* high) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 Product;
+  const Product product = static_cast<Product>(a) * b;
+  *high = static_cast<uint64_t>(product >> 64);
+  return static_cast<uint64_t>(product);
+#else
+  const uint64_t a_low = a & 0xffffffff;
+  const uint64_t a_high = a >> 32;
+  const uint64_t b_low = b & 0xffffffff;
+  const uint64_t b_high = b >> 32;
+  const uint64_t low_low = a_low * b_low;
+  const uint64_t middle1 = a_high * b_low + (low_low >> 32);
+  const uint64_t middle2 = a_low * b_high + (middle1 & 0xffffffff);
+  *high = a_high * b_high + (middle1 >> 32) + (middle2 >> 32);
+  return (middle2 << 32) | (low_low & 0xffffffff);
+#endif
+}
+
+// Tables ----------------------------------------------------------------------
+
+// The number of bits kept of powers of 5 and of their inverses by Ryu.
+const int kPow5BitCount = 125;
+const int kPow5InvBitCount = 125;
+const int kPow5TableSize = 326;
+const int kPow5InvTableSize = 342;
+
+// The range of decimal exponents that Eisel-Lemire handles.
+const int kMinPow10 = -348;
+const int kMaxPow10 = 347;
+
+// Just enough of an unsigned big integer to compute the tables below.
+class BigNumber {
+ public:
+  static const int kMaxWords = 44;
+
+  explicit BigNumber(int power_of_two) : size_(power_of_two / 32 + 1) {
+    DCHECK_LT(size_, kMaxWords);
+    memset(words_, 0, sizeof(words_));
+    words_[power_of_two / 32] = 1u << (power_of_two % 32);
+  }
+
+  void MultiplyBy(uint32_t factor) {
+    uint64_t carry = 0;
+    for (int i = 0; i < size_; i++) {
+      carry += static_cast<uint64_t>(words_[i]) * factor;
+      words_[i] = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+    if (carry) {
+      CHECK_LT(size_, kMaxWords);
+      words_[size_++] = static_cast<uint32_t>(carry);
+    }
+  }
+
+  void DivideBy(uint32_t divisor) {
+    uint64_t remainder = 0;
+    for (int i = size_ - 1; i >= 0; i--) {
+      remainder = (remainder << 32) | words_[i];
+      words_[i] = static_cast<uint32_t>(remainder / divisor);
+      remainder %= divisor;
+    }
+    while (size_ > 1 && !words_[size_ - 1])
+      size_--;
+  }
+
+  int BitLength() const {
+    int length = 32 * size_;
+    for (uint32_t top = words_[size_ - 1]; !(top & 0x80000000); top <<= 1)
+      length--;
+    return length;
+  }
+
+  // Returns the low 128 bits of this number shifted right by |shift| bits, or
+  // left if |shift| is negative.
+  UInt128 Shifted(int shift) const {
+    UInt128 result;
+    result.low = BitsAt(shift) | static_cast<uint64_t>(BitsAt(shift + 32))
+                                     << 32;
+    result.high = BitsAt(shift + 64) |
+                  static_cast<uint64_t>(BitsAt(shift + 96)) << 32;
+    return result;
+  }
+
+ private:
+  uint32_t Word(int index) const {
+    return index >= 0 && index < size_ ? words_[index] : 0;
+  }
+
+  // Returns the 32 bits starting at bit |bit|, which may be negative.
+  uint32_t BitsAt(int bit) const {
+    const int word = bit >= 0 ? bit / 32 : -((31 - bit) / 32);
+    const uint64_t bits =
+        Word(word) | static_cast<uint64_t>(Word(word + 1)) << 32;
+    return static_cast<uint32_t>(bits >> (bit - 32 * word));
+  }
+
+  uint32_t words_[kMaxWords];
+  int size_;
+};
+
+// Returns the number of bits of 5^e, or 1 for e == 0.
+inline int Pow5Bits(int e) {
+  return static_cast<int>(((static_cast<uint32_t>(e) * 1217359) >> 19) + 1);
+}
+
+// Returns floor(log10(2^e)), for e >= 0.
+inline int Log10Pow2(int e) {
+  return static_cast<int>((static_cast<uint32_t>(e) * 78913) >> 18);
+}
+
+// Returns floor(log10(5^e)), for e >= 0.
+inline int Log10Pow5(int e) {
+  return static_cast<int>((static_cast<uint32_t>(e) * 732923) >> 20);
+}
+
+// The tables are computed exactly on first use rather than compiled in, as
+// they take about 20 KB.
+struct Tables {
+  Tables() {
+    // The top kPow5BitCount bits of 5^i, and one more than the inverse
+    // 2^(bits - 1 + kPow5InvBitCount) / 5^i. The inverse comes from the fixed
+    // point 2^1024 / 5^i, which dividing by 5 at each step rounds down just
+    // like dividing by 5^i once.
+    BigNumber pow5(0);
+    BigNumber pow5_inverse(1024);
+    for (int i = 0; i < kPow5InvTableSize; i++) {
+      if (i) {
+        pow5.MultiplyBy(5);
+        pow5_inverse.DivideBy(5);
+      }
+      const int bits = pow5.BitLength();
+      DCHECK_EQ(Pow5Bits(i), bits);
+      if (i < kPow5TableSize)
+        pow5_split[i] = pow5.Shifted(bits - kPow5BitCount);
+      UInt128& inverse = pow5_inv_split[i];
+      inverse = pow5_inverse.Shifted(1024 - (bits - 1 + kPow5InvBitCount));
+      if (++inverse.low == 0)
+        inverse.high++;
+    }
+
+    // The top 128 bits of 10^e, rounded down.
+    BigNumber pow10(0);
+    for (int e = 0; e <= kMaxPow10; e++) {
+      if (e)
+        pow10.MultiplyBy(10);
+      pow10_significands[e - kMinPow10] =
+          pow10.Shifted(pow10.BitLength() - 128);
+    }
+    BigNumber pow10_inverse(1344);
+    for (int e = -1; e >= kMinPow10; e--) {
+      pow10_inverse.DivideBy(10);
+      pow10_significands[e - kMinPow10] =
+          pow10_inverse.Shifted(pow10_inverse.BitLength() - 128);
+    }
+  }
+
+  UInt128 pow5_split[kPow5TableSize];
+  UInt128 pow5_inv_split[kPow5InvTableSize];
+  UInt128 pow10_significands[kMaxPow10 - kMinPow10 + 1];
+
+  DISALLOW_COPY_AND_ASSIGN(Tables);
+};
+
+LazyInstance<Tables>::Leaky g_tables = LAZY_INSTANCE_INITIALIZER;
+
+// Ryu -------------------------------------------------------------------------
+
+const int kMantissaBits = 52;
+const int kExponentBias = 1023;
+
+inline int Pow5Factor(uint64_t value) {
+  int count = 0;
+  for (; value % 5 == 0; value /= 5)
+    count++;
+  return count;
+}
+
+inline bool MultipleOfPowerOf5(uint64_t value, int p) {
+  return Pow5Factor(value) >= p;
+}
+
+inline bool MultipleOfPowerOf2(uint64_t value, int p) {
+  return (value & ((uint64_t{1} << p) - 1)) == 0;
+}
+
+// Returns (m * multiplier) >> shift, where m has at most 55 bits and the
+// shift is between 64 and 128.
+inline uint64_t MultiplyShift(uint64_t m,
+                              const UInt128& multiplier,
+                              int shift) {
+  uint64_t high1;
+  const uint64_t low1 = Multiply128(m, multiplier.high, &high1);
+  uint64_t high0;
+  Multiply128(m, multiplier.low, &high0);
+  const uint64_t sum = high0 + low1;
+  if (sum < high0)
+    high1++;
+  shift -= 64;
+  DCHECK(shift > 0 && shift < 64);
+  return (high1 << (64 - shift)) | (sum >> shift);
+}
+
+}  // namespace
+
+void ShortestDecimal(double value, uint64_t* digits, int* exponent) {
+  DCHECK(value > 0 && value <= 1.7976931348623157e308);
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint64_t ieee_mantissa = bits & ((uint64_t{1} << kMantissaBits) - 1);
+  const int ieee_exponent = static_cast<int>(bits >> kMantissaBits);
+  const Tables& tables = g_tables.Get();
+
+  // Step 1: decode, with two extra bits to represent the halfway points.
+  int e2;
+  uint64_t m2;
+  if (ieee_exponent == 0) {
+    e2 = 1 - kExponentBias - kMantissaBits - 2;
+    m2 = ieee_mantissa;
+  } else {
+    e2 = ieee_exponent - kExponentBias - kMantissaBits - 2;
+    m2 = (uint64_t{1} << kMantissaBits) | ieee_mantissa;
+  }
+  const bool accept_bounds = (m2 & 1) == 0;
+
+  // Step 2: the interval of values that round to |value| is (mm, mp) * 2^e2,
+  // which is closed when the mantissa is even. The lower half is shorter at
+  // powers of two.
+  const uint64_t mv = 4 * m2;
+  const uint64_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+  // Step 3: convert the interval to decimal, vr, vp and vm * 10^e10.
+  uint64_t vr, vp, vm;
+  int e10;
+  bool vm_is_trailing_zeros = false;
+  bool vr_is_trailing_zeros = false;
+  if (e2 >= 0) {
+    const int q = Log10Pow2(e2) - (e2 > 3);
+    e10 = q;
+    const int k = kPow5InvBitCount + Pow5Bits(q) - 1;
+    const int i = -e2 + q + k;
+    const UInt128& multiplier = tables.pow5_inv_split[q];
+    vr = MultiplyShift(mv, multiplier, i);
+    vp = MultiplyShift(mv + 2, multiplier, i);
+    vm = MultiplyShift(mv - 1 - mm_shift, multiplier, i);
+    if (q <= 21) {
+      // Only one of mp, mv, and mm can be a multiple of 5, if any.
+      if (mv % 5 == 0)
+        vr_is_trailing_zeros = MultipleOfPowerOf5(mv, q);
+      else if (accept_bounds)
+        vm_is_trailing_zeros = MultipleOfPowerOf5(mv - 1 - mm_shift, q);
+      else
+        vp -= MultipleOfPowerOf5(mv + 2, q);
+    }
+  } else {
+    const int q = Log10Pow5(-e2) - (-e2 > 1);
+    e10 = q + e2;
+    const int i = -e2 - q;
+    const int k = Pow5Bits(i) - kPow5BitCount;
+    const int j = q - k;
+    const UInt128& multiplier = tables.pow5_split[i];
+    vr = MultiplyShift(mv, multiplier, j);
+    vp = MultiplyShift(mv + 2, multiplier, j);
+    vm = MultiplyShift(mv - 1 - mm_shift, multiplier, j);
+    if (q <= 1) {
+      // mv has at least two trailing zero bits, mp at least one, and mm one
+      // if mm_shift is 1.
+      vr_is_trailing_zeros = true;
+      if (accept_bounds)
+        vm_is_trailing_zeros = mm_shift == 1;
+      else
+        vp--;
+    } else if (q < 63) {
+      vr_is_trailing_zeros = MultipleOfPowerOf2(mv, q);
+    }
+  }
+
+  // Step 4: remove the digits that vp and vm share with vr, rounding vr.
+  int removed = 0;
+  uint64_t output;
+  if (vm_is_trailing_zeros || vr_is_trailing_zeros) {
+    // The rare general case, where the bounds and the rounding are exact.
+    int last_removed_digit = 0;
+    while (vp / 10 > vm / 10) {
+      vm_is_trailing_zeros &= vm % 10 == 0;
+      vr_is_trailing_zeros &= last_removed_digit == 0;
+      last_removed_digit = static_cast<int>(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+    if (vm_is_trailing_zeros) {
+      while (vm % 10 == 0) {
+        vr_is_trailing_zeros &= last_removed_digit == 0;
+        last_removed_digit = static_cast<int>(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        removed++;
+      }
+    }
+    // Round to even if the exact number is ...50..0.
+    if (vr_is_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0)
+      last_removed_digit = 4;
+    output = vr + ((vr == vm && (!accept_bounds || !vm_is_trailing_zeros)) ||
+                   last_removed_digit >= 5);
+  } else {
+    bool round_up = false;
+    if (vp / 100 > vm / 100) {
+      round_up = vr % 100 >= 50;
+      vr /= 100;
+      vp /= 100;
+      vm /= 100;
+      removed += 2;
+    }
+    while (vp / 10 > vm / 10) {
+      round_up = vr % 10 >= 5;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+    output = vr + (vr == vm || round_up);
+  }
+
+  *digits = output;
+  *exponent = e10 + removed;
+}
+
+bool FastDecimalToDouble(uint64_t significand, int exponent, double* output) {
+  if (significand == 0) {
+    *output = 0;
+    return true;
+  }
+  if (exponent < kMinPow10 || exponent > kMaxPow10)
+    return false;
+  const UInt128& pow10 =
+      g_tables.Get().pow10_significands[exponent - kMinPow10];
+
+  // Normalize, so that the product has 127 or 128 bits.
+  int leading_zeros = 0;
+  for (; !(significand & (uint64_t{1} << 63)); significand <<= 1)
+    leading_zeros++;
+  // floor(log2(10) * exponent) is the exponent of 10^exponent.
+  uint64_t result_exponent = static_cast<uint64_t>(
+      ((217706 * exponent) >> 16) + 64 + kExponentBias - leading_zeros);
+
+  uint64_t high;
+  uint64_t low = Multiply128(significand, pow10.high, &high);
+  // The 9 bits below the 54 that are kept decide the rounding. If they are
+  // all ones, the truncated low half of the power may carry into them.
+  if ((high & 0x1ff) == 0x1ff && low + significand < significand) {
+    uint64_t extra_high;
+    const uint64_t extra_low =
+        Multiply128(significand, pow10.low, &extra_high);
+    uint64_t merged_high = high;
+    const uint64_t merged_low = low + extra_high;
+    if (merged_low < low)
+      merged_high++;
+    if ((merged_high & 0x1ff) == 0x1ff && merged_low + 1 == 0 &&
+        extra_low + significand < significand) {
+      return false;
+    }
+    high = merged_high;
+    low = merged_low;
+  }
+
+  // Keep 54 bits, one more than the result, to round.
+  const uint64_t top_bit = high >> 63;
+  uint64_t mantissa = high >> (top_bit + 9);
+  result_exponent -= 1 ^ top_bit;
+
+  // An exact half-way point, which could as well be just above or below.
+  if (low == 0 && (high & 0x1ff) == 0 && (mantissa & 3) == 1)
+    return false;
+
+  mantissa += mantissa & 1;
+  mantissa >>= 1;
+  if (mantissa >> 53) {
+    mantissa >>= 1;
+    result_exponent++;
+  }
+
+  // Zero or underflow means subnormal, and 0x7ff or more infinite.
+  if (result_exponent - 1 >= 0x7ff - 1)
+    return false;
+
+  const uint64_t bits = result_exponent << kMantissaBits |
+                        (mantissa & ((uint64_t{1} << kMantissaBits) - 1));
+  memcpy(output, &bits, sizeof(bits));
+  return true;
+}
+
+}  // namespace internal
+}  // namespace base
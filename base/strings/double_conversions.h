@@ -0,0 +1,40 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_STRINGS_DOUBLE_CONVERSIONS_H_
+#define BASE_STRINGS_DOUBLE_CONVERSIONS_H_
+
+#include <stdint.h>
+
+#include "base/base_export.h"
+
+// The binary <-> decimal conversions behind DoubleToString() and
+// StringToDouble(). Use those instead.
+
+namespace base {
+namespace internal {
+
+// Sets |*digits| and |*exponent| to the shortest decimal, digits * 10^exponent,
+// which converts back to |value|. When several are as short, this picks the
+// closest to |value|. |value| must be finite and positive.
+//
+// This is Ulf Adams' Ryu algorithm.
+BASE_EXPORT void ShortestDecimal(double value,
+                                 uint64_t* digits,
+                                 int* exponent);
+
+// Sets |*output| to significand * 10^exponent, correctly rounded, and returns
+// true. Returns false, without setting |*output|, when that is not normal and
+// finite, or when the rounding cannot be decided without more precision.
+//
+// This is the Eisel-Lemire algorithm, which only needs one or two 64-bit
+// multiplications.
+BASE_EXPORT bool FastDecimalToDouble(uint64_t significand,
+                                     int exponent,
+                                     double* output);
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_STRINGS_DOUBLE_CONVERSIONS_H_
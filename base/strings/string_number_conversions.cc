@@ -6,20 +6,115 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <float.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wctype.h>
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 
+#include "base/cpu.h"
 #include "base/logging.h"
 #include "base/numerics/safe_conversions.h"
 #include "base/numerics/safe_math.h"
+#include "base/strings/double_conversions.h"
 #include "base/strings/utf_string_conversions.h"
 
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+#include <immintrin.h>
+#endif
+
 namespace base {
 
 namespace {
 
+const char kHexChars[] = "0123456789ABCDEF";
+
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+// The encoders below look up the hex digits of both nibbles of every byte
+// with a byte shuffle, and interleave them. They consume whole vectors of
+// input and return the number of bytes consumed.
+
+__attribute__((target("ssse3")))
+size_t HexEncodeSSSE3(const uint8_t* input, size_t size, char* output) {
+  const __m128i digits =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(kHexChars));
+  const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+  size_t consumed = 0;
+  for (; size - consumed >= 16; consumed += 16, output += 32) {
+    const __m128i in = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(input + consumed));
+    const __m128i high = _mm_shuffle_epi8(
+        digits, _mm_and_si128(_mm_srli_epi16(in, 4), nibble_mask));
+    const __m128i low =
+        _mm_shuffle_epi8(digits, _mm_and_si128(in, nibble_mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                     _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 16),
+                     _mm_unpackhi_epi8(high, low));
+  }
+  return consumed;
+}
+
+__attribute__((target("avx2")))
+size_t HexEncodeAVX2(const uint8_t* input, size_t size, char* output) {
+  const __m128i digits128 =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(kHexChars));
+  const __m256i digits =
+      _mm256_inserti128_si256(_mm256_castsi128_si256(digits128), digits128, 1);
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+  size_t consumed = 0;
+  for (; size - consumed >= 32; consumed += 32, output += 64) {
+    const __m256i in = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(input + consumed));
+    const __m256i high = _mm256_shuffle_epi8(
+        digits, _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble_mask));
+    const __m256i low =
+        _mm256_shuffle_epi8(digits, _mm256_and_si256(in, nibble_mask));
+    // The unpacks interleave within 128-bit lanes, which hold bytes 0-7 and
+    // 16-23, and 8-15 and 24-31.
+    const __m256i first = _mm256_unpacklo_epi8(high, low);
+    const __m256i second = _mm256_unpackhi_epi8(high, low);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output),
+                        _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 32),
+                        _mm256_permute2x128_si256(first, second, 0x31));
+  }
+  // Compilers only do this when optimizing, and SSE code running with dirty
+  // upper halves of the AVX registers is much slower.
+  _mm256_zeroupper();
+  return consumed;
+}
+
+#endif  // defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+const char kDigitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Writes the decimal digits of |value| backwards, ending at |end|, and returns
+// where they start.
+char* WriteDigitsBackwards(uint64_t value, char* end) {
+  while (value >= 100) {
+    end -= 2;
+    memcpy(end, kDigitPairs + value % 100 * 2, 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    end -= 2;
+    memcpy(end, kDigitPairs + value * 2, 2);
+  } else {
+    *--end = static_cast<char>('0' + value);
+  }
+  return end;
+}
+
 template <typename STR, typename INT>
 struct IntToStringT {
   static STR IntToString(INT value) {
@@ -323,10 +418,180 @@ bool String16ToIntImpl(const StringPiece16& input, VALUE* output) {
       input.begin(), input.end(), output);
 }
 
+// The whitespace that strtod() skips in the C locale.
+bool IsStrtodSpace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// A decimal number, as parsed by StringToDouble().
+struct Decimal {
+  // The first 19 significant digits, which fit in 64 bits.
+  uint64_t significand = 0;
+  int significant_digits = 0;
+
+  // Whether nonzero digits follow those in |significand|.
+  bool truncated = false;
+
+  // The value is about significand * 10^exponent.
+  int64_t exponent = 0;
+
+  // The digits and the point, and the exponent that applies to all of them.
+  const char* digits_begin = nullptr;
+  const char* digits_end = nullptr;
+  int64_t explicit_exponent = 0;
+};
+
+// Converts |decimal| exactly, without its sign, for the rare inputs that the
+// fast paths cannot decide, which have many digits or are subnormal. This
+// hands strtod() digits and an exponent only, without a decimal point that
+// would depend on the locale.
+double SlowDecimalToDouble(const Decimal& decimal) {
+  // 768 significant digits decide the rounding of any double, and a nonzero
+  // digit after them is enough to stand for the rest.
+  const int kMaxDigits = 780;
+  char buffer[kMaxDigits + 2 + kMaxNumberStringLength];
+  int length = 0;
+  int64_t exponent = decimal.explicit_exponent;
+  bool seen_point = false;
+  bool dropped_nonzero = false;
+  for (const char* p = decimal.digits_begin; p != decimal.digits_end; ++p) {
+    if (*p == '.') {
+      seen_point = true;
+      continue;
+    }
+    if (seen_point)
+      exponent--;
+    if (length == 0 && *p == '0')
+      continue;
+    if (length < kMaxDigits) {
+      buffer[length++] = *p;
+    } else {
+      exponent++;
+      dropped_nonzero |= *p != '0';
+    }
+  }
+  if (length == 0)
+    return 0;
+  if (dropped_nonzero) {
+    buffer[length++] = '1';
+    exponent--;
+  }
+  buffer[length++] = 'e';
+  exponent = std::min<int64_t>(std::max<int64_t>(exponent, -100000), 100000);
+  length += Int64ToBuffer(exponent, buffer + length);
+  buffer[length] = '\0';
+
+  // strtod() sets errno for overflows and underflows, which are reported by
+  // the value.
+  const int saved_errno = errno;
+  const double value = strtod(buffer, nullptr);
+  errno = saved_errno;
+  return value;
+}
+
+double DecimalToDouble(const Decimal& decimal) {
+  // Beyond this, values are zero or infinite anyway.
+  const int exponent = static_cast<int>(
+      std::min<int64_t>(std::max<int64_t>(decimal.exponent, -100000), 100000));
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  // Powers of ten that doubles hold exactly.
+  static const double kExactPowersOfTen[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+
+  // Both the significand and the power of ten are exact doubles, so a single
+  // correctly rounded operation gives the correctly rounded result.
+  if (!decimal.truncated && decimal.significand <= (uint64_t{1} << 53) &&
+      exponent >= -22 && exponent <= 22) {
+    const double significand = static_cast<double>(decimal.significand);
+    return exponent < 0 ? significand / kExactPowersOfTen[-exponent]
+                        : significand * kExactPowersOfTen[exponent];
+  }
+#endif
+
+  // With truncated digits, the value lies between the significand and the
+  // next one, which must then round the same way.
+  double value;
+  double upper;
+  if (internal::FastDecimalToDouble(decimal.significand, exponent, &value) &&
+      (!decimal.truncated ||
+       (internal::FastDecimalToDouble(decimal.significand + 1, exponent,
+                                      &upper) &&
+        upper == value))) {
+    return value;
+  }
+  return SlowDecimalToDouble(decimal);
+}
+
+// Parses the longest decimal number at the beginning of [begin, end) into
+// |*decimal|, and returns where it ends, or |begin| if there is none.
+const char* ParseDecimal(const char* begin, const char* end, Decimal* decimal) {
+  // Larger exponents give zero or infinity for any number of digits that fit
+  // in memory.
+  const int64_t kMaxExponent = int64_t{1} << 40;
+  const int kMaxSignificantDigits = 19;
+
+  const char* p = begin;
+  decimal->digits_begin = p;
+  bool has_digits = false;
+  bool seen_point = false;
+  for (; p != end; ++p) {
+    if (*p == '.' && !seen_point) {
+      seen_point = true;
+      continue;
+    }
+    if (!IsDigit(*p))
+      break;
+    has_digits = true;
+    const int digit = *p - '0';
+    if (decimal->significant_digits < kMaxSignificantDigits) {
+      decimal->significand = decimal->significand * 10 + digit;
+      if (decimal->significand)
+        decimal->significant_digits++;
+      if (seen_point)
+        decimal->exponent--;
+    } else {
+      decimal->truncated |= digit != 0;
+      if (!seen_point)
+        decimal->exponent++;
+    }
+  }
+  if (!has_digits)
+    return begin;
+  decimal->digits_end = p;
+
+  // An exponent only counts if it has digits.
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    const char* exponent_begin = p + 1;
+    bool negative = false;
+    if (exponent_begin != end &&
+        (*exponent_begin == '-' || *exponent_begin == '+')) {
+      negative = *exponent_begin == '-';
+      ++exponent_begin;
+    }
+    if (exponent_begin != end && IsDigit(*exponent_begin)) {
+      int64_t exponent = 0;
+      for (p = exponent_begin; p != end && IsDigit(*p); ++p) {
+        if (exponent < kMaxExponent)
+          exponent = exponent * 10 + (*p - '0');
+      }
+      decimal->explicit_exponent = negative ? -exponent : exponent;
+      decimal->exponent += decimal->explicit_exponent;
+    }
+  }
+  return p;
+}
+
 }  // namespace
 
 std::string IntToString(int value) {
-  return IntToStringT<std::string, int>::IntToString(value);
+  char buffer[kMaxNumberStringLength];
+  return std::string(buffer, Int64ToBuffer(value, buffer));
 }
 
 string16 IntToString16(int value) {
@@ -334,7 +599,8 @@ string16 IntToString16(int value) {
 }
 
 std::string UintToString(unsigned int value) {
-  return IntToStringT<std::string, unsigned int>::IntToString(value);
+  char buffer[kMaxNumberStringLength];
+  return std::string(buffer, Uint64ToBuffer(value, buffer));
 }
 
 string16 UintToString16(unsigned int value) {
@@ -342,7 +608,8 @@ string16 UintToString16(unsigned int value) {
 }
 
 std::string Int64ToString(int64_t value) {
-  return IntToStringT<std::string, int64_t>::IntToString(value);
+  char buffer[kMaxNumberStringLength];
+  return std::string(buffer, Int64ToBuffer(value, buffer));
 }
 
 string16 Int64ToString16(int64_t value) {
@@ -350,7 +617,8 @@ string16 Int64ToString16(int64_t value) {
 }
 
 std::string Uint64ToString(uint64_t value) {
-  return IntToStringT<std::string, uint64_t>::IntToString(value);
+  char buffer[kMaxNumberStringLength];
+  return std::string(buffer, Uint64ToBuffer(value, buffer));
 }
 
 string16 Uint64ToString16(uint64_t value) {
@@ -358,7 +626,8 @@ string16 Uint64ToString16(uint64_t value) {
 }
 
 std::string SizeTToString(size_t value) {
-  return IntToStringT<std::string, size_t>::IntToString(value);
+  char buffer[kMaxNumberStringLength];
+  return std::string(buffer, Uint64ToBuffer(value, buffer));
 }
 
 string16 SizeTToString16(size_t value) {
@@ -366,18 +635,85 @@ string16 SizeTToString16(size_t value) {
 }
 
 std::string DoubleToString(double value) {
-  auto ret = std::to_string(value);
-  // If this returned an integer, don't do anything.
-  if (ret.find('.') == std::string::npos) {
-    return ret;
+  char buffer[kMaxNumberStringLength];
+  return std::string(buffer, DoubleToBuffer(value, buffer));
+}
+
+size_t Int64ToBuffer(int64_t value, char* buffer) {
+  if (value >= 0)
+    return Uint64ToBuffer(static_cast<uint64_t>(value), buffer);
+  buffer[0] = '-';
+  return 1 + Uint64ToBuffer(0 - static_cast<uint64_t>(value), buffer + 1);
+}
+
+size_t Uint64ToBuffer(uint64_t value, char* buffer) {
+  char digits[kMaxNumberStringLength];
+  char* const end = digits + sizeof(digits);
+  const char* const begin = WriteDigitsBackwards(value, end);
+  memcpy(buffer, begin, end - begin);
+  return end - begin;
+}
+
+size_t DoubleToBuffer(double value, char* buffer) {
+  char* out = buffer;
+  if (std::isnan(value)) {
+    memcpy(out, "nan", 3);
+    return 3;
   }
-  // Otherwise, it has an annoying tendency to leave trailing zeros.
-  size_t len = ret.size();
-  while (len >= 2 && ret[len - 1] == '0' && ret[len - 2] != '.') {
-    --len;
+  if (std::signbit(value)) {
+    *out++ = '-';
+    value = -value;
   }
-  ret.erase(len);
-  return ret;
+  if (std::isinf(value) || value == 0) {
+    memcpy(out, value == 0 ? "0.0" : "inf", 3);
+    return out + 3 - buffer;
+  }
+
+  uint64_t significand;
+  int exponent;
+  internal::ShortestDecimal(value, &significand, &exponent);
+  char digit_buffer[kMaxNumberStringLength];
+  char* const digits_end = digit_buffer + sizeof(digit_buffer);
+  const char* const digits = WriteDigitsBackwards(significand, digits_end);
+  const int length = static_cast<int>(digits_end - digits);
+  // The value is 0.<digits> * 10^point.
+  const int point = length + exponent;
+
+  if (point <= -6 || point > 21) {
+    // <digit>[.<digits>]e<sign><exponent>
+    *out++ = digits[0];
+    if (length > 1) {
+      *out++ = '.';
+      memcpy(out, digits + 1, length - 1);
+      out += length - 1;
+    }
+    *out++ = 'e';
+    *out++ = point > 0 ? '+' : '-';
+    const int shown_exponent = point > 0 ? point - 1 : 1 - point;
+    out += Uint64ToBuffer(shown_exponent, out);
+  } else if (point <= 0) {
+    // 0.<zeros><digits>
+    memcpy(out, "0.000000", 2 - point);
+    out += 2 - point;
+    memcpy(out, digits, length);
+    out += length;
+  } else if (point < length) {
+    // <digits>.<digits>
+    memcpy(out, digits, point);
+    out += point;
+    *out++ = '.';
+    memcpy(out, digits + point, length - point);
+    out += length - point;
+  } else {
+    // <digits><zeros>.0
+    memcpy(out, digits, length);
+    out += length;
+    memset(out, '0', point - length);
+    out += point - length;
+    memcpy(out, ".0", 2);
+    out += 2;
+  }
+  return out - buffer;
 }
 
 bool StringToInt(const StringPiece& input, int* output) {
@@ -420,23 +756,34 @@ bool StringToSizeT(const StringPiece16& input, size_t* output) {
   return String16ToIntImpl(input, output);
 }
 
-bool StringToDouble(const std::string& input, double* output) {
-  char* endptr = nullptr;
-  *output = strtod(input.c_str(), &endptr);
+bool StringToDouble(const StringPiece& input, double* output) {
+  const char* const begin = input.data();
+  const char* const end = begin + input.size();
+
+  // Like strtod(), parse the number after any leading whitespace, but fail
+  // for it below.
+  const char* number_begin = begin;
+  while (number_begin != end && IsStrtodSpace(*number_begin))
+    ++number_begin;
+  bool negative = false;
+  const char* digits_begin = number_begin;
+  if (digits_begin != end && (*digits_begin == '-' || *digits_begin == '+')) {
+    negative = *digits_begin == '-';
+    ++digits_begin;
+  }
 
-  // Cases to return false:
-  //  - If the input string is empty, there was nothing to parse.
-  //  - If endptr does not point to the end of the string, there are either
-  //    characters remaining in the string after a parsed number, or the string
-  //    does not begin with a parseable number.  endptr is compared to the
-  //    expected end given the string's stated length to correctly catch cases
-  //    where the string contains embedded NUL characters.
-  //  - If the first character is a space, there was leading whitespace
-  return !input.empty() &&
-         input.c_str() + input.length() == endptr &&
-         !isspace(input[0]) &&
-         *output != std::numeric_limits<double>::infinity() &&
-         *output != -std::numeric_limits<double>::infinity();
+  Decimal decimal;
+  const char* number_end = ParseDecimal(digits_begin, end, &decimal);
+  if (number_end == digits_begin) {
+    *output = 0;
+    return false;
+  }
+  const double value = DecimalToDouble(decimal);
+  *output = negative ? -value : value;
+
+  // Fail for leading whitespace, characters after the number, such as an
+  // embedded NUL, and overflows.
+  return number_begin == begin && number_end == end && !std::isinf(value);
 }
 
 // Note: if you need to add String16ToDouble, first ask yourself if it's
@@ -445,20 +792,32 @@ bool StringToDouble(const std::string& input, double* output) {
 
 // Note: if you need to add an iterator range version of StringToDouble, first
 // ask yourself if it's really necessary. If it is, probably the best
-// implementation here is to instantiate a string and use the string version.
+// implementation here is to use the StringPiece version.
 
 std::string HexEncode(const void* bytes, size_t size) {
-  static const char kHexChars[] = "0123456789ABCDEF";
-
   // Each input byte creates two output hex characters.
   std::string ret(size * 2, '\0');
+  if (size)
+    HexEncodeToBuffer(bytes, size, &ret[0]);
+  return ret;
+}
 
-  for (size_t i = 0; i < size; ++i) {
-    char b = reinterpret_cast<const char*>(bytes)[i];
-    ret[(i * 2)] = kHexChars[(b >> 4) & 0xf];
-    ret[(i * 2) + 1] = kHexChars[b & 0xf];
+size_t HexEncodeToBuffer(const void* bytes, size_t size, char* output) {
+  const uint8_t* input = reinterpret_cast<const uint8_t*>(bytes);
+  size_t i = 0;
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+  if (CPU::HasFeature(CPU::FEATURE_AVX2))
+    i = HexEncodeAVX2(input, size, output);
+  if (CPU::HasFeature(CPU::FEATURE_SSSE3))
+    i += HexEncodeSSSE3(input + i, size - i, output + i * 2);
+#endif
+
+  for (; i < size; ++i) {
+    uint8_t b = input[i];
+    output[(i * 2)] = kHexChars[b >> 4];
+    output[(i * 2) + 1] = kHexChars[b & 0xf];
   }
-  return ret;
+  return size * 2;
 }
 
 bool HexStringToInt(const StringPiece& input, int* output) {
@@ -46,11 +46,27 @@ BASE_EXPORT string16 Uint64ToString16(uint64_t value);
 BASE_EXPORT std::string SizeTToString(size_t value);
 BASE_EXPORT string16 SizeTToString16(size_t value);
 
-// Deprecated: prefer std::to_string(double) instead.
 // DoubleToString converts the double to a string format that ignores the
-// locale. If you want to use locale specific formatting, use ICU.
+// locale. If you want to use locale specific formatting, use ICU. The result
+// is the shortest decimal that StringToDouble() converts back to |value|. It
+// is written like 0.25, 1.0 or 1e-7, with a digit before the point, and with a
+// point or an exponent, so that it is also a JSON number with a fraction. It
+// uses an exponent below 1e-6 and from 1e21, and is "inf", "-inf" or "nan" if
+// |value| is not finite.
 BASE_EXPORT std::string DoubleToString(double value);
 
+// Number -> buffer conversions ------------------------------------------------
+
+// The maximum number of characters written by the functions below.
+const size_t kMaxNumberStringLength = 25;
+
+// These write the same characters as the functions above to |buffer|, which
+// must have room for kMaxNumberStringLength of them, and return their number.
+// They do not write a terminating NUL.
+BASE_EXPORT size_t Int64ToBuffer(int64_t value, char* buffer);
+BASE_EXPORT size_t Uint64ToBuffer(uint64_t value, char* buffer);
+BASE_EXPORT size_t DoubleToBuffer(double value, char* buffer);
+
 // String -> number conversions ------------------------------------------------
 
 // Perform a best-effort conversion of the input string to a numeric type,
@@ -84,16 +100,16 @@ BASE_EXPORT bool StringToUint64(const StringPiece16& input, uint64_t* output);
 BASE_EXPORT bool StringToSizeT(const StringPiece& input, size_t* output);
 BASE_EXPORT bool StringToSizeT(const StringPiece16& input, size_t* output);
 
-// Deprecated: prefer std::stod() instead.
 // For floating-point conversions, only conversions of input strings in decimal
 // form are defined to work.  Behavior with strings representing floating-point
 // numbers in hexadecimal, and strings representing non-finite values (such as
 // NaN and inf) is undefined.  Otherwise, these behave the same as the integral
 // variants.  This expects the input string to NOT be specific to the locale.
-// If your input is locale specific, use ICU to read the number.
+// If your input is locale specific, use ICU to read the number. The result is
+// correctly rounded, and does not depend on the C library's locale either.
 // WARNING: Will write to |output| even when returning false.
 //          Read the comments here and above StringToInt() carefully.
-BASE_EXPORT bool StringToDouble(const std::string& input, double* output);
+BASE_EXPORT bool StringToDouble(const StringPiece& input, double* output);
 
 // Hex encoding ----------------------------------------------------------------
 
@@ -105,6 +121,13 @@ BASE_EXPORT bool StringToDouble(const std::string& input, double* output);
 //   std::numeric_limits<size_t>::max() / 2
 BASE_EXPORT std::string HexEncode(const void* bytes, size_t size);
 
+// Writes the same upper case hex characters as HexEncode() to |output|, which
+// must have room for 2 * |size| of them and must not overlap |bytes|. Returns
+// the number of characters written. No null terminator is written.
+BASE_EXPORT size_t HexEncodeToBuffer(const void* bytes,
+                                     size_t size,
+                                     char* output);
+
 // Best effort conversion, see StringToInt above for restrictions.
 // Will only successful parse hex values that will fit into |output|, i.e.
 // -0x80000000 < |input| < 0x7FFFFFFF.
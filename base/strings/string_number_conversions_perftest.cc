@@ -0,0 +1,124 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/strings/string_number_conversions.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const int kNumValues = 1 << 16;
+const int kIterations = 16;
+
+// Random doubles of the kinds found in metrics: short decimals, and the
+// results of arithmetic, which need all 17 digits.
+std::vector<double> MakeDoubles() {
+  std::vector<double> values;
+  uint64_t random = 88172645463325252ull;
+  for (int i = 0; i < kNumValues; i++) {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    if (i % 2)
+      values.push_back(static_cast<double>(random % 1000000) / 100);
+    else
+      values.push_back(static_cast<double>(random >> 11) / (1 << 20));
+  }
+  return values;
+}
+
+// Runs |function| on each of |num_values| values a few times, and prints the
+// time per value.
+template <typename Function>
+void Measure(const char* trace, size_t num_values, Function function) {
+  TimeTicks start = TimeTicks::Now();
+  for (int iteration = 0; iteration < kIterations; iteration++) {
+    for (size_t i = 0; i < num_values; i++)
+      function(i);
+  }
+  TimeDelta elapsed = TimeTicks::Now() - start;
+  perf_test::PrintResult("conversion_time", "", trace,
+                         elapsed.InSecondsF() * 1e9 / kIterations / num_values,
+                         "ns", true);
+}
+
+}  // namespace
+
+TEST(StringNumberConversionsPerfTest, FormatDouble) {
+  const std::vector<double> values = MakeDoubles();
+  char buffer[32];
+  size_t sink = 0;
+  Measure("DoubleToBuffer", values.size(),
+          [&](size_t i) { sink += DoubleToBuffer(values[i], buffer); });
+  Measure("DoubleToString", values.size(),
+          [&](size_t i) { sink += DoubleToString(values[i]).size(); });
+  // The shortest snprintf() format that round-trips.
+  Measure("snprintf", values.size(), [&](size_t i) {
+    sink += snprintf(buffer, sizeof(buffer), "%.17g", values[i]);
+  });
+  EXPECT_NE(0u, sink);
+}
+
+TEST(StringNumberConversionsPerfTest, ParseDouble) {
+  const std::vector<double> values = MakeDoubles();
+  std::vector<std::string> strings;
+  for (double value : values)
+    strings.push_back(DoubleToString(value));
+  double sink = 0;
+  Measure("StringToDouble", strings.size(), [&](size_t i) {
+    double value;
+    StringToDouble(strings[i], &value);
+    sink += value;
+  });
+  Measure("strtod", strings.size(),
+          [&](size_t i) { sink += strtod(strings[i].c_str(), nullptr); });
+  EXPECT_NE(0, sink);
+}
+
+TEST(StringNumberConversionsPerfTest, FormatInt64) {
+  char buffer[32];
+  size_t sink = 0;
+  Measure("Int64ToBuffer", kNumValues, [&](size_t i) {
+    sink += Int64ToBuffer(static_cast<int64_t>(i) * 7919 * 7919, buffer);
+  });
+  Measure("Int64ToString", kNumValues, [&](size_t i) {
+    sink += Int64ToString(static_cast<int64_t>(i) * 7919 * 7919).size();
+  });
+  EXPECT_NE(0u, sink);
+}
+
+// Times JSON documents made of a list of doubles, per double.
+TEST(StringNumberConversionsPerfTest, JSONNumbers) {
+  ListValue list;
+  for (double value : MakeDoubles())
+    list.AppendDouble(value);
+  std::string json;
+  Measure("JSONWriter", kNumValues, [&](size_t i) {
+    if (i == 0)
+      JSONWriter::Write(list, &json);
+  });
+  Measure("JSONReader", kNumValues, [&](size_t i) {
+    if (i == 0) {
+      EXPECT_TRUE(JSONReader::Read(json));
+    }
+  });
+}
+
+}  // namespace base
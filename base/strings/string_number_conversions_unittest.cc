@@ -9,10 +9,13 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <cmath>
 #include <limits>
 
+#include "base/cpu.h"
 #include "base/format_macros.h"
 #include "base/macros.h"
 #include "base/strings/stringprintf.h"
@@ -769,6 +772,122 @@ TEST(StringNumberConversionsTest, StringToDouble) {
   EXPECT_DOUBLE_EQ(3.14, output);
 }
 
+namespace {
+
+uint64_t NextRandom(uint64_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+// Returns whether |a| and |b| are the same double, including their sign.
+bool SameDouble(double a, double b) {
+  return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Returns the significant digits of the decimal |str|, without leading or
+// trailing zeros.
+std::string SignificantDigits(const std::string& str) {
+  std::string digits;
+  for (char c : str.substr(0, str.find('e'))) {
+    if (c >= '0' && c <= '9' && (c != '0' || !digits.empty()))
+      digits.push_back(c);
+  }
+  return digits.substr(0, digits.find_last_not_of('0') + 1);
+}
+
+}  // namespace
+
+TEST(StringNumberConversionsTest, StringToDoubleEdgeCases) {
+  static const struct {
+    const char* input;
+    double output;
+    bool success;
+  } cases[] = {
+    // Half-way between 2^53 and the next double, and just above.
+    {"9007199254740993", 9007199254740992.0, true},
+    {"9007199254740993.0000000000000000000001", 9007199254740994.0, true},
+    {"900719925474099300000000000e-11", 9007199254740992.0, true},
+    // The largest double, and half-way to the next power of two.
+    {"1.7976931348623157e308", 1.7976931348623157e308, true},
+    {"1.7976931348623158e308", 1.7976931348623157e308, true},
+    {"1.7976931348623159e308", std::numeric_limits<double>::infinity(),
+                               false},
+    // The smallest normal and subnormal doubles, and half of the latter.
+    {"2.2250738585072014e-308", 2.2250738585072014e-308, true},
+    {"4.9406564584124654e-324", 4.9406564584124654e-324, true},
+    {"2.4703282292062327e-324", 0.0, true},
+    {"2.4703282292062328e-324", 4.9406564584124654e-324, true},
+    {"1e-400", 0.0, true},
+    {"-0", -0.0, true},
+    {"0e999999", 0.0, true},
+    {"0.000000000000000000000000000000000001", 1e-36, true},
+    {"123456789012345678901234567890", 1.2345678901234568e29, true},
+    {".5", 0.5, true},
+    {"-.5e1", -5.0, true},
+    {".", 0.0, false},
+    {"1.2.3", 1.2, false},
+    {"1e+", 1.0, false},
+    {"0x10", 0.0, false},
+  };
+
+  for (size_t i = 0; i < arraysize(cases); ++i) {
+    double output;
+    EXPECT_EQ(cases[i].success, StringToDouble(cases[i].input, &output))
+        << cases[i].input;
+    EXPECT_TRUE(SameDouble(cases[i].output, output))
+        << cases[i].input << " gave " << output;
+  }
+}
+
+TEST(StringNumberConversionsTest, StringToDoubleMatchesStrtod) {
+  uint64_t random = 88172645463325252ull;
+  for (int i = 0; i < 200000; i++) {
+    // Random digits around a decimal point, with a random exponent, and some
+    // long inputs that need more than 19 digits to round correctly.
+    std::string input;
+    if (NextRandom(&random) % 2)
+      input.push_back('-');
+    const uint64_t length_class = NextRandom(&random) % 16;
+    const size_t num_digits =
+        1 + NextRandom(&random) % (length_class == 0 ? 800 : 20);
+    const size_t point = NextRandom(&random) % (num_digits + 1);
+    for (size_t digit = 0; digit < num_digits; digit++) {
+      if (digit == point)
+        input.push_back('.');
+      // Runs of zeros and nines are the hard cases.
+      const uint64_t kind = NextRandom(&random) % 8;
+      input.push_back(kind == 0 ? '0' : kind == 1 ? '9'
+                                      : '0' + NextRandom(&random) % 10);
+    }
+    const int exponent = static_cast<int>(NextRandom(&random) % 700) - 350;
+    input += StringPrintf("e%d", exponent);
+
+    const double expected = strtod(input.c_str(), nullptr);
+    double output;
+    EXPECT_EQ(!std::isinf(expected), StringToDouble(input, &output)) << input;
+    EXPECT_TRUE(SameDouble(expected, output))
+        << input << " gave " << output << " instead of " << expected;
+  }
+
+  // The exact decimal expansions of random doubles, and the same rounded to
+  // fewer digits.
+  for (int i = 0; i < 100000; i++) {
+    double value;
+    const uint64_t bits = NextRandom(&random);
+    memcpy(&value, &bits, sizeof(value));
+    if (!std::isfinite(value))
+      continue;
+    const int precision = static_cast<int>(NextRandom(&random) % 30);
+    const std::string input = StringPrintf("%.*e", precision, value);
+    const double expected = strtod(input.c_str(), nullptr);
+    double output;
+    EXPECT_EQ(!std::isinf(expected), StringToDouble(input, &output)) << input;
+    EXPECT_TRUE(SameDouble(expected, output)) << input;
+  }
+}
+
 TEST(StringNumberConversionsTest, DoubleToString) {
   static const struct {
     double input;
@@ -799,12 +918,113 @@ TEST(StringNumberConversionsTest, DoubleToString) {
   EXPECT_EQ("1334890332160.0", DoubleToString(input));
 }
 
+TEST(StringNumberConversionsTest, DoubleToStringFormats) {
+  static const struct {
+    double input;
+    const char* expected;
+  } cases[] = {
+    {-0.0, "-0.0"},
+    {0.1, "0.1"},
+    {-0.8, "-0.8"},
+    {1.0 / 3, "0.3333333333333333"},
+    {123.456, "123.456"},
+    {1e-6, "0.000001"},
+    {1.5e-7, "1.5e-7"},
+    {1e20, "100000000000000000000.0"},
+    {1e21, "1e+21"},
+    {123456789012345680000.0, "123456789012345680000.0"},
+    {9007199254740993.0, "9007199254740992.0"},
+    {5e-324, "5e-324"},
+    {2.2250738585072014e-308, "2.2250738585072014e-308"},
+    {-1.7976931348623157e308, "-1.7976931348623157e+308"},
+    {std::numeric_limits<double>::infinity(), "inf"},
+    {-std::numeric_limits<double>::infinity(), "-inf"},
+    {std::numeric_limits<double>::quiet_NaN(), "nan"},
+  };
+
+  for (size_t i = 0; i < arraysize(cases); ++i)
+    EXPECT_EQ(cases[i].expected, DoubleToString(cases[i].input));
+}
+
+TEST(StringNumberConversionsTest, DoubleToStringIsShortest) {
+  uint64_t random = 88172645463325252ull;
+  for (int i = 0; i < 100000; i++) {
+    double value;
+    const uint64_t bits = NextRandom(&random);
+    memcpy(&value, &bits, sizeof(value));
+    if (!std::isfinite(value))
+      continue;
+
+    const std::string str = DoubleToString(value);
+    ASSERT_LE(str.size(), kMaxNumberStringLength);
+    double round_trip;
+    EXPECT_TRUE(StringToDouble(str, &round_trip)) << str;
+    EXPECT_TRUE(SameDouble(value, round_trip)) << str;
+
+    // The shortest correctly rounded decimal that converts back to |value|.
+    std::string shortest = StringPrintf("%.16e", value);
+    for (int precision = 15; precision >= 0; precision--) {
+      const std::string shorter = StringPrintf("%.*e", precision, value);
+      if (strtod(shorter.c_str(), nullptr) != value)
+        break;
+      shortest = shorter;
+    }
+    EXPECT_EQ(SignificantDigits(shortest), SignificantDigits(str))
+        << shortest << " " << str;
+  }
+}
+
+TEST(StringNumberConversionsTest, NumberToBuffer) {
+  char buffer[kMaxNumberStringLength];
+  EXPECT_EQ("-9223372036854775808",
+            std::string(buffer, Int64ToBuffer(
+                                    std::numeric_limits<int64_t>::min(),
+                                    buffer)));
+  EXPECT_EQ("18446744073709551615",
+            std::string(buffer, Uint64ToBuffer(
+                                    std::numeric_limits<uint64_t>::max(),
+                                    buffer)));
+  EXPECT_EQ("-0.000001234567890123457",
+            std::string(buffer, DoubleToBuffer(-1.234567890123457e-6,
+                                               buffer)));
+  EXPECT_EQ("-2.2250738585072014e-308",
+            std::string(buffer, DoubleToBuffer(-2.2250738585072014e-308,
+                                               buffer)));
+}
+
 TEST(StringNumberConversionsTest, HexEncode) {
   std::string hex(HexEncode(NULL, 0));
   EXPECT_EQ(hex.length(), 0U);
   unsigned char bytes[] = {0x01, 0xff, 0x02, 0xfe, 0x03, 0x80, 0x81};
   hex = HexEncode(bytes, sizeof(bytes));
   EXPECT_EQ(hex.compare("01FF02FE038081"), 0);
+
+  // Long enough to go through the vectorized code, at all alignments, with
+  // each of the encoders the machine supports.
+  const int kDisabledFeatures[] = {
+      0, CPU::FEATURE_AVX2, CPU::FEATURE_AVX2 | CPU::FEATURE_SSSE3};
+  std::string data;
+  for (int i = 0; i < 300; ++i)
+    data.push_back(static_cast<char>(i * 13));
+  for (size_t k = 0; k < arraysize(kDisabledFeatures); ++k) {
+    CPU::SetDisabledFeaturesForTesting(kDisabledFeatures[k]);
+    for (size_t offset = 0; offset < 4; ++offset) {
+      const std::string input = data.substr(offset);
+      std::string expected;
+      for (char c : input)
+        expected += StringPrintf("%02X", static_cast<uint8_t>(c));
+      EXPECT_EQ(expected, HexEncode(input.data(), input.size()))
+          << "disabled features " << kDisabledFeatures[k];
+
+      // Nothing is written past the characters.
+      std::string buffer(expected.size() + 1, '*');
+      EXPECT_EQ(expected.size(),
+                HexEncodeToBuffer(input.data(), input.size(), &buffer[0]));
+      EXPECT_EQ(expected + "*", buffer)
+          << "disabled features " << kDisabledFeatures[k];
+    }
+  }
+  CPU::SetDisabledFeaturesForTesting(0);
 }
 
 }  // namespace base
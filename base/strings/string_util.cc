@@ -20,6 +20,7 @@
 #include <limits>
 #include <vector>
 
+#include "base/cpu.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/memory/singleton.h"
@@ -29,6 +30,17 @@
 #include "base/third_party/icu/icu_utf.h"
 #include "build/build_config.h"
 
+// SSE2 is part of the x86-64 baseline, and Chrome requires it on x86 too. The
+// SSSE3 UTF-8 validator is compiled with a target attribute.
+#if defined(ARCH_CPU_X86_FAMILY) && defined(__SSE2__)
+#define STRING_UTIL_USE_SSE2
+#include <emmintrin.h>
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+#define STRING_UTIL_USE_SSSE3
+#include <tmmintrin.h>
+#endif
+#endif
+
 namespace base {
 
 namespace {
@@ -473,6 +485,25 @@ inline bool DoIsStringASCII(const Char* characters, size_t length) {
   MachineWord all_char_bits = 0;
   const Char* end = characters + length;
 
+#if defined(STRING_UTIL_USE_SSE2)
+  // OR together 16 bytes at a time, and fold the result into machine words,
+  // which are then checked as below.
+  const size_t kVectorChars = sizeof(__m128i) / sizeof(Char);
+  if (length >= kVectorChars) {
+    __m128i all_vector_bits = _mm_setzero_si128();
+    for (; end - characters >= static_cast<ptrdiff_t>(kVectorChars);
+         characters += kVectorChars) {
+      all_vector_bits = _mm_or_si128(
+          all_vector_bits,
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(characters)));
+    }
+    MachineWord words[sizeof(__m128i) / sizeof(MachineWord)];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(words), all_vector_bits);
+    for (MachineWord word : words)
+      all_char_bits |= word;
+  }
+#endif
+
   // Prologue: align the input.
   while (!IsAlignedToMachineWord(characters) && characters != end) {
     all_char_bits |= *characters;
@@ -516,11 +547,184 @@ bool IsStringASCII(const std::wstring& str) {
 }
 #endif
 
+namespace {
+
+#if defined(STRING_UTIL_USE_SSSE3)
+
+// The SSSE3 validator checks 16 bytes at a time, without branches, with the
+// lookup algorithm of simdjson (John Keiser and Daniel Lemire, "Validating
+// UTF-8 In Less Than One Instruction Per Byte").
+//
+// Most errors show in a pair of consecutive bytes. Each kind of error gets a
+// bit, and three lookups, by the high and low nibbles of the first byte and
+// the high nibble of the second one, give the kinds of error that the pair
+// may be. Their intersection is the kinds of error it is.
+const uint8_t kTooShort = 1 << 0;   // Lead byte, then lead byte or ASCII.
+const uint8_t kTooLong = 1 << 1;    // ASCII, then continuation byte.
+const uint8_t kOverlong3 = 1 << 2;  // E0, then 80-9F.
+const uint8_t kTooLarge = 1 << 3;   // F4, then 90-BF, or F5-FF, then 90-BF.
+const uint8_t kSurrogate = 1 << 4;  // ED, then A0-BF.
+const uint8_t kOverlong2 = 1 << 5;  // C0-C1, then continuation byte.
+const uint8_t kTooLarge1000 = 1 << 6;  // F5-FF, then 80-8F.
+const uint8_t kOverlong4 = 1 << 6;     // F0, then 80-8F.
+const uint8_t kTwoContinuations = 1 << 7;
+const uint8_t kCarry = kTooShort | kTooLong | kTwoContinuations;
+
+const uint8_t kFirstHighNibbleErrors[16] = {
+    // 0-7: ASCII.
+    kTooLong, kTooLong, kTooLong, kTooLong,
+    kTooLong, kTooLong, kTooLong, kTooLong,
+    // 8-B: continuation byte.
+    kTwoContinuations, kTwoContinuations, kTwoContinuations, kTwoContinuations,
+    // C: lead byte of 2, with overlong C0 and C1.
+    kTooShort | kOverlong2,
+    // D: lead byte of 2.
+    kTooShort,
+    // E: lead byte of 3.
+    kTooShort | kOverlong3 | kSurrogate,
+    // F: lead byte of 4, or invalid.
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+};
+
+const uint8_t kFirstLowNibbleErrors[16] = {
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,  // C0, E0, F0.
+    kCarry | kOverlong2,                            // C1.
+    kCarry,
+    kCarry,
+    kCarry | kTooLarge,                             // F4.
+    kCarry | kTooLarge | kTooLarge1000,             // F5-FF.
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,  // ED.
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+};
+
+const uint8_t kSecondHighNibbleErrors[16] = {
+    // 0-7: ASCII.
+    kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooShort, kTooShort, kTooShort, kTooShort,
+    // 8: 80-8F.
+    kTooLong | kOverlong2 | kTwoContinuations | kOverlong3 | kTooLarge1000 |
+        kOverlong4,
+    // 9: 90-9F.
+    kTooLong | kOverlong2 | kTwoContinuations | kOverlong3 | kTooLarge,
+    // A-B: A0-BF.
+    kTooLong | kOverlong2 | kTwoContinuations | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoContinuations | kSurrogate | kTooLarge,
+    // C-F: lead byte.
+    kTooShort, kTooShort, kTooShort, kTooShort,
+};
+
+// Bytes above these values at the end of a block start a character which
+// needs more bytes.
+const uint8_t kIncompleteMax[16] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1,
+};
+
+// Returns the errors of the 16 bytes of |input|, preceded by those of
+// |previous|.
+__attribute__((target("ssse3")))
+inline __m128i CheckUTF8Block(__m128i input, __m128i previous) {
+  const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+  const __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+  const __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+  const __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+
+  const __m128i first_high = _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(kFirstHighNibbleErrors)),
+      _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble_mask));
+  const __m128i first_low = _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(kFirstLowNibbleErrors)),
+      _mm_and_si128(prev1, nibble_mask));
+  const __m128i second_high = _mm_shuffle_epi8(
+      _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(kSecondHighNibbleErrors)),
+      _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask));
+  const __m128i pair_errors =
+      _mm_and_si128(_mm_and_si128(first_high, first_low), second_high);
+
+  // The third and fourth bytes of characters must be continuation bytes, and
+  // so kTwoContinuations is expected exactly for them.
+  const __m128i third_or_fourth = _mm_and_si128(
+      _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+                   _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80))),
+      _mm_set1_epi8(0x80));
+  __m128i errors = _mm_xor_si128(pair_errors, third_or_fourth);
+
+  // Unlike well-formedness, IsValidCharacter() also rejects noncharacters,
+  // which are U+FDD0-U+FDEF, encoded as EF B7 90-AF, and U+xFFFE-U+xFFFF,
+  // encoded as EF BF BE-BF or F0-F4 xF BF BE-BF. This only needs to flag them
+  // in well-formed input, whose last bytes are then unambiguous.
+  const __m128i is_ef = _mm_cmpeq_epi8(prev2, _mm_set1_epi8(0xef));
+  const __m128i fdd0 = _mm_and_si128(
+      _mm_and_si128(is_ef, _mm_cmpeq_epi8(prev1, _mm_set1_epi8(0xb7))),
+      _mm_cmpeq_epi8(
+          _mm_and_si128(_mm_add_epi8(input, _mm_set1_epi8(0x70)),
+                        _mm_set1_epi8(0xe0)),
+          _mm_setzero_si128()));
+  const __m128i plane_lead = _mm_and_si128(
+      _mm_cmpeq_epi8(_mm_max_epu8(prev3, _mm_set1_epi8(0xf0)), prev3),
+      _mm_cmpeq_epi8(_mm_and_si128(prev2, nibble_mask), nibble_mask));
+  const __m128i fffe = _mm_and_si128(
+      _mm_and_si128(_mm_or_si128(is_ef, plane_lead),
+                    _mm_cmpeq_epi8(prev1, _mm_set1_epi8(0xbf))),
+      _mm_cmpeq_epi8(_mm_max_epu8(input, _mm_set1_epi8(0xbe)), input));
+  return _mm_or_si128(errors, _mm_or_si128(fdd0, fffe));
+}
+
+__attribute__((target("ssse3")))
+bool IsStringUTF8SSSE3(const uint8_t* src, size_t src_len) {
+  const __m128i incomplete_max =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(kIncompleteMax));
+  __m128i previous = _mm_setzero_si128();
+  __m128i errors = _mm_setzero_si128();
+
+  size_t i = 0;
+  for (; i + 16 <= src_len; i += 16) {
+    const __m128i input =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    if (!_mm_movemask_epi8(input)) {
+      // ASCII only needs the previous block to be complete.
+      errors = _mm_or_si128(errors, _mm_subs_epu8(previous, incomplete_max));
+    } else {
+      errors = _mm_or_si128(errors, CheckUTF8Block(input, previous));
+    }
+    previous = input;
+  }
+
+  // The rest is padded with ASCII, which also catches a character cut by the
+  // end of the string.
+  uint8_t last[16] = {0};
+  memcpy(last, src + i, src_len - i);
+  const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+  errors = _mm_or_si128(errors, CheckUTF8Block(input, previous));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(errors, _mm_setzero_si128())) ==
+         0xffff;
+}
+
+#endif  // defined(STRING_UTIL_USE_SSSE3)
+
+}  // namespace
+
 bool IsStringUTF8(const StringPiece& str) {
   const char *src = str.data();
   int32_t src_len = static_cast<int32_t>(str.length());
   int32_t char_index = 0;
 
+#if defined(STRING_UTIL_USE_SSSE3)
+  if (CPU::HasFeature(CPU::FEATURE_SSSE3)) {
+    return IsStringUTF8SSSE3(reinterpret_cast<const uint8_t*>(src),
+                             str.length());
+  }
+#endif
+
   while (char_index < src_len) {
     int32_t code_point;
     CBU8_NEXT(src, char_index, src_len, code_point);
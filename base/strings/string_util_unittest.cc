@@ -13,7 +13,10 @@
 
 #include "base/macros.h"
 #include "base/strings/string16.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/utf_string_conversion_utils.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/third_party/icu/icu_utf.h"
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -388,6 +391,62 @@ TEST(StringUtilTest, IsStringUTF8) {
   EXPECT_FALSE(IsStringUTF8("embedded\xc0\x80U+0000"));
 }
 
+namespace {
+
+// The scalar validator, which the vectorized one must agree with.
+bool IsStringUTF8Reference(const std::string& str) {
+  const char* src = str.data();
+  int32_t src_len = static_cast<int32_t>(str.length());
+  int32_t char_index = 0;
+  while (char_index < src_len) {
+    int32_t code_point;
+    CBU8_NEXT(src, char_index, src_len, code_point);
+    if (!IsValidCharacter(code_point))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(StringUtilTest, IsStringUTF8MatchesReference) {
+  static const char* const kValidPieces[] = {
+      "a", "abcdefghijklmnopq", "\x7f", "\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80",
+      "\xed\x9f\xbf", "\xef\xbf\xbd", "\xef\xb7\x8f", "\xef\xb7\xb0",
+      "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbd",
+  };
+  // Noncharacters, surrogates, overlongs and truncated sequences.
+  static const char* const kInvalidPieces[] = {
+      "\xc1\xbf", "\xe0\x9f\xbf", "\xed\xa0\x80", "\xef\xbf\xbe",
+      "\xef\xbf\xbf", "\xef\xb7\x90", "\xef\xb7\xaf", "\xf0\x8f\xbf\xbf",
+      "\xf0\x9f\xbf\xbe", "\xf3\xbf\xbf\xbf", "\xf4\x90\x80\x80",
+      "\xf5\x80\x80\x80", "\x80", "\xbf", "\xc2", "\xe1\x80", "\xf1\x80\x80",
+      "\xfe", "\xff",
+  };
+  uint32_t random = 2463534242u;
+  auto next_random = [&random]() {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    return random;
+  };
+  for (int i = 0; i < 100000; i++) {
+    // Up to about 100 bytes, to cross several 16-byte blocks, with an invalid
+    // piece in about half of the strings.
+    std::string str;
+    const uint32_t num_pieces = next_random() % 24;
+    const uint32_t invalid_piece = next_random() % 48;
+    for (uint32_t piece = 0; piece < num_pieces; piece++) {
+      if (piece == invalid_piece)
+        str += kInvalidPieces[next_random() % arraysize(kInvalidPieces)];
+      else
+        str += kValidPieces[next_random() % arraysize(kValidPieces)];
+    }
+    EXPECT_EQ(IsStringUTF8Reference(str), IsStringUTF8(str))
+        << HexEncode(str.data(), str.size());
+  }
+}
+
 TEST(StringUtilTest, IsStringASCII) {
   static char char_ascii[] =
       "0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF";
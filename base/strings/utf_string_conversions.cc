@@ -6,11 +6,20 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+
 #include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversion_utils.h"
+#include "base/third_party/icu/icu_utf.h"
 #include "build/build_config.h"
 
+// SSE2 is part of the x86-64 baseline, and Chrome requires it on x86 too.
+#if defined(ARCH_CPU_X86_FAMILY) && defined(__SSE2__)
+#define UTF_CONVERSIONS_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace base {
 
 namespace {
@@ -41,6 +50,251 @@ bool ConvertUnicode(const SRC_CHAR* src,
   return success;
 }
 
+// UTF-8 <-> UTF-16 converters -------------------------------------------------
+
+// These write into an output string which is sized once, and only fall back
+// on the generic code above for invalid input.
+
+inline bool IsTrailByte(uint8_t c) {
+  return (c & 0xc0) == 0x80;
+}
+
+// Returns the length of |src| in UTF-16 if it is valid UTF-8: one for each
+// byte other than continuation bytes, plus one for each lead byte of 4.
+size_t UTF16Length(const uint8_t* src, size_t src_len) {
+  size_t length = 0;
+  size_t i = 0;
+#if defined(UTF_CONVERSIONS_USE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sums = zero;
+  for (; i + 16 <= src_len; i += 16) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    // Continuation bytes are -128 to -65 as signed bytes.
+    const __m128i starts = _mm_cmpgt_epi8(in, _mm_set1_epi8(-65));
+    const __m128i leads_of_4 =
+        _mm_cmpeq_epi8(_mm_max_epu8(in, _mm_set1_epi8(0xf0)), in);
+    const __m128i units = _mm_sub_epi8(zero, _mm_add_epi8(starts, leads_of_4));
+    sums = _mm_add_epi64(sums, _mm_sad_epu8(units, zero));
+  }
+  length = _mm_cvtsi128_si32(sums) +
+           _mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums));
+#endif
+  for (; i < src_len; ++i)
+    length += !IsTrailByte(src[i]) + (src[i] >= 0xf0);
+  return length;
+}
+
+// Returns an upper bound of the length of |src| in UTF-8: one for each ASCII
+// character, two up to U+07FF, and three otherwise, which is also enough for
+// surrogate pairs and the U+FFFD replacing invalid ones.
+size_t UTF8LengthBound(const char16* src, size_t src_len) {
+  size_t length = 3 * src_len;
+  size_t i = 0;
+#if defined(UTF_CONVERSIONS_USE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  __m128i savings = zero;
+  for (; i + 8 <= src_len; i += 8) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i up_to_7f =
+        _mm_cmpeq_epi16(_mm_subs_epu16(in, _mm_set1_epi16(0x7f)), zero);
+    const __m128i up_to_7ff =
+        _mm_cmpeq_epi16(_mm_subs_epu16(in, _mm_set1_epi16(0x7ff)), zero);
+    const __m128i saved =
+        _mm_sub_epi8(zero, _mm_packs_epi16(up_to_7f, up_to_7ff));
+    savings = _mm_add_epi64(savings, _mm_sad_epu8(saved, zero));
+  }
+  length -= _mm_cvtsi128_si32(savings) +
+            _mm_cvtsi128_si32(_mm_unpackhi_epi64(savings, savings));
+#endif
+  for (; i < src_len; ++i)
+    length -= (src[i] < 0x80) + (src[i] < 0x800);
+  return length;
+}
+
+// Copies the leading ASCII characters of |src| to |dest|, and returns their
+// number.
+size_t CopyASCIIPrefix(const uint8_t* src, size_t src_len, char16* dest) {
+  size_t i = 0;
+#if defined(UTF_CONVERSIONS_USE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= src_len; i += 16) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    if (_mm_movemask_epi8(in))
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_unpacklo_epi8(in, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 8),
+                     _mm_unpackhi_epi8(in, zero));
+  }
+#endif
+  for (; i < src_len && src[i] < 0x80; ++i)
+    dest[i] = src[i];
+  return i;
+}
+
+size_t CopyASCIIPrefix(const char16* src, size_t src_len, char* dest) {
+  size_t i = 0;
+#if defined(UTF_CONVERSIONS_USE_SSE2)
+  const __m128i non_ascii_mask = _mm_set1_epi16(static_cast<int16_t>(0xff80));
+  for (; i + 16 <= src_len; i += 16) {
+    const __m128i low =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i high =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+    const __m128i non_ascii =
+        _mm_and_si128(_mm_or_si128(low, high), non_ascii_mask);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(non_ascii, _mm_setzero_si128())) !=
+        0xffff) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_packus_epi16(low, high));
+  }
+#endif
+  for (; i < src_len && src[i] < 0x80; ++i)
+    dest[i] = static_cast<char>(src[i]);
+  return i;
+}
+
+bool ConvertUTF8ToUTF16(const char* src_chars,
+                        size_t src_len,
+                        string16* output) {
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(src_chars);
+  // The length is exact for valid input. Invalid input may need more, but no
+  // more than one unit per remaining byte.
+  output->resize(UTF16Length(src, src_len));
+  char16* const begin = &(*output)[0];
+  char16* dest = begin;
+  bool grown = false;
+  bool success = true;
+
+  size_t i = 0;
+  while (i < src_len) {
+    const size_t ascii_length = CopyASCIIPrefix(src + i, src_len - i, dest);
+    i += ascii_length;
+    dest += ascii_length;
+
+    while (i < src_len && src[i] >= 0x80) {
+      const uint8_t lead = src[i];
+      const size_t remaining = src_len - i;
+      if (lead >= 0xc2 && lead <= 0xdf && remaining >= 2 &&
+          IsTrailByte(src[i + 1])) {
+        *dest++ = static_cast<char16>(((lead & 0x1f) << 6) |
+                                      (src[i + 1] & 0x3f));
+        i += 2;
+        continue;
+      }
+      // E0 and F0 need higher second bytes to not be overlong, and ED and F4
+      // lower ones to not be surrogates or beyond U+10FFFF.
+      if ((lead & 0xf0) == 0xe0 && remaining >= 3) {
+        const uint8_t second = src[i + 1];
+        if (second >= (lead == 0xe0 ? 0xa0 : 0x80) &&
+            second <= (lead == 0xed ? 0x9f : 0xbf) &&
+            IsTrailByte(src[i + 2])) {
+          *dest++ = static_cast<char16>(((lead & 0x0f) << 12) |
+                                        ((second & 0x3f) << 6) |
+                                        (src[i + 2] & 0x3f));
+          i += 3;
+          continue;
+        }
+      }
+      if (lead >= 0xf0 && lead <= 0xf4 && remaining >= 4) {
+        const uint8_t second = src[i + 1];
+        if (second >= (lead == 0xf0 ? 0x90 : 0x80) &&
+            second <= (lead == 0xf4 ? 0x8f : 0xbf) &&
+            IsTrailByte(src[i + 2]) && IsTrailByte(src[i + 3])) {
+          const uint32_t code_point =
+              ((lead & 0x07) << 18) | ((second & 0x3f) << 12) |
+              ((src[i + 2] & 0x3f) << 6) | (src[i + 3] & 0x3f);
+          *dest++ = static_cast<char16>(CBU16_LEAD(code_point));
+          *dest++ = static_cast<char16>(CBU16_TRAIL(code_point));
+          i += 4;
+          continue;
+        }
+      }
+
+      // Invalid input.
+      if (!grown) {
+        const size_t offset = dest - begin;
+        output->resize(std::max(output->size(), offset + remaining));
+        dest = &(*output)[0] + offset;
+        grown = true;
+      }
+      // ReadUnicodeCharacter() looks at 6 bytes at most, so this only limits
+      // the index to int32_t.
+      int32_t char_index = 0;
+      uint32_t code_point;
+      if (ReadUnicodeCharacter(src_chars + i,
+                               static_cast<int32_t>(std::min<size_t>(
+                                   remaining, 8)),
+                               &char_index, &code_point)) {
+        if (code_point < 0x10000) {
+          *dest++ = static_cast<char16>(code_point);
+        } else {
+          *dest++ = static_cast<char16>(CBU16_LEAD(code_point));
+          *dest++ = static_cast<char16>(CBU16_TRAIL(code_point));
+        }
+      } else {
+        *dest++ = 0xFFFD;
+        success = false;
+      }
+      i += char_index + 1;
+    }
+  }
+
+  output->resize(dest - &(*output)[0]);
+  return success;
+}
+
+bool ConvertUTF16ToUTF8(const char16* src,
+                        size_t src_len,
+                        std::string* output) {
+  output->resize(UTF8LengthBound(src, src_len));
+  char* const begin = &(*output)[0];
+  char* dest = begin;
+  bool success = true;
+
+  size_t i = 0;
+  while (i < src_len) {
+    const size_t ascii_length = CopyASCIIPrefix(src + i, src_len - i, dest);
+    i += ascii_length;
+    dest += ascii_length;
+
+    for (; i < src_len && src[i] >= 0x80; ++i) {
+      uint32_t code_point = src[i];
+      if (CBU16_IS_SURROGATE(code_point)) {
+        if (CBU16_IS_SURROGATE_LEAD(code_point) && i + 1 < src_len &&
+            CBU16_IS_TRAIL(src[i + 1])) {
+          code_point = CBU16_GET_SUPPLEMENTARY(code_point, src[i + 1]);
+          ++i;
+        } else {
+          code_point = 0xFFFD;
+          success = false;
+        }
+      }
+
+      if (code_point < 0x800) {
+        *dest++ = static_cast<char>(0xc0 | (code_point >> 6));
+      } else {
+        if (code_point < 0x10000) {
+          *dest++ = static_cast<char>(0xe0 | (code_point >> 12));
+        } else {
+          *dest++ = static_cast<char>(0xf0 | (code_point >> 18));
+          *dest++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+        }
+        *dest++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+      }
+      *dest++ = static_cast<char>(0x80 | (code_point & 0x3f));
+    }
+  }
+
+  output->resize(dest - begin);
+  return success;
+}
+
 }  // namespace
 
 // UTF-8 <-> Wide --------------------------------------------------------------
@@ -144,80 +398,30 @@ std::wstring UTF16ToWide(const string16& utf16) {
 
 // UTF16 <-> UTF8 --------------------------------------------------------------
 
-#if defined(WCHAR_T_IS_UTF32)
-
 bool UTF8ToUTF16(const char* src, size_t src_len, string16* output) {
-  if (IsStringASCII(StringPiece(src, src_len))) {
-    output->assign(src, src + src_len);
-    return true;
-  } else {
-    PrepareForUTF16Or32Output(src, src_len, output);
-    return ConvertUnicode(src, src_len, output);
-  }
+  return ConvertUTF8ToUTF16(src, src_len, output);
 }
 
 string16 UTF8ToUTF16(StringPiece utf8) {
-  if (IsStringASCII(utf8)) {
-    return string16(utf8.begin(), utf8.end());
-  }
-
   string16 ret;
-  PrepareForUTF16Or32Output(utf8.data(), utf8.length(), &ret);
   // Ignore the success flag of this call, it will do the best it can for
   // invalid input, which is what we want here.
-  ConvertUnicode(utf8.data(), utf8.length(), &ret);
+  ConvertUTF8ToUTF16(utf8.data(), utf8.length(), &ret);
   return ret;
 }
 
 bool UTF16ToUTF8(const char16* src, size_t src_len, std::string* output) {
-  if (IsStringASCII(StringPiece16(src, src_len))) {
-    output->assign(src, src + src_len);
-    return true;
-  } else {
-    PrepareForUTF8Output(src, src_len, output);
-    return ConvertUnicode(src, src_len, output);
-  }
+  return ConvertUTF16ToUTF8(src, src_len, output);
 }
 
 std::string UTF16ToUTF8(StringPiece16 utf16) {
-  if (IsStringASCII(utf16)) {
-    return std::string(utf16.begin(), utf16.end());
-  }
-
   std::string ret;
   // Ignore the success flag of this call, it will do the best it can for
   // invalid input, which is what we want here.
-  UTF16ToUTF8(utf16.data(), utf16.length(), &ret);
+  ConvertUTF16ToUTF8(utf16.data(), utf16.length(), &ret);
   return ret;
 }
 
-#elif defined(WCHAR_T_IS_UTF16)
-// Easy case since we can use the "wide" versions we already wrote above.
-
-bool UTF8ToUTF16(const char* src, size_t src_len, string16* output) {
-  return UTF8ToWide(src, src_len, output);
-}
-
-string16 UTF8ToUTF16(StringPiece utf8) {
-  return UTF8ToWide(utf8);
-}
-
-bool UTF16ToUTF8(const char16* src, size_t src_len, std::string* output) {
-  return WideToUTF8(src, src_len, output);
-}
-
-std::string UTF16ToUTF8(StringPiece16 utf16) {
-  if (IsStringASCII(utf16))
-    return std::string(utf16.data(), utf16.data() + utf16.length());
-
-  std::string ret;
-  PrepareForUTF8Output(utf16.data(), utf16.length(), &ret);
-  ConvertUnicode(utf16.data(), utf16.length(), &ret);
-  return ret;
-}
-
-#endif
-
 string16 ASCIIToUTF16(StringPiece ascii) {
   DCHECK(IsStringASCII(ascii)) << ascii;
   return string16(ascii.begin(), ascii.end());
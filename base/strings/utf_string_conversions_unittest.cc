@@ -3,11 +3,13 @@
 // found in the LICENSE file.
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
+#include "base/strings/utf_string_conversion_utils.h"
 #include "base/strings/utf_string_conversions.h"
 #include "build/build_config.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -208,4 +210,102 @@ TEST(UTFStringConversionsTest, ConvertMultiString) {
   EXPECT_EQ(expected, converted);
 }
 
+namespace {
+
+// The generic conversion, which the UTF-8 <-> UTF-16 fast paths must agree
+// with, including for the replacement of invalid input.
+template <typename SRC_STRING, typename DEST_STRING>
+bool ConvertReference(const SRC_STRING& src, DEST_STRING* output) {
+  output->clear();
+  bool success = true;
+  int32_t src_len = static_cast<int32_t>(src.length());
+  for (int32_t i = 0; i < src_len; i++) {
+    uint32_t code_point;
+    if (ReadUnicodeCharacter(src.data(), src_len, &i, &code_point)) {
+      WriteUnicodeCharacter(code_point, output);
+    } else {
+      WriteUnicodeCharacter(0xFFFD, output);
+      success = false;
+    }
+  }
+  return success;
+}
+
+class RandomPieces {
+ public:
+  RandomPieces() : random_(2463534242u) {}
+
+  // Returns a string of up to 24 pieces, most of them from |valid|.
+  template <typename STRING, size_t N, size_t M>
+  STRING Generate(const STRING (&valid)[N], const STRING (&invalid)[M]) {
+    STRING str;
+    const uint32_t num_pieces = Next() % 24;
+    const uint32_t invalid_piece = Next() % 48;
+    for (uint32_t piece = 0; piece < num_pieces; piece++) {
+      if (piece == invalid_piece)
+        str += invalid[Next() % M];
+      else
+        str += valid[Next() % N];
+    }
+    return str;
+  }
+
+ private:
+  uint32_t Next() {
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return random_;
+  }
+
+  uint32_t random_;
+};
+
+}  // namespace
+
+TEST(UTFStringConversionsTest, UTF8ToUTF16MatchesReference) {
+  const std::string kValidPieces[] = {
+      "a", "abcdefghijklmnopq", "\x7f", "\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80",
+      "\xed\x9f\xbf", "\xee\x80\x80", "\xef\xbf\xbd", "\xf0\x90\x80\x80",
+      "\xf4\x8f\xbf\xbd", std::string(1, '\0'),
+  };
+  const std::string kInvalidPieces[] = {
+      "\xc1\xbf", "\xe0\x9f\xbf", "\xed\xa0\x80", "\xef\xbf\xbe",
+      "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80",
+      "\xf8\x88\x80\x80\x80", "\x80", "\xbf", "\xc2", "\xe1\x80",
+      "\xf1\x80\x80", "\xfe", "\xff",
+  };
+  RandomPieces pieces;
+  for (int i = 0; i < 100000; i++) {
+    const std::string utf8 = pieces.Generate(kValidPieces, kInvalidPieces);
+    string16 expected;
+    const bool expected_success = ConvertReference(utf8, &expected);
+    string16 utf16;
+    EXPECT_EQ(expected_success, UTF8ToUTF16(utf8.data(), utf8.size(), &utf16));
+    EXPECT_EQ(expected, utf16);
+  }
+}
+
+TEST(UTFStringConversionsTest, UTF16ToUTF8MatchesReference) {
+  const string16 kValidPieces[] = {
+      string16(1, 'a'), ASCIIToUTF16("abcdefghijklmnopq"), string16(1, 0x7f),
+      string16(1, 0x80), string16(1, 0x7ff), string16(1, 0x800),
+      string16(1, 0xd7ff), string16(1, 0xe000), string16(1, 0xfffd),
+      string16(1, 0xffff), string16(1, 0), {0xd800, 0xdc00}, {0xdbff, 0xdfff},
+  };
+  const string16 kInvalidPieces[] = {
+      string16(1, 0xd800), string16(1, 0xdbff), string16(1, 0xdc00),
+      string16(1, 0xdfff), {0xdc00, 0xd800},
+  };
+  RandomPieces pieces;
+  for (int i = 0; i < 100000; i++) {
+    const string16 utf16 = pieces.Generate(kValidPieces, kInvalidPieces);
+    std::string expected;
+    const bool expected_success = ConvertReference(utf16, &expected);
+    std::string utf8;
+    EXPECT_EQ(expected_success, UTF16ToUTF8(utf16.data(), utf16.size(), &utf8));
+    EXPECT_EQ(expected, utf8);
+  }
+}
+
 }  // namespace base
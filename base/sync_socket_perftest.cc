@@ -0,0 +1,158 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/sync_socket.h"
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/ring_sync_socket.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+// Sends back each message it receives, of |message_size| bytes, until the
+// socket fails.
+class EchoThread : public DelegateSimpleThread::Delegate {
+ public:
+  EchoThread(SyncSocket* socket, size_t message_size)
+      : socket_(socket),
+        message_size_(message_size),
+        thread_(this, "Echo") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    std::vector<char> message(message_size_);
+    while (socket_->Receive(message.data(), message.size()) ==
+               message.size() &&
+           socket_->Send(message.data(), message.size()) == message.size()) {
+    }
+  }
+
+  void Join() { thread_.Join(); }
+
+ private:
+  SyncSocket* socket_;
+  const size_t message_size_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(EchoThread);
+};
+
+// Receives |messages| messages of |message_size| bytes.
+class SinkThread : public DelegateSimpleThread::Delegate {
+ public:
+  SinkThread(SyncSocket* socket, size_t message_size, int messages)
+      : socket_(socket),
+        message_size_(message_size),
+        messages_(messages),
+        thread_(this, "Sink") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    std::vector<char> message(message_size_);
+    for (int i = 0; i < messages_; i++)
+      ASSERT_EQ(message.size(), socket_->Receive(message.data(),
+                                                 message.size()));
+  }
+
+  void Join() { thread_.Join(); }
+
+ private:
+  SyncSocket* socket_;
+  const size_t message_size_;
+  const int messages_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(SinkThread);
+};
+
+void MeasureRoundTrips(const std::string& trace,
+                       SyncSocket* socket,
+                       SyncSocket* peer,
+                       size_t message_size) {
+  const int kRoundTrips = 20000;
+  EchoThread echo(peer, message_size);
+  std::vector<char> message(message_size);
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kRoundTrips; i++) {
+    ASSERT_EQ(message.size(), socket->Send(message.data(), message.size()));
+    ASSERT_EQ(message.size(),
+              socket->Receive(message.data(), message.size()));
+  }
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  socket->Close();
+  echo.Join();
+
+  perf_test::PrintResult("round_trip_time",
+                         "_" + SizeTToString(message_size) + "B", trace,
+                         elapsed.InSecondsF() * 1e6 / kRoundTrips, "us", true);
+}
+
+void MeasureThroughput(const std::string& trace,
+                       SyncSocket* socket,
+                       SyncSocket* peer,
+                       size_t message_size) {
+  const int kMessages = 200000;
+  SinkThread sink(peer, message_size, kMessages);
+  std::vector<char> message(message_size);
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kMessages; i++)
+    ASSERT_EQ(message.size(), socket->Send(message.data(), message.size()));
+  sink.Join();
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+
+  perf_test::PrintResult("throughput",
+                         "_" + SizeTToString(message_size) + "B", trace,
+                         kMessages * (message_size / (1024.0 * 1024)) /
+                             elapsed.InSecondsF(),
+                         "MB/s", true);
+}
+
+const size_t kMessageSizes[] = {4, 256, 4096};
+
+}  // namespace
+
+TEST(SyncSocketPerfTest, RoundTrip) {
+  for (size_t message_size : kMessageSizes) {
+    SyncSocket socket_a;
+    SyncSocket socket_b;
+    ASSERT_TRUE(SyncSocket::CreatePair(&socket_a, &socket_b));
+    MeasureRoundTrips("SyncSocket", &socket_a, &socket_b, message_size);
+  }
+  for (size_t message_size : kMessageSizes) {
+    RingSyncSocket socket_a;
+    RingSyncSocket socket_b;
+    ASSERT_TRUE(RingSyncSocket::CreatePair(&socket_a, &socket_b));
+    MeasureRoundTrips("RingSyncSocket", &socket_a, &socket_b, message_size);
+  }
+}
+
+TEST(SyncSocketPerfTest, Throughput) {
+  for (size_t message_size : kMessageSizes) {
+    SyncSocket socket_a;
+    SyncSocket socket_b;
+    ASSERT_TRUE(SyncSocket::CreatePair(&socket_a, &socket_b));
+    MeasureThroughput("SyncSocket", &socket_a, &socket_b, message_size);
+  }
+  for (size_t message_size : kMessageSizes) {
+    RingSyncSocket socket_a;
+    RingSyncSocket socket_b;
+    ASSERT_TRUE(RingSyncSocket::CreatePair(&socket_a, &socket_b));
+    MeasureThroughput("RingSyncSocket", &socket_a, &socket_b, message_size);
+  }
+}
+
+}  // namespace base
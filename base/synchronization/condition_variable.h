@@ -71,7 +71,9 @@
 #include "base/synchronization/lock.h"
 #include "build/build_config.h"
 
-#if defined(OS_POSIX)
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include "base/atomicops.h"
+#elif defined(OS_POSIX)
 #include <pthread.h>
 #endif
 
@@ -101,6 +103,19 @@ class BASE_EXPORT ConditionVariable {
 
 #if defined(OS_WIN)
   ConditionVarImpl* impl_;
+#elif defined(OS_LINUX) || defined(OS_ANDROID)
+  // A futex, incremented by each Signal() and Broadcast(). Wait() sleeps
+  // until it changes.
+  subtle::Atomic32 sequence_;
+  // The number of threads in Wait(), so that Signal() and Broadcast() only
+  // make a system call when there are some.
+  subtle::Atomic32 waiters_;
+  // Broadcast() moves the waiters to wait on this lock, rather than wake them
+  // all up to contend for it.
+  internal::LockImpl* user_lock_impl_;
+#if DCHECK_IS_ON()
+  base::Lock* user_lock_;     // Needed to adjust shadow lock state on wait.
+#endif
 #elif defined(OS_POSIX)
   pthread_cond_t condition_;
   pthread_mutex_t* user_mutex_;
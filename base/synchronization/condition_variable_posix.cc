@@ -13,8 +13,91 @@
 #include "base/time/time.h"
 #include "build/build_config.h"
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <limits.h>
+
+#include "base/synchronization/futex_linux.h"
+#endif
+
 namespace base {
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+
+ConditionVariable::ConditionVariable(Lock* user_lock)
+    : sequence_(0),
+      waiters_(0),
+      user_lock_impl_(&user_lock->lock_)
+#if DCHECK_IS_ON()
+    , user_lock_(user_lock)
+#endif
+{
+}
+
+ConditionVariable::~ConditionVariable() {
+  DCHECK_EQ(0, subtle::NoBarrier_Load(&waiters_));
+}
+
+void ConditionVariable::Wait() {
+  base::ThreadRestrictions::AssertWaitAllowed();
+  subtle::Barrier_AtomicIncrement(&waiters_, 1);
+  // Any Signal() or Broadcast() made once the lock is released changes the
+  // sequence, so that the futex does not wait.
+  const subtle::Atomic32 sequence = subtle::NoBarrier_Load(&sequence_);
+#if DCHECK_IS_ON()
+  user_lock_->CheckHeldAndUnmark();
+#endif
+  user_lock_impl_->Unlock();
+  internal::FutexWait(&sequence_, sequence, NULL);
+  // Others may have been moved to wait on the lock by Broadcast(): take it as
+  // having waiters, so that releasing it wakes up the next one.
+  user_lock_impl_->LockWithWaiters();
+#if DCHECK_IS_ON()
+  user_lock_->CheckUnheldAndMark();
+#endif
+  subtle::NoBarrier_AtomicIncrement(&waiters_, -1);
+}
+
+void ConditionVariable::TimedWait(const TimeDelta& max_time) {
+  base::ThreadRestrictions::AssertWaitAllowed();
+  subtle::Barrier_AtomicIncrement(&waiters_, 1);
+  const subtle::Atomic32 sequence = subtle::NoBarrier_Load(&sequence_);
+#if DCHECK_IS_ON()
+  user_lock_->CheckHeldAndUnmark();
+#endif
+  user_lock_impl_->Unlock();
+  if (max_time > TimeDelta()) {
+    const struct timespec relative_time = max_time.ToTimeSpec();
+    internal::FutexWait(&sequence_, sequence, &relative_time);
+  }
+  user_lock_impl_->LockWithWaiters();
+#if DCHECK_IS_ON()
+  user_lock_->CheckUnheldAndMark();
+#endif
+  subtle::NoBarrier_AtomicIncrement(&waiters_, -1);
+}
+
+void ConditionVariable::Broadcast() {
+  const subtle::Atomic32 sequence =
+      subtle::Barrier_AtomicIncrement(&sequence_, 1);
+  if (subtle::NoBarrier_Load(&waiters_) == 0)
+    return;
+  // Wake up a single waiter, and move the others to wait on the lock, which
+  // the woken up one takes as having waiters. Should the sequence have changed
+  // again in between, wake them all up instead.
+  if (internal::FutexRequeue(&sequence_, 1, user_lock_impl_->native_handle(),
+                   sequence) < 0) {
+    internal::FutexWake(&sequence_, INT_MAX);
+  }
+}
+
+void ConditionVariable::Signal() {
+  subtle::Barrier_AtomicIncrement(&sequence_, 1);
+  if (subtle::NoBarrier_Load(&waiters_) != 0)
+    internal::FutexWake(&sequence_, 1);
+}
+
+#else  // defined(OS_LINUX) || defined(OS_ANDROID)
+
 ConditionVariable::ConditionVariable(Lock* user_lock)
     : user_mutex_(user_lock->lock_.native_handle())
 #if DCHECK_IS_ON()
@@ -134,4 +217,6 @@ void ConditionVariable::Signal() {
   DCHECK_EQ(0, rv);
 }
 
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
 }  // namespace base
@@ -11,6 +11,7 @@
 #include "base/bind.h"
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/macros.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/single_thread_task_runner.h"
 #include "base/synchronization/condition_variable.h"
@@ -487,6 +488,84 @@ TEST_F(ConditionVariableTest, LargeFastTaskTest) {
                                    queue.ThreadSafeCheckShutdown(kThreadCount));
 }
 
+// Waits for each of a series of broadcasts, of which it counts how many it
+// saw, in turn with the other waiters.
+class BroadcastWaiter : public PlatformThread::Delegate {
+ public:
+  BroadcastWaiter(Lock* lock,
+                  ConditionVariable* broadcast_cv,
+                  ConditionVariable* woken_cv,
+                  const int* generation,
+                  int* woken_count)
+      : lock_(lock),
+        broadcast_cv_(broadcast_cv),
+        woken_cv_(woken_cv),
+        generation_(generation),
+        woken_count_(woken_count) {}
+
+  static const int kGenerations = 50;
+
+  void ThreadMain() override {
+    AutoLock auto_lock(*lock_);
+    for (int seen = 0; seen < kGenerations; ++seen) {
+      while (*generation_ == seen)
+        broadcast_cv_->Wait();
+      ++*woken_count_;
+      woken_cv_->Signal();
+    }
+  }
+
+ private:
+  Lock* lock_;
+  ConditionVariable* broadcast_cv_;
+  ConditionVariable* woken_cv_;
+  const int* generation_;
+  int* woken_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(BroadcastWaiter);
+};
+
+// Broadcast() moves the waiters to the lock rather than wake them all up: they
+// must all still get out of Wait(), one at a time, holding the lock.
+TEST_F(ConditionVariableTest, BroadcastWakesAllWaiters) {
+  const int kThreadCount = 16;
+  Lock lock;
+  ConditionVariable broadcast_cv(&lock);
+  ConditionVariable woken_cv(&lock);
+  int generation = 0;
+  int woken_count = 0;
+
+  BroadcastWaiter waiter(&lock, &broadcast_cv, &woken_cv, &generation,
+                         &woken_count);
+  PlatformThreadHandle handles[kThreadCount];
+  for (int i = 0; i < kThreadCount; ++i)
+    ASSERT_TRUE(PlatformThread::Create(0, &waiter, &handles[i]));
+
+  for (int i = 1; i <= BroadcastWaiter::kGenerations; ++i) {
+    AutoLock auto_lock(lock);
+    ++generation;
+    broadcast_cv.Broadcast();
+    while (woken_count < i * kThreadCount)
+      woken_cv.Wait();
+    EXPECT_EQ(i * kThreadCount, woken_count);
+  }
+
+  for (int i = 0; i < kThreadCount; ++i)
+    PlatformThread::Join(handles[i]);
+}
+
+TEST_F(ConditionVariableTest, TimedWaitWithoutTimeout) {
+  Lock lock;
+  ConditionVariable cv(&lock);
+  AutoLock auto_lock(lock);
+
+  // Both return at once, with the lock held.
+  cv.TimedWait(kZeroMs);
+  lock.AssertAcquired();
+  cv.TimedWait(-kTenMs);
+  lock.AssertAcquired();
+}
+
 //------------------------------------------------------------------------------
 // Finally we provide the implementation for the methods in the WorkQueue class.
 //------------------------------------------------------------------------------
@@ -0,0 +1,78 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Thin wrappers around the futex(2) system call, on which Lock,
+// ConditionVariable and WaitableEvent are built on Linux. All the futexes are
+// private to the process.
+
+#ifndef BASE_SYNCHRONIZATION_FUTEX_LINUX_H_
+#define BASE_SYNCHRONIZATION_FUTEX_LINUX_H_
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "base/atomicops.h"
+#include "build/build_config.h"
+
+namespace base {
+namespace internal {
+
+// Sleeps until |*futex| is woken up, unless it is not |value|. Waits no longer
+// than |relative_timeout| if it is not null. Returns 0 when woken up, -1 with
+// errno set to EAGAIN if |*futex| was not |value|, to ETIMEDOUT on timeout, or
+// to EINTR on a signal or a spurious wake-up. Callers recheck their condition
+// in all cases.
+inline int FutexWait(volatile subtle::Atomic32* futex,
+                     subtle::Atomic32 value,
+                     const struct timespec* relative_timeout) {
+  return syscall(SYS_futex, futex, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, value,
+                 relative_timeout, NULL, 0);
+}
+
+// Same as FutexWait(), until |absolute_timeout| of CLOCK_MONOTONIC.
+inline int FutexWaitUntil(volatile subtle::Atomic32* futex,
+                          subtle::Atomic32 value,
+                          const struct timespec* absolute_timeout) {
+  return syscall(SYS_futex, futex, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG,
+                 value, absolute_timeout, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+// Wakes up to |count| threads waiting on |futex|. The futex need not be
+// mapped anymore, so that an object may be destroyed by a thread it wakes up
+// while this is in progress. Returns the number of threads woken up.
+inline int FutexWake(volatile subtle::Atomic32* futex, int count) {
+  return syscall(SYS_futex, futex, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count,
+                 NULL, NULL, 0);
+}
+
+// Wakes up to |wake_count| threads waiting on |futex|, and moves the others to
+// wait on |target| instead, unless |*futex| is not |value|. Returns -1 with
+// errno set to EAGAIN in that case.
+inline int FutexRequeue(volatile subtle::Atomic32* futex,
+                        int wake_count,
+                        volatile subtle::Atomic32* target,
+                        subtle::Atomic32 value) {
+  return syscall(SYS_futex, futex, FUTEX_CMP_REQUEUE | FUTEX_PRIVATE_FLAG,
+                 wake_count, static_cast<intptr_t>(INT_MAX), target, value);
+}
+
+// Tells the processor that this is a spin-wait loop, which saves power and
+// lets the other hyperthread of the core run.
+inline void SpinPause() {
+#if defined(ARCH_CPU_X86_FAMILY)
+  __asm__ __volatile__("pause");
+#elif defined(ARCH_CPU_ARM_FAMILY)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_FUTEX_LINUX_H_
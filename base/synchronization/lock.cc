@@ -28,6 +28,13 @@ void Lock::CheckHeldAndUnmark() {
   owning_thread_ref_ = PlatformThreadRef();
 }
 
+void Lock::CheckNotHeldByCurrentThread() const {
+  // Only the current thread can set |owning_thread_ref_| to itself, so this
+  // is reliable without holding the lock.
+  DCHECK(!(owning_thread_ref_ == PlatformThread::CurrentRef()))
+      << "Lock acquired recursively";
+}
+
 void Lock::CheckUnheldAndMark() {
   DCHECK(owning_thread_ref_.is_null());
   owning_thread_ref_ = PlatformThread::CurrentRef();
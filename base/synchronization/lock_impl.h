@@ -11,6 +11,8 @@
 
 #if defined(OS_WIN)
 #include <windows.h>
+#elif defined(OS_LINUX) || defined(OS_ANDROID)
+#include "base/atomicops.h"
 #elif defined(OS_POSIX)
 #include <pthread.h>
 #endif
@@ -25,6 +27,10 @@ class BASE_EXPORT LockImpl {
  public:
 #if defined(OS_WIN)
   typedef CRITICAL_SECTION NativeHandle;
+#elif defined(OS_LINUX) || defined(OS_ANDROID)
+  // A futex: 0 if the lock is free, 1 if it is held, and 2 if it is held and
+  // there may be threads waiting for it.
+  typedef subtle::Atomic32 NativeHandle;
 #elif defined(OS_POSIX)
   typedef pthread_mutex_t NativeHandle;
 #endif
@@ -43,6 +49,13 @@ class BASE_EXPORT LockImpl {
   // a successful call to Try, or a call to Lock.
   void Unlock();
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  // Same as Lock(), but marks the lock as having waiters, so that Unlock()
+  // wakes one up. For the waiters of a ConditionVariable, which it moves to
+  // wait for the lock.
+  void LockWithWaiters();
+#endif
+
   // Return the native underlying lock.
   // TODO(awalker): refactor lock and condition variables so that this is
   // unnecessary.
@@ -51,6 +64,13 @@ class BASE_EXPORT LockImpl {
  private:
   NativeHandle native_handle_;
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  // The average number of times the lock was checked before it was taken, by
+  // the threads which found it held. They check it up to about twice as many
+  // times before they go to sleep.
+  subtle::Atomic32 average_spins_;
+#endif
+
   DISALLOW_COPY_AND_ASSIGN(LockImpl);
 };
 
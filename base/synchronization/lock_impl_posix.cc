@@ -7,11 +7,113 @@
 #include <errno.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "base/logging.h"
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <unistd.h>
+
+#include "base/synchronization/futex_linux.h"
+#endif
+
 namespace base {
 namespace internal {
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+
+namespace {
+
+// The most times a thread checks a held lock before it goes to sleep.
+const int kMaxSpins = 100;
+
+// kMaxSpins, or 0 if there is a single processor, on which the holder of a
+// lock cannot release it while another thread spins. -1 until computed.
+subtle::Atomic32 g_max_spins = -1;
+
+int GetMaxSpins() {
+  subtle::Atomic32 max_spins = subtle::NoBarrier_Load(&g_max_spins);
+  if (max_spins < 0) {
+    max_spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? kMaxSpins : 0;
+    subtle::NoBarrier_Store(&g_max_spins, max_spins);
+  }
+  return max_spins;
+}
+
+}  // namespace
+
+LockImpl::LockImpl() : native_handle_(0), average_spins_(0) {}
+
+LockImpl::~LockImpl() {
+  DCHECK_EQ(0, subtle::NoBarrier_Load(&native_handle_));
+}
+
+bool LockImpl::Try() {
+  return subtle::Acquire_CompareAndSwap(&native_handle_, 0, 1) == 0;
+}
+
+void LockImpl::Lock() {
+  subtle::Atomic32 state =
+      subtle::Acquire_CompareAndSwap(&native_handle_, 0, 1);
+  if (state == 0)
+    return;
+
+  // Spin for a while first: a lock is usually held briefly, so it may well be
+  // released before going to sleep and being woken up would be done with.
+  // Locks which were released soon enough in the past are spun on longer.
+  const int average_spins = subtle::NoBarrier_Load(&average_spins_);
+  const int max_spins = std::min(GetMaxSpins(), average_spins * 2 + 10);
+  for (int spins = 1; spins <= max_spins; ++spins) {
+    SpinPause();
+    state = subtle::NoBarrier_Load(&native_handle_);
+    if (state == 0) {
+      state = subtle::Acquire_CompareAndSwap(&native_handle_, 0, 1);
+      if (state == 0) {
+        subtle::NoBarrier_Store(&average_spins_,
+                                average_spins + (spins - average_spins) / 8);
+        return;
+      }
+    }
+  }
+  if (max_spins) {
+    subtle::NoBarrier_Store(&average_spins_,
+                            average_spins + (max_spins - average_spins) / 8);
+  }
+
+  // Go to sleep, after marking the lock as having waiters. Once woken up,
+  // take the lock as if it still has waiters, since others may be asleep.
+  do {
+    if (state == 2 ||
+        subtle::NoBarrier_CompareAndSwap(&native_handle_, 1, 2) != 0) {
+      FutexWait(&native_handle_, 2, NULL);
+    }
+    state = subtle::Acquire_CompareAndSwap(&native_handle_, 0, 2);
+  } while (state != 0);
+}
+
+void LockImpl::LockWithWaiters() {
+  subtle::Atomic32 state;
+  while ((state = subtle::Acquire_CompareAndSwap(&native_handle_, 0, 2)) !=
+         0) {
+    if (state == 2 ||
+        subtle::NoBarrier_CompareAndSwap(&native_handle_, 1, 2) != 0) {
+      FutexWait(&native_handle_, 2, NULL);
+    }
+  }
+}
+
+void LockImpl::Unlock() {
+  const subtle::Atomic32 state =
+      subtle::Release_CompareAndSwap(&native_handle_, 1, 0);
+  DCHECK_NE(0, state) << "Unlocking a lock which is not held";
+  if (state == 2) {
+    subtle::Release_Store(&native_handle_, 0);
+    FutexWake(&native_handle_, 1);
+  }
+}
+
+#else  // defined(OS_LINUX) || defined(OS_ANDROID)
+
 LockImpl::LockImpl() {
 #ifndef NDEBUG
   // In debug, setup attributes for lock error checking.
@@ -51,5 +153,7 @@ void LockImpl::Unlock() {
   DCHECK_EQ(rv, 0) << ". " << strerror(rv);
 }
 
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
 }  // namespace internal
 }  // namespace base
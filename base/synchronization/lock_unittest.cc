@@ -212,4 +212,59 @@ TEST(LockTest, MutexFourThreads) {
   EXPECT_EQ(4 * 40, value);
 }
 
+// Tests that heavily contended locks exclude, with spinning and sleeping ------
+
+class ContendedLockTestThread : public PlatformThread::Delegate {
+ public:
+  ContendedLockTestThread(Lock* lock, int* value)
+      : lock_(lock), value_(value) {}
+
+  static const int kIterations = 20000;
+
+  void ThreadMain() override {
+    for (int i = 0; i < kIterations; i++) {
+      AutoLock auto_lock(*lock_);
+      // A non-atomic increment in two steps, which would lose updates without
+      // mutual exclusion.
+      int v = *value_;
+      if (i % 1000 == 0)
+        PlatformThread::YieldCurrentThread();
+      *value_ = v + 1;
+    }
+  }
+
+ private:
+  Lock* lock_;
+  int* value_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContendedLockTestThread);
+};
+
+TEST(LockTest, Contended) {
+  const int kNumThreads = 8;
+  Lock lock;
+  int value = 0;
+
+  ContendedLockTestThread thread(&lock, &value);
+  PlatformThreadHandle handles[kNumThreads];
+  for (int i = 0; i < kNumThreads; i++)
+    ASSERT_TRUE(PlatformThread::Create(0, &thread, &handles[i]));
+  for (int i = 0; i < kNumThreads; i++)
+    PlatformThread::Join(handles[i]);
+
+  EXPECT_EQ(kNumThreads * ContendedLockTestThread::kIterations, value);
+  EXPECT_TRUE(lock.Try());
+  lock.Release();
+}
+
+#if DCHECK_IS_ON() && GTEST_HAS_DEATH_TEST
+// Acquiring a lock recursively fails, rather than hangs.
+TEST(LockDeathTest, RecursiveAcquire) {
+  Lock lock;
+  lock.Acquire();
+  ASSERT_DEATH(lock.Acquire(), "");
+  lock.Release();
+}
+#endif  // DCHECK_IS_ON() && GTEST_HAS_DEATH_TEST
+
 }  // namespace base
@@ -0,0 +1,99 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/read_write_lock.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "base/threading/platform_thread.h"
+#include "build/build_config.h"
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <sched.h>
+#endif
+
+namespace base {
+
+ReadWriteLock::ReadWriteLock()
+    : slots_(static_cast<ReaderSlot*>(
+          AlignedAlloc(sizeof(ReaderSlot) * kNumReaderSlots, kCacheLineSize))),
+      writer_(0),
+      readers_done_(&wait_lock_),
+      writer_done_(&wait_lock_) {
+  memset(slots_.get(), 0, sizeof(ReaderSlot) * kNumReaderSlots);
+}
+
+ReadWriteLock::~ReadWriteLock() {
+  DCHECK_EQ(0, CountReaders());
+  DCHECK_EQ(0, subtle::NoBarrier_Load(&writer_));
+}
+
+void ReadWriteLock::ReadAcquire() {
+  for (;;) {
+    subtle::Atomic32* readers = CurrentReaders();
+    // Either the writer sees this reader, or this reader sees the writer.
+    subtle::Barrier_AtomicIncrement(readers, 1);
+    if (!subtle::Acquire_Load(&writer_))
+      return;
+
+    // Let the writer go first.
+    RemoveReader(readers);
+    AutoLock auto_lock(wait_lock_);
+    while (subtle::NoBarrier_Load(&writer_))
+      writer_done_.Wait();
+  }
+}
+
+void ReadWriteLock::ReadRelease() {
+  RemoveReader(CurrentReaders());
+}
+
+void ReadWriteLock::WriteAcquire() {
+  writer_lock_.Acquire();
+  subtle::NoBarrier_Store(&writer_, 1);
+  subtle::MemoryBarrier();
+
+  AutoLock auto_lock(wait_lock_);
+  while (CountReaders() != 0)
+    readers_done_.Wait();
+}
+
+void ReadWriteLock::WriteRelease() {
+  {
+    AutoLock auto_lock(wait_lock_);
+    subtle::Release_Store(&writer_, 0);
+    writer_done_.Broadcast();
+  }
+  writer_lock_.Release();
+}
+
+subtle::Atomic32* ReadWriteLock::CurrentReaders() {
+  unsigned int slot;
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  // A system call free read of the processor number on most architectures.
+  const int cpu = sched_getcpu();
+  slot = cpu >= 0 ? cpu : PlatformThread::CurrentId();
+#else
+  slot = PlatformThread::CurrentId();
+#endif
+  return &slots_.get()[slot % kNumReaderSlots].readers;
+}
+
+void ReadWriteLock::RemoveReader(subtle::Atomic32* readers) {
+  subtle::Barrier_AtomicIncrement(readers, -1);
+  if (subtle::NoBarrier_Load(&writer_)) {
+    AutoLock auto_lock(wait_lock_);
+    readers_done_.Signal();
+  }
+}
+
+int ReadWriteLock::CountReaders() const {
+  int count = 0;
+  for (int i = 0; i < kNumReaderSlots; ++i)
+    count += subtle::Acquire_Load(&slots_.get()[i].readers);
+  return count;
+}
+
+}  // namespace base
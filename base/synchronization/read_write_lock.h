@@ -0,0 +1,117 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+#define BASE_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/macros.h"
+#include "base/memory/aligned_memory.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+
+namespace base {
+
+// A lock which either any number of readers or a single writer may hold, for
+// data which is read far more often than it is written.
+//
+// Readers do not contend with each other: each counts itself on a counter of
+// the processor it runs on, in a cache line of its own, rather than on a
+// counter shared by all the processors. This makes writers expensive: they
+// wait for the counters of all the processors to drop to zero. Writers take
+// precedence over new readers, which wait for them to be done.
+//
+// The lock is not recursive: a thread which holds it must not acquire it
+// again, not even as a reader, since a waiting writer blocks new readers.
+class LOCKABLE BASE_EXPORT ReadWriteLock {
+ public:
+  ReadWriteLock();
+  ~ReadWriteLock();
+
+  // Acquires the lock as one of its readers, waiting while a writer holds it
+  // or waits for it.
+  void ReadAcquire() SHARED_LOCK_FUNCTION();
+  void ReadRelease() UNLOCK_FUNCTION();
+
+  // Acquires the lock as its only writer, waiting for the readers and the
+  // other writers to release it.
+  void WriteAcquire() EXCLUSIVE_LOCK_FUNCTION();
+  void WriteRelease() UNLOCK_FUNCTION();
+
+ private:
+  // The number of reader counters. Processors beyond that share counters.
+  static const int kNumReaderSlots = 16;
+  static const size_t kCacheLineSize = 64;
+
+  struct ReaderSlot {
+    // The number of readers which acquired the lock on this processor, less
+    // the number of those which released it on this processor. Only the sum
+    // over all the slots is meaningful, since a reader may move to another
+    // processor while it holds the lock.
+    subtle::Atomic32 readers;
+    char padding[kCacheLineSize - sizeof(subtle::Atomic32)];
+  };
+
+  // Returns the counter of the processor this thread runs on.
+  subtle::Atomic32* CurrentReaders();
+
+  // Stops counting a reader on |readers|, and wakes up the writer if it
+  // waits for the readers.
+  void RemoveReader(subtle::Atomic32* readers);
+
+  // Returns the number of readers which hold the lock, or which are about to
+  // wait for the writer.
+  int CountReaders() const;
+
+  scoped_ptr<ReaderSlot, AlignedFreeDeleter> slots_;
+
+  // 1 while a writer holds the lock or waits for the readers.
+  subtle::Atomic32 writer_;
+
+  // Held by the writer, to keep the other writers out.
+  Lock writer_lock_;
+
+  // Protects the waits: of the writer for the readers, and of the readers
+  // for the writer.
+  Lock wait_lock_;
+  ConditionVariable readers_done_;
+  ConditionVariable writer_done_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadWriteLock);
+};
+
+// Holds a ReadWriteLock as a reader while it is in scope.
+class SCOPED_LOCKABLE AutoReadLock {
+ public:
+  explicit AutoReadLock(ReadWriteLock& lock) SHARED_LOCK_FUNCTION(lock)
+      : lock_(lock) {
+    lock_.ReadAcquire();
+  }
+  ~AutoReadLock() UNLOCK_FUNCTION() { lock_.ReadRelease(); }
+
+ private:
+  ReadWriteLock& lock_;
+  DISALLOW_COPY_AND_ASSIGN(AutoReadLock);
+};
+
+// Holds a ReadWriteLock as its writer while it is in scope.
+class SCOPED_LOCKABLE AutoWriteLock {
+ public:
+  explicit AutoWriteLock(ReadWriteLock& lock) EXCLUSIVE_LOCK_FUNCTION(lock)
+      : lock_(lock) {
+    lock_.WriteAcquire();
+  }
+  ~AutoWriteLock() UNLOCK_FUNCTION() { lock_.WriteRelease(); }
+
+ private:
+  ReadWriteLock& lock_;
+  DISALLOW_COPY_AND_ASSIGN(AutoWriteLock);
+};
+
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_READ_WRITE_LOCK_H_
@@ -0,0 +1,197 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/read_write_lock.h"
+
+#include "base/atomicops.h"
+#include "base/macros.h"
+#include "base/memory/scoped_vector.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Holds the lock as a reader on its own thread, until told to release it.
+class ReaderThread : public DelegateSimpleThread::Delegate {
+ public:
+  explicit ReaderThread(ReadWriteLock* lock)
+      : lock_(lock),
+        acquired_(false, false),
+        release_(false, false),
+        thread_(this, "Reader") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    AutoReadLock auto_lock(*lock_);
+    acquired_.Signal();
+    release_.Wait();
+  }
+
+  void WaitUntilAcquired() { acquired_.Wait(); }
+  bool AcquiredWithin(TimeDelta max_time) {
+    return acquired_.TimedWait(max_time);
+  }
+
+  void ReleaseAndJoin() {
+    release_.Signal();
+    thread_.Join();
+  }
+
+ private:
+  ReadWriteLock* lock_;
+  WaitableEvent acquired_;
+  WaitableEvent release_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReaderThread);
+};
+
+// Takes the lock as a writer on its own thread.
+class WriterThread : public DelegateSimpleThread::Delegate {
+ public:
+  explicit WriterThread(ReadWriteLock* lock)
+      : lock_(lock), acquired_(0), thread_(this, "Writer") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    AutoWriteLock auto_lock(*lock_);
+    subtle::Release_Store(&acquired_, 1);
+  }
+
+  bool acquired() const { return subtle::Acquire_Load(&acquired_) != 0; }
+
+  void Join() { thread_.Join(); }
+
+ private:
+  ReadWriteLock* lock_;
+  subtle::Atomic32 acquired_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriterThread);
+};
+
+// Keeps two values equal, which readers check, as a writer or a reader.
+class ValuesThread : public DelegateSimpleThread::Delegate {
+ public:
+  static const int kIterations = 2000;
+
+  ValuesThread(ReadWriteLock* lock, int* first, int* second, bool writer)
+      : lock_(lock),
+        first_(first),
+        second_(second),
+        writer_(writer),
+        mismatches_(0),
+        thread_(this, writer ? "Writer" : "Reader") {}
+
+  void Start() { thread_.Start(); }
+
+  void Run() override {
+    for (int i = 0; i < kIterations; ++i) {
+      if (writer_) {
+        AutoWriteLock auto_lock(*lock_);
+        ++*first_;
+        if (i % 100 == 0)
+          PlatformThread::YieldCurrentThread();
+        ++*second_;
+      } else {
+        AutoReadLock auto_lock(*lock_);
+        const int first = *first_;
+        if (i % 100 == 0)
+          PlatformThread::YieldCurrentThread();
+        if (*second_ != first)
+          ++mismatches_;
+      }
+    }
+  }
+
+  int Join() {
+    thread_.Join();
+    return mismatches_;
+  }
+
+ private:
+  ReadWriteLock* lock_;
+  int* first_;
+  int* second_;
+  const bool writer_;
+  int mismatches_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(ValuesThread);
+};
+
+}  // namespace
+
+TEST(ReadWriteLockTest, ReadersShareTheLock) {
+  ReadWriteLock lock;
+  AutoReadLock auto_lock(lock);
+
+  // Another reader gets the lock while this thread holds it.
+  ReaderThread reader(&lock);
+  reader.WaitUntilAcquired();
+  reader.ReleaseAndJoin();
+}
+
+TEST(ReadWriteLockTest, WriterWaitsForReaders) {
+  ReadWriteLock lock;
+  ReaderThread reader(&lock);
+  reader.WaitUntilAcquired();
+
+  lock.ReadAcquire();
+  WriterThread writer(&lock);
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(20));
+  EXPECT_FALSE(writer.acquired());
+
+  lock.ReadRelease();
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(20));
+  EXPECT_FALSE(writer.acquired());
+
+  reader.ReleaseAndJoin();
+  writer.Join();
+  EXPECT_TRUE(writer.acquired());
+}
+
+TEST(ReadWriteLockTest, ReadersWaitForWriter) {
+  ReadWriteLock lock;
+  lock.WriteAcquire();
+
+  ReaderThread reader(&lock);
+  EXPECT_FALSE(reader.AcquiredWithin(TimeDelta::FromMilliseconds(20)));
+  lock.WriteRelease();
+  reader.WaitUntilAcquired();
+  reader.ReleaseAndJoin();
+}
+
+// Readers never see the two values a writer keeps equal differ, while many
+// readers and writers contend for the lock.
+TEST(ReadWriteLockTest, ReadersAndWriters) {
+  const int kNumReaders = 8;
+  const int kNumWriters = 2;
+  ReadWriteLock lock;
+  int first = 0;
+  int second = 0;
+
+  ScopedVector<ValuesThread> threads;
+  for (int i = 0; i < kNumReaders + kNumWriters; ++i) {
+    threads.push_back(
+        new ValuesThread(&lock, &first, &second, i < kNumWriters));
+  }
+  for (ValuesThread* thread : threads)
+    thread->Start();
+  for (ValuesThread* thread : threads)
+    EXPECT_EQ(0, thread->Join());
+
+  AutoReadLock auto_lock(lock);
+  EXPECT_EQ(kNumWriters * ValuesThread::kIterations, first);
+  EXPECT_EQ(first, second);
+}
+
+}  // namespace base
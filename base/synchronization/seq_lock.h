@@ -0,0 +1,98 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SYNCHRONIZATION_SEQ_LOCK_H_
+#define BASE_SYNCHRONIZATION_SEQ_LOCK_H_
+
+#include <stddef.h>
+#include <string.h>
+
+#include <type_traits>
+
+#include "base/atomicops.h"
+#include "base/macros.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "base/threading/platform_thread.h"
+
+namespace base {
+
+// A sequence lock, holding a small value of plain data which is read far more
+// often than it is written, such as a snapshot of a few counters.
+//
+// Readers neither wait for each other nor write to shared memory: they copy
+// the value, and copy it again if a writer changed it in the meantime. A
+// reader is only held up by a writer in the middle of a write. Writers are
+// serialized by a Lock.
+//
+// Example:
+//   struct Stats { int64_t count; int64_t sum; };
+//   SeqLock<Stats> stats;
+//   stats.Write(new_stats);       // On the writing threads.
+//   Stats snapshot = stats.Read();  // On any thread.
+template <typename T>
+class SeqLock {
+ public:
+  static_assert(std::is_pod<T>::value, "SeqLock only holds plain data");
+
+  SeqLock() : sequence_(0) { memset(words_, 0, sizeof(words_)); }
+  explicit SeqLock(const T& value) : sequence_(0) {
+    memset(words_, 0, sizeof(words_));
+    memcpy(words_, &value, sizeof(T));
+  }
+
+  // Returns a consistent copy of the value, as of the last Write().
+  T Read() const {
+    subtle::Atomic32 words[kNumWords];
+    for (;;) {
+      const subtle::Atomic32 sequence = subtle::Acquire_Load(&sequence_);
+      // An odd sequence number means that a write is in progress.
+      if (sequence & 1) {
+        PlatformThread::YieldCurrentThread();
+        continue;
+      }
+      for (size_t i = 0; i < kNumWords; ++i)
+        words[i] = subtle::NoBarrier_Load(&words_[i]);
+      // The copy is only good if no write started while it was made.
+      subtle::MemoryBarrier();
+      if (subtle::NoBarrier_Load(&sequence_) == sequence)
+        break;
+    }
+    T value;
+    memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+  void Write(const T& value) LOCKS_EXCLUDED(writer_lock_) {
+    subtle::Atomic32 words[kNumWords] = {};
+    memcpy(words, &value, sizeof(T));
+
+    AutoLock auto_lock(writer_lock_);
+    const subtle::Atomic32 sequence = subtle::NoBarrier_Load(&sequence_);
+    subtle::NoBarrier_Store(&sequence_, sequence + 1);
+    // Readers see the odd sequence number before any of the new words.
+    subtle::MemoryBarrier();
+    for (size_t i = 0; i < kNumWords; ++i)
+      subtle::NoBarrier_Store(&words_[i], words[i]);
+    subtle::Release_Store(&sequence_, sequence + 2);
+  }
+
+ private:
+  // The value is kept in atomic words, which readers may load while a writer
+  // stores them.
+  static const size_t kNumWords =
+      (sizeof(T) + sizeof(subtle::Atomic32) - 1) / sizeof(subtle::Atomic32);
+
+  // Odd while a write is in progress, and incremented again once it is done.
+  subtle::Atomic32 sequence_;
+  subtle::Atomic32 words_[kNumWords];
+
+  Lock writer_lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(SeqLock);
+};
+
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_SEQ_LOCK_H_
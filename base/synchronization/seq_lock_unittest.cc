@@ -0,0 +1,100 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/seq_lock.h"
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "base/memory/scoped_vector.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Larger than a word, and not a multiple of one.
+struct Snapshot {
+  int64_t first;
+  int64_t second;
+  int16_t third;
+};
+
+const int kWrites = 20000;
+
+// Reads a SeqLock until it holds its last value, and checks that each value
+// it reads is consistent and no older than the previous one.
+class SnapshotReader : public DelegateSimpleThread::Delegate {
+ public:
+  explicit SnapshotReader(const SeqLock<Snapshot>* lock)
+      : lock_(lock), inconsistencies_(0), thread_(this, "SnapshotReader") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    int64_t last = 0;
+    while (last != kWrites) {
+      const Snapshot snapshot = lock_->Read();
+      if (snapshot.second != snapshot.first * 2 ||
+          snapshot.third != static_cast<int16_t>(snapshot.first) ||
+          snapshot.first < last) {
+        ++inconsistencies_;
+      }
+      last = snapshot.first;
+    }
+  }
+
+  int Join() {
+    thread_.Join();
+    return inconsistencies_;
+  }
+
+ private:
+  const SeqLock<Snapshot>* lock_;
+  int inconsistencies_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotReader);
+};
+
+}  // namespace
+
+TEST(SeqLockTest, ReadWrite) {
+  SeqLock<int> zero;
+  EXPECT_EQ(0, zero.Read());
+
+  const Snapshot kInitial = {1, 2, 3};
+  SeqLock<Snapshot> lock(kInitial);
+  Snapshot snapshot = lock.Read();
+  EXPECT_EQ(1, snapshot.first);
+  EXPECT_EQ(2, snapshot.second);
+  EXPECT_EQ(3, snapshot.third);
+
+  const Snapshot kWritten = {-4, 5, -6};
+  lock.Write(kWritten);
+  snapshot = lock.Read();
+  EXPECT_EQ(-4, snapshot.first);
+  EXPECT_EQ(5, snapshot.second);
+  EXPECT_EQ(-6, snapshot.third);
+}
+
+// Readers never see a value which is partly written.
+TEST(SeqLockTest, ConcurrentReaders) {
+  const int kNumReaders = 4;
+  const Snapshot kInitial = {0, 0, 0};
+  SeqLock<Snapshot> lock(kInitial);
+
+  ScopedVector<SnapshotReader> readers;
+  for (int i = 0; i < kNumReaders; ++i)
+    readers.push_back(new SnapshotReader(&lock));
+  for (int64_t i = 1; i <= kWrites; ++i) {
+    const Snapshot snapshot = {i, i * 2, static_cast<int16_t>(i)};
+    lock.Write(snapshot);
+  }
+  for (SnapshotReader* reader : readers)
+    EXPECT_EQ(0, reader->Join());
+}
+
+}  // namespace base
@@ -0,0 +1,349 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/macros.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/read_write_lock.h"
+#include "base/synchronization/seq_lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+#if defined(OS_POSIX)
+#include <pthread.h>
+#endif
+
+namespace base {
+
+namespace {
+
+const int kRoundTrips = 20000;
+const int kAcquisitions = 400000;
+const int kReads = 1000000;
+
+#if defined(OS_POSIX)
+// A pthread mutex and condition variable, as Lock and ConditionVariable are
+// built on other platforms, to compare with.
+class PthreadLock {
+ public:
+  PthreadLock() {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&cond_, NULL);
+  }
+  ~PthreadLock() {
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  void Acquire() { pthread_mutex_lock(&mutex_); }
+  void Release() { pthread_mutex_unlock(&mutex_); }
+  void Wait() { pthread_cond_wait(&cond_, &mutex_); }
+  void Signal() { pthread_cond_signal(&cond_); }
+
+ private:
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+
+  DISALLOW_COPY_AND_ASSIGN(PthreadLock);
+};
+#endif  // defined(OS_POSIX)
+
+// A Lock and a ConditionVariable, with the interface of a pthread mutex and
+// condition variable.
+class BaseLock {
+ public:
+  BaseLock() : cv_(&lock_) {}
+
+  void Acquire() { lock_.Acquire(); }
+  void Release() { lock_.Release(); }
+  void Wait() { cv_.Wait(); }
+  void Signal() { cv_.Signal(); }
+
+ private:
+  Lock lock_;
+  ConditionVariable cv_;
+
+  DISALLOW_COPY_AND_ASSIGN(BaseLock);
+};
+
+// Signals |pong| each time |ping| is signaled, |kRoundTrips| times.
+class EventPonger : public DelegateSimpleThread::Delegate {
+ public:
+  EventPonger(WaitableEvent* ping, WaitableEvent* pong)
+      : ping_(ping), pong_(pong), thread_(this, "EventPonger") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    for (int i = 0; i < kRoundTrips; ++i) {
+      ping_->Wait();
+      pong_->Signal();
+    }
+  }
+
+  void Join() { thread_.Join(); }
+
+ private:
+  WaitableEvent* ping_;
+  WaitableEvent* pong_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(EventPonger);
+};
+
+// Hands a turn back, with a condition variable, each time it is given one.
+template <typename LockType>
+class ConditionPonger : public DelegateSimpleThread::Delegate {
+ public:
+  ConditionPonger(LockType* lock, int* turn)
+      : lock_(lock), turn_(turn), thread_(this, "ConditionPonger") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    lock_->Acquire();
+    for (int i = 0; i < kRoundTrips; ++i) {
+      while (*turn_ != 1)
+        lock_->Wait();
+      *turn_ = 0;
+      lock_->Signal();
+    }
+    lock_->Release();
+  }
+
+  void Join() { thread_.Join(); }
+
+ private:
+  LockType* lock_;
+  int* turn_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConditionPonger);
+};
+
+// Takes a lock |kAcquisitions| times, split between its threads, each
+// incrementing a counter.
+template <typename LockType>
+class Contender : public DelegateSimpleThread::Delegate {
+ public:
+  Contender(LockType* lock, int* counter, int acquisitions)
+      : lock_(lock),
+        counter_(counter),
+        acquisitions_(acquisitions),
+        thread_(this, "Contender") {}
+
+  void Start() { thread_.Start(); }
+
+  void Run() override {
+    for (int i = 0; i < acquisitions_; ++i) {
+      lock_->Acquire();
+      ++*counter_;
+      lock_->Release();
+    }
+  }
+
+  void Join() { thread_.Join(); }
+
+ private:
+  LockType* lock_;
+  int* counter_;
+  const int acquisitions_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(Contender);
+};
+
+// A small value read far more often than it is written, with the interface
+// of SeqLock, guarded by a Lock or a ReadWriteLock.
+struct Counters {
+  int64_t count;
+  int64_t sum;
+};
+
+class LockedCounters {
+ public:
+  LockedCounters() { counters_.count = counters_.sum = 0; }
+
+  Counters Read() {
+    AutoLock auto_lock(lock_);
+    return counters_;
+  }
+
+ private:
+  Lock lock_;
+  Counters counters_;
+
+  DISALLOW_COPY_AND_ASSIGN(LockedCounters);
+};
+
+class ReadWriteLockedCounters {
+ public:
+  ReadWriteLockedCounters() { counters_.count = counters_.sum = 0; }
+
+  Counters Read() {
+    AutoReadLock auto_lock(lock_);
+    return counters_;
+  }
+
+ private:
+  ReadWriteLock lock_;
+  Counters counters_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadWriteLockedCounters);
+};
+
+// Reads |Guarded| counters |reads| times.
+template <typename Guarded>
+class CountersReader : public DelegateSimpleThread::Delegate {
+ public:
+  CountersReader(Guarded* counters, int reads)
+      : counters_(counters), reads_(reads), thread_(this, "CountersReader") {}
+
+  void Start() { thread_.Start(); }
+
+  void Run() override {
+    int64_t sum = 0;
+    for (int i = 0; i < reads_; ++i)
+      sum += counters_->Read().sum;
+    EXPECT_EQ(0, sum);
+  }
+
+  void Join() { thread_.Join(); }
+
+ private:
+  Guarded* counters_;
+  const int reads_;
+  DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountersReader);
+};
+
+void PrintRoundTrip(const std::string& trace, TimeDelta elapsed) {
+  perf_test::PrintResult("round_trip_time", "", trace,
+                         elapsed.InSecondsF() * 1e6 / kRoundTrips, "us", true);
+}
+
+template <typename LockType>
+void MeasureConditionRoundTrips(const std::string& trace) {
+  LockType lock;
+  int turn = 0;
+  ConditionPonger<LockType> ponger(&lock, &turn);
+  const TimeTicks start = TimeTicks::Now();
+  lock.Acquire();
+  for (int i = 0; i < kRoundTrips; ++i) {
+    turn = 1;
+    lock.Signal();
+    while (turn != 0)
+      lock.Wait();
+  }
+  lock.Release();
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  ponger.Join();
+  PrintRoundTrip(trace, elapsed);
+}
+
+template <typename LockType>
+void MeasureContention(const std::string& trace, int num_threads) {
+  LockType lock;
+  int counter = 0;
+  ScopedVector<Contender<LockType>> contenders;
+  for (int i = 0; i < num_threads; ++i) {
+    contenders.push_back(new Contender<LockType>(&lock, &counter,
+                                                 kAcquisitions / num_threads));
+  }
+  const TimeTicks start = TimeTicks::Now();
+  for (Contender<LockType>* contender : contenders)
+    contender->Start();
+  for (Contender<LockType>* contender : contenders)
+    contender->Join();
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  EXPECT_EQ(kAcquisitions / num_threads * num_threads, counter);
+
+  perf_test::PrintResult("acquisition_time",
+                         "_" + IntToString(num_threads) + "threads", trace,
+                         elapsed.InSecondsF() * 1e9 / counter, "ns", true);
+}
+
+template <typename Guarded>
+void MeasureReads(const std::string& trace, int num_threads) {
+  Guarded counters;
+  ScopedVector<CountersReader<Guarded>> readers;
+  for (int i = 0; i < num_threads; ++i) {
+    readers.push_back(
+        new CountersReader<Guarded>(&counters, kReads / num_threads));
+  }
+  const TimeTicks start = TimeTicks::Now();
+  for (CountersReader<Guarded>* reader : readers)
+    reader->Start();
+  for (CountersReader<Guarded>* reader : readers)
+    reader->Join();
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+
+  perf_test::PrintResult("read_time",
+                         "_" + IntToString(num_threads) + "threads", trace,
+                         elapsed.InSecondsF() * 1e9 /
+                             (kReads / num_threads * num_threads),
+                         "ns", true);
+}
+
+}  // namespace
+
+TEST(SynchronizationPerfTest, WaitableEventRoundTrip) {
+  const bool kManualReset[] = {false, true};
+  for (bool manual_reset : kManualReset) {
+    WaitableEvent ping(false, false);
+    WaitableEvent pong(manual_reset, false);
+    EventPonger ponger(&ping, &pong);
+    const TimeTicks start = TimeTicks::Now();
+    for (int i = 0; i < kRoundTrips; ++i) {
+      ping.Signal();
+      pong.Wait();
+      if (manual_reset)
+        pong.Reset();
+    }
+    const TimeDelta elapsed = TimeTicks::Now() - start;
+    ponger.Join();
+    PrintRoundTrip(manual_reset ? "WaitableEvent_ManualReset"
+                                : "WaitableEvent_AutoReset",
+                   elapsed);
+  }
+}
+
+TEST(SynchronizationPerfTest, ConditionVariableRoundTrip) {
+  MeasureConditionRoundTrips<BaseLock>("ConditionVariable");
+#if defined(OS_POSIX)
+  MeasureConditionRoundTrips<PthreadLock>("pthread_cond");
+#endif
+}
+
+TEST(SynchronizationPerfTest, LockContention) {
+  const int kThreadCounts[] = {1, 2, 4, 8};
+  for (int num_threads : kThreadCounts) {
+    MeasureContention<BaseLock>("Lock", num_threads);
+#if defined(OS_POSIX)
+    MeasureContention<PthreadLock>("pthread_mutex", num_threads);
+#endif
+  }
+}
+
+TEST(SynchronizationPerfTest, ReadMostly) {
+  const int kThreadCounts[] = {1, 4, 16, 64};
+  for (int num_threads : kThreadCounts) {
+    MeasureReads<LockedCounters>("Lock", num_threads);
+    MeasureReads<ReadWriteLockedCounters>("ReadWriteLock", num_threads);
+    MeasureReads<SeqLock<Counters>>("SeqLock", num_threads);
+  }
+}
+
+}  // namespace base
@@ -18,6 +18,7 @@
 #if defined(OS_POSIX)
 #include <list>
 #include <utility>
+#include "base/atomicops.h"
 #include "base/memory/ref_counted.h"
 #include "base/synchronization/lock.h"
 #endif
@@ -154,9 +155,21 @@ class BASE_EXPORT WaitableEvent {
 
     bool Dequeue(Waiter* waiter, void* tag);
 
+    // Called with |lock_| held. If the event is signaled, resets it unless it
+    // is manual-reset, and returns true. Otherwise returns false, once Signal()
+    // is made to take |lock_|, so that a waiter can be enqueued.
+    bool ConsumeSignalOrPrepareEnqueue();
+
+    // Called with |lock_| held, once |waiters_| may have become empty.
+    void UpdateHasWaiterList();
+
     base::Lock lock_;
     const bool manual_reset_;
-    bool signaled_;
+    // Whether the event is signaled, whether |waiters_| is not empty, which
+    // only changes with |lock_| held, and on Linux, the number of threads
+    // waiting on it as a futex. Signal() and Wait() only take |lock_| when
+    // there are waiters in |waiters_|.
+    subtle::Atomic32 state_;
     std::list<Waiter*> waiters_;
 
    private:
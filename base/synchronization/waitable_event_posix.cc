@@ -12,6 +12,14 @@
 #include "base/synchronization/lock.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/threading/thread_restrictions.h"
+#include "build/build_config.h"
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <errno.h>
+#include <limits.h>
+
+#include "base/synchronization/futex_linux.h"
+#endif
 
 // -----------------------------------------------------------------------------
 // A WaitableEvent on POSIX is implemented as a wait-list. Currently we don't
@@ -32,10 +40,26 @@
 // the wait-list of many events. An event passes a pointer to itself when
 // firing a waiter and so we can store that pointer to find out which event
 // triggered.
+//
+// Whether the event is signaled and whether the wait-list is empty are kept in
+// an atomic state word, so that an event without a wait-list is signaled
+// without taking the lock. On Linux, Wait and TimedWait do not use the
+// wait-list at all: they wait on the state word as a futex, so that Signal is
+// a single atomic operation, followed by a futex wake if there are waiters.
 // -----------------------------------------------------------------------------
 
 namespace base {
 
+namespace {
+
+// The bits of WaitableEventKernel::state_.
+const subtle::Atomic32 kSignaled = 1;
+const subtle::Atomic32 kHasWaiterList = 2;
+// Added to the state for each thread waiting on it as a futex.
+const subtle::Atomic32 kFutexWaiter = 4;
+
+}  // namespace
+
 // -----------------------------------------------------------------------------
 // This is just an abstract base class for waking the two types of waiters
 // -----------------------------------------------------------------------------
@@ -47,34 +71,74 @@ WaitableEvent::~WaitableEvent() {
 }
 
 void WaitableEvent::Reset() {
-  base::AutoLock locked(kernel_->lock_);
-  kernel_->signaled_ = false;
+  subtle::Atomic32 state = subtle::NoBarrier_Load(&kernel_->state_);
+  while (state & kSignaled) {
+    const subtle::Atomic32 previous = subtle::NoBarrier_CompareAndSwap(
+        &kernel_->state_, state, state & ~kSignaled);
+    if (previous == state)
+      return;
+    state = previous;
+  }
 }
 
 void WaitableEvent::Signal() {
-  base::AutoLock locked(kernel_->lock_);
-
-  if (kernel_->signaled_)
-    return;
-
-  if (kernel_->manual_reset_) {
-    SignalAll();
-    kernel_->signaled_ = true;
-  } else {
-    // In the case of auto reset, if no waiters were woken, we remain
-    // signaled.
-    if (!SignalOne())
-      kernel_->signaled_ = true;
+  // A waiter may delete the event as soon as it sees it signaled, so nothing
+  // but the kernel's address is used once it is: waking up the threads waiting
+  // on an address which is no longer a futex is harmless.
+  WaitableEventKernel* const kernel = kernel_.get();
+  const bool manual_reset = kernel->manual_reset_;
+  // Set when the wait-list is signaled. This keeps the kernel alive until its
+  // lock is released.
+  scoped_refptr<WaitableEventKernel> locked_kernel;
+
+  subtle::Atomic32 state = subtle::NoBarrier_Load(&kernel->state_);
+  for (;;) {
+    if (state & kSignaled)
+      break;
+
+    if ((state & kHasWaiterList) && !locked_kernel.get()) {
+      locked_kernel = kernel;
+      kernel->lock_.Acquire();
+      if (manual_reset) {
+        SignalAll();
+      } else if (SignalOne()) {
+        break;
+      }
+      // In the case of auto reset, if no waiters were woken, we remain
+      // signaled.
+      state = subtle::NoBarrier_Load(&kernel->state_);
+      continue;
+    }
+
+    const subtle::Atomic32 previous = subtle::Release_CompareAndSwap(
+        &kernel->state_, state, state | kSignaled);
+    if (previous == state) {
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+      if (state >= kFutexWaiter)
+        internal::FutexWake(&kernel->state_, manual_reset ? INT_MAX : 1);
+#endif
+      break;
+    }
+    state = previous;
   }
+
+  if (locked_kernel.get())
+    locked_kernel->lock_.Release();
 }
 
 bool WaitableEvent::IsSignaled() {
-  base::AutoLock locked(kernel_->lock_);
-
-  const bool result = kernel_->signaled_;
-  if (result && !kernel_->manual_reset_)
-    kernel_->signaled_ = false;
-  return result;
+  if (kernel_->manual_reset_)
+    return (subtle::Acquire_Load(&kernel_->state_) & kSignaled) != 0;
+
+  subtle::Atomic32 state = subtle::NoBarrier_Load(&kernel_->state_);
+  while (state & kSignaled) {
+    const subtle::Atomic32 previous = subtle::Acquire_CompareAndSwap(
+        &kernel_->state_, state, state & ~kSignaled);
+    if (previous == state)
+      return true;
+    state = previous;
+  }
+  return false;
 }
 
 // -----------------------------------------------------------------------------
@@ -157,19 +221,78 @@ void WaitableEvent::Wait() {
   DCHECK(result) << "TimedWait() should never fail with infinite timeout";
 }
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+
 bool WaitableEvent::TimedWait(const TimeDelta& max_time) {
   base::ThreadRestrictions::AssertWaitAllowed();
-  const TimeTicks end_time(TimeTicks::Now() + max_time);
   const bool finite_time = max_time.ToInternalValue() >= 0;
 
-  kernel_->lock_.Acquire();
-  if (kernel_->signaled_) {
-    if (!kernel_->manual_reset_) {
-      // In this case we were signaled when we had no waiters. Now that
-      // someone has waited upon us, we can automatically reset.
-      kernel_->signaled_ = false;
+  // The deadline of the futex wait, which is absolute on CLOCK_MONOTONIC, the
+  // clock of TimeTicks.
+  struct timespec deadline;
+  const struct timespec* deadline_pointer = NULL;
+  bool timed_out = finite_time && max_time <= TimeDelta();
+  if (finite_time && !timed_out) {
+    const TimeTicks end_time(TimeTicks::Now() + max_time);
+    if (!end_time.is_max()) {
+      deadline = (end_time - TimeTicks()).ToTimeSpec();
+      deadline_pointer = &deadline;
+    }
+  }
+
+  WaitableEventKernel* const kernel = kernel_.get();
+  // kFutexWaiter once this thread is counted in the state.
+  subtle::Atomic32 registered = 0;
+  subtle::Atomic32 state = subtle::NoBarrier_Load(&kernel->state_);
+  for (;;) {
+    subtle::Atomic32 new_state;
+    if (state & kSignaled) {
+      // Take the signal, which an auto-reset event only gives to one waiter,
+      // and stop being counted as a waiter at once.
+      new_state = state - registered;
+      if (!kernel->manual_reset_)
+        new_state &= ~kSignaled;
+    } else if (timed_out) {
+      new_state = state - registered;
+    } else if (!registered) {
+      new_state = state + kFutexWaiter;
+    } else {
+      // Sleep unless the state changed since it was read, then read it again
+      // whatever woke this thread up.
+      const int rv =
+          internal::FutexWaitUntil(&kernel->state_, state, deadline_pointer);
+      if (rv < 0 && errno == ETIMEDOUT)
+        timed_out = true;
+      state = subtle::NoBarrier_Load(&kernel->state_);
+      continue;
+    }
+
+    const subtle::Atomic32 previous =
+        subtle::Acquire_CompareAndSwap(&kernel->state_, state, new_state);
+    if (previous != state) {
+      state = previous;
+      continue;
     }
+    if (state & kSignaled)
+      return true;
+    if (timed_out)
+      return false;
+    registered = kFutexWaiter;
+    state = new_state;
+  }
+}
+
+#else  // defined(OS_LINUX) || defined(OS_ANDROID)
+
+bool WaitableEvent::TimedWait(const TimeDelta& max_time) {
+  base::ThreadRestrictions::AssertWaitAllowed();
+  const TimeTicks end_time(TimeTicks::Now() + max_time);
+  const bool finite_time = max_time.ToInternalValue() >= 0;
 
+  kernel_->lock_.Acquire();
+  if (kernel_->ConsumeSignalOrPrepareEnqueue()) {
+    // If this is an auto-reset event, we were signaled when we had no
+    // waiters. Now that someone has waited upon us, it was reset.
     kernel_->lock_.Release();
     return true;
   }
@@ -218,6 +341,8 @@ bool WaitableEvent::TimedWait(const TimeDelta& max_time) {
   }
 }
 
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
 // -----------------------------------------------------------------------------
 // Synchronous waiting on multiple objects.
 
@@ -325,15 +450,14 @@ size_t WaitableEvent::EnqueueMany
     return 0;
 
   waitables[0].first->kernel_->lock_.Acquire();
-    if (waitables[0].first->kernel_->signaled_) {
-      if (!waitables[0].first->kernel_->manual_reset_)
-        waitables[0].first->kernel_->signaled_ = false;
+    if (waitables[0].first->kernel_->ConsumeSignalOrPrepareEnqueue()) {
       waitables[0].first->kernel_->lock_.Release();
       return count;
     }
 
     const size_t r = EnqueueMany(waitables + 1, count - 1, waiter);
     if (r) {
+      waitables[0].first->kernel_->UpdateHasWaiterList();
       waitables[0].first->kernel_->lock_.Release();
     } else {
       waitables[0].first->Enqueue(waiter);
@@ -351,12 +475,33 @@ size_t WaitableEvent::EnqueueMany
 WaitableEvent::WaitableEventKernel::WaitableEventKernel(bool manual_reset,
                                                         bool initially_signaled)
     : manual_reset_(manual_reset),
-      signaled_(initially_signaled) {
+      state_(initially_signaled ? kSignaled : 0) {
 }
 
 WaitableEvent::WaitableEventKernel::~WaitableEventKernel() {
 }
 
+bool WaitableEvent::WaitableEventKernel::ConsumeSignalOrPrepareEnqueue() {
+  // Both at once, or a Signal() which does not see the wait-list could be
+  // missed by the waiter about to be enqueued.
+  subtle::Atomic32 state = subtle::NoBarrier_Load(&state_);
+  for (;;) {
+    subtle::Atomic32 new_state = state | kHasWaiterList;
+    if (state & kSignaled)
+      new_state = manual_reset_ ? state : state & ~kSignaled;
+    const subtle::Atomic32 previous =
+        subtle::Acquire_CompareAndSwap(&state_, state, new_state);
+    if (previous == state)
+      return (state & kSignaled) != 0;
+    state = previous;
+  }
+}
+
+void WaitableEvent::WaitableEventKernel::UpdateHasWaiterList() {
+  if (waiters_.empty() && (subtle::NoBarrier_Load(&state_) & kHasWaiterList))
+    subtle::NoBarrier_AtomicIncrement(&state_, -kHasWaiterList);
+}
+
 // -----------------------------------------------------------------------------
 // Wake all waiting waiters. Called with lock held.
 // -----------------------------------------------------------------------------
@@ -370,6 +515,7 @@ bool WaitableEvent::SignalAll() {
   }
 
   kernel_->waiters_.clear();
+  kernel_->UpdateHasWaiterList();
   return signaled_at_least_one;
 }
 
@@ -379,20 +525,26 @@ bool WaitableEvent::SignalAll() {
 // ---------------------------------------------------------------------------
 bool WaitableEvent::SignalOne() {
   for (;;) {
-    if (kernel_->waiters_.empty())
+    if (kernel_->waiters_.empty()) {
+      kernel_->UpdateHasWaiterList();
       return false;
+    }
 
     const bool r = (*kernel_->waiters_.begin())->Fire(this);
     kernel_->waiters_.pop_front();
-    if (r)
+    if (r) {
+      kernel_->UpdateHasWaiterList();
       return true;
+    }
   }
 }
 
 // -----------------------------------------------------------------------------
-// Add a waiter to the list of those waiting. Called with lock held.
+// Add a waiter to the list of those waiting. Called with lock held, after
+// ConsumeSignalOrPrepareEnqueue returned false.
 // -----------------------------------------------------------------------------
 void WaitableEvent::Enqueue(Waiter* waiter) {
+  DCHECK(subtle::NoBarrier_Load(&kernel_->state_) & kHasWaiterList);
   kernel_->waiters_.push_back(waiter);
 }
 
@@ -405,6 +557,7 @@ bool WaitableEvent::WaitableEventKernel::Dequeue(Waiter* waiter, void* tag) {
        i = waiters_.begin(); i != waiters_.end(); ++i) {
     if (*i == waiter && (*i)->Compare(tag)) {
       waiters_.erase(i);
+      UpdateHasWaiterList();
       return true;
     }
   }
@@ -6,7 +6,9 @@
 
 #include <stddef.h>
 
+#include "base/atomicops.h"
 #include "base/compiler_specific.h"
+#include "base/macros.h"
 #include "base/threading/platform_thread.h"
 #include "base/time/time.h"
 #include "build/build_config.h"
@@ -128,7 +130,7 @@ TEST(WaitableEventTest, WaitMany) {
 
 // Tests that using TimeDelta::Max() on TimedWait() is not the same as passing
 // a timeout of 0. (crbug.com/465948)
-#if defined(OS_POSIX)
+#if defined(OS_POSIX) && !defined(OS_LINUX) && !defined(OS_ANDROID)
 // crbug.com/465948 not fixed yet.
 #define MAYBE_TimedWait DISABLED_TimedWait
 #else
@@ -150,4 +152,99 @@ TEST(WaitableEventTest, MAYBE_TimedWait) {
   PlatformThread::Join(thread);
 }
 
+// Waits for an event, and counts the waiters which got out of their wait.
+class WaitableEventWaiter : public PlatformThread::Delegate {
+ public:
+  WaitableEventWaiter(WaitableEvent* event, subtle::Atomic32* woken_count)
+      : event_(event), woken_count_(woken_count) {}
+
+  void ThreadMain() override {
+    event_->Wait();
+    subtle::Barrier_AtomicIncrement(woken_count_, 1);
+  }
+
+ private:
+  WaitableEvent* event_;
+  subtle::Atomic32* woken_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(WaitableEventWaiter);
+};
+
+// Waits until |*count| is |expected|, for up to a minute.
+void WaitForCount(subtle::Atomic32* count, subtle::Atomic32 expected) {
+  const TimeTicks end_time = TimeTicks::Now() + TimeDelta::FromMinutes(1);
+  while (subtle::Acquire_Load(count) != expected &&
+         TimeTicks::Now() < end_time) {
+    PlatformThread::Sleep(TimeDelta::FromMilliseconds(1));
+  }
+  EXPECT_EQ(expected, subtle::Acquire_Load(count));
+}
+
+// Tests that each Signal() of an auto-reset event lets exactly one of many
+// waiters go.
+TEST(WaitableEventTest, AutoResetManyWaiters) {
+  const int kNumThreads = 10;
+  WaitableEvent event(false, false);
+  subtle::Atomic32 woken_count = 0;
+
+  WaitableEventWaiter waiter(&event, &woken_count);
+  PlatformThreadHandle handles[kNumThreads];
+  for (int i = 0; i < kNumThreads; ++i)
+    ASSERT_TRUE(PlatformThread::Create(0, &waiter, &handles[i]));
+
+  for (int i = 1; i <= kNumThreads; ++i) {
+    event.Signal();
+    WaitForCount(&woken_count, i);
+  }
+  EXPECT_FALSE(event.IsSignaled());
+
+  for (int i = 0; i < kNumThreads; ++i)
+    PlatformThread::Join(handles[i]);
+  EXPECT_EQ(kNumThreads, subtle::NoBarrier_Load(&woken_count));
+}
+
+// Tests that a Signal() of a manual-reset event lets all the waiters go,
+// whether they wait for it alone or with WaitMany().
+TEST(WaitableEventTest, ManualResetManyWaiters) {
+  const int kNumThreads = 10;
+  WaitableEvent event(true, false);
+  WaitableEvent other_event(true, false);
+  subtle::Atomic32 woken_count = 0;
+
+  WaitableEventWaiter waiter(&event, &woken_count);
+  PlatformThreadHandle handles[kNumThreads];
+  for (int i = 0; i < kNumThreads; ++i)
+    ASSERT_TRUE(PlatformThread::Create(0, &waiter, &handles[i]));
+
+  WaitableEventSignaler signaler(TimeDelta::FromMilliseconds(10), &event);
+  PlatformThreadHandle signaler_handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &signaler, &signaler_handle));
+  WaitableEvent* events[] = {&other_event, &event};
+  EXPECT_EQ(1u, WaitableEvent::WaitMany(events, arraysize(events)));
+
+  WaitForCount(&woken_count, kNumThreads);
+  EXPECT_TRUE(event.IsSignaled());
+  EXPECT_FALSE(other_event.IsSignaled());
+
+  PlatformThread::Join(signaler_handle);
+  for (int i = 0; i < kNumThreads; ++i)
+    PlatformThread::Join(handles[i]);
+}
+
+// Tests that TimedWait() times out when the event is not signaled, and does
+// not take the signal of an auto-reset event meant for another waiter.
+TEST(WaitableEventTest, TimedWaitTimesOut) {
+  WaitableEvent event(false, false);
+
+  const TimeDelta kTimeout = TimeDelta::FromMilliseconds(50);
+  const TimeTicks start = TimeTicks::Now();
+  EXPECT_FALSE(event.TimedWait(kTimeout));
+  EXPECT_GE(TimeTicks::Now() - start, kTimeout);
+
+  EXPECT_FALSE(event.TimedWait(TimeDelta()));
+  event.Signal();
+  EXPECT_TRUE(event.TimedWait(TimeDelta()));
+  EXPECT_FALSE(event.IsSignaled());
+}
+
 }  // namespace base
@@ -153,10 +153,7 @@ bool WaitableEventWatcher::StartWatching(
 
   event_ = event;
 
-  if (kernel->signaled_) {
-    if (!kernel->manual_reset_)
-      kernel->signaled_ = false;
-
+  if (kernel->ConsumeSignalOrPrepareEnqueue()) {
     // No hairpinning - we can't call the delegate directly here. We have to
     // enqueue a task on the MessageLoop as normal.
     current_ml->task_runner()->PostTask(FROM_HERE, internal_callback_);
@@ -177,7 +177,7 @@ void PlatformThread::Sleep(TimeDelta duration) {
 
 // static
 const char* PlatformThread::GetName() {
-  return ThreadIdNameManager::GetInstance()->GetName(CurrentId());
+  return ThreadIdNameManager::GetInstance()->GetNameForCurrentThread();
 }
 
 // static
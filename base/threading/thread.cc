@@ -11,6 +11,7 @@
 #include "base/threading/thread_id_name_manager.h"
 #include "base/threading/thread_local.h"
 #include "base/threading/thread_restrictions.h"
+#include "base/trace_event/trace_stack_sampler.h"
 #include "build/build_config.h"
 
 #if defined(OS_WIN)
@@ -220,6 +221,7 @@ void Thread::ThreadMain() {
 
   // Complete the initialization of our Thread object.
   PlatformThread::SetName(name_.c_str());
+  trace_event::TraceStackSampler::RegisterCurrentThread();
 
   // Lazily initialize the message_loop so that it can run on this thread.
   DCHECK(message_loop_);
@@ -268,6 +270,8 @@ void Thread::ThreadMain() {
     DCHECK(GetThreadWasQuitProperly());
   }
 
+  trace_event::TraceStackSampler::UnregisterCurrentThread();
+
   // We can't receive messages anymore.
   // (The message loop is destructed at the end of this block)
   message_loop_ = nullptr;
@@ -7,6 +7,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <utility>
+
 #include "base/logging.h"
 #include "base/memory/singleton.h"
 #include "base/strings/string_util.h"
@@ -17,11 +20,33 @@ namespace {
 static const char kDefaultName[] = "";
 static std::string* g_default_name;
 
+typedef std::pair<PlatformThreadId, const char*> IdAndName;
+
+bool IdLess(const IdAndName& id_and_name, PlatformThreadId id) {
+  return id_and_name.first < id;
+}
+
 }
 
+struct ThreadIdNameManager::NameTable {
+  // Returns the name of the thread |id|, or the default name if it has none.
+  const char* Find(PlatformThreadId id) const {
+    std::vector<IdAndName>::const_iterator it =
+        std::lower_bound(names.begin(), names.end(), id, &IdLess);
+    if (it == names.end() || it->first != id)
+      return g_default_name->c_str();
+    return it->second;
+  }
+
+  std::vector<IdAndName> names;
+};
+
 ThreadIdNameManager::ThreadIdNameManager()
     : main_process_name_(NULL),
-      main_process_id_(kInvalidThreadId) {
+      main_process_id_(kInvalidThreadId),
+      name_table_(reinterpret_cast<subtle::AtomicWord>(new NameTable)),
+      name_table_epoch_(0),
+      name_table_readers_() {
   g_default_name = new std::string(kDefaultName);
 
   AutoLock locked(lock_);
@@ -29,6 +54,8 @@ ThreadIdNameManager::ThreadIdNameManager()
 }
 
 ThreadIdNameManager::~ThreadIdNameManager() {
+  delete reinterpret_cast<const NameTable*>(
+      subtle::NoBarrier_Load(&name_table_));
 }
 
 ThreadIdNameManager* ThreadIdNameManager::GetInstance() {
@@ -46,6 +73,7 @@ void ThreadIdNameManager::RegisterThread(PlatformThreadHandle::Handle handle,
   thread_id_to_handle_[id] = handle;
   thread_handle_to_interned_name_[handle] =
       name_to_interned_name_[kDefaultName];
+  UpdateNameTableLocked(id);
 }
 
 void ThreadIdNameManager::SetName(PlatformThreadId id,
@@ -68,25 +96,41 @@ void ThreadIdNameManager::SetName(PlatformThreadId id,
   if (id_to_handle_iter == thread_id_to_handle_.end()) {
     main_process_name_ = leaked_str;
     main_process_id_ = id;
-    return;
+  } else {
+    thread_handle_to_interned_name_[id_to_handle_iter->second] = leaked_str;
   }
-  thread_handle_to_interned_name_[id_to_handle_iter->second] = leaked_str;
+  UpdateNameTableLocked(id);
 }
 
 const char* ThreadIdNameManager::GetName(PlatformThreadId id) {
-  AutoLock locked(lock_);
-
-  if (id == main_process_id_)
-    return main_process_name_->c_str();
-
-  ThreadIdToHandleMap::iterator id_to_handle_iter =
-      thread_id_to_handle_.find(id);
-  if (id_to_handle_iter == thread_id_to_handle_.end())
-    return name_to_interned_name_[kDefaultName]->c_str();
+  // Keeps the table from being deleted while it is looked up. If an update
+  // started a new epoch meanwhile, it may not have seen the count, so the
+  // lookup counts itself in the new epoch instead. The epoch is checked again
+  // with an acquire load, as updates may have flipped it away and back: the
+  // table loaded below is then at least as new as the last of them, which
+  // waits for this count before it is replaced.
+  subtle::Atomic32* readers;
+  for (;;) {
+    const subtle::Atomic32 epoch = subtle::Acquire_Load(&name_table_epoch_);
+    readers = &name_table_readers_[epoch];
+    subtle::Barrier_AtomicIncrement(readers, 1);
+    if (subtle::Acquire_Load(&name_table_epoch_) == epoch)
+      break;
+    subtle::Barrier_AtomicIncrement(readers, -1);
+  }
+  const char* name = reinterpret_cast<const NameTable*>(
+                         subtle::Acquire_Load(&name_table_))->Find(id);
+  subtle::Barrier_AtomicIncrement(readers, -1);
+  return name;
+}
 
-  ThreadHandleToInternedNameMap::iterator handle_to_name_iter =
-      thread_handle_to_interned_name_.find(id_to_handle_iter->second);
-  return handle_to_name_iter->second->c_str();
+const char* ThreadIdNameManager::GetNameForCurrentThread() {
+  const char* name = current_thread_name_.Get();
+  if (!name) {
+    name = GetName(PlatformThread::CurrentId());
+    current_thread_name_.Set(name);
+  }
+  return name;
 }
 
 void ThreadIdNameManager::RemoveName(PlatformThreadHandle::Handle handle,
@@ -103,10 +147,47 @@ void ThreadIdNameManager::RemoveName(PlatformThreadHandle::Handle handle,
   DCHECK((id_to_handle_iter!= thread_id_to_handle_.end()));
   // The given |id| may have been re-used by the system. Make sure the
   // mapping points to the provided |handle| before removal.
-  if (id_to_handle_iter->second != handle)
-    return;
+  if (id_to_handle_iter->second == handle)
+    thread_id_to_handle_.erase(id_to_handle_iter);
+  UpdateNameTableLocked(id);
+}
+
+void ThreadIdNameManager::UpdateNameTableLocked(PlatformThreadId id) {
+  NameTable* table = new NameTable;
+  table->names.reserve(thread_id_to_handle_.size() + 1);
+  for (const auto& id_and_handle : thread_id_to_handle_) {
+    if (id_and_handle.first == main_process_id_)
+      continue;
+    ThreadHandleToInternedNameMap::const_iterator handle_to_name_iter =
+        thread_handle_to_interned_name_.find(id_and_handle.second);
+    DCHECK(handle_to_name_iter != thread_handle_to_interned_name_.end());
+    table->names.push_back(
+        IdAndName(id_and_handle.first, handle_to_name_iter->second->c_str()));
+  }
+  if (main_process_id_ != kInvalidThreadId) {
+    table->names.insert(std::lower_bound(table->names.begin(),
+                                         table->names.end(), main_process_id_,
+                                         &IdLess),
+                        IdAndName(main_process_id_,
+                                  main_process_name_->c_str()));
+  }
 
-  thread_id_to_handle_.erase(id_to_handle_iter);
+  // Lookups which start in the new epoch load the new table. Those counted in
+  // the old one may still use the old table, which is deleted once they are
+  // done; they are short, and no new ones are counted there.
+  const NameTable* old_table =
+      reinterpret_cast<const NameTable*>(subtle::NoBarrier_Load(&name_table_));
+  subtle::Release_Store(&name_table_,
+                        reinterpret_cast<subtle::AtomicWord>(table));
+  const subtle::Atomic32 epoch = subtle::NoBarrier_Load(&name_table_epoch_);
+  subtle::Release_Store(&name_table_epoch_, epoch ^ 1);
+  subtle::MemoryBarrier();
+  while (subtle::Acquire_Load(&name_table_readers_[epoch]))
+    PlatformThread::YieldCurrentThread();
+  delete old_table;
+
+  if (id == PlatformThread::CurrentId())
+    current_thread_name_.Set(table->Find(id));
 }
 
 }  // namespace base
@@ -8,16 +8,29 @@
 #include <map>
 #include <string>
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/macros.h"
 #include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
 #include "base/threading/platform_thread.h"
+#include "base/threading/thread_local.h"
 
 namespace base {
 
 template <typename T>
 struct DefaultSingletonTraits;
 
+// Keeps the names of the threads, by thread id. Names are interned: the same
+// name is always returned as the same pointer, which stays valid forever.
+//
+// Looking up a name does not take a lock. The names of all the threads are
+// kept in an immutable table, which is replaced as a whole when a name changes
+// and looked up lock-free: a lookup retries if a name changes as it starts,
+// and a change waits for the lookups of the table it replaces. The name of
+// each thread is also cached in a thread-local for its own lookups. Names are
+// expected to be set by the threads they name, which is what keeps their
+// cached names up to date.
 class BASE_EXPORT ThreadIdNameManager {
  public:
   static ThreadIdNameManager* GetInstance();
@@ -33,6 +46,9 @@ class BASE_EXPORT ThreadIdNameManager {
   // Get the name for the given id.
   const char* GetName(PlatformThreadId id);
 
+  // Same as GetName(PlatformThread::CurrentId()), without a system call.
+  const char* GetNameForCurrentThread();
+
   // Remove the name for the given id.
   void RemoveName(PlatformThreadHandle::Handle handle, PlatformThreadId id);
 
@@ -45,20 +61,43 @@ class BASE_EXPORT ThreadIdNameManager {
       ThreadHandleToInternedNameMap;
   typedef std::map<std::string, std::string*> NameToInternedNameMap;
 
+  // The interned names of the threads, sorted by thread id.
+  struct NameTable;
+
   ThreadIdNameManager();
   ~ThreadIdNameManager();
 
+  // Replaces |name_table_| with one built from the maps, and sets the cached
+  // name of the current thread to its name, if it is |id|. The replaced table
+  // is deleted once the lookups which may still use it are done.
+  void UpdateNameTableLocked(PlatformThreadId id)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // lock_ protects the name_to_interned_name_, thread_id_to_handle_ and
   // thread_handle_to_interned_name_ maps.
   Lock lock_;
 
-  NameToInternedNameMap name_to_interned_name_;
-  ThreadIdToHandleMap thread_id_to_handle_;
-  ThreadHandleToInternedNameMap thread_handle_to_interned_name_;
+  NameToInternedNameMap name_to_interned_name_ GUARDED_BY(lock_);
+  ThreadIdToHandleMap thread_id_to_handle_ GUARDED_BY(lock_);
+  ThreadHandleToInternedNameMap thread_handle_to_interned_name_
+      GUARDED_BY(lock_);
 
   // Treat the main process specially as there is no PlatformThreadHandle.
-  std::string* main_process_name_;
-  PlatformThreadId main_process_id_;
+  std::string* main_process_name_ GUARDED_BY(lock_);
+  PlatformThreadId main_process_id_ GUARDED_BY(lock_);
+
+  // The current NameTable, which GetName() looks up.
+  subtle::AtomicWord name_table_;
+
+  // Flips between 0 and 1 whenever |name_table_| is replaced. A GetName()
+  // counts itself in name_table_readers_[epoch] of the epoch it starts in, so
+  // that an update only waits for the lookups started before it, not for new
+  // ones.
+  subtle::Atomic32 name_table_epoch_;
+  subtle::Atomic32 name_table_readers_[2];
+
+  // The interned name of the current thread, once it was set or looked up.
+  ThreadLocalPointer<const char> current_thread_name_;
 
   DISALLOW_COPY_AND_ASSIGN(ThreadIdNameManager);
 };
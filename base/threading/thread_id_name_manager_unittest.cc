@@ -4,7 +4,12 @@
 
 #include "base/threading/thread_id_name_manager.h"
 
+#include <string.h>
+
+#include "base/atomicops.h"
+#include "base/macros.h"
 #include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
 #include "base/threading/thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/platform_test.h"
@@ -16,6 +21,38 @@ namespace {
 const char kAThread[] = "a thread";
 const char kBThread[] = "b thread";
 
+// Looks up the name of a thread over and over, until told to stop.
+class NameLookupThread : public base::DelegateSimpleThread::Delegate {
+ public:
+  explicit NameLookupThread(base::PlatformThreadId id)
+      : id_(id), stop_(0), mismatches_(0), thread_(this, "NameLookup") {
+    thread_.Start();
+  }
+
+  void Run() override {
+    base::ThreadIdNameManager* manager =
+        base::ThreadIdNameManager::GetInstance();
+    while (!base::subtle::Acquire_Load(&stop_)) {
+      if (strcmp(kAThread, manager->GetName(id_)) != 0)
+        ++mismatches_;
+    }
+  }
+
+  int StopAndJoin() {
+    base::subtle::Release_Store(&stop_, 1);
+    thread_.Join();
+    return mismatches_;
+  }
+
+ private:
+  const base::PlatformThreadId id_;
+  base::subtle::Atomic32 stop_;
+  int mismatches_;
+  base::DelegateSimpleThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(NameLookupThread);
+};
+
 TEST_F(ThreadIdNameManagerTest, AddThreads) {
   base::ThreadIdNameManager* manager = base::ThreadIdNameManager::GetInstance();
   base::Thread thread_a(kAThread);
@@ -90,4 +127,36 @@ TEST_F(ThreadIdNameManagerTest, ResettingNameKeepsCorrectInternedValue) {
   base::PlatformThread::SetName("");
 }
 
+TEST_F(ThreadIdNameManagerTest, GetNameForCurrentThread) {
+  base::ThreadIdNameManager* manager = base::ThreadIdNameManager::GetInstance();
+
+  base::PlatformThreadId a_id = base::PlatformThread::CurrentId();
+  base::PlatformThread::SetName("Test Name");
+  EXPECT_EQ(manager->GetName(a_id), manager->GetNameForCurrentThread());
+  EXPECT_STREQ("Test Name", manager->GetNameForCurrentThread());
+
+  base::PlatformThread::SetName("New name");
+  EXPECT_EQ(manager->GetName(a_id), manager->GetNameForCurrentThread());
+  EXPECT_STREQ("New name", base::PlatformThread::GetName());
+
+  base::PlatformThread::SetName("");
+  EXPECT_STREQ("", manager->GetNameForCurrentThread());
+}
+
+// Looking up a name while other threads come and go always finds it.
+TEST_F(ThreadIdNameManagerTest, LookupWhileThreadsChange) {
+  base::Thread thread_a(kAThread);
+  thread_a.StartAndWaitForTesting();
+
+  NameLookupThread lookup(thread_a.GetThreadId());
+  for (int i = 0; i < 20; ++i) {
+    base::Thread thread_b(kBThread);
+    thread_b.StartAndWaitForTesting();
+    thread_b.Stop();
+  }
+  EXPECT_EQ(0, lookup.StopAndJoin());
+
+  thread_a.Stop();
+}
+
 }  // namespace
@@ -657,6 +657,20 @@ class BASE_EXPORT TimeTicks : public time_internal::TimeBase<TimeTicks> {
   // clock will be used instead.
   static bool IsHighResolution();
 
+  // Like Now(), but cheaper where the CPU has an invariant time stamp counter
+  // (see CPU::has_non_stop_time_stamp_counter()), on x86 Linux and Android:
+  // converts a reading of the counter with a rate that is regularly
+  // recalibrated against Now(), instead of asking the kernel.  The values have
+  // the same origin as those of Now(), and normally stay within a few
+  // microseconds of them; they only jump if Now() itself does relative to the
+  // counter, e.g. across a suspend.  Returns Now() elsewhere, and until the
+  // rate of the counter has been measured, which takes a few milliseconds.
+  static TimeTicks NowFromTimeStampCounter();
+
+  // Returns true if NowFromTimeStampCounter() reads the time stamp counter,
+  // rather than calling Now().
+  static bool IsTimeStampCounterCalibrated();
+
 #if defined(OS_WIN)
   // Translates an absolute QPC timestamp into a TimeTicks value. The returned
   // value has the same origin as Now(). Do NOT attempt to use this if
@@ -0,0 +1,53 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/time/time.h"
+
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const int kReadings = 1000000;
+
+// Reads |clock| kReadings times, and prints the time each reading took.
+template <typename Clock>
+void MeasureClock(const char* trace, Clock clock) {
+  int64_t sink = 0;
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kReadings; i++)
+    sink += clock().ToInternalValue();
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  EXPECT_NE(0, sink);
+  perf_test::PrintResult("time_per_reading", "", trace,
+                         elapsed.InSecondsF() * 1e9 / kReadings, "ns", true);
+}
+
+}  // namespace
+
+TEST(TimePerfTest, Now) {
+  // Gives NowFromTimeStampCounter() time to calibrate the counter.
+  const TimeTicks deadline = TimeTicks::Now() + TimeDelta::FromSeconds(1);
+  while (!TimeTicks::IsTimeStampCounterCalibrated() &&
+         TimeTicks::Now() < deadline) {
+    TimeTicks::NowFromTimeStampCounter();
+    PlatformThread::Sleep(TimeDelta::FromMilliseconds(1));
+  }
+
+  MeasureClock("Time::Now", &Time::Now);
+  MeasureClock("TimeTicks::Now", &TimeTicks::Now);
+  MeasureClock(TimeTicks::IsTimeStampCounterCalibrated()
+                   ? "TimeTicks::NowFromTimeStampCounter"
+                   : "TimeTicks::NowFromTimeStampCounter_uncalibrated",
+               &TimeTicks::NowFromTimeStampCounter);
+  if (ThreadTicks::IsSupported()) {
+    ThreadTicks::WaitUntilInitialized();
+    MeasureClock("ThreadTicks::Now", &ThreadTicks::Now);
+  }
+}
+
+}  // namespace base
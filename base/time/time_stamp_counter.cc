@@ -0,0 +1,253 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/time/time.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/cpu.h"
+#include "base/lazy_instance.h"
+#include "base/synchronization/lock.h"
+#include "build/build_config.h"
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY) && (defined(OS_LINUX) || defined(OS_ANDROID))
+
+namespace {
+
+// How long the rate of the counter is first measured for, during which
+// NowFromTimeStampCounter() returns Now().
+const int64_t kInitialCalibrationMicroseconds =
+    10 * Time::kMicrosecondsPerMillisecond;
+
+// How often the rate is measured again, to follow the adjustments made to
+// Now(), e.g. by NTP.
+const int64_t kRecalibrationIntervalMicroseconds =
+    100 * Time::kMicrosecondsPerMillisecond;
+
+// When the conversion is behind Now() by more than this, it jumps to Now()
+// instead of converging to it. It never jumps back, as its values would then
+// decrease: when it is ahead of Now(), it converges at up to half speed.
+const int64_t kMaxErrorMicroseconds = Time::kMicrosecondsPerMillisecond;
+
+// Measurements of the counter against Now() which take longer than this, e.g.
+// because the thread was preempted, are not precise enough to use.
+const double kMaxMeasurementMicroseconds = 50;
+
+uint64_t ReadTimeStampCounter() {
+  uint32_t low;
+  uint32_t high;
+  __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+  return static_cast<uint64_t>(high) << 32 | low;
+}
+
+// Keeps the compiler from moving memory accesses across it.  x86 itself does
+// not reorder loads with other loads, nor stores with other stores.
+inline void CompilerBarrier() {
+  __asm__ volatile("" : : : "memory");
+}
+
+// Converts counter readings to TimeTicks: the counter reading |ticks|
+// corresponds to |us| microseconds, and each tick to |us_per_tick| more.
+struct Conversion {
+  uint64_t ticks;
+  int64_t us;
+  double us_per_tick;
+
+  // The counter reading from which to measure the rate again.
+  uint64_t recalibration_ticks;
+};
+
+int64_t Convert(const Conversion& conversion, uint64_t ticks) {
+  // |ticks| can be slightly before |conversion.ticks|, when read on another
+  // CPU or before a concurrent recalibration.
+  return conversion.us +
+         static_cast<int64_t>(
+             static_cast<int64_t>(ticks - conversion.ticks) *
+             conversion.us_per_tick);
+}
+
+enum CounterSupport {
+  COUNTER_SUPPORT_UNKNOWN,
+  COUNTER_SUPPORTED,
+  COUNTER_UNSUPPORTED,
+};
+
+subtle::Atomic32 g_counter_support = COUNTER_SUPPORT_UNKNOWN;
+
+// g_conversion is read without locking, under a sequence lock: g_sequence is
+// odd while g_conversion is being written, and changes with each write.  It
+// is 0 until the first conversion is written.
+subtle::Atomic32 g_sequence = 0;
+Conversion g_conversion;
+
+// The state of the writer of g_conversion.
+struct Calibration {
+  Calibration() : ticks(0), us(0), measurement_ticks(0) {}
+
+  Lock lock;
+
+  // The last measurement of the counter against Now(), if |ticks| is not 0,
+  // and how many ticks it took.
+  uint64_t ticks;
+  int64_t us;
+  uint64_t measurement_ticks;
+};
+
+LazyInstance<Calibration>::Leaky g_calibration = LAZY_INSTANCE_INITIALIZER;
+
+// Measures the counter against Now(), and updates g_conversion when it is due.
+// Never blocks: when another thread is calibrating, returns right away.
+void Calibrate() {
+  Calibration* calibration = g_calibration.Pointer();
+  if (!calibration->lock.Try())
+    return;
+  AutoLock lock(calibration->lock, AutoLock::AlreadyAcquired());
+
+  if (subtle::NoBarrier_Load(&g_counter_support) == COUNTER_SUPPORT_UNKNOWN) {
+    subtle::NoBarrier_Store(&g_counter_support,
+                            CPU().has_non_stop_time_stamp_counter()
+                                ? COUNTER_SUPPORTED
+                                : COUNTER_UNSUPPORTED);
+  }
+  if (subtle::NoBarrier_Load(&g_counter_support) != COUNTER_SUPPORTED)
+    return;
+
+  // Only this thread writes g_sequence and g_conversion.
+  const subtle::Atomic32 sequence = subtle::NoBarrier_Load(&g_sequence);
+  const Conversion& current = g_conversion;
+
+  // Reading the counter around Now() bounds the error of the measurement.
+  const uint64_t before = ReadTimeStampCounter();
+  const int64_t now_us = TimeTicks::Now().ToInternalValue();
+  const uint64_t after = ReadTimeStampCounter();
+  const uint64_t ticks = before + (after - before) / 2;
+
+  if (!calibration->ticks) {
+    calibration->ticks = ticks;
+    calibration->us = now_us;
+    calibration->measurement_ticks = after - before;
+    return;
+  }
+  if (ticks <= calibration->ticks || now_us <= calibration->us)
+    return;
+
+  const double us_per_tick = static_cast<double>(now_us - calibration->us) /
+                             static_cast<double>(ticks - calibration->ticks);
+  if (sequence == 0) {
+    if (now_us - calibration->us < kInitialCalibrationMicroseconds)
+      return;
+    // There is no rate to bound the measurements with yet, but the one they
+    // make is precise enough for that.
+    if ((after - before) * us_per_tick > kMaxMeasurementMicroseconds)
+      return;
+    if (calibration->measurement_ticks * us_per_tick >
+        kMaxMeasurementMicroseconds) {
+      // The first measurement was not precise: start over from this one.
+      calibration->ticks = ticks;
+      calibration->us = now_us;
+      calibration->measurement_ticks = after - before;
+      return;
+    }
+  } else {
+    if (ticks < current.recalibration_ticks)
+      return;  // Another thread just recalibrated.
+    if ((after - before) * current.us_per_tick > kMaxMeasurementMicroseconds)
+      return;
+  }
+
+  calibration->ticks = ticks;
+  calibration->us = now_us;
+  calibration->measurement_ticks = after - before;
+
+  Conversion next;
+  next.ticks = ticks;
+  next.us = now_us;
+  next.us_per_tick = us_per_tick;
+  if (sequence != 0) {
+    // Continues from the current conversion, so that the values stay
+    // monotonic, and converges to Now() by the next recalibration.
+    const int64_t converted_us = Convert(current, ticks);
+    const int64_t error_us = now_us - converted_us;
+    if (error_us < kMaxErrorMicroseconds) {
+      next.us = converted_us;
+      next.us_per_tick =
+          us_per_tick *
+          (1 + static_cast<double>(std::max(
+                   error_us, -kRecalibrationIntervalMicroseconds / 2)) /
+                   kRecalibrationIntervalMicroseconds);
+    }
+  }
+
+  // Counter readings up to about now may still be converted with the current
+  // conversion, so the next one starts from here, and no lower than the
+  // current one.
+  const uint64_t switch_ticks = ReadTimeStampCounter();
+  next.us = Convert(next, switch_ticks);
+  if (sequence != 0)
+    next.us = std::max(next.us, Convert(current, switch_ticks));
+  next.ticks = switch_ticks;
+  next.recalibration_ticks =
+      switch_ticks + static_cast<uint64_t>(kRecalibrationIntervalMicroseconds /
+                                           us_per_tick);
+
+  subtle::NoBarrier_Store(&g_sequence, sequence + 1);
+  CompilerBarrier();
+  g_conversion = next;
+  subtle::Release_Store(&g_sequence, sequence + 2);
+}
+
+}  // namespace
+
+// static
+TimeTicks TimeTicks::NowFromTimeStampCounter() {
+  if (subtle::NoBarrier_Load(&g_counter_support) == COUNTER_UNSUPPORTED)
+    return Now();
+
+  for (;;) {
+    const subtle::Atomic32 sequence = subtle::Acquire_Load(&g_sequence);
+    if (sequence == 0) {
+      // Not calibrated yet.
+      Calibrate();
+      return Now();
+    }
+    // Once calibrated, Now() can be behind the values already returned, so
+    // the read is retried while g_conversion is written, which is quick.
+    if (sequence & 1)
+      continue;
+    const Conversion conversion = g_conversion;
+    CompilerBarrier();
+    if (subtle::NoBarrier_Load(&g_sequence) != sequence)
+      continue;
+    const uint64_t ticks = ReadTimeStampCounter();
+    if (ticks >= conversion.recalibration_ticks)
+      Calibrate();
+    return TimeTicks(Convert(conversion, ticks));
+  }
+}
+
+// static
+bool TimeTicks::IsTimeStampCounterCalibrated() {
+  return subtle::Acquire_Load(&g_sequence) != 0;
+}
+
+#else
+
+// static
+TimeTicks TimeTicks::NowFromTimeStampCounter() {
+  return Now();
+}
+
+// static
+bool TimeTicks::IsTimeStampCounterCalibrated() {
+  return false;
+}
+
+#endif
+
+}  // namespace base
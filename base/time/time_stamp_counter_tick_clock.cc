@@ -0,0 +1,15 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/time/time_stamp_counter_tick_clock.h"
+
+namespace base {
+
+TimeStampCounterTickClock::~TimeStampCounterTickClock() {}
+
+TimeTicks TimeStampCounterTickClock::NowTicks() {
+  return TimeTicks::NowFromTimeStampCounter();
+}
+
+}  // namespace base
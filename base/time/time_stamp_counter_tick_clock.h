@@ -0,0 +1,24 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TIME_TIME_STAMP_COUNTER_TICK_CLOCK_H_
+#define BASE_TIME_TIME_STAMP_COUNTER_TICK_CLOCK_H_
+
+#include "base/base_export.h"
+#include "base/compiler_specific.h"
+#include "base/time/tick_clock.h"
+
+namespace base {
+
+class BASE_EXPORT TimeStampCounterTickClock : public TickClock {
+ public:
+  ~TimeStampCounterTickClock() override;
+
+  // Simply returns TimeTicks::NowFromTimeStampCounter().
+  TimeTicks NowTicks() override;
+};
+
+}  // namespace base
+
+#endif  // BASE_TIME_TIME_STAMP_COUNTER_TICK_CLOCK_H_
@@ -12,8 +12,10 @@
 #include "base/compiler_specific.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/strings/stringprintf.h"
 #include "base/threading/platform_thread.h"
+#include "base/time/time_stamp_counter_tick_clock.h"
 #include "build/build_config.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -638,6 +640,94 @@ TEST(TimeTicks, HighRes) {
   HighResClockTest(&TimeTicks::Now);
 }
 
+// Returns false if NowFromTimeStampCounter() does not read the counter after a
+// while, as on CPUs without an invariant counter.
+static bool WaitForTimeStampCounterCalibration() {
+  const TimeTicks deadline = TimeTicks::Now() + TimeDelta::FromSeconds(1);
+  while (!TimeTicks::IsTimeStampCounterCalibrated() &&
+         TimeTicks::Now() < deadline) {
+    TimeTicks::NowFromTimeStampCounter();
+    PlatformThread::Sleep(TimeDelta::FromMilliseconds(1));
+  }
+  return TimeTicks::IsTimeStampCounterCalibrated();
+}
+
+TEST(TimeTicks, NowFromTimeStampCounterHighRes) {
+  WaitForTimeStampCounterCalibration();
+  HighResClockTest(&TimeTicks::NowFromTimeStampCounter);
+}
+
+TEST(TimeTicks, NowFromTimeStampCounterTracksNow) {
+  if (!WaitForTimeStampCounterCalibration())
+    return;
+
+  // Over several recalibrations of the counter, its values stay between the
+  // values of Now() read around them, give or take the error of the
+  // conversion, and never decrease.
+  const TimeDelta kMaxError = TimeDelta::FromMicroseconds(100);
+  TimeStampCounterTickClock clock;
+  TimeTicks last_ticks;
+  const TimeTicks end = TimeTicks::Now() + TimeDelta::FromMilliseconds(500);
+  while (TimeTicks::Now() < end) {
+    const TimeTicks before = TimeTicks::Now();
+    const TimeTicks ticks = clock.NowTicks();
+    const TimeTicks after = TimeTicks::Now();
+    ASSERT_GE(ticks, before - kMaxError);
+    ASSERT_LE(ticks, after + kMaxError);
+    ASSERT_GE(ticks, last_ticks);
+    last_ticks = ticks;
+    PlatformThread::Sleep(TimeDelta::FromMilliseconds(1));
+  }
+}
+
+namespace {
+
+// Reads NowFromTimeStampCounter() in a loop until |end|, and counts the times
+// it decreased.
+class TimeStampCounterReader : public PlatformThread::Delegate {
+ public:
+  explicit TimeStampCounterReader(TimeTicks end)
+      : end_(end), num_decreases_(0) {}
+
+  void ThreadMain() override {
+    TimeTicks last_ticks;
+    for (;;) {
+      const TimeTicks ticks = TimeTicks::NowFromTimeStampCounter();
+      if (ticks < last_ticks)
+        num_decreases_++;
+      if (ticks >= end_)
+        break;
+      last_ticks = ticks;
+    }
+  }
+
+  int num_decreases() const { return num_decreases_; }
+
+ private:
+  const TimeTicks end_;
+  int num_decreases_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimeStampCounterReader);
+};
+
+}  // namespace
+
+TEST(TimeTicks, NowFromTimeStampCounterMonotonicAcrossThreads) {
+  // The readers race with the recalibrations, which each of them may make.
+  const TimeTicks end = TimeTicks::Now() + TimeDelta::FromMilliseconds(300);
+  const int kNumThreads = 4;
+  scoped_ptr<TimeStampCounterReader> readers[kNumThreads];
+  PlatformThreadHandle handles[kNumThreads];
+  for (int i = 0; i < kNumThreads; i++) {
+    readers[i].reset(new TimeStampCounterReader(end));
+    ASSERT_TRUE(PlatformThread::Create(0, readers[i].get(), &handles[i]));
+  }
+  for (int i = 0; i < kNumThreads; i++) {
+    PlatformThread::Join(handles[i]);
+    EXPECT_EQ(0, readers[i]->num_decreases());
+  }
+}
+
 // Fails frequently on Android http://crbug.com/352633 with:
 // Expected: (delta_thread.InMicroseconds()) > (0), actual: 0 vs 0
 #if defined(OS_ANDROID)
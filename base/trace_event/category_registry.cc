@@ -0,0 +1,193 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/category_registry.h"
+
+#include <string.h>
+
+#include "base/atomicops.h"
+#include "base/bits.h"
+#include "base/hash.h"
+#include "base/logging.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+// Constant-initialized, in the order of the CategoryRegistry::kCategory*
+// pointers.
+TraceCategory g_builtin_categories[] = {
+    {0, "toplevel"},
+    {0, "tracing already shutdown"},
+    {0, "__metadata"}};
+
+static_assert(arraysize(g_builtin_categories) ==
+                  CategoryRegistry::kNumBuiltinCategories,
+              "kNumBuiltinCategories must match g_builtin_categories");
+
+// The added categories are kept in chunks, the first one of
+// kFirstChunkCategories and each one after twice as large as the previous.
+const size_t kFirstChunkCategories = 64;
+const size_t kMaxChunks = 24;
+subtle::AtomicWord g_chunks[kMaxChunks];
+
+// The number of categories, built-in ones included.
+subtle::AtomicWord g_category_count = CategoryRegistry::kNumBuiltinCategories;
+
+// An open addressing hash table of all the categories, which is never more
+// than half full. It is replaced by one twice as large when it fills up. The
+// replaced tables are leaked, as lookups may still be using them; they are
+// smaller than the current one put together.
+struct CategoryIndex {
+  explicit CategoryIndex(size_t capacity)
+      : mask(capacity - 1), slots(new subtle::AtomicWord[capacity]()) {}
+
+  const size_t mask;
+  subtle::AtomicWord* const slots;
+};
+
+const size_t kInitialIndexCapacity = 256;
+subtle::AtomicWord g_index;
+
+size_t HashCategoryName(const char* name) {
+  return Hash32(name, strlen(name), 0);
+}
+
+// Adds |category| to |index|, which must have room for it.
+void InsertIntoIndex(CategoryIndex* index, TraceCategory* category) {
+  size_t slot = HashCategoryName(category->name) & index->mask;
+  while (subtle::NoBarrier_Load(&index->slots[slot]))
+    slot = (slot + 1) & index->mask;
+  subtle::Release_Store(&index->slots[slot],
+                        reinterpret_cast<subtle::AtomicWord>(category));
+}
+
+// Returns the chunk and the position in it of the added category |index|.
+void GetChunkAndOffset(size_t index, size_t* chunk, size_t* offset) {
+  const size_t added_index = index - CategoryRegistry::kNumBuiltinCategories;
+  *chunk = bits::Log2Floor(
+      static_cast<uint32_t>(added_index / kFirstChunkCategories + 1));
+  *offset = added_index - kFirstChunkCategories * ((1u << *chunk) - 1);
+}
+
+}  // namespace
+
+// static
+TraceCategory* const CategoryRegistry::kCategoryToplevel =
+    &g_builtin_categories[0];
+TraceCategory* const CategoryRegistry::kCategoryAlreadyShutdown =
+    &g_builtin_categories[1];
+TraceCategory* const CategoryRegistry::kCategoryMetadata =
+    &g_builtin_categories[2];
+const size_t CategoryRegistry::kNumBuiltinCategories;
+
+// static
+TraceCategory* CategoryRegistry::GetCategoryByName(const char* category_group) {
+  const CategoryIndex* index =
+      reinterpret_cast<const CategoryIndex*>(subtle::Acquire_Load(&g_index));
+  if (!index) {
+    // Nothing was added yet.
+    for (TraceCategory& category : g_builtin_categories) {
+      if (strcmp(category.name, category_group) == 0)
+        return &category;
+    }
+    return NULL;
+  }
+
+  for (size_t slot = HashCategoryName(category_group) & index->mask;;
+       slot = (slot + 1) & index->mask) {
+    TraceCategory* category = reinterpret_cast<TraceCategory*>(
+        subtle::Acquire_Load(&index->slots[slot]));
+    if (!category)
+      return NULL;
+    if (strcmp(category->name, category_group) == 0)
+      return category;
+  }
+}
+
+// static
+TraceCategory* CategoryRegistry::AddCategoryLocked(const char* category_group,
+                                                   unsigned char enabled) {
+  DCHECK(!GetCategoryByName(category_group));
+  const size_t count = subtle::NoBarrier_Load(&g_category_count);
+
+  size_t chunk;
+  size_t offset;
+  GetChunkAndOffset(count, &chunk, &offset);
+  CHECK_LT(chunk, kMaxChunks);
+  TraceCategory* categories = reinterpret_cast<TraceCategory*>(
+      subtle::NoBarrier_Load(&g_chunks[chunk]));
+  if (!categories) {
+    categories = new TraceCategory[kFirstChunkCategories << chunk];
+    subtle::Release_Store(&g_chunks[chunk],
+                          reinterpret_cast<subtle::AtomicWord>(categories));
+  }
+
+  // Don't hold on to the category_group pointer, so that we can create
+  // category groups with strings not known at compile time (this is
+  // required by SetWatchEvent).
+  TraceCategory* category = &categories[offset];
+  category->enabled = enabled;
+  category->name = strdup(category_group);
+
+  CategoryIndex* index =
+      reinterpret_cast<CategoryIndex*>(subtle::NoBarrier_Load(&g_index));
+  if (!index || (count + 1) * 2 > index->mask + 1) {
+    index = new CategoryIndex(index ? (index->mask + 1) * 2
+                                    : kInitialIndexCapacity);
+    for (size_t i = 0; i < count; ++i)
+      InsertIntoIndex(index, GetCategoryAt(i));
+    InsertIntoIndex(index, category);
+    subtle::Release_Store(&g_index,
+                          reinterpret_cast<subtle::AtomicWord>(index));
+  } else {
+    InsertIntoIndex(index, category);
+  }
+
+  subtle::Release_Store(&g_category_count, count + 1);
+  return category;
+}
+
+// static
+size_t CategoryRegistry::GetCategoryCount() {
+  return subtle::Acquire_Load(&g_category_count);
+}
+
+// static
+TraceCategory* CategoryRegistry::GetCategoryAt(size_t index) {
+  if (index < kNumBuiltinCategories)
+    return &g_builtin_categories[index];
+  size_t chunk;
+  size_t offset;
+  GetChunkAndOffset(index, &chunk, &offset);
+  return &reinterpret_cast<TraceCategory*>(
+      subtle::Acquire_Load(&g_chunks[chunk]))[offset];
+}
+
+// static
+bool CategoryRegistry::IsValidCategory(const TraceCategory* category) {
+  if (category >= g_builtin_categories &&
+      category < g_builtin_categories + kNumBuiltinCategories) {
+    return true;
+  }
+  const size_t count = GetCategoryCount();
+  if (count == kNumBuiltinCategories)
+    return false;
+  size_t last_chunk;
+  size_t last_offset;
+  GetChunkAndOffset(count - 1, &last_chunk, &last_offset);
+  for (size_t chunk = 0; chunk <= last_chunk; ++chunk) {
+    const TraceCategory* categories = reinterpret_cast<const TraceCategory*>(
+        subtle::Acquire_Load(&g_chunks[chunk]));
+    const size_t size =
+        chunk == last_chunk ? last_offset + 1 : kFirstChunkCategories << chunk;
+    if (category >= categories && category < categories + size)
+      return true;
+  }
+  return false;
+}
+
+}  // namespace trace_event
+}  // namespace base
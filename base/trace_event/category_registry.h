@@ -0,0 +1,70 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TRACE_EVENT_CATEGORY_REGISTRY_H_
+#define BASE_TRACE_EVENT_CATEGORY_REGISTRY_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/macros.h"
+
+namespace base {
+namespace trace_event {
+
+// A category group, and whether it is enabled. The enabled flags come first,
+// so that the pointer to them which the TRACE_EVENT macros keep is also a
+// pointer to the category.
+struct TraceCategory {
+  static const TraceCategory* FromEnabledFlags(const unsigned char* enabled) {
+    return reinterpret_cast<const TraceCategory*>(enabled);
+  }
+
+  // The TraceLog::CategoryGroupEnabledFlags of the category group. These are
+  // char instead of bool so that the API can be used from C.
+  unsigned char enabled;
+  const char* name;
+};
+
+// Keeps all the category groups ever used, for the lifetime of the process.
+//
+// The built-in categories are a constant-initialized table, so they exist
+// before any code runs and have fixed indices. The others are added as they
+// are first used, with no limit on their number, in chunks which are never
+// moved, so that the TRACE_EVENT macros can keep pointers to them. Looking up
+// a category by name takes no lock and is a single hash table lookup.
+class BASE_EXPORT CategoryRegistry {
+ public:
+  // The built-in categories, which GetCategoryAt() returns first.
+  static TraceCategory* const kCategoryToplevel;
+  static TraceCategory* const kCategoryAlreadyShutdown;
+  static TraceCategory* const kCategoryMetadata;
+  static const size_t kNumBuiltinCategories = 3;
+
+  // Returns the category group |category_group|, or NULL if it was never
+  // added.
+  static TraceCategory* GetCategoryByName(const char* category_group);
+
+  // Adds the category group |category_group|, which is copied, with the
+  // |enabled| flags, and returns it. It must not have been added already.
+  // Calls to this must be serialized by the caller.
+  static TraceCategory* AddCategoryLocked(const char* category_group,
+                                          unsigned char enabled);
+
+  // The number of categories, and the one at |index|, which must be less.
+  // The categories added before a call to GetCategoryCount() are all seen.
+  static size_t GetCategoryCount();
+  static TraceCategory* GetCategoryAt(size_t index);
+
+  // Returns true if |category| is one of the categories, for DCHECKs.
+  static bool IsValidCategory(const TraceCategory* category);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(CategoryRegistry);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BASE_TRACE_EVENT_CATEGORY_REGISTRY_H_
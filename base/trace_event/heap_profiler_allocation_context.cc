@@ -45,9 +45,7 @@ using base::trace_event::AllocationContext;
 using base::trace_event::Backtrace;
 
 size_t hash<Backtrace>::operator()(const Backtrace& backtrace) const {
-  return base::Hash(
-    std::string(reinterpret_cast<const char*>(backtrace.frames),
-                sizeof(backtrace.frames)));
+  return base::Hash32(backtrace.frames, sizeof(backtrace.frames), 0);
 }
 
 size_t hash<AllocationContext>::operator()(const AllocationContext& ctx) const {
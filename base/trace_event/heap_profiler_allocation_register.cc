@@ -0,0 +1,197 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/heap_profiler_allocation_register.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "base/trace_event/trace_event_memory_overhead.h"
+
+namespace base {
+namespace trace_event {
+
+AllocationRegister::AllocationRegister()
+    : AllocationRegister(kDefaultNumCells) {}
+
+AllocationRegister::AllocationRegister(uint32_t num_cells)
+    // Reserve enough address space to store |num_cells| entries if
+    // necessary, with a guard page after it to catch overruns. Cell 0 is the
+    // list terminator, so it is not counted.
+    : num_cells_(num_cells + 1),
+      cells_(static_cast<Cell*>(
+          AllocateVirtualMemory(num_cells_ * sizeof(Cell)))),
+      buckets_(static_cast<CellIndex*>(
+          AllocateVirtualMemory(kNumBuckets * sizeof(CellIndex)))),
+
+      // The free list is empty. The first unused cell is cell 1, because index
+      // 0 is used as list terminator.
+      free_list_(0),
+      next_unused_cell_(1),
+      num_allocations_(0),
+      num_dropped_(0) {
+  DCHECK_GT(num_cells, 0u);
+}
+
+AllocationRegister::~AllocationRegister() {
+  FreeVirtualMemory(buckets_, kNumBuckets * sizeof(CellIndex));
+  FreeVirtualMemory(cells_, num_cells_ * sizeof(Cell));
+}
+
+bool AllocationRegister::Insert(void* address,
+                                size_t size,
+                                AllocationContext context) {
+  DCHECK(address != nullptr);
+
+  CellIndex* idx_ptr = Lookup(address);
+
+  // If the index is 0, the address is not yet present, so insert it.
+  if (*idx_ptr == 0) {
+    CellIndex idx = GetFreeCell();
+    if (idx == 0) {
+      num_dropped_++;
+      return false;
+    }
+    *idx_ptr = idx;
+    cells_[idx].next = 0;
+    cells_[idx].allocation.address = address;
+    num_allocations_++;
+  }
+
+  Allocation& allocation = cells_[*idx_ptr].allocation;
+  allocation.size = size;
+  allocation.context = context;
+  return true;
+}
+
+bool AllocationRegister::Remove(void* address) {
+  // Get a pointer to the index of the cell that stores |address|. The index
+  // can be an element of |buckets_| or the |next| member of a cell.
+  CellIndex* idx_ptr = Lookup(address);
+  CellIndex freed_idx = *idx_ptr;
+
+  // If the index is 0, the address was not there in the first place.
+  if (freed_idx == 0)
+    return false;
+
+  // The cell at the index is now free, remove it from the linked list for
+  // |Hash(address)|.
+  Cell* freed_cell = &cells_[freed_idx];
+  *idx_ptr = freed_cell->next;
+
+  // Put the free cell at the front of the free list.
+  freed_cell->next = free_list_;
+  free_list_ = freed_idx;
+
+  // Reset the address, so that on iteration the free cell is ignored.
+  freed_cell->allocation.address = nullptr;
+  num_allocations_--;
+  return true;
+}
+
+void AllocationRegister::Clear() {
+  if (next_unused_cell_ == 1)
+    return;
+  // Cells are initialized when they are taken, and iteration stops at
+  // |next_unused_cell_|, so only the buckets need to be reset.
+  memset(buckets_, 0, kNumBuckets * sizeof(CellIndex));
+  free_list_ = 0;
+  next_unused_cell_ = 1;
+  num_allocations_ = 0;
+}
+
+AllocationRegister::ConstIterator AllocationRegister::begin() const {
+  // Initialize the iterator's index to 0. Cell 0 never stores an entry.
+  ConstIterator iterator(*this, 0);
+  // Incrementing will advance the iterator to the first used cell.
+  ++iterator;
+  return iterator;
+}
+
+AllocationRegister::ConstIterator AllocationRegister::end() const {
+  // Cell |next_unused_cell_ - 1| is the last cell that could contain an entry,
+  // so index |next_unused_cell_| is an iterator past the last element, in line
+  // with the STL iterator conventions.
+  return ConstIterator(*this, next_unused_cell_);
+}
+
+AllocationRegister::ConstIterator::ConstIterator(
+    const AllocationRegister& alloc_register,
+    CellIndex index)
+    : register_(alloc_register), index_(index) {}
+
+void AllocationRegister::ConstIterator::operator++() {
+  // Find the next cell with a non-null address until all cells that could
+  // possibly be used have been iterated. A null address indicates a free cell.
+  do {
+    index_++;
+  } while (index_ < register_.next_unused_cell_ &&
+           register_.cells_[index_].allocation.address == nullptr);
+}
+
+bool AllocationRegister::ConstIterator::operator!=(
+    const ConstIterator& other) const {
+  return index_ != other.index_;
+}
+
+const AllocationRegister::Allocation& AllocationRegister::ConstIterator::
+operator*() const {
+  return register_.cells_[index_].allocation;
+}
+
+void AllocationRegister::EstimateTraceMemoryOverhead(
+    TraceEventMemoryOverhead* overhead) const {
+  // Estimate memory overhead by counting all of the cells that have ever been
+  // touched. Don't report mmapped memory as allocated, because it has not been
+  // allocated by malloc.
+  size_t allocated = sizeof(AllocationRegister);
+  size_t resident = sizeof(AllocationRegister)
+                    // Include size of touched cells (size of |*cells_|).
+                    + sizeof(Cell) * next_unused_cell_
+                    // Size of |*buckets_|.
+                    + sizeof(CellIndex) * kNumBuckets;
+  overhead->Add("AllocationRegister", allocated, resident);
+}
+
+// static
+uint32_t AllocationRegister::Hash(void* address) {
+  // The multiplicative hashing scheme from [Knuth 1998]. |a| is the first
+  // prime after 2^17; shifting out the low bits discards the alignment bits
+  // that every heap address shares.
+  const uintptr_t key = reinterpret_cast<uintptr_t>(address);
+  const uintptr_t a = 131101;
+  const uintptr_t shift = 15;
+  const uintptr_t h = (key * a) >> shift;
+  return static_cast<uint32_t>(h) & kNumBucketsMask;
+}
+
+AllocationRegister::CellIndex* AllocationRegister::Lookup(void* address) {
+  // The list head is in |buckets_| at the hash offset.
+  CellIndex* idx_ptr = &buckets_[Hash(address)];
+
+  // Chase down the list until the cell that holds |address| is found,
+  // or until the list ends.
+  while (*idx_ptr != 0 && cells_[*idx_ptr].allocation.address != address)
+    idx_ptr = &cells_[*idx_ptr].next;
+
+  return idx_ptr;
+}
+
+AllocationRegister::CellIndex AllocationRegister::GetFreeCell() {
+  // First try to re-use a cell from the freelist.
+  if (free_list_) {
+    CellIndex idx = free_list_;
+    free_list_ = cells_[idx].next;
+    return idx;
+  }
+
+  // Otherwise pick the next cell that has not been touched before, unless the
+  // table is full.
+  if (next_unused_cell_ == num_cells_)
+    return 0;
+  return next_unused_cell_++;
+}
+
+}  // namespace trace_event
+}  // namespace base
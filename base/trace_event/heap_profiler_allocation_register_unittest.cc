@@ -0,0 +1,233 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/heap_profiler_allocation_register.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/trace_event/heap_profiler_allocation_context.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace trace_event {
+
+class AllocationRegisterTest : public testing::Test {
+ public:
+  static uint32_t GetHighWaterMark(const AllocationRegister& reg) {
+    return reg.next_unused_cell_;
+  }
+};
+
+namespace {
+
+// Iterates over all entries in the allocation register and returns the bitwise
+// or of all addresses stored in it.
+uintptr_t OrAllAddresses(const AllocationRegister& reg) {
+  uintptr_t acc = 0;
+
+  for (const AllocationRegister::Allocation& alloc : reg)
+    acc |= reinterpret_cast<uintptr_t>(alloc.address);
+
+  return acc;
+}
+
+// Iterates over all entries in the allocation register and returns the sum of
+// the sizes of the entries.
+size_t SumAllSizes(const AllocationRegister& reg) {
+  size_t sum = 0;
+
+  for (const AllocationRegister::Allocation& alloc : reg)
+    sum += alloc.size;
+
+  return sum;
+}
+
+void* AddressAt(uintptr_t address) {
+  return reinterpret_cast<void*>(address);
+}
+
+}  // namespace
+
+TEST_F(AllocationRegisterTest, InsertRemove) {
+  AllocationRegister reg;
+  AllocationContext ctx = AllocationContext::Empty();
+
+  // Zero-sized allocations should be tracked too.
+  EXPECT_EQ(0u, OrAllAddresses(reg));
+
+  EXPECT_TRUE(reg.Insert(AddressAt(1), 0, ctx));
+  EXPECT_EQ(1u, OrAllAddresses(reg));
+
+  reg.Insert(AddressAt(2), 0, ctx);
+  EXPECT_EQ(3u, OrAllAddresses(reg));
+
+  reg.Insert(AddressAt(4), 0, ctx);
+  EXPECT_EQ(7u, OrAllAddresses(reg));
+  EXPECT_EQ(3u, reg.size());
+
+  EXPECT_TRUE(reg.Remove(AddressAt(2)));
+  EXPECT_EQ(5u, OrAllAddresses(reg));
+
+  EXPECT_TRUE(reg.Remove(AddressAt(4)));
+  EXPECT_EQ(1u, OrAllAddresses(reg));
+
+  EXPECT_TRUE(reg.Remove(AddressAt(1)));
+  EXPECT_EQ(0u, OrAllAddresses(reg));
+  EXPECT_EQ(0u, reg.size());
+}
+
+TEST_F(AllocationRegisterTest, DoubleFreeIsAllowed) {
+  AllocationRegister reg;
+  AllocationContext ctx = AllocationContext::Empty();
+
+  reg.Insert(AddressAt(1), 0, ctx);
+  reg.Insert(AddressAt(2), 0, ctx);
+  EXPECT_TRUE(reg.Remove(AddressAt(1)));
+  EXPECT_FALSE(reg.Remove(AddressAt(1)));  // Remove for the second time.
+  EXPECT_FALSE(reg.Remove(AddressAt(4)));  // Remove never inserted address.
+  EXPECT_FALSE(reg.Remove(nullptr));
+  EXPECT_EQ(2u, OrAllAddresses(reg));
+}
+
+TEST_F(AllocationRegisterTest, DoubleInsertOverwrites) {
+  AllocationRegister reg;
+  AllocationContext ctx = AllocationContext::Empty();
+  StackFrame frame1 = "Foo";
+  StackFrame frame2 = "Bar";
+
+  ctx.backtrace.frames[0] = frame1;
+  reg.Insert(AddressAt(1), 11, ctx);
+
+  {
+    AllocationRegister::Allocation elem = *reg.begin();
+    EXPECT_EQ(frame1, elem.context.backtrace.frames[0]);
+    EXPECT_EQ(11u, elem.size);
+    EXPECT_EQ(AddressAt(1), elem.address);
+  }
+
+  ctx.backtrace.frames[0] = frame2;
+  reg.Insert(AddressAt(1), 13, ctx);
+
+  {
+    AllocationRegister::Allocation elem = *reg.begin();
+    EXPECT_EQ(frame2, elem.context.backtrace.frames[0]);
+    EXPECT_EQ(13u, elem.size);
+    EXPECT_EQ(AddressAt(1), elem.address);
+  }
+  EXPECT_EQ(1u, reg.size());
+}
+
+// Check that even if more entries than the number of buckets are inserted, the
+// register still behaves correctly.
+TEST_F(AllocationRegisterTest, InsertRemoveCollisions) {
+  size_t expected_sum = 0;
+  AllocationRegister reg;
+  AllocationContext ctx = AllocationContext::Empty();
+
+  // By inserting 100 more entries than the number of buckets, there will be at
+  // least 100 collisions.
+  for (uintptr_t i = 1; i <= 0x10000 + 100; i++) {
+    size_t size = i % 31;
+    expected_sum += size;
+    reg.Insert(AddressAt(i * 16), size, ctx);
+
+    // Don't check the sum on every iteration to keep the test fast.
+    if (i % (1 << 14) == 0)
+      EXPECT_EQ(expected_sum, SumAllSizes(reg));
+  }
+
+  EXPECT_EQ(expected_sum, SumAllSizes(reg));
+
+  for (uintptr_t i = 1; i <= 0x10000 + 100; i++) {
+    size_t size = i % 31;
+    expected_sum -= size;
+    reg.Remove(AddressAt(i * 16));
+
+    if (i % (1 << 14) == 0)
+      EXPECT_EQ(expected_sum, SumAllSizes(reg));
+  }
+
+  EXPECT_EQ(expected_sum, SumAllSizes(reg));
+  EXPECT_EQ(0u, reg.size());
+}
+
+// Removing cells puts them on the free list, inserting reuses them. Check that
+// iteration skips the free cells.
+TEST_F(AllocationRegisterTest, InsertRemoveRandomOrder) {
+  size_t expected_sum = 0;
+  AllocationRegister reg;
+  AllocationContext ctx = AllocationContext::Empty();
+
+  uintptr_t generator = 3;
+  uintptr_t prime = 1013;
+  uint32_t initial_water_mark = GetHighWaterMark(reg);
+
+  for (uintptr_t i = 2; i < prime; i++) {
+    size_t size = i % 31 + 1;
+    expected_sum += size;
+    reg.Insert(AddressAt(i), size, ctx);
+  }
+
+  // This should have used a fresh slot for each of the |prime - 2| inserts.
+  ASSERT_EQ(prime - 2, GetHighWaterMark(reg) - initial_water_mark);
+
+  // Iterate the numbers 2, 3, ..., prime - 1 in pseudorandom order.
+  for (uintptr_t i = generator; i != 1; i = (i * generator) % prime) {
+    size_t size = i % 31 + 1;
+    expected_sum -= size;
+    reg.Remove(AddressAt(i));
+    EXPECT_EQ(expected_sum, SumAllSizes(reg));
+  }
+
+  ASSERT_EQ(0u, expected_sum);
+
+  // Insert |prime - 2| entries again. This should use cells from the free list,
+  // so the |next_unused_cell_| index should not change.
+  for (uintptr_t i = 2; i < prime; i++)
+    reg.Insert(AddressAt(i), 0, ctx);
+
+  ASSERT_EQ(prime - 2, GetHighWaterMark(reg) - initial_water_mark);
+
+  // Inserting one more entry should use a fresh cell again.
+  reg.Insert(AddressAt(prime), 0, ctx);
+  ASSERT_EQ(prime - 1, GetHighWaterMark(reg) - initial_water_mark);
+}
+
+TEST_F(AllocationRegisterTest, DropsInsertsWhenFull) {
+  AllocationRegister reg(4);
+  AllocationContext ctx = AllocationContext::Empty();
+
+  for (uintptr_t i = 1; i <= 4; i++)
+    EXPECT_TRUE(reg.Insert(AddressAt(i), 1, ctx));
+  EXPECT_FALSE(reg.Insert(AddressAt(5), 1, ctx));
+  EXPECT_EQ(4u, reg.size());
+  EXPECT_EQ(1u, reg.num_dropped());
+
+  // Existing entries can still be updated, and freed cells reused.
+  EXPECT_TRUE(reg.Insert(AddressAt(1), 2, ctx));
+  EXPECT_TRUE(reg.Remove(AddressAt(2)));
+  EXPECT_TRUE(reg.Insert(AddressAt(5), 1, ctx));
+  EXPECT_EQ(5u, SumAllSizes(reg));
+  EXPECT_EQ(1u, reg.num_dropped());
+}
+
+TEST_F(AllocationRegisterTest, Clear) {
+  AllocationRegister reg;
+  AllocationContext ctx = AllocationContext::Empty();
+
+  for (uintptr_t i = 1; i <= 100; i++)
+    reg.Insert(AddressAt(i), 1, ctx);
+  reg.Clear();
+  EXPECT_EQ(0u, reg.size());
+  EXPECT_EQ(0u, OrAllAddresses(reg));
+  EXPECT_FALSE(reg.Remove(AddressAt(1)));
+
+  reg.Insert(AddressAt(8), 3, ctx);
+  EXPECT_EQ(8u, OrAllAddresses(reg));
+  EXPECT_EQ(3u, SumAllSizes(reg));
+}
+
+}  // namespace trace_event
+}  // namespace base
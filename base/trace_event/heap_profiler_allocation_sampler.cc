@@ -0,0 +1,351 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/heap_profiler_allocation_sampler.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/allocator/allocator_shim.h"
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/rand_util.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread_local_storage.h"
+#include "base/trace_event/heap_profiler_allocation_context.h"
+#include "base/trace_event/heap_profiler_allocation_context_tracker.h"
+#include "base/trace_event/heap_profiler_allocation_register.h"
+#include "base/trace_event/heap_profiler_heap_dump_writer.h"
+#include "build/build_config.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+// The number of counters in the free filter. A power of two.
+const size_t kFreeFilterSize = 1 << 16;
+const size_t kFreeFilterBitsPerWord = 32;
+
+// Per-thread sampling state. The state is allocated with new on the first
+// allocation a thread makes, which reenters the sampler; the TLS slot holds
+// |kThreadStateInitializing| meanwhile, so that the nested call bails out.
+struct ThreadState {
+  // The number of bytes the thread can allocate before the next sample.
+  int64_t bytes_until_sample;
+
+  // The state of the xorshift64* generator used to draw sampling intervals.
+  uint64_t random_state;
+
+  // Set while the thread is inside the sampler, so that allocations made by
+  // the sampler itself (e.g. by the allocation context tracker) are ignored.
+  bool in_sampler;
+};
+
+void* const kThreadStateInitializing = reinterpret_cast<void*>(1);
+
+// The mean sampling interval in bytes, or 0 when the sampler is stopped.
+// Only changes with |g_lock| held.
+subtle::AtomicWord g_mean_sampling_interval = 0;
+
+// A counting filter over the sampled addresses: the counter for the hash of
+// an address is the number of sampled allocations with that hash. Nearly all
+// freed addresses were not sampled, and for those the free hook gets away
+// with reading a single bit instead of taking |g_lock|: the bit of a counter
+// is set while the counter is not zero. The bits take 8 KiB, which stays in
+// the cache, unlike the counters. Both are only modified with |g_lock| held.
+uint32_t g_free_filter_counts[kFreeFilterSize];
+subtle::Atomic32 g_free_filter_bits[kFreeFilterSize / kFreeFilterBitsPerWord];
+
+LazyInstance<Lock>::Leaky g_lock = LAZY_INSTANCE_INITIALIZER;
+
+// The sampled allocations which have not been freed yet. Allocated on the
+// first start and never deleted, as the hooks can run concurrently with stop.
+AllocationRegister* g_register = nullptr;
+
+ThreadLocalStorage::StaticSlot g_tls_thread_state = TLS_INITIALIZER;
+
+#if defined(COMPILER_GCC)
+// A copy of the |g_tls_thread_state| of the thread, once it is created. The
+// ThreadLocalStorage lookup costs about as much as the rest of the hooks put
+// together, while this is a single load. The initial-exec model makes sure
+// that accessing it never allocates, which the default model may do in a
+// dlopen()ed library.
+__thread ThreadState* g_cached_thread_state
+    __attribute__((tls_model("initial-exec"))) = nullptr;
+#endif
+
+ThreadState* GetCachedThreadState() {
+#if defined(COMPILER_GCC)
+  return g_cached_thread_state;
+#else
+  return nullptr;
+#endif
+}
+
+void SetCachedThreadState(ThreadState* state) {
+#if defined(COMPILER_GCC)
+  g_cached_thread_state = state;
+#endif
+}
+
+// Runs on the exiting thread, which may still allocate afterwards.
+void DestructThreadState(void* thread_state) {
+  if (thread_state == kThreadStateInitializing)
+    return;
+  SetCachedThreadState(nullptr);
+  delete static_cast<ThreadState*>(thread_state);
+}
+
+size_t GetFreeFilterIndex(void* address) {
+  // Heap addresses are at least 8-byte aligned, so the low bits carry no
+  // information. Fibonacci hashing spreads the rest over the filter.
+  uint32_t key = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(address) >>
+                                       3);
+  return (key * 2654435769u) >> 16;
+}
+
+subtle::Atomic32* GetFreeFilterWord(size_t index) {
+  return &g_free_filter_bits[index / kFreeFilterBitsPerWord];
+}
+
+subtle::Atomic32 GetFreeFilterBit(size_t index) {
+  return static_cast<subtle::Atomic32>(1u << (index % kFreeFilterBitsPerWord));
+}
+
+// Counts a sampled allocation in the free filter. Requires |g_lock|.
+void AddToFreeFilter(size_t index) {
+  if (g_free_filter_counts[index]++ == 0) {
+    subtle::Atomic32* word = GetFreeFilterWord(index);
+    subtle::NoBarrier_Store(
+        word, subtle::NoBarrier_Load(word) | GetFreeFilterBit(index));
+  }
+}
+
+// Uncounts a freed sample from the free filter. Requires |g_lock|.
+void RemoveFromFreeFilter(size_t index) {
+  if (--g_free_filter_counts[index] == 0) {
+    subtle::Atomic32* word = GetFreeFilterWord(index);
+    subtle::NoBarrier_Store(
+        word, subtle::NoBarrier_Load(word) & ~GetFreeFilterBit(index));
+  }
+}
+
+uint64_t NextRandom(uint64_t* state) {
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * UINT64_C(2685821657736338717);
+}
+
+// Draws the number of bytes until the next sample from an exponential
+// distribution with mean |mean_sampling_interval|.
+int64_t NextSamplingInterval(ThreadState* state,
+                             size_t mean_sampling_interval) {
+  // Uniformly distributed in (0, 1], so that the logarithm is finite.
+  double uniform = static_cast<double>(
+                       (NextRandom(&state->random_state) >> 11) + 1) /
+                   static_cast<double>(UINT64_C(1) << 53);
+  return static_cast<int64_t>(-log(uniform) * mean_sampling_interval) + 1;
+}
+
+// Returns the state of the current thread, or null if the thread is creating
+// its state right now.
+ThreadState* GetThreadState(size_t mean_sampling_interval) {
+  ThreadState* cached_state = GetCachedThreadState();
+  if (cached_state)
+    return cached_state;
+
+  void* value = g_tls_thread_state.Get();
+  if (value == kThreadStateInitializing)
+    return nullptr;
+  if (value) {
+    SetCachedThreadState(static_cast<ThreadState*>(value));
+    return static_cast<ThreadState*>(value);
+  }
+
+  g_tls_thread_state.Set(kThreadStateInitializing);
+  ThreadState* state = new ThreadState;
+  state->in_sampler = false;
+  // Zero is a fixed point of xorshift.
+  state->random_state = RandUint64() | 1;
+  state->bytes_until_sample =
+      NextSamplingInterval(state, mean_sampling_interval);
+  g_tls_thread_state.Set(state);
+  SetCachedThreadState(state);
+  return state;
+}
+
+void AllocationHook(void* address, size_t size) {
+  AllocationSampler::RecordAlloc(address, size);
+}
+
+void FreeHook(void* address) {
+  AllocationSampler::RecordFree(address);
+}
+
+// Copies the sampled allocations into |samples|, unless there are more than
+// |samples| can hold without reallocating. Nothing is allocated or freed with
+// |g_lock| held, as that would reenter the sampler.
+bool CopySamples(std::vector<AllocationRegister::Allocation>* samples) {
+  AutoLock lock(g_lock.Get());
+  if (g_register->size() > samples->capacity())
+    return false;
+  for (const AllocationRegister::Allocation& allocation : *g_register)
+    samples->push_back(allocation);
+  return true;
+}
+
+}  // namespace
+
+// static
+void AllocationSampler::Start(size_t mean_sampling_interval) {
+  DCHECK_GT(mean_sampling_interval, 0u);
+  if (!g_tls_thread_state.initialized())
+    g_tls_thread_state.Initialize(DestructThreadState);
+
+  // Allocate the register before taking the lock: if the hooks are installed
+  // already, the allocation may be sampled, which takes the lock.
+  if (!g_register) {
+    AllocationRegister* alloc_register = new AllocationRegister();
+    AutoLock lock(g_lock.Get());
+    g_register = alloc_register;
+  }
+
+  {
+    AutoLock lock(g_lock.Get());
+    subtle::NoBarrier_Store(
+        &g_mean_sampling_interval,
+        static_cast<subtle::AtomicWord>(mean_sampling_interval));
+  }
+  allocator::SetAllocationHooks(&AllocationHook, &FreeHook);
+}
+
+// static
+void AllocationSampler::Stop() {
+  allocator::SetAllocationHooks(nullptr, nullptr);
+
+  AutoLock lock(g_lock.Get());
+  subtle::NoBarrier_Store(&g_mean_sampling_interval, 0);
+  if (!g_register)
+    return;
+  g_register->Clear();
+  for (size_t i = 0; i < kFreeFilterSize; i++)
+    g_free_filter_counts[i] = 0;
+  for (size_t i = 0; i < kFreeFilterSize / kFreeFilterBitsPerWord; i++)
+    subtle::NoBarrier_Store(&g_free_filter_bits[i], 0);
+}
+
+// static
+bool AllocationSampler::is_sampling() {
+  return subtle::NoBarrier_Load(&g_mean_sampling_interval) != 0;
+}
+
+// static
+void AllocationSampler::RecordAlloc(void* address, size_t size) {
+  const size_t mean_sampling_interval =
+      static_cast<size_t>(subtle::NoBarrier_Load(&g_mean_sampling_interval));
+  if (!mean_sampling_interval || !address)
+    return;
+
+  ThreadState* state = GetThreadState(mean_sampling_interval);
+  if (!state || state->in_sampler)
+    return;
+
+  // The fast path: this allocation does not reach the next sampling point.
+  state->bytes_until_sample -= static_cast<int64_t>(size);
+  if (state->bytes_until_sample > 0)
+    return;
+
+  // The allocation covers one or more sampling points; it is recorded once.
+  // The distance from its end to the next point is again exponentially
+  // distributed, because the exponential distribution is memoryless.
+  state->bytes_until_sample =
+      NextSamplingInterval(state, mean_sampling_interval);
+
+  state->in_sampler = true;
+
+  // Taking the snapshot can allocate, so do it before taking the lock.
+  AllocationContext context = AllocationContext::Empty();
+  if (AllocationContextTracker::capture_enabled())
+    context = AllocationContextTracker::GetContextSnapshot();
+
+  // Weigh the sample by the inverse of the probability of sampling an
+  // allocation of this size. 1 - exp(-x) is computed as -expm1(-x) to keep
+  // precision for allocations much smaller than the interval.
+  const double sampling_probability =
+      -expm1(-static_cast<double>(size) / mean_sampling_interval);
+  const size_t estimated_size =
+      static_cast<size_t>(size / sampling_probability + 0.5);
+
+  {
+    AutoLock lock(g_lock.Get());
+    // The sampler may have been stopped since the check above.
+    if (subtle::NoBarrier_Load(&g_mean_sampling_interval)) {
+      const size_t index = GetFreeFilterIndex(address);
+      // A missed free leaves a stale sample behind; replace it.
+      if (g_register->Remove(address))
+        RemoveFromFreeFilter(index);
+      if (g_register->Insert(address, estimated_size, context))
+        AddToFreeFilter(index);
+    }
+  }
+
+  state->in_sampler = false;
+}
+
+// static
+void AllocationSampler::RecordFree(void* address) {
+  if (!address)
+    return;
+
+  // When the sampler is stopped all of the bits are clear.
+  const size_t index = GetFreeFilterIndex(address);
+  if (!(subtle::NoBarrier_Load(GetFreeFilterWord(index)) &
+        GetFreeFilterBit(index))) {
+    return;
+  }
+
+  AutoLock lock(g_lock.Get());
+  if (g_register->Remove(address))
+    RemoveFromFreeFilter(index);
+}
+
+// static
+void AllocationSampler::InsertSamplesInto(HeapDumpWriter* writer) {
+  if (!g_register)
+    return;
+
+  std::vector<AllocationRegister::Allocation> samples;
+  for (;;) {
+    size_t num_samples;
+    {
+      AutoLock lock(g_lock.Get());
+      num_samples = g_register->size();
+    }
+    // Leave room for allocations sampled until the lock is taken again.
+    samples.reserve(num_samples + num_samples / 8 + 16);
+    if (CopySamples(&samples))
+      break;
+  }
+
+  for (const AllocationRegister::Allocation& sample : samples)
+    writer->InsertAllocation(sample.context, sample.size);
+}
+
+// static
+size_t AllocationSampler::num_dropped() {
+  if (!g_register)
+    return 0;
+  AutoLock lock(g_lock.Get());
+  return g_register->num_dropped();
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,73 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TRACE_EVENT_HEAP_PROFILER_ALLOCATION_SAMPLER_H_
+#define BASE_TRACE_EVENT_HEAP_PROFILER_ALLOCATION_SAMPLER_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/macros.h"
+
+namespace base {
+namespace trace_event {
+
+class HeapDumpWriter;
+
+// The allocation sampler records a random sample of the allocations made by
+// the process, together with the |AllocationContext| of the allocating
+// thread, for heap profiling with low overhead. Recording every allocation
+// costs a lock and a hash table insertion per malloc(); sampling reduces that
+// to a thread-local counter decrement for all but a few allocations.
+//
+// Allocations are sampled as a Poisson process over the allocated bytes: the
+// sampler draws the number of bytes until the next sample from an exponential
+// distribution with the given mean, and samples the allocation during which
+// that many bytes have been allocated. The probability that an allocation of
+// |size| bytes is sampled is therefore 1 - exp(-size / mean), independently of
+// the other allocations, and every sample is recorded with a weight of
+// size / (1 - exp(-size / mean)) bytes, which makes the heap dump an unbiased
+// estimate of the live heap.
+//
+// The sampler is fed by the allocator shim (see base/allocator/
+// allocator_shim.h) when it is compiled in. Allocators which are not covered
+// by the shim can call |RecordAlloc| and |RecordFree| directly.
+class BASE_EXPORT AllocationSampler {
+ public:
+  // The default mean number of bytes between two samples.
+  static const size_t kDefaultMeanSamplingInterval = 128 * 1024;
+
+  // Starts sampling allocations with a mean interval of
+  // |mean_sampling_interval| bytes. Installs the allocator shim hooks.
+  static void Start(size_t mean_sampling_interval);
+
+  // Stops sampling and discards all samples. |Start| and |Stop| must not be
+  // called concurrently.
+  static void Stop();
+
+  // Returns whether the sampler has been started.
+  static bool is_sampling();
+
+  // Records an allocation of |size| bytes at |address|, or a free of the
+  // allocation at |address|. These are safe to call from any thread and from
+  // within the allocator, and are no-ops when the sampler is not started.
+  static void RecordAlloc(void* address, size_t size);
+  static void RecordFree(void* address);
+
+  // Inserts the estimated size of every sampled allocation that has not been
+  // freed yet into |writer|. This copies the samples out under a lock, so it
+  // does not block allocations on other threads while the dump is written.
+  static void InsertSamplesInto(HeapDumpWriter* writer);
+
+  // Returns the number of samples dropped because the sample table was full.
+  static size_t num_dropped();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(AllocationSampler);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BASE_TRACE_EVENT_HEAP_PROFILER_ALLOCATION_SAMPLER_H_
@@ -0,0 +1,85 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/heap_profiler_allocation_sampler.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "base/allocator/allocator_shim.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+const size_t kNumLiveAllocations = 10000;
+const int kNumRounds = 200;
+
+// Runs a malloc/free workload of small allocations, calling the sampler
+// hooks the way the allocator shim does unless the shim is compiled in, and
+// returns the time it took.
+TimeDelta RunWorkload(size_t size) {
+  const bool call_hooks = !allocator::IsAllocatorShimEnabled();
+  std::vector<void*> allocations(kNumLiveAllocations, nullptr);
+  TimeTicks start = TimeTicks::Now();
+  for (int round = 0; round < kNumRounds; round++) {
+    for (size_t i = 0; i < kNumLiveAllocations; i++) {
+      if (allocations[i]) {
+        if (call_hooks)
+          AllocationSampler::RecordFree(allocations[i]);
+        free(allocations[i]);
+      }
+      allocations[i] = malloc(size + i % 64);
+      if (call_hooks)
+        AllocationSampler::RecordAlloc(allocations[i], size + i % 64);
+    }
+  }
+  TimeDelta elapsed = TimeTicks::Now() - start;
+  for (void* allocation : allocations) {
+    if (call_hooks)
+      AllocationSampler::RecordFree(allocation);
+    free(allocation);
+  }
+  return elapsed;
+}
+
+void MeasureOverhead(size_t size, const std::string& trace) {
+  // Warm up the allocator, so that the first measurement is not penalized.
+  RunWorkload(size);
+  TimeDelta baseline = RunWorkload(size);
+
+  AllocationSampler::Start(AllocationSampler::kDefaultMeanSamplingInterval);
+  TimeDelta sampled = RunWorkload(size);
+  AllocationSampler::Stop();
+
+  const double num_ops = static_cast<double>(kNumLiveAllocations) * kNumRounds;
+  perf_test::PrintResult("malloc_free_time", "_baseline", trace,
+                         baseline.InSecondsF() * 1e9 / num_ops, "ns", false);
+  perf_test::PrintResult("malloc_free_time", "_sampled", trace,
+                         sampled.InSecondsF() * 1e9 / num_ops, "ns", false);
+  perf_test::PrintResult(
+      "sampling_overhead", "", trace,
+      100.0 * (sampled - baseline).InSecondsF() / baseline.InSecondsF(), "%",
+      true);
+}
+
+}  // namespace
+
+TEST(AllocationSamplerPerfTest, SmallAllocations) {
+  MeasureOverhead(32, "32_bytes");
+}
+
+TEST(AllocationSamplerPerfTest, MediumAllocations) {
+  MeasureOverhead(1024, "1_KiB");
+}
+
+}  // namespace trace_event
+}  // namespace base
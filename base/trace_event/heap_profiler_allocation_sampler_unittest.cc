@@ -0,0 +1,224 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/heap_profiler_allocation_sampler.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "base/allocator/allocator_shim.h"
+#include "base/json/json_reader.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/threading/simple_thread.h"
+#include "base/trace_event/heap_profiler_allocation_context.h"
+#include "base/trace_event/heap_profiler_allocation_context_tracker.h"
+#include "base/trace_event/heap_profiler_heap_dump_writer.h"
+#include "base/trace_event/heap_profiler_stack_frame_deduplicator.h"
+#include "base/trace_event/heap_profiler_type_name_deduplicator.h"
+#include "base/trace_event/trace_event_argument.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+const char kSampled[] = "Sampled";
+
+// The allocations in these tests are fake: the sampler never dereferences
+// the addresses, so any non-null value will do.
+void* FakeAddress(uintptr_t index) {
+  return reinterpret_cast<void*>(0x100000 + index * 16);
+}
+
+// Writes a heap dump of the current samples and returns the size of the entry
+// with the given "bt" and no "type", or -1 if there is no such entry.
+int64_t GetSampledSize(const std::string& backtrace) {
+  scoped_refptr<StackFrameDeduplicator> sf_deduplicator =
+      new StackFrameDeduplicator;
+  scoped_refptr<TypeNameDeduplicator> tn_deduplicator =
+      new TypeNameDeduplicator;
+  HeapDumpWriter writer(sf_deduplicator.get(), tn_deduplicator.get());
+  AllocationSampler::InsertSamplesInto(&writer);
+
+  std::string json;
+  writer.WriteHeapDump()->AppendAsTraceFormat(&json);
+  scoped_ptr<Value> heap_dump = JSONReader::Read(json);
+  const DictionaryValue* dictionary;
+  const ListValue* entries;
+  EXPECT_TRUE(heap_dump && heap_dump->GetAsDictionary(&dictionary));
+  EXPECT_TRUE(dictionary->GetList("entries", &entries));
+
+  for (size_t i = 0; i < entries->GetSize(); i++) {
+    const DictionaryValue* entry;
+    std::string entry_backtrace;
+    std::string size;
+    EXPECT_TRUE(entries->GetDictionary(i, &entry));
+    if (entry->HasKey("type"))
+      continue;
+    EXPECT_TRUE(entry->GetString("bt", &entry_backtrace));
+    EXPECT_TRUE(entry->GetString("size", &size));
+    if (entry_backtrace == backtrace)
+      return strtoll(size.c_str(), nullptr, 16);
+  }
+  return -1;
+}
+
+int64_t GetTotalSampledSize() {
+  return GetSampledSize("");
+}
+
+// Starts the sampler for the fake allocations of the tests. The real ones,
+// which the allocator shim reports if it is compiled in, would add to them.
+void StartWithoutHooks(size_t mean_sampling_interval) {
+  AllocationSampler::Start(mean_sampling_interval);
+  allocator::SetAllocationHooks(nullptr, nullptr);
+}
+
+class AllocatingDelegate : public DelegateSimpleThread::Delegate {
+ public:
+  AllocatingDelegate(uintptr_t first_index, size_t num_allocations)
+      : first_index_(first_index), num_allocations_(num_allocations) {}
+
+  void Run() override {
+    for (size_t i = 0; i < num_allocations_; i++)
+      AllocationSampler::RecordAlloc(FakeAddress(first_index_ + i), 4096);
+    for (size_t i = 0; i < num_allocations_; i++)
+      AllocationSampler::RecordFree(FakeAddress(first_index_ + i));
+  }
+
+ private:
+  const uintptr_t first_index_;
+  const size_t num_allocations_;
+};
+
+}  // namespace
+
+TEST(AllocationSamplerTest, StoppedSamplerIgnoresAllocations) {
+  ASSERT_FALSE(AllocationSampler::is_sampling());
+  AllocationSampler::RecordAlloc(FakeAddress(1), 1 << 30);
+  EXPECT_EQ(0, GetTotalSampledSize());
+}
+
+TEST(AllocationSamplerTest, EstimatesLiveHeap) {
+  StartWithoutHooks(AllocationSampler::kDefaultMeanSamplingInterval);
+  EXPECT_TRUE(AllocationSampler::is_sampling());
+
+  // Allocate 200 MiB in 1 KiB blocks, which results in ~1600 samples. The
+  // standard deviation of the estimate is then less than 3 percent.
+  const size_t kNumAllocations = 200 * 1024;
+  const size_t kSize = 1024;
+  for (size_t i = 0; i < kNumAllocations; i++)
+    AllocationSampler::RecordAlloc(FakeAddress(i), kSize);
+
+  const double expected = static_cast<double>(kNumAllocations * kSize);
+  double estimate = static_cast<double>(GetTotalSampledSize());
+  EXPECT_GT(estimate, expected * 0.85);
+  EXPECT_LT(estimate, expected * 1.15);
+
+  // Free half of the blocks.
+  for (size_t i = 0; i < kNumAllocations; i += 2)
+    AllocationSampler::RecordFree(FakeAddress(i));
+  estimate = static_cast<double>(GetTotalSampledSize());
+  EXPECT_GT(estimate, expected / 2 * 0.8);
+  EXPECT_LT(estimate, expected / 2 * 1.2);
+
+  for (size_t i = 1; i < kNumAllocations; i += 2)
+    AllocationSampler::RecordFree(FakeAddress(i));
+  EXPECT_EQ(0, GetTotalSampledSize());
+
+  AllocationSampler::Stop();
+  EXPECT_FALSE(AllocationSampler::is_sampling());
+}
+
+TEST(AllocationSamplerTest, LargeAllocationsAreExact) {
+  StartWithoutHooks(1024);
+
+  // An allocation much larger than the sampling interval is sampled with
+  // probability 1, and then its weight is its size.
+  AllocationSampler::RecordAlloc(FakeAddress(1), 1 << 20);
+  AllocationSampler::RecordAlloc(FakeAddress(2), 1 << 21);
+  EXPECT_EQ((1 << 20) + (1 << 21), GetTotalSampledSize());
+
+  AllocationSampler::RecordFree(FakeAddress(1));
+  EXPECT_EQ(1 << 21, GetTotalSampledSize());
+
+  // Stopping discards the samples.
+  AllocationSampler::Stop();
+  StartWithoutHooks(1024);
+  EXPECT_EQ(0, GetTotalSampledSize());
+  AllocationSampler::Stop();
+}
+
+TEST(AllocationSamplerTest, RecordsAllocationContext) {
+  AllocationContextTracker::SetCaptureEnabled(true);
+  AllocationContextTracker::PushPseudoStackFrame(kSampled);
+  StartWithoutHooks(1024);
+
+  AllocationSampler::RecordAlloc(FakeAddress(1), 1 << 20);
+
+  scoped_refptr<StackFrameDeduplicator> sf_deduplicator =
+      new StackFrameDeduplicator;
+  const StackFrame frames[] = {kSampled};
+  const std::string sampled_id =
+      IntToString(sf_deduplicator->Insert(frames, frames + 1));
+  EXPECT_EQ(1 << 20, GetSampledSize(sampled_id));
+
+  AllocationSampler::RecordFree(FakeAddress(1));
+  AllocationSampler::Stop();
+  AllocationContextTracker::PopPseudoStackFrame(kSampled);
+  AllocationContextTracker::SetCaptureEnabled(false);
+}
+
+TEST(AllocationSamplerTest, ConcurrentAllocations) {
+  StartWithoutHooks(4096);
+
+  const int kNumThreads = 8;
+  const size_t kNumAllocations = 10000;
+  ScopedVector<AllocatingDelegate> delegates;
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    delegates.push_back(
+        new AllocatingDelegate(i * kNumAllocations, kNumAllocations));
+    threads.push_back(
+        new DelegateSimpleThread(delegates.back(), "AllocationSampler"));
+    threads.back()->Start();
+  }
+  for (DelegateSimpleThread* thread : threads)
+    thread->Join();
+
+  // Every sampled allocation was freed again.
+  EXPECT_EQ(0, GetTotalSampledSize());
+  EXPECT_EQ(0u, AllocationSampler::num_dropped());
+  AllocationSampler::Stop();
+}
+
+TEST(AllocationSamplerTest, SamplesThroughAllocatorShim) {
+  if (!allocator::IsAllocatorShimEnabled())
+    return;
+  AllocationSampler::Start(1024);
+
+  // Other allocations are sampled too, but they are much smaller, and mostly
+  // freed again.
+  const int64_t kSize = 1 << 20;
+  void* volatile block = malloc(kSize);
+  ASSERT_TRUE(block);
+  const int64_t with_block = GetTotalSampledSize();
+  free(block);
+  const int64_t without_block = GetTotalSampledSize();
+  EXPECT_GT(with_block - without_block, kSize / 2);
+  EXPECT_LT(with_block - without_block, kSize * 3 / 2);
+
+  AllocationSampler::Stop();
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,140 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/heap_profiler_heap_dump_writer.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "base/strings/stringprintf.h"
+#include "base/trace_event/heap_profiler_stack_frame_deduplicator.h"
+#include "base/trace_event/heap_profiler_type_name_deduplicator.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+// An entry of the heap dump: the total size for a (stack frame ID, type ID)
+// pair. A stack frame ID of -1 means "any backtrace", a type ID of -1 means
+// "any type".
+struct Entry {
+  int stack_frame_id;
+  int type_id;
+  size_t size;
+};
+
+// Orders entries by their size, largest first.
+bool IsLarger(const Entry& lhs, const Entry& rhs) {
+  return lhs.size > rhs.size;
+}
+
+// Returns the number of frames in |backtrace|. Unused frames are null and
+// always at the end.
+size_t CountFrames(const Backtrace& backtrace) {
+  const StackFrame* begin = std::begin(backtrace.frames);
+  const StackFrame* end = std::end(backtrace.frames);
+  return std::find(begin, end, nullptr) - begin;
+}
+
+void AppendEntries(const hash_map<std::pair<int, int>, size_t>& sizes,
+                   std::vector<Entry>* entries) {
+  for (const auto& ids_and_size : sizes) {
+    Entry entry = {ids_and_size.first.first, ids_and_size.first.second,
+                   ids_and_size.second};
+    entries->push_back(entry);
+  }
+}
+
+}  // namespace
+
+HeapDumpWriter::HeapDumpWriter(StackFrameDeduplicator* stack_frame_deduplicator,
+                               TypeNameDeduplicator* type_name_deduplicator)
+    : traced_value_(new TracedValue()),
+      stack_frame_deduplicator_(stack_frame_deduplicator),
+      type_name_deduplicator_(type_name_deduplicator) {}
+
+HeapDumpWriter::~HeapDumpWriter() {}
+
+void HeapDumpWriter::InsertAllocation(const AllocationContext& context,
+                                      size_t size) {
+  bytes_by_context_[context] += size;
+}
+
+scoped_refptr<TracedValue> HeapDumpWriter::WriteHeapDump() {
+  size_t total_size = 0;
+  hash_map<std::pair<int, int>, size_t> bytes_by_backtrace;
+  hash_map<std::pair<int, int>, size_t> bytes_by_type;
+  hash_map<std::pair<int, int>, size_t> bytes_by_backtrace_and_type;
+
+  for (const auto& context_and_size : bytes_by_context_) {
+    const AllocationContext& context = context_and_size.first;
+    const size_t size = context_and_size.second;
+    const StackFrame* frames = context.backtrace.frames;
+
+    // Inserting the backtrace also assigns IDs to all of its frames, so
+    // ancestors can be looked up by the consumer of the trace. An empty
+    // backtrace has no ID and is only accounted for in the totals.
+    int stack_frame_id = stack_frame_deduplicator_->Insert(
+        frames, frames + CountFrames(context.backtrace));
+    int type_id = type_name_deduplicator_->Insert(context.type_name);
+
+    total_size += size;
+    bytes_by_type[std::make_pair(-1, type_id)] += size;
+    if (stack_frame_id != -1) {
+      bytes_by_backtrace[std::make_pair(stack_frame_id, -1)] += size;
+      bytes_by_backtrace_and_type[std::make_pair(stack_frame_id, type_id)] +=
+          size;
+    }
+  }
+
+  std::vector<Entry> entries;
+  Entry total = {-1, -1, total_size};
+  entries.push_back(total);
+  AppendEntries(bytes_by_type, &entries);
+  AppendEntries(bytes_by_backtrace, &entries);
+  AppendEntries(bytes_by_backtrace_and_type, &entries);
+  std::stable_sort(entries.begin(), entries.end(), IsLarger);
+
+  std::string buffer;
+  traced_value_->BeginArray("entries");
+  for (const Entry& entry : entries) {
+    traced_value_->BeginDictionary();
+
+    WriteSize(entry.size);
+
+    // An empty "bt" denotes the root of the call tree, i.e. the total for all
+    // backtraces.
+    if (entry.stack_frame_id == -1) {
+      traced_value_->SetString("bt", "");
+    } else {
+      SStringPrintf(&buffer, "%i", entry.stack_frame_id);
+      traced_value_->SetString("bt", buffer);
+    }
+
+    if (entry.type_id != -1) {
+      SStringPrintf(&buffer, "%i", entry.type_id);
+      traced_value_->SetString("type", buffer);
+    }
+
+    traced_value_->EndDictionary();
+  }
+  traced_value_->EndArray();  // "entries"
+
+  return traced_value_;
+}
+
+void HeapDumpWriter::WriteSize(size_t size) {
+  std::string buffer;
+  SStringPrintf(&buffer, "%" PRIx64, static_cast<uint64_t>(size));
+  traced_value_->SetString("size", buffer);
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,84 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TRACE_EVENT_HEAP_PROFILER_HEAP_DUMP_WRITER_H_
+#define BASE_TRACE_EVENT_HEAP_PROFILER_HEAP_DUMP_WRITER_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/containers/hash_tables.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/trace_event/heap_profiler_allocation_context.h"
+#include "base/trace_event/trace_event_argument.h"
+
+namespace base {
+namespace trace_event {
+
+class StackFrameDeduplicator;
+class TypeNameDeduplicator;
+
+// Helper class to dump a snapshot of an |AllocationRegister| or other heap
+// bookkeeping structure into a |TracedValue|. This class is intended to be
+// used as a one-shot local instance on the stack. To write heap dumps, call
+// |InsertAllocation| for every captured allocation, then call
+// |WriteHeapDump| to do the processing and generate a heap dump value for
+// the trace log.
+//
+// The heap dump is a dictionary with an "entries" list. Every entry has a
+// "size" (in bytes, as a hexadecimal string) and a "bt" (the stack frame ID
+// of the leaf frame of a backtrace) and optionally a "type" (a type name ID):
+//
+//  - The entry with an empty "bt" and no "type" is the total of the heap.
+//  - Entries with an empty "bt" and a "type" are totals for that type.
+//  - Entries with a "bt" and no "type" are totals for that backtrace.
+//  - Entries with both are the bytes allocated for that type from that
+//    backtrace.
+//
+// The stack frame and type name IDs refer to the deduplicators, which are
+// written to the trace once, when the trace is finalized.
+class BASE_EXPORT HeapDumpWriter {
+ public:
+  // The |StackFrameDeduplicator| and |TypeNameDeduplicator| are not owned.
+  // The heap dump writer assumes exclusive access to them during the lifetime
+  // of the dump writer.
+  HeapDumpWriter(StackFrameDeduplicator* stack_frame_deduplicator,
+                 TypeNameDeduplicator* type_name_deduplicator);
+  ~HeapDumpWriter();
+
+  // Adds |size| bytes to the total of |context|. The heavier processing is
+  // deferred to |WriteHeapDump|.
+  void InsertAllocation(const AllocationContext& context, size_t size);
+
+  // Aggregates allocations and writes an "entries" array to a traced value.
+  scoped_refptr<TracedValue> WriteHeapDump();
+
+ private:
+  // Writes a "size" key with value |size| as a hexadecimal string to the
+  // traced value.
+  void WriteSize(size_t size);
+
+  // The value that this heap dumper writes to.
+  const scoped_refptr<TracedValue> traced_value_;
+
+  // Helper for generating the |stackFrames| dictionary. Not owned, must
+  // outlive this heap dump writer instance.
+  StackFrameDeduplicator* const stack_frame_deduplicator_;
+
+  // Helper for converting type names to IDs. Not owned, must outlive this
+  // heap dump writer instance.
+  TypeNameDeduplicator* const type_name_deduplicator_;
+
+  // A map of allocation context to the number of bytes allocated for that
+  // context.
+  hash_map<AllocationContext, size_t> bytes_by_context_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapDumpWriter);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BASE_TRACE_EVENT_HEAP_PROFILER_HEAP_DUMP_WRITER_H_
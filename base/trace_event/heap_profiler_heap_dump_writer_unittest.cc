@@ -0,0 +1,144 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/heap_profiler_heap_dump_writer.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <iterator>
+#include <string>
+
+#include "base/json/json_reader.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/trace_event/heap_profiler_allocation_context.h"
+#include "base/trace_event/heap_profiler_stack_frame_deduplicator.h"
+#include "base/trace_event/heap_profiler_type_name_deduplicator.h"
+#include "base/trace_event/trace_event_argument.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+// Define all strings once, because the deduplicators require pointer equality,
+// and string interning is unreliable.
+const char kBrowserMain[] = "BrowserMain";
+const char kRendererMain[] = "RendererMain";
+const char kCreateWidget[] = "CreateWidget";
+const char kInt[] = "int";
+const char kBool[] = "bool";
+
+scoped_ptr<Value> WriteAndReadBack(HeapDumpWriter* writer) {
+  std::string json;
+  writer->WriteHeapDump()->AppendAsTraceFormat(&json);
+  return JSONReader::Read(json);
+}
+
+// Returns the size of the entry with the given "bt" and "type" (an empty type
+// meaning no "type" key), or -1 if there is no such entry.
+int GetSize(const Value& heap_dump,
+            const std::string& backtrace,
+            const std::string& type) {
+  const DictionaryValue* dictionary;
+  const ListValue* entries;
+  EXPECT_TRUE(heap_dump.GetAsDictionary(&dictionary));
+  EXPECT_TRUE(dictionary->GetList("entries", &entries));
+
+  int result = -1;
+  for (size_t i = 0; i < entries->GetSize(); i++) {
+    const DictionaryValue* entry;
+    std::string entry_backtrace;
+    std::string entry_type;
+    std::string size;
+    EXPECT_TRUE(entries->GetDictionary(i, &entry));
+    EXPECT_TRUE(entry->GetString("bt", &entry_backtrace));
+    entry->GetString("type", &entry_type);
+    EXPECT_TRUE(entry->GetString("size", &size));
+    if (entry_backtrace == backtrace && entry_type == type) {
+      EXPECT_EQ(-1, result) << "Duplicate entry";
+      result = static_cast<int>(strtol(size.c_str(), nullptr, 16));
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(HeapDumpWriterTest, Empty) {
+  scoped_refptr<StackFrameDeduplicator> sf_deduplicator =
+      new StackFrameDeduplicator;
+  scoped_refptr<TypeNameDeduplicator> tn_deduplicator =
+      new TypeNameDeduplicator;
+  HeapDumpWriter writer(sf_deduplicator.get(), tn_deduplicator.get());
+  scoped_ptr<Value> heap_dump = WriteAndReadBack(&writer);
+  ASSERT_TRUE(heap_dump);
+
+  // Only the total is written.
+  EXPECT_EQ(0, GetSize(*heap_dump, "", ""));
+}
+
+TEST(HeapDumpWriterTest, Aggregation) {
+  scoped_refptr<StackFrameDeduplicator> sf_deduplicator =
+      new StackFrameDeduplicator;
+  scoped_refptr<TypeNameDeduplicator> tn_deduplicator =
+      new TypeNameDeduplicator;
+  HeapDumpWriter writer(sf_deduplicator.get(), tn_deduplicator.get());
+
+  AllocationContext ctx = AllocationContext::Empty();
+  ctx.backtrace.frames[0] = kBrowserMain;
+  ctx.backtrace.frames[1] = kCreateWidget;
+  ctx.type_name = kInt;
+  writer.InsertAllocation(ctx, 10);
+  writer.InsertAllocation(ctx, 20);
+  ctx.type_name = kBool;
+  writer.InsertAllocation(ctx, 5);
+
+  ctx.backtrace.frames[0] = kRendererMain;
+  writer.InsertAllocation(ctx, 7);
+
+  // An allocation without backtrace only counts towards the totals.
+  AllocationContext empty = AllocationContext::Empty();
+  empty.type_name = kInt;
+  writer.InsertAllocation(empty, 100);
+
+  scoped_ptr<Value> heap_dump = WriteAndReadBack(&writer);
+  ASSERT_TRUE(heap_dump);
+
+  // The IDs are assigned in the order in which the contexts are visited,
+  // which is unspecified, so look them up. Inserting again returns the
+  // existing ID.
+  const StackFrame browser_widget[] = {kBrowserMain, kCreateWidget};
+  const StackFrame renderer_widget[] = {kRendererMain, kCreateWidget};
+  const std::string browser_widget_id = IntToString(
+      sf_deduplicator->Insert(std::begin(browser_widget),
+                              std::end(browser_widget)));
+  const std::string renderer_widget_id = IntToString(
+      sf_deduplicator->Insert(std::begin(renderer_widget),
+                              std::end(renderer_widget)));
+  const std::string browser_main_id =
+      IntToString(sf_deduplicator->Insert(browser_widget, browser_widget + 1));
+  const std::string int_id = IntToString(tn_deduplicator->Insert(kInt));
+  const std::string bool_id = IntToString(tn_deduplicator->Insert(kBool));
+
+  EXPECT_EQ(142, GetSize(*heap_dump, "", ""));
+  EXPECT_EQ(130, GetSize(*heap_dump, "", int_id));
+  EXPECT_EQ(12, GetSize(*heap_dump, "", bool_id));
+  EXPECT_EQ(35, GetSize(*heap_dump, browser_widget_id, ""));
+  EXPECT_EQ(30, GetSize(*heap_dump, browser_widget_id, int_id));
+  EXPECT_EQ(5, GetSize(*heap_dump, browser_widget_id, bool_id));
+  EXPECT_EQ(7, GetSize(*heap_dump, renderer_widget_id, ""));
+  EXPECT_EQ(7, GetSize(*heap_dump, renderer_widget_id, bool_id));
+  EXPECT_EQ(-1, GetSize(*heap_dump, renderer_widget_id, int_id));
+
+  // Entries are only written for leaf frames of inserted backtraces.
+  EXPECT_EQ(-1, GetSize(*heap_dump, browser_main_id, ""));
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -7,6 +7,10 @@
 #include <stddef.h>
 
 #include "base/allocator/allocator_extension.h"
+#include "base/allocator/allocator_shim.h"
+#include "base/trace_event/heap_profiler_allocation_sampler.h"
+#include "base/trace_event/heap_profiler_heap_dump_writer.h"
+#include "base/trace_event/memory_dump_session_state.h"
 #include "base/trace_event/process_memory_dump.h"
 #include "build/build_config.h"
 
@@ -28,7 +32,7 @@ MallocDumpProvider* MallocDumpProvider::GetInstance() {
                    LeakySingletonTraits<MallocDumpProvider>>::get();
 }
 
-MallocDumpProvider::MallocDumpProvider() {}
+MallocDumpProvider::MallocDumpProvider() : heap_profiler_enabled_(false) {}
 
 MallocDumpProvider::~MallocDumpProvider() {}
 
@@ -97,8 +101,30 @@ bool MallocDumpProvider::OnMemoryDump(const MemoryDumpArgs& /* args */,
                           resident_size - allocated_objects_size);
   }
 
+  // Heap dumps are only written when tracing, which provides the session
+  // state with the stack frame and type name deduplicators.
+  if (heap_profiler_enabled_ && pmd->session_state()) {
+    MemoryDumpSessionState* session_state = pmd->session_state().get();
+    HeapDumpWriter writer(session_state->stack_frame_deduplicator(),
+                          session_state->type_name_deduplicator());
+    AllocationSampler::InsertSamplesInto(&writer);
+    pmd->AddHeapDump("malloc", writer.WriteHeapDump());
+  }
+
   return true;
 }
 
+void MallocDumpProvider::OnHeapProfilingEnabled(bool enabled) {
+  if (!allocator::IsAllocatorShimEnabled() ||
+      enabled == heap_profiler_enabled_) {
+    return;
+  }
+  if (enabled)
+    AllocationSampler::Start(AllocationSampler::kDefaultMeanSamplingInterval);
+  else
+    AllocationSampler::Stop();
+  heap_profiler_enabled_ = enabled;
+}
+
 }  // namespace trace_event
 }  // namespace base
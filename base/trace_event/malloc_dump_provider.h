@@ -32,6 +32,7 @@ class BASE_EXPORT MallocDumpProvider : public MemoryDumpProvider {
   // MemoryDumpProvider implementation.
   bool OnMemoryDump(const MemoryDumpArgs& args,
                     ProcessMemoryDump* pmd) override;
+  void OnHeapProfilingEnabled(bool enabled) override;
 
  private:
   friend struct DefaultSingletonTraits<MallocDumpProvider>;
@@ -39,6 +40,10 @@ class BASE_EXPORT MallocDumpProvider : public MemoryDumpProvider {
   MallocDumpProvider();
   ~MallocDumpProvider() override;
 
+  // Whether the allocation sampler has been started by this provider. Only
+  // the allocator shim feeds the sampler, so it is not started without it.
+  bool heap_profiler_enabled_;
+
   DISALLOW_COPY_AND_ASSIGN(MallocDumpProvider);
 };
 
@@ -106,8 +106,8 @@ class BASE_EXPORT ProcessMemoryDump {
   const AllocatorDumpsMap& allocator_dumps() const { return allocator_dumps_; }
 
   // Adds a heap dump for the allocator with |absolute_name|. The |TracedValue|
-  // must have the correct format. |trace_event::HeapDumper| will generate such
-  // a value from a |trace_event::AllocationRegister|.
+  // must have the correct format. |trace_event::HeapDumpWriter| will generate
+  // such a value from a |trace_event::AllocationRegister|.
   void AddHeapDump(const std::string& absolute_name,
                    scoped_refptr<TracedValue> heap_dump);
 
@@ -4,11 +4,17 @@
 
 #include "base/trace_event/process_memory_maps_dump_provider.h"
 
+#include <fcntl.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "base/files/scoped_file.h"
-#include "base/format_macros.h"
 #include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
 #include "base/trace_event/process_memory_dump.h"
 #include "base/trace_event/process_memory_maps.h"
@@ -19,22 +25,64 @@ namespace trace_event {
 // static
 FILE* ProcessMemoryMapsDumpProvider::proc_smaps_for_testing = nullptr;
 
+// static
+FILE* ProcessMemoryMapsDumpProvider::proc_smaps_rollup_for_testing = nullptr;
+
 namespace {
 
-const uint32_t kMaxLineSize = 4096;
+// The smaps file is read in chunks of this size. /proc files are generated a
+// page at a time by the kernel, so large reads fill the buffer with as many
+// regions as fit and keep the number of read() syscalls low.
+const size_t kReadChunkSize = 256 * 1024;
+
+// Lines longer than this (e.g. absurdly long mapped file names) are skipped.
+const size_t kMaxLineSize = 4096;
+
+const uint32_t kNumExpectedCountersPerRegion = 6;
+
+// Parses the hexadecimal number at |*pos| and advances |*pos| past it.
+bool ParseHex(const char** pos, const char* end, uint64_t* value) {
+  const char* p = *pos;
+  uint64_t result = 0;
+  for (; p < end; ++p) {
+    int digit;
+    if (*p >= '0' && *p <= '9')
+      digit = *p - '0';
+    else if (*p >= 'a' && *p <= 'f')
+      digit = *p - 'a' + 10;
+    else
+      break;
+    result = (result << 4) | static_cast<uint64_t>(digit);
+  }
+  if (p == *pos)
+    return false;
+  *pos = p;
+  *value = result;
+  return true;
+}
+
+// Advances |*pos| past the next space-separated token and the spaces after it.
+void SkipToken(const char** pos, const char* end) {
+  const char* p = *pos;
+  while (p < end && *p != ' ')
+    ++p;
+  while (p < end && *p == ' ')
+    ++p;
+  *pos = p;
+}
 
-bool ParseSmapsHeader(const char* header_line,
+bool ParseSmapsHeader(const char* line,
+                      const char* end,
                       ProcessMemoryMaps::VMRegion* region) {
-  // e.g., "00400000-00421000 r-xp 00000000 fc:01 1234  /foo.so\n"
+  // e.g., "00400000-00421000 r-xp 00000000 fc:01 1234  /foo.so"
   bool res = true;  // Whether this region should be appended or skipped.
   uint64_t end_addr = 0;
-  char protection_flags[5] = {0};
-  char mapped_file[kMaxLineSize];
-
-  if (sscanf(header_line, "%" SCNx64 "-%" SCNx64 " %4c %*s %*s %*s%4095[^\n]\n",
-             &region->start_address, &end_addr, protection_flags,
-             mapped_file) != 4)
+  const char* pos = line;
+  if (!ParseHex(&pos, end, &region->start_address) || pos == end ||
+      *pos++ != '-' || !ParseHex(&pos, end, &end_addr) || pos == end ||
+      *pos++ != ' ' || end - pos < 4) {
     return false;
+  }
 
   if (end_addr > region->start_address) {
     region->size_in_bytes = end_addr - region->start_address;
@@ -45,94 +93,165 @@ bool ParseSmapsHeader(const char* header_line,
   }
 
   region->protection_flags = 0;
-  if (protection_flags[0] == 'r') {
+  if (pos[0] == 'r') {
     region->protection_flags |=
         ProcessMemoryMaps::VMRegion::kProtectionFlagsRead;
   }
-  if (protection_flags[1] == 'w') {
+  if (pos[1] == 'w') {
     region->protection_flags |=
         ProcessMemoryMaps::VMRegion::kProtectionFlagsWrite;
   }
-  if (protection_flags[2] == 'x') {
+  if (pos[2] == 'x') {
     region->protection_flags |=
         ProcessMemoryMaps::VMRegion::kProtectionFlagsExec;
   }
 
-  region->mapped_file = mapped_file;
-  TrimWhitespaceASCII(region->mapped_file, TRIM_ALL, &region->mapped_file);
+  // Skip the protection flags, offset, device and inode.
+  for (int i = 0; i < 4; ++i)
+    SkipToken(&pos, end);
+
+  // The rest of the line is the (possibly empty) mapped file, which can
+  // contain spaces.
+  while (end > pos && (end[-1] == ' ' || end[-1] == '\t'))
+    --end;
+  region->mapped_file.assign(pos, end);
 
   return res;
 }
 
-uint64_t ReadCounterBytes(char* counter_line) {
+uint32_t ParseSmapsCounter(const char* line,
+                           const char* end,
+                           ProcessMemoryMaps::VMRegion* region) {
+  // A smaps counter lines looks as follows: "RSS:  0 Kb"
+  const char* colon = static_cast<const char*>(memchr(line, ':', end - line));
+  if (!colon)
+    return 0;
+
+  StringPiece counter_name(line, colon - line);
+  uint64_t* counter = nullptr;
+  if (counter_name == "Pss")
+    counter = &region->byte_stats_proportional_resident;
+  else if (counter_name == "Private_Dirty")
+    counter = &region->byte_stats_private_dirty_resident;
+  else if (counter_name == "Private_Clean")
+    counter = &region->byte_stats_private_clean_resident;
+  else if (counter_name == "Shared_Dirty")
+    counter = &region->byte_stats_shared_dirty_resident;
+  else if (counter_name == "Shared_Clean")
+    counter = &region->byte_stats_shared_clean_resident;
+  else if (counter_name == "Swap")
+    counter = &region->byte_stats_swapped;
+  if (!counter)
+    return 0;
+
+  const char* pos = colon + 1;
+  while (pos < end && *pos == ' ')
+    ++pos;
   uint64_t counter_value = 0;
-  int res = sscanf(counter_line, "%*s %" SCNu64 " kB", &counter_value);
-  DCHECK_EQ(1, res);
-  return counter_value * 1024;
+  const char* digits = pos;
+  for (; pos < end && IsAsciiDigit(*pos); ++pos)
+    counter_value = counter_value * 10 + static_cast<uint64_t>(*pos - '0');
+  DCHECK_NE(digits, pos);
+  *counter = counter_value * 1024;
+  return 1;
 }
 
-uint32_t ParseSmapsCounter(char* counter_line,
-                           ProcessMemoryMaps::VMRegion* region) {
-  // A smaps counter lines looks as follows: "RSS:  0 Kb\n"
-  uint32_t res = 1;
-  char counter_name[20];
-  int did_read = sscanf(counter_line, "%19[^\n ]", counter_name);
-  DCHECK_EQ(1, did_read);
-
-  if (strcmp(counter_name, "Pss:") == 0) {
-    region->byte_stats_proportional_resident = ReadCounterBytes(counter_line);
-  } else if (strcmp(counter_name, "Private_Dirty:") == 0) {
-    region->byte_stats_private_dirty_resident = ReadCounterBytes(counter_line);
-  } else if (strcmp(counter_name, "Private_Clean:") == 0) {
-    region->byte_stats_private_clean_resident = ReadCounterBytes(counter_line);
-  } else if (strcmp(counter_name, "Shared_Dirty:") == 0) {
-    region->byte_stats_shared_dirty_resident = ReadCounterBytes(counter_line);
-  } else if (strcmp(counter_name, "Shared_Clean:") == 0) {
-    region->byte_stats_shared_clean_resident = ReadCounterBytes(counter_line);
-  } else if (strcmp(counter_name, "Swap:") == 0) {
-    region->byte_stats_swapped = ReadCounterBytes(counter_line);
+// Incremental parser state, carried across the chunks of the smaps file.
+struct SmapsParserState {
+  SmapsParserState()
+      : counters_parsed_for_current_region(0),
+        num_valid_regions(0),
+        should_add_current_region(false) {}
+
+  ProcessMemoryMaps::VMRegion region;
+  uint32_t counters_parsed_for_current_region;
+  uint32_t num_valid_regions;
+  bool should_add_current_region;
+};
+
+void ParseSmapsLine(const char* line,
+                    const char* end,
+                    SmapsParserState* state,
+                    ProcessMemoryMaps* pmm) {
+  if (line == end)
+    return;
+  if (isxdigit(line[0]) && !isupper(line[0])) {
+    state->region = ProcessMemoryMaps::VMRegion();
+    state->counters_parsed_for_current_region = 0;
+    state->should_add_current_region =
+        ParseSmapsHeader(line, end, &state->region);
   } else {
-    res = 0;
+    state->counters_parsed_for_current_region +=
+        ParseSmapsCounter(line, end, &state->region);
+    DCHECK_LE(state->counters_parsed_for_current_region,
+              kNumExpectedCountersPerRegion);
+    if (state->counters_parsed_for_current_region ==
+            kNumExpectedCountersPerRegion &&
+        state->should_add_current_region) {
+      pmm->AddVMRegion(state->region);
+      ++state->num_valid_regions;
+      state->should_add_current_region = false;
+    }
   }
-
-  return res;
 }
 
-uint32_t ReadLinuxProcSmapsFile(FILE* smaps_file, ProcessMemoryMaps* pmm) {
-  if (!smaps_file)
+// Parses a /proc/<pid>/smaps or /proc/<pid>/smaps_rollup file. The file is
+// read in large chunks and parsed in place, line by line, which is much
+// cheaper than fgets() + sscanf() for processes with many mappings.
+uint32_t ReadLinuxProcSmapsFile(int fd, ProcessMemoryMaps* pmm) {
+  if (fd < 0)
     return 0;
 
-  fseek(smaps_file, 0, SEEK_SET);
-
-  char line[kMaxLineSize];
-  const uint32_t kNumExpectedCountersPerRegion = 6;
-  uint32_t counters_parsed_for_current_region = 0;
-  uint32_t num_valid_regions = 0;
-  ProcessMemoryMaps::VMRegion region;
-  bool should_add_current_region = false;
+  scoped_ptr<char[]> buffer(new char[kReadChunkSize]);
+  SmapsParserState state;
+  off_t offset = 0;
+  size_t buffered = 0;
+  bool skipping_long_line = false;
   for (;;) {
-    line[0] = '\0';
-    if (fgets(line, kMaxLineSize, smaps_file) == nullptr)
+    ssize_t res = HANDLE_EINTR(pread(fd, buffer.get() + buffered,
+                                     kReadChunkSize - buffered, offset));
+    if (res < 0)
+      return 0;
+    offset += res;
+    buffered += res;
+    bool eof = res == 0;
+
+    const char* line = buffer.get();
+    const char* end = buffer.get() + buffered;
+    for (;;) {
+      const char* eol =
+          static_cast<const char*>(memchr(line, '\n', end - line));
+      if (!eol) {
+        if (!eof)
+          break;
+        // The last line may lack a trailing newline.
+        eol = end;
+      }
+      if (!skipping_long_line)
+        ParseSmapsLine(line, eol, &state, pmm);
+      skipping_long_line = false;
+      line = eol + (eol < end ? 1 : 0);
+      if (line == end)
+        break;
+    }
+    if (eof)
       break;
-    DCHECK_GT(strlen(line), 0u);
-    if (isxdigit(line[0]) && !isupper(line[0])) {
-      region = ProcessMemoryMaps::VMRegion();
-      counters_parsed_for_current_region = 0;
-      should_add_current_region = ParseSmapsHeader(line, &region);
+
+    buffered = end - line;
+    if (buffered > kMaxLineSize) {
+      // A line which does not fit; drop what we have and skip the rest of it.
+      buffered = 0;
+      skipping_long_line = true;
     } else {
-      counters_parsed_for_current_region += ParseSmapsCounter(line, &region);
-      DCHECK_LE(counters_parsed_for_current_region,
-                kNumExpectedCountersPerRegion);
-      if (counters_parsed_for_current_region == kNumExpectedCountersPerRegion) {
-        if (should_add_current_region) {
-          pmm->AddVMRegion(region);
-          ++num_valid_regions;
-          should_add_current_region = false;
-        }
-      }
+      memmove(buffer.get(), line, buffered);
     }
   }
-  return num_valid_regions;
+  return state.num_valid_regions;
+}
+
+uint32_t ReadLinuxProcSmapsFile(const char* path, ProcessMemoryMaps* pmm) {
+  ScopedFD fd(HANDLE_EINTR(open(path, O_RDONLY | O_CLOEXEC)));
+  return ReadLinuxProcSmapsFile(fd.get(), pmm);
 }
 
 }  // namespace
@@ -153,16 +272,28 @@ ProcessMemoryMapsDumpProvider::~ProcessMemoryMapsDumpProvider() {
 // the current process.
 bool ProcessMemoryMapsDumpProvider::OnMemoryDump(const MemoryDumpArgs& args,
                                                  ProcessMemoryDump* pmd) {
-  // Snapshot of memory maps is not taken for light dump requests.
-  if (args.level_of_detail == MemoryDumpLevelOfDetail::LIGHT)
+  uint32_t res = 0;
+  if (args.level_of_detail == MemoryDumpLevelOfDetail::LIGHT) {
+    // Light dumps only get the totals for the whole process, as a single
+    // region, from smaps_rollup. On kernels without smaps_rollup (< 4.14) no
+    // snapshot of the memory maps is taken for light dump requests.
+    if (UNLIKELY(proc_smaps_rollup_for_testing)) {
+      res = ReadLinuxProcSmapsFile(fileno(proc_smaps_rollup_for_testing),
+                                   pmd->process_mmaps());
+    } else {
+      res = ReadLinuxProcSmapsFile("/proc/self/smaps_rollup",
+                                   pmd->process_mmaps());
+    }
+    if (res > 0)
+      pmd->set_has_process_mmaps();
     return true;
+  }
 
-  uint32_t res = 0;
   if (UNLIKELY(proc_smaps_for_testing)) {
-    res = ReadLinuxProcSmapsFile(proc_smaps_for_testing, pmd->process_mmaps());
+    res = ReadLinuxProcSmapsFile(fileno(proc_smaps_for_testing),
+                                 pmd->process_mmaps());
   } else {
-    ScopedFILE smaps_file(fopen("/proc/self/smaps", "r"));
-    res = ReadLinuxProcSmapsFile(smaps_file.get(), pmd->process_mmaps());
+    res = ReadLinuxProcSmapsFile("/proc/self/smaps", pmd->process_mmaps());
   }
 
   if (res > 0) {
@@ -26,8 +26,13 @@ class BASE_EXPORT ProcessMemoryMapsDumpProvider : public MemoryDumpProvider {
  private:
   friend struct DefaultSingletonTraits<ProcessMemoryMapsDumpProvider>;
   FRIEND_TEST_ALL_PREFIXES(ProcessMemoryMapsDumpProviderTest, ParseProcSmaps);
+  FRIEND_TEST_ALL_PREFIXES(ProcessMemoryMapsDumpProviderTest,
+                           ParseProcSmapsRollup);
+  FRIEND_TEST_ALL_PREFIXES(ProcessMemoryMapsDumpProviderPerfTest,
+                           ParseLargeProcSmaps);
 
   static FILE* proc_smaps_for_testing;
+  static FILE* proc_smaps_rollup_for_testing;
 
   ProcessMemoryMapsDumpProvider();
   ~ProcessMemoryMapsDumpProvider() override;
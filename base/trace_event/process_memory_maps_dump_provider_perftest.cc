@@ -0,0 +1,102 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/process_memory_maps_dump_provider.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_file.h"
+#include "base/format_macros.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/trace_event/process_memory_dump.h"
+#include "base/trace_event/process_memory_maps.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+const size_t kNumRegions = 50000;
+const int kNumIterations = 5;
+
+// Generates a synthetic /proc/self/smaps with |num_regions| regions, half of
+// them file-backed, in the format of a 4.x kernel.
+std::string GenerateSmaps(size_t num_regions) {
+  std::string smaps;
+  uint64_t address = 0x7f0000000000;
+  for (size_t i = 0; i < num_regions; ++i) {
+    const uint64_t size_kb = 4 * (1 + i % 64);
+    StringAppendF(&smaps,
+                  "%012" PRIx64 "-%012" PRIx64 " r%sp %08x fc:01 %" PRIuS " ",
+                  address, address + size_kb * 1024, i % 3 ? "w-" : "-x",
+                  static_cast<unsigned>(i * 4096), i % 2 ? i : 0);
+    if (i % 2) {
+      StringAppendF(&smaps, "                  /usr/lib/libfoo%" PRIuS ".so",
+                    i);
+    }
+    smaps += "\n";
+    StringAppendF(&smaps,
+                  "Size:           %8" PRIu64 " kB\n"
+                  "Rss:            %8" PRIu64 " kB\n"
+                  "Pss:            %8" PRIu64 " kB\n"
+                  "Shared_Clean:          4 kB\n"
+                  "Shared_Dirty:          0 kB\n"
+                  "Private_Clean:         0 kB\n"
+                  "Private_Dirty: %8" PRIu64 " kB\n"
+                  "Referenced:            4 kB\n"
+                  "Anonymous:             0 kB\n"
+                  "AnonHugePages:         0 kB\n"
+                  "Swap:                  0 kB\n"
+                  "KernelPageSize:        4 kB\n"
+                  "MMUPageSize:           4 kB\n"
+                  "Locked:                0 kB\n"
+                  "VmFlags: rd wr mr mw me ac sd\n",
+                  size_kb, size_kb, size_kb / 2, size_kb - 4);
+    address += size_kb * 1024 + 4096;
+  }
+  return smaps;
+}
+
+}  // namespace
+
+TEST(ProcessMemoryMapsDumpProviderPerfTest, ParseLargeProcSmaps) {
+  const std::string smaps = GenerateSmaps(kNumRegions);
+  FilePath temp_path;
+  ScopedFILE temp_file(CreateAndOpenTemporaryFile(&temp_path));
+  ASSERT_TRUE(temp_file.get());
+  ASSERT_TRUE(WriteFileDescriptor(fileno(temp_file.get()), smaps.data(),
+                                  smaps.size()));
+  ProcessMemoryMapsDumpProvider::proc_smaps_for_testing = temp_file.get();
+
+  const MemoryDumpArgs dump_args = {MemoryDumpLevelOfDetail::DETAILED};
+  auto pmmdp = ProcessMemoryMapsDumpProvider::GetInstance();
+  TimeDelta total;
+  for (int i = 0; i < kNumIterations; ++i) {
+    ProcessMemoryDump pmd(nullptr /* session_state */);
+    TimeTicks start = TimeTicks::Now();
+    ASSERT_TRUE(pmmdp->OnMemoryDump(dump_args, &pmd));
+    total += TimeTicks::Now() - start;
+    ASSERT_EQ(kNumRegions, pmd.process_mmaps()->vm_regions().size());
+  }
+  ProcessMemoryMapsDumpProvider::proc_smaps_for_testing = nullptr;
+  DeleteFile(temp_path, false);
+
+  perf_test::PrintResult("smaps_parse_time", "", "50k_regions",
+                         total.InMillisecondsF() / kNumIterations, "ms",
+                         true);
+  perf_test::PrintResult("smaps_parse_throughput", "", "50k_regions",
+                         smaps.size() * kNumIterations /
+                             total.InSecondsF() / (1024 * 1024),
+                         "MB/s", false);
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -104,6 +104,21 @@ const char kTestSmaps2[] =
     "Locked:                0 kB\n"
     "VmFlags: rd wr mr mw me ac sd\n";
 
+const char kTestSmapsRollup[] =
+    "00400000-ffffffffff601000 ---p 00000000 00:00 0           [rollup]\n"
+    "Rss:                9276 kB\n"
+    "Pss:                4735 kB\n"
+    "Shared_Clean:       4404 kB\n"
+    "Shared_Dirty:          0 kB\n"
+    "Private_Clean:       324 kB\n"
+    "Private_Dirty:      4548 kB\n"
+    "Referenced:         9276 kB\n"
+    "Anonymous:          4548 kB\n"
+    "AnonHugePages:         0 kB\n"
+    "Swap:                 12 kB\n"
+    "SwapPss:              12 kB\n"
+    "Locked:                0 kB\n";
+
 void CreateAndSetSmapsFileForTesting(const char* smaps_string,
                                      ScopedFILE& file) {
   FilePath temp_path;
@@ -186,5 +201,38 @@ TEST(ProcessMemoryMapsDumpProviderTest, ParseProcSmaps) {
   EXPECT_EQ(0 * 1024UL, regions_2[0].byte_stats_swapped);
 }
 
+TEST(ProcessMemoryMapsDumpProviderTest, ParseProcSmapsRollup) {
+  const MemoryDumpArgs dump_args = {MemoryDumpLevelOfDetail::LIGHT};
+  auto pmmdp = ProcessMemoryMapsDumpProvider::GetInstance();
+
+  // A missing or empty smaps_rollup (older kernels) is not an error.
+  ProcessMemoryDump pmd_invalid(nullptr /* session_state */);
+  ScopedFILE empty_file(OpenFile(FilePath("/dev/null"), "r"));
+  ASSERT_TRUE(empty_file.get());
+  ProcessMemoryMapsDumpProvider::proc_smaps_rollup_for_testing =
+      empty_file.get();
+  EXPECT_TRUE(pmmdp->OnMemoryDump(dump_args, &pmd_invalid));
+  ASSERT_FALSE(pmd_invalid.has_process_mmaps());
+
+  ProcessMemoryDump pmd(nullptr /* session_state */);
+  ScopedFILE temp_file;
+  CreateAndSetSmapsFileForTesting(kTestSmapsRollup, temp_file);
+  ProcessMemoryMapsDumpProvider::proc_smaps_rollup_for_testing =
+      temp_file.get();
+  EXPECT_TRUE(pmmdp->OnMemoryDump(dump_args, &pmd));
+  ProcessMemoryMapsDumpProvider::proc_smaps_rollup_for_testing = nullptr;
+  ASSERT_TRUE(pmd.has_process_mmaps());
+  const auto& regions = pmd.process_mmaps()->vm_regions();
+  ASSERT_EQ(1UL, regions.size());
+  EXPECT_EQ(0x00400000UL, regions[0].start_address);
+  EXPECT_EQ("[rollup]", regions[0].mapped_file);
+  EXPECT_EQ(4735 * 1024UL, regions[0].byte_stats_proportional_resident);
+  EXPECT_EQ(4404 * 1024UL, regions[0].byte_stats_shared_clean_resident);
+  EXPECT_EQ(0UL, regions[0].byte_stats_shared_dirty_resident);
+  EXPECT_EQ(324 * 1024UL, regions[0].byte_stats_private_clean_resident);
+  EXPECT_EQ(4548 * 1024UL, regions[0].byte_stats_private_dirty_resident);
+  EXPECT_EQ(12 * 1024UL, regions[0].byte_stats_swapped);
+}
+
 }  // namespace trace_event
 }  // namespace base
@@ -6,6 +6,7 @@
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <utility>
 
 #include "base/json/json_reader.h"
@@ -74,6 +75,14 @@ class ConvertableTraceConfigToTraceFormat
   const TraceConfig trace_config_;
 };
 
+bool IsDisabledByDefault(const StringPiece& category) {
+  return category.starts_with(TRACE_DISABLED_BY_DEFAULT(""));
+}
+
+bool IsNameLessThan(const std::string& name, const StringPiece& category) {
+  return StringPiece(name) < category;
+}
+
 }  // namespace
 
 TraceConfig::TraceConfig() {
@@ -176,62 +185,7 @@ bool TraceConfig::IsCategoryGroupEnabled(
     const char* category_group_name) const {
   // TraceLog should call this method only as part of enabling/disabling
   // categories.
-
-  bool had_enabled_by_default = false;
-  DCHECK(category_group_name);
-  CStringTokenizer category_group_tokens(
-      category_group_name, category_group_name + strlen(category_group_name),
-      ",");
-  while (category_group_tokens.GetNext()) {
-    std::string category_group_token = category_group_tokens.token();
-    // Don't allow empty tokens, nor tokens with leading or trailing space.
-    DCHECK(!TraceConfig::IsEmptyOrContainsLeadingOrTrailingWhitespace(
-               category_group_token))
-        << "Disallowed category string";
-    if (IsCategoryEnabled(category_group_token.c_str())) {
-      return true;
-    }
-    if (!base::MatchPattern(category_group_token.c_str(),
-                            TRACE_DISABLED_BY_DEFAULT("*")))
-      had_enabled_by_default = true;
-  }
-  // Do a second pass to check for explicitly disabled categories
-  // (those explicitly enabled have priority due to first pass).
-  category_group_tokens.Reset();
-  bool category_group_disabled = false;
-  while (category_group_tokens.GetNext()) {
-    std::string category_group_token = category_group_tokens.token();
-    for (StringList::const_iterator ci = excluded_categories_.begin();
-         ci != excluded_categories_.end();
-         ++ci) {
-      if (base::MatchPattern(category_group_token.c_str(), ci->c_str())) {
-        // Current token of category_group_name is present in excluded_list.
-        // Flag the exclusion and proceed further to check if any of the
-        // remaining categories of category_group_name is not present in the
-        // excluded_ list.
-        category_group_disabled = true;
-        break;
-      }
-      // One of the category of category_group_name is not present in
-      // excluded_ list. So, if it's not a disabled-by-default category,
-      // it has to be included_ list. Enable the category_group_name
-      // for recording.
-      if (!base::MatchPattern(category_group_token.c_str(),
-                              TRACE_DISABLED_BY_DEFAULT("*"))) {
-        category_group_disabled = false;
-      }
-    }
-    // One of the categories present in category_group_name is not present in
-    // excluded_ list. Implies this category_group_name group can be enabled
-    // for recording, since one of its groups is enabled for recording.
-    if (!category_group_disabled)
-      break;
-  }
-  // If the category group is not excluded, and there are no included patterns
-  // we consider this category group enabled, as long as it had categories
-  // other than disabled-by-default.
-  return !category_group_disabled &&
-         included_categories_.empty() && had_enabled_by_default;
+  return CategoryMatcher(*this).IsCategoryGroupEnabled(category_group_name);
 }
 
 void TraceConfig::Merge(const TraceConfig& config) {
@@ -632,28 +586,7 @@ void TraceConfig::WriteCategoryFilterString(const StringList& delays,
 }
 
 bool TraceConfig::IsCategoryEnabled(const char* category_name) const {
-  StringList::const_iterator ci;
-
-  // Check the disabled- filters and the disabled-* wildcard first so that a
-  // "*" filter does not include the disabled.
-  for (ci = disabled_categories_.begin();
-       ci != disabled_categories_.end();
-       ++ci) {
-    if (base::MatchPattern(category_name, ci->c_str()))
-      return true;
-  }
-
-  if (base::MatchPattern(category_name, TRACE_DISABLED_BY_DEFAULT("*")))
-    return false;
-
-  for (ci = included_categories_.begin();
-       ci != included_categories_.end();
-       ++ci) {
-    if (base::MatchPattern(category_name, ci->c_str()))
-      return true;
-  }
-
-  return false;
+  return CategoryMatcher(*this).IsCategoryEnabled(category_name);
 }
 
 bool TraceConfig::IsEmptyOrContainsLeadingOrTrailingWhitespace(
@@ -667,5 +600,125 @@ bool TraceConfig::HasIncludedPatterns() const {
   return !included_categories_.empty();
 }
 
+TraceConfig::CategoryMatcher::CategoryMatcher() {
+}
+
+TraceConfig::CategoryMatcher::CategoryMatcher(const TraceConfig& config)
+    : included_(config.included_categories_),
+      disabled_(config.disabled_categories_),
+      excluded_(config.excluded_categories_) {}
+
+TraceConfig::CategoryMatcher::CategoryMatcher(const CategoryMatcher& other) =
+    default;
+
+TraceConfig::CategoryMatcher::~CategoryMatcher() {
+}
+
+TraceConfig::CategoryMatcher& TraceConfig::CategoryMatcher::operator=(
+    const CategoryMatcher& rhs) = default;
+
+bool TraceConfig::CategoryMatcher::IsCategoryGroupEnabled(
+    const char* category_group_name) const {
+  bool had_enabled_by_default = false;
+  DCHECK(category_group_name);
+  CStringTokenizer category_group_tokens(
+      category_group_name, category_group_name + strlen(category_group_name),
+      ",");
+  while (category_group_tokens.GetNext()) {
+    StringPiece category_group_token = category_group_tokens.token_piece();
+    // Don't allow empty tokens, nor tokens with leading or trailing space.
+    DCHECK(!TraceConfig::IsEmptyOrContainsLeadingOrTrailingWhitespace(
+               category_group_token.as_string()))
+        << "Disallowed category string";
+    if (IsCategoryEnabled(category_group_token))
+      return true;
+    if (!IsDisabledByDefault(category_group_token))
+      had_enabled_by_default = true;
+  }
+  // Do a second pass to check for explicitly disabled categories
+  // (those explicitly enabled have priority due to first pass).
+  category_group_tokens.Reset();
+  bool category_group_disabled = false;
+  while (category_group_tokens.GetNext()) {
+    StringPiece category_group_token = category_group_tokens.token_piece();
+    if (excluded_.Matches(category_group_token)) {
+      // Current token of category_group_name is present in excluded_list.
+      // Flag the exclusion and proceed further to check if any of the
+      // remaining categories of category_group_name is not present in the
+      // excluded_ list.
+      category_group_disabled = true;
+    } else if (!excluded_.empty() &&
+               !IsDisabledByDefault(category_group_token)) {
+      // One of the category of category_group_name is not present in
+      // excluded_ list. So, if it's not a disabled-by-default category,
+      // it has to be included_ list. Enable the category_group_name
+      // for recording.
+      category_group_disabled = false;
+    }
+    // One of the categories present in category_group_name is not present in
+    // excluded_ list. Implies this category_group_name group can be enabled
+    // for recording, since one of its groups is enabled for recording.
+    if (!category_group_disabled)
+      break;
+  }
+  // If the category group is not excluded, and there are no included patterns
+  // we consider this category group enabled, as long as it had categories
+  // other than disabled-by-default.
+  return !category_group_disabled && included_.empty() &&
+         had_enabled_by_default;
+}
+
+bool TraceConfig::CategoryMatcher::IsCategoryEnabled(
+    const StringPiece& category) const {
+  // Check the disabled- filters and the disabled-* wildcard first so that a
+  // "*" filter does not include the disabled.
+  if (disabled_.Matches(category))
+    return true;
+  if (IsDisabledByDefault(category))
+    return false;
+  return included_.Matches(category);
+}
+
+TraceConfig::CategoryMatcher::PatternSet::PatternSet() : empty_(true) {
+}
+
+TraceConfig::CategoryMatcher::PatternSet::PatternSet(
+    const StringList& patterns)
+    : empty_(patterns.empty()) {
+  for (const std::string& pattern : patterns) {
+    const size_t wildcard = pattern.find_first_of("*?\\");
+    if (wildcard == std::string::npos)
+      names_.push_back(pattern);
+    else if (wildcard == pattern.size() - 1 && pattern[wildcard] == '*')
+      prefixes_.push_back(pattern.substr(0, wildcard));
+    else
+      patterns_.push_back(pattern);
+  }
+  std::sort(names_.begin(), names_.end());
+}
+
+TraceConfig::CategoryMatcher::PatternSet::PatternSet(const PatternSet& other) =
+    default;
+
+TraceConfig::CategoryMatcher::PatternSet::~PatternSet() {
+}
+
+bool TraceConfig::CategoryMatcher::PatternSet::Matches(
+    const StringPiece& category) const {
+  StringList::const_iterator name = std::lower_bound(
+      names_.begin(), names_.end(), category, &IsNameLessThan);
+  if (name != names_.end() && category == *name)
+    return true;
+  for (const std::string& prefix : prefixes_) {
+    if (category.starts_with(prefix))
+      return true;
+  }
+  for (const std::string& pattern : patterns_) {
+    if (MatchPattern(category, pattern))
+      return true;
+  }
+  return false;
+}
+
 }  // namespace trace_event
 }  // namespace base
@@ -12,6 +12,7 @@
 
 #include "base/base_export.h"
 #include "base/gtest_prod_util.h"
+#include "base/strings/string_piece.h"
 #include "base/trace_event/memory_dump_request_args.h"
 #include "base/values.h"
 
@@ -49,6 +50,48 @@ class BASE_EXPORT TraceConfig {
 
   typedef std::vector<MemoryDumpTriggerConfig> MemoryDumpConfig;
 
+  // The category filters of a TraceConfig, compiled to be matched against
+  // many category groups, as TraceLog does each time its config changes.
+  // Names without wildcards are looked up in sorted lists, and prefixes such
+  // as "cc*" are compared without MatchPattern().
+  class BASE_EXPORT CategoryMatcher {
+   public:
+    CategoryMatcher();
+    explicit CategoryMatcher(const TraceConfig& config);
+    CategoryMatcher(const CategoryMatcher& other);
+    ~CategoryMatcher();
+
+    CategoryMatcher& operator=(const CategoryMatcher& rhs);
+
+    // Same as TraceConfig::IsCategoryGroupEnabled() for |config|.
+    bool IsCategoryGroupEnabled(const char* category_group) const;
+
+    // Returns true if the single |category| is enabled by |config|.
+    bool IsCategoryEnabled(const StringPiece& category) const;
+
+   private:
+    class PatternSet {
+     public:
+      PatternSet();
+      explicit PatternSet(const StringList& patterns);
+      PatternSet(const PatternSet& other);
+      ~PatternSet();
+
+      bool Matches(const StringPiece& category) const;
+      bool empty() const { return empty_; }
+
+     private:
+      StringList names_;
+      StringList prefixes_;
+      StringList patterns_;
+      bool empty_;
+    };
+
+    PatternSet included_;
+    PatternSet disabled_;
+    PatternSet excluded_;
+  };
+
   TraceConfig();
 
   // Create TraceConfig object from category filter and trace options strings.
@@ -184,6 +227,7 @@ class BASE_EXPORT TraceConfig {
   FRIEND_TEST_ALL_PREFIXES(TraceConfigTest, TraceConfigFromMemoryConfigString);
   FRIEND_TEST_ALL_PREFIXES(TraceConfigTest, LegacyStringToMemoryDumpConfig);
   FRIEND_TEST_ALL_PREFIXES(TraceConfigTest, EmptyMemoryDumpConfigTest);
+  FRIEND_TEST_ALL_PREFIXES(TraceConfigTest, CategoryMatcher);
 
   // The default trace config, used when none is provided.
   // Allows all non-disabled-by-default categories through, except if they end
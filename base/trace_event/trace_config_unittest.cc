@@ -3,8 +3,13 @@
 // found in the LICENSE file.
 
 #include <stddef.h>
+#include <string.h>
+
+#include <string>
 
 #include "base/macros.h"
+#include "base/strings/pattern.h"
+#include "base/strings/string_tokenizer.h"
 #include "base/trace_event/memory_dump_manager.h"
 #include "base/trace_event/trace_config.h"
 #include "base/trace_event/trace_config_memory_test_util.h"
@@ -23,6 +28,69 @@ const char kDefaultTraceConfigString[] =
     "\"excluded_categories\":[\"*Debug\",\"*Test\"],"
     "\"record_mode\":\"record-until-full\""
   "}";
+
+// The category matching of TraceConfig before CategoryMatcher, with
+// MatchPattern(), which the matcher must agree with.
+class ReferenceCategoryMatcher {
+ public:
+  ReferenceCategoryMatcher(const TraceConfig::StringList& included,
+                           const TraceConfig::StringList& disabled,
+                           const TraceConfig::StringList& excluded)
+      : included_(included), disabled_(disabled), excluded_(excluded) {}
+
+  bool IsCategoryGroupEnabled(const char* category_group_name) const {
+    bool had_enabled_by_default = false;
+    CStringTokenizer tokens(category_group_name,
+                            category_group_name + strlen(category_group_name),
+                            ",");
+    while (tokens.GetNext()) {
+      const std::string token = tokens.token();
+      if (IsCategoryEnabled(token.c_str()))
+        return true;
+      if (!MatchPattern(token, TRACE_DISABLED_BY_DEFAULT("*")))
+        had_enabled_by_default = true;
+    }
+    tokens.Reset();
+    bool category_group_disabled = false;
+    while (tokens.GetNext()) {
+      const std::string token = tokens.token();
+      for (const std::string& excluded : excluded_) {
+        if (MatchPattern(token, excluded)) {
+          category_group_disabled = true;
+          break;
+        }
+        if (!MatchPattern(token, TRACE_DISABLED_BY_DEFAULT("*")))
+          category_group_disabled = false;
+      }
+      if (!category_group_disabled)
+        break;
+    }
+    return !category_group_disabled && included_.empty() &&
+           had_enabled_by_default;
+  }
+
+ private:
+  bool IsCategoryEnabled(const char* category_name) const {
+    for (const std::string& disabled : disabled_) {
+      if (MatchPattern(category_name, disabled))
+        return true;
+    }
+    if (MatchPattern(category_name, TRACE_DISABLED_BY_DEFAULT("*")))
+      return false;
+    for (const std::string& included : included_) {
+      if (MatchPattern(category_name, included))
+        return true;
+    }
+    return false;
+  }
+
+  const TraceConfig::StringList& included_;
+  const TraceConfig::StringList& disabled_;
+  const TraceConfig::StringList& excluded_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReferenceCategoryMatcher);
+};
+
 }  // namespace
 
 TEST(TraceConfigTest, TraceConfigFromValidLegacyFormat) {
@@ -459,6 +527,52 @@ TEST(TraceConfigTest, IsCategoryGroupEnabled) {
   EXPECT_FALSE(tc.IsCategoryGroupEnabled("excluded,disabled-by-default-cc"));
 }
 
+TEST(TraceConfigTest, CategoryMatcher) {
+  // Names, prefixes and other patterns are matched differently.
+  TraceConfig tc("cc,gpu*,v?8,a\\*b,disabled-by-default-ipc*", "");
+  TraceConfig::CategoryMatcher matcher(tc);
+  EXPECT_TRUE(matcher.IsCategoryGroupEnabled("cc"));
+  EXPECT_FALSE(matcher.IsCategoryGroupEnabled("ccc"));
+  EXPECT_TRUE(matcher.IsCategoryGroupEnabled("gpu"));
+  EXPECT_TRUE(matcher.IsCategoryGroupEnabled("gpu.service"));
+  EXPECT_FALSE(matcher.IsCategoryGroupEnabled("gp"));
+  EXPECT_TRUE(matcher.IsCategoryGroupEnabled("v8"));
+  EXPECT_TRUE(matcher.IsCategoryGroupEnabled("vx8"));
+  EXPECT_FALSE(matcher.IsCategoryGroupEnabled("vxx8"));
+  EXPECT_TRUE(matcher.IsCategoryGroupEnabled("a*b"));
+  EXPECT_FALSE(matcher.IsCategoryGroupEnabled("axb"));
+  EXPECT_TRUE(matcher.IsCategoryGroupEnabled("disabled-by-default-ipc.flow"));
+  EXPECT_FALSE(matcher.IsCategoryGroupEnabled("disabled-by-default-cc"));
+  EXPECT_TRUE(matcher.IsCategoryGroupEnabled("other,cc"));
+  EXPECT_FALSE(matcher.IsCategoryGroupEnabled("other"));
+
+  // The matcher matches as MatchPattern() on the filters did.
+  const char* const kFilters[] = {
+      "", "*", "-*Debug,-*Test", "included,-excluded", "-excluded*",
+      "disabled-by-default-cc,-excluded", "disabled-by-default-*,inc*",
+      "cc,gpu*,v?8,a\\*b,disabled-by-default-ipc*", "*,-cc*", "-*",
+      "in?luded,ex*ed", "disabled-by-default-c?"};
+  const char* const kCategoryGroups[] = {
+      "included", "excluded", "excluded_too", "included,excluded",
+      "excluded,disabled-by-default-cc", "disabled-by-default-cc",
+      "disabled-by-default-gpu", "inc", "someDebug", "someDebug,other",
+      "cc", "ccc", "gpu.service", "v8", "vxx8", "a*b", "axb",
+      "disabled-by-default-ipc.flow", "cc,disabled-by-default-cc", "exed",
+      "inXluded"};
+  for (const char* filter : kFilters) {
+    tc = TraceConfig(filter, "");
+    matcher = TraceConfig::CategoryMatcher(tc);
+    ReferenceCategoryMatcher reference(tc.included_categories_,
+                                       tc.disabled_categories_,
+                                       tc.excluded_categories_);
+    for (const char* category_group : kCategoryGroups) {
+      EXPECT_EQ(reference.IsCategoryGroupEnabled(category_group),
+                matcher.IsCategoryGroupEnabled(category_group))
+          << filter << " " << category_group;
+    }
+  }
+}
+
 TEST(TraceConfigTest, IsEmptyOrContainsLeadingOrTrailingWhitespace) {
   // Test that IsEmptyOrContainsLeadingOrTrailingWhitespace actually catches
   // categories that are explicitly forbidden.
@@ -5,11 +5,13 @@
 #include "base/trace_event/trace_event_argument.h"
 
 #include <stdint.h>
+#include <string.h>
 
+#include <algorithm>
 #include <utility>
 
-#include "base/bits.h"
-#include "base/json/json_writer.h"
+#include "base/json/string_escape.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/trace_event/trace_event_memory_overhead.h"
 #include "base/values.h"
 
@@ -41,39 +43,245 @@ const bool kStackTypeArray = true;
 #define DEBUG_POP_CONTAINER() do {} while (0)
 #endif
 
-inline void WriteKeyNameAsRawPtr(Pickle& pickle, const char* ptr) {
-  pickle.WriteBytes(&kTypeCStr, 1);
-  pickle.WriteUInt64(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr)));
+// Reads the encoding which TracedValue writes. In a dictionary each member is
+// its type, its name and its value; in an array each element is its type and
+// its value. Integers and lengths are varints, doubles and name pointers are
+// copied as they are.
+class Reader {
+ public:
+  Reader(const char* begin, const char* end) : pos_(begin), end_(end) {}
+
+  bool AtEnd() const { return pos_ == end_; }
+  const char* pos() const { return pos_; }
+  const char* end() const { return end_; }
+
+  char ReadType() {
+    DCHECK(!AtEnd());
+    return *pos_++;
+  }
+
+  uint64_t ReadVarint() {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      DCHECK(!AtEnd());
+      const uint8_t byte = static_cast<uint8_t>(*pos_++);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return value;
+    }
+  }
+
+  bool ReadBool() { return ReadType() != 0; }
+
+  int ReadInt() {
+    const uint32_t zigzag = static_cast<uint32_t>(ReadVarint());
+    return static_cast<int>((zigzag >> 1) ^ (0u - (zigzag & 1)));
+  }
+
+  double ReadDouble() {
+    double value;
+    Read(&value, sizeof(value));
+    return value;
+  }
+
+  StringPiece ReadString() {
+    const size_t length = static_cast<size_t>(ReadVarint());
+    DCHECK_LE(length, static_cast<size_t>(end_ - pos_));
+    StringPiece value(pos_, length);
+    pos_ += length;
+    return value;
+  }
+
+  StringPiece ReadKeyName() {
+    if (ReadType() == kTypeString)
+      return ReadString();
+    const char* name;
+    Read(&name, sizeof(name));
+    return name;
+  }
+
+  // Skips the value of type |type|.
+  void SkipValue(char type) {
+    switch (type) {
+      case kTypeStartDict:
+        for (char member_type = ReadType(); member_type != kTypeEndDict;
+             member_type = ReadType()) {
+          ReadKeyName();
+          SkipValue(member_type);
+        }
+        break;
+      case kTypeStartArray:
+        for (char element_type = ReadType(); element_type != kTypeEndArray;
+             element_type = ReadType()) {
+          SkipValue(element_type);
+        }
+        break;
+      case kTypeBool:
+        ReadBool();
+        break;
+      case kTypeInt:
+        ReadVarint();
+        break;
+      case kTypeDouble:
+        ReadDouble();
+        break;
+      case kTypeString:
+        ReadString();
+        break;
+      default:
+        NOTREACHED();
+    }
+  }
+
+ private:
+  void Read(void* value, size_t size) {
+    DCHECK_LE(size, static_cast<size_t>(end_ - pos_));
+    memcpy(value, pos_, size);
+    pos_ += size;
+  }
+
+  const char* pos_;
+  const char* const end_;
+
+  DISALLOW_COPY_AND_ASSIGN(Reader);
+};
+
+// A member of a dictionary, and where its value is encoded.
+struct DictionaryMember {
+  StringPiece name;
+  char type;
+  const char* value;
+};
+
+bool DictionaryMemberNameLess(const DictionaryMember& a,
+                              const DictionaryMember& b) {
+  return a.name < b.name;
 }
 
-inline void WriteKeyNameWithCopy(Pickle& pickle, base::StringPiece str) {
-  pickle.WriteBytes(&kTypeString, 1);
-  pickle.WriteString(str);
+void AppendDictionaryAsJSON(Reader* reader, std::string* out);
+
+void AppendValueAsJSON(char type, Reader* reader, std::string* out) {
+  char buffer[kMaxNumberStringLength];
+  switch (type) {
+    case kTypeStartDict:
+      AppendDictionaryAsJSON(reader, out);
+      break;
+    case kTypeStartArray: {
+      out->push_back('[');
+      bool first = true;
+      for (char element_type = reader->ReadType();
+           element_type != kTypeEndArray; element_type = reader->ReadType()) {
+        if (!first)
+          out->push_back(',');
+        first = false;
+        AppendValueAsJSON(element_type, reader, out);
+      }
+      out->push_back(']');
+    } break;
+    case kTypeBool:
+      out->append(reader->ReadBool() ? "true" : "false");
+      break;
+    case kTypeInt:
+      out->append(buffer, Int64ToBuffer(reader->ReadInt(), buffer));
+      break;
+    case kTypeDouble:
+      out->append(buffer, DoubleToBuffer(reader->ReadDouble(), buffer));
+      break;
+    case kTypeString:
+      EscapeJSONString(reader->ReadString(), true, out);
+      break;
+    default:
+      NOTREACHED();
+  }
 }
 
-std::string ReadKeyName(PickleIterator& pickle_iterator) {
-  const char* type = nullptr;
-  bool res = pickle_iterator.ReadBytes(&type, 1);
-  std::string key_name;
-  if (res && *type == kTypeCStr) {
-    uint64_t ptr_value = 0;
-    res = pickle_iterator.ReadUInt64(&ptr_value);
-    key_name = reinterpret_cast<const char*>(static_cast<uintptr_t>(ptr_value));
-  } else if (res && *type == kTypeString) {
-    res = pickle_iterator.ReadString(&key_name);
+// Writes the members of a dictionary sorted by name, and only the last one of
+// each name, as JSONWriter writes a DictionaryValue. The dictionary ends at
+// kTypeEndDict, or at the end of |reader| for the outermost one.
+void AppendDictionaryAsJSON(Reader* reader, std::string* out) {
+  std::vector<DictionaryMember> members;
+  while (!reader->AtEnd()) {
+    DictionaryMember member;
+    member.type = reader->ReadType();
+    if (member.type == kTypeEndDict)
+      break;
+    member.name = reader->ReadKeyName();
+    member.value = reader->pos();
+    reader->SkipValue(member.type);
+    members.push_back(member);
+  }
+  std::stable_sort(members.begin(), members.end(), &DictionaryMemberNameLess);
+
+  out->push_back('{');
+  bool first = true;
+  for (size_t i = 0; i < members.size(); ++i) {
+    if (i + 1 < members.size() && members[i + 1].name == members[i].name)
+      continue;
+    if (!first)
+      out->push_back(',');
+    first = false;
+    EscapeJSONString(members[i].name, true, out);
+    out->push_back(':');
+    Reader value_reader(members[i].value, reader->end());
+    AppendValueAsJSON(members[i].type, &value_reader, out);
   }
-  DCHECK(res);
-  return key_name;
+  out->push_back('}');
 }
+
+void ReadDictionary(Reader* reader, DictionaryValue* dict);
+
+scoped_ptr<Value> ReadValue(char type, Reader* reader) {
+  switch (type) {
+    case kTypeStartDict: {
+      scoped_ptr<DictionaryValue> dict(new DictionaryValue);
+      ReadDictionary(reader, dict.get());
+      return dict;
+    }
+    case kTypeStartArray: {
+      scoped_ptr<ListValue> list(new ListValue);
+      for (char element_type = reader->ReadType();
+           element_type != kTypeEndArray; element_type = reader->ReadType()) {
+        list->Append(ReadValue(element_type, reader));
+      }
+      return list;
+    }
+    case kTypeBool:
+      return make_scoped_ptr(new FundamentalValue(reader->ReadBool()));
+    case kTypeInt:
+      return make_scoped_ptr(new FundamentalValue(reader->ReadInt()));
+    case kTypeDouble:
+      return make_scoped_ptr(new FundamentalValue(reader->ReadDouble()));
+    case kTypeString:
+      return make_scoped_ptr(new StringValue(reader->ReadString().as_string()));
+    default:
+      NOTREACHED();
+      return nullptr;
+  }
+}
+
+void ReadDictionary(Reader* reader, DictionaryValue* dict) {
+  while (!reader->AtEnd()) {
+    const char type = reader->ReadType();
+    if (type == kTypeEndDict)
+      break;
+    const StringPiece name = reader->ReadKeyName();
+    dict->SetWithoutPathExpansion(name.as_string(), ReadValue(type, reader));
+  }
+}
+
 }  // namespace
 
 TracedValue::TracedValue() : TracedValue(0) {
 }
 
-TracedValue::TracedValue(size_t capacity) {
+TracedValue::TracedValue(size_t capacity)
+    : data_(inline_buffer_), size_(0), capacity_(kInlineCapacity) {
   DEBUG_PUSH_CONTAINER(kStackTypeDict);
-  if (capacity)
-    pickle_.Reserve(capacity);
+  if (capacity > kInlineCapacity) {
+    heap_buffer_.reset(new char[capacity]);
+    data_ = heap_buffer_.get();
+    capacity_ = capacity;
+  }
 }
 
 TracedValue::~TracedValue() {
@@ -84,68 +292,67 @@ TracedValue::~TracedValue() {
 
 void TracedValue::SetInteger(const char* name, int value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeInt, 1);
-  pickle_.WriteInt(value);
-  WriteKeyNameAsRawPtr(pickle_, name);
+  WriteType(kTypeInt);
+  WriteKeyNameAsRawPtr(name);
+  WriteInt(value);
 }
 
 void TracedValue::SetIntegerWithCopiedName(base::StringPiece name, int value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeInt, 1);
-  pickle_.WriteInt(value);
-  WriteKeyNameWithCopy(pickle_, name);
+  WriteType(kTypeInt);
+  WriteKeyNameWithCopy(name);
+  WriteInt(value);
 }
 
 void TracedValue::SetDouble(const char* name, double value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeDouble, 1);
-  pickle_.WriteDouble(value);
-  WriteKeyNameAsRawPtr(pickle_, name);
+  WriteType(kTypeDouble);
+  WriteKeyNameAsRawPtr(name);
+  WriteDouble(value);
 }
 
 void TracedValue::SetDoubleWithCopiedName(base::StringPiece name,
                                           double value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeDouble, 1);
-  pickle_.WriteDouble(value);
-  WriteKeyNameWithCopy(pickle_, name);
+  WriteType(kTypeDouble);
+  WriteKeyNameWithCopy(name);
+  WriteDouble(value);
 }
 
 void TracedValue::SetBoolean(const char* name, bool value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeBool, 1);
-  pickle_.WriteBool(value);
-  WriteKeyNameAsRawPtr(pickle_, name);
+  WriteType(kTypeBool);
+  WriteKeyNameAsRawPtr(name);
+  WriteBool(value);
 }
 
 void TracedValue::SetBooleanWithCopiedName(base::StringPiece name,
                                            bool value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeBool, 1);
-  pickle_.WriteBool(value);
-  WriteKeyNameWithCopy(pickle_, name);
+  WriteType(kTypeBool);
+  WriteKeyNameWithCopy(name);
+  WriteBool(value);
 }
 
 void TracedValue::SetString(const char* name, base::StringPiece value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeString, 1);
-  pickle_.WriteString(value);
-  WriteKeyNameAsRawPtr(pickle_, name);
+  WriteType(kTypeString);
+  WriteKeyNameAsRawPtr(name);
+  WriteString(value);
 }
 
 void TracedValue::SetStringWithCopiedName(base::StringPiece name,
                                           base::StringPiece value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeString, 1);
-  pickle_.WriteString(value);
-  WriteKeyNameWithCopy(pickle_, name);
+  WriteType(kTypeString);
+  WriteKeyNameWithCopy(name);
+  WriteString(value);
 }
 
 void TracedValue::SetValue(const char* name, const TracedValue& value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
   BeginDictionary(name);
-  pickle_.WriteBytes(value.pickle_.payload(),
-                     static_cast<int>(value.pickle_.payload_size()));
+  Write(value.data_, value.size_);
   EndDictionary();
 }
 
@@ -153,85 +360,84 @@ void TracedValue::SetValueWithCopiedName(base::StringPiece name,
                                          const TracedValue& value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
   BeginDictionaryWithCopiedName(name);
-  pickle_.WriteBytes(value.pickle_.payload(),
-                     static_cast<int>(value.pickle_.payload_size()));
+  Write(value.data_, value.size_);
   EndDictionary();
 }
 
 void TracedValue::BeginDictionary(const char* name) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
   DEBUG_PUSH_CONTAINER(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeStartDict, 1);
-  WriteKeyNameAsRawPtr(pickle_, name);
+  WriteType(kTypeStartDict);
+  WriteKeyNameAsRawPtr(name);
 }
 
 void TracedValue::BeginDictionaryWithCopiedName(base::StringPiece name) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
   DEBUG_PUSH_CONTAINER(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeStartDict, 1);
-  WriteKeyNameWithCopy(pickle_, name);
+  WriteType(kTypeStartDict);
+  WriteKeyNameWithCopy(name);
 }
 
 void TracedValue::BeginArray(const char* name) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
   DEBUG_PUSH_CONTAINER(kStackTypeArray);
-  pickle_.WriteBytes(&kTypeStartArray, 1);
-  WriteKeyNameAsRawPtr(pickle_, name);
+  WriteType(kTypeStartArray);
+  WriteKeyNameAsRawPtr(name);
 }
 
 void TracedValue::BeginArrayWithCopiedName(base::StringPiece name) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
   DEBUG_PUSH_CONTAINER(kStackTypeArray);
-  pickle_.WriteBytes(&kTypeStartArray, 1);
-  WriteKeyNameWithCopy(pickle_, name);
+  WriteType(kTypeStartArray);
+  WriteKeyNameWithCopy(name);
 }
 
 void TracedValue::EndDictionary() {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
   DEBUG_POP_CONTAINER();
-  pickle_.WriteBytes(&kTypeEndDict, 1);
+  WriteType(kTypeEndDict);
 }
 
 void TracedValue::AppendInteger(int value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeArray);
-  pickle_.WriteBytes(&kTypeInt, 1);
-  pickle_.WriteInt(value);
+  WriteType(kTypeInt);
+  WriteInt(value);
 }
 
 void TracedValue::AppendDouble(double value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeArray);
-  pickle_.WriteBytes(&kTypeDouble, 1);
-  pickle_.WriteDouble(value);
+  WriteType(kTypeDouble);
+  WriteDouble(value);
 }
 
 void TracedValue::AppendBoolean(bool value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeArray);
-  pickle_.WriteBytes(&kTypeBool, 1);
-  pickle_.WriteBool(value);
+  WriteType(kTypeBool);
+  WriteBool(value);
 }
 
 void TracedValue::AppendString(base::StringPiece value) {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeArray);
-  pickle_.WriteBytes(&kTypeString, 1);
-  pickle_.WriteString(value);
+  WriteType(kTypeString);
+  WriteString(value);
 }
 
 void TracedValue::BeginArray() {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeArray);
   DEBUG_PUSH_CONTAINER(kStackTypeArray);
-  pickle_.WriteBytes(&kTypeStartArray, 1);
+  WriteType(kTypeStartArray);
 }
 
 void TracedValue::BeginDictionary() {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeArray);
   DEBUG_PUSH_CONTAINER(kStackTypeDict);
-  pickle_.WriteBytes(&kTypeStartDict, 1);
+  WriteType(kTypeStartDict);
 }
 
 void TracedValue::EndArray() {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeArray);
   DEBUG_POP_CONTAINER();
-  pickle_.WriteBytes(&kTypeEndArray, 1);
+  WriteType(kTypeEndArray);
 }
 
 void TracedValue::SetValue(const char* name, scoped_ptr<base::Value> value) {
@@ -349,125 +555,82 @@ void TracedValue::AppendBaseValue(const base::Value& value) {
 
 scoped_ptr<base::Value> TracedValue::ToBaseValue() const {
   scoped_ptr<DictionaryValue> root(new DictionaryValue);
-  DictionaryValue* cur_dict = root.get();
-  ListValue* cur_list = nullptr;
-  std::vector<Value*> stack;
-  PickleIterator it(pickle_);
-  const char* type;
-
-  while (it.ReadBytes(&type, 1)) {
-    DCHECK((cur_dict && !cur_list) || (cur_list && !cur_dict));
-    switch (*type) {
-      case kTypeStartDict: {
-        auto new_dict = new DictionaryValue();
-        if (cur_dict) {
-          cur_dict->SetWithoutPathExpansion(ReadKeyName(it),
-                                            make_scoped_ptr(new_dict));
-          stack.push_back(cur_dict);
-          cur_dict = new_dict;
-        } else {
-          cur_list->Append(make_scoped_ptr(new_dict));
-          stack.push_back(cur_list);
-          cur_list = nullptr;
-          cur_dict = new_dict;
-        }
-      } break;
-
-      case kTypeEndArray:
-      case kTypeEndDict: {
-        if (stack.back()->GetAsDictionary(&cur_dict)) {
-          cur_list = nullptr;
-        } else if (stack.back()->GetAsList(&cur_list)) {
-          cur_dict = nullptr;
-        }
-        stack.pop_back();
-      } break;
-
-      case kTypeStartArray: {
-        auto new_list = new ListValue();
-        if (cur_dict) {
-          cur_dict->SetWithoutPathExpansion(ReadKeyName(it),
-                                            make_scoped_ptr(new_list));
-          stack.push_back(cur_dict);
-          cur_dict = nullptr;
-          cur_list = new_list;
-        } else {
-          cur_list->Append(make_scoped_ptr(new_list));
-          stack.push_back(cur_list);
-          cur_list = new_list;
-        }
-      } break;
-
-      case kTypeBool: {
-        bool value;
-        CHECK(it.ReadBool(&value));
-        if (cur_dict) {
-          cur_dict->SetBooleanWithoutPathExpansion(ReadKeyName(it), value);
-        } else {
-          cur_list->AppendBoolean(value);
-        }
-      } break;
-
-      case kTypeInt: {
-        int value;
-        CHECK(it.ReadInt(&value));
-        if (cur_dict) {
-          cur_dict->SetIntegerWithoutPathExpansion(ReadKeyName(it), value);
-        } else {
-          cur_list->AppendInteger(value);
-        }
-      } break;
-
-      case kTypeDouble: {
-        double value;
-        CHECK(it.ReadDouble(&value));
-        if (cur_dict) {
-          cur_dict->SetDoubleWithoutPathExpansion(ReadKeyName(it), value);
-        } else {
-          cur_list->AppendDouble(value);
-        }
-      } break;
-
-      case kTypeString: {
-        std::string value;
-        CHECK(it.ReadString(&value));
-        if (cur_dict) {
-          cur_dict->SetStringWithoutPathExpansion(ReadKeyName(it), value);
-        } else {
-          cur_list->AppendString(value);
-        }
-      } break;
-
-      default:
-        NOTREACHED();
-    }
-  }
-  DCHECK(stack.empty());
-  return std::move(root);
+  Reader reader(data_, data_ + size_);
+  ReadDictionary(&reader, root.get());
+  DCHECK(reader.AtEnd());
+  return root;
 }
 
 void TracedValue::AppendAsTraceFormat(std::string* out) const {
   DCHECK_CURRENT_CONTAINER_IS(kStackTypeDict);
   DCHECK_CONTAINER_STACK_DEPTH_EQ(1u);
 
-  // TODO(primiano): this could be smarter, skip the ToBaseValue encoding and
-  // produce the JSON on its own. This will require refactoring JSONWriter
-  // to decouple the base::Value traversal from the JSON writing bits
-  std::string tmp;
-  JSONWriter::Write(*ToBaseValue(), &tmp);
-  *out += tmp;
+  Reader reader(data_, data_ + size_);
+  AppendDictionaryAsJSON(&reader, out);
+  DCHECK(reader.AtEnd());
 }
 
 void TracedValue::EstimateTraceMemoryOverhead(
     TraceEventMemoryOverhead* overhead) {
-  const size_t kPickleHeapAlign = 4096;  // Must be == Pickle::kPickleHeapAlign.
   overhead->Add("TracedValue",
 
                 /* allocated size */
-                bits::Align(pickle_.GetTotalAllocatedSize(), kPickleHeapAlign),
+                sizeof(*this) + (heap_buffer_ ? capacity_ : 0),
 
                 /* resident size */
-                bits::Align(pickle_.size(), kPickleHeapAlign));
+                sizeof(*this) + (heap_buffer_ ? size_ : 0));
+}
+
+void TracedValue::Write(const void* data, size_t size) {
+  if (size > capacity_ - size_) {
+    const size_t new_capacity = std::max(capacity_ * 2, size_ + size);
+    scoped_ptr<char[]> new_buffer(new char[new_capacity]);
+    memcpy(new_buffer.get(), data_, size_);
+    heap_buffer_ = std::move(new_buffer);
+    data_ = heap_buffer_.get();
+    capacity_ = new_capacity;
+  }
+  memcpy(data_ + size_, data, size);
+  size_ += size;
+}
+
+void TracedValue::WriteVarint(uint64_t value) {
+  char buffer[10];
+  size_t size = 0;
+  for (; value >= 0x80; value >>= 7)
+    buffer[size++] = static_cast<char>(value | 0x80);
+  buffer[size++] = static_cast<char>(value);
+  Write(buffer, size);
+}
+
+void TracedValue::WriteBool(bool value) {
+  const char byte = value ? 1 : 0;
+  Write(&byte, 1);
+}
+
+void TracedValue::WriteInt(int value) {
+  // Zigzag encoded, so that small negative values are short too.
+  const uint32_t bits = static_cast<uint32_t>(value);
+  WriteVarint((bits << 1) ^ (0u - (bits >> 31)));
+}
+
+void TracedValue::WriteDouble(double value) {
+  Write(&value, sizeof(value));
+}
+
+void TracedValue::WriteString(base::StringPiece value) {
+  WriteVarint(value.size());
+  Write(value.data(), value.size());
+}
+
+void TracedValue::WriteKeyNameAsRawPtr(const char* name) {
+  WriteType(kTypeCStr);
+  Write(&name, sizeof(name));
+}
+
+void TracedValue::WriteKeyNameWithCopy(base::StringPiece name) {
+  WriteType(kTypeString);
+  WriteString(name);
 }
 
 }  // namespace trace_event
@@ -6,13 +6,13 @@
 #define BASE_TRACE_EVENT_TRACE_EVENT_ARGUMENT_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <string>
 #include <vector>
 
 #include "base/macros.h"
 #include "base/memory/scoped_ptr.h"
-#include "base/pickle.h"
 #include "base/strings/string_piece.h"
 #include "base/trace_event/trace_event_impl.h"
 
@@ -22,6 +22,9 @@ class Value;
 
 namespace trace_event {
 
+// A structured trace event argument. Values are written in a compact binary
+// encoding, into a buffer inside the TracedValue until they outgrow it, and
+// only converted to JSON when the trace is flushed.
 class BASE_EXPORT TracedValue : public ConvertableToTraceFormat {
  public:
   TracedValue();
@@ -75,9 +78,27 @@ class BASE_EXPORT TracedValue : public ConvertableToTraceFormat {
   scoped_ptr<base::Value> ToBaseValue() const;
 
  private:
+  // Large enough for the arguments of most trace events.
+  static const size_t kInlineCapacity = 256;
+
   ~TracedValue() override;
 
-  Pickle pickle_;
+  void Write(const void* data, size_t size);
+  void WriteType(char type) { Write(&type, 1); }
+  void WriteVarint(uint64_t value);
+  void WriteBool(bool value);
+  void WriteInt(int value);
+  void WriteDouble(double value);
+  void WriteString(base::StringPiece value);
+  void WriteKeyNameAsRawPtr(const char* name);
+  void WriteKeyNameWithCopy(base::StringPiece name);
+
+  // The encoded value, which is in |inline_buffer_| or in |heap_buffer_|.
+  char* data_;
+  size_t size_;
+  size_t capacity_;
+  scoped_ptr<char[]> heap_buffer_;
+  char inline_buffer_[kInlineCapacity];
 
 #ifndef NDEBUG
   // In debug builds checks the pairings of {Start,End}{Dictionary,Array}
@@ -0,0 +1,118 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/trace_event_argument.h"
+
+#include <string>
+#include <utility>
+
+#include "base/json/json_writer.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+const int kNumEvents = 100000;
+
+// The arguments of a typical event with structured arguments.
+void FillTracedValue(TracedValue* value, int i) {
+  value->SetInteger("id", i);
+  value->SetDouble("duration_ms", i * 0.25);
+  value->SetBoolean("visible", (i & 1) != 0);
+  value->SetString("state", "painting");
+  value->BeginDictionary("rect");
+  value->SetInteger("x", i % 640);
+  value->SetInteger("y", i % 480);
+  value->SetInteger("width", 64);
+  value->SetInteger("height", 48);
+  value->EndDictionary();
+  value->BeginArray("layers");
+  value->AppendInteger(1);
+  value->AppendInteger(2);
+  value->AppendInteger(3);
+  value->EndArray();
+}
+
+scoped_ptr<Value> MakeBaseValue(int i) {
+  scoped_ptr<DictionaryValue> value(new DictionaryValue);
+  value->SetInteger("id", i);
+  value->SetDouble("duration_ms", i * 0.25);
+  value->SetBoolean("visible", (i & 1) != 0);
+  value->SetString("state", "painting");
+  scoped_ptr<DictionaryValue> rect(new DictionaryValue);
+  rect->SetInteger("x", i % 640);
+  rect->SetInteger("y", i % 480);
+  rect->SetInteger("width", 64);
+  rect->SetInteger("height", 48);
+  value->Set("rect", std::move(rect));
+  scoped_ptr<ListValue> layers(new ListValue);
+  layers->AppendInteger(1);
+  layers->AppendInteger(2);
+  layers->AppendInteger(3);
+  value->Set("layers", std::move(layers));
+  return value;
+}
+
+void PrintPerEvent(const std::string& measurement,
+                   const std::string& trace,
+                   TimeDelta elapsed) {
+  perf_test::PrintResult(measurement, "", trace,
+                         elapsed.InSecondsF() * 1e9 / kNumEvents, "ns", true);
+}
+
+}  // namespace
+
+// The cost of building the arguments of an event, which is paid while
+// tracing.
+TEST(TraceEventArgumentPerfTest, Record) {
+  TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumEvents; ++i) {
+    scoped_refptr<TracedValue> value = new TracedValue;
+    FillTracedValue(value.get(), i);
+  }
+  PrintPerEvent("record_time", "TracedValue", TimeTicks::Now() - start);
+
+  start = TimeTicks::Now();
+  for (int i = 0; i < kNumEvents; ++i) {
+    scoped_refptr<TracedValue> value = new TracedValue;
+    value->SetValue("args", MakeBaseValue(i));
+  }
+  PrintPerEvent("record_time", "TracedValue_from_Value",
+                TimeTicks::Now() - start);
+}
+
+// The cost of converting the arguments of an event to JSON, which is paid
+// when the trace is flushed.
+TEST(TraceEventArgumentPerfTest, Flush) {
+  scoped_refptr<TracedValue> value = new TracedValue;
+  FillTracedValue(value.get(), 12345);
+
+  std::string json;
+  TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumEvents; ++i) {
+    json.clear();
+    value->AppendAsTraceFormat(&json);
+  }
+  PrintPerEvent("flush_time", "AppendAsTraceFormat", TimeTicks::Now() - start);
+
+  std::string value_json;
+  start = TimeTicks::Now();
+  for (int i = 0; i < kNumEvents; ++i) {
+    value_json.clear();
+    JSONWriter::Write(*value->ToBaseValue(), &value_json);
+  }
+  PrintPerEvent("flush_time", "ToBaseValue_JSONWriter",
+                TimeTicks::Now() - start);
+  EXPECT_EQ(value_json, json);
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -8,6 +8,7 @@
 
 #include <utility>
 
+#include "base/strings/string_number_conversions.h"
 #include "base/values.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -95,6 +96,51 @@ TEST(TraceEventArgumentTest, LongStrings) {
             json);
 }
 
+TEST(TraceEventArgumentTest, CopiedNamesAndEscaping) {
+  scoped_refptr<TracedValue> value = new TracedValue();
+  std::string name = "copied";
+  value->SetIntegerWithCopiedName(name, -1);
+  name = "negative";
+  value->SetIntegerWithCopiedName(name, -2147483647 - 1);
+  value->SetDoubleWithCopiedName("double", -0.5);
+  value->SetBooleanWithCopiedName("bool", false);
+  value->SetStringWithCopiedName("quo\"te", "line\nbreak");
+  // The last value set for a name is the one written.
+  value->SetInteger("copied", 3);
+  value->BeginArrayWithCopiedName("array");
+  value->AppendDouble(1.0);
+  value->AppendString("\\");
+  value->EndArray();
+  std::string json;
+  value->AppendAsTraceFormat(&json);
+  EXPECT_EQ(
+      "{\"array\":[1.0,\"\\\\\"],\"bool\":false,\"copied\":3,"
+      "\"double\":-0.5,\"negative\":-2147483648,"
+      "\"quo\\\"te\":\"line\\nbreak\"}",
+      json);
+}
+
+// Values which outgrow the buffer of the TracedValue are kept whole.
+TEST(TraceEventArgumentTest, LargeValue) {
+  const int kNumElements = 1000;
+  scoped_refptr<TracedValue> value = new TracedValue();
+  value->BeginArray("array");
+  for (int i = 0; i < kNumElements; ++i)
+    value->AppendInteger(i * 1000);
+  value->EndArray();
+  std::string json;
+  value->AppendAsTraceFormat(&json);
+
+  std::string expected = "{\"array\":[";
+  for (int i = 0; i < kNumElements; ++i) {
+    if (i)
+      expected += ",";
+    expected += IntToString(i * 1000);
+  }
+  expected += "]}";
+  EXPECT_EQ(expected, json);
+}
+
 TEST(TraceEventArgumentTest, PassBaseValue) {
   FundamentalValue int_value(42);
   FundamentalValue bool_value(true);
@@ -29,6 +29,7 @@
 #include "base/trace_event/trace_buffer.h"
 #include "base/trace_event/trace_event.h"
 #include "base/trace_event/trace_event_synthetic_delay.h"
+#include "base/trace_event/trace_stack_sampler.h"
 #include "base/values.h"
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -1189,6 +1190,33 @@ TEST_F(TraceEventTestFixture, AddMetadataEvent) {
   ASSERT_EQ(4, num_calls);
 }
 
+// Test that there is no limit on the number of category groups.
+TEST_F(TraceEventTestFixture, ManyCategoryGroups) {
+  const int kNumCategoryGroups = 1000;
+  TraceLog::GetInstance()->SetEnabled(TraceConfig("many_groups_1*", ""),
+                                      TraceLog::RECORDING_MODE);
+  std::vector<const unsigned char*> enabled_flags;
+  for (int i = 0; i < kNumCategoryGroups; ++i) {
+    const std::string name = StringPrintf("many_groups_%d", i);
+    enabled_flags.push_back(TraceLog::GetCategoryGroupEnabled(name.c_str()));
+    EXPECT_EQ(enabled_flags.back(),
+              TraceLog::GetCategoryGroupEnabled(name.c_str()));
+  }
+  for (int i = 0; i < kNumCategoryGroups; ++i) {
+    const std::string name = StringPrintf("many_groups_%d", i);
+    EXPECT_EQ(name, TraceLog::GetCategoryGroupName(enabled_flags[i]));
+    EXPECT_EQ(name[12] == '1', *enabled_flags[i] != 0) << name;
+  }
+  EndTraceAndFlush();
+  for (const unsigned char* enabled : enabled_flags)
+    EXPECT_FALSE(*enabled);
+
+  std::vector<std::string> cat_groups;
+  TraceLog::GetInstance()->GetKnownCategoryGroups(&cat_groups);
+  EXPECT_TRUE(ContainsValue(cat_groups, "many_groups_0"));
+  EXPECT_TRUE(ContainsValue(cat_groups, "many_groups_999"));
+}
+
 // Test that categories work.
 TEST_F(TraceEventTestFixture, Categories) {
   // Test that categories that are used can be retrieved whether trace was
@@ -1994,6 +2022,52 @@ TEST_F(TraceEventTestFixture, TraceContinuousSampling) {
   Clear();
 }
 
+TEST_F(TraceEventTestFixture, TraceStackSampling) {
+  // Threads register themselves for their stacks to be sampled.
+  Thread thread("StackSampledThread");
+  ASSERT_TRUE(thread.StartAndWaitForTesting());
+
+#if (defined(OS_LINUX) || defined(OS_ANDROID)) && \
+    (defined(ARCH_CPU_X86_FAMILY) || defined(ARCH_CPU_ARM64))
+  // The samples are events of the sampled thread. Capturing a stack may time
+  // out on a loaded machine, so tracing is retried until there is one.
+  int stack_frame_id = -1;
+  const TimeTicks deadline = TimeTicks::Now() + TimeDelta::FromSeconds(10);
+  while (stack_frame_id < 0 && TimeTicks::Now() < deadline) {
+    Clear();
+    BeginSpecificTrace(TraceStackSampler::kStackSamplingCategory);
+    TraceLog::GetInstance()->WaitSamplingEventForTesting();
+    EndTraceAndFlush();
+    for (size_t i = 0; i < trace_parsed_.GetSize(); i++) {
+      DictionaryValue* event = NULL;
+      std::string name;
+      int tid;
+      if (trace_parsed_.GetDictionary(i, &event) &&
+          event->GetString("name", &name) && name == "StackSample" &&
+          event->GetInteger("tid", &tid) && tid == thread.GetThreadId()) {
+        EXPECT_TRUE(event->GetInteger("args.stack_frame_id", &stack_frame_id));
+        break;
+      }
+    }
+  }
+  ASSERT_GE(stack_frame_id, 0);
+
+  // The stack frames of the samples are added when tracing stops.
+  DictionaryValue* metadata = FindNamePhase("stackFrames", "M");
+  ASSERT_TRUE(metadata);
+  DictionaryValue* stack_frames;
+  ASSERT_TRUE(metadata->GetDictionary("args.stackFrames", &stack_frames));
+  EXPECT_TRUE(stack_frames->HasKey(StringPrintf("%d", stack_frame_id)));
+#else
+  BeginSpecificTrace(TraceStackSampler::kStackSamplingCategory);
+  TraceLog::GetInstance()->WaitSamplingEventForTesting();
+  EndTraceAndFlush();
+  EXPECT_FALSE(FindNamePhase("StackSample", "P"));
+#endif
+
+  thread.Stop();
+}
+
 class MyData : public ConvertableToTraceFormat {
  public:
   MyData() {}
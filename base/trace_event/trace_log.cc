@@ -27,6 +27,7 @@
 #include "base/threading/thread_id_name_manager.h"
 #include "base/threading/worker_pool.h"
 #include "base/time/time.h"
+#include "base/trace_event/category_registry.h"
 #include "base/trace_event/heap_profiler_allocation_context_tracker.h"
 #include "base/trace_event/memory_dump_manager.h"
 #include "base/trace_event/memory_dump_provider.h"
@@ -35,6 +36,7 @@
 #include "base/trace_event/trace_event.h"
 #include "base/trace_event/trace_event_synthetic_delay.h"
 #include "base/trace_event/trace_sampling_thread.h"
+#include "base/trace_event/trace_stack_sampler.h"
 #include "build/build_config.h"
 
 #if defined(OS_WIN)
@@ -84,30 +86,6 @@ const size_t kEchoToConsoleTraceEventBufferChunks = 256;
 const size_t kTraceEventBufferSizeInBytes = 100 * 1024;
 const int kThreadFlushTimeoutMs = 3000;
 
-#define MAX_CATEGORY_GROUPS 100
-
-// Parallel arrays g_category_groups and g_category_group_enabled are separate
-// so that a pointer to a member of g_category_group_enabled can be easily
-// converted to an index into g_category_groups. This allows macros to deal
-// only with char enabled pointers from g_category_group_enabled, and we can
-// convert internally to determine the category name from the char enabled
-// pointer.
-const char* g_category_groups[MAX_CATEGORY_GROUPS] = {
-    "toplevel",
-    "tracing already shutdown",
-    "tracing categories exhausted; must increase MAX_CATEGORY_GROUPS",
-    "__metadata"};
-
-// The enabled flag is char instead of bool so that the API can be used from C.
-unsigned char g_category_group_enabled[MAX_CATEGORY_GROUPS] = {0};
-// Indexes here have to match the g_category_groups array indexes above.
-const int g_category_already_shutdown = 1;
-const int g_category_categories_exhausted = 2;
-const int g_category_metadata = 3;
-const int g_num_builtin_categories = 4;
-// Skip default categories.
-base::subtle::AtomicWord g_category_index = g_num_builtin_categories;
-
 // The name of the current thread. This is used to decide if the current
 // thread name has changed. We combine all the seen thread names into the
 // output name for the thread.
@@ -136,7 +114,7 @@ void InitializeMetadataEvent(TraceEvent* trace_event,
       TimeTicks(),
       ThreadTicks(),
       TRACE_EVENT_PHASE_METADATA,
-      &g_category_group_enabled[g_category_metadata],
+      &CategoryRegistry::kCategoryMetadata->enabled,
       metadata_name,
       trace_event_internal::kNoId,  // id
       trace_event_internal::kNoId,  // bind_id
@@ -353,6 +331,8 @@ TraceLog::TraceLog()
       sampling_thread_handle_(0),
       trace_config_(TraceConfig()),
       event_callback_trace_config_(TraceConfig()),
+      trace_config_matcher_(trace_config_),
+      event_callback_trace_config_matcher_(event_callback_trace_config_),
       thread_shared_chunk_index_(0),
       generation_(0),
       use_worker_thread_(false) {
@@ -361,8 +341,8 @@ TraceLog::TraceLog()
   // traced or not, so we allow races on the enabled flag to keep the trace
   // macros fast.
   // TODO(jbates): ANNOTATE_BENIGN_RACE_SIZED crashes windows TSAN bots:
-  // ANNOTATE_BENIGN_RACE_SIZED(g_category_group_enabled,
-  //                            sizeof(g_category_group_enabled),
+  // ANNOTATE_BENIGN_RACE_SIZED(&category->enabled,
+  //                            sizeof(category->enabled),
   //                           "trace_event category enabled");
 #if defined(OS_NACL)  // NaCl shouldn't expose the process id.
   SetProcessID(0);
@@ -421,39 +401,33 @@ const unsigned char* TraceLog::GetCategoryGroupEnabled(
     const char* category_group) {
   TraceLog* tracelog = GetInstance();
   if (!tracelog) {
-    DCHECK(!g_category_group_enabled[g_category_already_shutdown]);
-    return &g_category_group_enabled[g_category_already_shutdown];
+    DCHECK(!CategoryRegistry::kCategoryAlreadyShutdown->enabled);
+    return &CategoryRegistry::kCategoryAlreadyShutdown->enabled;
   }
   return tracelog->GetCategoryGroupEnabledInternal(category_group);
 }
 
 const char* TraceLog::GetCategoryGroupName(
     const unsigned char* category_group_enabled) {
-  // Calculate the index of the category group by finding
-  // category_group_enabled in g_category_group_enabled array.
-  uintptr_t category_begin =
-      reinterpret_cast<uintptr_t>(g_category_group_enabled);
-  uintptr_t category_ptr = reinterpret_cast<uintptr_t>(category_group_enabled);
-  DCHECK(category_ptr >= category_begin &&
-         category_ptr < reinterpret_cast<uintptr_t>(g_category_group_enabled +
-                                                    MAX_CATEGORY_GROUPS))
+  const TraceCategory* category =
+      TraceCategory::FromEnabledFlags(category_group_enabled);
+  DCHECK(CategoryRegistry::IsValidCategory(category))
       << "out of bounds category pointer";
-  uintptr_t category_index =
-      (category_ptr - category_begin) / sizeof(g_category_group_enabled[0]);
-  return g_category_groups[category_index];
+  return category->name;
 }
 
-void TraceLog::UpdateCategoryGroupEnabledFlag(size_t category_index) {
+unsigned char TraceLog::ComputeCategoryGroupEnabledFlags(
+    const char* category_group) const {
   unsigned char enabled_flag = 0;
-  const char* category_group = g_category_groups[category_index];
   if (mode_ == RECORDING_MODE &&
-      trace_config_.IsCategoryGroupEnabled(category_group))
+      trace_config_matcher_.IsCategoryGroupEnabled(category_group))
     enabled_flag |= ENABLED_FOR_RECORDING;
   else if (mode_ == MONITORING_MODE &&
-           trace_config_.IsCategoryGroupEnabled(category_group))
+           trace_config_matcher_.IsCategoryGroupEnabled(category_group))
     enabled_flag |= ENABLED_FOR_MONITORING;
   if (event_callback_ &&
-      event_callback_trace_config_.IsCategoryGroupEnabled(category_group))
+      event_callback_trace_config_matcher_.IsCategoryGroupEnabled(
+          category_group))
     enabled_flag |= ENABLED_FOR_EVENT_CALLBACK;
 #if defined(OS_WIN)
   if (base::trace_event::TraceEventETWExport::IsCategoryGroupEnabled(
@@ -461,14 +435,18 @@ void TraceLog::UpdateCategoryGroupEnabledFlag(size_t category_index) {
     enabled_flag |= ENABLED_FOR_ETW_EXPORT;
   }
 #endif
-
-  g_category_group_enabled[category_index] = enabled_flag;
+  return enabled_flag;
 }
 
 void TraceLog::UpdateCategoryGroupEnabledFlags() {
-  size_t category_index = base::subtle::NoBarrier_Load(&g_category_index);
-  for (size_t i = 0; i < category_index; i++)
-    UpdateCategoryGroupEnabledFlag(i);
+  trace_config_matcher_ = TraceConfig::CategoryMatcher(trace_config_);
+  event_callback_trace_config_matcher_ =
+      TraceConfig::CategoryMatcher(event_callback_trace_config_);
+  size_t category_count = CategoryRegistry::GetCategoryCount();
+  for (size_t i = 0; i < category_count; i++) {
+    TraceCategory* category = CategoryRegistry::GetCategoryAt(i);
+    category->enabled = ComputeCategoryGroupEnabledFlags(category->name);
+  }
 }
 
 void TraceLog::UpdateSyntheticDelaysFromTraceConfig() {
@@ -504,59 +482,36 @@ const unsigned char* TraceLog::GetCategoryGroupEnabledInternal(
     const char* category_group) {
   DCHECK(!strchr(category_group, '"'))
       << "Category groups may not contain double quote";
-  // The g_category_groups is append only, avoid using a lock for the fast path.
-  size_t current_category_index = base::subtle::Acquire_Load(&g_category_index);
-
-  // Search for pre-existing category group.
-  for (size_t i = 0; i < current_category_index; ++i) {
-    if (strcmp(g_category_groups[i], category_group) == 0) {
-      return &g_category_group_enabled[i];
-    }
-  }
+  // The categories are append only, avoid using a lock for the fast path.
+  TraceCategory* category = CategoryRegistry::GetCategoryByName(category_group);
+  if (category)
+    return &category->enabled;
 
-  unsigned char* category_group_enabled = NULL;
   // This is the slow path: the lock is not held in the case above, so more
   // than one thread could have reached here trying to add the same category.
   // Only hold to lock when actually appending a new category, and
   // check the categories groups again.
   AutoLock lock(lock_);
-  size_t category_index = base::subtle::Acquire_Load(&g_category_index);
-  for (size_t i = 0; i < category_index; ++i) {
-    if (strcmp(g_category_groups[i], category_group) == 0) {
-      return &g_category_group_enabled[i];
-    }
-  }
+  category = CategoryRegistry::GetCategoryByName(category_group);
+  if (category)
+    return &category->enabled;
 
-  // Create a new category group.
-  DCHECK(category_index < MAX_CATEGORY_GROUPS)
-      << "must increase MAX_CATEGORY_GROUPS";
-  if (category_index < MAX_CATEGORY_GROUPS) {
-    // Don't hold on to the category_group pointer, so that we can create
-    // category groups with strings not known at compile time (this is
-    // required by SetWatchEvent).
-    const char* new_group = strdup(category_group);
-    g_category_groups[category_index] = new_group;
-    DCHECK(!g_category_group_enabled[category_index]);
-    // Note that if both included and excluded patterns in the
-    // TraceConfig are empty, we exclude nothing,
-    // thereby enabling this category group.
-    UpdateCategoryGroupEnabledFlag(category_index);
-    category_group_enabled = &g_category_group_enabled[category_index];
-    // Update the max index now.
-    base::subtle::Release_Store(&g_category_index, category_index + 1);
-  } else {
-    category_group_enabled =
-        &g_category_group_enabled[g_category_categories_exhausted];
-  }
-  return category_group_enabled;
+  // Note that if both included and excluded patterns in the
+  // TraceConfig are empty, we exclude nothing,
+  // thereby enabling this category group.
+  category = CategoryRegistry::AddCategoryLocked(
+      category_group, ComputeCategoryGroupEnabledFlags(category_group));
+  return &category->enabled;
 }
 
 void TraceLog::GetKnownCategoryGroups(
     std::vector<std::string>* category_groups) {
   AutoLock lock(lock_);
-  size_t category_index = base::subtle::NoBarrier_Load(&g_category_index);
-  for (size_t i = g_num_builtin_categories; i < category_index; i++)
-    category_groups->push_back(g_category_groups[i]);
+  size_t category_count = CategoryRegistry::GetCategoryCount();
+  for (size_t i = CategoryRegistry::kNumBuiltinCategories; i < category_count;
+       i++) {
+    category_groups->push_back(CategoryRegistry::GetCategoryAt(i)->name);
+  }
 }
 
 void TraceLog::SetEnabled(const TraceConfig& trace_config, Mode mode) {
@@ -606,17 +561,23 @@ void TraceLog::SetEnabled(const TraceConfig& trace_config, Mode mode) {
     UpdateCategoryGroupEnabledFlags();
     UpdateSyntheticDelaysFromTraceConfig();
 
-    if (new_options & kInternalEnableSampling) {
+    const bool stack_sampling_enabled = trace_config_.IsCategoryGroupEnabled(
+        TraceStackSampler::kStackSamplingCategory);
+    if ((new_options & kInternalEnableSampling) || stack_sampling_enabled) {
       sampling_thread_.reset(new TraceSamplingThread);
-      sampling_thread_->RegisterSampleBucket(
-          &g_trace_state[0], "bucket0",
-          Bind(&TraceSamplingThread::DefaultSamplingCallback));
-      sampling_thread_->RegisterSampleBucket(
-          &g_trace_state[1], "bucket1",
-          Bind(&TraceSamplingThread::DefaultSamplingCallback));
-      sampling_thread_->RegisterSampleBucket(
-          &g_trace_state[2], "bucket2",
-          Bind(&TraceSamplingThread::DefaultSamplingCallback));
+      if (new_options & kInternalEnableSampling) {
+        sampling_thread_->RegisterSampleBucket(
+            &g_trace_state[0], "bucket0",
+            Bind(&TraceSamplingThread::DefaultSamplingCallback));
+        sampling_thread_->RegisterSampleBucket(
+            &g_trace_state[1], "bucket1",
+            Bind(&TraceSamplingThread::DefaultSamplingCallback));
+        sampling_thread_->RegisterSampleBucket(
+            &g_trace_state[2], "bucket2",
+            Bind(&TraceSamplingThread::DefaultSamplingCallback));
+      }
+      if (stack_sampling_enabled)
+        sampling_thread_->EnableStackSampling();
       if (!PlatformThread::Create(0, sampling_thread_.get(),
                                   &sampling_thread_handle_)) {
         DCHECK(false) << "failed to create thread";
@@ -695,6 +656,15 @@ void TraceLog::SetDisabledWhileLocked() {
     PlatformThread::Join(sampling_thread_handle_);
     lock_.Acquire();
     sampling_thread_handle_ = PlatformThreadHandle();
+    if (sampling_thread_->stack_sampler_) {
+      // Adds the call trees which the stack samples refer to.
+      const char* arg_name = "stackFrames";
+      const unsigned char arg_type = TRACE_VALUE_TYPE_CONVERTABLE;
+      scoped_refptr<ConvertableToTraceFormat> stack_frames =
+          sampling_thread_->stack_sampler_->stack_frame_deduplicator();
+      AddMetadataEventWhileLocked("stackFrames", 1, &arg_name, &arg_type, NULL,
+                                  &stack_frames, TRACE_EVENT_FLAG_NONE);
+    }
     sampling_thread_.reset();
   }
 
@@ -1210,7 +1180,7 @@ TraceEventHandle TraceLog::AddTraceEventWithThreadIdAndTimestamp(
   // current thread to avoid locks in most cases.
   if (thread_id == static_cast<int>(PlatformThread::CurrentId())) {
     const char* new_name =
-        ThreadIdNameManager::GetInstance()->GetName(thread_id);
+        ThreadIdNameManager::GetInstance()->GetNameForCurrentThread();
     // Check if the thread name has been set or changed since the previous
     // call (if any), but don't bother if the new name is empty. Note this will
     // not detect a thread name change within the same char* buffer address: we
@@ -1343,12 +1313,25 @@ void TraceLog::AddMetadataEvent(
     const unsigned long long* arg_values,
     const scoped_refptr<ConvertableToTraceFormat>* convertable_values,
     unsigned int flags) {
-  scoped_ptr<TraceEvent> trace_event(new TraceEvent);
   AutoLock lock(lock_);
+  AddMetadataEventWhileLocked(name, num_args, arg_names, arg_types, arg_values,
+                              convertable_values, flags);
+}
+
+void TraceLog::AddMetadataEventWhileLocked(
+    const char* name,
+    int num_args,
+    const char** arg_names,
+    const unsigned char* arg_types,
+    const unsigned long long* arg_values,
+    const scoped_refptr<ConvertableToTraceFormat>* convertable_values,
+    unsigned int flags) {
+  lock_.AssertAcquired();
+  scoped_ptr<TraceEvent> trace_event(new TraceEvent);
   trace_event->Initialize(
       0,  // thread_id
       TimeTicks(), ThreadTicks(), TRACE_EVENT_PHASE_METADATA,
-      &g_category_group_enabled[g_category_metadata], name,
+      &CategoryRegistry::kCategoryMetadata->enabled, name,
       trace_event_internal::kNoId,  // id
       trace_event_internal::kNoId,  // bind_id
       num_args, arg_names, arg_types, arg_values, convertable_values, flags);
@@ -1678,17 +1661,17 @@ TraceBuffer* TraceLog::CreateTraceBuffer() {
 #if defined(OS_WIN)
 void TraceLog::UpdateETWCategoryGroupEnabledFlags() {
   AutoLock lock(lock_);
-  size_t category_index = base::subtle::NoBarrier_Load(&g_category_index);
+  size_t category_count = CategoryRegistry::GetCategoryCount();
   // Go through each category and set/clear the ETW bit depending on whether the
   // category is enabled.
-  for (size_t i = 0; i < category_index; i++) {
-    const char* category_group = g_category_groups[i];
-    DCHECK(category_group);
+  for (size_t i = 0; i < category_count; i++) {
+    TraceCategory* category = CategoryRegistry::GetCategoryAt(i);
+    DCHECK(category->name);
     if (base::trace_event::TraceEventETWExport::IsCategoryGroupEnabled(
-            category_group)) {
-      g_category_group_enabled[i] |= ENABLED_FOR_ETW_EXPORT;
+            category->name)) {
+      category->enabled |= ENABLED_FOR_ETW_EXPORT;
     } else {
-      g_category_group_enabled[i] &= ~ENABLED_FOR_ETW_EXPORT;
+      category->enabled &= ~ENABLED_FOR_ETW_EXPORT;
     }
   }
 }
@@ -350,8 +350,10 @@ class BASE_EXPORT TraceLog : public MemoryDumpProvider {
   // Enable the category group in the enabled mode if category_filter_ matches
   // the category group, or event_callback_ is not null and
   // event_callback_category_filter_ matches the category group.
+  // Recompiles the matchers of the trace configs first.
   void UpdateCategoryGroupEnabledFlags();
-  void UpdateCategoryGroupEnabledFlag(size_t category_index);
+  unsigned char ComputeCategoryGroupEnabledFlags(
+      const char* category_group) const;
 
   // Configure synthetic delays based on the values set in the current
   // trace config.
@@ -367,6 +369,14 @@ class BASE_EXPORT TraceLog : public MemoryDumpProvider {
   ~TraceLog() override;
   const unsigned char* GetCategoryGroupEnabledInternal(const char* name);
   void AddMetadataEventsWhileLocked();
+  void AddMetadataEventWhileLocked(
+      const char* name,
+      int num_args,
+      const char** arg_names,
+      const unsigned char* arg_types,
+      const unsigned long long* arg_values,
+      const scoped_refptr<ConvertableToTraceFormat>* convertable_values,
+      unsigned int flags);
 
   InternalTraceOptions trace_options() const {
     return static_cast<InternalTraceOptions>(
@@ -472,6 +482,9 @@ class BASE_EXPORT TraceLog : public MemoryDumpProvider {
 
   TraceConfig trace_config_;
   TraceConfig event_callback_trace_config_;
+  // Compiled from the configs above by UpdateCategoryGroupEnabledFlags().
+  TraceConfig::CategoryMatcher trace_config_matcher_;
+  TraceConfig::CategoryMatcher event_callback_trace_config_matcher_;
 
   ThreadLocalPointer<ThreadLocalEventBuffer> thread_local_event_buffer_;
   ThreadLocalBoolean thread_blocks_message_loop_;
@@ -24,7 +24,9 @@ class TraceBucketData {
 };
 
 TraceSamplingThread::TraceSamplingThread()
-    : thread_running_(false), waitable_event_for_testing_(false, false) {}
+    : stack_sampling_enabled_(false),
+      thread_running_(false),
+      waitable_event_for_testing_(false, false) {}
 
 TraceSamplingThread::~TraceSamplingThread() {}
 
@@ -32,10 +34,23 @@ void TraceSamplingThread::ThreadMain() {
   PlatformThread::SetName("Sampling Thread");
   thread_running_ = true;
   const int kSamplingFrequencyMicroseconds = 1000;
-  while (!cancellation_flag_.IsSet()) {
-    PlatformThread::Sleep(
-        TimeDelta::FromMicroseconds(kSamplingFrequencyMicroseconds));
+  // Capturing stacks interrupts the sampled threads, so it is done less often.
+  const int kStackSamplingPeriod = 10;
+  if (stack_sampling_enabled_)
+    stack_sampler_.reset(new TraceStackSampler);
+  TimeDelta sleep_time =
+      TimeDelta::FromMicroseconds(kSamplingFrequencyMicroseconds);
+  int stack_sampling_period = kStackSamplingPeriod;
+  if (sample_buckets_.empty()) {
+    // Without buckets, the thread only wakes up to sample stacks.
+    sleep_time *= kStackSamplingPeriod;
+    stack_sampling_period = 1;
+  }
+  for (int i = 0; !cancellation_flag_.IsSet(); ++i) {
+    PlatformThread::Sleep(sleep_time);
     GetSamples();
+    if (stack_sampler_ && i % stack_sampling_period == 0)
+      stack_sampler_->SampleThreads();
     waitable_event_for_testing_.Signal();
   }
 }
@@ -76,6 +91,11 @@ void TraceSamplingThread::RegisterSampleBucket(
   sample_buckets_.push_back(TraceBucketData(bucket, name, callback));
 }
 
+void TraceSamplingThread::EnableStackSampling() {
+  DCHECK(!thread_running_);
+  stack_sampling_enabled_ = true;
+}
+
 // static
 void TraceSamplingThread::ExtractCategoryAndName(const char* combined,
                                                  const char** category,
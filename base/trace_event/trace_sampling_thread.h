@@ -5,9 +5,11 @@
 #ifndef BASE_TRACE_EVENT_TRACE_SAMPLING_THREAD_H_
 #define BASE_TRACE_EVENT_TRACE_SAMPLING_THREAD_H_
 
+#include "base/memory/scoped_ptr.h"
 #include "base/synchronization/cancellation_flag.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/trace_event/trace_event.h"
+#include "base/trace_event/trace_stack_sampler.h"
 
 namespace base {
 namespace trace_event {
@@ -38,11 +40,18 @@ class TraceSamplingThread : public PlatformThread::Delegate {
   void RegisterSampleBucket(TRACE_EVENT_API_ATOMIC_WORD* bucket,
                             const char* const name,
                             TraceSampleCallback callback);
+  // Makes the thread also sample the native stacks of the registered threads,
+  // with a TraceStackSampler. Same restriction as RegisterSampleBucket.
+  void EnableStackSampling();
   // Splits a combined "category\0name" into the two component parts.
   static void ExtractCategoryAndName(const char* combined,
                                      const char** category,
                                      const char** name);
   std::vector<TraceBucketData> sample_buckets_;
+  bool stack_sampling_enabled_;
+  // Created and used on the sampling thread, and kept after it stops so that
+  // TraceLog can add the stack frames of the samples to the trace.
+  scoped_ptr<TraceStackSampler> stack_sampler_;
   bool thread_running_;
   CancellationFlag cancellation_flag_;
   WaitableEvent waitable_event_for_testing_;
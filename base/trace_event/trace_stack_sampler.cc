@@ -0,0 +1,439 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/trace_stack_sampler.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "base/trace_event/trace_event.h"
+#include "build/build_config.h"
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#if defined(ARCH_CPU_X86_FAMILY) || defined(ARCH_CPU_ARM64)
+#define CAN_CAPTURE_STACKS 1
+#endif
+#endif
+
+#if defined(CAN_CAPTURE_STACKS)
+#include <dlfcn.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "base/atomicops.h"
+#include "base/synchronization/futex_linux.h"
+#endif
+
+#if defined(CAN_CAPTURE_STACKS) && defined(__GLIBCXX__)
+#include <cxxabi.h>
+#endif
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+struct RegisteredThread {
+  PlatformThreadId thread_id;
+  // The highest address of the thread's stack.
+  uintptr_t stack_end;
+};
+
+// Held while sending a capture request, so that the thread cannot exit
+// before it gets the signal, as it unregisters first.
+LazyInstance<Lock>::Leaky g_registry_lock = LAZY_INSTANCE_INITIALIZER;
+LazyInstance<std::vector<RegisteredThread>>::Leaky g_registered_threads =
+    LAZY_INSTANCE_INITIALIZER;
+
+// The frame names, which are never freed, as they are referred to by the
+// stackFrames of traces.
+LazyInstance<Lock>::Leaky g_frame_names_lock = LAZY_INSTANCE_INITIALIZER;
+LazyInstance<std::set<std::string>>::Leaky g_frame_names =
+    LAZY_INSTANCE_INITIALIZER;
+
+const char* InternFrameName(const std::string& name) {
+  AutoLock lock(g_frame_names_lock.Get());
+  return g_frame_names.Get().insert(name).first->c_str();
+}
+
+#if defined(CAN_CAPTURE_STACKS)
+
+// How long to wait for a thread to capture its stack. A thread which does not
+// handle the signal in time, e.g. because it blocks SIGPROF, is not sampled.
+const int kCaptureTimeoutMs = 10;
+
+// The stack being captured, shared between the sampling thread and the
+// signal handler on the sampled thread.
+//
+// Each request has its own sequence number, which |sequence| holds while the
+// request is open. The signal handler takes the request by swapping it for 0,
+// and only then writes |num_frames| and |frames|, so a handler running late
+// cannot overwrite a later request. A sampling thread giving up on a request
+// closes it the same way, and if the handler took it first, waits for it to
+// finish. |thread_id| and |stack_end| only change while no request is open.
+struct CaptureRequest {
+  // The sequence number of the open request, or 0.
+  subtle::Atomic32 sequence;
+  // Set to the sequence number of the request once |frames| are captured.
+  subtle::Atomic32 done_sequence;
+  subtle::Atomic32 thread_id;
+  uintptr_t stack_end;
+  subtle::Atomic32 num_frames;
+  const void* frames[TraceStackSampler::kMaxFrames];
+};
+
+CaptureRequest g_capture_request;
+
+// Held by the sampling thread for a whole capture, as there is one request.
+LazyInstance<Lock>::Leaky g_capture_lock = LAZY_INSTANCE_INITIALIZER;
+// The sequence number of the last request, guarded by g_capture_lock.
+uint32_t g_last_sequence = 0;
+
+// Whether the SIGPROF handler is installed, guarded by g_registry_lock. It is
+// never uninstalled, as a request which timed out may leave a SIGPROF pending,
+// e.g. on a thread blocking all signals for a while, which would kill the
+// process with the default action. The handler ignores it.
+bool g_handler_installed = false;
+// The SIGPROF action the handler replaced, to which it passes on the signals
+// which are not capture requests.
+struct sigaction g_previous_action;
+
+void GetRegisters(const ucontext_t* context,
+                  uintptr_t* pc,
+                  uintptr_t* sp,
+                  uintptr_t* fp) {
+#if defined(ARCH_CPU_X86_64)
+  *pc = context->uc_mcontext.gregs[REG_RIP];
+  *sp = context->uc_mcontext.gregs[REG_RSP];
+  *fp = context->uc_mcontext.gregs[REG_RBP];
+#elif defined(ARCH_CPU_X86)
+  *pc = context->uc_mcontext.gregs[REG_EIP];
+  *sp = context->uc_mcontext.gregs[REG_ESP];
+  *fp = context->uc_mcontext.gregs[REG_EBP];
+#elif defined(ARCH_CPU_ARM64)
+  *pc = context->uc_mcontext.pc;
+  *sp = context->uc_mcontext.sp;
+  *fp = context->uc_mcontext.regs[29];
+#endif
+}
+
+// Walks the frame pointers of the interrupted code. On all the supported
+// architectures, a frame pointer points to the caller's frame pointer,
+// followed by the return address. Only the part of the stack above the stack
+// pointer is read, which is mapped, and the frame pointers must go up, so that
+// a code not keeping frame pointers can only shorten the stack.
+size_t WalkStack(const ucontext_t* context,
+                 uintptr_t stack_end,
+                 const void** frames) {
+  uintptr_t pc;
+  uintptr_t sp;
+  uintptr_t fp;
+  GetRegisters(context, &pc, &sp, &fp);
+  size_t num_frames = 0;
+  frames[num_frames++] = reinterpret_cast<const void*>(pc);
+  while (num_frames < TraceStackSampler::kMaxFrames && fp >= sp &&
+         fp <= stack_end - 2 * sizeof(uintptr_t) &&
+         fp % sizeof(uintptr_t) == 0) {
+    const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+    const uintptr_t return_address = frame[1];
+    if (!return_address)
+      break;
+    frames[num_frames++] = reinterpret_cast<const void*>(return_address);
+    if (frame[0] <= fp)
+      break;
+    fp = frame[0];
+  }
+  return num_frames;
+}
+
+// Takes the open request |sequence| if it is for the current thread, |tid|.
+// Returns false if there is no such request, e.g. as it timed out.
+bool TakeCaptureRequest(subtle::Atomic32 sequence, pid_t tid) {
+  return sequence &&
+         subtle::NoBarrier_Load(&g_capture_request.thread_id) == tid &&
+         subtle::NoBarrier_CompareAndSwap(&g_capture_request.sequence,
+                                          sequence, 0) == sequence;
+}
+
+// Completes the request |sequence|, once taken, with |num_frames| frames.
+void FinishCaptureRequest(subtle::Atomic32 sequence, size_t num_frames) {
+  subtle::NoBarrier_Store(&g_capture_request.num_frames, num_frames);
+  subtle::Release_Store(&g_capture_request.done_sequence, sequence);
+  internal::FutexWake(&g_capture_request.done_sequence, 1);
+}
+
+// Runs on the sampled thread, so may only do async-signal-safe work.
+void CaptureStackSignalHandler(int signal, siginfo_t* info, void* context) {
+  const int saved_errno = errno;
+  // Capture requests are sent with tgkill() from this process. Other SIGPROFs,
+  // e.g. from a profiling timer, go to the previous action.
+  if (info->si_code == SI_TKILL && info->si_pid == getpid()) {
+    const subtle::Atomic32 sequence =
+        subtle::Acquire_Load(&g_capture_request.sequence);
+    if (TakeCaptureRequest(sequence, syscall(__NR_gettid))) {
+      FinishCaptureRequest(
+          sequence,
+          WalkStack(static_cast<const ucontext_t*>(context),
+                    g_capture_request.stack_end, g_capture_request.frames));
+    }
+  } else if (g_previous_action.sa_flags & SA_SIGINFO) {
+    g_previous_action.sa_sigaction(signal, info, context);
+  } else if (g_previous_action.sa_handler != SIG_DFL &&
+             g_previous_action.sa_handler != SIG_IGN) {
+    // The default action, ending the process, is not taken: a SIGPROF which
+    // would have done so is dropped.
+    g_previous_action.sa_handler(signal);
+  }
+  errno = saved_errno;
+}
+
+// Waits for the request |sequence| to be completed, until |deadline| if it is
+// not null. Returns false on timeout.
+bool WaitForCaptureRequest(subtle::Atomic32 sequence,
+                           const TimeTicks* deadline) {
+  for (;;) {
+    const subtle::Atomic32 done_sequence =
+        subtle::Acquire_Load(&g_capture_request.done_sequence);
+    if (done_sequence == sequence)
+      return true;
+    struct timespec timeout;
+    if (deadline) {
+      const TimeDelta remaining = *deadline - TimeTicks::Now();
+      if (remaining <= TimeDelta())
+        return false;
+      timeout = remaining.ToTimeSpec();
+    }
+    internal::FutexWait(&g_capture_request.done_sequence, done_sequence,
+                        deadline ? &timeout : NULL);
+  }
+}
+
+#if defined(__GLIBCXX__)
+std::string Demangle(const char* symbol) {
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(symbol, NULL, 0, &status);
+  if (!demangled)
+    return symbol;
+  std::string name(demangled);
+  free(demangled);
+  return name;
+}
+#else
+std::string Demangle(const char* symbol) {
+  return symbol;
+}
+#endif
+
+#endif  // defined(CAN_CAPTURE_STACKS)
+
+}  // namespace
+
+const char TraceStackSampler::kStackSamplingCategory[] =
+    TRACE_DISABLED_BY_DEFAULT("cpu_profiler");
+const size_t TraceStackSampler::kMaxFrames;
+
+// static
+void TraceStackSampler::RegisterCurrentThread() {
+#if defined(CAN_CAPTURE_STACKS)
+  pthread_attr_t attributes;
+  if (pthread_getattr_np(pthread_self(), &attributes))
+    return;
+  void* stack_address;
+  size_t stack_size;
+  const int error =
+      pthread_attr_getstack(&attributes, &stack_address, &stack_size);
+  pthread_attr_destroy(&attributes);
+  if (error)
+    return;
+
+  RegisteredThread thread;
+  thread.thread_id = PlatformThread::CurrentId();
+  thread.stack_end = reinterpret_cast<uintptr_t>(stack_address) + stack_size;
+  AutoLock lock(g_registry_lock.Get());
+  g_registered_threads.Get().push_back(thread);
+#endif
+}
+
+// static
+void TraceStackSampler::UnregisterCurrentThread() {
+#if defined(CAN_CAPTURE_STACKS)
+  const PlatformThreadId thread_id = PlatformThread::CurrentId();
+  AutoLock lock(g_registry_lock.Get());
+  std::vector<RegisteredThread>& threads = g_registered_threads.Get();
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    if (it->thread_id == thread_id) {
+      threads.erase(it);
+      break;
+    }
+  }
+
+  // A request sent to the thread may not be handled before it exits, e.g. if
+  // it blocks SIGPROF. It is completed without frames, so that it is not left
+  // open for a new thread getting the same id.
+  const subtle::Atomic32 sequence =
+      subtle::Acquire_Load(&g_capture_request.sequence);
+  if (TakeCaptureRequest(sequence, thread_id))
+    FinishCaptureRequest(sequence, 0);
+#endif
+}
+
+// static
+size_t TraceStackSampler::CaptureStack(PlatformThreadId thread_id,
+                                       const void** frames) {
+#if defined(CAN_CAPTURE_STACKS)
+  DCHECK_NE(PlatformThread::CurrentId(), thread_id);
+  AutoLock capture_lock(g_capture_lock.Get());
+  CaptureRequest* request = &g_capture_request;
+  subtle::Atomic32 sequence;
+  bool sent;
+  {
+    AutoLock lock(g_registry_lock.Get());
+    if (!g_handler_installed)
+      return 0;
+    const std::vector<RegisteredThread>& threads = g_registered_threads.Get();
+    auto thread = std::find_if(threads.begin(), threads.end(),
+                               [thread_id](const RegisteredThread& registered) {
+                                 return registered.thread_id == thread_id;
+                               });
+    if (thread == threads.end())
+      return 0;
+
+    subtle::NoBarrier_Store(&request->thread_id, thread_id);
+    request->stack_end = thread->stack_end;
+    // 0 means that no request is open.
+    if (!++g_last_sequence)
+      g_last_sequence = 1;
+    sequence = static_cast<subtle::Atomic32>(g_last_sequence);
+    subtle::Release_Store(&request->sequence, sequence);
+    sent = !syscall(__NR_tgkill, getpid(), thread_id, SIGPROF);
+  }
+
+  const TimeTicks deadline =
+      TimeTicks::Now() + TimeDelta::FromMilliseconds(kCaptureTimeoutMs);
+  if (!sent || !WaitForCaptureRequest(sequence, &deadline)) {
+    // Close the request, unless the thread took it, which then completes it
+    // shortly.
+    if (subtle::NoBarrier_CompareAndSwap(&request->sequence, sequence, 0) ==
+        sequence) {
+      return 0;
+    }
+    WaitForCaptureRequest(sequence, NULL);
+  }
+
+  const size_t num_frames = subtle::NoBarrier_Load(&request->num_frames);
+  std::copy(request->frames, request->frames + num_frames, frames);
+  return num_frames;
+#else
+  return 0;
+#endif
+}
+
+TraceStackSampler::TraceStackSampler()
+    : category_group_enabled_(
+          TRACE_EVENT_API_GET_CATEGORY_GROUP_ENABLED(kStackSamplingCategory)),
+      stack_frame_deduplicator_(new StackFrameDeduplicator) {
+#if defined(CAN_CAPTURE_STACKS)
+  AutoLock lock(g_registry_lock.Get());
+  if (!g_handler_installed) {
+    struct sigaction action = {};
+    action.sa_sigaction = &CaptureStackSignalHandler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &g_previous_action) == 0)
+      g_handler_installed = true;
+    else
+      DPLOG(ERROR) << "sigaction(SIGPROF)";
+  }
+#endif
+}
+
+TraceStackSampler::~TraceStackSampler() {}
+
+void TraceStackSampler::SampleThreads() {
+  if (!*category_group_enabled_)
+    return;
+
+  std::vector<PlatformThreadId> thread_ids;
+  {
+    AutoLock lock(g_registry_lock.Get());
+    for (const RegisteredThread& thread : g_registered_threads.Get())
+      thread_ids.push_back(thread.thread_id);
+  }
+
+  const PlatformThreadId current_thread_id = PlatformThread::CurrentId();
+  const void* frames[kMaxFrames];
+  StackFrame frame_names[kMaxFrames];
+  for (PlatformThreadId thread_id : thread_ids) {
+    if (thread_id == current_thread_id)
+      continue;
+    const size_t num_frames = CaptureStack(thread_id, frames);
+    if (!num_frames)
+      continue;
+    const TimeTicks timestamp = TimeTicks::Now();
+
+    // The deduplicator takes the bottom frame first.
+    for (size_t i = 0; i < num_frames; ++i)
+      frame_names[num_frames - 1 - i] = GetFrameName(frames[i], i > 0);
+    const int stack_frame_id = stack_frame_deduplicator_->Insert(
+        frame_names, frame_names + num_frames);
+
+    const char* arg_name = "stack_frame_id";
+    const unsigned char arg_type = TRACE_VALUE_TYPE_INT;
+    const unsigned long long arg_value = stack_frame_id;
+    TRACE_EVENT_API_ADD_TRACE_EVENT_WITH_THREAD_ID_AND_TIMESTAMP(
+        TRACE_EVENT_PHASE_SAMPLE, category_group_enabled_, "StackSample",
+        trace_event_internal::kNoId, static_cast<int>(thread_id), timestamp,
+        1, &arg_name, &arg_type, &arg_value, NULL, TRACE_EVENT_FLAG_NONE);
+  }
+}
+
+StackFrame TraceStackSampler::GetFrameName(const void* pc,
+                                           bool is_return_address) {
+  auto it = frame_names_.find(pc);
+  if (it != frame_names_.end())
+    return it->second;
+
+  std::string name;
+#if defined(CAN_CAPTURE_STACKS)
+  // A return address may be past the end of the calling function.
+  const char* address = static_cast<const char*>(pc) - is_return_address;
+  Dl_info info;
+  if (dladdr(address, &info)) {
+    if (info.dli_sname) {
+      name = Demangle(info.dli_sname);
+    } else if (info.dli_fname) {
+      const char* module = strrchr(info.dli_fname, '/');
+      name = StringPrintf("%s+0x%" PRIxPTR,
+                          module ? module + 1 : info.dli_fname,
+                          reinterpret_cast<uintptr_t>(pc) -
+                              reinterpret_cast<uintptr_t>(info.dli_fbase));
+    }
+  }
+#endif
+  if (name.empty())
+    name = StringPrintf("%p", pc);
+
+  StackFrame frame_name = InternFrameName(name);
+  frame_names_[pc] = frame_name;
+  return frame_name;
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,85 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TRACE_EVENT_TRACE_STACK_SAMPLER_H_
+#define BASE_TRACE_EVENT_TRACE_STACK_SAMPLER_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/containers/hash_tables.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/threading/platform_thread.h"
+#include "base/trace_event/heap_profiler_stack_frame_deduplicator.h"
+
+namespace base {
+namespace trace_event {
+
+// Periodically sampling the native stacks of the registered threads shows
+// where their CPU time goes, without an external profiler. It is enabled by
+// tracing with the kStackSamplingCategory category, and done from the
+// TraceSamplingThread.
+//
+// The stack of a thread is captured by sending it a SIGPROF, whose handler
+// walks the frame pointers of the interrupted code, so the stacks only go as
+// deep as the code keeps frame pointers (-fno-omit-frame-pointer). Each
+// sample is added to the trace as a sample event of the sampled thread, with
+// a "stack_frame_id" argument indexing the "stackFrames" metadata event which
+// is added when tracing stops. Capturing stacks is only supported on Linux and
+// Android on x86, x86-64 and ARM64; elsewhere no samples are taken.
+class BASE_EXPORT TraceStackSampler {
+ public:
+  // The category of the sample events, which enables stack sampling.
+  static const char kStackSamplingCategory[];
+
+  // The deepest stack which is captured.
+  static const size_t kMaxFrames = 64;
+
+  // Makes the stack of the current thread be sampled, until the thread calls
+  // UnregisterCurrentThread(), which it must do before it exits. base::Thread
+  // registers its threads.
+  static void RegisterCurrentThread();
+  static void UnregisterCurrentThread();
+
+  // Captures the stack of the registered thread |thread_id|, into |frames|,
+  // which has room for kMaxFrames program counters, the most recently called
+  // function first. Returns the number of frames, or 0 if the stack could not
+  // be captured, e.g. as no TraceStackSampler could install the SIGPROF
+  // handler. Must not be called on the thread itself.
+  static size_t CaptureStack(PlatformThreadId thread_id, const void** frames);
+
+  // Installs the SIGPROF handler, if not done yet. It stays installed for the
+  // lifetime of the process, and passes the SIGPROFs which are not capture
+  // requests, e.g. from a profiling timer, to the handler installed before.
+  TraceStackSampler();
+  ~TraceStackSampler();
+
+  // Captures the stacks of all the registered threads, but the current one,
+  // and adds them to the trace.
+  void SampleThreads();
+
+  // The call trees of the samples, which the "stackFrames" metadata event
+  // holds.
+  const scoped_refptr<StackFrameDeduplicator>& stack_frame_deduplicator()
+      const {
+    return stack_frame_deduplicator_;
+  }
+
+ private:
+  // Returns the name of the function at |pc|, which is kept for the lifetime
+  // of the process, as the trace may outlive the sampler.
+  StackFrame GetFrameName(const void* pc, bool is_return_address);
+
+  const unsigned char* const category_group_enabled_;
+  scoped_refptr<StackFrameDeduplicator> stack_frame_deduplicator_;
+  hash_map<const void*, StackFrame> frame_names_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceStackSampler);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BASE_TRACE_EVENT_TRACE_STACK_SAMPLER_H_
@@ -0,0 +1,166 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/trace_stack_sampler.h"
+
+#include <stddef.h>
+
+#include "base/macros.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+#if (defined(OS_LINUX) || defined(OS_ANDROID)) && \
+    (defined(ARCH_CPU_X86_FAMILY) || defined(ARCH_CPU_ARM64))
+#define CAN_CAPTURE_STACKS 1
+#endif
+
+#if defined(CAN_CAPTURE_STACKS)
+#include <signal.h>
+#endif
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+// Waits to be stopped, possibly registered for its stack to be sampled.
+class WaitingThread : public PlatformThread::Delegate {
+ public:
+  explicit WaitingThread(bool register_thread)
+      : register_thread_(register_thread),
+        block_sigprof_(false),
+        thread_id_(kInvalidThreadId),
+        started_(false, false),
+        unblock_sigprof_(false, false),
+        stop_(false, false) {}
+
+  void ThreadMain() override {
+    if (register_thread_)
+      TraceStackSampler::RegisterCurrentThread();
+#if defined(CAN_CAPTURE_STACKS)
+    sigset_t sigprof;
+    sigemptyset(&sigprof);
+    sigaddset(&sigprof, SIGPROF);
+    if (block_sigprof_)
+      pthread_sigmask(SIG_BLOCK, &sigprof, NULL);
+#endif
+    thread_id_ = PlatformThread::CurrentId();
+    started_.Signal();
+#if defined(CAN_CAPTURE_STACKS)
+    if (block_sigprof_) {
+      unblock_sigprof_.Wait();
+      pthread_sigmask(SIG_UNBLOCK, &sigprof, NULL);
+    }
+#endif
+    stop_.Wait();
+    if (register_thread_)
+      TraceStackSampler::UnregisterCurrentThread();
+  }
+
+  void Start() {
+    ASSERT_TRUE(PlatformThread::Create(0, this, &handle_));
+    started_.Wait();
+  }
+
+  // Makes the thread block SIGPROF until UnblockSigprof() is called. Must be
+  // called before Start().
+  void BlockSigprof() { block_sigprof_ = true; }
+  void UnblockSigprof() { unblock_sigprof_.Signal(); }
+
+  void Stop() {
+    stop_.Signal();
+    PlatformThread::Join(handle_);
+  }
+
+  PlatformThreadId thread_id() const { return thread_id_; }
+
+ private:
+  const bool register_thread_;
+  bool block_sigprof_;
+  PlatformThreadId thread_id_;
+  PlatformThreadHandle handle_;
+  WaitableEvent started_;
+  WaitableEvent unblock_sigprof_;
+  WaitableEvent stop_;
+
+  DISALLOW_COPY_AND_ASSIGN(WaitingThread);
+};
+
+}  // namespace
+
+TEST(TraceStackSamplerTest, CaptureStack) {
+  TraceStackSampler sampler;
+  WaitingThread registered_thread(true);
+  registered_thread.Start();
+  WaitingThread unregistered_thread(false);
+  unregistered_thread.Start();
+
+  const void* frames[TraceStackSampler::kMaxFrames];
+#if defined(CAN_CAPTURE_STACKS)
+  // The thread is interrupted in its wait, which is captured again. A capture
+  // gives up after a short while, which a loaded machine may take to deliver
+  // the signal, so it is retried.
+  for (int i = 0; i < 3; ++i) {
+    const TimeTicks deadline = TimeTicks::Now() + TimeDelta::FromSeconds(10);
+    size_t num_frames = 0;
+    while (!num_frames && TimeTicks::Now() < deadline) {
+      num_frames = TraceStackSampler::CaptureStack(
+          registered_thread.thread_id(), frames);
+    }
+    EXPECT_GE(num_frames, 1u);
+    EXPECT_LE(num_frames, TraceStackSampler::kMaxFrames);
+    EXPECT_TRUE(frames[0]);
+  }
+#else
+  EXPECT_EQ(0u, TraceStackSampler::CaptureStack(registered_thread.thread_id(),
+                                                frames));
+#endif
+  EXPECT_EQ(0u, TraceStackSampler::CaptureStack(
+                    unregistered_thread.thread_id(), frames));
+
+  registered_thread.Stop();
+  unregistered_thread.Stop();
+}
+
+#if defined(CAN_CAPTURE_STACKS)
+TEST(TraceStackSamplerTest, LateSignalIsIgnored) {
+  TraceStackSampler sampler;
+  WaitingThread blocking_thread(true);
+  blocking_thread.BlockSigprof();
+  blocking_thread.Start();
+  WaitingThread thread(true);
+  thread.Start();
+
+  // The request to the thread blocking SIGPROF times out, and its handler runs
+  // late, maybe while another stack is being captured, which must not be
+  // disturbed. Later requests to both threads are handled.
+  const void* frames[TraceStackSampler::kMaxFrames];
+  EXPECT_EQ(0u, TraceStackSampler::CaptureStack(blocking_thread.thread_id(),
+                                                frames));
+  blocking_thread.UnblockSigprof();
+  const TimeTicks deadline = TimeTicks::Now() + TimeDelta::FromSeconds(10);
+  size_t num_frames = 0;
+  for (int i = 0; i < 100 && TimeTicks::Now() < deadline; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      num_frames = 0;
+      frames[0] = NULL;
+      const PlatformThreadId thread_id =
+          j ? blocking_thread.thread_id() : thread.thread_id();
+      while (!num_frames && TimeTicks::Now() < deadline)
+        num_frames = TraceStackSampler::CaptureStack(thread_id, frames);
+      EXPECT_GE(num_frames, 1u);
+      EXPECT_TRUE(frames[0]);
+    }
+  }
+
+  blocking_thread.Stop();
+  thread.Stop();
+}
+#endif  // defined(CAN_CAPTURE_STACKS)
+
+}  // namespace trace_event
+}  // namespace base
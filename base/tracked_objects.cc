@@ -340,6 +340,7 @@ ThreadData::ThreadData(int thread_number)
 }
 
 ThreadData::~ThreadData() {
+  deaths_.ForEach([](Deaths* deaths) { delete deaths; });
 }
 
 void ThreadData::PushToHeadOfList() {
@@ -487,17 +488,12 @@ void ThreadData::OnProfilingPhaseCompleted(int profiling_phase) {
 }
 
 Births* ThreadData::TallyABirth(const Location& location) {
-  BirthMap::iterator it = birth_map_.find(location);
-  Births* child;
-  if (it != birth_map_.end()) {
-    child =  it->second;
+  Births* child = births_.Find(location);
+  if (child) {
     child->RecordBirth();
   } else {
     child = new Births(location, *this);  // Leak this.
-    // Lock since the map may get relocated now, and other threads sometimes
-    // snapshot it (but they lock before copying it).
-    base::AutoLock lock(map_lock_);
-    birth_map_[location] = child;
+    births_.Insert(child);
   }
 
   return child;
@@ -525,15 +521,12 @@ void ThreadData::TallyADeath(const Births& births,
     queue_duration = 0;
   }
 
-  DeathMap::iterator it = death_map_.find(&births);
-  DeathData* death_data;
-  if (it != death_map_.end()) {
-    death_data = &it->second;
-  } else {
-    base::AutoLock lock(map_lock_);  // Lock as the map may get relocated now.
-    death_data = &death_map_[&births];
-  }  // Release lock ASAP.
-  death_data->RecordDeath(queue_duration, run_duration, random_number_);
+  Deaths* deaths = deaths_.Find(&births);
+  if (!deaths) {
+    deaths = new Deaths(&births);
+    deaths_.Insert(deaths);
+  }
+  deaths->death_data.RecordDeath(queue_duration, run_duration, random_number_);
 }
 
 // static
@@ -664,31 +657,29 @@ void ThreadData::SnapshotExecutedTasks(
 void ThreadData::SnapshotMaps(int profiling_phase,
                               BirthMap* birth_map,
                               DeathsSnapshot* deaths) {
-  base::AutoLock lock(map_lock_);
-
-  for (const auto& birth : birth_map_)
-    (*birth_map)[birth.first] = birth.second;
+  births_.ForEach([birth_map](Births* births) {
+    (*birth_map)[births->location()] = births;
+  });
 
-  for (const auto& death : death_map_) {
+  deaths_.ForEach([profiling_phase, deaths](const Deaths* death) {
+    const DeathData& death_data = death->death_data;
     deaths->push_back(std::make_pair(
-        death.first,
-        DeathDataPhaseSnapshot(profiling_phase, death.second.count(),
-                               death.second.run_duration_sum(),
-                               death.second.run_duration_max(),
-                               death.second.run_duration_sample(),
-                               death.second.queue_duration_sum(),
-                               death.second.queue_duration_max(),
-                               death.second.queue_duration_sample(),
-                               death.second.last_phase_snapshot())));
-  }
+        death->births,
+        DeathDataPhaseSnapshot(profiling_phase, death_data.count(),
+                               death_data.run_duration_sum(),
+                               death_data.run_duration_max(),
+                               death_data.run_duration_sample(),
+                               death_data.queue_duration_sum(),
+                               death_data.queue_duration_max(),
+                               death_data.queue_duration_sample(),
+                               death_data.last_phase_snapshot())));
+  });
 }
 
 void ThreadData::OnProfilingPhaseCompletedOnThread(int profiling_phase) {
-  base::AutoLock lock(map_lock_);
-
-  for (auto& death : death_map_) {
-    death.second.OnProfilingPhaseCompleted(profiling_phase);
-  }
+  deaths_.ForEach([profiling_phase](Deaths* death) {
+    death->death_data.OnProfilingPhaseCompleted(profiling_phase);
+  });
 }
 
 static void OptionallyInitializeAlternateTimer() {
@@ -845,9 +836,8 @@ void ThreadData::ShutdownSingleThreadedCleanup(bool leak) {
     ThreadData* next_thread_data = thread_data_list;
     thread_data_list = thread_data_list->next();
 
-    for (BirthMap::iterator it = next_thread_data->birth_map_.begin();
-         next_thread_data->birth_map_.end() != it; ++it)
-      delete it->second;  // Delete the Birth Records.
+    // Delete the Birth Records.
+    next_thread_data->births_.ForEach([](Births* births) { delete births; });
     delete next_thread_data;  // Includes all Death Records.
   }
 }
@@ -878,6 +868,11 @@ void TaskStopwatch::Start() {
 #endif
 
   start_time_ = ThreadData::Now();
+  // The time stamp counter only replaces the real time source.
+  if (!start_time_.is_null() &&
+      !(kAllowAlternateTimeSourceHandling && ThreadData::now_function_)) {
+    start_counter_ = TimeStampCounter::Now();
+  }
 
   current_thread_data_ = ThreadData::Get();
   if (!current_thread_data_)
@@ -895,17 +890,20 @@ void TaskStopwatch::Start() {
 }
 
 void TaskStopwatch::Stop() {
-  const TrackedTime end_time = ThreadData::Now();
+  if (!start_counter_.is_null()) {
+    wallclock_duration_ms_ =
+        (TimeStampCounter::Now() - start_counter_).InMilliseconds();
+  } else {
+    const TrackedTime end_time = ThreadData::Now();
+    if (!start_time_.is_null() && !end_time.is_null())
+      wallclock_duration_ms_ = (end_time - start_time_).InMilliseconds();
+  }
 #if DCHECK_IS_ON()
   DCHECK(state_ == RUNNING);
   state_ = STOPPED;
   DCHECK(child_ == NULL);
 #endif
 
-  if (!start_time_.is_null() && !end_time.is_null()) {
-    wallclock_duration_ms_ = (end_time - start_time_).InMilliseconds();
-  }
-
   if (!current_thread_data_)
     return;
 
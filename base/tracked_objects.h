@@ -21,6 +21,7 @@
 #include "base/lazy_instance.h"
 #include "base/location.h"
 #include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/process/process_handle.h"
 #include "base/profiler/alternate_timer.h"
 #include "base/profiler/tracked_time.h"
@@ -110,10 +111,12 @@ struct TrackingInfo;
 // Each thread maintains a list of data items specific to that thread in a
 // ThreadData instance (for that specific thread only).  The two critical items
 // are lists of DeathData and Births instances.  These lists are maintained in
-// STL maps, which are indexed by Location.  As noted earlier, we can compare
-// locations very efficiently as we consider the underlying data (file,
-// function, line) to be atoms, and hence pointer comparison is used rather than
-// (slow) string comparisons.
+// open-addressing hash tables (see SingleWriterTable), indexed by Location and
+// by Births respectively, which only the owning thread writes, and which other
+// threads read without locking.  As noted earlier, we can compare locations
+// very efficiently as we consider the underlying data (file, function, line) to
+// be atoms, and hence pointer comparison is used rather than (slow) string
+// comparisons.
 //
 // To provide a mechanism for iterating over all "known threads," which means
 // threads that have recorded a birth or a death, we create a singly linked list
@@ -397,6 +400,125 @@ class BASE_EXPORT DeathData {
   DISALLOW_ASSIGN(DeathData);
 };
 
+//------------------------------------------------------------------------------
+// An open-addressing hash table of pointers to |Entry| records, indexed by
+// |Traits::GetKey(entry)|.  Only one thread looks up and inserts entries, and
+// it does so without a lock; any thread may visit the entries concurrently.
+// Entries are never removed, nor deleted by the table.  When the table grows,
+// its previous buckets are kept until destruction, so that a concurrent visit
+// can finish with them (missing the entries inserted meanwhile).
+//
+// |Traits| provides a Key type, and static GetKey(const Entry&) and
+// Hash(const Key&) functions.
+
+template <typename Entry, typename Traits>
+class SingleWriterTable {
+ public:
+  typedef typename Traits::Key Key;
+
+  SingleWriterTable() : buckets_(0), size_(0) {}
+
+  ~SingleWriterTable() {
+    const Buckets* buckets = current_buckets();
+    while (buckets) {
+      const Buckets* previous = buckets->previous;
+      delete buckets;
+      buckets = previous;
+    }
+  }
+
+  // Returns the entry with |key|, or NULL.  Only called on the writing thread.
+  Entry* Find(const Key& key) const {
+    const Buckets* buckets = current_buckets();
+    if (!buckets)
+      return NULL;
+    const size_t mask = buckets->capacity - 1;
+    for (size_t i = Traits::Hash(key) & mask;; i = (i + 1) & mask) {
+      Entry* entry = reinterpret_cast<Entry*>(
+          base::subtle::NoBarrier_Load(&buckets->entries[i]));
+      if (!entry || Traits::GetKey(*entry) == key)
+        return entry;
+    }
+  }
+
+  // Adds |entry|, whose key must not be in the table yet.  Only called on the
+  // writing thread.
+  void Insert(Entry* entry) {
+    Buckets* buckets = current_buckets();
+    // Keep the table at most half full, so that probe sequences stay short.
+    if (!buckets || 2 * (size_ + 1) > buckets->capacity) {
+      Buckets* grown = new Buckets(
+          buckets ? 2 * buckets->capacity : kInitialCapacity, buckets);
+      for (size_t i = 0; buckets && i < buckets->capacity; ++i) {
+        Entry* old_entry = reinterpret_cast<Entry*>(
+            base::subtle::NoBarrier_Load(&buckets->entries[i]));
+        if (old_entry)
+          Store(grown, old_entry);
+      }
+      // Publishes the entries of |grown| along with it.
+      base::subtle::Release_Store(&buckets_,
+                                  reinterpret_cast<base::subtle::AtomicWord>(
+                                      grown));
+      buckets = grown;
+    }
+    Store(buckets, entry);
+    ++size_;
+  }
+
+  // Calls |visitor| with each entry.  May be called on any thread.
+  template <typename Visitor>
+  void ForEach(const Visitor& visitor) const {
+    const Buckets* buckets = reinterpret_cast<const Buckets*>(
+        base::subtle::Acquire_Load(&buckets_));
+    for (size_t i = 0; buckets && i < buckets->capacity; ++i) {
+      Entry* entry = reinterpret_cast<Entry*>(
+          base::subtle::Acquire_Load(&buckets->entries[i]));
+      if (entry)
+        visitor(entry);
+    }
+  }
+
+ private:
+  static const size_t kInitialCapacity = 16;
+
+  struct Buckets {
+    Buckets(size_t capacity, const Buckets* previous)
+        : capacity(capacity),
+          previous(previous),
+          entries(new base::subtle::AtomicWord[capacity]()) {}
+
+    // A power of 2.
+    const size_t capacity;
+    const Buckets* const previous;
+    const scoped_ptr<base::subtle::AtomicWord[]> entries;
+  };
+
+  Buckets* current_buckets() const {
+    return reinterpret_cast<Buckets*>(
+        base::subtle::NoBarrier_Load(&buckets_));
+  }
+
+  // Stores |entry| in the first free bucket of its probe sequence, publishing
+  // its contents.
+  static void Store(Buckets* buckets, Entry* entry) {
+    const size_t mask = buckets->capacity - 1;
+    size_t i = Traits::Hash(Traits::GetKey(*entry)) & mask;
+    while (base::subtle::NoBarrier_Load(&buckets->entries[i]))
+      i = (i + 1) & mask;
+    base::subtle::Release_Store(&buckets->entries[i],
+                                reinterpret_cast<base::subtle::AtomicWord>(
+                                    entry));
+  }
+
+  // The current Buckets, read by visitors on other threads.
+  base::subtle::AtomicWord buckets_;
+
+  // The number of entries.  Only accessed on the writing thread.
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(SingleWriterTable);
+};
+
 //------------------------------------------------------------------------------
 // A temporary collection of data that can be sorted and summarized.  It is
 // gathered (carefully) from many threads.  Instances are held in arrays and
@@ -447,7 +569,6 @@ class BASE_EXPORT ThreadData {
   };
 
   typedef base::hash_map<Location, Births*, Location::Hash> BirthMap;
-  typedef std::map<const Births*, DeathData> DeathMap;
 
   // Initialize the current thread context with a new instance of ThreadData.
   // This is used by all threads that have names, and should be explicitly
@@ -564,6 +685,32 @@ class BASE_EXPORT ThreadData {
   typedef std::vector<std::pair<const Births*, DeathDataPhaseSnapshot>>
       DeathsSnapshot;
 
+  // The deaths on this thread of the tasks born at a Births.
+  struct Deaths {
+    explicit Deaths(const Births* births) : births(births) {}
+
+    const Births* const births;
+    DeathData death_data;
+  };
+
+  struct BirthsTraits {
+    typedef Location Key;
+    static const Location& GetKey(const Births& births) {
+      return births.location();
+    }
+    static size_t Hash(const Location& location) {
+      return Location::Hash()(location);
+    }
+  };
+
+  struct DeathsTraits {
+    typedef const Births* Key;
+    static const Births* GetKey(const Deaths& deaths) { return deaths.births; }
+    static size_t Hash(const Births* births) {
+      return base::HashPair(reinterpret_cast<uintptr_t>(births), 0);
+    }
+  };
+
   // Worker thread construction creates a name since there is none.
   explicit ThreadData(int thread_number);
 
@@ -592,10 +739,10 @@ class BASE_EXPORT ThreadData {
                    int32_t queue_duration,
                    const TaskStopwatch& stopwatch);
 
-  // Snapshots (under a lock) the profiled data for the tasks for this thread
-  // and writes all of the executed tasks' data -- i.e. the data for all
-  // profiling phases (including the current one: |current_profiling_phase|) for
-  // the tasks with with entries in the death_map_ -- into |phased_snapshots|.
+  // Snapshots the profiled data for the tasks for this thread and writes all
+  // of the executed tasks' data -- i.e. the data for all profiling phases
+  // (including the current one: |current_profiling_phase|) for the tasks with
+  // with entries in deaths_ -- into |phased_snapshots|.
   // Also updates the |birth_counts| tally for each task to keep track of the
   // number of living instances of the task -- that is, each task maps to the
   // number of births for the task that have not yet been balanced by a death.
@@ -603,9 +750,9 @@ class BASE_EXPORT ThreadData {
                              PhasedProcessDataSnapshotMap* phased_snapshots,
                              BirthCountMap* birth_counts);
 
-  // Using our lock, make a copy of the specified maps.  This call may be made
-  // on  non-local threads, which necessitate the use of the lock to prevent
-  // the map(s) from being reallocated while they are copied.
+  // Makes a copy of the births and deaths of this thread.  This call may be
+  // made on non-local threads, without locking: the tables are only appended
+  // to, and stay readable while they grow.
   void SnapshotMaps(int profiling_phase,
                     BirthMap* birth_map,
                     DeathsSnapshot* deaths);
@@ -698,25 +845,15 @@ class BASE_EXPORT ThreadData {
   // corresponding to the created thread name if it is a worker thread.
   int worker_thread_number_;
 
-  // A map used on each thread to keep track of Births on this thread.
-  // This map should only be accessed on the thread it was constructed on.
-  // When a snapshot is needed, this structure can be locked in place for the
-  // duration of the snapshotting activity.
-  BirthMap birth_map_;
+  // A table used on each thread to keep track of Births on this thread.
+  // It is only written on the thread it was constructed on, and may be read
+  // from any thread when a snapshot is needed.
+  SingleWriterTable<Births, BirthsTraits> births_;
 
-  // Similar to birth_map_, this records informations about death of tracked
+  // Similar to births_, this records informations about death of tracked
   // instances (i.e., when a tracked instance was destroyed on this thread).
-  // It is locked before changing, and hence other threads may access it by
-  // locking before reading it.
-  DeathMap death_map_;
-
-  // Lock to protect *some* access to BirthMap and DeathMap.  The maps are
-  // regularly read and written on this thread, but may only be read from other
-  // threads.  To support this, we acquire this lock if we are writing from this
-  // thread, or reading from another thread.  For reading from this thread we
-  // don't need a lock, as there is no potential for a conflict since the
-  // writing is only done from this thread.
-  mutable base::Lock map_lock_;
+  // The Deaths records are owned by this ThreadData.
+  SingleWriterTable<Deaths, DeathsTraits> deaths_;
 
   // A random number that we used to select decide which sample to keep as a
   // representative sample in each DeathData instance.  We can't start off with
@@ -771,6 +908,10 @@ class BASE_EXPORT TaskStopwatch {
   // Time when the stopwatch was started.
   TrackedTime start_time_;
 
+  // Time stamp counter when the stopwatch was started, if the run duration is
+  // measured with it rather than with a second ThreadData::Now().
+  TimeStampCounter start_counter_;
+
   // Wallclock duration of the task.
   int32_t wallclock_duration_ms_;
 
@@ -11,6 +11,7 @@
 
 #include "base/memory/scoped_ptr.h"
 #include "base/process/process_handle.h"
+#include "base/threading/simple_thread.h"
 #include "base/time/time.h"
 #include "base/tracking_info.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -119,6 +120,69 @@ class TrackedObjectsTest : public testing::Test {
 // static
 unsigned int TrackedObjectsTest::test_time_;
 
+namespace {
+
+const int kLocations = 300;
+const int kTasksPerLocation = 20;
+
+// Runs |kTasksPerLocation| tasks born at each of |kLocations| locations, on a
+// worker thread.
+class ManyLocationsThread : public base::SimpleThread {
+ public:
+  ManyLocationsThread() : base::SimpleThread("ManyLocationsThread") {}
+
+  void Run() override {
+    for (int i = 0; i < kTasksPerLocation; ++i) {
+      for (int line = 1; line <= kLocations; ++line) {
+        const Births* births = ThreadData::TallyABirthIfActive(
+            Location("ManyLocations", kFile, line, NULL));
+        TaskStopwatch stopwatch;
+        stopwatch.Start();
+        stopwatch.Stop();
+        ThreadData::TallyRunOnWorkerThreadIfTracking(births, TrackedTime(),
+                                                     stopwatch);
+      }
+    }
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ManyLocationsThread);
+};
+
+}  // namespace
+
+TEST_F(TrackedObjectsTest, SnapshotWhileTallying) {
+  ThreadData::InitializeAndSetTrackingStatus(ThreadData::PROFILING_ACTIVE);
+
+  // Snapshots are taken without locking, while the tables of the worker
+  // thread grow.
+  ManyLocationsThread thread;
+  thread.Start();
+  for (int i = 0; i < 100; ++i) {
+    ProcessDataSnapshot process_data;
+    ThreadData::Snapshot(0, &process_data);
+    for (const TaskSnapshot& task : process_data.phased_snapshots[0].tasks) {
+      EXPECT_EQ(kFile, task.birth.location.file_name);
+      EXPECT_LE(task.death_data.count, kTasksPerLocation);
+    }
+  }
+  thread.Join();
+
+  ProcessDataSnapshot process_data;
+  ThreadData::Snapshot(0, &process_data);
+  const std::vector<TaskSnapshot>& tasks =
+      process_data.phased_snapshots[0].tasks;
+  ASSERT_EQ(static_cast<size_t>(kLocations), tasks.size());
+  std::vector<bool> seen(kLocations + 1);
+  for (const TaskSnapshot& task : tasks) {
+    ASSERT_GE(task.birth.location.line_number, 1);
+    ASSERT_LE(task.birth.location.line_number, kLocations);
+    EXPECT_FALSE(seen[task.birth.location.line_number]);
+    seen[task.birth.location.line_number] = true;
+    EXPECT_EQ(kTasksPerLocation, task.death_data.count);
+  }
+}
+
 TEST_F(TrackedObjectsTest, TaskStopwatchNoStartStop) {
   ThreadData::InitializeAndSetTrackingStatus(ThreadData::PROFILING_ACTIVE);
 
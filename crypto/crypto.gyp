@@ -160,6 +160,22 @@
         '<@(crypto_sources)',
       ],
     },
+    {
+      # GN: //crypto:crypto_perftests
+      'target_name': 'crypto_perftests',
+      'type': '<(gtest_target_type)',
+      'dependencies': [
+        'crypto',
+        '../base/base.gyp:base',
+        '../base/base.gyp:test_support_base',
+        '../testing/gtest.gyp:gtest',
+      ],
+      'sources': [
+        'sha2_perftest.cc',
+        '../base/test/run_all_unittests.cc',
+        '../testing/perf/perf_test.cc'
+      ],
+    },
     {
       'target_name': 'crypto_unittests',
       'type': 'executable',
@@ -30,6 +30,15 @@ CRYPTO_EXPORT void SHA256HashString(const base::StringPiece& str,
 // string.
 CRYPTO_EXPORT std::string SHA256HashString(const base::StringPiece& str);
 
+// Computes the SHA-256 hashes of the |count| strings in |strs| and stores the
+// hash of strs[i] at 'output' + i * kSHA256Length. 'output' must be
+// |count| * kSHA256Length bytes long. On CPUs with AVX2 but without the SHA
+// extensions, eight strings are hashed in parallel, which is much faster than
+// hashing them one by one.
+CRYPTO_EXPORT void SHA256HashStrings(const base::StringPiece* strs,
+                                     size_t count,
+                                     void* output);
+
 }  // namespace crypto
 
 #endif  // CRYPTO_SHA2_H_
@@ -0,0 +1,39 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// SHA-256 pieces shared by crypto/sha2.cc and the NSS SHA-256 implementation
+// in crypto/third_party/nss/sha512.cc. Not for other uses.
+
+#ifndef CRYPTO_SHA2_INTERNAL_H_
+#define CRYPTO_SHA2_INTERNAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/cpu.h"
+
+namespace crypto {
+namespace internal {
+
+// The SHA-256 round constants, K in FIPS 180-4.
+extern const uint32_t kSHA256RoundConstants[64];
+
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+// Whether ProcessSHA256BlocksSHA() may be called on this CPU.
+bool CanUseSHA256Extensions();
+
+// Runs the SHA-256 compression function over the |num_blocks| 64-byte blocks
+// at |blocks|, updating |state|, using the SHA extensions. |blocks| need not
+// be aligned.
+void ProcessSHA256BlocksSHA(uint32_t state[8],
+                            const uint8_t* blocks,
+                            size_t num_blocks);
+
+#endif  // defined(BASE_CPU_TARGET_ATTRIBUTES)
+
+}  // namespace internal
+}  // namespace crypto
+
+#endif  // CRYPTO_SHA2_INTERNAL_H_
@@ -0,0 +1,72 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crypto/sha2.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/format_macros.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace crypto {
+
+namespace {
+
+// Each measurement hashes this many bytes in total.
+const size_t kBytesPerMeasurement = 64 * 1024 * 1024;
+
+// The strings are hashed in batches of this many.
+const size_t kBatchSize = 64;
+
+void PrintThroughput(const std::string& measurement,
+                     size_t string_size,
+                     base::TimeDelta elapsed) {
+  perf_test::PrintResult(
+      measurement, "", base::StringPrintf("%" PRIuS "_bytes", string_size),
+      kBytesPerMeasurement / elapsed.InSecondsF() / (1024 * 1024), "MiB/s",
+      true);
+}
+
+void MeasureThroughput(size_t string_size) {
+  const std::string data(kBatchSize * string_size, 'a');
+  std::vector<base::StringPiece> strs;
+  for (size_t i = 0; i < kBatchSize; i++) {
+    strs.push_back(
+        base::StringPiece(data.data() + i * string_size, string_size));
+  }
+  std::vector<uint8_t> output(kBatchSize * kSHA256Length);
+  const size_t iterations = kBytesPerMeasurement / data.size();
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (size_t i = 0; i < iterations; i++) {
+    for (size_t j = 0; j < kBatchSize; j++)
+      SHA256HashString(strs[j], &output[j * kSHA256Length], kSHA256Length);
+  }
+  PrintThroughput("sha256_single", string_size,
+                  base::TimeTicks::Now() - start);
+
+  start = base::TimeTicks::Now();
+  for (size_t i = 0; i < iterations; i++)
+    SHA256HashStrings(strs.data(), strs.size(), output.data());
+  PrintThroughput("sha256_multiple", string_size,
+                  base::TimeTicks::Now() - start);
+}
+
+}  // namespace
+
+TEST(Sha256PerfTest, Throughput) {
+  MeasureThroughput(64);
+  MeasureThroughput(1024);
+  MeasureThroughput(16 * 1024);
+}
+
+}  // namespace crypto
@@ -7,6 +7,14 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <string>
+#include <vector>
+
+#include "base/cpu.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_piece.h"
+#include "crypto/secure_hash.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 TEST(Sha256Test, Test1) {
@@ -100,3 +108,112 @@ TEST(Sha256Test, Test3) {
   for (size_t i = 0; i < sizeof(output_truncated3); i++)
     EXPECT_EQ(expected3[i], static_cast<int>(output_truncated3[i]));
 }
+
+TEST(Sha256Test, StringsKnownAnswersEveryKernel) {
+  // The examples from FIPS 180-2, repeated so that the strings fill more than
+  // one batch of lanes.
+  const std::string inputs[] = {
+      "abc", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      std::string(1000000, 'a')};
+  const uint8_t expected[][crypto::kSHA256Length] = {
+      {0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40,
+       0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17,
+       0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad},
+      {0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26,
+       0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff,
+       0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1},
+      {0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7,
+       0xe2, 0x84, 0xd7, 0x3e, 0x67, 0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97,
+       0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0}};
+
+  const size_t kCount = 20;
+  std::vector<base::StringPiece> strs;
+  for (size_t i = 0; i < kCount; i++)
+    strs.push_back(inputs[i % 3]);
+
+  // Hiding the SHA extensions makes the multi-buffer kernel run wherever the
+  // machine has AVX2, and hiding AVX2 makes the strings be hashed one by one,
+  // with the SHA extensions or, hiding both, without.
+  const int kDisabledFeatures[] = {
+      0, base::CPU::FEATURE_SHA, base::CPU::FEATURE_AVX2,
+      base::CPU::FEATURE_SHA | base::CPU::FEATURE_AVX2};
+  for (size_t k = 0; k < arraysize(kDisabledFeatures); k++) {
+    base::CPU::SetDisabledFeaturesForTesting(kDisabledFeatures[k]);
+    std::vector<uint8_t> output(kCount * crypto::kSHA256Length);
+    crypto::SHA256HashStrings(strs.data(), kCount, output.data());
+
+    for (size_t i = 0; i < kCount; i++) {
+      for (size_t j = 0; j < crypto::kSHA256Length; j++) {
+        EXPECT_EQ(expected[i % 3][j], output[i * crypto::kSHA256Length + j])
+            << "disabled features " << kDisabledFeatures[k] << ", string "
+            << i;
+      }
+    }
+  }
+  base::CPU::SetDisabledFeaturesForTesting(0);
+}
+
+TEST(Sha256Test, StringsMatchSingle) {
+  // Strings of every length up to three blocks, around the padding
+  // boundaries, and in batches that leave lanes idle.
+  std::string data(300, 0);
+  uint32_t x = 1;
+  for (size_t i = 0; i < data.size(); i++) {
+    x = x * 1103515245 + 12345;
+    data[i] = static_cast<char>(x >> 16);
+  }
+
+  for (size_t count = 0; count <= 200; count += count < 10 ? 1 : 19) {
+    std::vector<base::StringPiece> strs;
+    for (size_t i = 0; i < count; i++) {
+      // Vary the offset too, so that the blocks are not aligned.
+      strs.push_back(
+          base::StringPiece(data.data() + i % 7, (i * 37 + count) % 193));
+    }
+    // The multi-buffer kernel is used even with the SHA extensions.
+    base::CPU::SetDisabledFeaturesForTesting(base::CPU::FEATURE_SHA);
+    std::vector<uint8_t> output(count * crypto::kSHA256Length + 1, 0xcc);
+    crypto::SHA256HashStrings(strs.data(), count, output.data());
+    base::CPU::SetDisabledFeaturesForTesting(0);
+
+    for (size_t i = 0; i < count; i++) {
+      EXPECT_EQ(crypto::SHA256HashString(strs[i]),
+                std::string(reinterpret_cast<const char*>(
+                                &output[i * crypto::kSHA256Length]),
+                            crypto::kSHA256Length))
+          << "count " << count << ", string " << i;
+    }
+    // Nothing is written past the last hash.
+    EXPECT_EQ(0xcc, output.back());
+  }
+}
+
+TEST(Sha256Test, SecureHashMatchesWithoutSHAExtensions) {
+  // Messages of every length up to three blocks, at unaligned offsets, fed to
+  // SecureHash whole and in pieces that leave partial blocks buffered.
+  std::string data(300, 0);
+  uint32_t x = 1;
+  for (size_t i = 0; i < data.size(); i++) {
+    x = x * 1103515245 + 12345;
+    data[i] = static_cast<char>(x >> 16);
+  }
+
+  for (size_t length = 0; length <= 3 * 64; length++) {
+    const base::StringPiece message(data.data() + length % 7, length);
+    const size_t split = length * 5 / 7;
+    std::string hashes[2];
+    for (int i = 0; i < 2; i++) {
+      base::CPU::SetDisabledFeaturesForTesting(i ? base::CPU::FEATURE_SHA : 0);
+      scoped_ptr<crypto::SecureHash> ctx(
+          crypto::SecureHash::Create(crypto::SecureHash::SHA256));
+      ctx->Update(message.data(), split);
+      ctx->Update(message.data() + split, length - split);
+      hashes[i].resize(crypto::kSHA256Length);
+      ctx->Finish(&hashes[i][0], crypto::kSHA256Length);
+      EXPECT_EQ(crypto::SHA256HashString(message), hashes[i])
+          << "length " << length;
+    }
+    base::CPU::SetDisabledFeaturesForTesting(0);
+    EXPECT_EQ(hashes[0], hashes[1]) << "length " << length;
+  }
+}
@@ -49,6 +49,7 @@
 #endif
 #include "crypto/third_party/nss/chromium-blapi.h"
 #include "crypto/third_party/nss/chromium-sha256.h"    /* for struct SHA256ContextStr */
+#include "crypto/sha2_internal.h"  /* Chromium: SHA extension block function */
 
 #include <stdlib.h>
 #include <string.h>
@@ -181,6 +182,13 @@ SHA256_Begin(SHA256Context *ctx)
 static void
 SHA256_Compress(SHA256Context *ctx)
 {
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+    /* Chromium: B holds the block in big-endian byte order. */
+    if (crypto::internal::CanUseSHA256Extensions()) {
+	crypto::internal::ProcessSHA256BlocksSHA(H, B, 1);
+	return;
+    }
+#endif
   {
     register PRUint32 t1, t2;
 
@@ -418,6 +426,16 @@ SHA256_Update(SHA256Context *ctx, const unsigned char *input,
     }
 
     /* if enough data to fill one or more whole buffers, process them. */
+#if defined(BASE_CPU_TARGET_ATTRIBUTES)
+    /* Chromium: the SHA extensions hash whole blocks in place. */
+    if (inputLen >= SHA256_BLOCK_LENGTH &&
+	crypto::internal::CanUseSHA256Extensions()) {
+	unsigned int numBlocks = inputLen / SHA256_BLOCK_LENGTH;
+	crypto::internal::ProcessSHA256BlocksSHA(H, input, numBlocks);
+	input    += numBlocks * SHA256_BLOCK_LENGTH;
+	inputLen -= numBlocks * SHA256_BLOCK_LENGTH;
+    }
+#endif
     while (inputLen >= SHA256_BLOCK_LENGTH) {
     	memcpy(B, input, SHA256_BLOCK_LENGTH);
 	input    += SHA256_BLOCK_LENGTH;